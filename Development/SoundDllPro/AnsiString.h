@@ -0,0 +1,106 @@
+//-----------------------------------------------------------------------------
+/// \file AnsiString.h
+/// \author Berg
+/// \brief Minimal AnsiString for building CAsio classes without VCL
+///
+/// Project SoundMexPro
+/// Module SoundDllPro
+/// Minimal replacement of the Borland AnsiString used by casioExceptions.h
+/// with compilers other than C++Builder (e.g. for the unit tests in
+/// UnitTest). Implements AnsiString(), AnsiString(const char*), c_str() and
+/// cat_sprintf(const char *, ...) only.
+///
+/// ****************************************************************************
+/// Copyright 2023 Daniel Berg, Oldenburg, Germany
+/// ****************************************************************************
+///
+/// This file is part of SoundMexPro.
+///
+///    SoundMexPro is free software: you can redistribute it and/or modify
+///    it under the terms of the GNU General Public License as published by
+///    the Free Software Foundation, either version 3 of the License, or
+///    (at your option) any later version.
+///
+///    SoundMexPro is distributed in the hope that it will be useful,
+///    but WITHOUT ANY WARRANTY; without even the implied warranty of
+///    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+///    GNU General Public License for more details.
+///
+///    You should have received a copy of the GNU General Public License
+///    along with SoundMexPro.  If not, see <http:///www.gnu.org/licenses/>.
+///
+//-----------------------------------------------------------------------------
+#ifndef AnsiStringH
+#define AnsiStringH
+
+#include <stdarg.h>
+#include <stdio.h>
+#include <string>
+#include <vector>
+
+/// String class with the subset of the Borland AnsiString interface needed
+/// by CAsio.
+///
+/// variable prefix: str for (STR)ing
+class AnsiString {
+    std::string m_str;
+public:
+    AnsiString() {}
+
+    AnsiString(const char * lpsz) : m_str(lpsz ? lpsz : "") {}
+
+    /// Returns the zero terminated contents.
+    const char * c_str() const { return m_str.c_str(); }
+
+    /// Returns true if the string is empty.
+    bool IsEmpty() const { return m_str.empty(); }
+
+    /// Appends formatted text (printf format) and returns *this.
+    AnsiString & cat_sprintf(const char * lpszFormat, ...)
+    {
+        va_list args;
+        va_start(args, lpszFormat);
+        va_list argsCopy;
+        va_copy(argsCopy, args);
+        int nLen = vsnprintf(NULL, 0, lpszFormat, argsCopy);
+        va_end(argsCopy);
+        if (nLen > 0)
+        {
+            std::vector<char> vc((size_t)nLen + 1);
+            vsnprintf(&vc[0], vc.size(), lpszFormat, args);
+            m_str.append(&vc[0], (size_t)nLen);
+        }
+        va_end(args);
+        return *this;
+    }
+
+    AnsiString & operator+=(const AnsiString & str)
+    {
+        m_str += str.m_str;
+        return *this;
+    }
+
+    AnsiString operator+(const AnsiString & str) const
+    {
+        AnsiString strReturn(*this);
+        strReturn += str;
+        return strReturn;
+    }
+
+    bool operator==(const AnsiString & str) const
+    {
+        return m_str == str.m_str;
+    }
+};
+
+#endif
+
+
+// Next comment block tells emacs editor how to format code in this file.
+
+// Local Variables:
+// mode: c++
+// c-file-style: "stroustrup"
+// c-basic-offset: 4
+// indent-tabs-mode: nil
+// End:
@@ -0,0 +1,466 @@
+//-----------------------------------------------------------------------------
+/// \file SoundDllProBenchmark.cpp
+/// \author Berg
+/// \brief Benchmark of SoundDllPro.dll with synthetic sessions
+///
+/// Project SoundMexPro
+/// Module SoundDllPro
+/// Loads SoundDllPro.dll and runs synthetic sessions with driver model 'null'
+/// processing buffers as fast as possible (nullclock=1) for several buffer
+/// sizes:
+///    tracks   many tracks with memory and file data, ramps, loops, loop
+///             crossfades and crossfades between consecutive segments
+///    vst      VST plugins on several layers (positions) of track and master
+///             host (plugins passed with -vst, skipped if none passed)
+///    record   recording of several input channels (loopback) to files
+///    full     all of the above
+/// For each session and buffer size the 'perfreport' of SoundDllPro is
+/// collected and all reports are written as one JSON object to a file or
+/// stdout. NOTE: driver model 'null' calls all callbacks in its clock thread,
+/// so the queues and processing/done threads of driver model 'asio' are not
+/// part of the measurements. Usage:
+///    SoundDllProBenchmark [-dll SoundDllPro.dll] [-out report.json]
+///                         [-session tracks,vst,record,full]
+///                         [-bufsize 64,256,1024] [-seconds 10]
+///                         [-vst plugin.dll[,configfile]] [-vst ...]
+///
+/// ****************************************************************************
+/// Copyright 2023 Daniel Berg, Oldenburg, Germany
+/// ****************************************************************************
+///
+/// This file is part of SoundMexPro.
+///
+///    SoundMexPro is free software: you can redistribute it and/or modify
+///    it under the terms of the GNU General Public License as published by
+///    the Free Software Foundation, either version 3 of the License, or
+///    (at your option) any later version.
+///
+///    SoundMexPro is distributed in the hope that it will be useful,
+///    but WITHOUT ANY WARRANTY; without even the implied warranty of
+///    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+///    GNU General Public License for more details.
+///
+///    You should have received a copy of the GNU General Public License
+///    along with SoundMexPro.  If not, see <http:///www.gnu.org/licenses/>.
+///
+//-----------------------------------------------------------------------------
+#include <windows.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <math.h>
+#include <chrono>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include "soundmexpro_defs.h"
+
+/// sample rate of all sessions
+static const int c_nSampleRate = 44100;
+/// number of tracks of sessions with track data
+static const int c_nTracks = 16;
+/// number of recorded input channels
+static const int c_nInputs = 4;
+/// length of ramps and crossfades in samples
+static const int c_nRampLen = 441;
+/// maximum size of return values (large enough for perfreport)
+static const int c_nRetLen = 1 << 16;
+
+static const char * const c_rglpszSessions[] = { "tracks", "vst", "record", "full" };
+static const int c_nSessions = sizeof(c_rglpszSessions) / sizeof(c_rglpszSessions[0]);
+
+/// VST plugin to load with optional config file
+struct Plugin {
+    std::string strFileName;
+    std::string strConfigFile;
+};
+
+/// command line options
+struct Options {
+    std::string strDll;
+    std::string strOut;
+    std::vector<std::string> vstrSessions;
+    std::vector<int> viBufsizes;
+    double dSeconds;
+    std::vector<Plugin> vPlugins;
+};
+
+static LPFNSOUNDDLLPROCOMMAND g_lpfnCommand = NULL;
+
+/// Splits a comma separated list.
+static std::vector<std::string> Split(const std::string & str)
+{
+    std::vector<std::string> vstr;
+    std::string::size_type nStart = 0;
+    while (nStart <= str.size())
+    {
+        std::string::size_type nPos = str.find(',', nStart);
+        if (nPos == std::string::npos)
+            nPos = str.size();
+        if (nPos > nStart)
+            vstr.push_back(str.substr(nStart, nPos - nStart));
+        nStart = nPos + 1;
+    }
+    return vstr;
+}
+
+/// Returns comma separated list of indices nFirst..nFirst+nCount-1.
+static std::string Channels(int nFirst, int nCount)
+{
+    std::string str;
+    for (int n = nFirst; n < nFirst + nCount; ++n)
+    {
+        if (n > nFirst)
+            str += ",";
+        str += std::to_string(n);
+    }
+    return str;
+}
+
+/// Returns JSON string literal of str.
+static std::string JsonString(const std::string & str)
+{
+    std::string strJson = "\"";
+    for (size_t n = 0; n < str.size(); ++n)
+    {
+        char c = str[n];
+        if (c == '"' || c == '\\')
+            strJson += '\\';
+        if ((unsigned char)c < 0x20)
+            strJson += ' ';
+        else
+            strJson += c;
+    }
+    return strJson + "\"";
+}
+
+/// Calls SoundDllProCommand and returns the return string. Throws on error.
+static std::string Command(const std::string & strCommand)
+{
+    std::vector<char> vcRet(c_nRetLen, 0);
+    int nResult = g_lpfnCommand(strCommand.c_str(), &vcRet[0], c_nRetLen);
+    std::string strRet = &vcRet[0];
+    if (nResult != SOUNDDLL_RETURN_OK)
+        throw std::runtime_error("'" + strCommand + "' failed: " + strRet);
+    return strRet;
+}
+
+/// Returns temporary file name in the temp directory.
+static std::string TempFile(const std::string & strName)
+{
+    char szPath[MAX_PATH + 1] = { 0 };
+    if (!GetTempPathA(MAX_PATH, szPath))
+        throw std::runtime_error("cannot determine temp path");
+    return std::string(szPath) + "SoundDllProBenchmark_" + strName;
+}
+
+/// Writes a stereo 16 bit wave file with nSamples samples of noise.
+static void WriteWaveFile(const std::string & strFileName, uint32_t nSamples)
+{
+    FILE * pf = fopen(strFileName.c_str(), "wb");
+    if (!pf)
+        throw std::runtime_error("cannot create " + strFileName);
+    const uint16_t nChannels = 2;
+    const uint16_t nBits = 16;
+    uint32_t nDataBytes = nSamples * nChannels * (nBits / 8);
+    uint32_t dw;
+    uint16_t w;
+    fwrite("RIFF", 1, 4, pf);
+    dw = 36 + nDataBytes;                        fwrite(&dw, 4, 1, pf);
+    fwrite("WAVEfmt ", 1, 8, pf);
+    dw = 16;                                     fwrite(&dw, 4, 1, pf);
+    w = 1;                                       fwrite(&w, 2, 1, pf);
+    w = nChannels;                               fwrite(&w, 2, 1, pf);
+    dw = c_nSampleRate;                          fwrite(&dw, 4, 1, pf);
+    dw = c_nSampleRate * nChannels * (nBits / 8); fwrite(&dw, 4, 1, pf);
+    w = nChannels * (nBits / 8);                 fwrite(&w, 2, 1, pf);
+    w = nBits;                                   fwrite(&w, 2, 1, pf);
+    fwrite("data", 1, 4, pf);
+    fwrite(&nDataBytes, 4, 1, pf);
+    std::vector<int16_t> vn((size_t)nSamples * nChannels);
+    for (size_t n = 0; n < vn.size(); ++n)
+        vn[n] = (int16_t)(rand() % 16384 - 8192);
+    bool bOk = fwrite(&vn[0], sizeof(int16_t), vn.size(), pf) == vn.size();
+    fclose(pf);
+    if (!bOk)
+        throw std::runtime_error("cannot write " + strFileName);
+}
+
+/// Loads track data: nSegments memory segments (stereo, non-interleaved
+/// doubles) with ramps and crossfades between them and one looped wave file
+/// with loop crossfades to all tracks. vdData must stay valid until 'exit'.
+static void LoadTracks(std::vector<double> & vdData, const std::string & strWaveFile,
+                       double dSeconds)
+{
+    // a quarter of the duration in memory segments, the rest in the looped file
+    const int nSegments = 4;
+    uint32_t nSegmentSamples = (uint32_t)(dSeconds * c_nSampleRate / 4 / nSegments);
+    vdData.resize((size_t)nSegmentSamples * 2);
+    for (size_t n = 0; n < vdData.size(); ++n)
+        vdData[n] = 0.25 * sin(0.01 * (double)n);
+    std::string strTracks = Channels(0, c_nTracks);
+    for (int nSegment = 0; nSegment < nSegments; ++nSegment)
+        Command("command=loadmem;data=" + std::to_string((uint64_t)(uintptr_t)&vdData[0])
+                + ";samples=" + std::to_string(nSegmentSamples)
+                + ";channels=2;track=" + strTracks
+                + ";ramplen=" + std::to_string(c_nRampLen)
+                + ";crossfadelen=" + std::to_string(nSegment ? c_nRampLen : 0));
+    // file is written with a quarter of the duration and played three times
+    Command("command=loadfile;filename=" + strWaveFile
+            + ";track=" + strTracks
+            + ";loopcount=3;loopramplen=" + std::to_string(c_nRampLen)
+            + ";loopcrossfade=1;crossfadelen=" + std::to_string(c_nRampLen));
+}
+
+/// Loads all plugins on consecutive positions of track and master host.
+static void LoadPlugins(const std::vector<Plugin> & vPlugins)
+{
+    static const char * const c_rglpszTypes[] = { "track", "master" };
+    for (int nType = 0; nType < 2; ++nType)
+    {
+        for (size_t nPlugin = 0; nPlugin < vPlugins.size(); ++nPlugin)
+        {
+            std::string str = "command=vstload;type=" + std::string(c_rglpszTypes[nType])
+                + ";filename=" + vPlugins[nPlugin].strFileName
+                + ";input=0,1;output=0,1;position=" + std::to_string(nPlugin);
+            if (!vPlugins[nPlugin].strConfigFile.empty())
+                str += ";configfile=" + vPlugins[nPlugin].strConfigFile;
+            Command(str);
+        }
+    }
+}
+
+/// Runs one session with one buffer size and returns the JSON object of the
+/// run including the perfreport.
+static std::string RunSession(const Options & o, const std::string & strSession,
+                              int nBufsize, const std::string & strWaveFile)
+{
+    bool bFull = strSession == "full";
+    bool bTracks = bFull || strSession == "tracks";
+    bool bVst = bFull || strSession == "vst";
+    bool bRecord = bFull || strSession == "record";
+    int nTracks = bTracks ? c_nTracks : 2;
+    std::string strReportFile = TempFile("report.json");
+
+    Command("command=setdrivermodel;value=null");
+    std::string strInit = "command=init;samplerate=" + std::to_string(c_nSampleRate)
+        + ";bufsize=" + std::to_string(nBufsize)
+        + ";output=0,1;track=" + std::to_string(nTracks)
+        + ";nullclock=1";
+    if (bRecord)
+        strInit += ";nullinput=1;input=" + Channels(0, c_nInputs);
+    Command(strInit);
+    std::vector<double> vdData;
+    std::chrono::duration<double> dElapsed(0);
+    try
+    {
+        if (bTracks)
+            LoadTracks(vdData, strWaveFile, o.dSeconds);
+        else
+        {
+            // plain data on two tracks defining the duration of the run
+            vdData.assign((size_t)(o.dSeconds * c_nSampleRate) * 2, 0.0);
+            for (size_t n = 0; n < vdData.size(); ++n)
+                vdData[n] = 0.25 * sin(0.01 * (double)n);
+            Command("command=loadmem;data=" + std::to_string((uint64_t)(uintptr_t)&vdData[0])
+                    + ";samples=" + std::to_string(vdData.size() / 2)
+                    + ";channels=2;track=0,1");
+        }
+        if (bVst)
+            LoadPlugins(o.vPlugins);
+        if (bRecord)
+        {
+            std::string strFiles;
+            for (int nInput = 0; nInput < c_nInputs; ++nInput)
+                strFiles += (nInput ? ",'" : "'") + TempFile("rec" + std::to_string(nInput) + ".wav") + "'";
+            Command("command=recfilename;channel=" + Channels(0, c_nInputs) + ";filename=" + strFiles);
+        }
+        Command("command=perfstatsreset");
+        std::chrono::steady_clock::time_point tpStart = std::chrono::steady_clock::now();
+        Command("command=start");
+        Command("command=wait;timeout=600000");
+        dElapsed = std::chrono::steady_clock::now() - tpStart;
+        Command("command=stop");
+        Command("command=perfreport;filename=" + strReportFile);
+    }
+    catch (...)
+    {
+        std::vector<char> vcRet(c_nRetLen, 0);
+        g_lpfnCommand("command=exit", &vcRet[0], c_nRetLen);
+        throw;
+    }
+    Command("command=exit");
+
+    std::string strReport;
+    FILE * pf = fopen(strReportFile.c_str(), "rb");
+    if (!pf)
+        throw std::runtime_error("cannot read " + strReportFile);
+    char sz[4096];
+    size_t nRead;
+    while ((nRead = fread(sz, 1, sizeof(sz), pf)) > 0)
+        strReport.append(sz, nRead);
+    fclose(pf);
+    remove(strReportFile.c_str());
+    while (!strReport.empty() && (unsigned char)strReport[strReport.size() - 1] <= ' ')
+        strReport.erase(strReport.size() - 1);
+
+    char szElapsed[64];
+    snprintf(szElapsed, sizeof(szElapsed), "%.6f", dElapsed.count());
+    return "{\"session\":" + JsonString(strSession)
+        + ",\"bufsize\":" + std::to_string(nBufsize)
+        + ",\"tracks\":" + std::to_string(nTracks)
+        + ",\"inputs\":" + std::to_string(bRecord ? c_nInputs : 0)
+        + ",\"plugins\":" + std::to_string(bVst ? o.vPlugins.size() : 0)
+        + ",\"elapsed\":" + szElapsed
+        + ",\"report\":" + strReport + "}";
+}
+
+/// Parses command line into o. Returns false on bad arguments.
+static bool ParseArgs(int argc, char * argv[], Options & o)
+{
+    o.strDll = "SoundDllPro.dll";
+    o.vstrSessions.assign(c_rglpszSessions, c_rglpszSessions + c_nSessions);
+    o.viBufsizes.push_back(64);
+    o.viBufsizes.push_back(256);
+    o.viBufsizes.push_back(1024);
+    o.dSeconds = 10;
+    for (int n = 1; n < argc; ++n)
+    {
+        std::string strArg = argv[n];
+        if (n + 1 >= argc)
+            return false;
+        std::string strValue = argv[++n];
+        if (strArg == "-dll")
+            o.strDll = strValue;
+        else if (strArg == "-out")
+            o.strOut = strValue;
+        else if (strArg == "-seconds")
+            o.dSeconds = atof(strValue.c_str());
+        else if (strArg == "-session")
+            o.vstrSessions = Split(strValue);
+        else if (strArg == "-bufsize")
+        {
+            o.viBufsizes.clear();
+            std::vector<std::string> vstr = Split(strValue);
+            for (size_t i = 0; i < vstr.size(); ++i)
+                o.viBufsizes.push_back(atoi(vstr[i].c_str()));
+        }
+        else if (strArg == "-vst")
+        {
+            std::vector<std::string> vstr = Split(strValue);
+            if (vstr.empty() || vstr.size() > 2)
+                return false;
+            Plugin p;
+            p.strFileName = vstr[0];
+            if (vstr.size() > 1)
+                p.strConfigFile = vstr[1];
+            o.vPlugins.push_back(p);
+        }
+        else
+            return false;
+    }
+    if (o.dSeconds <= 0 || o.viBufsizes.empty())
+        return false;
+    for (size_t i = 0; i < o.vstrSessions.size(); ++i)
+    {
+        bool bKnown = false;
+        for (int nSession = 0; nSession < c_nSessions; ++nSession)
+            bKnown |= o.vstrSessions[i] == c_rglpszSessions[nSession];
+        if (!bKnown)
+            return false;
+    }
+    for (size_t i = 0; i < o.viBufsizes.size(); ++i)
+        if (o.viBufsizes[i] <= 0)
+            return false;
+    return true;
+}
+
+int main(int argc, char * argv[])
+{
+    Options o;
+    if (!ParseArgs(argc, argv, o))
+    {
+        fprintf(stderr,
+                "usage: SoundDllProBenchmark [-dll SoundDllPro.dll] [-out report.json]\n"
+                "                            [-session tracks,vst,record,full]\n"
+                "                            [-bufsize 64,256,1024] [-seconds 10]\n"
+                "                            [-vst plugin.dll[,configfile]] [-vst ...]\n");
+        return 1;
+    }
+    HMODULE hLib = LoadLibraryA(o.strDll.c_str());
+    if (!hLib)
+    {
+        fprintf(stderr, "error loading %s\n", o.strDll.c_str());
+        return 1;
+    }
+    // exported name may be decorated with a leading underscore
+    g_lpfnCommand = (LPFNSOUNDDLLPROCOMMAND)GetProcAddress(hLib, "_" SOUNDDLL_COMMANDNAME);
+    if (!g_lpfnCommand)
+        g_lpfnCommand = (LPFNSOUNDDLLPROCOMMAND)GetProcAddress(hLib, SOUNDDLL_COMMANDNAME);
+    if (!g_lpfnCommand)
+    {
+        fprintf(stderr, "%s not found in %s\n", SOUNDDLL_COMMANDNAME, o.strDll.c_str());
+        FreeLibrary(hLib);
+        return 1;
+    }
+
+    int nReturn = 0;
+    std::string strWaveFile = TempFile("tracks.wav");
+    std::string strJson = "{\"seconds\":" + std::to_string(o.dSeconds) + ",\"runs\":[";
+    bool bFirst = true;
+    try
+    {
+        WriteWaveFile(strWaveFile, (uint32_t)(o.dSeconds * c_nSampleRate / 4));
+        for (size_t nSession = 0; nSession < o.vstrSessions.size(); ++nSession)
+        {
+            const std::string & strSession = o.vstrSessions[nSession];
+            if (strSession == "vst" && o.vPlugins.empty())
+            {
+                fprintf(stderr, "session 'vst' skipped: no plugins passed (-vst)\n");
+                continue;
+            }
+            for (size_t nBufsize = 0; nBufsize < o.viBufsizes.size(); ++nBufsize)
+            {
+                fprintf(stderr, "%-8s bufsize %5d ...\n", strSession.c_str(), o.viBufsizes[nBufsize]);
+                std::string strRun = RunSession(o, strSession, o.viBufsizes[nBufsize], strWaveFile);
+                strJson += (bFirst ? "\n" : ",\n") + strRun;
+                bFirst = false;
+            }
+        }
+    }
+    catch (const std::exception & e)
+    {
+        fprintf(stderr, "error: %s\n", e.what());
+        nReturn = 1;
+    }
+    remove(strWaveFile.c_str());
+    for (int nInput = 0; nInput < c_nInputs; ++nInput)
+        remove(TempFile("rec" + std::to_string(nInput) + ".wav").c_str());
+    strJson += "\n]}\n";
+
+    if (!nReturn)
+    {
+        FILE * pf = o.strOut.empty() ? stdout : fopen(o.strOut.c_str(), "wb");
+        if (!pf)
+        {
+            fprintf(stderr, "cannot create %s\n", o.strOut.c_str());
+            nReturn = 1;
+        }
+        else
+        {
+            fputs(strJson.c_str(), pf);
+            if (pf != stdout)
+                fclose(pf);
+        }
+    }
+    FreeLibrary(hLib);
+    return nReturn;
+}
+
+// Local Variables:
+// mode: c++
+// c-file-style: "stroustrup"
+// c-basic-offset: 4
+// indent-tabs-mode: nil
+// End:
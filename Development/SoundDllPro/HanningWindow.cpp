@@ -2,7 +2,8 @@
 /// \file HanningWindow.cpp
 ///
 /// \author Berg
-/// \brief Implementation hanning window class CHanningWindow
+/// \brief Implementation hanning window class CHanningWindow and cached hanning
+/// ramp tables
 ///
 /// Project SoundMexPro
 /// Module  SoundDllPro.dll
@@ -30,9 +31,250 @@
 #pragma hdrstop
 #include <math.h>
 #include <tchar.h>
+#include <map>
+#include <vector>
 #include "HanningWindow.h"
 //------------------------------------------------------------------------------
 
+//------------------------------------------------------------------------------
+/// \class CHanningTable, prefix ht. Hanning 'up' ramp values for one window
+/// length: m_vfValues[n] = 0.5 - 0.5*cos(M_PI*n/m_nLength) for n = 0...m_nLength.
+/// NOTE: tables are immutable and are not deleted while referenced, so pointers
+/// returned by AcquireHanningTable stay valid and may be read without locking
+/// until ReleaseHanningTable is called
+//------------------------------------------------------------------------------
+class CHanningTable
+{
+   public:
+      CHanningTable(unsigned int nLength);
+      unsigned int         m_nLength;
+      unsigned int         m_nRefCount;   ///< number of references (protected by cache)
+      std::vector<float>   m_vfValues;
+};
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+/// \class CHanningTableCache, prefix htc. Process wide cache of reference
+/// counted hanning tables keyed by window length. Access is protected by a
+/// critical section. Unreferenced tables are kept for re-use, until their total
+/// number of values exceeds HANNINGTABLE_MAXUNUSED
+//------------------------------------------------------------------------------
+#define HANNINGTABLE_MAXUNUSED   (1 << 21)
+class CHanningTableCache
+{
+   public:
+      CHanningTableCache();
+      ~CHanningTableCache();
+      const CHanningTable* Acquire(unsigned int nLength);
+      void                 Release(const float* pfTable);
+   private:
+      CRITICAL_SECTION                          m_cs;
+      std::map<unsigned int, CHanningTable*>    m_mTables;
+      unsigned int                              m_nUnused;  ///< number of values of unreferenced tables
+      void                                      Purge();
+};
+//------------------------------------------------------------------------------
+/// global instance of hanning table cache
+static CHanningTableCache g_htcHanningTables;
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+/// constructor. Calculates table values
+//------------------------------------------------------------------------------
+CHanningTable::CHanningTable(unsigned int nLength)
+   : m_nLength(nLength), m_nRefCount(0)
+{
+   m_vfValues.resize(nLength+1);
+   for (unsigned int n = 0; n <= nLength; n++)
+      m_vfValues[n] = (float)(0.5 - 0.5*cos(M_PI*(double)(n)/(double)nLength));
+}
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+/// constructor. Initializes members
+//------------------------------------------------------------------------------
+CHanningTableCache::CHanningTableCache()
+   : m_nUnused(0)
+{
+   InitializeCriticalSection(&m_cs);
+}
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+/// destructor. Deletes all tables
+//------------------------------------------------------------------------------
+CHanningTableCache::~CHanningTableCache()
+{
+   std::map<unsigned int, CHanningTable*>::iterator it;
+   for (it = m_mTables.begin(); it != m_mTables.end(); it++)
+      delete it->second;
+   m_mTables.clear();
+   DeleteCriticalSection(&m_cs);
+}
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+/// returns table for passed length and increments its reference count.
+/// Creates it, if not existing yet
+//------------------------------------------------------------------------------
+const CHanningTable* CHanningTableCache::Acquire(unsigned int nLength)
+{
+   CHanningTable* pht;
+   EnterCriticalSection(&m_cs);
+   try
+      {
+      std::map<unsigned int, CHanningTable*>::iterator it = m_mTables.find(nLength);
+      if (it != m_mTables.end())
+         {
+         pht = it->second;
+         if (!pht->m_nRefCount)
+            m_nUnused -= (unsigned int)pht->m_vfValues.size();
+         }
+      else
+         {
+         pht = new CHanningTable(nLength);
+         m_mTables[nLength] = pht;
+         }
+      pht->m_nRefCount++;
+      }
+   __finally
+      {
+      LeaveCriticalSection(&m_cs);
+      }
+   return pht;
+}
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+/// decrements reference count of table with passed values. Unreferenced tables
+/// are purged, if too many values are unused
+//------------------------------------------------------------------------------
+void CHanningTableCache::Release(const float* pfTable)
+{
+   EnterCriticalSection(&m_cs);
+   try
+      {
+      std::map<unsigned int, CHanningTable*>::iterator it;
+      for (it = m_mTables.begin(); it != m_mTables.end(); it++)
+         {
+         CHanningTable* pht = it->second;
+         if (&pht->m_vfValues[0] != pfTable)
+            continue;
+         if (pht->m_nRefCount && !--pht->m_nRefCount)
+            {
+            m_nUnused += (unsigned int)pht->m_vfValues.size();
+            Purge();
+            }
+         break;
+         }
+      }
+   __finally
+      {
+      LeaveCriticalSection(&m_cs);
+      }
+}
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+/// deletes unreferenced tables until number of unused values is below
+/// HANNINGTABLE_MAXUNUSED. NOTE: must be called within critical section
+//------------------------------------------------------------------------------
+void CHanningTableCache::Purge()
+{
+   std::map<unsigned int, CHanningTable*>::iterator it = m_mTables.begin();
+   while (m_nUnused > HANNINGTABLE_MAXUNUSED && it != m_mTables.end())
+      {
+      if (it->second->m_nRefCount)
+         {
+         it++;
+         continue;
+         }
+      m_nUnused -= (unsigned int)it->second->m_vfValues.size();
+      delete it->second;
+      m_mTables.erase(it++);
+      }
+}
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+/// returns shared table with uWindowLen+1 hanning 'up' ramp values, i.e.
+/// GetHanningValue(n, uWindowLen) for n = 0...uWindowLen. Table stays valid
+/// until it is released by ReleaseHanningTable. May compute the table, so it
+/// must not be called on processing thread
+//------------------------------------------------------------------------------
+const float* AcquireHanningTable(unsigned int uWindowLen)
+{
+   if (!uWindowLen)
+      throw Exception("invalid window lenght passed to "  + UnicodeString(__FUNC__));
+   return &g_htcHanningTables.Acquire(uWindowLen)->m_vfValues[0];
+}
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+/// releases a table returned by AcquireHanningTable. NULL is ignored
+//------------------------------------------------------------------------------
+void ReleaseHanningTable(const float* pfTable)
+{
+   if (pfTable)
+      g_htcHanningTables.Release(pfTable);
+}
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+/// writes uCount subsequent values of a hanning ramp with length uWindowLen
+/// starting at ramp position uWindowPos to pf. Values are identical to
+/// GetHanningRamp(uWindowPos + n, uWindowLen, bUp)
+//------------------------------------------------------------------------------
+void FillRamp(float* pf, unsigned int uWindowPos, unsigned int uCount, unsigned int uWindowLen, bool bUp)
+{
+   if (uWindowPos > uWindowLen || uCount > uWindowLen - uWindowPos + 1)
+      throw Exception("invalid window pos passed to "  + UnicodeString(__FUNC__));
+   const float* pfTable = AcquireHanningTable(uWindowLen);
+   const float* pfValue;
+   unsigned int n;
+   if (bUp)
+      {
+      pfValue = pfTable + uWindowPos;
+      for (n = 0; n < uCount; n++)
+         pf[n] = pfValue[n];
+      }
+   else
+      {
+      pfValue = pfTable + uWindowLen - uWindowPos;
+      for (n = 0; n < uCount; n++)
+         pf[n] = *pfValue--;
+      }
+   ReleaseHanningTable(pfTable);
+}
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+/// multiplies uCount subsequent values in pf with hanning ramp values (see
+/// FillRamp)
+//------------------------------------------------------------------------------
+void MultiplyRamp(float* pf, unsigned int uWindowPos, unsigned int uCount, unsigned int uWindowLen, bool bUp)
+{
+   if (uWindowPos > uWindowLen || uCount > uWindowLen - uWindowPos + 1)
+      throw Exception("invalid window pos passed to "  + UnicodeString(__FUNC__));
+   const float* pfTable = AcquireHanningTable(uWindowLen);
+   const float* pfValue;
+   unsigned int n;
+   if (bUp)
+      {
+      pfValue = pfTable + uWindowPos;
+      for (n = 0; n < uCount; n++)
+         pf[n] *= pfValue[n];
+      }
+   else
+      {
+      pfValue = pfTable + uWindowLen - uWindowPos;
+      for (n = 0; n < uCount; n++)
+         pf[n] *= *pfValue--;
+      }
+   ReleaseHanningTable(pfTable);
+}
+//------------------------------------------------------------------------------
+
 
 //------------------------------------------------------------------------------
 /// returns hanning value for a window
@@ -67,11 +309,19 @@ float GetHanningValue(unsigned int uWindowPos, unsigned int uWindowLen)
 /// \brief constructor. initializes members
 //------------------------------------------------------------------------------
 CHanningWindow::CHanningWindow()
-   : m_ws(WINDOWSTATE_UP), m_nWindowPos(0), m_nWindowLen(0)
+   : m_ws(WINDOWSTATE_UP), m_nWindowPos(0), m_nWindowLen(0), m_pfTable(NULL)
 {
 }
 //------------------------------------------------------------------------------
 //------------------------------------------------------------------------------
+/// \brief destructor. Releases shared hanning table
+//------------------------------------------------------------------------------
+CHanningWindow::~CHanningWindow()
+{
+   ReleaseHanningTable(m_pfTable);
+}
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
 /// \brief returns actual state of window
 /// \retval internal state m_ws
 //------------------------------------------------------------------------------
@@ -114,6 +364,10 @@ void CHanningWindow::SetLength(unsigned int n)
    // changing length only allowed in non-running state
    if (m_ws == WINDOWSTATE_RUNUP || m_ws == WINDOWSTATE_RUNDOWN)
       throw Exception(_T("changing ramp length not allowed while ramp is active"));
+   // retrieve table here: GetValue must not do any table lookup
+   const float* pfTable = n ? AcquireHanningTable(n) : NULL;
+   ReleaseHanningTable(m_pfTable);
+   m_pfTable    = pfTable;
    m_nWindowLen = n;
 }
 //------------------------------------------------------------------------------
@@ -156,7 +410,7 @@ float CHanningWindow::GetValue(void)
       return 1.0f;
    else
       {
-      float f = GetHanningValue(m_nWindowLen-m_nWindowPos, m_nWindowLen);
+      float f = m_pfTable[m_nWindowLen-m_nWindowPos];
       if (m_ws == WINDOWSTATE_RUNDOWN)
          m_nWindowPos++;
       else if (m_ws == WINDOWSTATE_RUNUP)
@@ -177,3 +431,64 @@ float CHanningWindow::GetValue(void)
 }
 //------------------------------------------------------------------------------
 
+//------------------------------------------------------------------------------
+/// \brief writes nCount subsequent window values to pf. Values, position and
+/// state are identical to calling GetValue() nCount times
+/// \param[out] pf buffer to write values to
+/// \param[in] nCount number of values to write
+//------------------------------------------------------------------------------
+void CHanningWindow::GetValues(float* pf, unsigned int nCount)
+{
+   unsigned int n, nRamp;
+   while (nCount)
+      {
+      // zero length or invalid positions are handled by GetValue
+      if (  m_nWindowLen == 0
+         || (m_ws == WINDOWSTATE_RUNDOWN && m_nWindowPos >= m_nWindowLen)
+         || (m_ws == WINDOWSTATE_RUNUP && (m_nWindowPos == 0 || m_nWindowPos > m_nWindowLen))
+         )
+         {
+         *pf++ = GetValue();
+         nCount--;
+         continue;
+         }
+      if (m_ws == WINDOWSTATE_DOWN || m_ws == WINDOWSTATE_UP)
+         {
+         float f = m_ws == WINDOWSTATE_UP ? 1.0f : 0.0f;
+         for (n = 0; n < nCount; n++)
+            pf[n] = f;
+         return;
+         }
+      // running ramp: copy table values until border is reached
+      if (m_ws == WINDOWSTATE_RUNDOWN)
+         {
+         nRamp = m_nWindowLen - m_nWindowPos;
+         if (nRamp > nCount)
+            nRamp = nCount;
+         const float* pfTable = &m_pfTable[m_nWindowLen-m_nWindowPos];
+         for (n = 0; n < nRamp; n++)
+            pf[n] = *pfTable--;
+         m_nWindowPos += nRamp;
+         if (m_nWindowPos >= m_nWindowLen)
+            {
+            m_nWindowPos   = m_nWindowLen;
+            m_ws           = WINDOWSTATE_DOWN;
+            }
+         }
+      else
+         {
+         nRamp = m_nWindowPos;
+         if (nRamp > nCount)
+            nRamp = nCount;
+         const float* pfTable = &m_pfTable[m_nWindowLen-m_nWindowPos];
+         for (n = 0; n < nRamp; n++)
+            pf[n] = pfTable[n];
+         m_nWindowPos -= nRamp;
+         if (m_nWindowPos == 0)
+            m_ws = WINDOWSTATE_UP;
+         }
+      pf       += nRamp;
+      nCount   -= nRamp;
+      }
+}
+//------------------------------------------------------------------------------
@@ -2,7 +2,8 @@
 /// \file HanningWindow.h
 ///
 /// \author Berg
-/// \brief Implementation hanning window class CHanningWindow
+/// \brief Implementation hanning window class CHanningWindow and cached hanning
+/// ramp tables
 ///
 /// Project SoundMexPro
 /// Module  SoundDllPro.dll
@@ -48,6 +49,18 @@ enum WindowState
 /// returns hanning value for a window
 //------------------------------------------------------------------------------
 float GetHanningValue(unsigned int uWindowPos, unsigned int uWindowLen);
+//------------------------------------------------------------------------------
+/// returns shared table with uWindowLen+1 hanning 'up' ramp values and releases
+/// it (reference counted)
+//------------------------------------------------------------------------------
+const float* AcquireHanningTable(unsigned int uWindowLen);
+void  ReleaseHanningTable(const float* pfTable);
+//------------------------------------------------------------------------------
+/// writes/multiplies uCount subsequent hanning ramp values starting at ramp
+/// position uWindowPos to/with passed buffer
+//------------------------------------------------------------------------------
+void  FillRamp(float* pf, unsigned int uWindowPos, unsigned int uCount, unsigned int uWindowLen, bool bUp);
+void  MultiplyRamp(float* pf, unsigned int uWindowPos, unsigned int uCount, unsigned int uWindowLen, bool bUp);
 
    //------------------------------------------------------------------------------
    /// \class CHanningWindow, prefix hw
@@ -58,17 +71,23 @@ float GetHanningValue(unsigned int uWindowPos, unsigned int uWindowLen);
       friend class UNIT_TEST_CLASS;
       public:
          CHanningWindow();
+         ~CHanningWindow();
          WindowState GetState(void);
          bool        Running(void);
          void        SetState(WindowState ws);
          void        SetLength(unsigned int n);
          unsigned int GetLength(void);
          float       GetValue(void);
+         void        GetValues(float* pf, unsigned int nCount);
          unsigned int GetPosition(void);
       private:
          WindowState    m_ws;       ///< actual 'window state' of window
          unsigned int   m_nWindowPos; ///< actual position of window
          unsigned int   m_nWindowLen; ///< length of window
+         const float*   m_pfTable;  ///< shared hanning table for m_nWindowLen
+         // table is released in destructor: no copies
+         CHanningWindow(const CHanningWindow&);
+         CHanningWindow& operator=(const CHanningWindow&);
    };
 
 //------------------------------------------------------------------------------
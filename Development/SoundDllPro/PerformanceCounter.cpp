@@ -2,7 +2,8 @@
 /// \file PerformanceCounter.cpp
 /// \author Berg
 /// \brief Implementation of class CPerformanceCounter (encapsulating calls
-/// to QueryPerformance??? commands)
+/// to QueryPerformance??? commands or clock_gettime respectively) with
+/// lock-free log-bucketed histogram of measured values
 ///
 /// Project SoundMexPro
 /// Module  SoundDllPro.dll
@@ -30,29 +31,78 @@
 //------------------------------------------------------------------------------
 #pragma hdrstop
 
+#include <math.h>
+#ifndef _WIN32
+#include <time.h>
+#endif
 #include "PerformanceCounter.h"
 //------------------------------------------------------------------------------
 
+// atomic operations used for histogram buckets
+#ifdef _WIN32
+   #define PERF_ATOMIC_INC(p)       InterlockedIncrement(p)
+   #define PERF_ATOMIC_XCHG(p, v)   InterlockedExchange(p, v)
+#else
+   #define PERF_ATOMIC_INC(p)       __sync_add_and_fetch(p, 1)
+   #define PERF_ATOMIC_XCHG(p, v)   __sync_lock_test_and_set(p, v)
+#endif
+
 //------------------------------------------------------------------------------
-/// Constructor. Retrieves QueryPerformanceFrequency and sets class valid on success.
+/// Constructor. Retrieves timer frequency and sets class valid on success.
 //------------------------------------------------------------------------------
 CPerformanceCounter::CPerformanceCounter()
+   :  m_nLast(0),
+      m_nThis(0),
+      m_dDecayValue(0.0),
+      m_dThreshold(0.0)
 {
-   LARGE_INTEGER  liFreq;
-   m_bValid = QueryPerformanceFrequency(&liFreq);
-   if (m_bValid)
-      m_dFrequency = (double)liFreq.QuadPart;
+   m_dFrequency   = GetTicksPerSecond();
+   m_bValid       = m_dFrequency > 0.0;
    Reset();
 }
 //------------------------------------------------------------------------------
 
+//------------------------------------------------------------------------------
+/// returns current value of portable high resolution timer in ticks
+//------------------------------------------------------------------------------
+int64_t CPerformanceCounter::GetTicks()
+{
+   #ifdef _WIN32
+   LARGE_INTEGER li;
+   if (!QueryPerformanceCounter(&li))
+      return 0;
+   return (int64_t)li.QuadPart;
+   #else
+   struct timespec ts;
+   clock_gettime(CLOCK_MONOTONIC, &ts);
+   return (int64_t)ts.tv_sec * 1000000000 + (int64_t)ts.tv_nsec;
+   #endif
+}
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+/// returns frequency of timer returned by GetTicks (0 if not available)
+//------------------------------------------------------------------------------
+double CPerformanceCounter::GetTicksPerSecond()
+{
+   #ifdef _WIN32
+   LARGE_INTEGER li;
+   if (!QueryPerformanceFrequency(&li))
+      return 0.0;
+   return (double)li.QuadPart;
+   #else
+   return 1e9;
+   #endif
+}
+//------------------------------------------------------------------------------
+
 //------------------------------------------------------------------------------
 /// Starts counter
 //------------------------------------------------------------------------------
 void CPerformanceCounter::Start()
 {
    if (m_bValid)
-      m_bValid = QueryPerformanceCounter(&m_liLast);
+      m_nLast = GetTicks();
 }
 //------------------------------------------------------------------------------
 
@@ -63,26 +113,36 @@ double CPerformanceCounter::Stop()
 {
    if (m_bValid)
       {
-      m_bValid = QueryPerformanceCounter(&m_liThis);
+      m_nThis = GetTicks();
       // calculate time in seconds that is elapsed
-      double d = ((double)m_liThis.QuadPart - (double)m_liLast.QuadPart)/ m_dFrequency;
+      double d = (double)(m_nThis - m_nLast) / m_dFrequency;
       if (d > m_dValueMax)
          m_dValueMax = d;
       m_dValue = d;
       // store it with decay
       m_dDecayValue = m_dDecayValue * 0.9 + (0.1)*d;
+      m_dSum += d;
+      // store it in histogram
+      PERF_ATOMIC_INC(&m_anBuckets[BucketIndex(d)]);
+      if (m_dThreshold > 0.0 && d > m_dThreshold)
+         PERF_ATOMIC_INC(&m_nAboveThreshold);
       }
    return m_dValue;
 }
 //------------------------------------------------------------------------------
 
 //------------------------------------------------------------------------------
-/// resets internal performance value
+/// resets internal performance value, sum and histogram. May be called while
+/// counter is running
 //------------------------------------------------------------------------------
 void CPerformanceCounter::Reset()
 {
-   m_dValue    = 0.0;
-   m_dValueMax = 0.0;
+   m_dValue       = 0.0;
+   m_dValueMax    = 0.0;
+   m_dSum         = 0.0;
+   PERF_ATOMIC_XCHG(&m_nAboveThreshold, 0);
+   for (unsigned int n = 0; n < PERF_HISTOGRAM_BUCKETS; n++)
+      PERF_ATOMIC_XCHG(&m_anBuckets[n], 0);
 }
 //------------------------------------------------------------------------------
 
@@ -112,3 +172,113 @@ double CPerformanceCounter::MaxValue()
    return m_dValueMax;
 }
 //------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+/// returns sum of all values since last reset
+//------------------------------------------------------------------------------
+double CPerformanceCounter::Sum()
+{
+   return m_dSum;
+}
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+/// returns number of values since last reset
+//------------------------------------------------------------------------------
+uint64_t CPerformanceCounter::Count()
+{
+   uint64_t nCount = 0;
+   for (unsigned int n = 0; n < PERF_HISTOGRAM_BUCKETS; n++)
+      nCount += (unsigned long)m_anBuckets[n];
+   return nCount;
+}
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+/// returns percentile (0 < dPercentile <= 1) of values since last reset in
+/// seconds. Returned value is the upper edge of the histogram bucket containing
+/// the percentile, but not more than the maximum value. Returns 0 if no values
+/// are available
+//------------------------------------------------------------------------------
+double CPerformanceCounter::Percentile(double dPercentile)
+{
+   // take a snapshot of the histogram: writer may continue meanwhile
+   unsigned long anBuckets[PERF_HISTOGRAM_BUCKETS];
+   uint64_t nCount = 0;
+   unsigned int n;
+   for (n = 0; n < PERF_HISTOGRAM_BUCKETS; n++)
+      {
+      anBuckets[n] = (unsigned long)m_anBuckets[n];
+      nCount += anBuckets[n];
+      }
+   if (!nCount)
+      return 0.0;
+   uint64_t nRank = (uint64_t)ceil(dPercentile * (double)nCount);
+   if (nRank < 1)
+      nRank = 1;
+   uint64_t nSum = 0;
+   for (n = 0; n < PERF_HISTOGRAM_BUCKETS - 1; n++)
+      {
+      nSum += anBuckets[n];
+      if (nSum >= nRank)
+         break;
+      }
+   double d = BucketUpperEdge(n);
+   if (d > m_dValueMax)
+      d = m_dValueMax;
+   return d;
+}
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+/// sets threshold in seconds: values above are counted (e.g. buffer deadline).
+/// A threshold of 0 disables counting
+//------------------------------------------------------------------------------
+void CPerformanceCounter::SetThreshold(double dThreshold)
+{
+   m_dThreshold = dThreshold;
+}
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+/// returns number of values above threshold since last reset
+//------------------------------------------------------------------------------
+uint64_t CPerformanceCounter::AboveThreshold()
+{
+   return (unsigned long)m_nAboveThreshold;
+}
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+/// returns histogram bucket index of a value in seconds: bucket 0 contains
+/// values below PERF_HISTOGRAM_RESOLUTION, then each octave is divided into
+/// PERF_HISTOGRAM_SUBBUCKETS buckets. Last bucket contains all larger values
+//------------------------------------------------------------------------------
+unsigned int CPerformanceCounter::BucketIndex(double dValue)
+{
+   double dScaled = dValue / PERF_HISTOGRAM_RESOLUTION;
+   if (!(dScaled >= 1.0))
+      return 0;
+   int nExponent;
+   // dScaled = dMantissa * 2^nExponent with 0.5 <= dMantissa < 1
+   double dMantissa = frexp(dScaled, &nExponent);
+   unsigned int nSub = (unsigned int)((2.0*dMantissa - 1.0) * PERF_HISTOGRAM_SUBBUCKETS);
+   unsigned int nIndex = 1 + (unsigned int)(nExponent - 1) * PERF_HISTOGRAM_SUBBUCKETS + nSub;
+   if (nIndex >= PERF_HISTOGRAM_BUCKETS)
+      nIndex = PERF_HISTOGRAM_BUCKETS - 1;
+   return nIndex;
+}
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+/// returns upper edge of a histogram bucket in seconds
+//------------------------------------------------------------------------------
+double CPerformanceCounter::BucketUpperEdge(unsigned int nBucket)
+{
+   if (!nBucket)
+      return PERF_HISTOGRAM_RESOLUTION;
+   unsigned int nOctave = (nBucket - 1) / PERF_HISTOGRAM_SUBBUCKETS;
+   unsigned int nSub    = (nBucket - 1) % PERF_HISTOGRAM_SUBBUCKETS;
+   return PERF_HISTOGRAM_RESOLUTION * ldexp(1.0 + (double)(nSub + 1) / PERF_HISTOGRAM_SUBBUCKETS, (int)nOctave);
+}
+//------------------------------------------------------------------------------
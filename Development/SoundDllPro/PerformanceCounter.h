@@ -2,7 +2,8 @@
 /// \file PerformanceCounter.cpp
 /// \author Berg
 /// \brief Implementation of class CPerformanceCounter (encapsulating calls
-/// to QueryPerformance??? commands)
+/// to QueryPerformance??? commands or clock_gettime respectively) with
+/// lock-free log-bucketed histogram of measured values
 ///
 /// Project SoundMexPro
 /// Module  SoundDllPro.dll
@@ -31,11 +32,29 @@
 #ifndef PerformanceCounterH
 #define PerformanceCounterH
 //------------------------------------------------------------------------------
+#ifdef _WIN32
 #include <windows.h>
+#endif
+#include <stdint.h>
 //------------------------------------------------------------------------------
 
+/// resolution of histogram (lower edge of first bucket) in seconds
+#define PERF_HISTOGRAM_RESOLUTION   1e-7
+/// number of buckets per octave of histogram
+#define PERF_HISTOGRAM_SUBBUCKETS   8
+/// total number of buckets of histogram: covers 100ns to ~200s with a
+/// relative bucket width of 1/PERF_HISTOGRAM_SUBBUCKETS
+#define PERF_HISTOGRAM_BUCKETS      256
+
 //------------------------------------------------------------------------------
-/// \class CPerformanceCounter. Encapsulates calls to QueryPerformance??? commands
+/// \class CPerformanceCounter. Encapsulates calls to QueryPerformance???
+/// commands (clock_gettime(CLOCK_MONOTONIC) on other platforms). Each value
+/// returned by Stop is stored in a log-bucketed histogram for retrieving
+/// percentiles. Histogram buckets are incremented with atomic operations and
+/// can be read and reset from other threads without locking while the counter
+/// is running.
+/// NOTE: Start and Stop of one instance must not be called from different
+/// threads concurrently
 //------------------------------------------------------------------------------
 class CPerformanceCounter
 {
@@ -47,14 +66,27 @@ class CPerformanceCounter
       double   DecayValue();
       double   Value();
       double   MaxValue();
+      double   Sum();
+      uint64_t Count();
+      double   Percentile(double dPercentile);
+      void     SetThreshold(double dThreshold);
+      uint64_t AboveThreshold();
+      static int64_t GetTicks();
+      static double  GetTicksPerSecond();
    private:
 	  bool           m_bValid;
 	  double         m_dFrequency;
-	  LARGE_INTEGER  m_liLast;
-	  LARGE_INTEGER  m_liThis;
+	  int64_t        m_nLast;
+	  int64_t        m_nThis;
       double         m_dDecayValue;
       double         m_dValue;
       double         m_dValueMax;
+      double         m_dSum;
+      double         m_dThreshold;
+      volatile long  m_nAboveThreshold;
+      volatile long  m_anBuckets[PERF_HISTOGRAM_BUCKETS];
+      static unsigned int  BucketIndex(double dValue);
+      static double        BucketUpperEdge(unsigned int nBucket);
 };
 //------------------------------------------------------------------------------
 #endif
@@ -0,0 +1,201 @@
+//------------------------------------------------------------------------------
+/// \file PlanarBuffer.cpp
+///
+/// \author Berg
+/// \brief Implementation of class CPlanarBuffer: multichannel float buffer with
+/// all channels stored in one aligned allocation
+///
+/// Project SoundMexPro
+/// Module  SoundDllPro.dll
+///
+/// ****************************************************************************
+/// Copyright 2023 Daniel Berg, Oldenburg, Germany
+/// ****************************************************************************
+///
+/// This file is part of SoundMexPro.
+///
+///    SoundMexPro is free software: you can redistribute it and/or modify
+///    it under the terms of the GNU General Public License as published by
+///    the Free Software Foundation, either version 3 of the License, or
+///    (at your option) any later version.
+///
+///    SoundMexPro is distributed in the hope that it will be useful,
+///    but WITHOUT ANY WARRANTY; without even the implied warranty of
+///    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+///    GNU General Public License for more details.
+///
+///    You should have received a copy of the GNU General Public License
+///    along with SoundMexPro.  If not, see <http:///www.gnu.org/licenses/>.
+///
+//------------------------------------------------------------------------------
+#pragma hdrstop
+#include <string.h>
+#include <stdint.h>
+#include "PlanarBuffer.h"
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+/// constructor. Buffer is empty until SetSize is called
+//------------------------------------------------------------------------------
+CPlanarBuffer::CPlanarBuffer()
+   :  m_pfAllocated(NULL),
+      m_pfData(NULL),
+      m_nChannels(0),
+      m_nFrames(0),
+      m_nStride(0)
+{
+}
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+/// destructor. Frees memory
+//------------------------------------------------------------------------------
+CPlanarBuffer::~CPlanarBuffer()
+{
+   Free();
+}
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+/// frees memory and resets sizes
+//------------------------------------------------------------------------------
+void CPlanarBuffer::Free()
+{
+   delete [] m_pfAllocated;
+   m_pfAllocated  = NULL;
+   m_pfData       = NULL;
+   m_nChannels    = 0;
+   m_nFrames      = 0;
+   m_nStride      = 0;
+   m_vpfChannels.clear();
+}
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+/// returns channel stride in floats used for nFrames frames: nFrames rounded up
+/// to a multiple of PLANARBUFFER_SIMD_FLOATS
+//------------------------------------------------------------------------------
+unsigned int CPlanarBuffer::GetStrideForFrames(unsigned int nFrames)
+{
+   return (unsigned int)(((nFrames + PLANARBUFFER_SIMD_FLOATS - 1) / PLANARBUFFER_SIMD_FLOATS)
+                           * PLANARBUFFER_SIMD_FLOATS);
+}
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+/// (re)allocates one aligned block for all channels and fills it with zeroes.
+/// Existing data are discarded
+//------------------------------------------------------------------------------
+void CPlanarBuffer::SetSize(unsigned int nChannels, unsigned int nFrames)
+{
+   Free();
+   if (!nChannels || !nFrames)
+      return;
+   unsigned int nStride = GetStrideForFrames(nFrames);
+   size_t nFloats = (size_t)nChannels * nStride;
+   // over-allocate by one alignment unit to align start manually (no aligned
+   // new with all supported compilers)
+   m_pfAllocated  = new float[nFloats + PLANARBUFFER_SIMD_FLOATS];
+   uintptr_t p    = (uintptr_t)m_pfAllocated;
+   p              = (p + PLANARBUFFER_ALIGNMENT - 1) & ~(uintptr_t)(PLANARBUFFER_ALIGNMENT - 1);
+   m_pfData       = (float*)p;
+   m_nChannels    = nChannels;
+   m_nFrames      = nFrames;
+   m_nStride      = nStride;
+   m_vpfChannels.resize(nChannels);
+   for (unsigned int n = 0; n < nChannels; n++)
+      m_vpfChannels[n] = m_pfData + (size_t)n * nStride;
+   memset(m_pfData, 0, nFloats * sizeof(float));
+}
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+/// sets all channels to zero
+//------------------------------------------------------------------------------
+void CPlanarBuffer::Clear()
+{
+   if (m_pfData)
+      memset(m_pfData, 0, (size_t)m_nChannels * m_nStride * sizeof(float));
+}
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+/// sets one channel to zero
+//------------------------------------------------------------------------------
+void CPlanarBuffer::Clear(unsigned int nChannel)
+{
+   memset(m_vpfChannels[nChannel], 0, m_nFrames * sizeof(float));
+}
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+/// copies a valarray to a channel. Missing frames are set to zero, additional
+/// frames are ignored
+//------------------------------------------------------------------------------
+void CPlanarBuffer::CopyFrom(unsigned int nChannel, const std::valarray<float>& vf)
+{
+   unsigned int nCopy = (unsigned int)vf.size();
+   if (nCopy > m_nFrames)
+      nCopy = m_nFrames;
+   float* pf = m_vpfChannels[nChannel];
+   if (nCopy)
+      memcpy(pf, &vf[0], nCopy * sizeof(float));
+   if (nCopy < m_nFrames)
+      memset(pf + nCopy, 0, (m_nFrames - nCopy) * sizeof(float));
+}
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+/// returns number of channels
+//------------------------------------------------------------------------------
+unsigned int CPlanarBuffer::GetNumChannels() const
+{
+   return m_nChannels;
+}
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+/// returns number of frames per channel
+//------------------------------------------------------------------------------
+unsigned int CPlanarBuffer::GetNumFrames() const
+{
+   return m_nFrames;
+}
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+/// returns distance of channels in floats
+//------------------------------------------------------------------------------
+unsigned int CPlanarBuffer::GetStride() const
+{
+   return m_nStride;
+}
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+/// returns aligned pointer to one channel
+//------------------------------------------------------------------------------
+float* CPlanarBuffer::GetChannel(unsigned int nChannel)
+{
+   return m_vpfChannels[nChannel];
+}
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+/// returns aligned pointer to one channel (const version)
+//------------------------------------------------------------------------------
+const float* CPlanarBuffer::GetChannel(unsigned int nChannel) const
+{
+   return m_vpfChannels[nChannel];
+}
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+/// returns array of channel pointers (VST calling convention) or NULL if
+/// buffer is empty
+//------------------------------------------------------------------------------
+float** CPlanarBuffer::GetChannels()
+{
+   return m_vpfChannels.empty() ? NULL : &m_vpfChannels[0];
+}
+//------------------------------------------------------------------------------
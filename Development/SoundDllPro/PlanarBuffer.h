@@ -0,0 +1,83 @@
+//------------------------------------------------------------------------------
+/// \file PlanarBuffer.h
+///
+/// \author Berg
+/// \brief Interface of class CPlanarBuffer: multichannel float buffer with all
+/// channels stored in one aligned allocation
+///
+/// Project SoundMexPro
+/// Module  SoundDllPro.dll
+///
+/// ****************************************************************************
+/// Copyright 2023 Daniel Berg, Oldenburg, Germany
+/// ****************************************************************************
+///
+/// This file is part of SoundMexPro.
+///
+///    SoundMexPro is free software: you can redistribute it and/or modify
+///    it under the terms of the GNU General Public License as published by
+///    the Free Software Foundation, either version 3 of the License, or
+///    (at your option) any later version.
+///
+///    SoundMexPro is distributed in the hope that it will be useful,
+///    but WITHOUT ANY WARRANTY; without even the implied warranty of
+///    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+///    GNU General Public License for more details.
+///
+///    You should have received a copy of the GNU General Public License
+///    along with SoundMexPro.  If not, see <http:///www.gnu.org/licenses/>.
+///
+//------------------------------------------------------------------------------
+#ifndef PlanarBufferH
+#define PlanarBufferH
+//------------------------------------------------------------------------------
+#include <vector>
+#include <valarray>
+
+//------------------------------------------------------------------------------
+/// alignment of buffer start and of each channel in bytes (cache line size,
+/// sufficient for all SSE/AVX/AVX-512 loads)
+#define PLANARBUFFER_ALIGNMENT   64
+/// channel stride granularity in floats: one full alignment unit
+#define PLANARBUFFER_SIMD_FLOATS (PLANARBUFFER_ALIGNMENT / sizeof(float))
+//------------------------------------------------------------------------------
+
+   //------------------------------------------------------------------------------
+   /// \class CPlanarBuffer, prefix pb. Planar multichannel float buffer. All
+   /// channels are stored in one allocation aligned to PLANARBUFFER_ALIGNMENT,
+   /// the channel stride is padded to a multiple of PLANARBUFFER_SIMD_FLOATS, so
+   /// every channel starts aligned as well. GetChannels returns a float** view
+   /// as expected by VST process functions.
+   /// NOTE: intended for stack and class member use, not copyable
+   //------------------------------------------------------------------------------
+   class CPlanarBuffer
+   {
+      friend class UNIT_TEST_CLASS;
+      public:
+         CPlanarBuffer();
+         ~CPlanarBuffer();
+         void                 SetSize(unsigned int nChannels, unsigned int nFrames);
+         void                 Clear();
+         void                 Clear(unsigned int nChannel);
+         void                 CopyFrom(unsigned int nChannel, const std::valarray<float>& vf);
+         unsigned int         GetNumChannels() const;
+         unsigned int         GetNumFrames() const;
+         unsigned int         GetStride() const;
+         float*               GetChannel(unsigned int nChannel);
+         const float*         GetChannel(unsigned int nChannel) const;
+         float**              GetChannels();
+         static unsigned int  GetStrideForFrames(unsigned int nFrames);
+      private:
+         float*               m_pfAllocated;    ///< allocated (unaligned) memory
+         float*               m_pfData;         ///< aligned start of channel 0
+         unsigned int         m_nChannels;      ///< number of channels
+         unsigned int         m_nFrames;        ///< number of valid frames per channel
+         unsigned int         m_nStride;        ///< distance of channels in floats
+         std::vector<float*>  m_vpfChannels;    ///< channel pointers (float** view)
+         void                 Free();
+         CPlanarBuffer(const CPlanarBuffer&);
+         CPlanarBuffer& operator=(const CPlanarBuffer&);
+   };
+
+//------------------------------------------------------------------------------
+#endif
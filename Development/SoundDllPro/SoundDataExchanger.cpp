@@ -34,6 +34,7 @@
 #include <algorithm>
 #include "casio.h"
 #include "casioExceptions.h"
+#include "SoundDllPro_Trace.h"
 
 #pragma clang diagnostic push
 #pragma clang diagnostic ignored "-Wheader-hygiene"
@@ -46,12 +47,17 @@ void SoundDataExchanger::InitProcQueues(unsigned  nProcQueueBuffers,
                                         unsigned  nPlaybackChannels,
                                         unsigned  nFrames)
 {
-    m_psdqProcCapture = new SoundDataQueue(nCaptureChannels,
-                                           nFrames,
+    (void)nCaptureChannels;
+    (void)nPlaybackChannels;
+    (void)nFrames;
+    // capture blocks are completely overwritten by the bufferSwitch,
+    // playback blocks are cleared for the processing
+    m_psdqProcCapture = new SoundDataQueue(m_psdpCapture,
+                                           false,
                                            nProcQueueBuffers);
     ++sm_nObjects;
-    m_psdqProcPlayback = new SoundDataQueue(nPlaybackChannels,
-                                            nFrames,
+    m_psdqProcPlayback = new SoundDataQueue(m_psdpPlayback,
+                                            true,
                                             nProcQueueBuffers);
     ++sm_nObjects;
 }
@@ -62,13 +68,19 @@ void SoundDataExchanger::InitDoneQueues(unsigned  nDoneQueueBuffers,
                                         unsigned  nPlaybackChannels,
                                         unsigned  nFrames)
 {
-    m_psdqDoneCapture = new SoundDataQueue(nCaptureChannels,
-                                           nFrames,
-                                           nDoneQueueBuffers);
+    (void)nCaptureChannels;
+    (void)nPlaybackChannels;
+    (void)nFrames;
+    // the "done" thread is not time critical: it blocks without spinning
+    m_psdqDoneCapture = new SoundDataQueue(m_psdpCapture,
+                                           false,
+                                           nDoneQueueBuffers,
+                                           0);
     ++sm_nObjects;
-    m_psdqDonePlayback = new SoundDataQueue(nPlaybackChannels,
-                                            nFrames,
-                                            nDoneQueueBuffers);
+    m_psdqDonePlayback = new SoundDataQueue(m_psdpPlayback,
+                                            true,
+                                            nDoneQueueBuffers,
+                                            0);
     ++sm_nObjects;
 }
 
@@ -78,6 +90,10 @@ void SoundDataExchanger::InitTmpBuffers(unsigned nCaptureChannels,
 {
     m_sdCapture.Reinitialize(nCaptureChannels, nFrames);
     m_sdPlayback.Reinitialize(nPlaybackChannels, nFrames);
+    m_sdSilence.Reinitialize(nPlaybackChannels, nFrames);
+    m_sdProcCapture.Reinitialize(nCaptureChannels, nFrames);
+    m_sdDoneCapture.Reinitialize(nCaptureChannels, nFrames);
+    m_sdDonePlayback.Reinitialize(nPlaybackChannels, nFrames);
 }
 
 SoundDataExchanger::SoundDataExchanger(unsigned nProcQueueBuffers,
@@ -90,6 +106,8 @@ SoundDataExchanger::SoundDataExchanger(unsigned nProcQueueBuffers,
       m_psdqDoneCapture(0),
       m_psdqDonePlayback(0),
       m_bRealtimeProcessing(nProcQueueBuffers == 0U),
+      m_psdpCapture(0),
+      m_psdpPlayback(0),
       m_pcaInst(CASIO_CLASS_NAME::Instance()),
       m_bProcXrun(false),
       m_bDoneXrun(false),
@@ -102,6 +120,12 @@ SoundDataExchanger::SoundDataExchanger(unsigned nProcQueueBuffers,
       m_bCalledHandleCapturePrivate(false),
       m_nExceptionalDoneQueueClearCount(0)
 {
+    // Each block in use is referenced by at least one queue slot, one more
+    // block is acquired by the writer before it is pushed.
+    unsigned nPoolBlocks = (m_bRealtimeProcessing ? 1U : nProcQueueBuffers)
+        + nDoneQueueBuffers + 2U;
+    m_psdpCapture = new SoundDataPool(nCaptureChannels, nFrames, nPoolBlocks);
+    m_psdpPlayback = new SoundDataPool(nPlaybackChannels, nFrames, nPoolBlocks);
     // if realtime processing, then the ProcQueue is only used for
     // synchronization.
     InitProcQueues((m_bRealtimeProcessing ? 1U : nProcQueueBuffers),
@@ -145,6 +169,11 @@ SoundDataExchanger::~SoundDataExchanger()
         m_psdqDonePlayback = 0;
         --sm_nObjects;
     }
+    // pools are deleted after the queues referencing their blocks
+    delete m_psdpCapture;
+    m_psdpCapture = 0;
+    delete m_psdpPlayback;
+    m_psdpPlayback = 0;
     m_pcaInst = 0;
 }
 
@@ -161,7 +190,17 @@ void SoundDataExchanger::StaticBufferSwitch(long nDoubleBufferIndex,
         SoundDataExchanger * psxInst = pcaInst->GetSoundDataExchanger();
         if (psxInst)
         {
+            if (pcaInst->m_ppcCallback)
+            {
+                pcaInst->m_ppcCallback->Start();
+            }
+            SDPTrace::Begin("bufferswitch");
             psxInst->OnBufferSwitch(nDoubleBufferIndex);
+            SDPTrace::End("bufferswitch");
+            if (pcaInst->m_ppcCallback)
+            {
+                pcaInst->m_ppcCallback->Stop();
+            }
         }
     }
 }
@@ -197,9 +236,14 @@ void SoundDataExchanger::GetCaptureQueueBuffers(SoundData * rgpsdBuffers[2])
         sm_rgpsdGetCaptureQueueBuffersLastBuffers[0] = rgpsdBuffers[0] =
             m_psdqProcCapture->GetWritePtr();
     }
-    if(m_psdqDoneCapture != 0 && m_bDoneXrun == false){
+    // The "done" queue references the block of the processing queue. If
+    // processed data are passed to the "done" queue, the processing thread
+    // pushes them (see CaptureDataProcToDone)
+    if(m_psdqDoneCapture != 0 && m_bDoneXrun == false
+       && m_bCaptureDoneProcessed == false){
         sm_rgpsdGetCaptureQueueBuffersLastBuffers[1] = rgpsdBuffers[1] =
-            m_psdqDoneCapture->GetWritePtr();
+            (rgpsdBuffers[0] != 0 ? rgpsdBuffers[0]
+                                  : m_psdqDoneCapture->GetWritePtr());
     }
 }
 
@@ -212,31 +256,41 @@ void SoundDataExchanger::RetrieveCaptureData(long  nDoubleBufferIndex,
     sm_rgpsdRetrieveCaptureDataLastBuffers[0] = rgpsdBuffers[0];
     sm_rgpsdRetrieveCaptureDataLastBuffers[1] = rgpsdBuffers[1];
 
-    // retrieve data from sound card and write it to both receivers
-    m_pcaInst->ConvertInputsToFloat(nDoubleBufferIndex, m_sdCapture.m_vvfData);
-    m_sdCapture.m_bIsLast = false;
-    unsigned nIdx;
-    for (nIdx = 0; nIdx < 2U; ++nIdx)
+    // retrieve data from sound card directly into the queue block(s)
+    SoundData * psdTarget = &m_sdCapture;
+    if (rgpsdBuffers[0] != 0)
     {
-        if (rgpsdBuffers[nIdx] != 0)
-        {
-            rgpsdBuffers[nIdx]->CopyFrom(m_sdCapture);
-        }
+        psdTarget = rgpsdBuffers[0];
+    }
+    else if (rgpsdBuffers[1] != 0)
+    {
+        psdTarget = rgpsdBuffers[1];
     }
+    m_pcaInst->ConvertInputsToFloat(nDoubleBufferIndex, psdTarget->m_vvfData);
+    psdTarget->m_bIsLast = false;
 }
 
 
-void SoundDataExchanger::PushCaptureQueues()
+void SoundDataExchanger::PushCaptureQueues(SoundData * rgpsdBuffers[2])
 {
     m_bCalledPushCaptureQueues = true;
-    if(m_bProcXrun == false){
+    // "done" queue first: the block has to be shared before the processing
+    // thread can see it
+    if (rgpsdBuffers[1] != 0)
+    {
+        if (rgpsdBuffers[1] == rgpsdBuffers[0])
+        {
+            m_psdqDoneCapture->PushRef(rgpsdBuffers[1]);
+        }
+        else
+        {
+            m_psdqDoneCapture->Push();
+        }
+    }
+    if (rgpsdBuffers[0] != 0)
+    {
         m_psdqProcCapture->Push();
     }
-   if (!m_bCaptureDoneProcessed) {
-      if (m_psdqDoneCapture != 0 && m_bDoneXrun == false) {
-         m_psdqDoneCapture->Push();
-      }
-   }
 }
 
 bool SoundDataExchanger::CheckCaptureXrun(SoundDataQueue * psdqCapture)
@@ -259,7 +313,7 @@ void SoundDataExchanger::HandleCaptureData(long nDoubleBufferIndex)
     SoundData * rgpsdBuffers[2] = {0,0};
     GetCaptureQueueBuffers(rgpsdBuffers);
     RetrieveCaptureData(nDoubleBufferIndex, rgpsdBuffers);
-    PushCaptureQueues();
+    PushCaptureQueues(rgpsdBuffers);
 }
 
 
@@ -275,10 +329,11 @@ void SoundDataExchanger::GetPlaybackQueueBuffers(SoundData * rgpsdBuffers[2])
             rgpsdBuffers[0] =
             m_psdqProcPlayback->GetReadPtr();
     }
-    if(m_psdqDonePlayback != 0 && m_bDoneXrun == false){
+    if(m_psdqDonePlayback != 0 && m_bDoneXrun == false
+       && m_psdqDonePlayback->NumEmptyBuffers() > 0U){
         sm_rgpsdGetPlaybackQueueBuffersLastBuffers[1] =
             rgpsdBuffers[1] =
-            m_psdqDonePlayback->GetWritePtr();
+            (rgpsdBuffers[0] != 0 ? rgpsdBuffers[0] : &m_sdSilence);
     }
     m_bCalledGetPlaybackQueueBuffers = true;
 }
@@ -292,31 +347,30 @@ void SoundDataExchanger::CopyPlaybackData(long  nDoubleBufferIndex,
     sm_rgpsdCopyPlaybackDataLastBuffers[1] = rgpsdBuffers[1];
 
 
-    if (rgpsdBuffers[0] != 0)
-    {
-        m_sdPlayback.CopyFrom(*rgpsdBuffers[0]);
-    }
-    else
+    // The block read from the processing queue is not referenced by anyone
+    // else yet: play it in place
+    SoundData * psdPlayback = rgpsdBuffers[0];
+    if (psdPlayback == 0)
     {   // there was an xrun, data is missing
         m_sdPlayback.Clear();
+        psdPlayback = &m_sdPlayback;
     }
-    m_pcaInst->OnBufferPlay(m_sdPlayback);
-    if(rgpsdBuffers[1] != 0)
-    {
-        rgpsdBuffers[1]->CopyFrom(m_sdPlayback);
-    }
+    m_pcaInst->OnBufferPlay(*psdPlayback);
     m_pcaInst->ConvertFloatToOutputs(nDoubleBufferIndex,
-                                     m_sdPlayback.m_vvfData);
+                                     psdPlayback->m_vvfData);
+    m_sdPlayback.m_bIsLast = psdPlayback->m_bIsLast;
 }
 
-void SoundDataExchanger::ReleasePlaybackQueues()
+void SoundDataExchanger::ReleasePlaybackQueues(SoundData * rgpsdBuffers[2])
 {
+    // "done" queue first: the block must not be released to the pool in
+    // between
+    if(rgpsdBuffers[1] != 0){
+        m_psdqDonePlayback->PushRef(rgpsdBuffers[1]);
+    }
     if(m_bProcXrun == false){
         m_psdqProcPlayback->Pop();
     }
-    if(m_psdqDonePlayback != 0 && m_bDoneXrun == false){
-        m_psdqDonePlayback->Push();
-    }
 }
 
 bool SoundDataExchanger::CheckPlaybackLastFlagAndStop()
@@ -340,7 +394,7 @@ void SoundDataExchanger::HandlePlaybackData(long nDoubleBufferIndex)
     SoundData * rgpsdBuffers[2] = {0,0};
     GetPlaybackQueueBuffers(rgpsdBuffers);
     CopyPlaybackData(nDoubleBufferIndex, rgpsdBuffers);
-    ReleasePlaybackQueues();
+    ReleasePlaybackQueues(rgpsdBuffers);
     CheckPlaybackLastFlagAndStop();
 }
 
@@ -362,33 +416,45 @@ bool SoundDataExchanger::HasDoneQueue()
 void SoundDataExchanger::GetProcBuffers(SoundData ** ppsdCapture,
                                             SoundData ** ppsdPlayback)
 {
+    SDPTraceScope sdpts("procget");
     m_psdqProcCapture->WaitForData();
     *ppsdCapture = m_psdqProcCapture->GetReadPtr();
+    // processing may modify capture data, that the "done" thread must
+    // receive unprocessed
+    if (m_psdqProcCapture->IsReadPtrShared())
+    {
+        m_sdProcCapture.CopyFrom(**ppsdCapture);
+        *ppsdCapture = &m_sdProcCapture;
+    }
     m_psdqProcPlayback->WaitForSpace();
     *ppsdPlayback = m_psdqProcPlayback->GetWritePtr();
 }
 
 void SoundDataExchanger::CaptureDataProcToDone()
 {
-   SoundData * rgpsdBuffers[2] = {0, 0};
-   GetCaptureQueueBuffers(rgpsdBuffers);
-   SoundData * psdCapture = 0;
-   SoundData * psdPlayback = 0;
-   GetProcBuffers(&psdCapture, &psdPlayback);
-   rgpsdBuffers[1]->CopyFrom(*psdCapture);
+    if (m_psdqDoneCapture == 0)
+    {
+        return;
+    }
+    // overruns of the "done" queue are reported by the bufferSwitch
+    if (m_psdqDoneCapture->NumEmptyBuffers() == 0U)
+    {
+        return;
+    }
+    // the block was processed in place: it is not shared in this mode
+    m_psdqDoneCapture->PushRef(m_psdqProcCapture->GetReadPtr());
 }
 
 
-void SoundDataExchanger::ProcPut() 
+void SoundDataExchanger::ProcPut()
 {
-   if (m_bCaptureDoneProcessed) {
-      CaptureDataProcToDone();
-      if (m_psdqDoneCapture != 0 && m_bDoneXrun == false) {
-         m_psdqDoneCapture->Push();
-      }
-   }
-   m_psdqProcCapture->Pop();
-   m_psdqProcPlayback->Push();
+    SDPTraceScope sdpts("procput");
+    if (m_bCaptureDoneProcessed)
+    {
+        CaptureDataProcToDone();
+    }
+    m_psdqProcCapture->Pop();
+    m_psdqProcPlayback->Push();
 }
 
 unsigned SoundDataExchanger::ProcPlaybackNumEmptyBuffers() const
@@ -406,6 +472,13 @@ unsigned SoundDataExchanger::ProcNumClientBuffers() const
                     ProcCaptureNumFilledBuffers());
 }
 
+unsigned SoundDataExchanger::SpinForProcClientBuffers()
+{
+    if (m_psdqProcCapture->SpinForData() && m_psdqProcPlayback->SpinForSpace())
+        return ProcNumClientBuffers();
+    return 0;
+}
+
 unsigned SoundDataExchanger::DoneNumFilledBuffers() const
 {
     if (m_psdqDonePlayback && m_psdqDoneCapture)
@@ -423,14 +496,29 @@ void SoundDataExchanger::Prefill(const SoundData & sdPlayback)
 void SoundDataExchanger::GetDoneBuffers(
         SoundData ** ppsdCapture, SoundData ** ppsdPlayback)
 {
+    SDPTraceScope sdpts("doneget");
     m_psdqDonePlayback->WaitForData();
     m_psdqDoneCapture->WaitForData();
     *ppsdCapture = m_psdqDoneCapture->GetReadPtr();
     *ppsdPlayback = m_psdqDonePlayback->GetReadPtr();
+    // The "done" callback may modify the data: blocks still used by the
+    // processing thread are copied. Usually the processing thread released
+    // them already.
+    if (m_psdqDoneCapture->IsReadPtrShared())
+    {
+        m_sdDoneCapture.CopyFrom(**ppsdCapture);
+        *ppsdCapture = &m_sdDoneCapture;
+    }
+    if (m_psdqDonePlayback->IsReadPtrShared())
+    {
+        m_sdDonePlayback.CopyFrom(**ppsdPlayback);
+        *ppsdPlayback = &m_sdDonePlayback;
+    }
 }
 
 void SoundDataExchanger::PopDoneBuffers()
 {
+    SDPTraceScope sdpts("donepop");
     m_psdqDoneCapture->Pop();
     m_psdqDonePlayback->Pop();
 }
@@ -457,6 +545,7 @@ HANDLE SoundDataExchanger::GetProcPlaybackSpaceEvent() const
 
 void SoundDataExchanger::DonePop()
 {
+    SDPTraceScope sdpts("donepop");
     m_psdqDoneCapture->Pop();
     m_psdqDonePlayback->Pop();
 }
@@ -59,6 +59,13 @@ namespace Asio
     /// The SoundDataExchanger class implements the sound data buffering,
     /// since native Asio is otherwise an unbuffered realtime sound I/O API.
     /// Instances are created and deleted by CAsio.
+    /// Capture and playback blocks are taken from two SoundDataPool
+    /// instances. The processing and "done" queues transport references to
+    /// these blocks, so the bufferSwitch converts capture data directly into
+    /// the pooled block and plays the pooled playback block without any
+    /// copies. A thread that may modify a block (processing and "done"
+    /// callbacks modify capture data in place) works on a private copy only
+    /// if the block is still referenced by the other queue.
     /// Possible class prefixes are sde or sdx.
     class SoundDataExchanger
     {
@@ -97,7 +104,9 @@ namespace Asio
         /// Get pointers to the current client sound data buffers in the
         /// processing queues: The next readable buffer in the capture
         /// queue, and the next writable buffer in the playback queue.
-        /// Waits for data/space if necessary.
+        /// Waits for data/space if necessary. If the capture block is still
+        /// referenced by the "done" capture queue, a private copy of it is
+        /// returned, that may be modified by the processing.
         /// \param[out] ppsdCapture
         ///  Assign address of the capture queue's next readable
         ///  Asio::SoundData to this pointer.
@@ -122,6 +131,14 @@ namespace Asio
         /// further soundcard interupts.
         unsigned ProcNumClientBuffers() const;
 
+        /// Spins for a short while until buffers are available for
+        /// processing, before the processing thread blocks in a wait for the
+        /// queue events. The number of spins adapts to the success of
+        /// spinning in previous calls.
+        /// \retval The number of buffers available for processing (0 if
+        /// none became available while spinning).
+        unsigned SpinForProcClientBuffers();
+
         ///  Returns the number of filled buffers in the "done" queues.
         /// \retval The minimum of the number of filled buffers in both
         /// "done" queues.
@@ -133,7 +150,9 @@ namespace Asio
 
         ///  Get pointers to the current sound data buffers that are
         /// readable next in the "done" queue. Waits for data if there is no
-        /// data available in both done queues yet.
+        /// data available in both done queues yet. Blocks still referenced
+        /// by the processing queues are copied to private buffers that may
+        /// be modified by the caller.
         /// \param[out] ppsdCapture
         ///  Assign address of the capture queue's current Asio::SoundData
         ///  to this pointer.
@@ -265,16 +284,37 @@ namespace Asio
         /// XRun in Visualization detected
         bool m_bDoneXrun;
 
-        /// Current capture data is stored here during bufferSwitch handling
+        /// Pool of capture blocks referenced by #m_psdqProcCapture and
+        /// #m_psdqDoneCapture. Blocks are acquired by the bufferSwitch.
+        SoundDataPool * m_psdpCapture;
+
+        /// Pool of playback blocks referenced by #m_psdqProcPlayback and
+        /// #m_psdqDonePlayback. Blocks are acquired by the processing thread.
+        SoundDataPool * m_psdpPlayback;
+
+        /// Capture data is converted to this buffer if no capture queue
+        /// can take it because of xruns.
         SoundData m_sdCapture;
 
-        /// Current playback data is stored here during bufferSwitch handling
-        /// This is temporary memory used during the CopyPlaybackData method,
-        /// but it is also used to store the state of the latest
+        /// Silence is played from here if the processing playback queue is in
+        /// xrun condition. Also used to store the state of the latest
         /// SoundData::m_bIsLast flag for the CheckPlaybackLastFlagAndStop
         /// method.
         SoundData m_sdPlayback;
 
+        /// Silence passed to the "done" playback queue if the processing
+        /// playback queue is in xrun condition. Never modified.
+        SoundData m_sdSilence;
+
+        /// Private copy of a shared capture block for the processing thread
+        SoundData m_sdProcCapture;
+
+        /// Private copy of a shared capture block for the "done" thread
+        SoundData m_sdDoneCapture;
+
+        /// Private copy of a shared playback block for the "done" thread
+        SoundData m_sdDonePlayback;
+
         /// Current index within double buffer set by \sa OnBufferSwitch
         long m_nCurrentDoubleBufferIndex;
 
@@ -329,7 +369,8 @@ namespace Asio
                             unsigned  nPlaybackChannels,
                             unsigned  nFrames);
         
-        /// Initialize the temporary buffers #m_sdCapture and #m_sdPlayback
+        /// Initialize the temporary buffers #m_sdCapture, #m_sdPlayback and
+        /// the private copies used by the processing and "done" threads.
         /// param[in] nCaptureChannels
         ///  The number of audio channels prepared for capture.
         /// param[in] nPlaybackChannels
@@ -373,13 +414,18 @@ namespace Asio
         /// \param rgpsdBuffers Addresses of next write buffers of capture
         ///        queues are stored here.
         ///        The address of the next buffer in the processing capture
-        ///        queue is stored at index 0. The address of the next buffer
-        ///        in the processing capture queue is stored at index 1.
-        ///        If one queue is not present or is currently in overrun
-        ///        condition, then NULL is stored in its place.
+        ///        queue is stored at index 0. The address of the buffer
+        ///        for the "done" capture queue is stored at index 1: this is
+        ///        the same block as at index 0 unless the processing capture
+        ///        queue is in overrun condition.
+        ///        If one queue is not present, is currently in overrun
+        ///        condition or (for the "done" queue) is filled by the
+        ///        processing thread (#m_bCaptureDoneProcessed), then NULL is
+        ///        stored in its place.
         void GetCaptureQueueBuffers(SoundData * rgpsdBuffers[2]);
 
-        /// Fills given buffers with sound data from the sound card.
+        /// Fills given buffers with sound data from the sound card. The data
+        /// are converted only once, if both addresses are identical.
         /// \param nDoubleBufferIndex
         ///    The current asio driver buffer index
         /// \param rgpsdBuffers
@@ -389,13 +435,19 @@ namespace Asio
         void RetrieveCaptureData(long  nDoubleBufferIndex,
                                  SoundData * rgpsdBuffers[2]);
 
-        /// Copies current proc capture data to current done capture data
+        /// Pushes a reference to the processed capture block of the
+        /// processing queue to the "done" capture queue. Called by the
+        /// processing thread if #m_bCaptureDoneProcessed is set.
         void CaptureDataProcToDone();
 
         /// Call Push on each capture queue that exists and is not
         /// currently in xrun condition (uses the #m_bProcXrun,
-        /// #m_bDoneXrun flags to determine the xrun condition)
-        void PushCaptureQueues();
+        /// #m_bDoneXrun flags to determine the xrun condition). The "done"
+        /// queue is pushed first, so the processing thread never sees a
+        /// block as unshared that the "done" thread will read.
+        /// \param rgpsdBuffers
+        ///    Buffers retrieved by #GetCaptureQueueBuffers.
+        void PushCaptureQueues(SoundData * rgpsdBuffers[2]);
 
         /// Handles the current playback data. Calls helper method to achieve
         /// that the playback data is retrieved from the processing playback
@@ -408,38 +460,43 @@ namespace Asio
 
         /// Helper method used by #HandlePlaybackData.
         /// Retrieves addresses from next read buffer of the processing
-        /// playback queue and of the next write buffer of the done playback
+        /// playback queue and of the buffer to pass to the done playback
         /// queue and stores them in the array given as parameter.
         /// \param rgpsdBuffers
         ///   Addresses of next buffers of playback queues are stored here.
         ///   At index 0, the address of the next read buffer of the
         ///   processing playback queue is stored.  At index 1, the address
-        ///   of next write buffer of the "done" playback queue is stored.
+        ///   of the block to be referenced by the "done" playback queue is
+        ///   stored: the block at index 0 or #m_sdSilence if the processing
+        ///   queue is in xrun condition.
         ///   If one of the queues is not present or is currently in xrun
         ///   condition, then 0 is stored in place of that address.
         void GetPlaybackQueueBuffers(SoundData * rgpsdBuffers[2]);
 
         /// Helper method used by #HandlePlaybackData.
-        /// Reads sound data from the processing playback queue,
-        /// calls the OnBufferPlay callback, copies the data to the "done"
-        /// queue, and in native format to the driver buffer.
-        /// An xrun that has been detected during #HandleCaptureData is
-        /// taken care of.
+        /// Calls the OnBufferPlay callback on the block read from the
+        /// processing playback queue (the bufferSwitch holds the only
+        /// reference to it) and writes it in native format to the driver
+        /// buffer. An xrun that has been detected during #HandleCaptureData
+        /// is taken care of by playing #m_sdPlayback cleared.
         /// \param nDoubleBufferIndex
         ///    The current asio driver buffer index
         /// \param rgpsdBuffers
         ///    Addresses of the next buffers in the Playback queues.
         ///    Index 0: Next read buffer in processing playback queue.
-        ///    Index 1: Next write buffer in "done" playback queue
+        ///    Index 1: Block to be passed to "done" playback queue
         void CopyPlaybackData(long  nDoubleBufferIndex,
                               SoundData * rgpsdBuffers[2]);
 
         /// Helper method used by #HandlePlaybackData.
-        /// Call SoundDataQueue::Pop on the processing playback queue and
-        /// SoundDataQueue::Push on the "done" playback queue if they exist and
-        /// the respective queue is not currently in xrun condition (uses the
-        /// #m_bProcXrun, #m_bDoneXrun flags to determine the xrun condition)
-        void ReleasePlaybackQueues();
+        /// Call SoundDataQueue::PushRef on the "done" playback queue and
+        /// SoundDataQueue::Pop on the processing playback queue if they exist
+        /// and the respective queue is not currently in xrun condition (uses
+        /// the #m_bProcXrun, #m_bDoneXrun flags to determine the xrun
+        /// condition)
+        /// \param rgpsdBuffers
+        ///    Buffers retrieved by #GetPlaybackQueueBuffers.
+        void ReleasePlaybackQueues(SoundData * rgpsdBuffers[2]);
 
         /// Checks whether the last playback buffer handled in the bufferswitch
         /// had its m_bIsLast flag set. If so, then CAsio::Stop() is called on
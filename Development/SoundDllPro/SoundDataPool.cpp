@@ -0,0 +1,142 @@
+//------------------------------------------------------------------------------
+/// \file SoundDataPool.cpp
+/// \author Berg
+/// \brief Implementation of class SoundDataPool
+///
+/// Project SoundMexPro
+/// Module SoundDllPro
+///
+/// Implementation of class SoundDataPool. Implements a pool of reference
+/// counted SoundData blocks that are shared by multiple SoundDataQueue
+/// instances
+/// \sa SoundDataQueue.cpp
+///
+/// ****************************************************************************
+/// Copyright 2023 Daniel Berg, Oldenburg, Germany
+/// ****************************************************************************
+///
+/// This file is part of SoundMexPro.
+///
+///    SoundMexPro is free software: you can redistribute it and/or modify
+///    it under the terms of the GNU General Public License as published by
+///    the Free Software Foundation, either version 3 of the License, or
+///    (at your option) any later version.
+///
+///    SoundMexPro is distributed in the hope that it will be useful,
+///    but WITHOUT ANY WARRANTY; without even the implied warranty of
+///    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+///    GNU General Public License for more details.
+///
+///    You should have received a copy of the GNU General Public License
+///    along with SoundMexPro.  If not, see <http:///www.gnu.org/licenses/>.
+///
+//------------------------------------------------------------------------------
+#include "SoundDataPool.h"
+#include "casioExceptions.h"
+
+namespace Asio
+{
+    SoundDataPool::SoundDataPool(unsigned nChannels,
+                                 unsigned nFrames,
+                                 unsigned nBlocks)
+        : m_nBlocks(nBlocks),
+          m_rgsdBlocks(0),
+          m_rgnRefCounts(0),
+          m_nNext(0)
+    {
+        if (nBlocks == 0)
+            throw EUnsupportedParamsError("SoundDataPool::SoundDataPool",
+                                          "Cannot create pool with 0 blocks.");
+        m_rgsdBlocks = SoundData::CreateArray(nBlocks, nChannels, nFrames);
+        m_rgnRefCounts = new SpscAtomic[nBlocks];
+    }
+
+    SoundDataPool::~SoundDataPool()
+    {
+        // secure clearing (try..catch around each action)
+        try
+        {
+            SoundData::DestroyArray(m_rgsdBlocks);
+        }
+        catch (...)
+        {
+        }
+        delete [] m_rgnRefCounts;
+        m_rgsdBlocks = 0;
+        m_rgnRefCounts = 0;
+    }
+
+    size_t SoundDataPool::Index(const SoundData * psdBlock) const
+    {
+        if (psdBlock < m_rgsdBlocks || psdBlock >= m_rgsdBlocks + m_nBlocks)
+            return m_nBlocks;
+        return (size_t)(psdBlock - m_rgsdBlocks);
+    }
+
+    SoundData * SoundDataPool::Acquire(bool bClear)
+    {
+        // blocks are usually released in the order they were acquired, so
+        // the block following the one acquired last is free in most cases
+        size_t nCount;
+        for (nCount = 0; nCount < m_nBlocks; ++nCount)
+        {
+            size_t nIndex = m_nNext;
+            m_nNext = (m_nNext + 1 == m_nBlocks) ? 0 : m_nNext + 1;
+            // only this thread increments a count from 0, so a free block
+            // cannot be taken by someone else meanwhile
+            if (m_rgnRefCounts[nIndex].LoadAcquire() == 0)
+            {
+                m_rgnRefCounts[nIndex].StoreRelease(1);
+                SoundData * psdBlock = m_rgsdBlocks + nIndex;
+                if (bClear)
+                    psdBlock->Clear();
+                psdBlock->m_bIsLast = false;
+                return psdBlock;
+            }
+        }
+        throw EXrunError("SoundDataPool::Acquire", false); // overrun
+    }
+
+    void SoundDataPool::AddRef(SoundData * psdBlock)
+    {
+        size_t nIndex = Index(psdBlock);
+        if (nIndex < m_nBlocks)
+            m_rgnRefCounts[nIndex].Increment();
+    }
+
+    void SoundDataPool::Release(SoundData * psdBlock)
+    {
+        size_t nIndex = Index(psdBlock);
+        if (nIndex < m_nBlocks)
+            m_rgnRefCounts[nIndex].Decrement();
+    }
+
+    bool SoundDataPool::IsShared(const SoundData * psdBlock) const
+    {
+        size_t nIndex = Index(psdBlock);
+        if (nIndex == m_nBlocks)
+            return true;
+        // counts only decrease while the caller holds a reference: if the
+        // caller's reference is the only one, it stays the only one
+        return m_rgnRefCounts[nIndex].LoadAcquire() > 1;
+    }
+
+    unsigned SoundDataPool::NumUsedBlocks() const
+    {
+        unsigned nUsed = 0;
+        size_t nIndex;
+        for (nIndex = 0; nIndex < m_nBlocks; ++nIndex)
+        {
+            if (m_rgnRefCounts[nIndex].LoadAcquire() != 0)
+                ++nUsed;
+        }
+        return nUsed;
+    }
+} // namespace Asio
+
+// Local Variables:
+// mode: c++
+// c-file-style: "stroustrup"
+// c-basic-offset: 4
+// indent-tabs-mode: nil
+// End:
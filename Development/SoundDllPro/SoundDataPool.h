@@ -0,0 +1,128 @@
+//------------------------------------------------------------------------------
+/// \file SoundDataPool.h
+/// \author Berg
+/// \brief Interface of class SoundDataPool
+///
+/// Project SoundMexPro
+/// Module SoundDllPro
+///
+/// Interface of class SoundDataPool. Implements a pool of reference counted
+/// SoundData blocks that are shared by multiple SoundDataQueue instances
+/// \sa SoundDataQueue.h
+///
+/// ****************************************************************************
+/// Copyright 2023 Daniel Berg, Oldenburg, Germany
+/// ****************************************************************************
+///
+/// This file is part of SoundMexPro.
+///
+///    SoundMexPro is free software: you can redistribute it and/or modify
+///    it under the terms of the GNU General Public License as published by
+///    the Free Software Foundation, either version 3 of the License, or
+///    (at your option) any later version.
+///
+///    SoundMexPro is distributed in the hope that it will be useful,
+///    but WITHOUT ANY WARRANTY; without even the implied warranty of
+///    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+///    GNU General Public License for more details.
+///
+///    You should have received a copy of the GNU General Public License
+///    along with SoundMexPro.  If not, see <http:///www.gnu.org/licenses/>.
+///
+//------------------------------------------------------------------------------
+#ifndef SOUND_DATA_POOL_H
+#define SOUND_DATA_POOL_H
+
+#include "SoundData.h"
+#include "SpscRing.h"
+
+class UNIT_TEST_CLASS;
+
+namespace Asio
+{
+    /// A SoundDataPool holds a fixed number of SoundData blocks with a
+    /// reference count each. A block is acquired by exactly one thread, filled
+    /// and then passed by reference to one or more queues. Each queue releases
+    /// its reference when the block is popped, the block is free again when
+    /// the last reference is released. A thread holding the only reference
+    /// to a block may modify it, all other holders must treat it as immutable.
+    /// No locks are used: blocks are released with a sequentially consistent
+    /// decrement, the acquiring thread finds free blocks by an acquire load of
+    /// the reference counts.
+    ///
+    /// variable prefix: sdp for (S)ound(D)ata(P)ool
+    class SoundDataPool {
+        friend class UNIT_TEST_CLASS;
+
+        /// Number of blocks
+        const size_t m_nBlocks;
+
+        /// The blocks
+        SoundData * m_rgsdBlocks;
+
+        /// Reference count of each block, 0 for free blocks
+        SpscAtomic * m_rgnRefCounts;
+
+        /// Index of block to check first on next Acquire. Only accessed by
+        /// the acquiring thread.
+        size_t m_nNext;
+
+        /// Returns the index of a block of this pool or m_nBlocks if the
+        /// block does not belong to this pool.
+        size_t Index(const SoundData * psdBlock) const;
+
+    public:
+        /// Create a pool of SoundData blocks.
+        /// \param[in] nChannels
+        ///  The number of audio channels in each block
+        /// \param[in] nFrames
+        ///  The number of samples stored for each channel in a block.
+        /// \param[in] nBlocks
+        ///  Number of blocks in the pool, i.e. the maximum number of blocks
+        ///  referenced at the same time.
+        SoundDataPool(unsigned nChannels, unsigned nFrames, unsigned nBlocks);
+
+        /// Deallocate the pool
+        ~SoundDataPool();
+
+        /// Return a free block with a reference count of one. Must always be
+        /// called by the same thread.
+        /// \param[in] bClear
+        ///  If true the samples of the block are set to zero. The m_bIsLast
+        ///  flag is always cleared.
+        /// \exception EXrunError if no free block is available
+        SoundData * Acquire(bool bClear);
+
+        /// Add a reference to a block. Blocks not belonging to the pool are
+        /// ignored.
+        void AddRef(SoundData * psdBlock);
+
+        /// Release a reference to a block. Blocks not belonging to the pool
+        /// are ignored.
+        void Release(SoundData * psdBlock);
+
+        /// Returns true if the caller holding a reference to the block
+        /// must not modify it, because other references exist or the
+        /// block does not belong to the pool.
+        bool IsShared(const SoundData * psdBlock) const;
+
+        /// Returns the number of blocks currently referenced.
+        unsigned NumUsedBlocks() const;
+
+    private:
+        SoundDataPool(const SoundDataPool &);
+        SoundDataPool & operator=(const SoundDataPool &);
+    }; // class SoundDataPool
+
+} // namespace Asio
+
+#endif // #ifndef SOUND_DATA_POOL_H
+
+// next comment block describes code layout for emacs.
+
+// Local Variables:
+// mode: c++
+// c-file-style: "stroustrup"
+// c-basic-offset: 4
+// indent-tabs-mode: nil
+// End:
@@ -30,35 +30,69 @@
 ///    along with SoundMexPro.  If not, see <http:///www.gnu.org/licenses/>.
 ///
 //------------------------------------------------------------------------------
-#include <windows.h>
 #include <algorithm>
 #include "SoundDataQueue.h"
 #include "casioExceptions.h"
 
 namespace Asio
 {
+    /// Condition for SpscSignal::Wait: ring has a filled slot
+    class CanReadCondition {
+        SpscRing & m_srRing;
+    public:
+        explicit CanReadCondition(SpscRing & srRing) : m_srRing(srRing) {}
+        bool operator()() const { return m_srRing.CanRead(); }
+    };
+
+    /// Condition for SpscSignal::Wait: ring has an empty slot
+    class CanWriteCondition {
+        SpscRing & m_srRing;
+    public:
+        explicit CanWriteCondition(SpscRing & srRing) : m_srRing(srRing) {}
+        bool operator()() const { return m_srRing.CanWrite(); }
+    };
+
     SoundDataQueue::SoundDataQueue(unsigned nChannels,
                                    unsigned nFrames,
-                                   unsigned nBuffers)
-        : m_nBufCapacity(nBuffers)
+                                   unsigned nBuffers,
+                                   unsigned nMaxSpins)
+        : m_nBufCapacity(nBuffers),
+          m_rgsdBuffers(0),
+          m_psdpPool(0),
+          m_rgpsdSlots(0),
+          m_bClearAcquired(false),
+          m_srRing(nBuffers),
+          m_sigDataAvailable(false, nMaxSpins),
+          m_sigSpaceAvailable(true, nMaxSpins)
+    {
+        m_rgsdBuffers = SoundData::CreateArray(nBuffers, nChannels, nFrames);
+        m_rgpsdSlots = new SoundData*[nBuffers];
+        unsigned nSlot;
+        for (nSlot = 0; nSlot < nBuffers; ++nSlot)
+            m_rgpsdSlots[nSlot] = m_rgsdBuffers + nSlot;
+        m_bGetWritePointerCalled = false;
+    }
+
+    SoundDataQueue::SoundDataQueue(SoundDataPool * psdpPool,
+                                   bool bClear,
+                                   unsigned nBuffers,
+                                   unsigned nMaxSpins)
+        : m_nBufCapacity(nBuffers),
+          m_rgsdBuffers(0),
+          m_psdpPool(psdpPool),
+          m_rgpsdSlots(0),
+          m_bClearAcquired(bClear),
+          m_srRing(nBuffers),
+          m_sigDataAvailable(false, nMaxSpins),
+          m_sigSpaceAvailable(true, nMaxSpins)
     {
-        if (nBuffers == 0)
+        if (psdpPool == 0)
             throw EUnsupportedParamsError("SoundDataQueue::SoundDataQueue",
-                                          "Cannot create queue with capacity"
-                                          " for 0 buffers.");
-        m_hDataAvailable = m_hSpaceAvailable = NULL;
-        m_hDataAvailable = CreateEvent(NULL, FALSE, FALSE, NULL);
-        if (m_hDataAvailable == NULL)
-            throw EWin32Error("SoundDataQueue::SoundDataQueue",
-                              "CreateEvent failed",
-                              (int)GetLastError());
-        m_hSpaceAvailable = CreateEvent(NULL, FALSE, TRUE, NULL);
-        if (m_hSpaceAvailable == NULL)
-            throw EWin32Error("SoundDataQueue::SoundDataQueue",
-                              "CreateEvent failed",
-                              (int)GetLastError());
-        m_psdRead = m_psdWrite = m_rgsdBuffers =
-            SoundData::CreateArray(nBuffers+1, nChannels, nFrames);
+                                          "Pool must not be NULL.");
+        m_rgpsdSlots = new SoundData*[nBuffers];
+        unsigned nSlot;
+        for (nSlot = 0; nSlot < nBuffers; ++nSlot)
+            m_rgpsdSlots[nSlot] = 0;
         m_bGetWritePointerCalled = false;
     }
 
@@ -67,17 +101,14 @@ namespace Asio
         // secure clearing (try..catch around each action)
         try
         {
-            SoundData::DestroyArray(m_rgsdBuffers);
-        }
-        catch (...)
-        {
-        }
-        try
-        {
-            if (m_hDataAvailable)
+            if (m_psdpPool && m_rgpsdSlots)
             {
-                CloseHandle(m_hDataAvailable);
-                m_hDataAvailable = NULL;
+                size_t nSlot;
+                for (nSlot = 0; nSlot < m_nBufCapacity; ++nSlot)
+                {
+                    if (m_rgpsdSlots[nSlot])
+                        m_psdpPool->Release(m_rgpsdSlots[nSlot]);
+                }
             }
         }
         catch (...)
@@ -85,25 +116,19 @@ namespace Asio
         }
         try
         {
-            if (m_hSpaceAvailable)
-            {
-                CloseHandle(m_hSpaceAvailable);
-                m_hSpaceAvailable = NULL;
-            }
+            SoundData::DestroyArray(m_rgsdBuffers);
         }
         catch (...)
         {
         }
-        m_psdRead = m_psdWrite = m_rgsdBuffers = 0;
+        delete [] m_rgpsdSlots;
+        m_rgpsdSlots = 0;
+        m_rgsdBuffers = 0;
     }
 
     unsigned SoundDataQueue::NumFilledBuffers() const
     {
-        // The extra "+ max_fill_count + 1" might look unnecessary, but is
-        // required when the write pointer has already wrapped to the beginning
-        // of the buffer, while the read pointer has not.
-        return ( (unsigned int)(m_psdWrite + m_nBufCapacity + 1 - m_psdRead)
-                 % (m_nBufCapacity + 1) );
+        return m_srRing.NumFilled();
     }
 
     unsigned SoundDataQueue::NumEmptyBuffers() const
@@ -113,35 +138,56 @@ namespace Asio
 
     SoundData * SoundDataQueue::GetReadPtr() const
     {
-        if (NumFilledBuffers() == 0)
+        if (!m_srRing.CanRead())
         {
             bool bUnderrun = true;
             throw EXrunError("SoundDataQueue::GetReadPtr", bUnderrun);
         }
-        return m_psdRead;
+        return m_rgpsdSlots[m_srRing.ReadSlot()];
+    }
+
+    bool SoundDataQueue::IsReadPtrShared() const
+    {
+        if (m_psdpPool == 0)
+            return false;
+        return m_psdpPool->IsShared(GetReadPtr());
     }
 
     void SoundDataQueue::Pop()
     {
-        if (NumFilledBuffers() == 0)
+        if (!m_srRing.CanRead())
         {
             bool bUnderrun = true;
             throw EXrunError("SoundDataQueue::GetReadPtr", bUnderrun);
         }
-        m_psdRead->Clear();
-        m_psdRead =
-            (unsigned int)(m_psdRead+1 - m_rgsdBuffers) % (m_nBufCapacity+1) + m_rgsdBuffers;
-        SetEvent(m_hSpaceAvailable);
+        unsigned nSlot = m_srRing.ReadSlot();
+        if (m_psdpPool)
+        {
+            m_psdpPool->Release(m_rgpsdSlots[nSlot]);
+            m_rgpsdSlots[nSlot] = 0;
+        }
+        else
+        {
+            // clear before releasing the buffer to the writing thread
+            m_rgpsdSlots[nSlot]->Clear();
+        }
+        m_srRing.CommitRead();
+        m_sigSpaceAvailable.Notify();
     }
 
     SoundData * SoundDataQueue::GetWritePtr()
     {
-        if (NumEmptyBuffers() == 0)
+        if (!m_srRing.CanWrite())
         {
             throw EXrunError("SoundDataQueue::GetWritePtr", false); // overrun
         }
+        unsigned nSlot = m_srRing.WriteSlot();
+        // the slot is owned by the writer until it is pushed: a block
+        // acquired by a previous call without Push is reused
+        if (m_psdpPool && m_rgpsdSlots[nSlot] == 0)
+            m_rgpsdSlots[nSlot] = m_psdpPool->Acquire(m_bClearAcquired);
         m_bGetWritePointerCalled = true;
-        return m_psdWrite;
+        return m_rgpsdSlots[nSlot];
     }
     void SoundDataQueue::Push()
     {
@@ -154,36 +200,66 @@ namespace Asio
                                    " no data can be in the current buffer",
                                    this);
         }
-        m_psdWrite =
-            (unsigned int)(m_psdWrite+1 - m_rgsdBuffers) % (m_nBufCapacity+1) + m_rgsdBuffers;
+        m_srRing.CommitWrite();
         m_bGetWritePointerCalled = false; // reset
-        SetEvent(m_hDataAvailable);
+        m_sigDataAvailable.Notify();
     }
 
-    void SoundDataQueue::WaitForData()
+    void SoundDataQueue::PushRef(SoundData * psdBlock)
     {
-        while (NumFilledBuffers() == 0)
+        if (m_psdpPool == 0)
+        {
+            throw EUnexpectedError(__FILE__, __LINE__,
+                                   "SoundDataQueue::PushRef",
+                                   "SoundDataQueue::PushRef can only be"
+                                   " used with queues transporting blocks"
+                                   " of a pool",
+                                   this);
+        }
+        if (!m_srRing.CanWrite())
         {
-            WaitForSingleObject(m_hDataAvailable, INFINITE);
+            throw EXrunError("SoundDataQueue::PushRef", false); // overrun
         }
+        unsigned nSlot = m_srRing.WriteSlot();
+        if (m_rgpsdSlots[nSlot])
+            m_psdpPool->Release(m_rgpsdSlots[nSlot]);
+        m_psdpPool->AddRef(psdBlock);
+        m_rgpsdSlots[nSlot] = psdBlock;
+        m_srRing.CommitWrite();
+        m_bGetWritePointerCalled = false; // reset
+        m_sigDataAvailable.Notify();
+    }
+
+    void SoundDataQueue::WaitForData()
+    {
+        m_sigDataAvailable.Wait(CanReadCondition(m_srRing));
     }
 
     void SoundDataQueue::WaitForSpace()
     {
-        while (NumEmptyBuffers() == 0)
-        {
-            WaitForSingleObject(m_hSpaceAvailable, INFINITE);
-        }
+        m_sigSpaceAvailable.Wait(CanWriteCondition(m_srRing));
+    }
+
+    bool SoundDataQueue::SpinForData()
+    {
+        return m_sigDataAvailable.Spin(CanReadCondition(m_srRing));
+    }
+
+    bool SoundDataQueue::SpinForSpace()
+    {
+        return m_sigSpaceAvailable.Spin(CanWriteCondition(m_srRing));
     }
 
-    HANDLE SoundDataQueue::GetDataEvent() const
+#ifdef _WIN32
+    HANDLE SoundDataQueue::GetDataEvent()
     {
-        return m_hDataAvailable;
+        return m_sigDataAvailable.GetEvent();
     }
-    HANDLE SoundDataQueue::GetSpaceEvent() const
+    HANDLE SoundDataQueue::GetSpaceEvent()
     {
-        return m_hSpaceAvailable;
+        return m_sigSpaceAvailable.GetEvent();
     }
+#endif
 } // namespace Asio
 
 // Local Variables:
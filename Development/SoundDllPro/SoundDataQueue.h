@@ -33,8 +33,9 @@
 #ifndef SOUND_DATA_QUEUE_H
 #define SOUND_DATA_QUEUE_H
 
-#include <windows.h>
 #include "SoundData.h"
+#include "SoundDataPool.h"
+#include "SpscRing.h"
 
 class UNIT_TEST_CLASS;
 
@@ -43,7 +44,13 @@ namespace Asio
     /// A SoundDataQueue is a FIFO of sound data buffers with limited maximum
     /// capacity.
     /// It can be used to transport sound data from one thread of execution to
-    /// another, and to introduce a delay.
+    /// another, and to introduce a delay. Exactly one thread may write to the
+    /// queue (GetWritePtr, Push) and exactly one thread may read from it
+    /// (GetReadPtr, Pop). The read and write positions are atomic and no
+    /// locks are used, a waiting thread spins before it blocks.
+    /// A queue either owns its buffers or transports references to blocks of
+    /// a SoundDataPool: then the same block can be pushed to several queues
+    /// without copying it (\sa PushRef).
     ///
     /// variable prefix: sdq for (S)ound(D)ata(Q)ueue
     class SoundDataQueue {
@@ -52,25 +59,30 @@ namespace Asio
         /// The maximum number of SoundData structs that can be stored in this Queue.
         const size_t m_nBufCapacity;
 
-        /// The memory allocated to store the data.  m_nBufCapacity + 1
-        /// locations are allocated: At least one location is always unused,
-        /// because we have m_nBufCapacity + 1 possible fillcounts
-        /// [0:m_nBufCapacity] that we need to distinguish.
+        /// The memory allocated to store the data: one location per buffer,
+        /// empty and full queue are distinguished by m_srRing. 0 if the
+        /// queue transports blocks of m_psdpPool.
         SoundData * m_rgsdBuffers;
 
-        /// points to location where to write next
-        SoundData * m_psdWrite;
+        /// Pool of the transported blocks, 0 if the queue owns its buffers
+        SoundDataPool * m_psdpPool;
 
-        ///  points to location where to read next
-        SoundData * m_psdRead;
+        /// The buffer of each slot of the queue. Fixed if the queue owns its
+        /// buffers, otherwise set by GetWritePtr and PushRef, and released
+        /// by Pop.
+        SoundData ** m_rgpsdSlots;
 
-        /// This Win32 Event is set when data has been written to the
-        /// queue using \sa Push
-        HANDLE m_hDataAvailable;
+        /// true if blocks acquired from m_psdpPool are cleared
+        bool m_bClearAcquired;
 
-        /// This Win32 Event is set when data has been read from the
-        /// queue using \sa Pop 
-        HANDLE m_hSpaceAvailable;
+        /// Read and write positions in m_rgpsdSlots
+        mutable SpscRing m_srRing;
+
+        /// Signalled when data has been written to the queue using \sa Push
+        SpscSignal m_sigDataAvailable;
+
+        /// Signalled when data has been read from the queue using \sa Pop
+        SpscSignal m_sigSpaceAvailable;
 
         /// Flag to detect erroneous usage of this instance
         bool m_bGetWritePointerCalled;
@@ -101,18 +113,42 @@ namespace Asio
         /// \exception EUnexpectedError If GetWritePtr() has not been called since the last push
         virtual void Push();
 
+        /// Push a reference to a block of the pool of this queue without
+        /// copying it. The reference count of the block is incremented. Blocks
+        /// that do not belong to the pool are transported as well, but are
+        /// never modified by the queue (\sa IsReadPtrShared).
+        /// \exception EUnexpectedError if the queue owns its buffers
+        /// \exception EXrunError if NumEmptyBuffers() == 0
+        void PushRef(SoundData * psdBlock);
+
+        /// Returns true if the buffer returned by GetReadPtr() is referenced
+        /// elsewhere and therefore must not be modified by the reader.
+        bool IsReadPtrShared() const;
+
         /// Wait until the queue contains at least one filled buffer.
         virtual void WaitForData();
 
         /// Wait until the queue has space for at least one buffer.
         virtual void WaitForSpace();
 
+        /// Spin for a short while until the queue contains at least one
+        /// filled buffer without blocking.
+        /// \retval true if a filled buffer is available
+        bool SpinForData();
+
+        /// Spin for a short while until the queue has space for at least one
+        /// buffer without blocking.
+        /// \retval true if an empty buffer is available
+        bool SpinForSpace();
+
+#ifdef _WIN32
         /// Returns the Win32 Event that signals data availability.
-        HANDLE GetDataEvent() const;
+        HANDLE GetDataEvent();
 
         /// Returns the Win32 Event that signals space availability.
-        HANDLE GetSpaceEvent() const;
-        
+        HANDLE GetSpaceEvent();
+#endif
+
         /// Create a queue of SoundData structs.
         /// \param[in] nChannels
         ///  The number of audio channels in each SoundData struct
@@ -122,9 +158,31 @@ namespace Asio
         /// \param[in] nBuffers
         ///  The maximum capacity of the queue, i.e. how many SoundData
         ///  instances can be stored in the queue.
+        /// \param[in] nMaxSpins
+        ///  Maximum number of spins of a waiting thread before it blocks,
+        ///  0 to block immediately.
         SoundDataQueue(unsigned nChannels,
                        unsigned nFrames,
-                       unsigned nBuffers);
+                       unsigned nBuffers,
+                       unsigned nMaxSpins = SpscSignal::DEFAULT_MAX_SPINS);
+
+        /// Create a queue transporting blocks of a SoundDataPool.
+        /// GetWritePtr acquires a block from the pool, Pop releases the
+        /// reference of the queue.
+        /// \param[in] psdpPool
+        ///  The pool, must exist longer than the queue.
+        /// \param[in] bClear
+        ///  If true, blocks acquired by GetWritePtr are cleared. Otherwise
+        ///  they contain old data and the writer has to overwrite all samples.
+        /// \param[in] nBuffers
+        ///  The maximum capacity of the queue.
+        /// \param[in] nMaxSpins
+        ///  Maximum number of spins of a waiting thread before it blocks,
+        ///  0 to block immediately.
+        SoundDataQueue(SoundDataPool * psdpPool,
+                       bool bClear,
+                       unsigned nBuffers,
+                       unsigned nMaxSpins = SpscSignal::DEFAULT_MAX_SPINS);
 
         /// Deallocate the Queue
         virtual ~SoundDataQueue();
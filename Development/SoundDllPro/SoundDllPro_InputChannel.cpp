@@ -44,7 +44,8 @@ SDPInput::SDPInput(unsigned int nChannelIndex, bool bDisableRecFile, unsigned in
       m_nChannelIndex(nChannelIndex),
       m_prfRecordFile(NULL),
       m_nBufPos(0),
-      m_bStarted(false)
+      m_bStarted(false),
+      m_bRecMultiFile(false)
 {
    if (!SoundClass())
       throw Exception("global SoundClass is invalid");
@@ -145,7 +146,8 @@ void SDPInput::Start()
 
    m_nBufPos = 0;
    m_bStarted = false;
-   if (!!m_prfRecordFile)
+   // NOTE: channels written to multichannel record file have no own file
+   if (!!m_prfRecordFile && !m_bRecMultiFile)
       {
       if (!m_prfRecordFile->IsOpen())
          m_prfRecordFile->OpenFile();
@@ -214,6 +216,11 @@ bool SDPInput::Pause()
 //------------------------------------------------------------------------------
 bool SDPInput::IsRecording()
 {
+   if (m_bRecMultiFile)
+      {
+      SDPRecMultiFile* psdprmf = SoundClass()->RecMultiFile();
+      return m_bSaveToFile && !!psdprmf && psdprmf->IsOpen() && psdprmf->Enabled();
+      }
    if (!m_prfRecordFile)
       return false;
    return m_bSaveToFile && m_prfRecordFile->IsOpen() && m_prfRecordFile->Enabled();
@@ -250,6 +257,13 @@ void SDPInput::SaveBuffer(std::valarray<float> &vaf, bool bSaveToFile)
    if (!bSaveToFile)
       return;
 
+   // data are written by SoundDllProMain to multichannel record file
+   if (m_bRecMultiFile)
+      {
+      m_bStarted = true;
+      return;
+      }
+
    if (!m_prfRecordFile)
       return;
 
@@ -296,11 +310,43 @@ std::valarray<float>& SDPInput::GetBuffer()
 }
 //------------------------------------------------------------------------------
 
+//------------------------------------------------------------------------------
+/// copies nSamples samples of ringbuffer in correct time order to pfDest
+/// without an intermediate copy. nOffset is the offset of the first sample to
+/// copy relative to the oldest sample in the ringbuffer.
+/// MUST BE SYNCED E.G. WITH CRITICAL SECTION BY CALLER (see SaveBuffer)
+//------------------------------------------------------------------------------
+void SDPInput::CopyBuffer(float* pfDest, unsigned int nOffset, unsigned int nSamples)
+{
+   unsigned int nSize = (unsigned int)m_vvafBuffer[0].size();
+   if (!nSize)
+      throw Exception("no buffers recorded");
+   if (nOffset > nSize || nSamples > nSize - nOffset)
+      throw Exception("invalid ringbuffer range requested");
+
+   // read position of first sample in ringbuffer
+   unsigned int nReadPos = m_nBufPos + nOffset;
+   if (nReadPos >= nSize)
+      nReadPos -= nSize;
+   unsigned int n = nSize - nReadPos;
+   if (n < nSamples)
+      {
+      // copy up to end of ringbuffer and rest from beginning
+      CopyMemory(pfDest, &m_vvafBuffer[0][nReadPos], (size_t)(n * sizeof(float)));
+      CopyMemory(pfDest + n, &m_vvafBuffer[0][0], (size_t)((nSamples - n) * sizeof(float)));
+      }
+   else if (nSamples)
+      CopyMemory(pfDest, &m_vvafBuffer[0][nReadPos], (size_t)(nSamples * sizeof(float)));
+}
+//------------------------------------------------------------------------------
+
 //------------------------------------------------------------------------------
 /// returns number of samples recorded to file
 //------------------------------------------------------------------------------
 int64_t  SDPInput::RecPosition()
 {
+   if (m_bRecMultiFile)
+      return !!SoundClass()->RecMultiFile() ? SoundClass()->RecMultiFile()->Size() : 0;
    if (!m_prfRecordFile)
       return 0;
    return m_prfRecordFile->Size();
@@ -329,6 +375,27 @@ bool SDPInput::SaveToFile()
 }
 //------------------------------------------------------------------------------
 
+//------------------------------------------------------------------------------
+/// sets flag, if channel is written to multichannel record file of
+/// SoundDllProMain instead of own record file
+//------------------------------------------------------------------------------
+void SDPInput::RecMultiFile(bool bEnable)
+{
+   if (bEnable && !!m_prfRecordFile && m_prfRecordFile->IsOpen())
+      Stop();
+   m_bRecMultiFile = bEnable;
+}
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+/// returns flag, if channel is written to multichannel record file
+//------------------------------------------------------------------------------
+bool SDPInput::RecMultiFile()
+{
+   return m_bRecMultiFile;
+}
+//------------------------------------------------------------------------------
+
 //------------------------------------------------------------------------------
 /// sets filename of reord file
 //------------------------------------------------------------------------------
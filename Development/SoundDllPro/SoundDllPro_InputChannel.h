@@ -58,7 +58,10 @@ class SDPInput
       bool                    Started();
       void                    SaveToFile(bool bEnable);
       bool                    SaveToFile();
+      void                    RecMultiFile(bool bEnable);
+      bool                    RecMultiFile();
       std::valarray<float>&   GetBuffer();
+      void                    CopyBuffer(float* pfDest, unsigned int nOffset, unsigned int nSamples);
       void                    BufferSize(unsigned int nBufSize);
       unsigned int            BufferSize(void);
       void                    RecordLength(unsigned int nRecordLength);
@@ -74,6 +77,7 @@ class SDPInput
       SDPRecFile*             m_prfRecordFile;  ///< instance of record file
       unsigned int            m_nBufPos;        ///< internal buffer position
       bool                    m_bStarted;       ///< flag if recording is started
+      bool                    m_bRecMultiFile;  ///< flag if channel is written to multichannel record file
       std::vector<std::valarray<float> > m_vvafBuffer;  ///< internal buffer
 };
 //------------------------------------------------------------------------------
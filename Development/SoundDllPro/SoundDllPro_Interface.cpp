@@ -42,6 +42,9 @@
 #include "SoundDllPro_Interface.h"
 #include "SoundDllPro_Main.h"
 #include "SoundDllPro_WaveReader_libsndfile.h"
+#include "SoundDllPro_SampleStore.h"
+#include "SoundDllPro_Trace.h"
+#include "SoundDllPro_RecFile.h"
 #include "MPlugin.h"
 #include "formTracks.h"
 #include "formMixer.h"
@@ -305,6 +308,8 @@ void SetDriverModel(TStringList *psl)
       SoundDllProMain::SetDriverModel(DRV_TYPE_ASIO);
    else if (!strcmpi(strType.c_str(), SOUNDDLLPRO_PAR_WDM))
       SoundDllProMain::SetDriverModel(DRV_TYPE_WDM);
+   else if (!strcmpi(strType.c_str(), SOUNDDLLPRO_PAR_NULL))
+      SoundDllProMain::SetDriverModel(DRV_TYPE_NULL);
    else
       throw Exception("unknown value");
 }
@@ -321,6 +326,8 @@ void GetDriverModel(TStringList *psl)
       SetValue(psl, SOUNDDLLPRO_PAR_VALUE, SOUNDDLLPRO_PAR_ASIO);
    else if (sdm == DRV_TYPE_WDM)
       SetValue(psl, SOUNDDLLPRO_PAR_VALUE, SOUNDDLLPRO_PAR_WDM);
+   else if (sdm == DRV_TYPE_NULL)
+      SetValue(psl, SOUNDDLLPRO_PAR_VALUE, SOUNDDLLPRO_PAR_NULL);
    else
       SetValue(psl, SOUNDDLLPRO_PAR_VALUE, "UNKNOWN");
 }
@@ -981,6 +988,7 @@ void LoadMem(TStringList *psl)
       unsigned int nLoopRampLen  = (unsigned int)GetInt(psl, SOUNDDLLPRO_PAR_LOOPRAMPLEN, 0, VAL_POS_OR_ZERO);
       bool bLoopCrossfade        = !(  GetInt(psl, SOUNDDLLPRO_PAR_LOOPCROSSFADE, 0, VAL_POS_OR_ZERO) == 0 );
       unsigned int nCrossfadeLen  = (unsigned int)GetInt(psl, SOUNDDLLPRO_PAR_CROSSFADELEN, 0, VAL_POS_OR_ZERO);
+      AnsiString strDataKey   = psl->Values[SOUNDDLLPRO_PAR_DATAKEY];
       // check data pointer or name of shared memory respectively
       if (psl->Values[SOUNDDLLPRO_PAR_DATA].IsEmpty())
          throw Exception("value for parameter '" + AnsiString(SOUNDDLLPRO_PAR_DATA) + "' must not be empty");
@@ -1000,28 +1008,57 @@ void LoadMem(TStringList *psl)
       // store SDPOutputData pointers  AND total number of samples
       // in track BEFORE loading new data to adjust global position later in blocking loop
       std::vector<SDPOutputData* > vpsdpod;
+      // convert each data channel only once: the blocks are shared by all tracks
+      // (and all other loaded objects with identical data or key)
+      std::vector<SDPSampleBlock* > vpsdpsb(nChannels, (SDPSampleBlock*)NULL);
       unsigned int nTrackIndex;
-      for (nTrackIndex = 0; nTrackIndex < nTracks; nTrackIndex++)
+      try
          {
-         viOffset[nTrackIndex] = (unsigned int)SoundClass()->m_vTracks[(unsigned int)viTrack[nTrackIndex]]->NumTrackSamples();
-         // NOTE: create SDPOD_AUDIO within loop to use default values from constructor!!
-         SDPOD_AUDIO sdpod;
-         sdpod.bIsFile        = false;
-         sdpod.pData          = (double*)nDataPointer;
-         sdpod.nChannelIndex  = (nTrackIndex % nChannels);
-         sdpod.nNumChannels   = nChannels;
-         sdpod.nNumSamples    = nSamples;
-         sdpod.nLoopCount     = nLoopCount;
-         sdpod.nOffset        = nOffset;
-         sdpod.nStartOffset   = nStartOffset;
-         sdpod.strName        = strName;
-         sdpod.fGain          = fGain;
-         sdpod.nRampLenght      = nRampLen;
-         sdpod.nLoopRampLenght  = nLoopRampLen;
-         sdpod.bLoopCrossfade   = bLoopCrossfade;
-         sdpod.nCrossfadeLengthLeft = nCrossfadeLen;
-
-         vpsdpod.push_back(SoundClass()->m_vTracks[(unsigned int)viTrack[nTrackIndex]]->LoadAudio(sdpod));
+         unsigned int nChannel;
+         SDPSampleStore* psdpss = SDPSampleStore::Instance();
+         if (psdpss)
+            {
+            for (nChannel = 0; nChannel < nChannels; nChannel++)
+               {
+               // NOTE: data are non-interleaved!
+               vpsdpsb[nChannel] = psdpss->Acquire((double*)nDataPointer + (uint64_t)nSamples*nChannel,
+                                                   nSamples,
+                                                   strDataKey.IsEmpty() ? AnsiString() : strDataKey + ":" + IntToStr((int)nChannel)
+                                                   );
+               }
+            }
+         for (nTrackIndex = 0; nTrackIndex < nTracks; nTrackIndex++)
+            {
+            viOffset[nTrackIndex] = (unsigned int)SoundClass()->m_vTracks[(unsigned int)viTrack[nTrackIndex]]->NumTrackSamples();
+            // NOTE: create SDPOD_AUDIO within loop to use default values from constructor!!
+            SDPOD_AUDIO sdpod;
+            sdpod.bIsFile        = false;
+            sdpod.pData          = (double*)nDataPointer;
+            sdpod.nChannelIndex  = (nTrackIndex % nChannels);
+            sdpod.nNumChannels   = nChannels;
+            sdpod.nNumSamples    = nSamples;
+            sdpod.nLoopCount     = nLoopCount;
+            sdpod.nOffset        = nOffset;
+            sdpod.nStartOffset   = nStartOffset;
+            sdpod.strName        = strName;
+            sdpod.fGain          = fGain;
+            sdpod.nRampLenght      = nRampLen;
+            sdpod.nLoopRampLenght  = nLoopRampLen;
+            sdpod.bLoopCrossfade   = bLoopCrossfade;
+            sdpod.nCrossfadeLengthLeft = nCrossfadeLen;
+            sdpod.psdpsb         = vpsdpsb[sdpod.nChannelIndex];
+
+            vpsdpod.push_back(SoundClass()->m_vTracks[(unsigned int)viTrack[nTrackIndex]]->LoadAudio(sdpod));
+            }
+         }
+      __finally
+         {
+         // release our references: blocks are kept by the loaded objects
+         for (unsigned int nChannel = 0; nChannel < nChannels; nChannel++)
+            {
+            if (vpsdpsb[nChannel])
+               vpsdpsb[nChannel]->Release();
+            }
          }
       //*************
       // BUGFIX on February 24th 2009: alignment fails for adding endless looped data here
@@ -1120,29 +1157,76 @@ void LoadFile(TStringList *psl)
       // in track BEFORE loading new data to adjust global position later in blocking loop
       std::vector<SDPOutputData* > vpsdpod(nTracks);
       unsigned int nTrackIndex;
+
+      // the file is read and decoded only once by one file instance shared by
+      // all loaded channels. NOTE: shared buffers need all channels to be
+      // played synchronously. This is not the case, if a track is used more than
+      // once (data appended to each other) or if a crossfade is used (channels
+      // on tracks with previously loaded data start earlier), so then every
+      // channel uses an own file instance
+      bool bShareFile = !nCrossfadeLen;
+      unsigned int nUsedTracks = 0;
+      std::vector<bool> vbTrackUsed(SoundClass()->m_vTracks.size(), false);
       for (nTrackIndex = 0; nTrackIndex < nTracks; nTrackIndex++)
          {
          if (viTrack[nTrackIndex] > -1)
             {
-            viOffset[nTrackIndex] = (unsigned int)SoundClass()->m_vTracks[(unsigned int)viTrack[nTrackIndex]]->NumTrackSamples();
-            // NOTE: create SDPOD_AUDIO within loop to use default values from constructor!!
-            SDPOD_AUDIO sdpod;
-            sdpod.bIsFile        = true;
-            sdpod.strName        = strFileName;
-            sdpod.nChannelIndex  = (unsigned int)(nTrackIndex % nChannels);
-            sdpod.nLoopCount     = (unsigned int)nLoopCount;
-            sdpod.nOffset        = nOffset;
-            sdpod.nStartOffset   = nStartOffset;
-            sdpod.nFileOffset    = nFileOffset;
-            sdpod.nNumSamples    = nLength;
-            sdpod.fGain          = fGain;
-            sdpod.nRampLenght      = nRampLen;
-            sdpod.nLoopRampLenght  = nLoopRampLen;
-            sdpod.bLoopCrossfade   = bLoopCrossfade;
-            sdpod.nCrossfadeLengthLeft = nCrossfadeLen;
-            vpsdpod[nTrackIndex] = SoundClass()->m_vTracks[(unsigned int)viTrack[nTrackIndex]]->LoadAudio(sdpod);
+            if (vbTrackUsed[(unsigned int)viTrack[nTrackIndex]])
+               bShareFile = false;
+            vbTrackUsed[(unsigned int)viTrack[nTrackIndex]] = true;
+            nUsedTracks++;
             }
          }
+      SDPWaveFile* psdpwf = NULL;
+      if (bShareFile && nUsedTracks > 1)
+         {
+         SDPOD_AUDIO sdpodFile;
+         sdpodFile.bIsFile          = true;
+         sdpodFile.strName          = strFileName;
+         sdpodFile.nLoopCount       = (unsigned int)nLoopCount;
+         sdpodFile.nStartOffset     = nStartOffset;
+         sdpodFile.nFileOffset      = nFileOffset;
+         sdpodFile.nNumSamples      = nLength;
+         sdpodFile.nLoopRampLenght  = nLoopRampLen;
+         sdpodFile.bLoopCrossfade   = bLoopCrossfade;
+         psdpwf = new SDPWaveFile(  sdpodFile,
+                                    (unsigned int)SoundClass()->SoundGetSampleRate(),
+                                    (unsigned int)SoundClass()->SoundBufsizeSamples() * SoundClass()->GetQueueNumBufs()
+                                    );
+         }
+      try
+         {
+         for (nTrackIndex = 0; nTrackIndex < nTracks; nTrackIndex++)
+            {
+            if (viTrack[nTrackIndex] > -1)
+               {
+               viOffset[nTrackIndex] = (unsigned int)SoundClass()->m_vTracks[(unsigned int)viTrack[nTrackIndex]]->NumTrackSamples();
+               // NOTE: create SDPOD_AUDIO within loop to use default values from constructor!!
+               SDPOD_AUDIO sdpod;
+               sdpod.bIsFile        = true;
+               sdpod.strName        = strFileName;
+               sdpod.nChannelIndex  = (unsigned int)(nTrackIndex % nChannels);
+               sdpod.nLoopCount     = (unsigned int)nLoopCount;
+               sdpod.nOffset        = nOffset;
+               sdpod.nStartOffset   = nStartOffset;
+               sdpod.nFileOffset    = nFileOffset;
+               sdpod.nNumSamples    = nLength;
+               sdpod.fGain          = fGain;
+               sdpod.nRampLenght      = nRampLen;
+               sdpod.nLoopRampLenght  = nLoopRampLen;
+               sdpod.bLoopCrossfade   = bLoopCrossfade;
+               sdpod.nCrossfadeLengthLeft = nCrossfadeLen;
+               sdpod.psdpwf         = psdpwf;
+               vpsdpod[nTrackIndex] = SoundClass()->m_vTracks[(unsigned int)viTrack[nTrackIndex]]->LoadAudio(sdpod);
+               }
+            }
+         }
+      __finally
+         {
+         // release our reference: file instance is kept by the readers
+         if (psdpwf)
+            psdpwf->Release();
+         }
 	  // reset nSamples for endless loop!
       if (!nLoopCount)
          nSamples = 0;
@@ -1829,6 +1913,164 @@ void NumXRuns(TStringList *psl)
 }
 //------------------------------------------------------------------------------
 
+//------------------------------------------------------------------------------
+/// returns statistics of wave file reader pool
+//------------------------------------------------------------------------------
+void FileReadStats(TStringList *psl)
+{
+   psl->Clear();
+   SDPWaveFilePool* psdpwfp = SDPWaveFilePool::Instance();
+   if (!psdpwfp)
+      throw Exception("file reader pool not initialized");
+   SDPWaveFilePoolStats sdpwfps;
+   psdpwfp->GetStats(sdpwfps);
+   psl->Values[SOUNDDLLPRO_PAR_THREADS]         = IntToStr((int)psdpwfp->NumThreads());
+   psl->Values[SOUNDDLLPRO_PAR_QUEUEDEPTH]      = IntToStr((int)sdpwfps.nQueueDepth);
+   psl->Values[SOUNDDLLPRO_PAR_MAXQUEUEDEPTH]   = IntToStr((int)sdpwfps.nMaxQueueDepth);
+   psl->Values[SOUNDDLLPRO_PAR_REQUESTS]        = IntToStr((int64_t)sdpwfps.nRequests);
+   psl->Values[SOUNDDLLPRO_PAR_MISSED]          = IntToStr((int64_t)sdpwfps.nMissed);
+   psl->Values[SOUNDDLLPRO_PAR_WORSTSLACK]      = DoubleToStr(sdpwfps.dWorstSlack);
+   psl->Values[SOUNDDLLPRO_PAR_REATTACHES]      = IntToStr((int64_t)sdpwfps.nReattaches);
+   psl->Values[SOUNDDLLPRO_PAR_UNDERRUNSAMPLES] = IntToStr((int64_t)sdpwfps.nUnderrun);
+}
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+/// returns statistics of asynchronous writer of record files
+//------------------------------------------------------------------------------
+void RecWriteStats(TStringList *psl)
+{
+   psl->Clear();
+   SDPRecWriter* psdprw = SDPRecWriter::Instance();
+   if (!psdprw)
+      throw Exception("record writer not initialized (disabled with 'recwritebufsize')");
+   SDPRecWriterStats sdprws;
+   psdprw->GetStats(sdprws);
+   psl->Values[SOUNDDLLPRO_PAR_BLOCKS]          = IntToStr((int)psdprw->NumBlocks());
+   psl->Values[SOUNDDLLPRO_PAR_BLOCKSIZE]       = IntToStr((int)psdprw->BlockSize());
+   psl->Values[SOUNDDLLPRO_PAR_FILES]           = IntToStr((int)sdprws.nFiles);
+   psl->Values[SOUNDDLLPRO_PAR_SYNCFILES]       = IntToStr((int)sdprws.nSyncFiles);
+   psl->Values[SOUNDDLLPRO_PAR_QUEUEDEPTH]      = IntToStr((int)sdprws.nQueueDepth);
+   psl->Values[SOUNDDLLPRO_PAR_MAXQUEUEDEPTH]   = IntToStr((int)sdprws.nMaxQueueDepth);
+   psl->Values[SOUNDDLLPRO_PAR_MAXBLOCKSUSED]   = IntToStr((int)sdprws.nMaxBlocksUsed);
+   psl->Values[SOUNDDLLPRO_PAR_BYTES]           = IntToStr((int64_t)sdprws.nBytes);
+   psl->Values[SOUNDDLLPRO_PAR_WRITES]          = IntToStr((int64_t)sdprws.nWrites);
+   psl->Values[SOUNDDLLPRO_PAR_STALLS]          = IntToStr((int64_t)sdprws.nStalls);
+   psl->Values[SOUNDDLLPRO_PAR_STALLTIME]       = DoubleToStr(sdprws.dStallTime);
+   psl->Values[SOUNDDLLPRO_PAR_MAXSTALLTIME]    = DoubleToStr(sdprws.dMaxStallTime);
+   psl->Values[SOUNDDLLPRO_PAR_MAXWRITETIME]    = DoubleToStr(sdprws.dMaxWriteTime);
+}
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+/// returns statistics of sample store used by command 'loadmem'
+//------------------------------------------------------------------------------
+void LoadMemStats(TStringList *psl)
+{
+   psl->Clear();
+   SDPSampleStore* psdpss = SDPSampleStore::Instance();
+   if (!psdpss)
+      throw Exception("sample store not initialized");
+   SDPSampleStoreStats sdpsss;
+   psdpss->GetStats(sdpsss);
+   psl->Values[SOUNDDLLPRO_PAR_BLOCKS]       = IntToStr((int)sdpsss.nBlocks);
+   psl->Values[SOUNDDLLPRO_PAR_REFERENCES]   = IntToStr((int)sdpsss.nReferences);
+   psl->Values[SOUNDDLLPRO_PAR_BYTES]        = IntToStr((int64_t)sdpsss.nBytes);
+   psl->Values[SOUNDDLLPRO_PAR_SAVEDBYTES]   = IntToStr((int64_t)sdpsss.nSavedBytes);
+   psl->Values[SOUNDDLLPRO_PAR_HITS]         = IntToStr((int64_t)sdpsss.nHits);
+   psl->Values[SOUNDDLLPRO_PAR_MISSES]       = IntToStr((int64_t)sdpsss.nMisses);
+}
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+/// returns performance report of current or last run as JSON string or writes
+/// it to a file
+//------------------------------------------------------------------------------
+void PerfReport(TStringList *psl)
+{
+   AnsiString strFileName = Trim(psl->Values[SOUNDDLLPRO_PAR_FILENAME]);
+   psl->Clear();
+   AnsiString strReport = SoundClass()->GetPerformanceReport();
+   if (strFileName.IsEmpty())
+      {
+      psl->Values[SOUNDDLLPRO_PAR_VALUE] = strReport;
+      return;
+      }
+   TStringList *pslTmp = new TStringList();
+   try
+      {
+      pslTmp->Add(strReport);
+      pslTmp->SaveToFile(strFileName);
+      }
+   __finally
+      {
+      TRYDELETENULL(pslTmp);
+      }
+}
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+/// returns count, percentiles and maximum of processing times of all
+/// performance stages in milliseconds. Does not stop the device
+//------------------------------------------------------------------------------
+void PerfStats(TStringList *psl)
+{
+   psl->Clear();
+   AnsiString strName, strCount, strP50, strP99, strP999, strMax;
+   for (unsigned int n = 0; n < PERF_STAGE_LAST; n++)
+      {
+      CPerformanceCounter& pc = SoundClass()->PerfStage(n);
+      strName  += AnsiString(g_lpcszPerfStageNames[n]) + ",";
+      strCount += IntToStr((int64_t)pc.Count()) + ",";
+      strP50   += DoubleToStr(1000.0*pc.Percentile(0.5)) + ",";
+      strP99   += DoubleToStr(1000.0*pc.Percentile(0.99)) + ",";
+      strP999  += DoubleToStr(1000.0*pc.Percentile(0.999)) + ",";
+      strMax   += DoubleToStr(1000.0*pc.MaxValue()) + ",";
+      }
+   // remove last ','
+   RemoveTrailingChar(strName);
+   RemoveTrailingChar(strCount);
+   RemoveTrailingChar(strP50);
+   RemoveTrailingChar(strP99);
+   RemoveTrailingChar(strP999);
+   RemoveTrailingChar(strMax);
+   SetValue(psl, SOUNDDLLPRO_PAR_NAME,       strName);
+   SetValue(psl, SOUNDDLLPRO_PAR_COUNT,      strCount);
+   SetValue(psl, SOUNDDLLPRO_PAR_P50,        strP50);
+   SetValue(psl, SOUNDDLLPRO_PAR_P99,        strP99);
+   SetValue(psl, SOUNDDLLPRO_PAR_P999,       strP999);
+   SetValue(psl, SOUNDDLLPRO_PAR_MAXVALUE,   strMax);
+}
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+/// resets histograms of all performance stages. Does not stop the device
+//------------------------------------------------------------------------------
+#pragma argsused
+void PerfStatsReset(TStringList *psl)
+{
+   SoundClass()->ResetPerfStages();
+}
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+/// writes events of the trace ring to a file in Chrome/Perfetto trace JSON
+/// format. Does not stop the device
+//------------------------------------------------------------------------------
+void TraceDump(TStringList *psl)
+{
+   AnsiString strFileName = Trim(psl->Values[SOUNDDLLPRO_PAR_FILENAME]);
+   if (strFileName.IsEmpty())
+      throw Exception("'" + AnsiString(SOUNDDLLPRO_PAR_FILENAME) + "' must be specified");
+   float fLength = GetFloat(psl, SOUNDDLLPRO_PAR_LENGTH, 0.0f, VAL_POS_OR_ZERO);
+   psl->Clear();
+   SDPTrace* psdpt = SDPTrace::Instance();
+   if (!psdpt)
+      throw Exception("tracing not enabled (see '" + AnsiString(SOUNDDLLPRO_PAR_TRACESIZE) + "' in command '" + AnsiString(SOUNDDLLPRO_CMD_INIT) + "')");
+   psdpt->Dump(ExpandFileName(strFileName).c_str(), (double)fLength);
+}
+//------------------------------------------------------------------------------
+
 //------------------------------------------------------------------------------
 /// sets values between 0 and 1 to be interpreted as clipping for one or more
 /// channels on input ot output
@@ -2009,7 +2251,10 @@ void RecPosition(TStringList *psl)
 //------------------------------------------------------------------------------
 
 //------------------------------------------------------------------------------
-/// retrieves a buffer of recorded data from one or more input channnels
+/// retrieves a buffer of recorded data from one or more input channnels. If
+/// a cursor (absolute record position of first sample not retrieved yet) is
+/// passed, only samples recorded since the cursor are returned and samples
+/// lost from the ringbuffer are reported in 'overrun'
 //------------------------------------------------------------------------------
 void RecGetData(TStringList *psl)
 {
@@ -2018,15 +2263,25 @@ void RecGetData(TStringList *psl)
    // data pointer for receiving data passed. If empty only BUFSIZE and CHANNELS are returned
    // for caller to determine needed space
    NativeInt nDataPointer           = (NativeInt)GetInt(psl, SOUNDDLLPRO_PAR_DATA, 0, VAL_POS_OR_ZERO);
+   // cursor for streaming read (-1: return complete ringbuffer)
+   int64_t nCursor                  = -1;
+   if (!Trim(psl->Values[SOUNDDLLPRO_PAR_CURSOR]).IsEmpty())
+      nCursor = GetInt(psl, SOUNDDLLPRO_PAR_CURSOR, VAL_POS_OR_ZERO);
+   // maximum number of samples to return for streaming read (-1: no limit)
+   int64_t nMaxSamples              = -1;
+   if (!Trim(psl->Values[SOUNDDLLPRO_PAR_SAMPLES]).IsEmpty())
+      nMaxSamples = GetInt(psl, SOUNDDLLPRO_PAR_SAMPLES, VAL_POS_OR_ZERO);
 
    psl->Clear();
-   AnsiString str;
-   std::valarray<float> *pvaf;
    // NOTE: viChannel cannot be empty here
    unsigned int nChannels = (unsigned int)viChannel.size();
    unsigned int nSize = 0;
    unsigned int nSizeTmp;
+   unsigned int nOffset = 0;
+   unsigned int nSamples = 0;
    int64_t nPosition = 0;
+   int64_t nFirst = 0;
+   int64_t nOverrun = 0;
    EnterCriticalSection(&SoundClass()->m_csBufferDone);
    try
       {
@@ -2043,15 +2298,34 @@ void RecGetData(TStringList *psl)
          }
       // get current position
       nPosition = (int64_t)(SoundClass()->GetBufferDonePosition() / SoundClass()->GetRecDownSampleFactor());
+      // NOTE: since we have to return 'leading zeroes' in the beginning, the position has to be
+      // calculated (may be negative in the beginning!)
+      nFirst   = nPosition - (int64_t)nSize;
+      nSamples = nSize;
+      if (nCursor >= 0)
+         {
+         if (nCursor > nPosition)
+            throw Exception("invalid cursor: larger than current record position " + IntToStr(nPosition));
+         // samples already overwritten in ringbuffer are lost
+         if (nCursor < nFirst)
+            nOverrun = nFirst - nCursor;
+         else
+            {
+            nOffset  = (unsigned int)(nCursor - nFirst);
+            nFirst   = nCursor;
+            }
+         nSamples = (unsigned int)(nPosition - nFirst);
+         if (nMaxSamples >= 0 && nSamples > nMaxSamples)
+            nSamples = (unsigned int)nMaxSamples;
+         }
       // copy data only if passed data pointer valid!
       if (!!nDataPointer)
          {
          float *lpd = (float*)nDataPointer;
          for (unsigned int i = 0; i < nChannels; i++)
             {
-            pvaf = &SoundClass()->m_vInput[(unsigned int)viChannel[i]]->GetBuffer();
-            CopyMemory(lpd, &((*pvaf)[0]), nSize*sizeof(float));
-            lpd += nSize;
+            SoundClass()->m_vInput[(unsigned int)viChannel[i]]->CopyBuffer(lpd, nOffset, nSamples);
+            lpd += nSamples;
             }
          }
       }
@@ -2059,11 +2333,14 @@ void RecGetData(TStringList *psl)
       {
       LeaveCriticalSection(&SoundClass()->m_csBufferDone);
       }
-   // NOTE: since we have to return 'leading zeroes' in the beginning, the position has to be
-   // calculated (may be negative in the beginning!)
-   psl->Values[SOUNDDLLPRO_PAR_POSITION]  = IntToStr((int64_t)(nPosition-nSize));
-   psl->Values[SOUNDDLLPRO_PAR_BUFSIZE]   = IntToStr((int)nSize);
+   psl->Values[SOUNDDLLPRO_PAR_POSITION]  = IntToStr((int64_t)nFirst);
+   psl->Values[SOUNDDLLPRO_PAR_BUFSIZE]   = IntToStr((int)nSamples);
    psl->Values[SOUNDDLLPRO_PAR_CHANNELS]  = IntToStr((int)nChannels);
+   if (nCursor >= 0)
+      {
+      psl->Values[SOUNDDLLPRO_PAR_CURSOR]    = IntToStr((int64_t)(nFirst + nSamples));
+      psl->Values[SOUNDDLLPRO_PAR_OVERRUN]   = IntToStr((int64_t)nOverrun);
+      }
    return;
 }
 //------------------------------------------------------------------------------
@@ -2282,6 +2559,51 @@ void RecFileName(TStringList *psl)
 }
 //------------------------------------------------------------------------------
 
+//------------------------------------------------------------------------------
+/// sets and returns file for recording a group of input channels interleaved
+/// to one file
+//------------------------------------------------------------------------------
+void RecMultiFile(TStringList *psl)
+{
+   AnsiString strValue     = psl->Values[SOUNDDLLPRO_PAR_VALUE];
+   AnsiString strFileName  = psl->Values[SOUNDDLLPRO_PAR_FILENAME];
+   AnsiString strChannel   = psl->Values[SOUNDDLLPRO_PAR_CHANNEL];
+   psl->Clear();
+   if (!strValue.IsEmpty() && strValue != "0" && strValue != "1")
+      throw Exception("invalid value for parameter 'value' (must be 0 or 1)");
+   if (strValue == "0")
+      {
+      if (!strFileName.IsEmpty())
+         throw Exception("parameter 'filename' not allowed if 'value' is 0");
+      SoundClass()->RecMultiFile("", std::vector<int>());
+      }
+   else if (!strFileName.IsEmpty())
+      {
+      std::vector<int> viChannel = SoundClass()->ConvertSoundChannelArgument(strChannel, CT_INPUT);
+      SoundClass()->RecMultiFile(strFileName, viChannel);
+      }
+   else if (strValue == "1" || !strChannel.IsEmpty())
+      throw Exception("parameter 'filename' missing");
+
+   // write current status to return
+   SDPRecMultiFile* psdprmf = SoundClass()->RecMultiFile();
+   SetValue(psl, SOUNDDLLPRO_PAR_VALUE, psdprmf ? "1" : "0");
+   AnsiString str;
+   if (psdprmf)
+      {
+      const std::vector<unsigned int>& vnChannels = psdprmf->Channels();
+      for (unsigned int i = 0; i < vnChannels.size(); i++)
+         str += IntToStr((int)vnChannels[i]) + ",";
+      // remove last ','
+      RemoveTrailingChar(str);
+      SetValue(psl, SOUNDDLLPRO_PAR_FILENAME, psdprmf->FileName());
+      }
+   else
+      SetValue(psl, SOUNDDLLPRO_PAR_FILENAME, "");
+   SetValue(psl, SOUNDDLLPRO_PAR_CHANNEL, str);
+}
+//------------------------------------------------------------------------------
+
 //------------------------------------------------------------------------------
 /// sets and returns pause status for one or more recording channel (pauses
 /// recording to file)
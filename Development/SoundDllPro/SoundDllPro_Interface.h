@@ -102,6 +102,7 @@ void   RecThreshold(TStringList *psl);
 void   RecStarted(TStringList *psl);
 void   RecLength(TStringList *psl);
 void   RecFileName(TStringList *psl);
+void   RecMultiFile(TStringList *psl);
 void   RecPause(TStringList *psl);
 void   Volume(TStringList *psl);
 void   TrackVolume(TStringList *psl);
@@ -112,6 +113,13 @@ void   ClearTrack(TStringList *psl);
 void   Playing(TStringList *psl);
 void   Recording(TStringList *psl);
 void   NumXRuns(TStringList *psl);
+void   FileReadStats(TStringList *psl);
+void   RecWriteStats(TStringList *psl);
+void   LoadMemStats(TStringList *psl);
+void   PerfReport(TStringList *psl);
+void   PerfStats(TStringList *psl);
+void   PerfStatsReset(TStringList *psl);
+void   TraceDump(TStringList *psl);
 void   ClipThreshold(TStringList *psl);
 void   ClipCount(TStringList *psl);
 void   ResetClipCount(TStringList *psl);
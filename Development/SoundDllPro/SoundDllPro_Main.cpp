@@ -30,6 +30,9 @@
 #pragma hdrstop
 #include <math.h>
 #include <stdio.h>
+#define PSAPI_VERSION 1
+#include <psapi.h>
+#pragma comment(lib, "psapi.lib")
 #include "SoundDllPro_Main.h"
 #include "MPlugin.h"
 #include "formTracks.h"
@@ -38,7 +41,10 @@
 #include "formPerformance.h"
 #include "SoundDllPro_RecFile.h"
 #include "SoundDllPro_SoundClassAsio.h"
+#include "SoundDllPro_SoundClassNull.h"
 #include "SoundDllPro_WaveReader_libsndfile.h"
+#include "SoundDllPro_SampleStore.h"
+#include "SoundDllPro_Trace.h"
 #ifdef NOMMDEVICE
    #include "SoundDllPro_SoundClassWdm.h"
 #else
@@ -62,6 +68,23 @@ const char* g_lpcszDriverStatus[RUNNING+1] =
    };
 //------------------------------------------------------------------------------
 
+//------------------------------------------------------------------------------
+/// names of performance stages
+//------------------------------------------------------------------------------
+const char* g_lpcszPerfStageNames[PERF_STAGE_LAST] =
+   {
+   "dsp",
+   "vstrec",
+   "vsttrack",
+   "vstmaster",
+   "ml",
+   "rec",
+   "vis",
+   "callback",
+   "queuewait"
+   };
+//------------------------------------------------------------------------------
+
 //------------------------------------------------------------------------------
 /// Pointer to global instance (set in constructor).
 //------------------------------------------------------------------------------
@@ -130,10 +153,19 @@ SoundDllProMain::SoundDllProMain()
       m_dSecondsPerBuffer(1.0),
       m_bRecFilesDisabled(false),
       m_fRampLength(1.0f),
+      m_nRunStartTicks(0),
+      m_dRunTime(0.0),
+      m_bRunTimeRunning(false),
       m_pVSTHostTrack(NULL),
       m_pVSTHostMaster(NULL),
       m_pVSTHostFinal(NULL),
       m_pVSTHostRecord(NULL),
+      m_psdpwfp(NULL),
+      m_psdpss(NULL),
+      m_psdpt(NULL),
+      m_psdprw(NULL),
+      m_psdprmf(NULL),
+      m_psdpwpTracks(NULL),
       m_nHangsForError(1),
       m_nThreadPriority(2), // corresponds to tpHighest!
       m_bFile2File(false),
@@ -159,7 +191,11 @@ SoundDllProMain::SoundDllProMain()
       m_nThresholdMode(SDA_THRSHLDMODE_OR),
       m_bAutoCleanup(false),
       m_nBufsizeFile2File(1024),
-      m_nOutChannelsFile2File(2)
+      m_nOutChannelsFile2File(2),
+      m_pvvfTrackIn(NULL),
+      m_pvvfTrackOut(NULL),
+      m_bTrackGainRamp(false),
+      m_nTrackLevelIndex(0)
 {
    if (!IsAudioSpike())
       SetStyle();
@@ -195,6 +231,8 @@ SoundDllProMain::SoundDllProMain()
          #else
          m_pscSoundClass = (SoundClassBase*)(new SoundClassMMDevice());
          #endif
+      else if (GetDriverModel() == DRV_TYPE_NULL)
+         m_pscSoundClass = (SoundClassBase*)(new SoundClassNull());
       else
          m_pscSoundClass = (SoundClassBase*)(new SoundClassAsio());
       // attach all callbacks
@@ -235,6 +273,11 @@ SoundDllProMain::~SoundDllProMain()
    try{Stop(false, false);}catch(...){}
    try{Exit();}catch(...){}
    TRYDELETENULL(m_pfrmTracks);
+   // NOTE: must be deleted after all tracks (and thus all wave files)
+   TRYDELETENULL(m_psdpwfp);
+   TRYDELETENULL(m_psdpss);
+   // NOTE: must be deleted after all record files are closed
+   TRYDELETENULL(m_psdprw);
    TRYDELETENULL(m_pfrmAbout);
    TRYDELETENULL(m_pfrmPerformance);
    TRYDELETENULL(m_pfrmMixer);
@@ -245,8 +288,11 @@ SoundDllProMain::~SoundDllProMain()
    TRYDELETENULL(m_pVSTHostMaster);
    TRYDELETENULL(m_pVSTHostFinal);
    TRYDELETENULL(m_pVSTHostRecord);
+   TRYDELETENULL(m_psdpwpTracks);
    CloseHandle(m_hOnVisualizeDoneEvent);
    TRYDELETENULL(m_pscSoundClass);
+   // NOTE: must be deleted after sound class (i.e. after all writing threads)
+   TRYDELETENULL(m_psdpt);
    if (m_sdpdDebug)
       {
       try
@@ -340,6 +386,29 @@ void SoundDllProMain::Initialize(TStringList *psl)
          if (nWaveReadBufSize < WAVREAD_MINBUFSIZE)
             nWaveReadBufSize = WAVREAD_MINBUFSIZE;
          SDPWaveReader::sm_nWaveReaderBufSize = nWaveReadBufSize;
+         SDPWaveReader::sm_bWaveReaderMapFiles = GetInt(psl, SOUNDDLLPRO_PAR_FILEREADMAP, 1, VAL_POS_OR_ZERO) == 1;
+         int nWaveReadThreads = GetInt(psl, SOUNDDLLPRO_PAR_FILEREADTHREADS, WAVREAD_DEFAULTTHREADS, VAL_POS);
+         if (nWaveReadThreads > WAVREAD_MAXTHREADS)
+            throw Exception("invalid field in 'filereadthreads': must be between 1 and " + IntToStr(WAVREAD_MAXTHREADS));
+         // never use time critical priority for file reading...
+         m_psdpwfp = new SDPWaveFilePool((unsigned int)nWaveReadThreads, 2); // corresponds to tpHighest
+         m_psdpss = new SDPSampleStore();
+         int64_t nRecWriteBufSize = GetInt(psl, SOUNDDLLPRO_PAR_RECWRITEBUFSIZE, RECWRITE_DEFAULTBUFSIZE, VAL_POS_OR_ZERO);
+         if (nRecWriteBufSize > 0)
+            {
+            int nRecWriteBlockSize = (int)GetInt(psl, SOUNDDLLPRO_PAR_RECWRITEBLOCKSIZE, RECWRITE_DEFAULTBLOCKSIZE, VAL_POS);
+            if (nRecWriteBlockSize < RECWRITE_MINBLOCKSIZE || nRecWriteBlockSize > RECWRITE_MAXBLOCKSIZE)
+               throw Exception("invalid field in 'recwriteblocksize': must be between " + IntToStr(RECWRITE_MINBLOCKSIZE) + " and " + IntToStr(RECWRITE_MAXBLOCKSIZE));
+            m_psdprw = new SDPRecWriter((uint64_t)nRecWriteBufSize, (unsigned int)nRecWriteBlockSize);
+            }
+         int nTraceSize = GetInt(psl, SOUNDDLLPRO_PAR_TRACESIZE, 0, VAL_POS_OR_ZERO);
+         if (nTraceSize > 0)
+            {
+            AnsiString strTraceXrunFile = Trim(psl->Values[SOUNDDLLPRO_PAR_TRACEXRUNFILE]);
+            if (!strTraceXrunFile.IsEmpty())
+               strTraceXrunFile = ExpandFileName(strTraceXrunFile);
+            m_psdpt = new SDPTrace((unsigned int)nTraceSize, strTraceXrunFile.c_str());
+            }
 
          int nPriority = HIGH_PRIORITY_CLASS;
          if (!_wcsicmp(psl->Values[SOUNDDLLPRO_PAR_PRIORITY].c_str(), L"normal"))
@@ -465,6 +534,7 @@ void SoundDllProMain::Initialize(TStringList *psl)
             m_vfPendingTrackGain.push_back(1.0f);
             }
          m_vanTrackClipCount.resize(nTracks);
+         m_vnTrackNotify.resize(nTracks);
          m_vanTrackClipCount = 0;
          // initialize mute, solo and applied mute vectors of valarrays
          m_vvabChannelMute.resize(3);
@@ -533,25 +603,33 @@ void SoundDllProMain::Initialize(TStringList *psl)
             tt = TT_SINGLE;
          else if (n == 2)
             tt = TT_FIXNUM;
+         unsigned int nThreads = (unsigned int)GetInt(psl, SOUNDDLLPRO_PAR_VSTTHREADS, 0, VAL_POS_OR_ZERO);
          // NOTE: Changed on 28.01.2011: formely used SoundBufsizeCurrent(),
          // but should be identical!!
          if (nTracks)
             {
             m_pVSTHostTrack   = new TVSTHost("VST-Trackhost", this);
-            m_pVSTHostTrack->Init((unsigned int)nTracks, (unsigned int)nBufSize, tt, nThreadPriority);
+            m_pVSTHostTrack->Init((unsigned int)nTracks, (unsigned int)nBufSize, tt, nThreadPriority, nThreads);
             }
          if (nOutChannels)
             {
             m_pVSTHostMaster  = new TVSTHost("VST-Masterhost", this);
-            m_pVSTHostMaster->Init((unsigned int)nOutChannels, (unsigned int)nBufSize, tt, nThreadPriority);
+            m_pVSTHostMaster->Init((unsigned int)nOutChannels, (unsigned int)nBufSize, tt, nThreadPriority, nThreads);
             m_pVSTHostFinal  = new TVSTHost("VST-Finalhost", this);
-            m_pVSTHostFinal->Init((unsigned int)nOutChannels, (unsigned int)nBufSize, tt, nThreadPriority);
+            m_pVSTHostFinal->Init((unsigned int)nOutChannels, (unsigned int)nBufSize, tt, nThreadPriority, nThreads);
             }
          if (nInChannels)
             {
             m_pVSTHostRecord  = new TVSTHost("VST-Recordhost", this);
-            m_pVSTHostRecord->Init(nInChannels, nBufSize, tt, nThreadPriority);
+            m_pVSTHostRecord->Init(nInChannels, nBufSize, tt, nThreadPriority, nThreads);
             }
+         // worker pool for parallel track processing (pool size includes
+         // processing thread)
+         unsigned int nTrackThreads = (unsigned int)GetInt(psl, SOUNDDLLPRO_PAR_TRACKTHREADS, 0, VAL_POS_OR_ZERO);
+         if (nTrackThreads > SDPWORKERPOOL_MAXTHREADS)
+            throw Exception("invalid field in 'trackthreads': must not exceed " + IntToStr(SDPWORKERPOOL_MAXTHREADS));
+         if (nTrackThreads > 1 && nTracks > 1)
+            m_psdpwpTracks = new SDPWorkerPool(nTrackThreads, (TThreadPriority)((int)tpNormal + nThreadPriority));
 
          // finally attach external processing callbacks
          m_lpfnExtPreVSTProc        = (LPFNEXTSOUNDPROC)((NativeInt)GetInt(psl, SOUNDDLLPRO_PAR_EXTPREVSTPROC, 0, VAL_POS_OR_ZERO));
@@ -588,6 +666,11 @@ void SoundDllProMain::Initialize(TStringList *psl)
       TRYDELETENULL(m_pVSTHostMaster);
       TRYDELETENULL(m_pVSTHostFinal);
       TRYDELETENULL(m_pVSTHostRecord);
+      TRYDELETENULL(m_psdpwpTracks);
+      TRYDELETENULL(m_psdpwfp);
+      TRYDELETENULL(m_psdpss);
+      TRYDELETENULL(m_psdprw);
+      TRYDELETENULL(m_psdpt);
       throw;
       }
 }
@@ -697,6 +780,9 @@ void SoundDllProMain::CreateLocalBuffers(unsigned int nInChannels, unsigned int
    // calculate Seconds available per buffer
    m_dSecondsPerBuffer = (double)SoundBufsizeSamples() / SoundGetSampleRate();
    m_vvfDownSample.resize(nInChannels);
+   // record writer must be able to reserve blocks for all record files
+   if (m_psdprw && !m_bRecFilesDisabled)
+      m_psdprw->Budget(nInChannels);
    unsigned int nChannelIndex;
    for (nChannelIndex = 0; nChannelIndex < nInChannels; nChannelIndex++)
      {
@@ -743,12 +829,14 @@ void SoundDllProMain::Exit()
          TRYDELETENULL(m_vInput[nChannelIndex]);
          }
       m_vInput.clear();
+      TRYDELETENULL(m_psdprmf);
       for (nChannelIndex = 0; nChannelIndex < m_vTracks.size(); nChannelIndex++)
          {
          TRYDELETENULL(m_vTracks[nChannelIndex]);
          }
       m_vTracks.clear();
       m_vvafTrackBuffers.clear();
+      m_vnTrackNotify.clear();
       }
    __finally
       {
@@ -769,8 +857,16 @@ void SoundDllProMain::Start()
    if (!DeviceIsRunning())
       {
       ResetError();
-      for (int i = 0; i < PERF_COUNTER_LAST; i++)
-         m_pcProcess[i].Reset();
+      ResetPerfStages();
+      // count buffers exceeding deadline
+      m_pcProcess[PERF_COUNTER_DSP].SetThreshold(m_dSecondsPerBuffer);
+      m_dRunTime        = 0.0;
+      m_nRunStartTicks  = CPerformanceCounter::GetTicks();
+      m_bRunTimeRunning = true;
+      if (m_psdpwfp)
+         m_psdpwfp->ResetStats();
+      if (m_psdprw)
+         m_psdprw->ResetStats();
       m_vanTrackClipCount  = 0;
 //      m_nLoadPosition      = 0;
 //      m_nBufferDonePosition = 0;
@@ -790,6 +886,8 @@ void SoundDllProMain::Start()
          m_vOutput[nChannelIndex]->Start();
       for (nChannelIndex = 0; nChannelIndex < m_vInput.size(); nChannelIndex++)
          m_vInput[nChannelIndex]->Start();
+      if (m_psdprmf && !m_psdprmf->IsOpen())
+         m_psdprmf->OpenFile();
       for (nChannelIndex = 0; nChannelIndex < m_vTracks.size(); nChannelIndex++)
          m_vTracks[nChannelIndex]->Start();
       m_hwTrackGain.SetState(WINDOWSTATE_UP);
@@ -814,6 +912,7 @@ void SoundDllProMain::Start()
          }
       unsigned int nChannels = (unsigned int)m_vvfBuffersOutFile2File.size();
       bool bEmergencyStop;
+      m_nProcessedBuffers = 0;
       while (1)
          {
          // reset internal dummy data buffer to be passed to processing callbacks
@@ -979,6 +1078,11 @@ void SoundDllProMain::ClearTracks(std::vector<int> viTracks)
 void SoundDllProMain::DoStop(void)
 {
    m_mbMarkButtons.ResetButtons();
+   if (m_bRunTimeRunning)
+      {
+      m_dRunTime = (double)(CPerformanceCounter::GetTicks() - m_nRunStartTicks) / CPerformanceCounter::GetTicksPerSecond();
+      m_bRunTimeRunning = false;
+      }
    // wait until OnVisualizeDone is called with timeout. If it's never called
    // we call OnVisualizeDone by hand to close rec and debug files manually!
    DWORD dw = WaitForSingleObject(&m_hOnVisualizeDoneEvent, 1000);
@@ -1136,12 +1240,14 @@ void SoundDllProMain::OnStateChange(State asState)
 //------------------------------------------------------------------------------
 
 //------------------------------------------------------------------------------
-/// Callback called by sound class on every Xrun. Increases XRun counter
-/// \param[in] xtXrunType type of XRun (not used
+/// Callback called by sound class on every Xrun. Increases XRun counter and
+/// writes xrun to trace (if enabled)
+/// \param[in] xtXrunType type of XRun
 //------------------------------------------------------------------------------
 void SoundDllProMain::OnXrun(XrunType xtXrunType)
 {
    m_vanXrunCounter[xtXrunType]++;
+   SDPTrace::Xrun(xtXrunType == Asio::XR_PROC ? "xrun proc" : (xtXrunType == Asio::XR_DONE ? "xrun done" : "xrun rt"));
 //   OutputDebugString((IntToStr(m_vanXrunCounter.sum()) + " xruns (" + IntToStr(xtXrunType) + ")").c_str());
 }
 //------------------------------------------------------------------------------
@@ -1624,6 +1730,8 @@ std::vector<unsigned int>   SoundDllProMain::GetTrackInputChannels(unsigned int
 //------------------------------------------------------------------------------
 void SoundDllProMain::Process(vvf& vvfBuffersIn, vvf& vvfBuffersOut, bool& bIsLast)
 {
+   SDPTrace::SetBuffer((int64_t)m_nProcessedBuffers);
+   SDPTraceScope sdpts("process");
    // NOTE: we check for clipping on the input channels _before_ any signal
    // processing (i.e. before calling m_lpfnAsioProcess), because we want
    // to detect clipping in A/D-conversion, not in signal processing on the input!
@@ -1733,7 +1841,7 @@ void SoundDllProMain::DoSignalProcessing(vvf &vvfIn, vvf &vvfOut)
          throw Exception("samplerate of device changed to " + FloatToStr((long double)dSampleRate));
       #pragma clang diagnostic pop
       
-      size_t nChannel, nFrame, nTrack, nIndex;
+      size_t nChannel, nTrack, nIndex;
       size_t nChannels     = vvfOut.size();
       size_t nFrames       = (size_t)SoundBufsizeSamples();
       size_t nInChannels   = vvfIn.size();
@@ -1747,6 +1855,7 @@ void SoundDllProMain::DoSignalProcessing(vvf &vvfIn, vvf &vvfOut)
       try
          {
          m_pcProcess[PERF_COUNTER_DSP].Start();
+         SDPTrace::Begin(g_lpcszPerfStageNames[PERF_COUNTER_DSP]);
          // call function to check for start threshold
          if (WaitForThreshold(vvfIn, true))
             return;
@@ -1758,100 +1867,97 @@ void SoundDllProMain::DoSignalProcessing(vvf &vvfIn, vvf &vvfOut)
          if (bDoTrackGainRamp)
             {
             // generate ramp once in ramp buffer
-            for (nFrame = 0; nFrame < nFrames; nFrame++)
-               m_vafTrackGainRamp[nFrame] = m_hwTrackGain.GetValue();
+            m_hwTrackGain.GetValues(&m_vafTrackGainRamp[0], (unsigned int)nFrames);
             // now we check, if ramp is up now (after retrieving ramp values).
             // If so, we have to copy pending gains to real gains _after_ applying
             // this ramp!
             bCopyGains = (m_hwTrackGain.GetState() == WINDOWSTATE_UP);
             }
-         #ifdef PERFORMANCE_TEST
-         m_pcTest[0].Start();
-         #endif
-         // then retrieve track data ...
-         for (nTrack = 0; nTrack < nTracks; nTrack++)
-            {
-            // retrieve buffer from track
-            m_vTracks[nTrack]->GetBuffer(m_vvafTrackBuffers[nTrack]);
-            // if muted, overwrite with zeros
-            if (m_vvabAppliedChannelMute[CT_TRACK][nTrack])
-               m_vvafTrackBuffers[nTrack] = 0.0f;
-            }
-         #ifdef PERFORMANCE_TEST
-         m_pcTest[0].Stop();
-         m_pcTest[1].Start();
-         #endif
-         // call recording VST plugins
-         if (m_pVSTHostRecord)
-            {
-            // call external processing (audiospike)
-            if (!!m_lpfnExtPreRecVSTProc)
-               m_lpfnExtPreRecVSTProc(vvfIn);
-            m_pcProcess[PERF_COUNTER_VSTREC].Start();
-            m_pVSTHostRecord->Process(vvfIn);
-            m_pcProcess[PERF_COUNTER_VSTREC].Stop();
-            // call external processing (audiospike)
-            if (!!m_lpfnExtPostRecVSTProc)
-               m_lpfnExtPostRecVSTProc(vvfIn);
-            }
-         // ... and do I/O copies (add it to track buffer)
-         for (nChannel = 0; nChannel < nInChannels; nChannel++)
-            {
-            // clear muted input channels
-            // IMPORTANT NOTE: this will _not_ mute the input completely, because
-            // CAsio puts recorded data to processing queue _and_ done-queue at
-            // the same time as copy. Thus we here 'mute' only the copy procedure
-            // to the outputs, i.e. we only copy the corresponding input channel
-            // to a track, if it is _not_ muted
-            for (nIndex = 0; nIndex < m_vviIOMapping[nChannel].size(); nIndex++)
-               {
-               if (m_vviIOMapping[nChannel][nIndex] >= (int)nTracks)
-                  throw Exception("internal channel sizing I/O error");
-               if (!m_vvabAppliedChannelMute[CT_INPUT][nChannel])
-                  m_vvafTrackBuffers[(unsigned int)m_vviIOMapping[nChannel][nIndex]] += vvfIn[nChannel];
-               }
-            }
-         #ifdef PERFORMANCE_TEST
-         m_pcTest[1].Stop();
-         #endif
-         // call track VST plugins
-         if (m_pVSTHostTrack)
-            {
-            m_pcProcess[PERF_COUNTER_VSTTRACK].Start();
-            m_pVSTHostTrack->Process(m_vvafTrackBuffers);
-            m_pcProcess[PERF_COUNTER_VSTTRACK].Stop();
-            }
-         // finally apply gain or gain ramp respectively
-         if (bDoTrackGainRamp)
-            {
-            for (nTrack = 0; nTrack < nTracks; nTrack++)
-               m_vvafTrackBuffers[nTrack] *= (m_vafTrackGainRamp*(m_vfPendingTrackGain[nTrack] - m_vfTrackGain[nTrack]) + m_vfTrackGain[nTrack]);
-            // finally copy gains if necessary
-            if (bCopyGains)
-               m_vfTrackGain = m_vfPendingTrackGain;
-            }
-         // simple static gain
+         // render, mix and measure tracks with worker threads ...
+         if (m_psdpwpTracks)
+            DoTrackProcessingParallel(vvfIn, vvfOut, bDoTrackGainRamp, bCopyGains);
+         // ... or serial in this thread
          else
             {
+            #ifdef PERFORMANCE_TEST
+            m_pcTest[0].Start();
+            #endif
+            // then retrieve track data ...
             for (nTrack = 0; nTrack < nTracks; nTrack++)
-               m_vvafTrackBuffers[nTrack] *= m_vfTrackGain[nTrack];
-            }
-         // Now add or multiply up and store levels (maximum)
-         unsigned int n = (unsigned int)(m_nLoadPosition / (unsigned int)SoundBufsizeSamples() % (unsigned int)m_nNumTrackLevels);
-         float fMax;
-         for (nTrack = 0; nTrack < nTracks; nTrack++)
-            {
-            fMax = ArrayAbsMax(m_vvafTrackBuffers[nTrack]);
-            // store maxima for visualization
-            if (n < m_vvfTrackLevel.size())
-               m_vvfTrackLevel[n][nTrack] = fMax;
-            if (fMax > 1.0f)
-               m_vanTrackClipCount[nTrack]++;
-            // add/multiply up the tracks to the output channels
-            if (m_vTracks[nTrack]->Multiply())
-               vvfOut[m_vTracks[nTrack]->ChannelIndex()] *= m_vvafTrackBuffers[nTrack];
+               {
+               // retrieve buffer from track
+               m_vTracks[nTrack]->GetBuffer(m_vvafTrackBuffers[nTrack]);
+               // if muted, overwrite with zeros
+               if (m_vvabAppliedChannelMute[CT_TRACK][nTrack])
+                  m_vvafTrackBuffers[nTrack] = 0.0f;
+               }
+            #ifdef PERFORMANCE_TEST
+            m_pcTest[0].Stop();
+            m_pcTest[1].Start();
+            #endif
+            // call recording VST plugins
+            ProcessRecordVST(vvfIn);
+            // ... and do I/O copies (add it to track buffer)
+            for (nChannel = 0; nChannel < nInChannels; nChannel++)
+               {
+               // clear muted input channels
+               // IMPORTANT NOTE: this will _not_ mute the input completely, because
+               // CAsio puts recorded data to processing queue _and_ done-queue at
+               // the same time as copy. Thus we here 'mute' only the copy procedure
+               // to the outputs, i.e. we only copy the corresponding input channel
+               // to a track, if it is _not_ muted
+               for (nIndex = 0; nIndex < m_vviIOMapping[nChannel].size(); nIndex++)
+                  {
+                  if (m_vviIOMapping[nChannel][nIndex] >= (int)nTracks)
+                     throw Exception("internal channel sizing I/O error");
+                  if (!m_vvabAppliedChannelMute[CT_INPUT][nChannel])
+                     m_vvafTrackBuffers[(unsigned int)m_vviIOMapping[nChannel][nIndex]] += vvfIn[nChannel];
+                  }
+               }
+            #ifdef PERFORMANCE_TEST
+            m_pcTest[1].Stop();
+            #endif
+            // call track VST plugins
+            if (m_pVSTHostTrack)
+               {
+               m_pcProcess[PERF_COUNTER_VSTTRACK].Start();
+               SDPTrace::Begin(g_lpcszPerfStageNames[PERF_COUNTER_VSTTRACK]);
+               m_pVSTHostTrack->Process(m_vvafTrackBuffers);
+               SDPTrace::End(g_lpcszPerfStageNames[PERF_COUNTER_VSTTRACK]);
+               m_pcProcess[PERF_COUNTER_VSTTRACK].Stop();
+               }
+            // finally apply gain or gain ramp respectively
+            if (bDoTrackGainRamp)
+               {
+               for (nTrack = 0; nTrack < nTracks; nTrack++)
+                  m_vvafTrackBuffers[nTrack] *= (m_vafTrackGainRamp*(m_vfPendingTrackGain[nTrack] - m_vfTrackGain[nTrack]) + m_vfTrackGain[nTrack]);
+               // finally copy gains if necessary
+               if (bCopyGains)
+                  m_vfTrackGain = m_vfPendingTrackGain;
+               }
+            // simple static gain
             else
-               vvfOut[m_vTracks[nTrack]->ChannelIndex()] += m_vvafTrackBuffers[nTrack];
+               {
+               for (nTrack = 0; nTrack < nTracks; nTrack++)
+                  m_vvafTrackBuffers[nTrack] *= m_vfTrackGain[nTrack];
+               }
+            // Now add or multiply up and store levels (maximum)
+            unsigned int n = (unsigned int)(m_nLoadPosition / (unsigned int)SoundBufsizeSamples() % (unsigned int)m_nNumTrackLevels);
+            float fMax;
+            for (nTrack = 0; nTrack < nTracks; nTrack++)
+               {
+               fMax = ArrayAbsMax(m_vvafTrackBuffers[nTrack]);
+               // store maxima for visualization
+               if (n < m_vvfTrackLevel.size())
+                  m_vvfTrackLevel[n][nTrack] = fMax;
+               if (fMax > 1.0f)
+                  m_vanTrackClipCount[nTrack]++;
+               // add/multiply up the tracks to the output channels
+               if (m_vTracks[nTrack]->Multiply())
+                  vvfOut[m_vTracks[nTrack]->ChannelIndex()] *= m_vvafTrackBuffers[nTrack];
+               else
+                  vvfOut[m_vTracks[nTrack]->ChannelIndex()] += m_vvafTrackBuffers[nTrack];
+               }
             }
          // call external processing (audiospike)
          if (!!m_lpfnExtPreVSTProc)
@@ -1861,21 +1967,27 @@ void SoundDllProMain::DoSignalProcessing(vvf &vvfIn, vvf &vvfOut)
          if (m_pVSTHostMaster)
             {
             m_pcProcess[PERF_COUNTER_VSTMASTER].Start();
+            SDPTrace::Begin(g_lpcszPerfStageNames[PERF_COUNTER_VSTMASTER]);
             m_pVSTHostMaster->Process(vvfOut);
+            SDPTrace::End(g_lpcszPerfStageNames[PERF_COUNTER_VSTMASTER]);
             m_pcProcess[PERF_COUNTER_VSTMASTER].Stop();
             }
          // pass buffers to MATLAB plugin ....
          if (m_pMPlugin)
             {
             m_pcProcess[PERF_COUNTER_ML].Start();
+            SDPTrace::Begin(g_lpcszPerfStageNames[PERF_COUNTER_ML]);
             m_pMPlugin->Process(vvfIn, vvfOut);
+            SDPTrace::End(g_lpcszPerfStageNames[PERF_COUNTER_ML]);
             m_pcProcess[PERF_COUNTER_ML].Stop();
             }
          #ifndef FINALVST_ONPLAY
          if (m_pVSTHostFinal)
             {
             m_pcProcess[PERF_COUNTER_VSTMASTER].Start();
+            SDPTrace::Begin(g_lpcszPerfStageNames[PERF_COUNTER_VSTMASTER]);
             m_pVSTHostFinal->Process(vvfOut);
+            SDPTrace::End(g_lpcszPerfStageNames[PERF_COUNTER_VSTMASTER]);
             m_pcProcess[PERF_COUNTER_VSTMASTER].Stop();
             }
          #endif
@@ -1892,6 +2004,7 @@ void SoundDllProMain::DoSignalProcessing(vvf &vvfIn, vvf &vvfOut)
          }
       __finally
          {
+         SDPTrace::End(g_lpcszPerfStageNames[PERF_COUNTER_DSP]);
          m_pcProcess[PERF_COUNTER_DSP].Stop();
          LeaveCriticalSection(&m_csProcess);
          }
@@ -1909,6 +2022,162 @@ void SoundDllProMain::DoSignalProcessing(vvf &vvfIn, vvf &vvfOut)
 }
 //------------------------------------------------------------------------------
 
+//------------------------------------------------------------------------------
+/// calls recording VST plugins and external processing before and after them
+//------------------------------------------------------------------------------
+void SoundDllProMain::ProcessRecordVST(vvf &vvfIn)
+{
+   if (m_pVSTHostRecord)
+      {
+      // call external processing (audiospike)
+      if (!!m_lpfnExtPreRecVSTProc)
+         m_lpfnExtPreRecVSTProc(vvfIn);
+      m_pcProcess[PERF_COUNTER_VSTREC].Start();
+      SDPTrace::Begin(g_lpcszPerfStageNames[PERF_COUNTER_VSTREC]);
+      m_pVSTHostRecord->Process(vvfIn);
+      SDPTrace::End(g_lpcszPerfStageNames[PERF_COUNTER_VSTREC]);
+      m_pcProcess[PERF_COUNTER_VSTREC].Stop();
+      // call external processing (audiospike)
+      if (!!m_lpfnExtPostRecVSTProc)
+         m_lpfnExtPostRecVSTProc(vvfIn);
+      }
+}
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+/// track part of DoSignalProcessing using the track worker pool:
+/// - call recording VST plugins
+/// - retrieve track data, apply track mute and add input data (one job per
+///   track)
+/// - send data notifications collected by the jobs
+/// - call track VST plugins
+/// - apply track gain, store levels and add or multiply tracks to output
+///   channels (one job per output channel)
+/// Each job only writes data of its own track or output channel and the tracks
+/// of a channel are processed in track order, so the result is identical to
+/// the serial processing in DoSignalProcessing
+/// NOTE: called within m_csProcess
+//------------------------------------------------------------------------------
+void SoundDllProMain::DoTrackProcessingParallel(vvf &vvfIn, vvf &vvfOut, bool bDoTrackGainRamp, bool bCopyGains)
+{
+   size_t nChannel, nIndex, nTrack;
+   size_t nTracks       = m_vTracks.size();
+   size_t nChannels     = vvfOut.size();
+   if (m_vnTrackNotify.size() != nTracks)
+      throw Exception("sizing error 2");
+   // check I/O mapping here: jobs should not fail on sizing errors
+   for (nChannel = 0; nChannel < m_vviIOMapping.size(); nChannel++)
+      {
+      for (nIndex = 0; nIndex < m_vviIOMapping[nChannel].size(); nIndex++)
+         {
+         if (m_vviIOMapping[nChannel][nIndex] >= (int)nTracks)
+            throw Exception("internal channel sizing I/O error");
+         }
+      }
+   // call recording VST plugins first: track jobs add processed input data
+   ProcessRecordVST(vvfIn);
+   // retrieve track data
+   m_pvvfTrackIn = &vvfIn;
+   m_psdpwpTracks->Run(RenderTrackJob, (unsigned int)nTracks);
+   // data notifications were collected by the jobs: send them from here
+   for (nTrack = 0; nTrack < nTracks; nTrack++)
+      {
+      for (nIndex = 0; nIndex < m_vnTrackNotify[nTrack]; nIndex++)
+         m_lpfnExtDataNotify();
+      }
+   // call track VST plugins (host uses its own threading)
+   if (m_pVSTHostTrack)
+      {
+      m_pcProcess[PERF_COUNTER_VSTTRACK].Start();
+      SDPTrace::Begin(g_lpcszPerfStageNames[PERF_COUNTER_VSTTRACK]);
+      m_pVSTHostTrack->Process(m_vvafTrackBuffers);
+      SDPTrace::End(g_lpcszPerfStageNames[PERF_COUNTER_VSTTRACK]);
+      m_pcProcess[PERF_COUNTER_VSTTRACK].Stop();
+      }
+   // sort tracks to output channels. NOTE: inner vectors keep their capacity,
+   // so no allocation here after first buffer
+   if (m_vvnChannelTracks.size() != nChannels)
+      m_vvnChannelTracks.resize(nChannels);
+   for (nChannel = 0; nChannel < nChannels; nChannel++)
+      m_vvnChannelTracks[nChannel].clear();
+   for (nTrack = 0; nTrack < nTracks; nTrack++)
+      {
+      nChannel = m_vTracks[nTrack]->ChannelIndex();
+      if (nChannel < nChannels)
+         m_vvnChannelTracks[nChannel].push_back((unsigned int)nTrack);
+      }
+   // apply gains, store levels and mix tracks to output channels
+   m_pvvfTrackOut       = &vvfOut;
+   m_bTrackGainRamp     = bDoTrackGainRamp;
+   m_nTrackLevelIndex   = (unsigned int)(m_nLoadPosition / (unsigned int)SoundBufsizeSamples() % (unsigned int)m_nNumTrackLevels);
+   m_psdpwpTracks->Run(MixChannelJob, (unsigned int)nChannels);
+   // finally copy gains if necessary
+   if (bCopyGains)
+      m_vfTrackGain = m_vfPendingTrackGain;
+}
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+/// job for track worker pool: retrieves data of one track, applies mute and
+/// adds input data mapped to the track (in input channel order)
+//------------------------------------------------------------------------------
+void SoundDllProMain::RenderTrackJob(unsigned int nTrack)
+{
+   m_vnTrackNotify[nTrack] = 0;
+   // retrieve buffer from track
+   m_vTracks[nTrack]->GetBuffer(m_vvafTrackBuffers[nTrack], &m_vnTrackNotify[nTrack]);
+   // if muted, overwrite with zeros
+   if (m_vvabAppliedChannelMute[CT_TRACK][nTrack])
+      m_vvafTrackBuffers[nTrack] = 0.0f;
+   // add input channels mapped to this track (see DoSignalProcessing for
+   // muted input channels)
+   vvf& vvfIn = *m_pvvfTrackIn;
+   for (size_t nChannel = 0; nChannel < m_vviIOMapping.size(); nChannel++)
+      {
+      if (m_vvabAppliedChannelMute[CT_INPUT][nChannel])
+         continue;
+      for (size_t nIndex = 0; nIndex < m_vviIOMapping[nChannel].size(); nIndex++)
+         {
+         if (m_vviIOMapping[nChannel][nIndex] == (int)nTrack)
+            m_vvafTrackBuffers[nTrack] += vvfIn[nChannel];
+         }
+      }
+}
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+/// job for track worker pool: applies gain (or gain ramp) to all tracks of
+/// one output channel, stores their levels and adds or multiplies them to the
+/// output channel
+//------------------------------------------------------------------------------
+void SoundDllProMain::MixChannelJob(unsigned int nChannel)
+{
+   vvf& vvfOut = *m_pvvfTrackOut;
+   std::vector<unsigned int>& vnTracks = m_vvnChannelTracks[nChannel];
+   unsigned int nTrack;
+   float fMax;
+   for (unsigned int n = 0; n < vnTracks.size(); n++)
+      {
+      nTrack = vnTracks[n];
+      if (m_bTrackGainRamp)
+         m_vvafTrackBuffers[nTrack] *= (m_vafTrackGainRamp*(m_vfPendingTrackGain[nTrack] - m_vfTrackGain[nTrack]) + m_vfTrackGain[nTrack]);
+      else
+         m_vvafTrackBuffers[nTrack] *= m_vfTrackGain[nTrack];
+      fMax = ArrayAbsMax(m_vvafTrackBuffers[nTrack]);
+      // store maxima for visualization
+      if (m_nTrackLevelIndex < m_vvfTrackLevel.size())
+         m_vvfTrackLevel[m_nTrackLevelIndex][nTrack] = fMax;
+      if (fMax > 1.0f)
+         m_vanTrackClipCount[nTrack]++;
+      // add/multiply up the track to the output channel
+      if (m_vTracks[nTrack]->Multiply())
+         vvfOut[nChannel] *= m_vvafTrackBuffers[nTrack];
+      else
+         vvfOut[nChannel] += m_vvafTrackBuffers[nTrack];
+      }
+}
+//------------------------------------------------------------------------------
+
 //------------------------------------------------------------------------------
 /// Called by sound class: Visualization, saving to files and polling of data
 /// from MATLAB
@@ -1916,6 +2185,7 @@ void SoundDllProMain::DoSignalProcessing(vvf &vvfIn, vvf &vvfOut)
 #pragma argsused
 void SoundDllProMain::OnBufferDone(vvf& vvfBuffersIn, vvf& vvfBuffersOut, bool& bIsLast)
 {
+   SDPTraceScope sdpts("bufferdone");
    #ifdef VIS_DEBUG
    int nStep = 0;
    #endif
@@ -2002,6 +2272,7 @@ void SoundDllProMain::OnBufferDone(vvf& vvfBuffersIn, vvf& vvfBuffersOut, bool&
                   }
                }
             m_pcProcess[PERF_COUNTER_REC].Start();
+            SDPTrace::Begin(g_lpcszPerfStageNames[PERF_COUNTER_REC]);
             // call function to check for record threshold
             bool bSaveToFile = !WaitForThreshold(vvfBuffersIn, false);
             vvf* pBuffers = &vvfBuffersIn;
@@ -2031,9 +2302,12 @@ void SoundDllProMain::OnBufferDone(vvf& vvfBuffersIn, vvf& vvfBuffersOut, bool&
             // now pass buffer to for saving
             for (nChannel = 0; nChannel < nChannels; nChannel++)
                m_vInput[nChannel]->SaveBuffer((*pBuffers)[nChannel], bSaveToFile);
+            if (bSaveToFile && m_psdprmf)
+               m_psdprmf->WriteBuffers(*pBuffers);
             // call external processing (if any)
             if (!!m_lpfnExtDoneProc)
                m_lpfnExtDoneProc(*pBuffers);
+            SDPTrace::End(g_lpcszPerfStageNames[PERF_COUNTER_REC]);
             m_pcProcess[PERF_COUNTER_REC].Stop();
             #ifdef VIS_DEBUG
             nStep++;
@@ -2182,7 +2456,9 @@ void SoundDllProMain::OnBufferPlay(vvf& vvfBuffer)
       if (m_pVSTHostFinal)
          {
          m_pcProcess[PERF_COUNTER_VSTMASTER].Start();
+         SDPTrace::Begin(g_lpcszPerfStageNames[PERF_COUNTER_VSTMASTER]);
          m_pVSTHostFinal->Process(vvfBuffer);
+         SDPTrace::End(g_lpcszPerfStageNames[PERF_COUNTER_VSTMASTER]);
          m_pcProcess[PERF_COUNTER_VSTMASTER].Stop();
          }
       #endif
@@ -2251,6 +2527,8 @@ void SoundDllProMain::OnStopComplete()
          m_vOutput[nChannelIndex]->Stop();
       for (nChannelIndex = 0; nChannelIndex < m_vInput.size(); nChannelIndex++)
          m_vInput[nChannelIndex]->Stop();
+      if (m_psdprmf)
+         m_psdprmf->CloseFile();
       for (nChannelIndex = 0; nChannelIndex < m_vTracks.size(); nChannelIndex++)
          m_vTracks[nChannelIndex]->Stop();
       if (m_pVSTHostTrack)
@@ -2342,6 +2620,60 @@ void SoundDllProMain::SetRecDownSampleFactor(unsigned int n)
 }
 //------------------------------------------------------------------------------
 
+//------------------------------------------------------------------------------
+/// sets file for writing a group of input channels interleaved to one file.
+/// The channels of the group are not written to their own record files. An
+/// empty filename switches back to one file per channel
+//------------------------------------------------------------------------------
+void SoundDllProMain::RecMultiFile(AnsiString strFileName, const std::vector<int> &viChannels)
+{
+   if (DeviceIsRunning())
+      throw Exception("cannot set multichannel record file while device is running");
+   if (m_bRecFilesDisabled)
+      throw Exception("recording to files is disabled");
+
+   std::vector<unsigned int> vnChannels;
+   unsigned int n;
+   if (!strFileName.IsEmpty())
+      {
+      if (viChannels.empty())
+         throw Exception("no channels specified for multichannel record file");
+      for (n = 0; n < viChannels.size(); n++)
+         {
+         if (viChannels[n] < 0 || (unsigned int)viChannels[n] >= m_vInput.size())
+            throw Exception("invalid channel for multichannel record file");
+         vnChannels.push_back((unsigned int)viChannels[n]);
+         }
+      }
+
+   for (n = 0; n < m_vInput.size(); n++)
+      m_vInput[n]->RecMultiFile(false);
+   TRYDELETENULL(m_psdprmf);
+   if (strFileName.IsEmpty())
+      return;
+
+   long lLatency  = 0;
+   if (m_bRecCompensateLatency &&  m_nRecDownSampleFactor == 1)
+      lLatency = (SoundGetLatency(Asio::INPUT) + SoundGetLatency(Asio::OUTPUT));
+   m_psdprmf = new SDPRecMultiFile( (unsigned int)SoundGetSampleRate()/m_nRecDownSampleFactor,
+                                    vnChannels,
+                                    (uint64_t)lLatency,
+                                    (unsigned int)SoundBufsizeSamples()/m_nRecDownSampleFactor);
+   m_psdprmf->FileName(strFileName);
+   for (n = 0; n < vnChannels.size(); n++)
+      m_vInput[vnChannels[n]]->RecMultiFile(true);
+}
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+/// returns interleaved record file (NULL if not set)
+//------------------------------------------------------------------------------
+SDPRecMultiFile* SoundDllProMain::RecMultiFile()
+{
+   return m_psdprmf;
+}
+//------------------------------------------------------------------------------
+
 //------------------------------------------------------------------------------
 /// Builds a vector with all track indices and calls IsPlaying(vector)
 //------------------------------------------------------------------------------
@@ -3121,6 +3453,109 @@ std::valarray<unsigned int>& SoundDllProMain::GetXruns()
    return m_vanXrunCounter;
 }
 //------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+/// returns performance counter of a stage PERF_COUNTER_* or PERF_STAGE_*
+//------------------------------------------------------------------------------
+CPerformanceCounter& SoundDllProMain::PerfStage(unsigned int nStage)
+{
+   if (nStage < PERF_COUNTER_LAST)
+      return m_pcProcess[nStage];
+   else if (nStage == PERF_STAGE_CALLBACK)
+      return m_pscSoundClass->m_pcCallback;
+   else if (nStage == PERF_STAGE_QUEUEWAIT)
+      return m_pscSoundClass->m_pcQueueWait;
+   throw Exception("invalid performance stage");
+}
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+/// resets performance counters of all stages. May be called while device is
+/// running
+//------------------------------------------------------------------------------
+void SoundDllProMain::ResetPerfStages()
+{
+   for (unsigned int n = 0; n < PERF_STAGE_LAST; n++)
+      PerfStage(n).Reset();
+}
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+/// returns JSON object with statistics of one performance counter in
+/// milliseconds. Percentiles are read from histogram of counter
+//------------------------------------------------------------------------------
+static AnsiString PerfCounterToJson(CPerformanceCounter &pc)
+{
+   uint64_t nCount = pc.Count();
+   AnsiString str = "{\"count\":" + IntToStr((int64_t)nCount);
+   str += ",\"mean_ms\":" + DoubleToStr(nCount ? 1000.0*pc.Sum()/(double)nCount : 0.0, "%.4lf");
+   const double   adPercentile[]    = {0.5, 0.9, 0.99, 0.999};
+   const char*    alpcszName[]      = {"p50_ms", "p90_ms", "p99_ms", "p999_ms"};
+   for (unsigned int n = 0; n < 4; n++)
+      str += ",\"" + AnsiString(alpcszName[n]) + "\":" + DoubleToStr(1000.0*pc.Percentile(adPercentile[n]), "%.4lf");
+   str += ",\"max_ms\":" + DoubleToStr(1000.0*pc.MaxValue(), "%.4lf") + "}";
+   return str;
+}
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+/// \brief returns performance report of current or last run as JSON object:
+/// per buffer processing times of all performance stages, buffers missing
+/// the buffer deadline (DSP time exceeding buffer duration), realtime factors,
+/// xruns and peak memory of the process
+/// \retval JSON string (single line)
+//------------------------------------------------------------------------------
+AnsiString SoundDllProMain::GetPerformanceReport()
+{
+   AnsiString strDriver;
+   if (m_bFile2File)
+      strDriver = "file2file";
+   else if (GetDriverModel() == DRV_TYPE_WDM)
+      strDriver = "wdm";
+   else if (GetDriverModel() == DRV_TYPE_NULL)
+      strDriver = "null";
+   else
+      strDriver = "asio";
+
+   // elapsed wall clock time: if still running current time. NOTE: computed
+   // from start ticks, so nothing is changed by the command thread here
+   double dElapsed = m_bRunTimeRunning
+                   ? (double)(CPerformanceCounter::GetTicks() - m_nRunStartTicks) / CPerformanceCounter::GetTicksPerSecond()
+                   : m_dRunTime;
+   double dAudio   = (double)m_nProcessedBuffers * m_dSecondsPerBuffer;
+   double dDsp     = m_pcProcess[PERF_COUNTER_DSP].Sum();
+
+   AnsiString str = "{\"drivermodel\":\"" + strDriver + "\"";
+   str += ",\"samplerate\":" + DoubleToStr(SoundGetSampleRate(), "%.0lf");
+   str += ",\"bufsize\":" + IntToStr((int)SoundBufsizeSamples());
+   str += ",\"deadline_ms\":" + DoubleToStr(1000.0*m_dSecondsPerBuffer, "%.4lf");
+   str += ",\"channels\":{\"output\":" + IntToStr((int)m_vOutput.size())
+        + ",\"input\":" + IntToStr((int)m_vInput.size())
+        + ",\"tracks\":" + IntToStr((int)m_vTracks.size()) + "}";
+   str += ",\"buffers\":" + IntToStr((int64_t)m_nProcessedBuffers);
+   str += ",\"elapsed_s\":" + DoubleToStr(dElapsed, "%.4lf");
+   str += ",\"realtime_factor\":" + DoubleToStr(dElapsed > 0.0 ? dAudio / dElapsed : 0.0, "%.4lf");
+   str += ",\"dsp_realtime_factor\":" + DoubleToStr(dDsp > 0.0 ? dAudio / dDsp : 0.0, "%.4lf");
+   str += ",\"deadline_misses\":" + IntToStr((int64_t)m_pcProcess[PERF_COUNTER_DSP].AboveThreshold());
+   str += ",\"xruns\":{\"proc\":" + IntToStr((int)m_vanXrunCounter[Asio::XR_PROC])
+        + ",\"done\":" + IntToStr((int)m_vanXrunCounter[Asio::XR_DONE])
+        + ",\"rt\":" + IntToStr((int)m_vanXrunCounter[Asio::XR_RT]) + "}";
+   PROCESS_MEMORY_COUNTERS pmc;
+   ZeroMemory(&pmc, sizeof(pmc));
+   GetProcessMemoryInfo(GetCurrentProcess(), &pmc, sizeof(pmc));
+   str += ",\"peak_memory\":{\"workingset\":" + IntToStr((int64_t)pmc.PeakWorkingSetSize)
+        + ",\"pagefile\":" + IntToStr((int64_t)pmc.PeakPagefileUsage) + "}";
+   str += ",\"stages\":{";
+   for (unsigned int n = 0; n < PERF_STAGE_LAST; n++)
+      {
+      if (n)
+         str += ",";
+      str += "\"" + AnsiString(g_lpcszPerfStageNames[n]) + "\":" + PerfCounterToJson(PerfStage(n));
+      }
+   str += "}}";
+   return str;
+}
+//------------------------------------------------------------------------------
 //------------------------------------------------------------------------------
 /// \brief sets current ramp length in milliseconds
 /// \param[in] f ramp length in milliseconds
@@ -3183,13 +3618,23 @@ void SoundDllProMain::ApplyRamp(vvf & vvfBuffers, CHanningWindow &hw)
       if (vvfBuffers[nChannel].size() != nFrames)
          throw Exception("fatal channel size (frame number) error in "  + UnicodeString(__FUNC__));
       }
-   float f;
-   for (nFrame = 0; nFrame < nFrames; ++nFrame)
-      {
-      f = hw.GetValue();
+   // retrieve ramp values blockwise to local buffer and apply them to all
+   // channels. NOTE: local buffer is used, because function is called from
+   // different threads
+   float afRamp[SDP_RAMPBLOCKSIZE];
+   float* pf;
+   unsigned int nBlock, n;
+   for (nFrame = 0; nFrame < nFrames; nFrame += nBlock)
+      {
+      nBlock = nFrames - nFrame;
+      if (nBlock > SDP_RAMPBLOCKSIZE)
+         nBlock = SDP_RAMPBLOCKSIZE;
+      hw.GetValues(afRamp, nBlock);
       for (nChannel = 0; nChannel < nChannels; ++nChannel)
          {
-         vvfBuffers[nChannel][nFrame] *= f;
+         pf = &vvfBuffers[nChannel][nFrame];
+         for (n = 0; n < nBlock; n++)
+            pf[n] *= afRamp[n];
          }
       }
 }
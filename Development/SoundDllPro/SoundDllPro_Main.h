@@ -49,8 +49,11 @@
 #include "VSTHost.h"
 #include "SoundDllPro_SoundClassBase.h"
 #include "SoundDllPro_Debug.h"
+#include "SoundDllPro_WorkerPool.h"
 //------------------------------------------------------------------------------
 #define SoundClass()             SoundDllProMain::Instance()
+/// block size for retrieving ramp values in SoundDllProMain::ApplyRamp
+#define SDP_RAMPBLOCKSIZE        256
 #ifdef PERFORMANCE_TEST
    #define NUM_TESTCOUNTER       10
 #endif
@@ -79,12 +82,24 @@ enum {
 };
 //------------------------------------------------------------------------------
 
+//------------------------------------------------------------------------------
+/// enumeration of all stages with performance histograms: processing counters
+/// PERF_COUNTER_* followed by counters of sound class
+//------------------------------------------------------------------------------
+enum {
+   PERF_STAGE_CALLBACK = PERF_COUNTER_LAST,
+   PERF_STAGE_QUEUEWAIT,
+   PERF_STAGE_LAST
+};
+extern const char* g_lpcszPerfStageNames[PERF_STAGE_LAST];
+
 //------------------------------------------------------------------------------
 /// enumeration of driver models
 //------------------------------------------------------------------------------
 enum TSoundDriverModel {
    DRV_TYPE_ASIO = 0,
-   DRV_TYPE_WDM
+   DRV_TYPE_WDM,
+   DRV_TYPE_NULL
 };
 //------------------------------------------------------------------------------
 
@@ -116,6 +131,11 @@ class TTracksForm;
 class TMixerForm;
 class TPerformanceForm;
 class TMPlugin;
+class SDPWaveFilePool;
+class SDPSampleStore;
+class SDPTrace;
+class SDPRecWriter;
+class SDPRecMultiFile;
 //------------------------------------------------------------------------------
 
 //------------------------------------------------------------------------------
@@ -190,6 +210,8 @@ class SoundDllProMain
       uint64_t          GetBufferPlayPosition();
       unsigned int      GetRecDownSampleFactor();
       void              SetRecDownSampleFactor(unsigned int n);
+      void              RecMultiFile(AnsiString strFileName, const std::vector<int> &viChannels);
+      SDPRecMultiFile*  RecMultiFile();
       AnsiString        GetVSTProperties();
       bool              AsyncError(AnsiString &str);
       void              ResetError();
@@ -250,6 +272,9 @@ class SoundDllProMain
       void                 ResetClipCount();
       const std::valarray<unsigned int>& GetTrackClipCount();
       std::valarray<unsigned int>& GetXruns();
+      AnsiString        GetPerformanceReport();
+      CPerformanceCounter& PerfStage(unsigned int nStage);
+      void              ResetPerfStages();
       void              SetRampLength(float f);
       void              ApplyRamp(vvf & vvfBuffers, CHanningWindow &hw);
    protected:
@@ -265,6 +290,10 @@ class SoundDllProMain
       bool              m_bRecFilesDisabled;   ///< global flag for sisabling recfiles
       void              Process(vvf& vvfBuffersIn, vvf& vvfBuffersOut, bool& bIsLast);
       void              DoSignalProcessing(vvf &vvfIn, vvf &vvfOut);
+      void              DoTrackProcessingParallel(vvf &vvfIn, vvf &vvfOut, bool bDoTrackGainRamp, bool bCopyGains);
+      void              RenderTrackJob(unsigned int nTrack);
+      void              MixChannelJob(unsigned int nChannel);
+      void              ProcessRecordVST(vvf &vvfIn);
       void              OnBufferDone(vvf& vvfBuffersIn, vvf& vvfBuffersOut, bool& bIsLast);
       void              OnBufferPlay(vvf& vvfBuffer);
       bool              WaitForThreshold(vvf& vvfBuffersIn, bool bStart);
@@ -288,12 +317,21 @@ class SoundDllProMain
       std::vector<float >  m_vfInputGain;          /// vector containing volume for each input channel
 
       std::valarray<unsigned int> m_vanXrunCounter; ///< counters for xruns
+      int64_t              m_nRunStartTicks;       ///< ticks (see CPerformanceCounter::GetTicks) at last start
+      double               m_dRunTime;             ///< wall clock time in seconds of last run
+      volatile bool        m_bRunTimeRunning;      ///< flag if run time is measured
       std::vector<std::vector<unsigned int> >  m_vvnClipCount;     ///< vector containing clipcounts
       std::vector<std::vector<float> > m_vvfClipThreshold;        ///< vector containing normalized clip threshold
       TVSTHost*         m_pVSTHostTrack;  // VST-Host for track plugins
       TVSTHost*         m_pVSTHostMaster; // VST-Host for master plugins
       TVSTHost*         m_pVSTHostFinal; // VST-Host for 'final' master plugins
       TVSTHost*         m_pVSTHostRecord; // VST-Host for masterecording plugins
+      SDPWaveFilePool*  m_psdpwfp;        // pool of threads reading wave files
+      SDPSampleStore*   m_psdpss;         // store of sample data shared between loaded vectors
+      SDPTrace*         m_psdpt;          // event trace ring (NULL: tracing disabled)
+      SDPRecWriter*     m_psdprw;         // asynchronous writer for record files (NULL: synchronous writing)
+      SDPRecMultiFile*  m_psdprmf;        // interleaved record file for a group of input channels (NULL: one file per channel)
+      SDPWorkerPool*    m_psdpwpTracks;   // worker pool for parallel track processing (NULL: serial)
       unsigned int      m_nHangsForError;      ///< number of hangs that yield an error
       int               m_nThreadPriority;
       bool              m_bFile2File;
@@ -343,6 +381,14 @@ class SoundDllProMain
 
       std::valarray<float> m_vafTrackGainRamp;     /// buffer for calculating ramp values for track gains
       std::vector<std::valarray<float> >  m_vvafTrackBuffers;
+      // variables for parallel track processing: set by DoTrackProcessingParallel
+      // for the jobs of the current buffer
+      vvf*              m_pvvfTrackIn;          /// input buffers of current buffer
+      vvf*              m_pvvfTrackOut;         /// output buffers of current buffer
+      bool              m_bTrackGainRamp;       /// flag if track gain ramp is to be applied
+      unsigned int      m_nTrackLevelIndex;     /// index in m_vvfTrackLevel for current buffer
+      std::vector<unsigned int>  m_vnTrackNotify;  /// data notifications collected by track jobs
+      std::vector<std::vector<unsigned int> >  m_vvnChannelTracks;   /// tracks per output channel
       void              InitializeMPlugin(TStringList *psl);
       void              DoButtonMarking(int64_t nSamplePosition);
 };
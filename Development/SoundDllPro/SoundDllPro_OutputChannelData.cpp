@@ -32,9 +32,11 @@
 //------------------------------------------------------------------------------
 #include <vcl.h>
 #include <objbase.h>
+#include <algorithm>
 #pragma hdrstop
 #include "SoundDllPro_OutputChannelData.h"
 #include "SoundDllPro_WaveReader_libsndfile.h"
+#include "SoundDllPro_SampleStore.h"
 #include "SoundDllPro_Main.h"
 
 //------------------------------------------------------------------------------
@@ -62,6 +64,8 @@ SDPOD_AUDIO& SDPOD_AUDIO::operator=(const SDPOD_AUDIO& r)
    bLoopCrossfade    = r.bLoopCrossfade;
    nCrossfadeLengthLeft    = r.nCrossfadeLengthLeft;
    nCrossfadeLengthRight   = r.nCrossfadeLengthRight;
+   psdpwf                  = r.psdpwf;
+   psdpsb                  = r.psdpsb;
    return *this;
 }
 //------------------------------------------------------------------------------
@@ -74,9 +78,14 @@ SDPOutputData::SDPOutputData(SDPOD_AUDIO &rsdpod, SDPOutputData* psdop)
       m_bIsInUse(false),
       m_bReady(false),
       m_psdpwr(NULL),
+      m_psdpsb(NULL),
       m_nPosition(0),
       m_nTotalPosition(0),
-      m_nSingleLoopSamples((unsigned int)rsdpod.nNumSamples)
+      m_nSingleLoopSamples((unsigned int)rsdpod.nNumSamples),
+      m_pfRampTable(NULL),
+      m_pfLoopRampTable(NULL),
+      m_pfCrossfadeLeftTable(NULL),
+      m_pfCrossfadeRightTable(NULL)
  {
    if (!SoundClass())
       throw Exception("invalid global SoundClass instance");
@@ -84,12 +93,27 @@ SDPOutputData::SDPOutputData(SDPOD_AUDIO &rsdpod, SDPOutputData* psdop)
    // check constraints that are identical for file AND mem
    if (!!m_sdopAudio.nOffset && !!m_sdopAudio.nCrossfadeLengthLeft)
       throw Exception("offset must not be specified if crossfade length is != 0");
-   if (m_sdopAudio.bIsFile)
-      InitializeFileWav();
-   else
-      InitializeMemWav(psdop);
-   SetPosition(0);
-   m_strID = InitializeGUID();
+   try
+      {
+      if (m_sdopAudio.bIsFile)
+         InitializeFileWav();
+      else
+         InitializeMemWav(psdop);
+      SetPosition(0);
+      m_strID = InitializeGUID();
+      }
+   catch (...)
+      {
+      // destructor is not called on exception in constructor
+      if (m_psdpsb)
+         {
+         m_psdpsb->Release();
+         m_psdpsb = NULL;
+         }
+      TRYDELETENULL(m_psdpwr);
+      ReleaseRamps();
+      throw;
+      }
    m_bIsInUse = true;
 }
 //------------------------------------------------------------------------------
@@ -100,26 +124,30 @@ SDPOutputData::SDPOutputData(SDPOD_AUDIO &rsdpod, SDPOutputData* psdop)
 //------------------------------------------------------------------------------
 void SDPOutputData::InitializeMemWav(SDPOutputData* psdop)
 {
-   m_vafBuffer.resize((unsigned int)m_nSingleLoopSamples);
    // check start offset (applied only for first loop!
    if (m_sdopAudio.nStartOffset >= m_nSingleLoopSamples - m_sdopAudio.nLoopRampLenght)
       throw Exception("start offset exceeds vector length - loopramp length");
-   // read data
-   // - if a 'source' SDPOutputData was passed, then we copy the buffer
-   // from the source
+   // get data (read only, data blocks are never changed after creation)
+   // - if a 'source' SDPOutputData was passed, then we share the block
+   // of the source
    if (!!psdop)
-      m_vafBuffer = psdop->m_vafBuffer;
-   // otherwise data are passed from MATLAB in m_sdopAudio.pData
-   else
       {
-      unsigned int nSample;
-      // NOTE: data are non-interleaved in pData!!!
-      m_sdopAudio.pData += m_nSingleLoopSamples*m_sdopAudio.nChannelIndex;
-      for (nSample = 0; nSample < m_nSingleLoopSamples; nSample++)
-         {
-         m_vafBuffer[nSample] = (float)*m_sdopAudio.pData++;
-         }
+      m_psdpsb = psdop->m_psdpsb;
+      m_psdpsb->AddRef();
+      }
+   // - if a shared block was passed (from sample store) we use it
+   else if (!!m_sdopAudio.psdpsb)
+      {
+      m_psdpsb = m_sdopAudio.psdpsb;
+      m_psdpsb->AddRef();
       }
+   // otherwise data are passed from MATLAB in m_sdopAudio.pData
+   // NOTE: data are non-interleaved in pData!!!
+   else
+      m_psdpsb = new SDPSampleBlock(m_sdopAudio.pData + m_nSingleLoopSamples*m_sdopAudio.nChannelIndex, m_nSingleLoopSamples);
+   // a shared block is used only on initialization: copies of this instance
+   // share it through m_psdpsb
+   m_sdopAudio.psdpsb = NULL;
    bool bCrossfade = m_sdopAudio.nLoopRampLenght && m_sdopAudio.bLoopCrossfade;
    m_nPosition = (uint64_t)m_sdopAudio.nStartOffset;
    // NOTE: Loopcount 0 must ALWAYS lead to total length of 0 (endless!!!)
@@ -141,12 +169,9 @@ void SDPOutputData::InitializeMemWav(SDPOutputData* psdop)
       m_vafCrossfadeBuffer.resize((unsigned int)m_sdopAudio.nLoopRampLenght);
       unsigned int n;
       for (n = 0; n < m_sdopAudio.nLoopRampLenght; n++)
-         {
-         if (!g_bUseRamps)
-            m_vafCrossfadeBuffer[n] = m_vafBuffer[n];
-         else
-            m_vafCrossfadeBuffer[n] = m_vafBuffer[n] * GetHanningRamp(n, m_sdopAudio.nLoopRampLenght, true);
-         }
+         m_vafCrossfadeBuffer[n] = m_psdpsb->m_vafData[n];
+      if (g_bUseRamps)
+         MultiplyRamp(&m_vafCrossfadeBuffer[0], 0, m_sdopAudio.nLoopRampLenght, m_sdopAudio.nLoopRampLenght, true);
       }
 }
 //------------------------------------------------------------------------------
@@ -161,10 +186,11 @@ void SDPOutputData::InitializeFileWav()
    unsigned int nMinBufsize = (unsigned int)SoundClass()->SoundBufsizeSamples() * SoundClass()->GetQueueNumBufs();
    m_psdpwr = new SDPWaveReader( m_sdopAudio,
                                  (unsigned int)SoundClass()->SoundGetSampleRate(),
-                                 nMinBufsize,
-                                 // never use time critical priority for file reading...
-                                 tpHighest // SoundClass()->ThreadPriority()
+                                 nMinBufsize
                                  );
+   // a shared file instance is used only on initialization: copies of this
+   // instance (e.g. for painting) must use an own one
+   m_sdopAudio.psdpwf = NULL;
 
    // NOTE: start offset and crossfade length is handled by file itself and _not_ to
    // be subtracted here
@@ -182,24 +208,20 @@ void SDPOutputData::InitializeFileWav()
       // but neglect startoffset!!
       SDPOD_AUDIO sdpod = m_sdopAudio;
       sdpod.nStartOffset = 0;
+      sdpod.psdpwf       = NULL;
       SDPWaveReader* psdpwr = NULL;
       try
          {
          psdpwr = new SDPWaveReader( sdpod,
                                     (unsigned int)SoundClass()->SoundGetSampleRate(),
-                                    nMinBufsize,
-                                    // never use time critical priority for file reading...
-                                    tpHighest // SoundClass()->ThreadPriority()
+                                    nMinBufsize
                                     );
          psdpwr->SetPosition(0);
          unsigned int n;
          for (n = 0; n < m_sdopAudio.nLoopRampLenght; n++)
-            {
-            if (!g_bUseRamps)
-               m_vafCrossfadeBuffer[n] = psdpwr->GetFileSample();
-            else
-               m_vafCrossfadeBuffer[n] = psdpwr->GetFileSample() * GetHanningRamp(n, m_sdopAudio.nLoopRampLenght, true);
-            }
+            m_vafCrossfadeBuffer[n] = psdpwr->GetFileSample();
+         if (g_bUseRamps)
+            MultiplyRamp(&m_vafCrossfadeBuffer[0], 0, m_sdopAudio.nLoopRampLenght, m_sdopAudio.nLoopRampLenght, true);
          }
       __finally
          {
@@ -224,6 +246,32 @@ void SDPOutputData::InitializeRamps()
       throw Exception("loop ramp lengths must not exceed 1000000 samples in crossfade mode");
    if (m_sdopAudio.nCrossfadeLengthLeft > m_nTotalLength/2)
       throw Exception("crossfade length must not exceed half of total playback length of object");
+   // retrieve shared hanning tables for ramp lengths. NOTE: right crossfade
+   // length is usually set later by SDPTrack (see SetCrossfadeLengthRight)
+   if (m_sdopAudio.nRampLenght)
+      m_pfRampTable = AcquireHanningTable(m_sdopAudio.nRampLenght);
+   if (m_sdopAudio.nLoopRampLenght)
+      m_pfLoopRampTable = AcquireHanningTable(m_sdopAudio.nLoopRampLenght);
+   if (m_sdopAudio.nCrossfadeLengthLeft)
+      m_pfCrossfadeLeftTable = AcquireHanningTable(m_sdopAudio.nCrossfadeLengthLeft);
+   if (m_sdopAudio.nCrossfadeLengthRight)
+      m_pfCrossfadeRightTable = AcquireHanningTable(m_sdopAudio.nCrossfadeLengthRight);
+}
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+/// releases shared hanning tables
+//------------------------------------------------------------------------------
+void SDPOutputData::ReleaseRamps()
+{
+   ReleaseHanningTable(m_pfRampTable);
+   m_pfRampTable = NULL;
+   ReleaseHanningTable(m_pfLoopRampTable);
+   m_pfLoopRampTable = NULL;
+   ReleaseHanningTable(m_pfCrossfadeLeftTable);
+   m_pfCrossfadeLeftTable = NULL;
+   ReleaseHanningTable(m_pfCrossfadeRightTable);
+   m_pfCrossfadeRightTable = NULL;
 }
 //------------------------------------------------------------------------------
 
@@ -245,9 +293,14 @@ AnsiString SDPOutputData::InitializeGUID()
 //------------------------------------------------------------------------------
 SDPOutputData::~SDPOutputData()
 {
-   m_vafBuffer.resize(0);
+   if (m_psdpsb)
+      {
+      m_psdpsb->Release();
+      m_psdpsb = NULL;
+      }
    m_vafCrossfadeBuffer.resize(0);
    TRYDELETENULL(m_psdpwr);
+   ReleaseRamps();
 }
 //------------------------------------------------------------------------------
 
@@ -269,14 +322,14 @@ void SDPOutputData::SetPosition(uint64_t nPosition)
       // only used in the very first loop (later the crossfade buffer
       // is used for adding up). Thus we have to check, if we are within
       // the first loop
-      if (nPosition < (uint64_t)(m_vafBuffer.size() - (uint64_t)m_sdopAudio.nStartOffset))
+      if (nPosition < (uint64_t)(m_psdpsb->m_vafData.size() - (uint64_t)m_sdopAudio.nStartOffset))
          m_nPosition = (uint64_t)(m_sdopAudio.nStartOffset) + nPosition;
       else
          {
-         nPosition -= (uint64_t)(m_vafBuffer.size() - (uint64_t)m_sdopAudio.nStartOffset);
-         // afterwards we have to set position modulo m_vafBuffer.size() - m_vafCrossfadeBuffer.size() and
+         nPosition -= (uint64_t)(m_psdpsb->m_vafData.size() - (uint64_t)m_sdopAudio.nStartOffset);
+         // afterwards we have to set position modulo m_psdpsb->m_vafData.size() - m_vafCrossfadeBuffer.size() and
          // add m_vafCrossfadeBuffer.size() (first samples used from crossfade-buffer!
-         m_nPosition = (nPosition % (m_vafBuffer.size()- m_vafCrossfadeBuffer.size())) + m_vafCrossfadeBuffer.size();
+         m_nPosition = (nPosition % (m_psdpsb->m_vafData.size()- m_vafCrossfadeBuffer.size())) + m_vafCrossfadeBuffer.size();
          }
       // OutputDebugStringW(("M_pos: " + IntToStr((int)m_nPosition)).w_str());
       }
@@ -326,14 +379,14 @@ float SDPOutputData::GetSample(bool bNoRamp)
       }
    else                                            
       {
-      unsigned int nSize      = (unsigned int)m_vafBuffer.size();
+      unsigned int nSize      = (unsigned int)m_psdpsb->m_vafData.size();
       // anything to play?
       if (!nSize || !m_bIsInUse)
          throw Exception("trying to retrieve sample from empty or 'not-in-use' SDPOutputData");
       uLoopPosition = m_nPosition;
       // get value. NOTE: m_nPosition is only incremented and checked in this function,
       // so we don't check on function entry!
-      fValue = m_vafBuffer[(unsigned int)m_nPosition++];
+      fValue = m_psdpsb->m_vafData[(unsigned int)m_nPosition++];
       // check for loop of main buffer
       if (m_nPosition >= nSize)
          {
@@ -354,17 +407,19 @@ float SDPOutputData::GetSample(bool bNoRamp)
       if (m_sdopAudio.nRampLenght && !bNoRamp)
          {
          // ramp up?
+         // NOTE: ramp values are read from shared hanning tables (see
+         // GetHanningRamp): down ramp value at pos is up ramp value at len-pos
          if (m_nTotalPosition <= m_sdopAudio.nRampLenght)
-            fValue *= GetHanningRamp((unsigned int)m_nTotalPosition, m_sdopAudio.nRampLenght, true);
+            fValue *= m_pfRampTable[(unsigned int)m_nTotalPosition];
          // ramp down?
          else if (RemainingLength() <= m_sdopAudio.nRampLenght)
-            fValue *= GetHanningRamp((unsigned int)(m_sdopAudio.nRampLenght - RemainingLength()), m_sdopAudio.nRampLenght, false);
+            fValue *= m_pfRampTable[(unsigned int)RemainingLength()];
          }
       // crossfade ramps
       if (m_sdopAudio.nCrossfadeLengthLeft && !bNoRamp && m_nTotalPosition <= m_sdopAudio.nCrossfadeLengthLeft)
-         fValue *= GetHanningRamp((unsigned int)m_nTotalPosition, m_sdopAudio.nCrossfadeLengthLeft, true);
+         fValue *= m_pfCrossfadeLeftTable[(unsigned int)m_nTotalPosition];
       if (m_sdopAudio.nCrossfadeLengthRight && !bNoRamp && RemainingLength() <= m_sdopAudio.nCrossfadeLengthRight)
-         fValue *= GetHanningRamp((unsigned int)(m_sdopAudio.nCrossfadeLengthRight - RemainingLength()), m_sdopAudio.nCrossfadeLengthRight, false);
+         fValue *= m_pfCrossfadeRightTable[(unsigned int)RemainingLength()];
       }
    // apply looping ramp
    if (m_sdopAudio.nLoopRampLenght)
@@ -379,7 +434,7 @@ float SDPOutputData::GetSample(bool bNoRamp)
          && (m_nTotalPosition) > m_sdopAudio.nLoopRampLenght)
          {
          if (g_bUseRamps)
-            fValue *= GetHanningRamp((unsigned int)uLoopPosition, m_sdopAudio.nLoopRampLenght, true);
+            fValue *= m_pfLoopRampTable[(unsigned int)uLoopPosition];
          }
       // loop ramp down?
       // NOTE: is NOT done in the end, as well as adding up crossfade value!
@@ -388,7 +443,7 @@ float SDPOutputData::GetSample(bool bNoRamp)
          {
          unsigned int nPos = m_sdopAudio.nLoopRampLenght - (unsigned int)(m_nSingleLoopSamples - uLoopPosition);
          if (g_bUseRamps)
-            fValue *= GetHanningRamp(nPos, m_sdopAudio.nLoopRampLenght, false);
+            fValue *= m_pfLoopRampTable[m_sdopAudio.nLoopRampLenght - nPos];
          if (m_vafCrossfadeBuffer.size())
             fValue += m_vafCrossfadeBuffer[nPos];
          }
@@ -398,6 +453,133 @@ float SDPOutputData::GetSample(bool bNoRamp)
 }
 //------------------------------------------------------------------------------
 
+//------------------------------------------------------------------------------
+/// returns number of subsequent samples (max. nMaxSamples) starting at current
+/// position, that are 'plain' samples, i.e. where GetSample would neither apply
+/// any ramp, loop ramp or crossfade nor reach a loop boundary or the end of
+/// data. Returns 0, if next sample has to be retrieved by GetSample
+//------------------------------------------------------------------------------
+unsigned int SDPOutputData::GetPlainSegmentLength(unsigned int nMaxSamples)
+{
+   uint64_t nPlain      = nMaxSamples;
+   uint64_t nTotalPos   = m_nTotalPosition;
+   bool     bEndless    = !m_nTotalLength;
+   uint64_t nLoopPos;
+
+   // last sample of data is always retrieved by GetSample (resets 'in-use'-flag)
+   if (!bEndless)
+      {
+      if (nTotalPos + 1 >= m_nTotalLength)
+         return 0;
+      nPlain = std::min(nPlain, m_nTotalLength - nTotalPos - 1);
+      }
+   if (m_sdopAudio.bIsFile)
+      nLoopPos = m_psdpwr->GetLoopPosition();
+   else
+      {
+      // last sample of buffer is always retrieved by GetSample (loop handling)
+      uint64_t nSize = (uint64_t)m_psdpsb->m_vafData.size();
+      if (m_nPosition + 1 >= nSize)
+         return 0;
+      nPlain   = std::min(nPlain, nSize - m_nPosition - 1);
+      nLoopPos = m_nPosition;
+      }
+   // 'regular' ramps and crossfade ramps (see GetSample)
+   if (g_bUseRamps)
+      {
+      // ramp up and left crossfade are applied, while total position (after
+      // increment) is <= ramp length
+      if (nTotalPos < m_sdopAudio.nRampLenght || nTotalPos < m_sdopAudio.nCrossfadeLengthLeft)
+         return 0;
+      // ramp down and right crossfade are applied, if RemainingLength() (after
+      // increment) is <= ramp length. NOTE: never in endless loops
+      if (!bEndless)
+         {
+         uint64_t nRampDown = std::max(m_sdopAudio.nRampLenght, m_sdopAudio.nCrossfadeLengthRight);
+         uint64_t nRemaining = m_nTotalLength - nTotalPos - 1;
+         if (nRemaining <= nRampDown)
+            return 0;
+         nPlain = std::min(nPlain, nRemaining - nRampDown);
+         }
+      }
+   // loop ramps (see GetSample): NOTE: checked independent from g_bUseRamps,
+   // because crossfade buffer is added in loop ramp down
+   uint64_t nLoopRamp = m_sdopAudio.nLoopRampLenght;
+   if (nLoopRamp)
+      {
+      if (nLoopPos < nLoopRamp)
+         {
+         // loop ramp up is applied in all but the very first loop
+         if (nTotalPos >= nLoopRamp)
+            return 0;
+         nPlain = std::min(nPlain, std::min(nLoopRamp - nLoopPos, nLoopRamp - nTotalPos));
+         }
+      else if (nLoopPos + nLoopRamp >= m_nSingleLoopSamples)
+         {
+         // loop ramp down is skipped only at the very end of data
+         if (bEndless || m_nTotalLength - nTotalPos - 1 > nLoopRamp - 1)
+            return 0;
+         nPlain = std::min(nPlain, m_nSingleLoopSamples - nLoopPos);
+         }
+      else
+         nPlain = std::min(nPlain, m_nSingleLoopSamples - nLoopRamp - nLoopPos);
+      }
+   return (unsigned int)nPlain;
+}
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+/// writes up to nSamples samples to passed buffer with results identical to
+/// calling GetSample() nSamples times. Request is split into segments: plain
+/// segments (no ramps, loop boundaries or crossfades) are copied and scaled
+/// with data-gain in a tight loop, all other samples are retrieved by GetSample.
+/// Returns number of samples written, which is less than nSamples, if data
+/// are done (not 'in use' any longer)
+//------------------------------------------------------------------------------
+unsigned int SDPOutputData::RenderBlock(float* pfBuffer, unsigned int nSamples)
+{
+   unsigned int nDone = 0;
+   unsigned int nPlain, n;
+   float fGain = m_sdopAudio.fGain;
+   while (nDone < nSamples && m_bIsInUse)
+      {
+      nPlain = GetPlainSegmentLength(nSamples - nDone);
+      if (nPlain && m_sdopAudio.bIsFile)
+         {
+         try
+            {
+            // NOTE: reader may return less samples than requested (end of its
+            // current read buffer): then next sample is retrieved by GetSample
+            nPlain = m_psdpwr->GetFileSamples(&pfBuffer[nDone], nPlain);
+            }
+         catch (Exception &e)
+            {
+            throw Exception("unexpected exception when retrieving file samples: " + e.Message + " (" + AnsiString(e.ClassName()) + ")");
+            }
+         float* pf = &pfBuffer[nDone];
+         for (n = 0; n < nPlain; n++)
+            pf[n] *= fGain;
+         }
+      else if (nPlain)
+         {
+         const float* pfSrc = &m_psdpsb->m_vafData[(unsigned int)m_nPosition];
+         float* pf = &pfBuffer[nDone];
+         for (n = 0; n < nPlain; n++)
+            pf[n] = pfSrc[n]*fGain;
+         m_nPosition += nPlain;
+         }
+      if (nPlain)
+         {
+         m_nTotalPosition  += nPlain;
+         nDone             += nPlain;
+         }
+      else
+         pfBuffer[nDone++] = GetSample();
+      }
+   return nDone;
+}
+//------------------------------------------------------------------------------
+
 //------------------------------------------------------------------------------
 /// returns true, if data to be played in endless loop or false else
 //------------------------------------------------------------------------------
@@ -446,6 +628,21 @@ void SDPOutputData::SetGlobalPosition(uint64_t nGlobalPosition)
 }
 //------------------------------------------------------------------------------
 
+//------------------------------------------------------------------------------
+/// sets length of right crossfade (left crossfade length of the following
+/// object) and retrieves it's hanning table, so that GetSample never has to
+/// look up or calculate a table. NOTE: table is set before length, because
+/// the object may be played already
+//------------------------------------------------------------------------------
+void SDPOutputData::SetCrossfadeLengthRight(unsigned int nLength)
+{
+   const float* pfTable = m_pfCrossfadeRightTable;
+   m_pfCrossfadeRightTable = nLength ? AcquireHanningTable(nLength) : NULL;
+   m_sdopAudio.nCrossfadeLengthRight = nLength;
+   ReleaseHanningTable(pfTable);
+}
+//------------------------------------------------------------------------------
+
 //------------------------------------------------------------------------------
 /// returns either filename or data name
 //------------------------------------------------------------------------------
@@ -38,6 +38,8 @@
 #include <stdint.h>
 #include <valarray>
 class SDPWaveReader;
+class SDPWaveFile;
+class SDPSampleBlock;
 //------------------------------------------------------------------------------
 // base class (struct) for audio data
 //------------------------------------------------------------------------------
@@ -60,7 +62,9 @@ public:
       nLoopRampLenght(0),
       bLoopCrossfade(false),
       nCrossfadeLengthLeft(0),
-      nCrossfadeLengthRight(0)
+      nCrossfadeLengthRight(0),
+      psdpwf(NULL),
+      psdpsb(NULL)
       {;}
    // = operator
    SDPOD_AUDIO& operator=(const SDPOD_AUDIO& r);              
@@ -89,6 +93,10 @@ public:
    // crossfade value between subsequent (!) SDPOD_AUDIO objects
    unsigned int  nCrossfadeLengthLeft;    // length of left crossfade ramp
    unsigned int  nCrossfadeLengthRight;   // length of right crossfade ramp
+   // file instance shared by all channels of one loaded file (NULL: use own instance)
+   SDPWaveFile*  psdpwf;
+   // shared sample data block (NULL: convert pData to own block)
+   SDPSampleBlock* psdpsb;
 };
 //------------------------------------------------------------------------------
 //------------------------------------------------------------------------------
@@ -105,12 +113,14 @@ class SDPOutputData
       SDPOutputData(SDPOD_AUDIO &rsdpod, SDPOutputData* psdop = NULL);
       ~SDPOutputData();
       float                GetSample(bool bNoRamp = false);
+      unsigned int         RenderBlock(float* pfBuffer, unsigned int nSamples);
       bool                 IsEndlessLoop();
       uint64_t             TotalLength();
       uint64_t             RemainingLength();
       unsigned int         LengthSingleLoop();
       void                 Offset(unsigned int nOffset);
       void                 SetGlobalPosition(uint64_t nGlobalPosition);
+      void                 SetCrossfadeLengthRight(unsigned int nLength);
       void                 SetPosition(uint64_t nPosition = 0);
       uint64_t             GetPosition();
       AnsiString           Name();
@@ -124,17 +134,23 @@ class SDPOutputData
       uint64_t             GetTotalLength();
    private:
       SDPWaveReader*       m_psdpwr;
-      std::valarray<float> m_vafBuffer;
+      SDPSampleBlock*      m_psdpsb;                  /// (shared) sample data of memory type
       std::valarray<float> m_vafCrossfadeBuffer;
       uint64_t             m_nPosition;
       uint64_t             m_nTotalLength;
       uint64_t             m_nTotalPosition;
       unsigned int         m_nSingleLoopSamples;
+      const float*         m_pfRampTable;             /// shared hanning table for ramp
+      const float*         m_pfLoopRampTable;         /// shared hanning table for loop ramp
+      const float*         m_pfCrossfadeLeftTable;    /// shared hanning table for left crossfade
+      const float*         m_pfCrossfadeRightTable;   /// shared hanning table for right crossfade
       AnsiString           m_strID;
       void                 InitializeMemWav(SDPOutputData* psdop);
       void                 InitializeFileWav();
       void                 InitializeRamps();
+      void                 ReleaseRamps();
       AnsiString           InitializeGUID();
+      unsigned int         GetPlainSegmentLength(unsigned int nMaxSamples);
 };
 //------------------------------------------------------------------------------
 #endif
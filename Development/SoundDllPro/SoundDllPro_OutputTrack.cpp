@@ -170,7 +170,7 @@ SDPOutputData* SDPTrack::LoadAudio(SDPOD_AUDIO& rsdpod)
       // copy left crossfade length from current object to right crossfade length
       // of last loaded object - if any
       if (psdpodTmp)
-         psdpodTmp->m_sdopAudio.nCrossfadeLengthRight = rsdpod.nCrossfadeLengthLeft;
+         psdpodTmp->SetCrossfadeLengthRight(rsdpod.nCrossfadeLengthLeft);
       // if no object before available, the rest left crossfade length of new object to 0
       // since it does not make sense!
       else
@@ -223,9 +223,14 @@ uint64_t SDPTrack::NumTrackSamples()
 //------------------------------------------------------------------------------
 
 //------------------------------------------------------------------------------
-/// writes audio data from track to passed valarray
+/// writes audio data from track to passed valarray. Data are rendered blockwise
+/// by SDPOutputData::RenderBlock, only samples at transitions between
+/// subsequent SDPOutputData instances (start positions, crossfades, end of data)
+/// are handled samplewise. If pnNotify is not NULL, data notifications are not
+/// sent but counted in *pnNotify to be sent later by the caller (used if
+/// called from a worker thread)
 //------------------------------------------------------------------------------
-void SDPTrack::GetBuffer(std::valarray<float>& vafBuffer)
+void SDPTrack::GetBuffer(std::valarray<float>& vafBuffer, unsigned int* pnNotify)
 {
    EnterCriticalSection(&m_csLock);
    uint64_t nPos = SoundClass()->GetLoadPosition();
@@ -237,45 +242,78 @@ void SDPTrack::GetBuffer(std::valarray<float>& vafBuffer)
          vafBuffer = 0.0f;
 
       unsigned int nSamples = (unsigned int)vafBuffer.size();
-      for (unsigned int n = 0; n < nSamples; n++,nPos++)
+      unsigned int n = 0;
+      unsigned int nBlock;
+      uint64_t     nRemaining;
+      while (n < nSamples)
          {
          if (m_psdpod[1] && m_psdpod[1]->m_bReady)
             {
+            m_nDataUnderrunPos = -1;
             // check if we have reached startposition of audio snippet at all
             // (otherwise play zero (or one for mutiplying track, see above)
-            if (nPos > m_psdpod[1]->GetGlobalPosition())
+            if (nPos <= m_psdpod[1]->GetGlobalPosition())
+               {
+               nBlock = nSamples - n;
+               if (m_psdpod[1]->GetGlobalPosition() - nPos + 1 < nBlock)
+                  nBlock = (unsigned int)(m_psdpod[1]->GetGlobalPosition() - nPos + 1);
+               n     += nBlock;
+               nPos  += nBlock;
+               continue;
+               }
+            // if we have a crossfade between different SDPOutputData and
+            // are within the crossfade ramp, then we have to retrieve a sample
+            // from the next (!!) buffer and add it up: done samplewise
+            nBlock = nSamples - n;
+            if (  m_psdpod[1]->m_sdopAudio.nCrossfadeLengthRight
+               && m_psdpod[1]->m_psdpodNext
+               )
+               {
+               nRemaining = m_psdpod[1]->RemainingLength();
+               if (nRemaining <= m_psdpod[1]->m_sdopAudio.nCrossfadeLengthRight)
+                  nBlock = 0;
+               else if (nRemaining - m_psdpod[1]->m_sdopAudio.nCrossfadeLengthRight < nBlock)
+                  nBlock = (unsigned int)(nRemaining - m_psdpod[1]->m_sdopAudio.nCrossfadeLengthRight);
+               }
+            if (nBlock)
+               nBlock = m_psdpod[1]->RenderBlock(&vafBuffer[n], nBlock);
+            if (nBlock)
+               {
+               n     += nBlock;
+               nPos  += nBlock;
+               }
+            else
                {
                vafBuffer[n] = m_psdpod[1]->GetSample();
-
-               // if we have a crossfade between different SDPOutputData and
-               // are within the crossfade ramp, then we have to retrieve a sample
-               // from the next (!!) buffer and add it up
                if (  m_psdpod[1]->m_sdopAudio.nCrossfadeLengthRight
                   && m_psdpod[1]->m_psdpodNext
                   && m_psdpod[1]->RemainingLength() < m_psdpod[1]->m_sdopAudio.nCrossfadeLengthRight
                   )
                   vafBuffer[n] += m_psdpod[1]->m_psdpodNext->GetSample();
-
-
-
-
-               // if not in use any longer, then it's done: set current data
-               // pointer to next
-               if (!m_psdpod[1]->m_bIsInUse)
+               n++;
+               nPos++;
+               }
+            // if not in use any longer, then it's done: set current data
+            // pointer to next
+            if (!m_psdpod[1]->m_bIsInUse)
+               {
+               if (m_bNotify)
                   {
-                  if (m_bNotify)
+                  if (pnNotify)
+                     (*pnNotify)++;
+                  else
                      SoundClass()->m_lpfnExtDataNotify();
-
-                  m_psdpod[1] = m_psdpod[1]->m_psdpodNext;
                   }
+
+               m_psdpod[1] = m_psdpod[1]->m_psdpodNext;
                }
-            m_nDataUnderrunPos = -1;
             }
          else
             {
-            m_nDataUnderrun++;
+            m_nDataUnderrun += nSamples - n;
             if (m_nDataUnderrunPos == -1)
                m_nDataUnderrunPos = (int64_t)nPos;
+            break;
             }
          }
       }
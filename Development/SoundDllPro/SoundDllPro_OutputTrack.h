@@ -63,7 +63,7 @@ class SDPTrack
       void           Multiply(bool bMultiply);
       bool           AutoCleanup();
       void           AutoCleanup(bool bAutoCleanup);
-      void           GetBuffer(std::valarray<float>& vafBuffer);
+      void           GetBuffer(std::valarray<float>& vafBuffer, unsigned int* pnNotify = NULL);
       void           SetPosition(uint64_t nPosition = 0);
       AnsiString     Name(void);
       void           Name(AnsiString strName);
@@ -1,8 +1,10 @@
 //------------------------------------------------------------------------------
 /// \file SoundDllPro_RecFile.cpp
 /// \author Berg
-/// \brief Implementation of classes SDPRecFile and PCMWaveFileHeader.
-/// Simple classes to write a normalized 32bit float mono PCM wave file
+/// \brief Implementation of classes SDPRecFile, PCMWaveFileHeader and
+/// SDPRecWriter. Simple classes to write a normalized 32bit float mono PCM
+/// wave file. Data are written asynchronously in large blocks by the writer
+/// thread of SDPRecWriter (if created)
 ///
 /// Project SoundMexPro
 /// Module  SoundDllPro.dll
@@ -28,6 +30,7 @@
 ///    along with SoundMexPro.  If not, see <http:///www.gnu.org/licenses/>.
 ///
 //------------------------------------------------------------------------------
+#include <limits.h>
 #include "SoundDllPro_RecFile.h"
 #ifndef TRYDELETENULL
    #define TRYDELETENULL(p) {if (p!=NULL) { try {delete p;} catch (...){;} p = NULL;}}
@@ -44,10 +47,17 @@ SDPRecFile::SDPRecFile( unsigned int nSampleRate,
    :  m_pfs(NULL),
       m_nSampleRate(nSampleRate),
       m_nChannelIndex(nChannelIndex),
+      m_wChannels(1),
       m_bEnabled(bEnabled),
       m_nRecLength(0),
       m_nSamplesToIgnore(nIgnoreSamples),
-      m_nIgnoreSamples(nIgnoreSamples)
+      m_nIgnoreSamples(nIgnoreSamples),
+      m_nSamples(0),
+      m_psdprw(NULL),
+      m_bSyncWriter(false),
+      m_psdprb(NULL),
+      m_nPendingBlocks(0),
+      m_nWriteError(0)
 {
 }
 //------------------------------------------------------------------------------
@@ -58,7 +68,15 @@ SDPRecFile::SDPRecFile( unsigned int nSampleRate,
 SDPRecFile::~SDPRecFile()
 {
    if (m_pfs)
-      CloseFile();
+      {
+      try
+         {
+         CloseFile();
+         }
+      catch (...)
+         {
+         }
+      }
    TRYDELETENULL(m_pfs);
 }
 //------------------------------------------------------------------------------
@@ -138,8 +156,18 @@ void SDPRecFile::OpenFile()
       // reset latenty compensation
       m_nIgnoreSamples = m_nSamplesToIgnore;
       m_pfs = new TFileStream(m_usFileName, fmCreate | fmShareDenyWrite);
-      m_wfh.SetWaveFormat(1, m_nSampleRate, 32, 3);
+      m_wfh.SetWaveFormat(m_wChannels, m_nSampleRate, 32, 3);
       m_pfs->WriteBuffer((const void*)&m_wfh, sizeof(PCMWaveFileHeader));
+      m_nSamples        = 0;
+      m_nWriteError     = 0;
+      m_usWriteError    = "";
+      m_psdprw          = SDPRecWriter::Instance();
+      // write synchronously, if no blocks can be reserved for the file
+      if (m_psdprw && !m_psdprw->Attach())
+         {
+         m_psdprw       = NULL;
+         m_bSyncWriter  = true;
+         }
       }
    catch (Exception &e)
       {
@@ -160,8 +188,9 @@ void SDPRecFile::OpenFile(UnicodeString usFileName)
 //------------------------------------------------------------------------------
 
 //------------------------------------------------------------------------------
-/// Writes current correct size informations to PCMWaveHeader of file and closes
-/// file
+/// Writes all pending data, writes current correct size informations to
+/// PCMWaveHeader of file and closes file. The header is written even if
+/// writing of pending data failed
 //------------------------------------------------------------------------------
 void SDPRecFile::CloseFile()
 {
@@ -169,13 +198,21 @@ void SDPRecFile::CloseFile()
       {
       try
          {
-         m_wfh.SetDataSize_Byte((DWORD)(m_pfs->Size - (DWORD)sizeof(PCMWaveFileHeader)));
-         m_pfs->Seek(0, soFromBeginning);
-         m_pfs->WriteBuffer((const void*)&m_wfh, sizeof(PCMWaveFileHeader));
+         try
+            {
+            Flush(false);
+            }
+         __finally
+            {
+            m_wfh.SetDataSize_Byte((uint64_t)(m_pfs->Size - (int64_t)sizeof(PCMWaveFileHeader)));
+            m_pfs->Seek(0, soFromBeginning);
+            m_pfs->WriteBuffer((const void*)&m_wfh, sizeof(PCMWaveFileHeader));
+            }
          }
       __finally
          {
          TRYDELETENULL(m_pfs);
+         DetachWriter();
          }
       }
 }
@@ -199,24 +236,36 @@ void SDPRecFile::WriteBuffer(std::valarray<float> &vaf)
    if (!m_bEnabled || !m_pfs)
       return;
 
-   unsigned int nNumSamples = (unsigned int)vaf.size();
-   unsigned int nReadPos = 0;
-
+   unsigned int nReadPos;
+   unsigned int nNumSamples = SamplesToWrite((unsigned int)vaf.size(), nReadPos);
+   if (!nNumSamples)
+      return;
+   Write(&vaf[nReadPos], (unsigned int)(nNumSamples*sizeof(float)));
+   m_nSamples += nNumSamples;
+}
+//------------------------------------------------------------------------------
 
+//------------------------------------------------------------------------------
+/// applies latency compensation and record length to a buffer with
+/// nNumSamples samples (frames). Returns number of samples to write and sets
+/// nReadPos to the first sample to write
+//------------------------------------------------------------------------------
+unsigned int SDPRecFile::SamplesToWrite(unsigned int nNumSamples, unsigned int &nReadPos)
+{
+   nReadPos = 0;
    if (m_nIgnoreSamples > 0)
       {
       // complete buffer to be ignored?
       if (m_nIgnoreSamples >= nNumSamples)
          {
          m_nIgnoreSamples -= nNumSamples;
-         return;
+         return 0;
          }
       nNumSamples -= (unsigned int)m_nIgnoreSamples;
       nReadPos += (unsigned int)m_nIgnoreSamples;
       m_nIgnoreSamples = 0;
       }
 
-
    if (!!m_nRecLength)
       {
       if ((uint64_t)Size() + nNumSamples > m_nRecLength)
@@ -225,7 +274,145 @@ void SDPRecFile::WriteBuffer(std::valarray<float> &vaf)
          nNumSamples =(unsigned int) (m_nRecLength - (uint64_t)Size());
          }
       }
-   m_pfs->WriteBuffer(&vaf[nReadPos], (int)(nNumSamples*sizeof(float)));
+   return nNumSamples;
+}
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+/// writes data to file synchronously or copies them to blocks of the record
+/// writer. Full blocks are queued for writing
+//------------------------------------------------------------------------------
+void SDPRecFile::Write(const void* pData, unsigned int nBytes)
+{
+   if (!m_psdprw)
+      {
+      m_pfs->WriteBuffer(pData, (int)nBytes);
+      return;
+      }
+   CheckWriteError();
+   const char* pc = (const char*)pData;
+   unsigned int n;
+   while (nBytes)
+      {
+      char* pcDest = BlockSpace(n);
+      if (n > nBytes)
+         n = nBytes;
+      CopyMemory(pcDest, pc, n);
+      BlockCommit(n);
+      pc       += n;
+      nBytes   -= n;
+      }
+}
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+/// returns pointer to free space of current block of record writer (acquires
+/// a new block if necessary) and sets nBytes to size of free space. Data
+/// written there must be committed with BlockCommit
+//------------------------------------------------------------------------------
+char* SDPRecFile::BlockSpace(unsigned int &nBytes)
+{
+   if (!m_psdprb)
+      m_psdprb = m_psdprw->AcquireBlock();
+   nBytes = m_psdprw->BlockSize() - m_psdprb->m_nUsed;
+   return m_psdprb->m_pData + m_psdprb->m_nUsed;
+}
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+/// marks nBytes bytes of current block as used. A full block is queued for
+/// writing
+//------------------------------------------------------------------------------
+void SDPRecFile::BlockCommit(unsigned int nBytes)
+{
+   m_psdprb->m_nUsed += nBytes;
+   if (m_psdprb->m_nUsed == m_psdprw->BlockSize())
+      {
+      InterlockedIncrement(&m_nPendingBlocks);
+      SDPRecBlock* psdprb = m_psdprb;
+      m_psdprb = NULL;
+      m_psdprw->Enqueue(this, psdprb);
+      }
+}
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+/// queues current block (or releases it if bDiscard is true) and waits until
+/// all queued blocks of the file are written
+//------------------------------------------------------------------------------
+void SDPRecFile::Flush(bool bDiscard)
+{
+   if (!m_psdprw)
+      return;
+   if (m_psdprb)
+      {
+      SDPRecBlock* psdprb = m_psdprb;
+      m_psdprb = NULL;
+      if (!bDiscard && psdprb->m_nUsed)
+         {
+         InterlockedIncrement(&m_nPendingBlocks);
+         m_psdprw->Enqueue(this, psdprb);
+         }
+      else
+         m_psdprw->ReleaseBlock(psdprb);
+      }
+   if (bDiscard)
+      m_psdprw->Purge(this);
+   if (!m_psdprw->WaitForFile(this, RECWRITE_FLUSHTIMEOUT))
+      {
+      // drop blocks not written yet and wait for the block currently written
+      // (if any): the file must not be used by the writer thread afterwards
+      m_usWriteError = "timeout writing queued data";
+      InterlockedExchange(&m_nWriteError, 1);
+      m_psdprw->Purge(this);
+      m_psdprw->WaitForFile(this, INFINITE);
+      }
+   if (!bDiscard)
+      CheckWriteError();
+}
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+/// releases blocks reserved by the file in record writer
+//------------------------------------------------------------------------------
+void SDPRecFile::DetachWriter()
+{
+   if (m_psdprw)
+      m_psdprw->Detach(true);
+   else if (m_bSyncWriter && SDPRecWriter::Instance())
+      SDPRecWriter::Instance()->Detach(false);
+   m_psdprw       = NULL;
+   m_bSyncWriter  = false;
+}
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+/// called by writer thread: writes a block to file. Errors are stored and
+/// reported by CheckWriteError, subsequent blocks are skipped
+//------------------------------------------------------------------------------
+void SDPRecFile::WriteBlock(SDPRecBlock* psdprb)
+{
+   if (m_nWriteError)
+      return;
+   try
+      {
+      m_pfs->WriteBuffer(psdprb->m_pData, (int)psdprb->m_nUsed);
+      }
+   catch (Exception &e)
+      {
+      m_usWriteError = e.Message;
+      InterlockedExchange(&m_nWriteError, 1);
+      }
+}
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+/// throws an exception if writer thread failed writing data
+//------------------------------------------------------------------------------
+void SDPRecFile::CheckWriteError()
+{
+   if (m_nWriteError)
+      throw Exception("error writing wave file for saving audio data: " + FileAndChannelStr() + " (" + m_usWriteError + ")");
 }
 //------------------------------------------------------------------------------
 
@@ -244,7 +431,11 @@ void SDPRecFile::Reset()
 //------------------------------------------------------------------------------
 void SDPRecFile::Clear()
 {
+   if (m_pfs)
+      Flush(true);
    TRYDELETENULL(m_pfs);
+   DetachWriter();
+   m_nSamples  = 0;
 }
 //------------------------------------------------------------------------------
 
@@ -255,7 +446,8 @@ int64_t SDPRecFile::Size()
 {
    if (!m_pfs)
       return 0;
-   return (m_pfs->Size - (int64_t)sizeof(PCMWaveFileHeader)) / (int64_t)sizeof(float);
+   // NOTE: file size cannot be used, because data may be queued in record writer
+   return m_nSamples;
 }
 //------------------------------------------------------------------------------
 
@@ -268,6 +460,14 @@ PCMWaveFileHeader::PCMWaveFileHeader()
    RiffHeader.len = 0;
    RiffHeader.typeStr[0] = 'W';RiffHeader.typeStr[1] = 'A';RiffHeader.typeStr[2] = 'V';RiffHeader.typeStr[3] = 'E';
 
+   // placeholder for ds64 chunk, see SetDataSize_Byte
+   ds64Chunk.id[0] = 'J';ds64Chunk.id[1] = 'U';ds64Chunk.id[2] = 'N';ds64Chunk.id[3] = 'K';
+   ds64Chunk.len = sizeof(ds64_chunk) - sizeof(chunk_hdr);
+   ds64Chunk.riffSize      = 0;
+   ds64Chunk.dataSize      = 0;
+   ds64Chunk.sampleCount   = 0;
+   ds64Chunk.tableLength   = 0;
+
    fmtChunk.id[0] = 'f';fmtChunk.id[1] = 'm';fmtChunk.id[2] = 't';fmtChunk.id[3] = ' ';
    fmtChunk.len = 16;// sizeof(wave_hdr);// 16;
 
@@ -281,27 +481,46 @@ PCMWaveFileHeader::PCMWaveFileHeader()
 //------------------------------------------------------------------------------
 
 //------------------------------------------------------------------------------
-// Set DataSize by total byte count
+// Set DataSize by total byte count. If the sizes do not fit into 32 bit, the
+// header is converted to RF64: sizes are written to the ds64 chunk and the
+// 32 bit sizes are set to 0xFFFFFFFF. Otherwise a RIFF header with a JUNK
+// chunk is written
 //------------------------------------------------------------------------------
-void PCMWaveFileHeader::SetDataSize_Byte(DWORD dwDataByteCount)
+void PCMWaveFileHeader::SetDataSize_Byte(uint64_t nDataByteCount)
 {
-   // writing datasize
-   dataChunk.len  = dwDataByteCount;
-   // writing size after RiffHeader
-   RiffHeader.len = dataChunk.len + sizeof(chunk_hdr) + sizeof(wave_hdr) + sizeof(riff_hdr) ;
+   // size after RiffHeader id and length
+   uint64_t nRiffSize = nDataByteCount + sizeof(riff_hdr) + sizeof(ds64_chunk)
+                        + 2*sizeof(chunk_hdr) + sizeof(wave_hdr) - sizeof(chunk_hdr);
+   if (nRiffSize > 0xFFFFFFFF)
+      {
+      RiffHeader.id[0] = 'R';RiffHeader.id[1] = 'F';RiffHeader.id[2] = '6';RiffHeader.id[3] = '4';
+      ds64Chunk.id[0] = 'd';ds64Chunk.id[1] = 's';ds64Chunk.id[2] = '6';ds64Chunk.id[3] = '4';
+      ds64Chunk.riffSize      = nRiffSize;
+      ds64Chunk.dataSize      = nDataByteCount;
+      ds64Chunk.sampleCount   = pcmFormatRec.wBlockAlign ? nDataByteCount / pcmFormatRec.wBlockAlign : 0;
+      RiffHeader.len = 0xFFFFFFFF;
+      dataChunk.len  = 0xFFFFFFFF;
+      }
+   else
+      {
+      RiffHeader.id[0] = 'R';RiffHeader.id[1] = 'I';RiffHeader.id[2] = 'F';RiffHeader.id[3] = 'F';
+      ds64Chunk.id[0] = 'J';ds64Chunk.id[1] = 'U';ds64Chunk.id[2] = 'N';ds64Chunk.id[3] = 'K';
+      ds64Chunk.riffSize      = 0;
+      ds64Chunk.dataSize      = 0;
+      ds64Chunk.sampleCount   = 0;
+      RiffHeader.len = (DWORD)nRiffSize;
+      dataChunk.len  = (DWORD)nDataByteCount;
+      }
 }
 //------------------------------------------------------------------------------
 
 //------------------------------------------------------------------------------
 // Set DataSize by total sample count
 //------------------------------------------------------------------------------
-void PCMWaveFileHeader::SetDataSize_Sample(DWORD dwDataSampleCount)
+void PCMWaveFileHeader::SetDataSize_Sample(uint64_t nDataSampleCount)
 {
-   // writing datasize
-   dataChunk.len  =  dwDataSampleCount * pcmFormatRec.wChannels
-                     * (DWORD)(div(pcmFormatRec.wBitsPerSample,8).quot);
-   // writing size after RiffHeader
-   RiffHeader.len =  dataChunk.len + sizeof(chunk_hdr) + sizeof(wave_hdr) + sizeof(riff_hdr) ;
+   SetDataSize_Byte(nDataSampleCount * pcmFormatRec.wChannels
+                     * (uint64_t)(div(pcmFormatRec.wBitsPerSample,8).quot));
 }
 //------------------------------------------------------------------------------
 
@@ -329,3 +548,632 @@ UnicodeString SDPRecFile::FileAndChannelStr()
 }
 //------------------------------------------------------------------------------
 
+//------------------------------------------------------------------------------
+/// constructor. Initializes members. Writing is always enabled, record length
+/// is not used. nMaxFrames is the maximum number of frames passed to
+/// WriteBuffers at once
+//------------------------------------------------------------------------------
+SDPRecMultiFile::SDPRecMultiFile(  unsigned int nSampleRate,
+                                    const std::vector<unsigned int> &vnChannels,
+                                    uint64_t nIgnoreSamples,
+                                    unsigned int nMaxFrames)
+   :  SDPRecFile(nSampleRate, vnChannels.empty() ? -1 : (int)vnChannels[0], nIgnoreSamples, true),
+      m_vnChannels(vnChannels),
+      m_nMaxFrames(nMaxFrames)
+{
+   // NOTE: block align of wave header is a WORD
+   if (m_vnChannels.empty() || m_vnChannels.size() > 0xFFFF / sizeof(float))
+      throw Exception("invalid number of channels for multichannel record file");
+   if (!m_nMaxFrames)
+      throw Exception("invalid buffer size for multichannel record file");
+   m_wChannels = (WORD)m_vnChannels.size();
+   m_vpfSource.resize(m_vnChannels.size());
+}
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+/// opens file and allocates buffer for interleaving: one buffer of frames for
+/// synchronous writing, a single frame (for frames split between two blocks)
+/// if data are interleaved directly to blocks of record writer
+//------------------------------------------------------------------------------
+void SDPRecMultiFile::OpenFile()
+{
+   if (m_pfs)
+      return;
+   SDPRecFile::OpenFile();
+   m_vfInterleave.resize((m_psdprw ? 1 : m_nMaxFrames) * m_vnChannels.size());
+}
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+/// returns indices of channels written to file
+//------------------------------------------------------------------------------
+const std::vector<unsigned int>& SDPRecMultiFile::Channels()
+{
+   return m_vnChannels;
+}
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+/// writes the channels of the file from a vector of buffers (all channels)
+/// interleaved to file. With record writer the frames are interleaved
+/// directly into its blocks
+//------------------------------------------------------------------------------
+void SDPRecMultiFile::WriteBuffers(std::vector<std::valarray<float> > &vvaf)
+{
+   if (!m_bEnabled || !m_pfs)
+      return;
+
+   unsigned int nChannel;
+   for (nChannel = 0; nChannel < m_vnChannels.size(); nChannel++)
+      {
+      if (m_vnChannels[nChannel] >= vvaf.size() || vvaf[m_vnChannels[nChannel]].size() != vvaf[m_vnChannels[0]].size())
+         throw Exception("invalid buffers passed to multichannel record file");
+      }
+
+   unsigned int nReadPos;
+   unsigned int nFrames = SamplesToWrite((unsigned int)vvaf[m_vnChannels[0]].size(), nReadPos);
+   if (!nFrames)
+      return;
+
+   for (nChannel = 0; nChannel < m_vnChannels.size(); nChannel++)
+      m_vpfSource[nChannel] = &vvaf[m_vnChannels[nChannel]][nReadPos];
+
+   unsigned int nFrameBytes = (unsigned int)(m_vnChannels.size() * sizeof(float));
+   unsigned int nFrame = 0;
+   unsigned int n, nBytes;
+   if (!m_psdprw)
+      {
+      while (nFrame < nFrames)
+         {
+         n = nFrames - nFrame;
+         if (n > m_nMaxFrames)
+            n = m_nMaxFrames;
+         Interleave(&m_vfInterleave[0], nFrame, n);
+         Write(&m_vfInterleave[0], n * nFrameBytes);
+         nFrame += n;
+         }
+      }
+   else
+      {
+      CheckWriteError();
+      while (nFrame < nFrames)
+         {
+         // NOTE: blocks only contain float data, so pointer is aligned
+         float* pfDest = (float*)BlockSpace(nBytes);
+         n = nBytes / nFrameBytes;
+         if (!n)
+            {
+            // frame does not fit into current block: Write splits it
+            Interleave(&m_vfInterleave[0], nFrame, 1);
+            Write(&m_vfInterleave[0], nFrameBytes);
+            nFrame++;
+            continue;
+            }
+         if (n > nFrames - nFrame)
+            n = nFrames - nFrame;
+         Interleave(pfDest, nFrame, n);
+         BlockCommit(n * nFrameBytes);
+         nFrame += n;
+         }
+      }
+   m_nSamples += nFrames;
+}
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+/// interleaves nFrames frames starting at nFirstFrame from source pointers to
+/// pfDest. Four channels are processed per pass: each source is read
+/// sequentially and each frame writes four adjacent floats. Remaining
+/// channels are copied one by one
+//------------------------------------------------------------------------------
+void SDPRecMultiFile::Interleave(float* pfDest, unsigned int nFirstFrame, unsigned int nFrames)
+{
+   unsigned int nChannels = (unsigned int)m_vnChannels.size();
+   unsigned int nChannel = 0;
+   unsigned int n;
+   unsigned int nEnd = nFirstFrame + nFrames;
+   for (; nChannel + 4 <= nChannels; nChannel += 4)
+      {
+      const float* pf0 = m_vpfSource[nChannel];
+      const float* pf1 = m_vpfSource[nChannel+1];
+      const float* pf2 = m_vpfSource[nChannel+2];
+      const float* pf3 = m_vpfSource[nChannel+3];
+      float* pf = pfDest + nChannel;
+      for (n = nFirstFrame; n < nEnd; n++)
+         {
+         pf[0] = pf0[n];
+         pf[1] = pf1[n];
+         pf[2] = pf2[n];
+         pf[3] = pf3[n];
+         pf += nChannels;
+         }
+      }
+   for (; nChannel < nChannels; nChannel++)
+      {
+      const float* pfSrc = m_vpfSource[nChannel];
+      float* pf = pfDest + nChannel;
+      for (n = nFirstFrame; n < nEnd; n++)
+         {
+         *pf = pfSrc[n];
+         pf += nChannels;
+         }
+      }
+}
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+// returns current filename and channels as string
+//------------------------------------------------------------------------------
+UnicodeString SDPRecMultiFile::FileAndChannelStr()
+{
+   UnicodeString us = "file '" + m_usFileName + "', channels ";
+   for (unsigned int n = 0; n < m_vnChannels.size(); n++)
+      {
+      if (n)
+         us += ",";
+      us += IntToStr((int)m_vnChannels[n]);
+      }
+   return us;
+}
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+/// static writer instance, set by constructor of SDPRecWriter
+//------------------------------------------------------------------------------
+SDPRecWriter* SDPRecWriter::sm_psdprw = NULL;
+
+//------------------------------------------------------------------------------
+/// constructor of writer thread. Thread is started by writer
+//------------------------------------------------------------------------------
+__fastcall SDPRecWriterThread::SDPRecWriterThread(SDPRecWriter* psdprw)
+   : TThread(true), m_psdprw(psdprw)
+{
+   Priority = tpHigher;
+   FreeOnTerminate = false;
+}
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+/// thread function. Waits for queued blocks and writes them to their files.
+/// All queued blocks are written before the thread exits
+//------------------------------------------------------------------------------
+void __fastcall SDPRecWriterThread::Execute()
+{
+   SDPRecWriteJob sdprwj;
+   DWORD nWaitResult;
+   double dStart;
+   while (1)
+      {
+      // wait for 'request' or 'stop'. To avoid dead locks we have a timeout
+      // of 1 second: in that case we simply check the queue
+      nWaitResult = WaitForMultipleObjects(2, m_psdprw->m_hEvents, false, 1000);
+      // NOTE: semaphore may count more requests than queued blocks, because
+      // all blocks are written on each wake up
+      while (m_psdprw->GetJob(sdprwj))
+         {
+         dStart = m_psdprw->Now();
+         sdprwj.m_psdprf->WriteBlock(sdprwj.m_psdprb);
+         m_psdprw->JobDone(sdprwj, m_psdprw->Now() - dStart);
+         }
+      if (Terminated || nWaitResult == WAIT_OBJECT_0 + SDP_RECWRITEREVENT_STOP)
+         break;
+      }
+}
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+/// constructor. Allocates page aligned memory for nBufSize bytes divided into
+/// blocks of nBlockSize bytes (at least two blocks), creates sync objects and
+/// starts writer thread. Sets static member SDPRecWriter::sm_psdprw
+//------------------------------------------------------------------------------
+SDPRecWriter::SDPRecWriter(uint64_t nBufSize, unsigned int nBlockSize)
+   :  m_psdprwt(NULL),
+      m_nFiles(0),
+      m_nSyncFiles(0),
+      m_pMemory(NULL),
+      m_hBlockDone(NULL)
+{
+   if (sm_psdprw)
+      throw Exception("record writer already created");
+   if (nBlockSize < RECWRITE_MINBLOCKSIZE || nBlockSize > RECWRITE_MAXBLOCKSIZE)
+      throw Exception("invalid record writer block size");
+   // use multiples of minimum block size for aligned writes
+   m_nBlockSize = ((nBlockSize + RECWRITE_MINBLOCKSIZE - 1) / RECWRITE_MINBLOCKSIZE) * RECWRITE_MINBLOCKSIZE;
+   uint64_t nNumBlocks = nBufSize / m_nBlockSize;
+   if (nNumBlocks < RECWRITE_BLOCKSPERFILE)
+      nNumBlocks = RECWRITE_BLOCKSPERFILE;
+
+   LARGE_INTEGER li;
+   QueryPerformanceFrequency(&li);
+   m_dFrequency = (double)li.QuadPart / 1000.0;
+
+   InitializeCriticalSection(&m_csQueue);
+
+   // stop event is manual-resetting, semaphore counts queued blocks
+   m_hEvents[SDP_RECWRITEREVENT_STOP]     = CreateEvent(NULL, TRUE, FALSE, NULL);
+   m_hEvents[SDP_RECWRITEREVENT_REQUEST]  = CreateSemaphore(NULL, 0, LONG_MAX, NULL);
+   m_hBlockDone                           = CreateEvent(NULL, FALSE, FALSE, NULL);
+   try
+      {
+      if (!m_hEvents[SDP_RECWRITEREVENT_STOP] || !m_hEvents[SDP_RECWRITEREVENT_REQUEST] || !m_hBlockDone)
+         throw Exception("error creating record writer events");
+
+      Allocate(nNumBlocks);
+      ResetStats();
+
+      m_psdprwt = new SDPRecWriterThread(this);
+      m_psdprwt->Start();
+      }
+   catch (...)
+      {
+      Cleanup();
+      throw;
+      }
+   sm_psdprw = this;
+}
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+/// destructor. Stops writer thread and does cleanup. All SDPRecFile instances
+/// must be closed before
+//------------------------------------------------------------------------------
+SDPRecWriter::~SDPRecWriter()
+{
+   sm_psdprw = NULL;
+   Cleanup();
+}
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+/// stops and deletes writer thread, releases sync objects and memory
+//------------------------------------------------------------------------------
+void SDPRecWriter::Cleanup()
+{
+   // NOTE: no exception here to happen in destructor: thus ignore any error....
+   if (m_hEvents[SDP_RECWRITEREVENT_STOP])
+      SetEvent(m_hEvents[SDP_RECWRITEREVENT_STOP]);
+   if (m_psdprwt)
+      {
+      m_psdprwt->Terminate();
+      m_psdprwt->WaitFor();
+      TRYDELETENULL(m_psdprwt);
+      }
+   for (int i = 0; i < 2; i++)
+      {
+      if (m_hEvents[i] != NULL)
+         {
+         CloseHandle(m_hEvents[i]);
+         m_hEvents[i] = NULL;
+         }
+      }
+   if (m_hBlockDone)
+      {
+      CloseHandle(m_hBlockDone);
+      m_hBlockDone = NULL;
+      }
+   Release();
+   DeleteCriticalSection(&m_csQueue);
+}
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+/// allocates page aligned memory for nNumBlocks blocks and fills list of free
+/// blocks. Memory must be released before
+//------------------------------------------------------------------------------
+void SDPRecWriter::Allocate(uint64_t nNumBlocks)
+{
+   if (nNumBlocks * m_nBlockSize > (uint64_t)(SIZE_T)-1)
+      throw Exception("invalid record writer buffer size");
+   m_pMemory = (char*)VirtualAlloc(NULL, (SIZE_T)(nNumBlocks * m_nBlockSize), MEM_COMMIT | MEM_RESERVE, PAGE_READWRITE);
+   if (!m_pMemory)
+      throw Exception("error allocating record writer buffer (" + IntToStr((int64_t)(nNumBlocks * m_nBlockSize)) + " bytes)");
+   m_vsdprb.resize((unsigned int)nNumBlocks);
+   for (unsigned int n = 0; n < m_vsdprb.size(); n++)
+      {
+      m_vsdprb[n].m_pData  = m_pMemory + (SIZE_T)n * m_nBlockSize;
+      m_vsdprb[n].m_nUsed  = 0;
+      m_vpsdprbFree.push_back(&m_vsdprb[n]);
+      }
+}
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+/// releases memory of all blocks
+//------------------------------------------------------------------------------
+void SDPRecWriter::Release()
+{
+   m_vpsdprbFree.clear();
+   m_vsdprb.clear();
+   if (m_pMemory)
+      {
+      VirtualFree(m_pMemory, 0, MEM_RELEASE);
+      m_pMemory = NULL;
+      }
+}
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+/// enlarges memory (if necessary), so that nFiles files can reserve their
+/// blocks. Must only be called while no file is open
+//------------------------------------------------------------------------------
+void SDPRecWriter::Budget(unsigned int nFiles)
+{
+   uint64_t nNumBlocks = (uint64_t)nFiles * RECWRITE_BLOCKSPERFILE;
+   EnterCriticalSection(&m_csQueue);
+   try
+      {
+      if (nNumBlocks > m_vsdprb.size())
+         {
+         if (m_nFiles || m_nSyncFiles || m_vpsdprbFree.size() != m_vsdprb.size())
+            throw Exception("cannot resize record writer buffer while files are open");
+         Release();
+         Allocate(nNumBlocks);
+         }
+      }
+   __finally
+      {
+      LeaveCriticalSection(&m_csQueue);
+      }
+}
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+/// reserves blocks for a file to be opened. Returns false, if not enough
+/// blocks are left: then file has to be written synchronously and Detach(false)
+/// must be called on close
+//------------------------------------------------------------------------------
+bool SDPRecWriter::Attach()
+{
+   bool bReturn;
+   EnterCriticalSection(&m_csQueue);
+   bReturn = (uint64_t)(m_nFiles + 1) * RECWRITE_BLOCKSPERFILE <= m_vsdprb.size();
+   if (bReturn)
+      m_nFiles++;
+   else
+      m_nSyncFiles++;
+   m_sdprws.nFiles      = m_nFiles;
+   m_sdprws.nSyncFiles  = m_nSyncFiles;
+   LeaveCriticalSection(&m_csQueue);
+   return bReturn;
+}
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+/// releases blocks reserved by a closed file (bAttached is return value of
+/// Attach)
+//------------------------------------------------------------------------------
+void SDPRecWriter::Detach(bool bAttached)
+{
+   EnterCriticalSection(&m_csQueue);
+   if (bAttached && m_nFiles)
+      m_nFiles--;
+   else if (!bAttached && m_nSyncFiles)
+      m_nSyncFiles--;
+   m_sdprws.nFiles      = m_nFiles;
+   m_sdprws.nSyncFiles  = m_nSyncFiles;
+   LeaveCriticalSection(&m_csQueue);
+}
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+/// returns static writer instance (may be NULL)
+//------------------------------------------------------------------------------
+SDPRecWriter* SDPRecWriter::Instance()
+{
+   return sm_psdprw;
+}
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+/// returns current time in milliseconds used for statistics
+//------------------------------------------------------------------------------
+double SDPRecWriter::Now()
+{
+   LARGE_INTEGER li;
+   QueryPerformanceCounter(&li);
+   return (double)li.QuadPart / m_dFrequency;
+}
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+/// returns size of one block in bytes
+//------------------------------------------------------------------------------
+unsigned int SDPRecWriter::BlockSize()
+{
+   return m_nBlockSize;
+}
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+/// returns total number of blocks
+//------------------------------------------------------------------------------
+unsigned int SDPRecWriter::NumBlocks()
+{
+   return (unsigned int)m_vsdprb.size();
+}
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+/// returns an empty block. If no block is free, it waits until the writer
+/// thread has written a block (back pressure). Throws an exception if no block
+/// becomes free within RECWRITE_ACQUIRETIMEOUT milliseconds
+//------------------------------------------------------------------------------
+SDPRecBlock* SDPRecWriter::AcquireBlock()
+{
+   EnterCriticalSection(&m_csQueue);
+   if (m_vpsdprbFree.empty())
+      {
+      double dStart = Now();
+      m_sdprws.nStalls++;
+      while (m_vpsdprbFree.empty())
+         {
+         LeaveCriticalSection(&m_csQueue);
+         if (Now() - dStart > RECWRITE_ACQUIRETIMEOUT)
+            throw Exception("timeout waiting for free record writer block (disk too slow or 'recwritebufsize' too small)");
+         WaitForSingleObject(m_hBlockDone, 10);
+         EnterCriticalSection(&m_csQueue);
+         }
+      double dStallTime = Now() - dStart;
+      m_sdprws.dStallTime += dStallTime;
+      if (dStallTime > m_sdprws.dMaxStallTime)
+         m_sdprws.dMaxStallTime = dStallTime;
+      }
+   SDPRecBlock* psdprb = m_vpsdprbFree.back();
+   m_vpsdprbFree.pop_back();
+   psdprb->m_nUsed = 0;
+   unsigned int nBlocksUsed = (unsigned int)(m_vsdprb.size() - m_vpsdprbFree.size());
+   if (nBlocksUsed > m_sdprws.nMaxBlocksUsed)
+      m_sdprws.nMaxBlocksUsed = nBlocksUsed;
+   LeaveCriticalSection(&m_csQueue);
+   return psdprb;
+}
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+/// returns an unused block to list of free blocks
+//------------------------------------------------------------------------------
+void SDPRecWriter::ReleaseBlock(SDPRecBlock* psdprb)
+{
+   EnterCriticalSection(&m_csQueue);
+   psdprb->m_nUsed = 0;
+   m_vpsdprbFree.push_back(psdprb);
+   LeaveCriticalSection(&m_csQueue);
+   SetEvent(m_hBlockDone);
+}
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+/// queues a block for writing to a file. Pending block counter of file must
+/// be incremented by caller before
+//------------------------------------------------------------------------------
+void SDPRecWriter::Enqueue(SDPRecFile* psdprf, SDPRecBlock* psdprb)
+{
+   SDPRecWriteJob sdprwj;
+   sdprwj.m_psdprf = psdprf;
+   sdprwj.m_psdprb = psdprb;
+   EnterCriticalSection(&m_csQueue);
+   m_dqJobs.push_back(sdprwj);
+   m_sdprws.nQueueDepth = (unsigned int)m_dqJobs.size();
+   if (m_sdprws.nQueueDepth > m_sdprws.nMaxQueueDepth)
+      m_sdprws.nMaxQueueDepth = m_sdprws.nQueueDepth;
+   LeaveCriticalSection(&m_csQueue);
+   // NOTE: if this fails, block is written after timeout of writer thread
+   if (!ReleaseSemaphore(m_hEvents[SDP_RECWRITEREVENT_REQUEST], 1, NULL))
+      throw Exception("error setting record writer event");
+}
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+/// waits until all queued blocks of a file are written. Returns false on
+/// timeout (dwTimeout in milliseconds, INFINITE for no timeout)
+//------------------------------------------------------------------------------
+bool SDPRecWriter::WaitForFile(SDPRecFile* psdprf, DWORD dwTimeout)
+{
+   double dStart = Now();
+   while (psdprf->m_nPendingBlocks)
+      {
+      if (dwTimeout != INFINITE && Now() - dStart > (double)dwTimeout)
+         return false;
+      WaitForSingleObject(m_hBlockDone, 10);
+      }
+   return true;
+}
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+/// removes all queued blocks of a file, that are not written yet
+//------------------------------------------------------------------------------
+void SDPRecWriter::Purge(SDPRecFile* psdprf)
+{
+   EnterCriticalSection(&m_csQueue);
+   std::deque<SDPRecWriteJob>::iterator it = m_dqJobs.begin();
+   while (it != m_dqJobs.end())
+      {
+      if (it->m_psdprf == psdprf)
+         {
+         it->m_psdprb->m_nUsed = 0;
+         m_vpsdprbFree.push_back(it->m_psdprb);
+         InterlockedDecrement(&psdprf->m_nPendingBlocks);
+         it = m_dqJobs.erase(it);
+         }
+      else
+         it++;
+      }
+   m_sdprws.nQueueDepth = (unsigned int)m_dqJobs.size();
+   LeaveCriticalSection(&m_csQueue);
+   SetEvent(m_hBlockDone);
+}
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+/// called by writer thread: removes the oldest job from the queue. Returns
+/// false if queue is empty
+//------------------------------------------------------------------------------
+bool SDPRecWriter::GetJob(SDPRecWriteJob &rsdprwj)
+{
+   bool bReturn = false;
+   EnterCriticalSection(&m_csQueue);
+   if (!m_dqJobs.empty())
+      {
+      rsdprwj = m_dqJobs.front();
+      m_dqJobs.pop_front();
+      m_sdprws.nQueueDepth = (unsigned int)m_dqJobs.size();
+      bReturn = true;
+      }
+   LeaveCriticalSection(&m_csQueue);
+   return bReturn;
+}
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+/// called by writer thread after a block was written: updates statistics,
+/// returns block to list of free blocks and signals waiting threads
+//------------------------------------------------------------------------------
+void SDPRecWriter::JobDone(SDPRecWriteJob &rsdprwj, double dWriteTime)
+{
+   EnterCriticalSection(&m_csQueue);
+   m_sdprws.nBytes += rsdprwj.m_psdprb->m_nUsed;
+   m_sdprws.nWrites++;
+   if (dWriteTime > m_sdprws.dMaxWriteTime)
+      m_sdprws.dMaxWriteTime = dWriteTime;
+   rsdprwj.m_psdprb->m_nUsed = 0;
+   m_vpsdprbFree.push_back(rsdprwj.m_psdprb);
+   LeaveCriticalSection(&m_csQueue);
+   InterlockedDecrement(&rsdprwj.m_psdprf->m_nPendingBlocks);
+   SetEvent(m_hBlockDone);
+}
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+/// returns a copy of current statistics
+//------------------------------------------------------------------------------
+void SDPRecWriter::GetStats(SDPRecWriterStats &rsdprws)
+{
+   EnterCriticalSection(&m_csQueue);
+   rsdprws = m_sdprws;
+   LeaveCriticalSection(&m_csQueue);
+}
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+/// resets statistics (open files, current queue depth and blocks in use are
+/// kept)
+//------------------------------------------------------------------------------
+void SDPRecWriter::ResetStats()
+{
+   EnterCriticalSection(&m_csQueue);
+   m_sdprws.nFiles            = m_nFiles;
+   m_sdprws.nSyncFiles        = m_nSyncFiles;
+   m_sdprws.nQueueDepth       = (unsigned int)m_dqJobs.size();
+   m_sdprws.nMaxQueueDepth    = m_sdprws.nQueueDepth;
+   m_sdprws.nMaxBlocksUsed    = (unsigned int)(m_vsdprb.size() - m_vpsdprbFree.size());
+   m_sdprws.nBytes            = 0;
+   m_sdprws.nWrites           = 0;
+   m_sdprws.nStalls           = 0;
+   m_sdprws.dStallTime        = 0.0;
+   m_sdprws.dMaxStallTime     = 0.0;
+   m_sdprws.dMaxWriteTime     = 0.0;
+   LeaveCriticalSection(&m_csQueue);
+}
+//------------------------------------------------------------------------------
@@ -1,8 +1,10 @@
 //------------------------------------------------------------------------------
 /// \file SoundDllPro_RecFile.h
 /// \author Berg
-/// \brief Implementation of classes SDPRecFile and PCMWaveFileHeader.
-/// Simple classes to write a normalized 32bit float mono PCM wave file
+/// \brief Implementation of classes SDPRecFile, PCMWaveFileHeader and
+/// SDPRecWriter. Simple classes to write a normalized 32bit float mono PCM
+/// wave file. Data are written asynchronously in large blocks by the writer
+/// thread of SDPRecWriter (if created)
 ///
 /// Project SoundMexPro
 /// Module  SoundDllPro.dll
@@ -33,19 +35,40 @@
 
 #include <vcl.h>
 #include <vector>
+#include <deque>
 #include <valarray>
 //------------------------------------------------------------------------------
 
+#define RECWRITE_DEFAULTBUFSIZE     67108864
+#define RECWRITE_DEFAULTBLOCKSIZE   1048576
+#define RECWRITE_MINBLOCKSIZE       65536
+#define RECWRITE_MAXBLOCKSIZE       4194304
+/// number of blocks reserved for each open file (one filled, one queued)
+#define RECWRITE_BLOCKSPERFILE      2
+/// timeout in milliseconds for waiting for a free block
+#define RECWRITE_ACQUIRETIMEOUT     2000
+/// timeout in milliseconds for waiting for queued blocks of a file
+#define RECWRITE_FLUSHTIMEOUT       10000
+
 //------------------------------------------------------------------------------
 /// structs as definitions for different wave header chunks
 //------------------------------------------------------------------------------
 #pragma pack(push, 1)
 struct riff_hdr {
-   char  id[4];         // identifier string = "RIFF"
+   char  id[4];         // identifier string = "RIFF" (or "RF64")
    DWORD len;           // remaining length after this header
    char  typeStr[4];    // 4-byte data type ("WAVE")
 };
 
+struct ds64_chunk {        // RF64 size chunk (EBU Tech 3306), written as "JUNK" for RIFF
+   char     id[4];         // identifier, "ds64" or "JUNK"
+   DWORD    len;           // remaining chunk length after header, here == 28
+   uint64_t riffSize;      // 64 bit size of RF64 chunk
+   uint64_t dataSize;      // 64 bit size of data chunk
+   uint64_t sampleCount;   // number of sample frames
+   DWORD    tableLength;   // number of entries of size table (always 0)
+};
+
 struct chunk_hdr {      // CHUNK 8-byte header
    char  id[4];         // identifier, e.g. "fmt " or "data"
    DWORD len;           // remaining chunk(!) length after header, here == 16
@@ -64,33 +87,160 @@ struct wave_hdr {          //pcm-wave format chunk
 
 //------------------------------------------------------------------------------
 /// \class PCMWaveFileHeader. Simple helper class to create a valid PCM wave file
-/// header
+/// header. Contains a placeholder chunk, that is converted to a ds64 chunk
+/// (RF64) if the data exceed the 4 GB limit of RIFF files
 //------------------------------------------------------------------------------
 class PCMWaveFileHeader
 {
    public:
       PCMWaveFileHeader();
-      void  SetDataSize_Byte(DWORD dwDataByteCount);
-      void  SetDataSize_Sample(DWORD dwDataSampleCount);
+      void  SetDataSize_Byte(uint64_t nDataByteCount);
+      void  SetDataSize_Sample(uint64_t nDataSampleCount);
       void  SetWaveFormat(WORD wChannels, DWORD dwSamplesPerSec, WORD wBitsPerSample, WORD wFormatTag = 3);
    private:
       riff_hdr       RiffHeader;
+      ds64_chunk     ds64Chunk;
       chunk_hdr      fmtChunk;
       wave_hdr       pcmFormatRec;
       chunk_hdr      dataChunk;
 };
 //------------------------------------------------------------------------------
 
+//------------------------------------------------------------------------------
+/// enumeration of sync objects of record writer
+//------------------------------------------------------------------------------
+enum SDPRecWriterEvents
+{
+   SDP_RECWRITEREVENT_STOP = 0,
+   SDP_RECWRITEREVENT_REQUEST
+};
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+/// one page aligned memory block of record writer
+//------------------------------------------------------------------------------
+class SDPRecBlock
+{
+   public:
+      char*          m_pData;          /// block memory
+      unsigned int   m_nUsed;          /// number of bytes used
+};
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+/// statistics of record writer. Times in milliseconds
+//------------------------------------------------------------------------------
+class SDPRecWriterStats
+{
+   public:
+      unsigned int   nFiles;           /// number of open files using the writer
+      unsigned int   nSyncFiles;       /// number of files written synchronously (no blocks left to reserve)
+      unsigned int   nQueueDepth;      /// number of blocks currently queued for writing
+      unsigned int   nMaxQueueDepth;   /// maximum number of blocks queued for writing
+      unsigned int   nMaxBlocksUsed;   /// maximum number of blocks in use (filled or queued)
+      uint64_t       nBytes;           /// number of bytes written
+      uint64_t       nWrites;          /// number of block writes
+      uint64_t       nStalls;          /// number of times a writing thread had to wait for a free block
+      double         dStallTime;       /// total time spent waiting for free blocks
+      double         dMaxStallTime;    /// maximum time spent waiting for a free block
+      double         dMaxWriteTime;    /// maximum time for writing one block
+};
+//------------------------------------------------------------------------------
+
+class SDPRecFile;
+class SDPRecWriter;
+//------------------------------------------------------------------------------
+/// writer thread of record writer
+//------------------------------------------------------------------------------
+class SDPRecWriterThread : public TThread
+{
+   private:
+      SDPRecWriter*  m_psdprw;         /// writer the thread belongs to
+   protected:
+      void __fastcall Execute();
+   public:
+      __fastcall SDPRecWriterThread(SDPRecWriter* psdprw);
+};
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+/// job of record writer: block to be written to a file
+//------------------------------------------------------------------------------
+class SDPRecWriteJob
+{
+   public:
+      SDPRecFile*    m_psdprf;
+      SDPRecBlock*   m_psdprb;
+};
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+/// record writer with a fixed memory budget divided into blocks. Threads
+/// recording data only copy them to a block of the file, full blocks are
+/// written to disk by a dedicated thread in the order they were queued. If
+/// no free block is available, the recording thread has to wait (back
+/// pressure), which is counted in statistics. Each open file reserves
+/// RECWRITE_BLOCKSPERFILE blocks, files that cannot reserve blocks are
+/// written synchronously. Thus a free block is always available after the
+/// writer thread has written the queued blocks
+//------------------------------------------------------------------------------
+class SDPRecWriter
+{
+   friend class SDPRecWriterThread;
+   private:
+      static SDPRecWriter*          sm_psdprw;
+      SDPRecWriterThread*           m_psdprwt;        /// writer thread
+      std::vector<SDPRecBlock>      m_vsdprb;         /// all blocks
+      std::vector<SDPRecBlock*>     m_vpsdprbFree;    /// free blocks
+      std::deque<SDPRecWriteJob>    m_dqJobs;         /// queued blocks
+      unsigned int                  m_nBlockSize;     /// size of one block in bytes
+      unsigned int                  m_nFiles;         /// number of open files with reserved blocks
+      unsigned int                  m_nSyncFiles;     /// number of open files written synchronously
+      char*                         m_pMemory;        /// memory of all blocks
+      CRITICAL_SECTION              m_csQueue;
+      HANDLE                        m_hEvents[2];     /// stop event and request semaphore
+      HANDLE                        m_hBlockDone;     /// event set after each written block
+      double                        m_dFrequency;     /// performance counter ticks per millisecond
+      SDPRecWriterStats             m_sdprws;         /// statistics
+      void                          Cleanup();
+      void                          Allocate(uint64_t nNumBlocks);
+      void                          Release();
+      bool                          GetJob(SDPRecWriteJob &rsdprwj);
+      void                          JobDone(SDPRecWriteJob &rsdprwj, double dWriteTime);
+   public:
+      SDPRecWriter(uint64_t nBufSize, unsigned int nBlockSize);
+      ~SDPRecWriter();
+      static SDPRecWriter* Instance();
+      double            Now();
+      unsigned int      BlockSize();
+      unsigned int      NumBlocks();
+      void              Budget(unsigned int nFiles);
+      bool              Attach();
+      void              Detach(bool bAttached);
+      SDPRecBlock*      AcquireBlock();
+      void              ReleaseBlock(SDPRecBlock* psdprb);
+      void              Enqueue(SDPRecFile* psdprf, SDPRecBlock* psdprb);
+      bool              WaitForFile(SDPRecFile* psdprf, DWORD dwTimeout);
+      void              Purge(SDPRecFile* psdprf);
+      void              GetStats(SDPRecWriterStats &rsdprws);
+      void              ResetStats();
+};
+//------------------------------------------------------------------------------
+
 //------------------------------------------------------------------------------
 /// \class SDPRecFile. Simple class to write a normalized 32bit float mono
-/// PCM wave files
+/// PCM wave files. If an SDPRecWriter instance exists when the file is
+/// opened, data are copied to blocks that are written by the writer thread.
+/// Files exceeding 4 GB are written as RF64 files
 //------------------------------------------------------------------------------
 class SDPRecFile
 {
+   friend class SDPRecWriter;
+   friend class SDPRecWriterThread;
    public:
       SDPRecFile(unsigned int nSampleRate, int nChannelIndex, uint64_t nIgnoreSamples, bool bEnabled);
-      ~SDPRecFile();
-      void           OpenFile();
+      virtual ~SDPRecFile();
+      virtual void   OpenFile();
       void           OpenFile(UnicodeString usFileName);
       void           CloseFile();
       bool           IsOpen();
@@ -111,11 +261,50 @@ class SDPRecFile
       UnicodeString     m_usFileName;
       unsigned int      m_nSampleRate;
       int               m_nChannelIndex;
+      WORD              m_wChannels;         ///< number of (interleaved) channels in file
       bool              m_bEnabled;
       uint64_t          m_nRecLength;
       uint64_t          m_nSamplesToIgnore;
       uint64_t          m_nIgnoreSamples;
-      UnicodeString     FileAndChannelStr();
+      int64_t           m_nSamples;          ///< number of sample frames written (or queued for writing)
+      SDPRecWriter*     m_psdprw;            ///< writer used for current file (NULL: synchronous writing)
+      bool              m_bSyncWriter;       ///< flag if file is counted as synchronous file by writer
+      SDPRecBlock*      m_psdprb;            ///< block currently filled
+      volatile LONG     m_nPendingBlocks;    ///< number of blocks queued for writing
+      volatile LONG     m_nWriteError;       ///< flag, if writer thread failed writing
+      UnicodeString     m_usWriteError;      ///< error message of writer thread
+      virtual UnicodeString FileAndChannelStr();
+      unsigned int      SamplesToWrite(unsigned int nNumSamples, unsigned int &nReadPos);
+      void              Write(const void* pData, unsigned int nBytes);
+      char*             BlockSpace(unsigned int &nBytes);
+      void              BlockCommit(unsigned int nBytes);
+      void              Flush(bool bDiscard);
+      void              WriteBlock(SDPRecBlock* psdprb);
+      void              CheckWriteError();
+      void              DetachWriter();
+};
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+/// \class SDPRecMultiFile. Writes a group of input channels interleaved to
+/// one normalized 32bit float wave file (RF64 if exceeding 4 GB)
+//------------------------------------------------------------------------------
+class SDPRecMultiFile : public SDPRecFile
+{
+   public:
+      SDPRecMultiFile(unsigned int nSampleRate, const std::vector<unsigned int> &vnChannels, uint64_t nIgnoreSamples, unsigned int nMaxFrames);
+      using SDPRecFile::OpenFile;
+      void                                OpenFile();
+      void                                WriteBuffers(std::vector<std::valarray<float> > &vvaf);
+      const std::vector<unsigned int>&    Channels();
+   protected:
+      UnicodeString                       FileAndChannelStr();
+   private:
+      std::vector<unsigned int>           m_vnChannels;     ///< indices of channels written to file
+      std::vector<const float*>           m_vpfSource;      ///< source pointers of current buffer
+      std::valarray<float>                m_vfInterleave;   ///< buffer for interleaved data (synchronous writing or split frames)
+      unsigned int                        m_nMaxFrames;     ///< maximum number of frames per buffer
+      void                                Interleave(float* pfDest, unsigned int nFirstFrame, unsigned int nFrames);
 };
 //------------------------------------------------------------------------------
 #endif
@@ -0,0 +1,260 @@
+//------------------------------------------------------------------------------
+/// \file SoundDllPro_SampleStore.cpp
+/// \author Berg
+/// \brief Implementation of classes SDPSampleBlock and SDPSampleStore. Stores
+/// float sample data loaded from memory (command 'loadmem') once per content
+/// (or user key) and shares them read-only between all SDPOutputData instances
+/// using them.
+///
+/// Project SoundMexPro
+/// Module  SoundDllPro.dll
+///
+/// ****************************************************************************
+/// Copyright 2023 Daniel Berg, Oldenburg, Germany
+/// ****************************************************************************
+///
+/// This file is part of SoundMexPro.
+///
+///    SoundMexPro is free software: you can redistribute it and/or modify
+///    it under the terms of the GNU General Public License as published by
+///    the Free Software Foundation, either version 3 of the License, or
+///    (at your option) any later version.
+///
+///    SoundMexPro is distributed in the hope that it will be useful,
+///    but WITHOUT ANY WARRANTY; without even the implied warranty of
+///    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+///    GNU General Public License for more details.
+///
+///    You should have received a copy of the GNU General Public License
+///    along with SoundMexPro.  If not, see <http:///www.gnu.org/licenses/>.
+///
+//------------------------------------------------------------------------------
+#include <vcl.h>
+#pragma hdrstop
+
+#include "SoundDllPro_SampleStore.h"
+#pragma package(smart_init)
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+/// static store instance, set by constructor of SDPSampleStore
+//------------------------------------------------------------------------------
+SDPSampleStore* SDPSampleStore::sm_psdpss = NULL;
+
+//------------------------------------------------------------------------------
+/// constructor. Converts passed double data to float
+//------------------------------------------------------------------------------
+SDPSampleBlock::SDPSampleBlock(const double* pdData, unsigned int nSamples)
+   :  m_nRefCount(1),
+      m_psdpss(NULL),
+      m_vafData(nSamples)
+{
+   for (unsigned int nSample = 0; nSample < nSamples; nSample++)
+      m_vafData[nSample] = (float)pdData[nSample];
+}
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+/// destructor. Only called by Release
+//------------------------------------------------------------------------------
+SDPSampleBlock::~SDPSampleBlock()
+{
+}
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+/// increments reference count
+//------------------------------------------------------------------------------
+void SDPSampleBlock::AddRef()
+{
+   InterlockedIncrement(&m_nRefCount);
+}
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+/// decrements reference count and deletes instance if it is not referenced
+/// any longer. Stored blocks are released by the store to remove them from the
+/// store consistently
+//------------------------------------------------------------------------------
+void SDPSampleBlock::Release()
+{
+   if (m_psdpss)
+      m_psdpss->Release(this);
+   else if (InterlockedDecrement(&m_nRefCount) == 0)
+      delete this;
+}
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+/// constructor. Sets static member SDPSampleStore::sm_psdpss
+//------------------------------------------------------------------------------
+SDPSampleStore::SDPSampleStore()
+   :  m_nHits(0),
+      m_nMisses(0)
+{
+   if (sm_psdpss)
+      throw Exception("sample store already created");
+   InitializeCriticalSection(&m_csStore);
+   sm_psdpss = this;
+}
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+/// destructor. Blocks still referenced are detached from the store and
+/// deleted on their last Release
+//------------------------------------------------------------------------------
+SDPSampleStore::~SDPSampleStore()
+{
+   sm_psdpss = NULL;
+   EnterCriticalSection(&m_csStore);
+   std::map<AnsiString, SDPSampleBlock*>::iterator it;
+   for (it = m_mapBlocks.begin(); it != m_mapBlocks.end(); it++)
+      it->second->m_psdpss = NULL;
+   m_mapBlocks.clear();
+   LeaveCriticalSection(&m_csStore);
+   DeleteCriticalSection(&m_csStore);
+}
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+/// returns static store instance (may be NULL)
+//------------------------------------------------------------------------------
+SDPSampleStore* SDPSampleStore::Instance()
+{
+   return sm_psdpss;
+}
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+/// returns a referenced block containing the passed data converted to float.
+/// If strKey is empty, blocks are identified by a hash of the data and the
+/// content of a found block is compared to the passed data. Otherwise blocks
+/// with same key and size are expected to contain identical data. Caller must
+/// call Release() on returned block
+//------------------------------------------------------------------------------
+SDPSampleBlock* SDPSampleStore::Acquire(const double* pdData, unsigned int nSamples, AnsiString strKey)
+{
+   AnsiString strStoreKey;
+   if (strKey.IsEmpty())
+      {
+      // FNV-1a hash over 64bit words
+      uint64_t nHash = 14695981039346656037ULL;
+      const uint64_t* pn = (const uint64_t*)pdData;
+      for (unsigned int nSample = 0; nSample < nSamples; nSample++)
+         {
+         nHash ^= *pn++;
+         nHash *= 1099511628211ULL;
+         }
+      strStoreKey = "#" + IntToHex((int64_t)nHash, 16);
+      }
+   else
+      strStoreKey = "$" + strKey;
+   strStoreKey += ":" + IntToStr((int)nSamples);
+
+   SDPSampleBlock* psdpsb = NULL;
+   EnterCriticalSection(&m_csStore);
+   try
+      {
+      std::map<AnsiString, SDPSampleBlock*>::iterator it = m_mapBlocks.find(strStoreKey);
+      if (it != m_mapBlocks.end())
+         {
+         psdpsb = it->second;
+         psdpsb->AddRef();
+         }
+      }
+   __finally
+      {
+      LeaveCriticalSection(&m_csStore);
+      }
+
+   // check content of block found by hash: different data with identical
+   // hash get an own block that is not stored
+   bool bStore = true;
+   if (psdpsb && strKey.IsEmpty() && nSamples)
+      {
+      const float* pf = &psdpsb->m_vafData[0];
+      for (unsigned int nSample = 0; nSample < nSamples; nSample++)
+         {
+         if (pf[nSample] != (float)pdData[nSample])
+            {
+            psdpsb->Release();
+            psdpsb = NULL;
+            bStore = false;
+            break;
+            }
+         }
+      }
+
+   if (psdpsb)
+      {
+      EnterCriticalSection(&m_csStore);
+      m_nHits++;
+      LeaveCriticalSection(&m_csStore);
+      return psdpsb;
+      }
+
+   // convert data outside of critical section (may take a while)
+   psdpsb = new SDPSampleBlock(pdData, nSamples);
+   EnterCriticalSection(&m_csStore);
+   try
+      {
+      m_nMisses++;
+      if (bStore && m_mapBlocks.find(strStoreKey) == m_mapBlocks.end())
+         {
+         psdpsb->m_psdpss  = this;
+         psdpsb->m_strKey  = strStoreKey;
+         m_mapBlocks[strStoreKey] = psdpsb;
+         }
+      }
+   __finally
+      {
+      LeaveCriticalSection(&m_csStore);
+      }
+   return psdpsb;
+}
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+/// decrements reference count of a stored block. Removes it from store and
+/// deletes it, if not referenced any longer
+//------------------------------------------------------------------------------
+void SDPSampleStore::Release(SDPSampleBlock* psdpsb)
+{
+   bool bDelete = false;
+   EnterCriticalSection(&m_csStore);
+   if (InterlockedDecrement(&psdpsb->m_nRefCount) == 0)
+      {
+      m_mapBlocks.erase(psdpsb->m_strKey);
+      bDelete = true;
+      }
+   LeaveCriticalSection(&m_csStore);
+   // free memory outside of critical section
+   if (bDelete)
+      delete psdpsb;
+}
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+/// returns current statistics
+//------------------------------------------------------------------------------
+void SDPSampleStore::GetStats(SDPSampleStoreStats &rsdpsss)
+{
+   rsdpsss.nReferences  = 0;
+   rsdpsss.nBytes       = 0;
+   rsdpsss.nSavedBytes  = 0;
+   EnterCriticalSection(&m_csStore);
+   rsdpsss.nBlocks      = (unsigned int)m_mapBlocks.size();
+   rsdpsss.nHits        = m_nHits;
+   rsdpsss.nMisses      = m_nMisses;
+   std::map<AnsiString, SDPSampleBlock*>::iterator it;
+   for (it = m_mapBlocks.begin(); it != m_mapBlocks.end(); it++)
+      {
+      uint64_t nBytes = (uint64_t)it->second->m_vafData.size() * sizeof(float);
+      LONG nRefCount  = it->second->m_nRefCount;
+      rsdpsss.nReferences  += (unsigned int)nRefCount;
+      rsdpsss.nBytes       += nBytes;
+      rsdpsss.nSavedBytes  += nBytes * (uint64_t)(nRefCount - 1);
+      }
+   LeaveCriticalSection(&m_csStore);
+}
+//------------------------------------------------------------------------------
@@ -0,0 +1,100 @@
+//------------------------------------------------------------------------------
+/// \file SoundDllPro_SampleStore.h
+/// \author Berg
+/// \brief Implementation of classes SDPSampleBlock and SDPSampleStore. Stores
+/// float sample data loaded from memory (command 'loadmem') once per content
+/// (or user key) and shares them read-only between all SDPOutputData instances
+/// using them.
+///
+/// Project SoundMexPro
+/// Module  SoundDllPro.dll
+///
+///
+/// ****************************************************************************
+/// Copyright 2023 Daniel Berg, Oldenburg, Germany
+/// ****************************************************************************
+///
+/// This file is part of SoundMexPro.
+///
+///    SoundMexPro is free software: you can redistribute it and/or modify
+///    it under the terms of the GNU General Public License as published by
+///    the Free Software Foundation, either version 3 of the License, or
+///    (at your option) any later version.
+///
+///    SoundMexPro is distributed in the hope that it will be useful,
+///    but WITHOUT ANY WARRANTY; without even the implied warranty of
+///    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+///    GNU General Public License for more details.
+///
+///    You should have received a copy of the GNU General Public License
+///    along with SoundMexPro.  If not, see <http:///www.gnu.org/licenses/>.
+///
+//------------------------------------------------------------------------------
+#ifndef SoundDllPro_SampleStoreH
+#define SoundDllPro_SampleStoreH
+//------------------------------------------------------------------------------
+#include <vcl.h>
+#include <stdint.h>
+#include <valarray>
+#include <map>
+
+class SDPSampleStore;
+//------------------------------------------------------------------------------
+/// reference counted block of float samples. Data must not be changed after
+/// creation. Never delete directly, call Release() instead
+//------------------------------------------------------------------------------
+class SDPSampleBlock
+{
+   friend class SDPSampleStore;
+   private:
+      volatile LONG        m_nRefCount;   /// reference count
+      SDPSampleStore*      m_psdpss;      /// store holding the block (NULL if not stored)
+      AnsiString           m_strKey;      /// key of block within store
+      ~SDPSampleBlock();
+   public:
+      std::valarray<float> m_vafData;     /// sample data
+      SDPSampleBlock(const double* pdData, unsigned int nSamples);
+      void                 AddRef();
+      void                 Release();
+};
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+/// statistics of sample store
+//------------------------------------------------------------------------------
+class SDPSampleStoreStats
+{
+   public:
+      unsigned int   nBlocks;          /// number of stored blocks
+      unsigned int   nReferences;      /// total number of references to stored blocks
+      uint64_t       nBytes;           /// memory used by stored blocks
+      uint64_t       nSavedBytes;      /// memory saved by sharing blocks
+      uint64_t       nHits;            /// number of requests served by existing blocks
+      uint64_t       nMisses;          /// number of requests that created new blocks
+};
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+/// store of shared sample blocks. Blocks are identified by a hash of their
+/// content or by a key passed by the user. Blocks are removed from the store
+/// when they are not referenced any longer
+//------------------------------------------------------------------------------
+class SDPSampleStore
+{
+   friend class SDPSampleBlock;
+   private:
+      static SDPSampleStore*  sm_psdpss;
+      std::map<AnsiString, SDPSampleBlock*> m_mapBlocks;
+      CRITICAL_SECTION        m_csStore;
+      uint64_t                m_nHits;
+      uint64_t                m_nMisses;
+      void                    Release(SDPSampleBlock* psdpsb);
+   public:
+      SDPSampleStore();
+      ~SDPSampleStore();
+      static SDPSampleStore*  Instance();
+      SDPSampleBlock*         Acquire(const double* pdData, unsigned int nSamples, AnsiString strKey = "");
+      void                    GetStats(SDPSampleStoreStats &rsdpsss);
+};
+//------------------------------------------------------------------------------
+#endif
@@ -49,6 +49,9 @@ SoundClassAsio::SoundClassAsio() :
    m_bCaptureDoneProcessed(false),
    m_bFreezeSampleRateOnStart(false)
 {
+   // let CAsio measure bufferSwitch callbacks and waits of processing thread
+   m_ppcCallback = &m_pcCallback;
+   m_ppcProcWait = &m_pcQueueWait;
 }
 //------------------------------------------------------------------------------
 
@@ -34,6 +34,7 @@
 //---------------------------------------------------------------------------
 
 #include <casio.h>
+#include "PerformanceCounter.h"
 
 
 //using namespace Asio;
@@ -70,6 +71,8 @@ class SoundClassBase
 {
    public:
       AnsiString           m_strFatalError;
+      CPerformanceCounter  m_pcCallback;     ///< time spent in driver callback per buffer
+      CPerformanceCounter  m_pcQueueWait;    ///< time processing waits for buffers in queues
       SoundClassBase();
       virtual ~SoundClassBase(void);
       // virtual, non-abstract functions
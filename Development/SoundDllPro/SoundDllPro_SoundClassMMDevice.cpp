@@ -44,6 +44,7 @@
 
 #include "soundmexpro_defs.h"
 #include "SoundDllPro_Tools.h"
+#include "SoundDllPro_Trace.h"
 
 //------------------------------------------------------------------------------
 
@@ -97,7 +98,11 @@ void __fastcall CHtMMDProcessingThread::Execute()
          // call processing
          if (dw == WAIT_OBJECT_0 + MMD_EVENT_PROCESS)
             {
+            m_phtmmd->m_pcCallback.Start();
+            SDPTrace::Begin("callback");
             m_phtmmd->Process();
+            SDPTrace::End("callback");
+            m_phtmmd->m_pcCallback.Stop();
             }
          // exit event
          else if (dw == WAIT_OBJECT_0 + MMD_EVENT_EXIT)
@@ -0,0 +1,813 @@
+//------------------------------------------------------------------------------
+/// \file SoundDllPro_SoundClassNull.cpp
+/// \author Berg
+/// \brief Implementation of sound class for SoundMexPro. Inherits form
+/// SoundClassBase. Implements all abstract functions for a 'null device'
+/// without any hardware driven by a virtual clock
+///
+/// Project SoundMexPro
+/// Module  SoundDllPro.dll
+///
+///
+/// ****************************************************************************
+/// Copyright 2023 Daniel Berg, Oldenburg, Germany
+/// ****************************************************************************
+///
+/// This file is part of SoundMexPro.
+///
+///    SoundMexPro is free software: you can redistribute it and/or modify
+///    it under the terms of the GNU General Public License as published by
+///    the Free Software Foundation, either version 3 of the License, or
+///    (at your option) any later version.
+///
+///    SoundMexPro is distributed in the hope that it will be useful,
+///    but WITHOUT ANY WARRANTY; without even the implied warranty of
+///    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+///    GNU General Public License for more details.
+///
+///    You should have received a copy of the GNU General Public License
+///    along with SoundMexPro.  If not, see <http:///www.gnu.org/licenses/>.
+///
+//------------------------------------------------------------------------------
+#pragma hdrstop
+
+#include "SoundDllPro_SoundClassNull.h"
+#pragma clang diagnostic push
+#pragma clang diagnostic ignored "-Wundef"
+#include <sndfile.h>
+#pragma clang diagnostic pop
+
+#include "soundmexpro_defs.h"
+#include "SoundDllPro_Tools.h"
+#include "SoundDllPro_Trace.h"
+
+//------------------------------------------------------------------------------
+
+#pragma package(smart_init)
+//------------------------------------------------------------------------------
+using namespace Asio;
+
+/// name of the one and only (virtual) driver
+#define NULLDEVICE_DRIVERNAME "SoundMexPro Null Device"
+
+//------------------------------------------------------------------------------
+/// CNullDeviceThread
+/// Clock thread of class SoundClassNull
+//------------------------------------------------------------------------------
+CNullDeviceThread::CNullDeviceThread(SoundClassNull* psc)
+:  TThread(true),
+   m_psc(psc)
+{
+   FreeOnTerminate = false;
+   Priority = tpHighest;
+   if (!m_psc)
+      throw Exception("invalid instance passed to clock thread");
+}
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+/// Thread function. Waits for start of device and calls processing of
+/// SoundClassNull for each clock tick while device is running
+//------------------------------------------------------------------------------
+void __fastcall CNullDeviceThread::Execute()
+{
+   while (!Terminated)
+      {
+      if (!m_psc->SoundIsRunning())
+         {
+         // wait for start or exit event
+         DWORD dw = WaitForMultipleObjects(NDEV_EVENT_NUMEVENTS, &m_psc->m_hEvents[0], false, 1000);
+         if (dw == WAIT_OBJECT_0 + NDEV_EVENT_EXIT)
+            Terminate();
+         continue;
+         }
+      // wait for next clock tick: returns false if exit event was set
+      if (!m_psc->WaitForClock())
+         {
+         Terminate();
+         continue;
+         }
+      m_psc->m_pcCallback.Start();
+      SDPTrace::Begin("callback");
+      m_psc->Process();
+      SDPTrace::End("callback");
+      m_psc->m_pcCallback.Stop();
+      }
+}
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+// contructor, initializes members, creates events and clock thread
+//------------------------------------------------------------------------------
+SoundClassNull::SoundClassNull()
+   :  SoundClassBase(),
+      m_pndt(NULL),
+      m_bDriverLoaded(false),
+      m_bInitialized(false),
+      m_bRunning(false),
+      m_bStopping(false),
+      m_dSampleRate(44100.0),
+      m_nBufsizeSamples(NULLDEVICE_DEFAULT_BUFSIZE),
+      m_ndc(NDC_REALTIME),
+      m_ndi(NDI_SILENCE),
+      m_nInputFilePos(0),
+      m_nSamplesPlayed(0),
+      m_nSampleStopPos(0),
+      m_nClockBuffers(0)
+{
+   InitializeCriticalSection(&m_csProcess);
+   QueryPerformanceFrequency(&m_liFrequency);
+   m_liClockStart.QuadPart = 0;
+
+   // Create events
+   int n;
+   for (n = 0; n < NDEV_EVENT_NUMEVENTS; n++)
+      m_hEvents[n] = NULL;
+   try
+      {
+      for (n = 0; n < NDEV_EVENT_NUMEVENTS; n++)
+         {
+         m_hEvents[n] = CreateEvent(NULL, FALSE, FALSE, NULL);
+         if (m_hEvents[n] == NULL)
+            throw Exception("error creating device event");
+         }
+      // create clock thread
+      m_pndt = new CNullDeviceThread(this);
+      m_pndt->Start();
+      }
+   catch (...)
+      {
+      Cleanup();
+      DeleteCriticalSection(&m_csProcess);
+      throw;
+      }
+}
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+// destructor, does cleanup
+//------------------------------------------------------------------------------
+SoundClassNull::~SoundClassNull()
+{
+   Cleanup();
+   DeleteCriticalSection(&m_csProcess);
+}
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+/// Does cleanup. Only to be called by destructor
+//------------------------------------------------------------------------------
+void SoundClassNull::Cleanup(void)
+{
+   try
+      {
+      SoundStop(false);
+      }
+   catch(...)
+      {
+      }
+
+   // if thread is still running, signal a break and wait for it
+   if (m_pndt && !m_pndt->Suspended)
+      {
+      SetEvent(m_hEvents[NDEV_EVENT_EXIT]);
+      m_pndt->WaitFor();
+      }
+   TRYDELETENULL(m_pndt);
+   int n;
+   for (n = 0; n < NDEV_EVENT_NUMEVENTS; n++)
+      {
+      if (m_hEvents[n])
+         {
+         CloseHandle(m_hEvents[n]);
+         m_hEvents[n] = NULL;
+         }
+      }
+}
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+// returns true if device is initialized or false otherwise
+//------------------------------------------------------------------------------
+bool SoundClassNull::SoundInitialized()
+{
+   return m_bInitialized;
+}
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+// loads (virtual) driver by index
+//------------------------------------------------------------------------------
+void SoundClassNull::SoundLoadDriverByIndex(size_t nIndex)
+{
+   if (nIndex >= SoundNumDrivers())
+      throw Exception("driver index out of range");
+
+   SoundLoadDriverByName(SoundDriverName((unsigned int)nIndex));
+}
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+// loads (virtual) driver by name
+//------------------------------------------------------------------------------
+void SoundClassNull::SoundLoadDriverByName(AnsiString strName)
+{
+   if (strName != NULLDEVICE_DRIVERNAME)
+      throw Exception("driver with requested name not found");
+   m_bDriverLoaded = true;
+   if (m_lpfnOnStateChange)
+      m_lpfnOnStateChange(Asio::LOADED);
+}
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+// unloads (virtual) driver
+//------------------------------------------------------------------------------
+void SoundClassNull::SoundUnloadDriver()
+{
+   SoundStop(false);
+   m_bDriverLoaded   = false;
+   m_bInitialized    = false;
+   if (m_lpfnOnStateChange)
+      m_lpfnOnStateChange(Asio::FREE);
+}
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+/// Reads configuration values from passed stringlist and initializes buffers
+/// and input source
+//------------------------------------------------------------------------------
+void SoundClassNull::SoundInit(TStringList* psl)
+{
+   if (SoundIsRunning())
+      throw Exception("cannot reinitialize device while it is running!");
+
+   if (!m_bDriverLoaded)
+      throw Exception("cannot init device before driver loaded");
+
+   m_bInitialized = false;
+   // channels are selected exactly like for ASIO driver model
+   m_vnOutChannels   = GetChannelSelection(psl, SOUNDDLLPRO_PAR_OUTPUT, "0,1");
+   m_vnInChannels    = GetChannelSelection(psl, SOUNDDLLPRO_PAR_INPUT, "-1");
+   m_nBufsizeSamples = (unsigned int)GetInt(psl, SOUNDDLLPRO_PAR_BUFSIZE, NULLDEVICE_DEFAULT_BUFSIZE, VAL_POS);
+
+   int n = (int)GetInt(psl, SOUNDDLLPRO_PAR_NULLCLOCK, NDC_REALTIME, VAL_POS_OR_ZERO);
+   if (n >= NDC_NUMCLOCKS)
+      throw Exception("invalid field in 'nullclock': must be 0 or 1");
+   m_ndc = (TNullDeviceClock)n;
+   n = (int)GetInt(psl, SOUNDDLLPRO_PAR_NULLINPUT, NDI_SILENCE, VAL_POS_OR_ZERO);
+   if (n >= NDI_NUMINPUTS)
+      throw Exception("invalid field in 'nullinput': must be between 0 and 2");
+   m_ndi = (TNullDeviceInput)n;
+   m_vvfInputFile.clear();
+   if (m_ndi == NDI_FILE)
+      LoadInputFile(psl->Values[SOUNDDLLPRO_PAR_NULLINPUTFILE]);
+
+   // finally initialize internal buffers
+   unsigned int nChannel;
+   m_vvfBufferOut.resize(m_vnOutChannels.size());
+   for (nChannel = 0; nChannel < m_vvfBufferOut.size(); nChannel++)
+      {
+      m_vvfBufferOut[nChannel].resize(m_nBufsizeSamples);
+      m_vvfBufferOut[nChannel] = 0.0f;
+      }
+   m_vvfBufferIn.resize(m_vnInChannels.size());
+   for (nChannel = 0; nChannel < m_vvfBufferIn.size(); nChannel++)
+      {
+      m_vvfBufferIn[nChannel].resize(m_nBufsizeSamples);
+      m_vvfBufferIn[nChannel] = 0.0f;
+      }
+
+   m_bInitialized = true;
+   if (m_lpfnOnStateChange)
+      m_lpfnOnStateChange(Asio::INITIALIZED);
+}
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+/// returns sorted indices of channels selected in field of passed string list.
+/// Field may contain a comma separated list of channel indices, 'all' or -1
+/// for no channels at all
+//------------------------------------------------------------------------------
+std::vector<unsigned int> SoundClassNull::GetChannelSelection(TStringList* psl, AnsiString strField, AnsiString strDefault)
+{
+   std::vector<unsigned int> vnChannels;
+   AnsiString str = psl->Values[strField];
+   if (str.IsEmpty())
+      str = strDefault;
+   int nChannelIndex;
+   if (!strcmpi(str.c_str(), SOUNDDLLPRO_PAR_ALL))
+      {
+      for (nChannelIndex = 0; nChannelIndex < NULLDEVICE_NUM_CHANNELS; nChannelIndex++)
+         vnChannels.push_back((unsigned int)nChannelIndex);
+      return vnChannels;
+      }
+   // -1: no channels at all
+   if (str == "-1")
+      return vnChannels;
+
+   TStringList *pslTmp = new TStringList();
+   try
+      {
+      pslTmp->Delimiter = ',';
+      pslTmp->DelimitedText = str;
+      for (int i = 0; i < pslTmp->Count; i++)
+         {
+         if (!TryStrToInt(pslTmp->Strings[i], nChannelIndex))
+            throw Exception("invalid field in '" + strField + "': not an integer");
+         if (nChannelIndex >= NULLDEVICE_NUM_CHANNELS || nChannelIndex < 0)
+            throw Exception("invalid field in '" + strField + "': out of range");
+         if (i && nChannelIndex <= (int)vnChannels.back())
+            throw Exception("invalid field in '" + strField + "': must be sorted ascending");
+         vnChannels.push_back((unsigned int)nChannelIndex);
+         }
+      }
+   __finally
+      {
+      TRYDELETENULL(pslTmp);
+      }
+   return vnChannels;
+}
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+/// reads complete sound file used as input source into memory. Samplerate of
+/// file must match current samplerate
+//------------------------------------------------------------------------------
+void SoundClassNull::LoadInputFile(AnsiString strFileName)
+{
+   if (strFileName.IsEmpty())
+      throw Exception("field 'nullinputfile' must be specified if 'nullinput' is 2");
+
+   SF_INFO sfi;
+   ZeroMemory(&sfi, sizeof(sfi));
+   SNDFILE* pSndFile = sf_open(strFileName.c_str(), SFM_READ, &sfi);
+   if (!pSndFile)
+      throw Exception("cannot open file '" + strFileName + "'");
+   try
+      {
+      if (sfi.samplerate != (int)m_dSampleRate)
+         throw Exception("samplerate of file '" + strFileName + "' does not match samplerate of device");
+      if (sfi.frames <= 0 || sfi.channels <= 0)
+         throw Exception("file '" + strFileName + "' is empty");
+      unsigned int nChannels  = (unsigned int)sfi.channels;
+      size_t       nFrames    = (size_t)sfi.frames;
+      std::vector<float> vfInterleaved(nFrames * nChannels);
+      if (sf_readf_float(pSndFile, &vfInterleaved[0], sfi.frames) != sfi.frames)
+         throw Exception("error reading file '" + strFileName + "'");
+      // de-interleave
+      m_vvfInputFile.resize(nChannels);
+      unsigned int nChannel;
+      size_t nFrame;
+      for (nChannel = 0; nChannel < nChannels; nChannel++)
+         {
+         m_vvfInputFile[nChannel].resize(nFrames);
+         for (nFrame = 0; nFrame < nFrames; nFrame++)
+            m_vvfInputFile[nChannel][nFrame] = vfInterleaved[nFrame * nChannels + nChannel];
+         }
+      }
+   __finally
+      {
+      sf_close(pSndFile);
+      }
+}
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+// returns number of (virtual) drivers: always one
+//------------------------------------------------------------------------------
+size_t SoundClassNull::SoundNumDrivers()
+{
+   return 1;
+}
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+// returns name of (virtual) driver by index
+//------------------------------------------------------------------------------
+AnsiString SoundClassNull::SoundDriverName(unsigned int iIndex)
+{
+   if (iIndex >= SoundNumDrivers())
+      throw Exception("driver index out of range");
+   return NULLDEVICE_DRIVERNAME;
+}
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+// returns index of current (virtual) driver
+//------------------------------------------------------------------------------
+unsigned int SoundClassNull::SoundCurrentDriverIndex(void)
+{
+   return 0;
+}
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+// returns number of input or ouput channels of (virtual) driver
+//------------------------------------------------------------------------------
+#pragma argsused
+long SoundClassNull::SoundChannels(Asio::Direction adDirection)
+{
+   return m_bDriverLoaded ? NULLDEVICE_NUM_CHANNELS : 0;
+}
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+// returns channel name of input or ouput channel of (virtual) driver
+//------------------------------------------------------------------------------
+AnsiString SoundClassNull::SoundChannelName(unsigned int iChannelIndex, Direction adDirection)
+{
+   if (iChannelIndex >= (unsigned int)SoundChannels(adDirection))
+      throw Exception("channel index out of range");
+   return (adDirection == Asio::INPUT ? "Null_In_" : "Null_Out_") + IntToStr((int)iChannelIndex);
+}
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+// returns number of ACTIVE input or output channels
+//------------------------------------------------------------------------------
+size_t SoundClassNull::SoundActiveChannels(Asio::Direction adDirection)
+{
+   return adDirection == Asio::INPUT ? m_vnInChannels.size() : m_vnOutChannels.size();
+}
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+// returns name of an ACTIVE input or output channel
+//------------------------------------------------------------------------------
+AnsiString SoundClassNull::SoundGetActiveChannelName(unsigned int iChannelIndex, Direction adDirection)
+{
+   if (iChannelIndex >= SoundActiveChannels(adDirection))
+      throw Exception("channel index out of range");
+   std::vector<unsigned int>& vn = adDirection == Asio::INPUT ? m_vnInChannels : m_vnOutChannels;
+   return SoundChannelName(vn[iChannelIndex], adDirection);
+}
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+// returns current buffer size
+//------------------------------------------------------------------------------
+long SoundClassNull::SoundBufsizeCurrent()
+{
+   return (long)m_nBufsizeSamples;
+}
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+// returns best buffer size: default buffer size of null device
+//------------------------------------------------------------------------------
+long SoundClassNull::SoundBufsizeBest()
+{
+   return NULLDEVICE_DEFAULT_BUFSIZE;
+}
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+// returns current number of buffers: no software buffers used
+//------------------------------------------------------------------------------
+long SoundClassNull::SoundNumBufOut()
+{
+   return 0;
+}
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+// starts device: resets counters and clock and wakes up clock thread
+//------------------------------------------------------------------------------
+void SoundClassNull::SoundStart()
+{
+   if (!SoundInitialized())
+      throw Exception("device is not initialized");
+   if (SoundIsRunning())
+      return;
+
+   m_nProcessCalls   = 0;
+   m_nSamplesPlayed  = 0;
+   m_nSampleStopPos  = 0;
+   m_nInputFilePos   = 0;
+   m_nClockBuffers   = 0;
+   unsigned int nChannel;
+   for (nChannel = 0; nChannel < m_vvfBufferOut.size(); nChannel++)
+      m_vvfBufferOut[nChannel] = 0.0f;
+   QueryPerformanceCounter(&m_liClockStart);
+
+   if (m_lpfnOnStateChange)
+      m_lpfnOnStateChange(Asio::RUNNING);
+
+   m_bStopping = false;
+   m_bRunning = true;
+   SetEvent(m_hEvents[NDEV_EVENT_START]);
+}
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+// stops device. Processing of current buffer is always completed before
+// (critical section). If called from a callback within the clock thread (e.g.
+// on reaching the run length), the stop is only requested: SoundIsStopping()
+// returns true and the clock thread stops the device after the callbacks of
+// the current buffer are done
+//------------------------------------------------------------------------------
+#pragma argsused
+void SoundClassNull::SoundStop(bool bWaitForStopDone)
+{
+   if (!SoundIsRunning())
+      return;
+
+   m_bStopping = true;
+   if (m_pndt && GetCurrentThreadId() == m_pndt->ThreadID)
+      return;
+   DoStop();
+}
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+// does the stop requested by SoundStop
+//------------------------------------------------------------------------------
+void SoundClassNull::DoStop(void)
+{
+   EnterCriticalSection(&m_csProcess);
+   try
+      {
+      if (!m_bRunning)
+         {
+         m_bStopping = false;
+         return;
+         }
+      m_bRunning = false;
+      m_bStopping = false;
+      m_nProcessCalls = 0;
+
+      if (m_lpfnOnStopComplete)
+         m_lpfnOnStopComplete();
+
+      if (m_lpfnOnStateChange)
+         m_lpfnOnStateChange(Asio::PREPARED);
+      }
+   __finally
+      {
+      LeaveCriticalSection(&m_csProcess);
+      }
+}
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+// returns true if state is RUNNING or false else
+//------------------------------------------------------------------------------
+bool SoundClassNull::SoundIsRunning()
+{
+   return m_bRunning;
+}
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+// returns m_bStopping
+//------------------------------------------------------------------------------
+bool SoundClassNull::SoundIsStopping()
+{
+   return m_bStopping;
+}
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+// returns maximum value of an active channel
+//------------------------------------------------------------------------------
+#pragma argsused
+float SoundClassNull::SoundActiveChannelMaxValue(Asio::Direction adDirection, size_t nChannel)
+{
+   // in this implementation values are always between 1 and -1
+   return 1.0f;
+}
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+// returns minimum value of an active channel
+//------------------------------------------------------------------------------
+#pragma argsused
+float SoundClassNull::SoundActiveChannelMinValue(Asio::Direction adDirection, size_t nChannel)
+{
+   // in this implementation values are always between 1 and -1
+   return -1.0f;
+}
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+// sets sample rate of device
+//------------------------------------------------------------------------------
+void SoundClassNull::SoundSetSampleRate(double dSampleRate)
+{
+   if (SoundIsRunning())
+      throw Exception("cannot reinitialize device while it is running!");
+   if (!SoundCanSampleRate(dSampleRate))
+      throw Exception("samplerate not supported");
+   m_dSampleRate = dSampleRate;
+}
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+// checks, if a particular samplerate is supported by device: all rates up to
+// NULLDEVICE_MAX_SAMPLERATE are supported
+//------------------------------------------------------------------------------
+bool SoundClassNull::SoundCanSampleRate(double dSampleRate)
+{
+   return dSampleRate > 0.0 && dSampleRate <= NULLDEVICE_MAX_SAMPLERATE;
+}
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+// returns current samplerate
+//------------------------------------------------------------------------------
+double SoundClassNull::SoundGetSampleRate(void)
+{
+   return m_dSampleRate;
+}
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+/// calls user defined XRun-function
+//------------------------------------------------------------------------------
+void SoundClassNull::OnXRun(void)
+{
+   if (m_lpfnOnXrun)
+      m_lpfnOnXrun(XR_PROC);
+}
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+/// calls user defined Error-function
+//------------------------------------------------------------------------------
+void SoundClassNull::OnError()
+{
+   if (m_lpfnOnError)
+      m_lpfnOnError();
+}
+//---------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+/// waits for next clock tick in clock thread. For NDC_REALTIME the n-th buffer
+/// is processed n buffer durations after start (like a device requesting
+/// buffers), if more than one buffer duration is missed an xrun is signalled
+/// and the clock restarts. For NDC_FAST it returns immediately.
+/// \retval false if exit event was set while waiting
+/// \retval true else
+//------------------------------------------------------------------------------
+bool SoundClassNull::WaitForClock(void)
+{
+   if (m_ndc == NDC_FAST)
+      return WaitForSingleObject(m_hEvents[NDEV_EVENT_EXIT], 0) != WAIT_OBJECT_0;
+
+   double  dTicksPerBuffer = (double)m_nBufsizeSamples * (double)m_liFrequency.QuadPart / m_dSampleRate;
+   int64_t nDeadline       = m_liClockStart.QuadPart + (int64_t)((double)(m_nClockBuffers + 1) * dTicksPerBuffer);
+   LARGE_INTEGER li;
+   QueryPerformanceCounter(&li);
+   if (li.QuadPart - nDeadline > (int64_t)dTicksPerBuffer)
+      {
+      OnXRun();
+      m_liClockStart  = li;
+      m_nClockBuffers = 0;
+      return true;
+      }
+   DWORD dwMs;
+   while (li.QuadPart < nDeadline)
+      {
+      // sleep coarse (system timer resolution), remaining time is yielded
+      dwMs = (DWORD)((nDeadline - li.QuadPart) * 1000 / m_liFrequency.QuadPart);
+      if (WaitForSingleObject(m_hEvents[NDEV_EVENT_EXIT], dwMs > 1 ? dwMs - 1 : 0) == WAIT_OBJECT_0)
+         return false;
+      QueryPerformanceCounter(&li);
+      }
+   m_nClockBuffers++;
+   return true;
+}
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+/// fills input buffers from input source. NOTE: for NDI_LOOPBACK the output
+/// buffer still contains the last played buffer here
+//------------------------------------------------------------------------------
+void SoundClassNull::GetInput(void)
+{
+   unsigned int nChannel, nOutChannel;
+   for (nChannel = 0; nChannel < m_vvfBufferIn.size(); nChannel++)
+      {
+      std::valarray<float>& vaf = m_vvfBufferIn[nChannel];
+      vaf = 0.0f;
+      if (m_ndi == NDI_LOOPBACK)
+         {
+         // input channel gets output channel with same index (if active)
+         for (nOutChannel = 0; nOutChannel < m_vnOutChannels.size(); nOutChannel++)
+            {
+            if (m_vnOutChannels[nOutChannel] == m_vnInChannels[nChannel])
+               {
+               vaf = m_vvfBufferOut[nOutChannel];
+               break;
+               }
+            }
+         }
+      else if (m_ndi == NDI_FILE)
+         {
+         // file channels are used cyclically, file is looped
+         std::valarray<float>& vafFile = m_vvfInputFile[nChannel % m_vvfInputFile.size()];
+         uint64_t nPos = m_nInputFilePos;
+         for (unsigned int n = 0; n < m_nBufsizeSamples; n++)
+            {
+            vaf[n] = vafFile[(size_t)nPos];
+            if (++nPos >= vafFile.size())
+               nPos = 0;
+            }
+         }
+      }
+   if (m_ndi == NDI_FILE && !m_vvfInputFile.empty())
+      m_nInputFilePos = (m_nInputFilePos + m_nBufsizeSamples) % m_vvfInputFile[0].size();
+}
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+/// Processing called in clock thread by CNullDeviceThread::Execute: calls
+/// processing, play and done callbacks for one buffer
+//------------------------------------------------------------------------------
+void SoundClassNull::Process(void)
+{
+   unsigned int nChannel;
+   bool bIsLast      = false;
+   bool bIsLastDone  = false;
+   EnterCriticalSection(&m_csProcess);
+   try
+      {
+      try
+         {
+         // device may have been stopped while we were waiting for the lock
+         if (m_bRunning)
+            {
+            m_nProcessCalls++;
+            GetInput();
+            for (nChannel = 0; nChannel < m_vvfBufferOut.size(); nChannel++)
+               m_vvfBufferOut[nChannel] = 0.0f;
+
+            if (m_lpfnOnProcess)
+               m_lpfnOnProcess(m_vvfBufferIn, m_vvfBufferOut, bIsLast);
+
+            // store position, where last buffer was processed
+            if (bIsLast && !m_nSampleStopPos)
+               m_nSampleStopPos = m_nSamplesPlayed + m_nBufsizeSamples;
+
+            if (m_lpfnOnBufferPlay)
+               m_lpfnOnBufferPlay(m_vvfBufferOut);
+
+            if (m_lpfnOnBufferDone)
+               m_lpfnOnBufferDone(m_vvfBufferIn, m_vvfBufferOut, bIsLastDone);
+
+            m_nSamplesPlayed += m_nBufsizeSamples;
+            }
+         }
+      __finally
+         {
+         LeaveCriticalSection(&m_csProcess);
+         }
+      }
+   catch (Exception &e)
+      {
+      m_strProcessingError = e.Message;
+      try
+         {
+         DoStop();
+         }
+      catch (...)
+         {
+         }
+      OnError();
+      }
+   // if m_nSampleStopPos was set above then we do the automatic stop, if this
+   // position was reached in playback
+   if (m_nSampleStopPos > 0 && m_nSamplesPlayed >= m_nSampleStopPos)
+      {
+      try
+         {
+         m_nSampleStopPos = 0;
+         DoStop();
+         }
+      catch (...)
+         {
+         }
+      }
+   // stop requested by a callback
+   else if (m_bStopping)
+      {
+      try
+         {
+         DoStop();
+         }
+      catch (...)
+         {
+         }
+      }
+}
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+/// returns description of sound format
+//------------------------------------------------------------------------------
+AnsiString SoundClassNull::SoundFormatString()
+{
+   return "32-bit IEEE float (null device)";
+}
+//------------------------------------------------------------------------------
@@ -0,0 +1,177 @@
+//------------------------------------------------------------------------------
+/// \file SoundDllPro_SoundClassNull.h
+/// \author Berg
+/// \brief Interface of sound class for SoundMexPro. Inherits form
+/// SoundClassBase. Implements all abstract functions for a 'null device'
+/// without any hardware driven by a virtual clock
+///
+/// Project SoundMexPro
+/// Module  SoundDllPro.dll
+///
+///
+/// ****************************************************************************
+/// Copyright 2023 Daniel Berg, Oldenburg, Germany
+/// ****************************************************************************
+///
+/// This file is part of SoundMexPro.
+///
+///    SoundMexPro is free software: you can redistribute it and/or modify
+///    it under the terms of the GNU General Public License as published by
+///    the Free Software Foundation, either version 3 of the License, or
+///    (at your option) any later version.
+///
+///    SoundMexPro is distributed in the hope that it will be useful,
+///    but WITHOUT ANY WARRANTY; without even the implied warranty of
+///    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+///    GNU General Public License for more details.
+///
+///    You should have received a copy of the GNU General Public License
+///    along with SoundMexPro.  If not, see <http:///www.gnu.org/licenses/>.
+///
+//------------------------------------------------------------------------------
+#ifndef SoundDllPro_SoundClassNullH
+#define SoundDllPro_SoundClassNullH
+//---------------------------------------------------------------------------
+
+#include <windows.h>
+#include "SoundDllPro_SoundClassBase.h"
+#include <casioEnums.h>
+
+/// number of (virtual) hardware channels per direction
+#define NULLDEVICE_NUM_CHANNELS     64
+/// default buffer size
+#define NULLDEVICE_DEFAULT_BUFSIZE  512
+/// maximum sample rate
+#define NULLDEVICE_MAX_SAMPLERATE   384000
+
+//------------------------------------------------------------------------------
+/// enum for clock modes of null device
+//------------------------------------------------------------------------------
+enum TNullDeviceClock
+{
+   NDC_REALTIME = 0,       /// buffers are processed in real time
+   NDC_FAST,               /// buffers are processed as fast as possible
+   NDC_NUMCLOCKS
+};
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+/// enum for input sources of null device
+//------------------------------------------------------------------------------
+enum TNullDeviceInput
+{
+   NDI_SILENCE = 0,        /// inputs are zero
+   NDI_LOOPBACK,           /// inputs contain last played output buffer
+   NDI_FILE,               /// inputs are read from a sound file (looped)
+   NDI_NUMINPUTS
+};
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+/// enum for module events
+//------------------------------------------------------------------------------
+enum TNullDeviceEvents
+{
+   NDEV_EVENT_START = 0,
+   NDEV_EVENT_EXIT,
+   NDEV_EVENT_NUMEVENTS
+};
+//------------------------------------------------------------------------------
+
+/// forward declarations
+class    SoundClassNull;
+
+//------------------------------------------------------------------------------
+/// \class CNullDeviceThread, clock thread used by SoundClassNull, prefix ndt
+//------------------------------------------------------------------------------
+class CNullDeviceThread : public TThread
+{
+   public:
+      CNullDeviceThread(SoundClassNull* psc);
+   protected:
+      SoundClassNull*   m_psc;         ///< owning SoundClassNull instance
+      void __fastcall   Execute();
+};
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+/// \class SoundClassNull. Inherits SoundClassBase.
+/// Implements all abstract functions for a device without hardware. A clock
+/// thread calls processing, play and done callbacks for each buffer either in
+/// real time or as fast as possible. Input data are silence, a loopback of
+/// the output or data from a sound file.
+/// NOTE: the callbacks are called directly in the clock thread. The
+/// SoundDataExchanger queues and the processing and done threads of CAsio
+/// (and their xrun handling) are not used: the exchanger is bound to the
+/// CAsio instance and its driver buffers
+//------------------------------------------------------------------------------
+class SoundClassNull : public SoundClassBase
+{
+   friend class CNullDeviceThread;
+
+   private:
+      CRITICAL_SECTION           m_csProcess;         ///< critical section processing
+      CNullDeviceThread*         m_pndt;              ///< clock thread instance
+      HANDLE                     m_hEvents[NDEV_EVENT_NUMEVENTS];  ///< array with events for starting/exiting
+      bool                       m_bDriverLoaded;     ///< flag if (virtual) driver is loaded
+      bool                       m_bInitialized;      ///< flag if device is initialized
+      volatile bool              m_bRunning;          ///< flag if sound is running
+      volatile bool              m_bStopping;         ///< flag if device is stopping (stop requested in clock thread)
+      double                     m_dSampleRate;       ///< current samplerate
+      unsigned int               m_nBufsizeSamples;   ///< buffer size in samples
+      TNullDeviceClock           m_ndc;               ///< clock mode
+      TNullDeviceInput           m_ndi;               ///< input source
+      std::vector<unsigned int>  m_vnOutChannels;     ///< indices of active output channels
+      std::vector<unsigned int>  m_vnInChannels;      ///< indices of active input channels
+      vvf                        m_vvfBufferIn;       ///< internal input buffer
+      vvf                        m_vvfBufferOut;      ///< internal output buffer
+      vvf                        m_vvfInputFile;      ///< data of input file
+      uint64_t                   m_nInputFilePos;     ///< current read position in input file
+      uint64_t                   m_nSamplesPlayed;    ///< samples played since start
+      uint64_t                   m_nSampleStopPos;    ///< position of last buffer to play
+      LARGE_INTEGER              m_liFrequency;       ///< performance counter frequency
+      LARGE_INTEGER              m_liClockStart;      ///< performance counter at clock start
+      uint64_t                   m_nClockBuffers;     ///< buffers processed since clock start
+      AnsiString                 m_strProcessingError;   ///< string for storing 'type' of processing error
+
+      void                       Cleanup(void);
+      std::vector<unsigned int>  GetChannelSelection(TStringList* psl, AnsiString strField, AnsiString strDefault);
+      void                       LoadInputFile(AnsiString strFileName);
+      void                       GetInput(void);
+      bool                       WaitForClock(void);
+      void                       Process(void);
+      void                       DoStop(void);
+      void                       OnXRun(void);
+      void                       OnError(void);
+   public:
+      SoundClassNull();
+      ~SoundClassNull();
+      virtual void         SoundInit(TStringList* psl);
+      virtual bool         SoundInitialized();
+      virtual void         SoundLoadDriverByIndex(size_t nIndex);
+      virtual void         SoundLoadDriverByName(AnsiString strName);
+      virtual void         SoundUnloadDriver();
+      virtual size_t       SoundNumDrivers();
+      virtual AnsiString   SoundDriverName(unsigned int iIndex);
+      virtual unsigned int SoundCurrentDriverIndex(void);
+      virtual long         SoundChannels(Asio::Direction adDirection);
+      virtual AnsiString   SoundChannelName(unsigned int iChannelIndex, Asio::Direction adDirection);
+      virtual void         SoundStart();
+      virtual void         SoundStop(bool bWaitForStopDone);
+      virtual bool         SoundIsRunning();
+      virtual bool         SoundIsStopping();
+      virtual size_t       SoundActiveChannels(Asio::Direction adDirection);
+      virtual AnsiString   SoundGetActiveChannelName(unsigned int iChannelIndex, Asio::Direction adDirection);
+      virtual long         SoundBufsizeCurrent();
+      virtual long         SoundBufsizeBest();
+      virtual long         SoundNumBufOut();
+      virtual void         SoundSetSampleRate(double dSampleRate);
+      virtual bool         SoundCanSampleRate(double dSampleRate);
+      virtual double       SoundGetSampleRate(void);
+      virtual float        SoundActiveChannelMaxValue(Asio::Direction adDirection, size_t nChannel);
+      virtual float        SoundActiveChannelMinValue(Asio::Direction adDirection, size_t nChannel);
+      virtual AnsiString   SoundFormatString();
+};
+//------------------------------------------------------------------------------
+
+#endif
@@ -39,6 +39,7 @@
 #include "formAbout.h"
 #include "VersionCheck.h"
 #include "frmVersionCheck.h"
+#include "HanningWindow.h"
 
 #pragma warn -use
 
@@ -92,7 +93,8 @@ AnsiString  GetLatestVersion(bool &rbUpdate)
 //------------------------------------------------------------------------------
 
 //------------------------------------------------------------------------------
-/// returns value of a hanning ramp
+/// returns value of a hanning ramp. Value is read from shared hanning table
+/// (see AcquireHanningTable)
 //------------------------------------------------------------------------------
 float GetHanningRamp(unsigned int uWindowPos, unsigned int uWindowLen, bool bUp)
 {
@@ -105,7 +107,10 @@ float GetHanningRamp(unsigned int uWindowPos, unsigned int uWindowLen, bool bUp)
       }
    if (!bUp)
       uWindowPos = uWindowLen - uWindowPos;
-   return (float)(0.5 - 0.5*cos(M_PI*(double)(uWindowPos)/(double)uWindowLen));
+   const float* pfTable = AcquireHanningTable(uWindowLen);
+   float f = pfTable[uWindowPos];
+   ReleaseHanningTable(pfTable);
+   return f;
 }
 //------------------------------------------------------------------------------
 
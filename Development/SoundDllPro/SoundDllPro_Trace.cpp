@@ -0,0 +1,424 @@
+//------------------------------------------------------------------------------
+/// \file SoundDllPro_Trace.cpp
+/// \author Berg
+/// \brief Implementation of class SDPTrace. Fixed size lock-free ring of
+/// timestamped begin/end events with export to Chrome/Perfetto trace JSON
+///
+/// Project SoundMexPro
+/// Module  SoundDllPro.dll
+///
+///
+/// ****************************************************************************
+/// Copyright 2023 Daniel Berg, Oldenburg, Germany
+/// ****************************************************************************
+///
+/// This file is part of SoundMexPro.
+///
+///    SoundMexPro is free software: you can redistribute it and/or modify
+///    it under the terms of the GNU General Public License as published by
+///    the Free Software Foundation, either version 3 of the License, or
+///    (at your option) any later version.
+///
+///    SoundMexPro is distributed in the hope that it will be useful,
+///    but WITHOUT ANY WARRANTY; without even the implied warranty of
+///    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+///    GNU General Public License for more details.
+///
+///    You should have received a copy of the GNU General Public License
+///    along with SoundMexPro.  If not, see <http:///www.gnu.org/licenses/>.
+///
+//------------------------------------------------------------------------------
+#include <vcl.h>
+#pragma hdrstop
+
+#include <stdio.h>
+#include "SoundDllPro_Trace.h"
+#include "PerformanceCounter.h"
+#pragma package(smart_init)
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+/// static trace instance, set by constructor of SDPTrace
+//------------------------------------------------------------------------------
+SDPTrace* volatile SDPTrace::sm_psdpt = NULL;
+
+//------------------------------------------------------------------------------
+/// number of threads currently writing to static trace instance
+//------------------------------------------------------------------------------
+volatile LONG SDPTrace::sm_nWriters = 0;
+
+//------------------------------------------------------------------------------
+/// constructor. Allocates ring with nSize rounded up to the next power of two,
+/// starts thread writing trace on xruns (if an xrun file is passed) and sets
+/// static member SDPTrace::sm_psdpt
+//------------------------------------------------------------------------------
+SDPTrace::SDPTrace(unsigned int nSize, const char* lpcszXrunFile)
+   :  m_nWrite(0),
+      m_nBuffer(0),
+      m_nDumpBusy(0),
+      m_hDumpThread(NULL)
+{
+   m_hDumpEvents[SDPTRACE_DUMPEVENT_STOP] = NULL;
+   m_hDumpEvents[SDPTRACE_DUMPEVENT_DUMP] = NULL;
+   if (sm_psdpt)
+      throw Exception("trace already created");
+   if (nSize < 2 || nSize > 0x1000000)
+      throw Exception("invalid trace size");
+   unsigned int nRingSize = 2;
+   while (nRingSize < nSize)
+      nRingSize <<= 1;
+   m_vEvents.resize(nRingSize);
+   for (unsigned int n = 0; n < nRingSize; n++)
+      m_vEvents[n].nSequence = 0;
+   m_nMask = (LONG)(nRingSize - 1);
+   m_szXrunFile[0] = '\0';
+   if (lpcszXrunFile)
+      lstrcpynA(m_szXrunFile, lpcszXrunFile, MAX_PATH);
+   m_dTicksPerSecond = CPerformanceCounter::GetTicksPerSecond();
+   // the dump thread is created here once: OnXrun is called from the audio
+   // callback and only sets the dump event
+   if (m_szXrunFile[0])
+      {
+      try
+         {
+         m_hDumpEvents[SDPTRACE_DUMPEVENT_STOP] = CreateEvent(NULL, TRUE, FALSE, NULL);
+         m_hDumpEvents[SDPTRACE_DUMPEVENT_DUMP] = CreateEvent(NULL, FALSE, FALSE, NULL);
+         if (!m_hDumpEvents[SDPTRACE_DUMPEVENT_STOP] || !m_hDumpEvents[SDPTRACE_DUMPEVENT_DUMP])
+            throw Exception("error creating trace dump events");
+         m_hDumpThread = CreateThread(NULL, 0, DumpThreadProc, this, 0, NULL);
+         if (!m_hDumpThread)
+            throw Exception("error creating trace dump thread");
+         }
+      catch (...)
+         {
+         CloseDumpThread();
+         throw;
+         }
+      }
+   sm_psdpt = this;
+}
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+/// destructor. Resets static member, waits for writers still using the
+/// instance and stops xrun dump thread
+//------------------------------------------------------------------------------
+SDPTrace::~SDPTrace()
+{
+   // NOTE: interlocked exchange is a full barrier: every writer registered
+   // before is seen by the loop below, every later one reads NULL
+   InterlockedExchangePointer((PVOID volatile*)&sm_psdpt, NULL);
+   while (sm_nWriters)
+      Sleep(0);
+   CloseDumpThread();
+}
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+/// stops dump thread (a running dump is completed) and closes its handles
+//------------------------------------------------------------------------------
+void SDPTrace::CloseDumpThread()
+{
+   if (m_hDumpThread)
+      {
+      SetEvent(m_hDumpEvents[SDPTRACE_DUMPEVENT_STOP]);
+      WaitForSingleObject(m_hDumpThread, INFINITE);
+      CloseHandle(m_hDumpThread);
+      m_hDumpThread = NULL;
+      }
+   for (int i = 0; i < 2; i++)
+      {
+      if (m_hDumpEvents[i])
+         {
+         CloseHandle(m_hDumpEvents[i]);
+         m_hDumpEvents[i] = NULL;
+         }
+      }
+}
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+/// returns static trace instance (may be NULL)
+//------------------------------------------------------------------------------
+SDPTrace* SDPTrace::Instance()
+{
+   return sm_psdpt;
+}
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+/// registers calling thread as writer and returns static trace instance. If
+/// no instance exists, NULL is returned and the writer is not registered.
+/// Otherwise ReleaseWriter must be called when the instance is not used any
+/// longer
+//------------------------------------------------------------------------------
+SDPTrace* SDPTrace::AcquireWriter()
+{
+   if (!sm_psdpt)
+      return NULL;
+   // NOTE: increment before re-reading the pointer (see destructor)
+   InterlockedIncrement(&sm_nWriters);
+   SDPTrace* psdpt = sm_psdpt;
+   if (!psdpt)
+      InterlockedDecrement(&sm_nWriters);
+   return psdpt;
+}
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+/// unregisters a writer registered by AcquireWriter
+//------------------------------------------------------------------------------
+void SDPTrace::ReleaseWriter()
+{
+   InterlockedDecrement(&sm_nWriters);
+}
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+/// writes a begin event if trace exists
+//------------------------------------------------------------------------------
+void SDPTrace::Begin(const char* lpcszName)
+{
+   SDPTrace* psdpt = AcquireWriter();
+   if (psdpt)
+      {
+      psdpt->Add('B', lpcszName);
+      ReleaseWriter();
+      }
+}
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+/// writes an end event if trace exists
+//------------------------------------------------------------------------------
+void SDPTrace::End(const char* lpcszName)
+{
+   SDPTrace* psdpt = AcquireWriter();
+   if (psdpt)
+      {
+      psdpt->Add('E', lpcszName);
+      ReleaseWriter();
+      }
+}
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+/// writes an instant event if trace exists
+//------------------------------------------------------------------------------
+void SDPTrace::Instant(const char* lpcszName)
+{
+   SDPTrace* psdpt = AcquireWriter();
+   if (psdpt)
+      {
+      psdpt->Add('i', lpcszName);
+      ReleaseWriter();
+      }
+}
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+/// sets index of buffer currently processed. Used as tag for all events
+/// written afterwards by any thread
+//------------------------------------------------------------------------------
+void SDPTrace::SetBuffer(int64_t nBuffer)
+{
+   SDPTrace* psdpt = AcquireWriter();
+   if (psdpt)
+      {
+      InterlockedExchange64(&psdpt->m_nBuffer, (LONGLONG)nBuffer);
+      ReleaseWriter();
+      }
+}
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+/// writes an xrun event and starts xrun dump (see OnXrun) if trace exists
+//------------------------------------------------------------------------------
+void SDPTrace::Xrun(const char* lpcszName)
+{
+   SDPTrace* psdpt = AcquireWriter();
+   if (psdpt)
+      {
+      psdpt->OnXrun(lpcszName);
+      ReleaseWriter();
+      }
+}
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+/// writes an event to the ring. Slot is reserved by an atomic increment of
+/// the write index. The sequence number of the slot is cleared while the event
+/// is written and set to write index + 1 afterwards
+//------------------------------------------------------------------------------
+void SDPTrace::Add(char cPhase, const char* lpcszName)
+{
+   int64_t nTicks = CPerformanceCounter::GetTicks();
+   LONG nIndex = InterlockedIncrement(&m_nWrite) - 1;
+   SDPTraceEvent &rEvent = m_vEvents[(unsigned int)(nIndex & m_nMask)];
+   InterlockedExchange(&rEvent.nSequence, 0);
+   rEvent.cPhase     = cPhase;
+   rEvent.dwThread   = GetCurrentThreadId();
+   // NOTE: atomic 64bit read (also in 32bit processes)
+   rEvent.nBuffer    = InterlockedCompareExchange64(&m_nBuffer, 0, 0);
+   rEvent.nTicks     = nTicks;
+   lstrcpynA(rEvent.szName, lpcszName ? lpcszName : "", SDPTRACE_NAMELEN);
+   InterlockedExchange(&rEvent.nSequence, nIndex + 1);
+}
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+/// copies all completely written events of the ring (oldest first). Events
+/// that are overwritten while being copied are skipped
+//------------------------------------------------------------------------------
+void SDPTrace::Snapshot(std::vector<SDPTraceEvent> &rvEvents)
+{
+   rvEvents.clear();
+   unsigned long nSize  = (unsigned long)m_nMask + 1;
+   unsigned long nEnd   = (unsigned long)m_nWrite;
+   // NOTE: unsigned arithmetic handles wrap around of write index
+   unsigned long nCount = nEnd < nSize && m_vEvents[nSize-1].nSequence == 0 ? nEnd : nSize;
+   rvEvents.reserve(nCount);
+   SDPTraceEvent sdpte;
+   for (unsigned long n = nEnd - nCount; n != nEnd; n++)
+      {
+      const SDPTraceEvent &rEvent = m_vEvents[n & (unsigned long)m_nMask];
+      LONG nSequence = rEvent.nSequence;
+      if (nSequence != (LONG)(n + 1))
+         continue;
+      MemoryBarrier();
+      sdpte.cPhase   = rEvent.cPhase;
+      sdpte.dwThread = rEvent.dwThread;
+      sdpte.nBuffer  = rEvent.nBuffer;
+      sdpte.nTicks   = rEvent.nTicks;
+      memcpy(sdpte.szName, rEvent.szName, SDPTRACE_NAMELEN);
+      MemoryBarrier();
+      if (rEvent.nSequence != nSequence)
+         continue;
+      sdpte.nSequence = nSequence;
+      sdpte.szName[SDPTRACE_NAMELEN-1] = '\0';
+      rvEvents.push_back(sdpte);
+      }
+}
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+/// returns size of ring in events
+//------------------------------------------------------------------------------
+unsigned int SDPTrace::Size()
+{
+   return (unsigned int)m_vEvents.size();
+}
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+/// writes events of the last dSeconds (relative to newest event, all events
+/// if dSeconds is <= 0) to file in Chrome/Perfetto trace JSON format
+//------------------------------------------------------------------------------
+void SDPTrace::Dump(const char* lpcszFileName, double dSeconds)
+{
+   std::vector<SDPTraceEvent> vEvents;
+   Snapshot(vEvents);
+
+   int64_t nNewest = 0;
+   int64_t nOldest = 0;
+   unsigned int n;
+   for (n = 0; n < vEvents.size(); n++)
+      {
+      if (!n || vEvents[n].nTicks > nNewest)
+         nNewest = vEvents[n].nTicks;
+      }
+   int64_t nFirst = nNewest - (int64_t)(dSeconds * m_dTicksPerSecond);
+   bool bFirst = true;
+   for (n = 0; n < vEvents.size(); n++)
+      {
+      if (dSeconds > 0.0 && vEvents[n].nTicks < nFirst)
+         continue;
+      if (bFirst || vEvents[n].nTicks < nOldest)
+         nOldest = vEvents[n].nTicks;
+      bFirst = false;
+      }
+
+   FILE* pf = fopen(lpcszFileName, "w");
+   if (!pf)
+      throw Exception("error creating trace file '" + AnsiString(lpcszFileName) + "'");
+   try
+      {
+      DWORD dwPid = GetCurrentProcessId();
+      bFirst = true;
+      fprintf(pf, "{\"traceEvents\":[");
+      for (n = 0; n < vEvents.size(); n++)
+         {
+         const SDPTraceEvent &rEvent = vEvents[n];
+         if (dSeconds > 0.0 && rEvent.nTicks < nFirst)
+            continue;
+         fprintf(pf, "%s\n{\"name\":\"", bFirst ? "" : ",");
+         bFirst = false;
+         // escape characters not allowed in JSON strings
+         for (const char* lpc = rEvent.szName; *lpc; lpc++)
+            {
+            if (*lpc == '"' || *lpc == '\\')
+               fprintf(pf, "\\%c", *lpc);
+            else if ((unsigned char)*lpc < 0x20)
+               fprintf(pf, "\\u%04x", (unsigned int)(unsigned char)*lpc);
+            else
+               fputc(*lpc, pf);
+            }
+         fprintf(pf, "\",\"ph\":\"%c\",\"ts\":%.3f,\"pid\":%lu,\"tid\":%lu,",
+                 rEvent.cPhase,
+                 (double)(rEvent.nTicks - nOldest) * 1000000.0 / m_dTicksPerSecond,
+                 (unsigned long)dwPid,
+                 (unsigned long)rEvent.dwThread
+                 );
+         if (rEvent.cPhase == 'i')
+            fprintf(pf, "\"s\":\"g\",");
+         fprintf(pf, "\"args\":{\"buf\":%ld}}", (long)rEvent.nBuffer);
+         }
+      fprintf(pf, "\n],\"displayTimeUnit\":\"ms\"}\n");
+      if (ferror(pf))
+         throw Exception("error writing trace file '" + AnsiString(lpcszFileName) + "'");
+      }
+   __finally
+      {
+      fclose(pf);
+      }
+}
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+/// writes an instant event and signals the dump thread to write the trace of
+/// the last SDPTRACE_XRUNSECONDS seconds to xrun file (if configured). Does
+/// nothing if a dump is still pending or running
+//------------------------------------------------------------------------------
+void SDPTrace::OnXrun(const char* lpcszName)
+{
+   Add('i', lpcszName);
+   if (!m_hDumpThread)
+      return;
+   if (InterlockedExchange(&m_nDumpBusy, 1))
+      return;
+   if (!SetEvent(m_hDumpEvents[SDPTRACE_DUMPEVENT_DUMP]))
+      InterlockedExchange(&m_nDumpBusy, 0);
+}
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+/// thread procedure for writing trace on xruns. Waits for dump or stop event.
+/// Errors are ignored, because they cannot be reported from here
+//------------------------------------------------------------------------------
+DWORD WINAPI SDPTrace::DumpThreadProc(LPVOID pParam)
+{
+   SDPTrace* psdpt = (SDPTrace*)pParam;
+   while (WaitForMultipleObjects(2, psdpt->m_hDumpEvents, FALSE, INFINITE) == WAIT_OBJECT_0 + SDPTRACE_DUMPEVENT_DUMP)
+      {
+      try
+         {
+         psdpt->Dump(psdpt->m_szXrunFile, SDPTRACE_XRUNSECONDS);
+         }
+      catch (...)
+         {
+         }
+      InterlockedExchange(&psdpt->m_nDumpBusy, 0);
+      }
+   return 0;
+}
+//------------------------------------------------------------------------------
@@ -0,0 +1,128 @@
+//------------------------------------------------------------------------------
+/// \file SoundDllPro_Trace.h
+/// \author Berg
+/// \brief Interface of classes SDPTrace and SDPTraceScope. SDPTrace is a fixed
+/// size lock-free ring of timestamped begin/end events written by all threads
+/// involved in processing. The last N seconds can be written as Chrome/Perfetto
+/// trace JSON (on command or automatically on xruns).
+///
+/// Project SoundMexPro
+/// Module  SoundDllPro.dll
+///
+///
+/// ****************************************************************************
+/// Copyright 2023 Daniel Berg, Oldenburg, Germany
+/// ****************************************************************************
+///
+/// This file is part of SoundMexPro.
+///
+///    SoundMexPro is free software: you can redistribute it and/or modify
+///    it under the terms of the GNU General Public License as published by
+///    the Free Software Foundation, either version 3 of the License, or
+///    (at your option) any later version.
+///
+///    SoundMexPro is distributed in the hope that it will be useful,
+///    but WITHOUT ANY WARRANTY; without even the implied warranty of
+///    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+///    GNU General Public License for more details.
+///
+///    You should have received a copy of the GNU General Public License
+///    along with SoundMexPro.  If not, see <http:///www.gnu.org/licenses/>.
+///
+//------------------------------------------------------------------------------
+#ifndef SoundDllPro_TraceH
+#define SoundDllPro_TraceH
+//------------------------------------------------------------------------------
+#include <windows.h>
+#include <stdint.h>
+#include <vector>
+//------------------------------------------------------------------------------
+
+/// maximum length of an event name (longer names are truncated)
+#define SDPTRACE_NAMELEN         48
+/// default length in seconds of trace written on xruns
+#define SDPTRACE_XRUNSECONDS     2.0
+
+//------------------------------------------------------------------------------
+/// enumeration of events of xrun dump thread
+//------------------------------------------------------------------------------
+enum SDPTraceDumpEvents
+{
+   SDPTRACE_DUMPEVENT_STOP = 0,
+   SDPTRACE_DUMPEVENT_DUMP
+};
+
+//------------------------------------------------------------------------------
+/// single event of trace ring. nSequence is zero while the event is written
+/// and the (1-based) write index of the event afterwards
+//------------------------------------------------------------------------------
+class SDPTraceEvent
+{
+   public:
+      volatile LONG  nSequence;                 ///< write index + 1, 0 while writing
+      char           cPhase;                    ///< 'B' (begin), 'E' (end) or 'i' (instant)
+      DWORD          dwThread;                  ///< id of writing thread
+      int64_t        nBuffer;                   ///< index of buffer processed when written
+      int64_t        nTicks;                    ///< timestamp in ticks of CPerformanceCounter
+      char           szName[SDPTRACE_NAMELEN];  ///< event name
+};
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+/// \class SDPTrace. Lock-free trace ring. Writers reserve a slot with an
+/// atomic increment of the write index, so any number of threads can write
+/// concurrently without blocking. Oldest events are overwritten, readers skip
+/// slots that are (re-)written while being read.
+/// All static event functions do nothing if no instance exists. They register
+/// as writer while using the instance and the destructor waits for all
+/// registered writers, so the ring is never freed while being written.
+//------------------------------------------------------------------------------
+class SDPTrace
+{
+   private:
+      static SDPTrace* volatile  sm_psdpt;         ///< static instance
+      static volatile LONG       sm_nWriters;      ///< number of writers using sm_psdpt
+      std::vector<SDPTraceEvent> m_vEvents;        ///< ring of events
+      LONG                       m_nMask;          ///< index mask (ring size - 1)
+      volatile LONG              m_nWrite;         ///< total number of reserved slots
+      volatile LONGLONG          m_nBuffer;        ///< index of current buffer
+      volatile LONG              m_nDumpBusy;      ///< flag if asynchronous dump is requested or running
+      HANDLE                     m_hDumpThread;    ///< thread writing trace on xruns (NULL if no xrun file)
+      HANDLE                     m_hDumpEvents[2]; ///< stop and dump event of dump thread
+      char                       m_szXrunFile[MAX_PATH];   ///< file written on xruns
+      double                     m_dTicksPerSecond;   ///< timer frequency
+      static SDPTrace*           AcquireWriter();
+      static void                ReleaseWriter();
+      void                       Add(char cPhase, const char* lpcszName);
+      void                       OnXrun(const char* lpcszName);
+      void                       Snapshot(std::vector<SDPTraceEvent> &rvEvents);
+      void                       CloseDumpThread();
+      static DWORD WINAPI        DumpThreadProc(LPVOID pParam);
+   public:
+      SDPTrace(unsigned int nSize, const char* lpcszXrunFile);
+      ~SDPTrace();
+      static SDPTrace*           Instance();
+      static void                Begin(const char* lpcszName);
+      static void                End(const char* lpcszName);
+      static void                Instant(const char* lpcszName);
+      static void                SetBuffer(int64_t nBuffer);
+      static void                Xrun(const char* lpcszName);
+      unsigned int               Size();
+      void                       Dump(const char* lpcszFileName, double dSeconds = 0.0);
+};
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+/// \class SDPTraceScope. Writes begin event in constructor and end event in
+/// destructor
+//------------------------------------------------------------------------------
+class SDPTraceScope
+{
+   private:
+      const char* m_lpcszName;
+   public:
+      SDPTraceScope(const char* lpcszName) : m_lpcszName(lpcszName) { SDPTrace::Begin(m_lpcszName); }
+      ~SDPTraceScope() { SDPTrace::End(m_lpcszName); }
+};
+//------------------------------------------------------------------------------
+#endif
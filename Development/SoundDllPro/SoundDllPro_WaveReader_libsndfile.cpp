@@ -1,8 +1,12 @@
 //------------------------------------------------------------------------------
 /// \file SoundDllPro_WaveReader_libsndfile.cpp
 /// \author Berg
-/// \brief Implementation of class SDPWaveReader. Encapsulates buffered reading
-/// of a single channel of a PCM wave file using a thread for non-blocking reading.
+/// \brief Implementation of classes SDPWaveFilePool, SDPWaveFile and
+/// SDPWaveReader. Encapsulates buffered reading of a PCM wave file using a
+/// small pool of worker threads for non-blocking reading of all files.
+/// All channels are read once by SDPWaveFile and shared by the SDPWaveReader
+/// instances reading single channels. Uncompressed WAV/RF64 files are read
+/// directly from a memory mapping of the file without any buffering.
 /// Uses libsndfile
 ///
 /// Project SoundMexPro
@@ -30,10 +34,12 @@
 //------------------------------------------------------------------------------
 #include <vcl.h>
 #include <windowsx.h>
+#include <algorithm>
 #pragma hdrstop
 
 #include "SoundDllPro_WaveReader_libsndfile.h"
 #include "SoundDllPro_Tools.h"
+#include "SoundDllPro_Trace.h"
 #pragma package(smart_init)
 //---------------------------------------------------------------------------
 
@@ -44,54 +50,552 @@
 unsigned int SDPWaveReader::sm_nWaveReaderBufSize = WAVREAD_DEFAULTBUFSIZE;
 
 //------------------------------------------------------------------------------
-/// constructor. Initializes members, opens file, checks file format, starts
-/// thread and waits until first data buffer is read.
+/// flag, if uncompressed files are memory mapped rather than streamed
 //------------------------------------------------------------------------------
-__fastcall SDPWaveReader::SDPWaveReader(  SDPOD_AUDIO       &rsdpodFile,
-                                          unsigned int      nDeviceSampleRate,
-                                          unsigned int      nMinBufsize,
-                                          int               nThreadPriority)
-   : TThread(true),
-     m_strFileName(rsdpodFile.strName),
+bool SDPWaveReader::sm_bWaveReaderMapFiles = true;
+
+//------------------------------------------------------------------------------
+/// static pool instance, set by constructor of SDPWaveFilePool
+//------------------------------------------------------------------------------
+SDPWaveFilePool* SDPWaveFilePool::sm_psdpwfp = NULL;
+
+//------------------------------------------------------------------------------
+/// constructor of worker thread. Thread is started by pool
+//------------------------------------------------------------------------------
+__fastcall SDPWaveFileWorker::SDPWaveFileWorker(SDPWaveFilePool* psdpwfp, int nThreadPriority)
+   : TThread(true), m_psdpwfp(psdpwfp)
+{
+   Priority = nThreadPriority == 3 ? tpTimeCritical : tpHighest;
+   FreeOnTerminate = false;
+}
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+/// thread function. Waits for requests: prepares own file instances for
+/// detached readers first, otherwise reads data (or prefetches pages of a
+/// mapped file) of the file with the earliest deadline
+//------------------------------------------------------------------------------
+void __fastcall SDPWaveFileWorker::Execute()
+{
+   SDPWaveFile* psdpwf;
+   SDPWaveReader* psdpwr;
+   double dDeadline;
+   uint64_t nFrom, nTo;
+   while (!Terminated)
+      {
+      // wait for 'request' or 'stop'. To avoid dead locks we have a timeout
+      // of 1 second: in that case we simply re-loop
+      DWORD nWaitResult = WaitForMultipleObjects(2, m_psdpwfp->m_hEvents, false, 1000);
+      if (nWaitResult == WAIT_OBJECT_0 + SDP_WAVEFILEPOOLEVENT_STOP)
+         break;
+      if (nWaitResult != WAIT_OBJECT_0 + SDP_WAVEFILEPOOLEVENT_REQUEST)
+         continue;
+      // detached readers play silence until they are re-attached, so they
+      // are served first
+      if (m_psdpwfp->GetSplitRequest(psdpwr))
+         {
+         SDPTraceScope sdpts("fileread");
+         psdpwr->PrepareSplit();
+         m_psdpwfp->SplitDone(psdpwr);
+         continue;
+         }
+      // NOTE: request may have been cancelled meanwhile
+      if (!m_psdpwfp->GetRequest(psdpwf, dDeadline))
+         continue;
+      // a file with an error is not read any more (error is reported by Seek)
+      if (psdpwf->m_strThreadError.IsEmpty())
+         {
+         try
+            {
+            SDPTraceScope sdpts("fileread");
+            if (psdpwf->IsMapped())
+               {
+               m_psdpwfp->GetPrefetch(psdpwf, nFrom, nTo);
+               psdpwf->Prefetch(nFrom, nTo);
+               }
+            else
+               psdpwf->ReadData();
+            }
+         catch (Exception &e)
+            {
+            psdpwf->m_strThreadError = e.Message;
+            OutputDebugString(("Thread error: " + psdpwf->m_strThreadError).c_str());
+            }
+         }
+      m_psdpwfp->RequestDone(psdpwf, dDeadline);
+      }
+}
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+/// constructor. Creates sync objects and starts worker threads. Sets static
+/// member SDPWaveFilePool::sm_psdpwfp
+//------------------------------------------------------------------------------
+SDPWaveFilePool::SDPWaveFilePool(unsigned int nNumThreads, int nThreadPriority)
+{
+   if (sm_psdpwfp)
+      throw Exception("file reader pool already created");
+   if (!nNumThreads || nNumThreads > WAVREAD_MAXTHREADS)
+      throw Exception("invalid number of file reader threads");
+
+   LARGE_INTEGER li;
+   QueryPerformanceFrequency(&li);
+   m_dFrequency = (double)li.QuadPart / 1000.0;
+
+   InitializeCriticalSection(&m_csQueue);
+   ResetStats();
+
+   // stop event is manual-resetting to stop all workers, semaphore counts requests
+   m_hEvents[SDP_WAVEFILEPOOLEVENT_STOP]    = CreateEvent(NULL, TRUE, FALSE, NULL);
+   m_hEvents[SDP_WAVEFILEPOOLEVENT_REQUEST] = CreateSemaphore(NULL, 0, LONG_MAX, NULL);
+   try
+      {
+      if (!m_hEvents[SDP_WAVEFILEPOOLEVENT_STOP] || !m_hEvents[SDP_WAVEFILEPOOLEVENT_REQUEST])
+         throw Exception("error creating file reader events");
+
+      for (unsigned int n = 0; n < nNumThreads; n++)
+         {
+         m_vpsdpwfw.push_back(new SDPWaveFileWorker(this, nThreadPriority));
+         m_vpsdpwfw.back()->Start();
+         }
+      }
+   catch (...)
+      {
+      Cleanup();
+      throw;
+      }
+   sm_psdpwfp = this;
+}
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+/// destructor. Stops worker threads and does cleanup. All SDPWaveFile instances
+/// must be deleted before
+//------------------------------------------------------------------------------
+SDPWaveFilePool::~SDPWaveFilePool()
+{
+   sm_psdpwfp = NULL;
+   Cleanup();
+}
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+/// stops and deletes worker threads and releases sync objects
+//------------------------------------------------------------------------------
+void SDPWaveFilePool::Cleanup()
+{
+   // NOTE: no exception here to happen in destructor: thus ignore any error....
+   if (m_hEvents[SDP_WAVEFILEPOOLEVENT_STOP])
+      SetEvent(m_hEvents[SDP_WAVEFILEPOOLEVENT_STOP]);
+   for (unsigned int n = 0; n < m_vpsdpwfw.size(); n++)
+      {
+      m_vpsdpwfw[n]->Terminate();
+      m_vpsdpwfw[n]->WaitFor();
+      TRYDELETENULL(m_vpsdpwfw[n]);
+      }
+   m_vpsdpwfw.clear();
+   for (int i = 0; i < 2; i++)
+      {
+      if (m_hEvents[i] != NULL)
+         {
+         CloseHandle(m_hEvents[i]);
+         m_hEvents[i] = NULL;
+         }
+      }
+   DeleteCriticalSection(&m_csQueue);
+}
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+/// returns static pool instance (may be NULL)
+//------------------------------------------------------------------------------
+SDPWaveFilePool* SDPWaveFilePool::Instance()
+{
+   return sm_psdpwfp;
+}
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+/// returns current time in milliseconds used for deadlines
+//------------------------------------------------------------------------------
+double SDPWaveFilePool::Now()
+{
+   LARGE_INTEGER li;
+   QueryPerformanceCounter(&li);
+   return (double)li.QuadPart / m_dFrequency;
+}
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+/// queues a refill request for a file. A deadline of 0 requests immediate
+/// reading (used on seeking), such requests are not used for deadline
+/// statistics. A file is queued only once: if it is queued already, the
+/// earlier deadline is kept. If it is read currently, it is re-queued after
+/// reading is done
+//------------------------------------------------------------------------------
+void SDPWaveFilePool::Request(SDPWaveFile* psdpwf, double dDeadline)
+{
+   EnterCriticalSection(&m_csQueue);
+   try
+      {
+      if (psdpwf->m_bQueued || psdpwf->m_bRequeue)
+         {
+         if (dDeadline < psdpwf->m_dDeadline)
+            psdpwf->m_dDeadline = dDeadline;
+         }
+      else
+         {
+         psdpwf->m_dDeadline = dDeadline;
+         if (psdpwf->m_bBusy)
+            psdpwf->m_bRequeue = true;
+         else
+            Enqueue(psdpwf);
+         }
+      }
+   __finally
+      {
+      LeaveCriticalSection(&m_csQueue);
+      }
+}
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+/// queues a prefetch request for the pages of a mapped file containing the
+/// 'total' positions nFrom up to (excluding) nTo. Called from processing
+/// thread. A range still pending is extended, so readers of different
+/// channels of the same file share one request
+//------------------------------------------------------------------------------
+void SDPWaveFilePool::RequestPrefetch(SDPWaveFile* psdpwf, uint64_t nFrom, uint64_t nTo, double dDeadline)
+{
+   EnterCriticalSection(&m_csQueue);
+   try
+      {
+      if (psdpwf->m_nPrefetchFrom == psdpwf->m_nPrefetchTo)
+         {
+         psdpwf->m_nPrefetchFrom = nFrom;
+         psdpwf->m_nPrefetchTo   = nTo;
+         }
+      else
+         {
+         if (nFrom < psdpwf->m_nPrefetchFrom)
+            psdpwf->m_nPrefetchFrom = nFrom;
+         if (nTo > psdpwf->m_nPrefetchTo)
+            psdpwf->m_nPrefetchTo = nTo;
+         }
+      Request(psdpwf, dDeadline);
+      }
+   __finally
+      {
+      LeaveCriticalSection(&m_csQueue);
+      }
+}
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+/// called by workers: returns pending prefetch range of a mapped file and
+/// clears it
+//------------------------------------------------------------------------------
+void SDPWaveFilePool::GetPrefetch(SDPWaveFile* psdpwf, uint64_t &rnFrom, uint64_t &rnTo)
+{
+   EnterCriticalSection(&m_csQueue);
+   rnFrom = psdpwf->m_nPrefetchFrom;
+   rnTo   = psdpwf->m_nPrefetchTo;
+   psdpwf->m_nPrefetchFrom = 0;
+   psdpwf->m_nPrefetchTo   = 0;
+   LeaveCriticalSection(&m_csQueue);
+}
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+/// removes a file from queue and waits until a worker currently reading it is
+/// done. Must not be called from within critical section of the file.
+/// NOTE: called in destructor of SDPWaveFile, so no exceptions are thrown here
+//------------------------------------------------------------------------------
+void SDPWaveFilePool::Cancel(SDPWaveFile* psdpwf)
+{
+   EnterCriticalSection(&m_csQueue);
+   std::vector<SDPWaveFile*>::iterator it = std::find(m_vpsdpwfQueue.begin(), m_vpsdpwfQueue.end(), psdpwf);
+   if (it != m_vpsdpwfQueue.end())
+      m_vpsdpwfQueue.erase(it);
+   psdpwf->m_bQueued    = false;
+   psdpwf->m_bRequeue   = false;
+   m_sdpwfps.nQueueDepth = (unsigned int)m_vpsdpwfQueue.size();
+   while (psdpwf->m_bBusy)
+      {
+      LeaveCriticalSection(&m_csQueue);
+      Sleep(1);
+      EnterCriticalSection(&m_csQueue);
+      psdpwf->m_bRequeue   = false;
+      }
+   LeaveCriticalSection(&m_csQueue);
+}
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+/// queues a request for preparing an own file instance for a detached reader
+/// (see SDPWaveReader::Reattach). Called from processing thread
+//------------------------------------------------------------------------------
+void SDPWaveFilePool::RequestSplit(SDPWaveReader* psdpwr)
+{
+   EnterCriticalSection(&m_csQueue);
+   try
+      {
+      if (!psdpwr->m_bSplitQueued && !psdpwr->m_bSplitBusy)
+         {
+         psdpwr->m_bSplitQueued = true;
+         m_vpsdpwrQueue.push_back(psdpwr);
+         if (!ReleaseSemaphore(m_hEvents[SDP_WAVEFILEPOOLEVENT_REQUEST], 1, NULL))
+            throw Exception("error setting load event");
+         }
+      }
+   __finally
+      {
+      LeaveCriticalSection(&m_csQueue);
+      }
+}
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+/// removes a reader from re-attach queue and waits until a worker currently
+/// preparing a file instance for it is done.
+/// NOTE: called in destructor of SDPWaveReader, so no exceptions are thrown here
+//------------------------------------------------------------------------------
+void SDPWaveFilePool::CancelSplit(SDPWaveReader* psdpwr)
+{
+   EnterCriticalSection(&m_csQueue);
+   std::vector<SDPWaveReader*>::iterator it = std::find(m_vpsdpwrQueue.begin(), m_vpsdpwrQueue.end(), psdpwr);
+   if (it != m_vpsdpwrQueue.end())
+      m_vpsdpwrQueue.erase(it);
+   psdpwr->m_bSplitQueued = false;
+   while (psdpwr->m_bSplitBusy)
+      {
+      LeaveCriticalSection(&m_csQueue);
+      Sleep(1);
+      EnterCriticalSection(&m_csQueue);
+      }
+   LeaveCriticalSection(&m_csQueue);
+}
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+/// adds number of samples returned as zeros by a reader waiting for
+/// re-attaching to statistics
+//------------------------------------------------------------------------------
+void SDPWaveFilePool::AddUnderrun(uint64_t nSamples)
+{
+   EnterCriticalSection(&m_csQueue);
+   m_sdpwfps.nUnderrun += nSamples;
+   LeaveCriticalSection(&m_csQueue);
+}
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+/// returns number of worker threads
+//------------------------------------------------------------------------------
+unsigned int SDPWaveFilePool::NumThreads()
+{
+   return (unsigned int)m_vpsdpwfw.size();
+}
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+/// returns a copy of current statistics
+//------------------------------------------------------------------------------
+void SDPWaveFilePool::GetStats(SDPWaveFilePoolStats &rsdpwfps)
+{
+   EnterCriticalSection(&m_csQueue);
+   rsdpwfps = m_sdpwfps;
+   LeaveCriticalSection(&m_csQueue);
+}
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+/// resets statistics (current queue depth is kept)
+//------------------------------------------------------------------------------
+void SDPWaveFilePool::ResetStats()
+{
+   EnterCriticalSection(&m_csQueue);
+   m_sdpwfps.nQueueDepth      = (unsigned int)m_vpsdpwfQueue.size();
+   m_sdpwfps.nMaxQueueDepth   = m_sdpwfps.nQueueDepth;
+   m_sdpwfps.nRequests        = 0;
+   m_sdpwfps.nMissed          = 0;
+   m_sdpwfps.dWorstSlack      = 0.0;
+   m_sdpwfps.nReattaches      = 0;
+   m_sdpwfps.nUnderrun        = 0;
+   m_bSlackValid              = false;
+   LeaveCriticalSection(&m_csQueue);
+}
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+/// appends a file to the queue and signals workers. Must be called within
+/// critical section
+//------------------------------------------------------------------------------
+void SDPWaveFilePool::Enqueue(SDPWaveFile* psdpwf)
+{
+   psdpwf->m_bQueued = true;
+   m_vpsdpwfQueue.push_back(psdpwf);
+   m_sdpwfps.nQueueDepth = (unsigned int)m_vpsdpwfQueue.size();
+   if (m_sdpwfps.nQueueDepth > m_sdpwfps.nMaxQueueDepth)
+      m_sdpwfps.nMaxQueueDepth = m_sdpwfps.nQueueDepth;
+   if (!ReleaseSemaphore(m_hEvents[SDP_WAVEFILEPOOLEVENT_REQUEST], 1, NULL))
+      throw Exception("error setting load event");
+}
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+/// called by workers: removes the file with the earliest deadline from the
+/// queue and marks it as busy. Returns false if queue is empty
+//------------------------------------------------------------------------------
+bool SDPWaveFilePool::GetRequest(SDPWaveFile* &rpsdpwf, double &rdDeadline)
+{
+   bool bReturn = false;
+   EnterCriticalSection(&m_csQueue);
+   try
+      {
+      if (!m_vpsdpwfQueue.empty())
+         {
+         std::vector<SDPWaveFile*>::iterator itNext = m_vpsdpwfQueue.begin();
+         std::vector<SDPWaveFile*>::iterator it;
+         for (it = m_vpsdpwfQueue.begin() + 1; it != m_vpsdpwfQueue.end(); it++)
+            {
+            if ((*it)->m_dDeadline < (*itNext)->m_dDeadline)
+               itNext = it;
+            }
+         rpsdpwf     = *itNext;
+         rdDeadline  = rpsdpwf->m_dDeadline;
+         m_vpsdpwfQueue.erase(itNext);
+         m_sdpwfps.nQueueDepth = (unsigned int)m_vpsdpwfQueue.size();
+         rpsdpwf->m_bQueued   = false;
+         rpsdpwf->m_bBusy     = true;
+         bReturn = true;
+         }
+      }
+   __finally
+      {
+      LeaveCriticalSection(&m_csQueue);
+      }
+   return bReturn;
+}
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+/// called by workers: removes the first reader from re-attach queue and marks
+/// it as busy. Returns false if queue is empty
+//------------------------------------------------------------------------------
+bool SDPWaveFilePool::GetSplitRequest(SDPWaveReader* &rpsdpwr)
+{
+   bool bReturn = false;
+   EnterCriticalSection(&m_csQueue);
+   if (!m_vpsdpwrQueue.empty())
+      {
+      rpsdpwr = m_vpsdpwrQueue.front();
+      m_vpsdpwrQueue.erase(m_vpsdpwrQueue.begin());
+      rpsdpwr->m_bSplitQueued = false;
+      rpsdpwr->m_bSplitBusy   = true;
+      bReturn = true;
+      }
+   LeaveCriticalSection(&m_csQueue);
+   return bReturn;
+}
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+/// called by workers after preparing an own file instance for a reader
+//------------------------------------------------------------------------------
+void SDPWaveFilePool::SplitDone(SDPWaveReader* psdpwr)
+{
+   EnterCriticalSection(&m_csQueue);
+   m_sdpwfps.nReattaches++;
+   psdpwr->m_bSplitBusy = false;
+   LeaveCriticalSection(&m_csQueue);
+}
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+/// called by workers after reading a file: updates statistics and re-queues
+/// the file if it was requested again while reading
+//------------------------------------------------------------------------------
+void SDPWaveFilePool::RequestDone(SDPWaveFile* psdpwf, double dDeadline)
+{
+   double dSlack = dDeadline - Now();
+   EnterCriticalSection(&m_csQueue);
+   try
+      {
+      m_sdpwfps.nRequests++;
+      if (dDeadline > 0.0)
+         {
+         if (dSlack < 0.0)
+            m_sdpwfps.nMissed++;
+         if (!m_bSlackValid || dSlack < m_sdpwfps.dWorstSlack)
+            m_sdpwfps.dWorstSlack = dSlack;
+         m_bSlackValid = true;
+         }
+      psdpwf->m_bBusy = false;
+      if (psdpwf->m_bRequeue)
+         {
+         psdpwf->m_bRequeue = false;
+         Enqueue(psdpwf);
+         }
+      }
+   __finally
+      {
+      LeaveCriticalSection(&m_csQueue);
+      }
+}
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+/// constructor. Initializes members, opens file, checks file format and
+/// allocates buffers. Buffers are filled by SDPWaveFilePool on first call to Seek
+//------------------------------------------------------------------------------
+SDPWaveFile::SDPWaveFile(  SDPOD_AUDIO       &rsdpodFile,
+                           unsigned int      nDeviceSampleRate,
+                           unsigned int      nMinBufsize)
+   : m_strFileName(rsdpodFile.strName),
      m_pSndFile(NULL),
+     m_psdpwfp(SDPWaveFilePool::Instance()),
      m_nBufferSize(nMinBufsize),
-     m_nFileChannel(rsdpodFile.nChannelIndex),
      m_nNumFileChannels(0),
-     m_nReadPos(0),
-     m_nSamplesRead(0),
      m_nSamplesReadFromFile(0),
      m_nFilePos(0),
-     m_bDone(false),
      m_nStartPos(0),
      m_nFileSize(0),
      m_nLength(0),
-     m_nReadBufIndex(0),
      m_nFileOffset(0),
      m_nFileLastSample(0),
-     m_bStarted(false),
      m_nCrossfadeOffset(0),
-     m_nTotalLength(0)
+     m_nTotalLength(0),
+     m_nRefCount(1),
+     m_nSeekPosition(0),
+     m_bSeekFresh(false),
+     m_sdpodFile(rsdpodFile),
+     m_nDeviceSampleRate(nDeviceSampleRate),
+     m_nMinBufsize(nMinBufsize),
+     m_bQueued(false),
+     m_bBusy(false),
+     m_bRequeue(false),
+     m_dDeadline(0.0),
+     m_nPrefetchFrom(0),
+     m_nPrefetchTo(0),
+     m_hMapFile(NULL),
+     m_hMapping(NULL),
+     m_pMapView(NULL),
+     m_pMapData(NULL),
+     m_nMapSubFormat(0),
+     m_nMapBytesPerSample(0)
 {
-   Priority = nThreadPriority == 3 ? tpTimeCritical : tpHighest;
-
-   m_hEvents[0] = NULL;
-   m_hEvents[1] = NULL;
-   // create named events non-signaled and auto-resetting
-   for (int i = 0; i < 2; i++)
-      {
-      m_hEvents[i]    = CreateEvent(NULL, FALSE, FALSE, NULL);
-      if (!m_hEvents[i])
-         throw Exception("error creating file reader events");
-      }
+   m_sdpodFile.psdpwf = NULL;
 
-   //WriteDebugString("start");
-   FreeOnTerminate = false;
+   if (!m_psdpwfp)
+      throw Exception("file reader pool not initialized");
    if (!FileExists(m_strFileName))
       throw Exception("file not found");
 
    try
       {
       InitializeCriticalSection(&m_csFile);
+      InitializeCriticalSection(&m_csBuffers);
 
       SF_INFO sfi;
       ZeroMemory(&sfi, sizeof(sfi));
@@ -101,15 +605,9 @@ __fastcall SDPWaveReader::SDPWaveReader(  SDPOD_AUDIO       &rsdpodFile,
       if (!m_pSndFile)
          throw Exception("error opening file");
 
-      // check, that channel is within range
       m_nNumFileChannels = (unsigned int)sfi.channels;
-      if (m_nFileChannel >= m_nNumFileChannels)
-         throw Exception("requested channel is out of range (requested: "
-                        + IntToStr((int)m_nFileChannel)
-                        + ", available: "
-                        + IntToStr((int)m_nNumFileChannels)
-                        + ")");
-
+      if (!m_nNumFileChannels)
+         throw Exception("file does not contain channels");
 
       // samplerate identical to device samplerate?
       if (nDeviceSampleRate != (unsigned int)sfi.samplerate)
@@ -174,30 +672,40 @@ __fastcall SDPWaveReader::SDPWaveReader(  SDPOD_AUDIO       &rsdpodFile,
 
 
       // use passed buffer size, but at least 640 kB totally for performance reasons
-      if (m_nNumFileChannels*m_nBufferSize < sm_nWaveReaderBufSize)
-         m_nBufferSize = sm_nWaveReaderBufSize/m_nNumFileChannels;
+      if (m_nNumFileChannels*m_nBufferSize < SDPWaveReader::sm_nWaveReaderBufSize)
+         m_nBufferSize = SDPWaveReader::sm_nWaveReaderBufSize/m_nNumFileChannels;
 
-      // create two float buffers for ping-pong filling
-      for (int i = 0; i < 2; i++)
+      // uncompressed files are read directly from mapped file: no buffers
+      // needed, the pool only prefetches the pages of the next m_nBufferSize
+      // frames ahead of the readers
+      if (SDPWaveReader::sm_bWaveReaderMapFiles && MapFile(sfi.format))
          {
-         // NOTE: we read all channels
-         m_sdpWB[i].m_vafBuffer.resize(m_nNumFileChannels*m_nBufferSize);
-         m_sdpWB[i].m_wrbStatus = SDP_WAVEREADERBUFFERSTATUS_DONE;
+         sf_close(m_pSndFile);
+         m_pSndFile = NULL;
+         }
+      else
+         {
+         // NOTE: we read all channels interleaved to one buffer and create two
+         // deinterleaved float buffers per channel for ping-pong filling
+         m_vafReadBuffer.resize(m_nNumFileChannels*m_nBufferSize);
+         for (int i = 0; i < 2; i++)
+            {
+            m_sdpWB[i].m_vvafChannels.resize(m_nNumFileChannels);
+            for (unsigned int nChannel = 0; nChannel < m_nNumFileChannels; nChannel++)
+               m_sdpWB[i].m_vvafChannels[nChannel].resize(m_nBufferSize);
+            m_sdpWB[i].m_wrbStatus = SDP_WAVEREADERBUFFERSTATUS_DONE;
+            m_sdpWB[i].m_nPending  = 0;
+            }
          }
       }
    catch (Exception &e)
       {
-      // tell thread to stop
-      if (!!m_hEvents[SDP_WAVEREADEREVENT_STOP])
-         {
-         if (!SetEvent(m_hEvents[SDP_WAVEREADEREVENT_STOP]))
-            throw Exception("error setting stop event");
-         }
-
+      UnmapFile();
       if (m_pSndFile)
          sf_close(m_pSndFile);
       m_pSndFile = NULL;
       AnsiString str = "error loading file '" + ExpandFileName(m_strFileName) + "': " + e.Message;
+      DeleteCriticalSection(&m_csBuffers);
       DeleteCriticalSection(&m_csFile);
       throw Exception(str);
       }
@@ -205,82 +713,268 @@ __fastcall SDPWaveReader::SDPWaveReader(  SDPOD_AUDIO       &rsdpodFile,
 //------------------------------------------------------------------------------
 
 //------------------------------------------------------------------------------
-/// destructor. Stops thread and does cleanup
+/// destructor. Cancels pending refill requests and does cleanup
 //------------------------------------------------------------------------------
-__fastcall SDPWaveReader::~SDPWaveReader()
+SDPWaveFile::~SDPWaveFile()
 {
-   // tell thread to stop: NOTE: no exception here to happen in destructor:
-   // thus ignore any error....
-   bool bStopEventSuccess = SetEvent(m_hEvents[SDP_WAVEREADEREVENT_STOP]);
-
-   Terminate();            
-   //wait only on 'regular' stopping
-   if (bStopEventSuccess)
-      WaitFor();
+   // wait until no worker is reading the file any more
+   m_psdpwfp->Cancel(this);
 
    if (m_pSndFile)
       sf_close(m_pSndFile);
    m_pSndFile = NULL;
+   UnmapFile();
 
-   for (int i = 0; i < 2; i++)
+   DeleteCriticalSection(&m_csBuffers);
+   DeleteCriticalSection(&m_csFile);
+}
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+/// increments reference count
+//------------------------------------------------------------------------------
+void SDPWaveFile::AddRef()
+{
+   InterlockedIncrement(&m_nRefCount);
+}
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+/// decrements reference count and deletes instance if it is not referenced
+/// any longer
+//------------------------------------------------------------------------------
+void SDPWaveFile::Release()
+{
+   if (InterlockedDecrement(&m_nRefCount) == 0)
+      delete this;
+}
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+/// tries to map the file, if it is an uncompressed little endian WAV or RF64
+/// file with 16bit or 24bit PCM or float data. Returns true on success, false
+/// if file has to be streamed.
+/// NOTE: mapping of large files may fail in 32bit processes
+//------------------------------------------------------------------------------
+bool SDPWaveFile::MapFile(int nFormat)
+{
+   int nType = nFormat & SF_FORMAT_TYPEMASK;
+   if (nType != SF_FORMAT_WAV && nType != SF_FORMAT_WAVEX && nType != SF_FORMAT_RF64)
+      return false;
+   if ((nFormat & SF_FORMAT_ENDMASK) == SF_ENDIAN_BIG)
+      return false;
+   switch (nFormat & SF_FORMAT_SUBMASK)
       {
-      if (m_hEvents[i] != NULL)
-         {
-         CloseHandle(m_hEvents[i]);
-         m_hEvents[i] = NULL;
-         }
+      case SF_FORMAT_PCM_16:  m_nMapBytesPerSample = 2; break;
+      case SF_FORMAT_PCM_24:  m_nMapBytesPerSample = 3; break;
+      case SF_FORMAT_FLOAT:   m_nMapBytesPerSample = 4; break;
+      default:                return false;
       }
-   DeleteCriticalSection(&m_csFile);
+   m_nMapSubFormat = nFormat & SF_FORMAT_SUBMASK;
+
+   LARGE_INTEGER liSize;
+   liSize.QuadPart = 0;
+   m_hMapFile = CreateFileA(m_strFileName.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+   if (m_hMapFile == INVALID_HANDLE_VALUE)
+      m_hMapFile = NULL;
+   if (m_hMapFile && GetFileSizeEx(m_hMapFile, &liSize) && liSize.QuadPart > 12)
+      m_hMapping = CreateFileMapping(m_hMapFile, NULL, PAGE_READONLY, 0, 0, NULL);
+   if (m_hMapping)
+      m_pMapView = (const unsigned char*)MapViewOfFile(m_hMapping, FILE_MAP_READ, 0, 0, 0);
+   if (m_pMapView)
+      m_pMapData = FindDataChunk((uint64_t)liSize.QuadPart);
+   if (!m_pMapData)
+      {
+      UnmapFile();
+      return false;
+      }
+   return true;
 }
 //------------------------------------------------------------------------------
 
 //------------------------------------------------------------------------------
-/// thread function. Reads data (if necessary)
+/// returns pointer to first sample in 'data' chunk of mapped file. Returns NULL
+/// if chunk is not found, format chunk does not match format reported by
+/// libsndfile or data chunk does not contain all frames
 //------------------------------------------------------------------------------
-void __fastcall SDPWaveReader::Execute()
+const unsigned char* SDPWaveFile::FindDataChunk(uint64_t nFileBytes)
 {
-   try
+   const unsigned char* pby = m_pMapView;
+   if (  (memcmp(pby, "RIFF", 4) && memcmp(pby, "RF64", 4))
+      || memcmp(pby + 8, "WAVE", 4)
+      )
+      return NULL;
+
+   unsigned int nBlockAlign = m_nNumFileChannels * m_nMapBytesPerSample;
+   bool bFormatChecked = false;
+   uint64_t nPos = 12;
+   uint64_t nChunkSize;
+   while (nPos + 8 <= nFileBytes)
       {
-      bool bBreak = false;
-      while (1)
+      nChunkSize = *(const uint32_t*)(pby + nPos + 4);
+      if (!memcmp(pby + nPos, "fmt ", 4))
          {
-         // wait for 'load' or 'stop' request. To avoid dead locks we
-         // have a timeout of 1 second: in that case we simply re-loop,
-         // but if termination was requested meanwhile or file is closed
-         // we break the loop
-         DWORD nWaitResult = WaitForMultipleObjects(2, m_hEvents, false, 1000);
-         switch (nWaitResult)
-            {
-            // first is 'load':
-            case (WAIT_OBJECT_0 + SDP_WAVEREADEREVENT_LOAD):
-               ReadData();
-               break;
-            // second is stop
-            case (WAIT_OBJECT_0 + SDP_WAVEREADEREVENT_STOP):
-               bBreak = true; break;
-            case (WAIT_TIMEOUT):
-               break;
-            default:
-               throw Exception("unexpected event");
-            }
-
-         if (bBreak || Terminated || !m_pSndFile)
-            break;
+         // nBlockAlign is stored at offset 12 within format chunk
+         if (nChunkSize < 16 || nPos + 24 > nFileBytes)
+            return NULL;
+         if (*(const uint16_t*)(pby + nPos + 20) != nBlockAlign)
+            return NULL;
+         bFormatChecked = true;
          }
+      else if (!memcmp(pby + nPos, "data", 4))
+         {
+         // NOTE: chunk size is not used (may be a placeholder in RF64 files),
+         // but all frames reported by libsndfile must be available
+         if (  !bFormatChecked
+            || nPos + 8 + m_nFileSize * nBlockAlign > nFileBytes
+            )
+            return NULL;
+         return pby + nPos + 8;
+         }
+      nPos += 8 + nChunkSize + (nChunkSize & 1);
       }
-   catch (Exception &e)
+   return NULL;
+}
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+/// releases file mapping (if any)
+//------------------------------------------------------------------------------
+void SDPWaveFile::UnmapFile()
+{
+   m_pMapData = NULL;
+   if (m_pMapView)
+      UnmapViewOfFile(m_pMapView);
+   m_pMapView = NULL;
+   if (m_hMapping)
+      CloseHandle(m_hMapping);
+   m_hMapping = NULL;
+   if (m_hMapFile)
+      CloseHandle(m_hMapFile);
+   m_hMapFile = NULL;
+}
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+/// returns true, if file is memory mapped
+//------------------------------------------------------------------------------
+bool SDPWaveFile::IsMapped()
+{
+   return m_pMapData != NULL;
+}
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+/// returns position (frame) within file for 'total' position of file object
+/// with respect to loop count, start offset and file snippet (see Seek).
+/// Returns number of subsequent frames in file belonging to the object in
+/// rnContiguous (i.e. until loop end or end of file for looped snippets)
+//------------------------------------------------------------------------------
+uint64_t SDPWaveFile::FilePosition(uint64_t nPosition, uint64_t &rnContiguous)
+{
+   uint64_t nLoopPos;
+   // NOTE: first m_nCrossfadeOffset samples are only used in first loop
+   if (nPosition < UsedLength() - m_nStartPos)
+      nLoopPos = m_nStartPos + nPosition;
+   else
+      nLoopPos = ((nPosition - (UsedLength() - m_nStartPos)) % (UsedLength() -  m_nCrossfadeOffset))
+               + m_nCrossfadeOffset;
+   rnContiguous = UsedLength() - nLoopPos;
+
+   uint64_t nFilePosition = nLoopPos + m_nFileOffset;
+   // looped snippet: continues at beginning of file
+   if (nFilePosition >= m_nFileSize)
+      nFilePosition -= m_nFileSize;
+   else if (rnContiguous > m_nFileSize - nFilePosition)
+      rnContiguous = m_nFileSize - nFilePosition;
+   return nFilePosition;
+}
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+/// converts nSamples subsequent samples of one channel starting at passed frame
+/// from mapped file to normalized floats (identical to values returned by
+/// sf_read_float)
+//------------------------------------------------------------------------------
+void SDPWaveFile::ReadMapped(uint64_t nFramePos, unsigned int nChannel, float* pfBuffer, unsigned int nSamples)
+{
+   unsigned int nStride = m_nNumFileChannels * m_nMapBytesPerSample;
+   const unsigned char* pby = m_pMapData + (size_t)(nFramePos * nStride) + nChannel * m_nMapBytesPerSample;
+   unsigned int n;
+   switch (m_nMapSubFormat)
       {
-      m_strThreadError = e.Message;
-      OutputDebugString(("Thread error: " + m_strThreadError).c_str());
-      Terminate();
+      case SF_FORMAT_PCM_16:
+         for (n = 0; n < nSamples; n++, pby += nStride)
+            pfBuffer[n] = (float)*(const int16_t*)pby * (1.0f / 32768.0f);
+         break;
+      case SF_FORMAT_PCM_24:
+         // shift to upper bytes for sign extension
+         for (n = 0; n < nSamples; n++, pby += nStride)
+            pfBuffer[n] = (float)((int32_t)(  ((uint32_t)pby[0] << 8)
+                                            | ((uint32_t)pby[1] << 16)
+                                            | ((uint32_t)pby[2] << 24)) >> 8) * (1.0f / 8388608.0f);
+         break;
+      default:
+         for (n = 0; n < nSamples; n++, pby += nStride)
+            memcpy(&pfBuffer[n], pby, sizeof(float));
+         break;
       }
 }
-//---------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+/// returns end of prefetch range of a mapped file starting at passed 'total'
+/// position: m_nBufferSize frames ahead, but not beyond total length
+//------------------------------------------------------------------------------
+uint64_t SDPWaveFile::PrefetchEnd(uint64_t nPosition)
+{
+   uint64_t nEnd = nPosition + m_nBufferSize;
+   if (!!m_nTotalLength && nEnd > m_nTotalLength)
+      nEnd = m_nTotalLength;
+   return nEnd;
+}
+//------------------------------------------------------------------------------
 
 //------------------------------------------------------------------------------
-/// Loads data from file to buffers (if status of buffer(s) is 'done')
+/// touches all pages of a mapped file containing the 'total' positions nFrom
+/// up to (excluding) nTo, so that they are faulted in by the calling pool
+/// worker rather than by the readers on the processing thread
 //------------------------------------------------------------------------------
-void SDPWaveReader::ReadData()
+void SDPWaveFile::Prefetch(uint64_t nFrom, uint64_t nTo)
+{
+   unsigned int nStride = m_nNumFileChannels * m_nMapBytesPerSample;
+   volatile unsigned char by;
+   uint64_t nContiguous;
+   while (nFrom < nTo)
+      {
+      uint64_t nFramePos = FilePosition(nFrom, nContiguous);
+      if (nContiguous > nTo - nFrom)
+         nContiguous = nTo - nFrom;
+      const unsigned char* pby    = m_pMapData + (size_t)(nFramePos * nStride);
+      const unsigned char* pbyEnd = pby + (size_t)(nContiguous * nStride);
+      for (; pby < pbyEnd; pby += WAVREAD_PAGESIZE)
+         by = *pby;
+      by = *(pbyEnd - 1);
+      nFrom += nContiguous;
+      }
+}
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+/// returns deadline for refilling a released buffer: the time when the other
+/// buffer will run dry
+//------------------------------------------------------------------------------
+double SDPWaveFile::RefillDeadline()
+{
+   return m_psdpwfp->Now() + 1000.0 * (double)m_nBufferSize / (double)m_nDeviceSampleRate;
+}
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+/// Loads data from file to buffers (if status of buffer(s) is 'done') and
+/// deinterleaves them to the channel buffers
+//------------------------------------------------------------------------------
+void SDPWaveFile::ReadData()
 {
    if (!m_pSndFile)
       throw Exception("try to read file samples from closed file");
@@ -292,12 +986,17 @@ void SDPWaveReader::ReadData()
       if (m_nSamplesReadFromFile >= (m_nTotalLength) && !!m_nTotalLength)
          return;
 
+      bool bDone;
       for (int i = 0; i < 2; i++)
          {
-         if (m_sdpWB[i].m_wrbStatus != SDP_WAVEREADERBUFFERSTATUS_DONE)
+         // NOTE: readers may release buffers concurrently (see ReleaseBuffer)
+         EnterCriticalSection(&m_csBuffers);
+         bDone = m_sdpWB[i].m_wrbStatus == SDP_WAVEREADERBUFFERSTATUS_DONE;
+         LeaveCriticalSection(&m_csBuffers);
+         if (!bDone)
             continue;
 
-         m_sdpWB[i].m_vafBuffer = 0.0f;
+         m_vafReadBuffer = 0.0f;
 
          unsigned int nValuesToRead = m_nBufferSize * m_nNumFileChannels;
          unsigned int nValuesRead   = 0;
@@ -311,7 +1010,7 @@ void SDPWaveReader::ReadData()
             // 1. full file used: 'regular' reading
             if (m_nLength == 0)
                {
-               n = sf_read_float(m_pSndFile, &m_sdpWB[i].m_vafBuffer[nValuesRead], nValuesToRead - nValuesRead);
+               n = sf_read_float(m_pSndFile, &m_vafReadBuffer[nValuesRead], nValuesToRead - nValuesRead);
                }
             // 2. snippet used: read with respect to file offset and last sample to use
             else
@@ -323,7 +1022,7 @@ void SDPWaveReader::ReadData()
                   nValuesToReadInThisRun = nValuesToRead - nValuesRead;
                   if (m_nFilePos + (uint64_t)nValuesToReadInThisRun/m_nNumFileChannels >= m_nFileLastSample)
                      nValuesToReadInThisRun = (int64_t)((m_nFileLastSample - m_nFilePos) * m_nNumFileChannels);
-                  n = sf_read_float(m_pSndFile, &m_sdpWB[i].m_vafBuffer[nValuesRead], nValuesToReadInThisRun);
+                  n = sf_read_float(m_pSndFile, &m_vafReadBuffer[nValuesRead], nValuesToReadInThisRun);
                   }
                // case 2b: 'last sample' before 'file offset': looped snippet used.
                else
@@ -331,7 +1030,7 @@ void SDPWaveReader::ReadData()
                   // case 2b1: we are already behind 'file offset': try to regular reading until file end
                   if (m_nFilePos >= m_nFileOffset)
                      {
-                     n = sf_read_float(m_pSndFile, &m_sdpWB[i].m_vafBuffer[nValuesRead], nValuesToRead - nValuesRead);
+                     n = sf_read_float(m_pSndFile, &m_vafReadBuffer[nValuesRead], nValuesToRead - nValuesRead);
                      }
                   // case 2b2: we are between beginning of file and 'last sample'
                   else if (m_nFilePos < m_nFileLastSample)
@@ -339,7 +1038,7 @@ void SDPWaveReader::ReadData()
                      nValuesToReadInThisRun = nValuesToRead - nValuesRead;
                      if (m_nFilePos + (uint64_t)nValuesToReadInThisRun/m_nNumFileChannels >= m_nFileLastSample)
                         nValuesToReadInThisRun = (int64_t)(m_nFileLastSample - m_nFilePos) * m_nNumFileChannels;
-                     n = sf_read_float(m_pSndFile, &m_sdpWB[i].m_vafBuffer[nValuesRead], nValuesToReadInThisRun);
+                     n = sf_read_float(m_pSndFile, &m_vafReadBuffer[nValuesRead], nValuesToReadInThisRun);
                      }
                   // case 2b3: we are in 'forbidden region': must never happen
                   else
@@ -413,24 +1112,98 @@ void SDPWaveReader::ReadData()
                }
             }
 
+         // deinterleave data to channel buffers
+         unsigned int nChannel, nSample, nReader;
+         for (nChannel = 0; nChannel < m_nNumFileChannels; nChannel++)
+            {
+            const float* pfSrc = &m_vafReadBuffer[nChannel];
+            float* pfDst = &m_sdpWB[i].m_vvafChannels[nChannel][0];
+            for (nSample = 0; nSample < m_nBufferSize; nSample++)
+               {
+               *pfDst++ = *pfSrc;
+               pfSrc += m_nNumFileChannels;
+               }
+            }
+
+         // all readers currently attached have to consume the buffer before
+         // it can be filled again
+         EnterCriticalSection(&m_csBuffers);
+         for (nReader = 0; nReader < m_vpsdpwr.size(); nReader++)
+            m_vpsdpwr[nReader]->m_abHold[i] = true;
+         m_sdpWB[i].m_nPending = (LONG)m_vpsdpwr.size();
+
          // set buffer status to 'filled'
          m_sdpWB[i].m_wrbStatus = SDP_WAVEREADERBUFFERSTATUS_FILLED;
+         LeaveCriticalSection(&m_csBuffers);
          }
       }
    __finally
       {
-      LeaveCriticalSection(&m_csFile);
+      LeaveCriticalSection(&m_csFile);
+      }
+}
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+/// sets 'total' position within file object with respect to loop count,
+/// start offset and file snippet and resets both buffers. Must be called
+/// within critical section of file
+//------------------------------------------------------------------------------
+void SDPWaveFile::SetFilePosition(uint64_t nPosition)
+{
+   // check position vs. length (only if not endless loop!)
+   if (!!TotalLength() && nPosition >= TotalLength())
+      throw Exception("position exceeds total length of file object");
+
+   int64_t nFilePosition;
+   // NOTE: the first m_nCrossfadeOffset samples are
+   // only used in the very first loop (later the crossfade buffer
+   // is used for adding up in SDPOutputData lass)).
+   // Thus we have to check, if we are within the first loop
+   if (nPosition < UsedLength() - m_nStartPos)
+      nFilePosition = (int64_t)(m_nStartPos + nPosition + m_nFileOffset);
+   else
+      {
+      // then check position within file with respect to used length.
+      // - First we subtract 'incomplete' first loop (where m_nStartPos was used) to have
+      //   correct 'looplength' for 'modulo' which is UsedLength() -  m_nCrossfadeOffset
+      // - finally add m_nCrossfadeOffset (first m_nCrossfadeOffset samples are in crossfade-buffer)
+      //   and the file offset
+      nFilePosition = (int64_t)(((nPosition - (UsedLength() - m_nStartPos)) % (UsedLength() -  m_nCrossfadeOffset))
+                     + m_nCrossfadeOffset + m_nFileOffset);
+      }
+
+   if (nFilePosition >= (int64_t)m_nFileSize)
+      nFilePosition -= m_nFileSize;
+
+   int64_t n = sf_seek(m_pSndFile, nFilePosition, SEEK_SET);
+   if (n != nFilePosition)
+      throw Exception("Error getting file sample position");
+   m_nFilePos = (uint64_t)nFilePosition;
+   // set numbers of samples already read.
+   m_nSamplesReadFromFile  = nPosition;
+
+   EnterCriticalSection(&m_csBuffers);
+   m_nSeekPosition         = nPosition;
+   m_bSeekFresh            = true;
+   // reset buffers
+   for (int i = 0; i < 2; i++)
+      {
+      m_sdpWB[i].m_wrbStatus  = SDP_WAVEREADERBUFFERSTATUS_DONE;
+      m_sdpWB[i].m_nPending   = 0;
       }
+   LeaveCriticalSection(&m_csBuffers);
 }
 //------------------------------------------------------------------------------
 
 //------------------------------------------------------------------------------
-/// sets 'total' position within file object with respect to loop count,
-/// start offset and file snippet
+/// sets 'total' position within file object and fills both buffers.
+/// Waits for the pool to fill the buffers, so it must only be called from
+/// main thread (never from processing thread or pool workers).
 /// IMPORTANT NOTE: must nevber be called, while 'really' in use, i.e. if
 /// GetSample is currently called asynchronously!!!
 //------------------------------------------------------------------------------
-void SDPWaveReader::SetPosition(uint64_t nPosition)
+void SDPWaveFile::Seek(uint64_t nPosition)
 {
 
 //OutputDebugString(__FUNC__);
@@ -441,97 +1214,44 @@ void SDPWaveReader::SetPosition(uint64_t nPosition)
       EnterCriticalSection(&m_csFile);
       try
          {
-         // check position vs. length (only if not endless loop!)
-         if (!!TotalLength() && nPosition >= TotalLength())
-            throw Exception("position exceeds total length of file object");
-
          strError = "set file position";
-         int64_t nFilePosition;
-         // NOTE: the first m_nCrossfadeOffset samples are
-         // only used in the very first loop (later the crossfade buffer
-         // is used for adding up in SDPOutputData lass)).
-         // Thus we have to check, if we are within the first loop
-         if (nPosition < UsedLength() - m_nStartPos)
-            nFilePosition = (int64_t)(m_nStartPos + nPosition + m_nFileOffset);
-         else
-            {
-            // then check position within file with respect to used length.
-            // - First we subtract 'incomplete' first loop (where m_nStartPos was used) to have
-            //   correct 'looplength' for 'modulo' which is UsedLength() -  m_nCrossfadeOffset
-            // - finally add m_nCrossfadeOffset (first m_nCrossfadeOffset samples are in crossfade-buffer)
-            //   and the file offset
-            nFilePosition = (int64_t)(((nPosition - (UsedLength() - m_nStartPos)) % (UsedLength() -  m_nCrossfadeOffset))
-                           + m_nCrossfadeOffset + m_nFileOffset);
-            }
-
-         if (nFilePosition >= (int64_t)m_nFileSize)
-            nFilePosition -= m_nFileSize;
-
-         int64_t n = sf_seek(m_pSndFile, nFilePosition, SEEK_SET);
-         if (n != nFilePosition)
-            throw Exception("Error getting file sample position");
-         m_bDone = false;
-         m_nFilePos = (uint64_t)nFilePosition;
-         // set numbers of samples already read.
-         m_nSamplesRead          = nPosition;
-         m_nSamplesReadFromFile  = m_nSamplesRead;
-
-
-         strError = "reset buffers";
-         // reset buffers
-         m_nReadBufIndex = 0;
-         m_nReadPos      = 0;
+         SetFilePosition(nPosition);
          }
       __finally
          {
-         // leave critical section before setting signals for thread to allow
-         // ReadData (called by thread function) to enter the critical section
+         // leave critical section before requesting data to allow
+         // ReadData (called by pool worker) to enter the critical section
          LeaveCriticalSection(&m_csFile);
          }
 
-      m_sdpWB[0].m_wrbStatus = SDP_WAVEREADERBUFFERSTATUS_DONE;
-      m_sdpWB[1].m_wrbStatus = SDP_WAVEREADERBUFFERSTATUS_DONE;
-
-      strError = "resume thread";
-      if (Suspended)
-          Start();
-
-      strError = "set thread re-start events";
-      // tell thread to read data
-      if (!SetEvent(m_hEvents[SDP_WAVEREADEREVENT_LOAD]))
-         throw Exception("error setting load event");
+      strError = "request buffers";
+      // tell pool to read data immediately
+      m_psdpwfp->Request(this, 0.0);
 
       strError = "wait for filled buffers";
-      // wait until thread is really running, i.e. first buffers are filled!
+      // wait until first buffers are filled!
       DWORD dw = GetTickCount();
       while (  m_sdpWB[0].m_wrbStatus != SDP_WAVEREADERBUFFERSTATUS_FILLED
             || m_sdpWB[1].m_wrbStatus != SDP_WAVEREADERBUFFERSTATUS_FILLED
             )
          {
          Sleep(1);
-         Application->ProcessMessages();
+         if (GetCurrentThreadId() == MainThreadID)
+            Application->ProcessMessages();
          if (ElapsedSince(dw) > 2000)
-            {
-            if (Suspended)
-               throw Exception("error resuming file reader thread");
             throw Exception("error reading file samples");
-            }
-         if (Terminated)
+         if (!m_strThreadError.IsEmpty())
             break;
          }
 
-      // check, if thread func itself had an error and terminated the thread
+      // check, if worker had an error reading data
       if (!m_strThreadError.IsEmpty())
          throw Exception(m_strThreadError);
       }
    catch (Exception &e)
       {
-      // tell thread to stop
-      if (!!m_hEvents[SDP_WAVEREADEREVENT_STOP])
-         {
-         if (!SetEvent(m_hEvents[SDP_WAVEREADEREVENT_STOP]))
-            throw Exception("error setting stop event");
-         }
+      // wait until no worker is reading the file any more
+      m_psdpwfp->Cancel(this);
 
       if (m_pSndFile)
          sf_close(m_pSndFile);
@@ -544,6 +1264,451 @@ void SDPWaveReader::SetPosition(uint64_t nPosition)
 }
 //------------------------------------------------------------------------------
 
+//------------------------------------------------------------------------------
+/// called by pool worker for an own (not shared) file instance of a detached
+/// reader: attaches the reader exclusively at passed position and fills both
+/// buffers directly without waiting for the pool
+//------------------------------------------------------------------------------
+void SDPWaveFile::Prepare(SDPWaveReader* psdpwr, uint64_t nPosition)
+{
+   // mapped files have no buffers: nothing to attach to, only prefetch the
+   // pages at passed position
+   if (IsMapped())
+      {
+      if (!!TotalLength() && nPosition >= TotalLength())
+         throw Exception("position exceeds total length of file object");
+      Prefetch(nPosition, PrefetchEnd(nPosition));
+      return;
+      }
+   EnterCriticalSection(&m_csFile);
+   try
+      {
+      EnterCriticalSection(&m_csBuffers);
+      m_vpsdpwr.clear();
+      m_vpsdpwr.push_back(psdpwr);
+      LeaveCriticalSection(&m_csBuffers);
+      SetFilePosition(nPosition);
+      }
+   __finally
+      {
+      LeaveCriticalSection(&m_csFile);
+      }
+   ReadData();
+}
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+/// attaches a reader to the buffers at passed position. If the buffers were
+/// just filled for the same position (i.e. another channel of the same file
+/// was set to that position before and no buffer was consumed completely
+/// since then) the reader simply joins the buffers. Otherwise a seek is done
+/// and all other readers are detached: they have to call SetPosition again to
+/// be re-attached.
+//------------------------------------------------------------------------------
+void SDPWaveFile::Attach(SDPWaveReader* psdpwr, uint64_t nPosition)
+{
+   bool bJoin;
+   EnterCriticalSection(&m_csFile);
+   EnterCriticalSection(&m_csBuffers);
+   try
+      {
+      std::vector<SDPWaveReader*>::iterator it = std::find(m_vpsdpwr.begin(), m_vpsdpwr.end(), psdpwr);
+      bJoin =  m_bSeekFresh
+            && m_nSeekPosition == nPosition
+            && m_sdpWB[0].m_wrbStatus == SDP_WAVEREADERBUFFERSTATUS_FILLED
+            && m_sdpWB[1].m_wrbStatus == SDP_WAVEREADERBUFFERSTATUS_FILLED;
+      if (bJoin)
+         {
+         // NOTE: if already attached, then reader still holds both buffers
+         if (it == m_vpsdpwr.end())
+            {
+            m_vpsdpwr.push_back(psdpwr);
+            for (int i = 0; i < 2; i++)
+               {
+               psdpwr->m_abHold[i] = true;
+               InterlockedIncrement(&m_sdpWB[i].m_nPending);
+               }
+            }
+         }
+      else
+         {
+         for (unsigned int n = 0; n < m_vpsdpwr.size(); n++)
+            {
+            m_vpsdpwr[n]->m_bAttached = false;
+            m_vpsdpwr[n]->m_abHold[0] = false;
+            m_vpsdpwr[n]->m_abHold[1] = false;
+            }
+         m_vpsdpwr.clear();
+         m_vpsdpwr.push_back(psdpwr);
+         }
+      }
+   __finally
+      {
+      LeaveCriticalSection(&m_csBuffers);
+      LeaveCriticalSection(&m_csFile);
+      }
+   if (!bJoin)
+      Seek(nPosition);
+   psdpwr->m_bAttached = true;
+}
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+/// detaches a reader from the buffers and releases all buffers it still holds.
+/// NOTE: called in destructor, so no exceptions are thrown here
+//------------------------------------------------------------------------------
+void SDPWaveFile::Detach(SDPWaveReader* psdpwr)
+{
+   EnterCriticalSection(&m_csFile);
+   EnterCriticalSection(&m_csBuffers);
+   try
+      {
+      std::vector<SDPWaveReader*>::iterator it = std::find(m_vpsdpwr.begin(), m_vpsdpwr.end(), psdpwr);
+      if (it != m_vpsdpwr.end())
+         m_vpsdpwr.erase(it);
+      bool bRequest = false;
+      for (int i = 0; i < 2; i++)
+         {
+         if (!psdpwr->m_abHold[i])
+            continue;
+         psdpwr->m_abHold[i] = false;
+         if (InterlockedDecrement(&m_sdpWB[i].m_nPending) <= 0)
+            {
+            m_sdpWB[i].m_wrbStatus = SDP_WAVEREADERBUFFERSTATUS_DONE;
+            bRequest = true;
+            }
+         }
+      psdpwr->m_bAttached = false;
+      if (bRequest)
+         {
+         try
+            {
+            m_psdpwfp->Request(this, RefillDeadline());
+            }
+         catch (...)
+            {
+            }
+         }
+      }
+   __finally
+      {
+      LeaveCriticalSection(&m_csBuffers);
+      LeaveCriticalSection(&m_csFile);
+      }
+}
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+/// called by a reader if it has consumed a buffer completely. If all attached
+/// readers have consumed it, the buffer is set to 'done' and a refill is
+/// requested from the pool.
+/// NOTE: readers of the same file may be called concurrently by track workers,
+/// so the shared state is changed within m_csBuffers. This critical section
+/// is never held during file access, so it does not block on reading
+//------------------------------------------------------------------------------
+void SDPWaveFile::ReleaseBuffer(SDPWaveReader* psdpwr, int nIndex)
+{
+   bool bRequest = false;
+   EnterCriticalSection(&m_csBuffers);
+   if (psdpwr->m_abHold[nIndex])
+      {
+      psdpwr->m_abHold[nIndex] = false;
+      m_bSeekFresh = false;
+      if (--m_sdpWB[nIndex].m_nPending <= 0)
+         {
+         // set actual to done
+         m_sdpWB[nIndex].m_wrbStatus = SDP_WAVEREADERBUFFERSTATUS_DONE;
+         bRequest = true;
+         }
+      }
+   LeaveCriticalSection(&m_csBuffers);
+   // request refilling before the other buffer runs dry
+   if (bRequest)
+      m_psdpwfp->Request(this, RefillDeadline());
+}
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+/// returns filename
+//------------------------------------------------------------------------------
+AnsiString SDPWaveFile::GetFileName()
+{
+   return m_strFileName;
+}
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+/// returns number of channels in file
+//------------------------------------------------------------------------------
+unsigned int SDPWaveFile::NumChannels()
+{
+   return m_nNumFileChannels;
+}
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+/// returns file size in samples
+//------------------------------------------------------------------------------
+uint64_t SDPWaveFile::FileSize()
+{
+   return m_nFileSize;
+}
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+/// returns total lenght to play in samples with respect to start position and
+/// looping
+//------------------------------------------------------------------------------
+uint64_t SDPWaveFile::TotalLength()
+{
+   return m_nTotalLength;
+}
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+/// returns used length or 0, if complete file used
+//------------------------------------------------------------------------------
+uint64_t SDPWaveFile::UsedLength()
+{
+   if (!m_nLength)
+      return m_nFileSize;
+   return  m_nLength;
+}
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+/// constructor. Uses SDPWaveFile instance passed in rsdpodFile.psdpwf or
+/// creates an own one, if none passed
+//------------------------------------------------------------------------------
+SDPWaveReader::SDPWaveReader( SDPOD_AUDIO       &rsdpodFile,
+                              unsigned int      nDeviceSampleRate,
+                              unsigned int      nMinBufsize)
+   : m_psdpwf(NULL),
+     m_nFileChannel(rsdpodFile.nChannelIndex),
+     m_nReadPos(0),
+     m_nSamplesRead(0),
+     m_nPrefetchPos(0),
+     m_bDone(false),
+     m_nReadBufIndex(0),
+     m_bStarted(false),
+     m_bAttached(false),
+     m_nSplitState(SDP_WAVEREADERSPLIT_NONE),
+     m_psdpwfSplit(NULL),
+     m_psdpwfRetired(NULL),
+     m_nSplitPosition(0),
+     m_nUnderrun(0),
+     m_bSplitQueued(false),
+     m_bSplitBusy(false)
+{
+   m_abHold[0] = false;
+   m_abHold[1] = false;
+   if (rsdpodFile.psdpwf)
+      {
+      m_psdpwf = rsdpodFile.psdpwf;
+      m_psdpwf->AddRef();
+      }
+   else
+      m_psdpwf = new SDPWaveFile(rsdpodFile, nDeviceSampleRate, nMinBufsize);
+
+   // check, that channel is within range
+   if (m_nFileChannel >= m_psdpwf->NumChannels())
+      {
+      AnsiString str = "error loading file '" + ExpandFileName(m_psdpwf->GetFileName())
+                     + "': requested channel is out of range (requested: "
+                     + IntToStr((int)m_nFileChannel)
+                     + ", available: "
+                     + IntToStr((int)m_psdpwf->NumChannels())
+                     + ")";
+      m_psdpwf->Release();
+      m_psdpwf = NULL;
+      throw Exception(str);
+      }
+}
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+/// destructor. Detaches from buffers and releases file instance
+//------------------------------------------------------------------------------
+SDPWaveReader::~SDPWaveReader()
+{
+   CancelSplit();
+   if (m_psdpwf)
+      {
+      if (m_bAttached)
+         m_psdpwf->Detach(this);
+      m_psdpwf->Release();
+      m_psdpwf = NULL;
+      }
+}
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+/// sets 'total' position within file object with respect to loop count,
+/// start offset and file snippet
+/// IMPORTANT NOTE: must nevber be called, while 'really' in use, i.e. if
+/// GetSample is currently called asynchronously!!!
+//------------------------------------------------------------------------------
+void SDPWaveReader::SetPosition(uint64_t nPosition)
+{
+   CancelSplit();
+   // mapped files have no buffers: nothing to attach to, but the first pages
+   // are prefetched here (like the buffers are filled by Seek)
+   if (m_psdpwf->IsMapped())
+      {
+      if (!!TotalLength() && nPosition >= TotalLength())
+         throw Exception("error setting file position of file '" + ExpandFileName(GetFileName()) + "': position exceeds total length of file object");
+      m_nPrefetchPos = m_psdpwf->PrefetchEnd(nPosition);
+      m_psdpwf->Prefetch(nPosition, m_nPrefetchPos);
+      }
+   else
+      m_psdpwf->Attach(this, nPosition);
+   m_bDone = false;
+   // set numbers of samples already read.
+   m_nSamplesRead    = nPosition;
+   // reset buffers
+   m_nReadBufIndex   = 0;
+   m_nReadPos        = 0;
+}
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+/// Called on processing thread, if reader was detached from shared buffers by
+/// another reader seeking to a different position without being re-attached
+/// by SetPosition. No file access is done here: an own SDPWaveFile instance
+/// is requested from the pool, which opens it and fills its buffers at the
+/// current position. Until it is ready the reader returns zeros (counted as
+/// underrun in pool statistics) and keeps on counting its position, then it
+/// skips the samples missed meanwhile within the new buffers. Returns true,
+/// if reader is attached again.
+/// NOTE: this is a fallback for readers not being re-positioned after a seek.
+/// It is not expected to happen regularly, since all channels of a shared
+/// file are set to the same position
+//------------------------------------------------------------------------------
+bool SDPWaveReader::Reattach()
+{
+   SDPWaveFilePool* psdpwfp = m_psdpwf->m_psdpwfp;
+   if (m_nSplitState == SDP_WAVEREADERSPLIT_REQUESTED)
+      return false;
+   if (m_nSplitState == SDP_WAVEREADERSPLIT_ERROR)
+      throw Exception("error re-attaching to file '" + GetFileName() + "': " + m_strSplitError);
+   // not ready yet, or ready too late (buffers do not contain current position
+   // any longer): request own file instance at current position. NOTE: a file
+   // instance prepared already is re-used by worker
+   if (  m_nSplitState == SDP_WAVEREADERSPLIT_NONE
+      || (  !m_psdpwfSplit->IsMapped()
+         && m_nSamplesRead - m_nSplitPosition >= 2*(uint64_t)m_psdpwfSplit->m_nBufferSize
+         )
+      )
+      {
+      m_nSplitPosition  = m_nSamplesRead;
+      m_nSplitState     = SDP_WAVEREADERSPLIT_REQUESTED;
+      psdpwfp->RequestSplit(this);
+      return false;
+      }
+
+   // switch to own instance. NOTE: releasing the shared instance might delete
+   // it (closing the file), so this is left to SetPosition or destructor. Own
+   // instance is never shared, so it cannot be detached again
+   m_psdpwfRetired   = m_psdpwf;
+   m_psdpwf          = m_psdpwfSplit;
+   m_psdpwfSplit     = NULL;
+   m_nSplitState     = SDP_WAVEREADERSPLIT_NONE;
+   m_bAttached       = true;
+   if (m_psdpwf->IsMapped())
+      m_nPrefetchPos = m_psdpwf->PrefetchEnd(m_nSplitPosition);
+   else
+      {
+      // skip samples returned as zeros meanwhile
+      m_nReadBufIndex   = 0;
+      m_nReadPos        = (unsigned int)(m_nSamplesRead - m_nSplitPosition);
+      if (m_nReadPos >= m_psdpwf->m_nBufferSize)
+         {
+         m_psdpwf->ReleaseBuffer(this, 0);
+         m_nReadBufIndex   = 1;
+         m_nReadPos        -= m_psdpwf->m_nBufferSize;
+         }
+      }
+   psdpwfp->AddUnderrun(m_nUnderrun);
+   m_nUnderrun = 0;
+   return true;
+}
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+/// called by pool worker: creates own SDPWaveFile instance (or re-uses the one
+/// prepared before) and fills its buffers at requested position
+//------------------------------------------------------------------------------
+void SDPWaveReader::PrepareSplit()
+{
+   try
+      {
+      if (!m_psdpwfSplit)
+         m_psdpwfSplit = new SDPWaveFile( m_psdpwf->m_sdpodFile,
+                                          m_psdpwf->m_nDeviceSampleRate,
+                                          m_psdpwf->m_nMinBufsize);
+      m_psdpwfSplit->Prepare(this, m_nSplitPosition);
+      InterlockedExchange(&m_nSplitState, SDP_WAVEREADERSPLIT_READY);
+      }
+   catch (Exception &e)
+      {
+      m_strSplitError = e.Message;
+      InterlockedExchange(&m_nSplitState, SDP_WAVEREADERSPLIT_ERROR);
+      }
+}
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+/// cancels re-attaching and releases file instances that were prepared or
+/// replaced by Reattach. Must not be called from processing thread.
+/// NOTE: called in destructor, so no exceptions are thrown here
+//------------------------------------------------------------------------------
+void SDPWaveReader::CancelSplit()
+{
+   SDPWaveFilePool* psdpwfp = SDPWaveFilePool::Instance();
+   if (psdpwfp)
+      {
+      psdpwfp->CancelSplit(this);
+      if (m_nUnderrun)
+         psdpwfp->AddUnderrun(m_nUnderrun);
+      }
+   m_nUnderrun       = 0;
+   m_nSplitState     = SDP_WAVEREADERSPLIT_NONE;
+   m_strSplitError   = "";
+   if (m_psdpwfSplit)
+      {
+      m_psdpwfSplit->Release();
+      m_psdpwfSplit = NULL;
+      }
+   if (m_psdpwfRetired)
+      {
+      m_psdpwfRetired->Release();
+      m_psdpwfRetired = NULL;
+      }
+}
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+/// called on processing thread for mapped files: requests the pool to prefetch
+/// the pages up to m_nBufferSize frames ahead of the read position, if less
+/// than half of them are left. The deadline is the time when the reader will
+/// reach the first page not prefetched yet
+//------------------------------------------------------------------------------
+void SDPWaveReader::PrefetchMapped()
+{
+   if (m_nSamplesRead + m_psdpwf->m_nBufferSize / 2 < m_nPrefetchPos)
+      return;
+   uint64_t nFrom = m_nPrefetchPos > m_nSamplesRead ? m_nPrefetchPos : m_nSamplesRead;
+   m_nPrefetchPos = m_psdpwf->PrefetchEnd(m_nSamplesRead);
+   if (nFrom >= m_nPrefetchPos)
+      return;
+   SDPWaveFilePool* psdpwfp = m_psdpwf->m_psdpwfp;
+   double dDeadline = 0.0;
+   if (nFrom > m_nSamplesRead)
+      dDeadline = psdpwfp->Now() + 1000.0 * (double)(nFrom - m_nSamplesRead) / (double)m_psdpwf->m_nDeviceSampleRate;
+   psdpwfp->RequestPrefetch(m_psdpwf, nFrom, m_nPrefetchPos, dDeadline);
+}
+//------------------------------------------------------------------------------
+
 //------------------------------------------------------------------------------
 /// returns one sample
 //------------------------------------------------------------------------------
@@ -553,63 +1718,152 @@ float SDPWaveReader::GetFileSample(bool bFileReadLazy)
    float fReturn = 0.0f;
    if (m_bDone)
       throw Exception("try to get file samples from done file");
+   if (m_psdpwf->IsMapped())
+      {
+      uint64_t nContiguous;
+      PrefetchMapped();
+      m_psdpwf->ReadMapped(m_psdpwf->FilePosition(m_nSamplesRead, nContiguous), m_nFileChannel, &fReturn, 1);
+      m_nSamplesRead++;
+      if (m_nSamplesRead == TotalLength() && !IsEndlessLoop())
+         m_bDone = true;
+      return fReturn;
+      }
+   if (!m_bAttached && !Reattach())
+      {
+      // no data until own file instance is ready: return zero
+      m_nSamplesRead++;
+      m_nUnderrun++;
+      if (m_nSamplesRead == TotalLength() && !IsEndlessLoop())
+         m_bDone = true;
+      return fReturn;
+      }
 
-   if (m_nReadPos < m_nBufferSize)
+   if (m_nReadPos < m_psdpwf->m_nBufferSize)
       {
-      fReturn     = m_sdpWB[m_nReadBufIndex].m_vafBuffer[m_nReadPos++*m_nNumFileChannels + m_nFileChannel];
+      fReturn     = m_psdpwf->m_sdpWB[m_nReadBufIndex].m_vvafChannels[m_nFileChannel][m_nReadPos++];
       m_nSamplesRead++;
 
       // completely done?
-      if (m_nSamplesRead == m_nTotalLength && !!m_nTotalLength)
+      if (m_nSamplesRead == TotalLength() && !IsEndlessLoop())
          m_bDone = true;
       // end of buffer reached after increment, but not completely done?
       //    -> switch data buffer
-      else if (m_nReadPos == m_nBufferSize)
+      else if (m_nReadPos == m_psdpwf->m_nBufferSize)
          {
-         // set actual to done
-         m_sdpWB[m_nReadBufIndex].m_wrbStatus = SDP_WAVEREADERBUFFERSTATUS_DONE;
-         // tell thread to read data
-         if (!SetEvent(m_hEvents[SDP_WAVEREADEREVENT_LOAD]))
-            throw Exception("error setting load event");
+         // release actual buffer (set to done, if consumed by all readers)
+         m_psdpwf->ReleaseBuffer(this, m_nReadBufIndex);
          // switch
          m_nReadBufIndex = (int)(!(bool)m_nReadBufIndex);
 
+         SDPWaveReaderBuffer& rsdpwb = m_psdpwf->m_sdpWB[m_nReadBufIndex];
          // if we are called with bFileReadLazy == true, then we are allowed for other
          // buffer to be ready again for a while (here: max 1 second)
          if (bFileReadLazy)
             {
             DWORD dw = GetTickCount();
-            while (m_sdpWB[m_nReadBufIndex].m_wrbStatus != SDP_WAVEREADERBUFFERSTATUS_FILLED)
+            while (  rsdpwb.m_wrbStatus != SDP_WAVEREADERBUFFERSTATUS_FILLED
+                  || !m_abHold[m_nReadBufIndex]
+                  )
                {
                if (ElapsedSince(dw) > 1000)
                   break;
                }
             }
 
-         // check, if we are allowed to read the other buffer!
-         if (m_sdpWB[m_nReadBufIndex].m_wrbStatus != SDP_WAVEREADERBUFFERSTATUS_FILLED)
+         // check, if we are allowed to read the other buffer! NOTE: if buffer
+         // is not held by this reader, then it still contains data already
+         // consumed by this reader
+         if (  rsdpwb.m_wrbStatus != SDP_WAVEREADERBUFFERSTATUS_FILLED
+            || !m_abHold[m_nReadBufIndex]
+            )
             {
             throw Exception("unexpected wave file read error (no filled data buffer): "
-            + IntToStr((int)m_nSamplesRead) + ", " + IntToStr((int)m_nTotalLength) + ", "
-            + IntToStr((int)m_nTotalLength-(int)m_nSamplesRead)
+            + IntToStr((int)m_nSamplesRead) + ", " + IntToStr((int)TotalLength()) + ", "
+            + IntToStr((int)TotalLength()-(int)m_nSamplesRead)
             );
             }
          m_nReadPos = 0;
          }
       }
    else
-      throw Exception("unexpected wave file read error 1 (" + IntToStr((int)m_nReadPos) + ":" + IntToStr((int)m_nBufferSize) + ")");
+      throw Exception("unexpected wave file read error 1 (" + IntToStr((int)m_nReadPos) + ":" + IntToStr((int)m_psdpwf->m_nBufferSize) + ")");
 
    return fReturn;
 }
 //------------------------------------------------------------------------------
 
+//------------------------------------------------------------------------------
+/// copies up to nSamples subsequent samples from current read buffer to passed
+/// buffer. Never switches read buffers and never copies the last sample of data:
+/// both is left to GetFileSample. Returns number of samples copied (may be 0).
+/// For mapped files samples are converted directly from the mapping up to the
+/// end of the loop
+//------------------------------------------------------------------------------
+unsigned int SDPWaveReader::GetFileSamples(float* pfBuffer, unsigned int nSamples)
+{
+   if (m_bDone)
+      throw Exception("try to get file samples from done file");
+   if (m_psdpwf->IsMapped())
+      {
+      uint64_t nContiguous;
+      uint64_t nFramePos = m_psdpwf->FilePosition(m_nSamplesRead, nContiguous);
+      if (nContiguous > nSamples)
+         nContiguous = nSamples;
+      // leave last sample of data to GetFileSample
+      if (!IsEndlessLoop() && m_nSamplesRead + nContiguous >= TotalLength())
+         nContiguous = TotalLength() - m_nSamplesRead - 1;
+      if (!nContiguous)
+         return 0;
+      m_bStarted = true;
+      PrefetchMapped();
+      m_psdpwf->ReadMapped(nFramePos, m_nFileChannel, pfBuffer, (unsigned int)nContiguous);
+      m_nSamplesRead += nContiguous;
+      return (unsigned int)nContiguous;
+      }
+   if (!m_bAttached && !Reattach())
+      {
+      // no data until own file instance is ready: return zeros, but leave last
+      // sample of data to GetFileSample
+      unsigned int nNum = nSamples;
+      if (!IsEndlessLoop() && m_nSamplesRead + nNum >= TotalLength())
+         nNum = (unsigned int)(TotalLength() - m_nSamplesRead - 1);
+      if (!nNum)
+         return 0;
+      m_bStarted = true;
+      memset(pfBuffer, 0, nNum*sizeof(float));
+      m_nSamplesRead += nNum;
+      m_nUnderrun    += nNum;
+      return nNum;
+      }
+   unsigned int nBufferSize = m_psdpwf->m_nBufferSize;
+   if (m_nReadPos >= nBufferSize)
+      throw Exception("unexpected wave file read error 2 (" + IntToStr((int)m_nReadPos) + ":" + IntToStr((int)nBufferSize) + ")");
+
+   // leave last sample of current buffer to GetFileSample
+   unsigned int nNum = nBufferSize - m_nReadPos - 1;
+   if (nNum > nSamples)
+      nNum = nSamples;
+   // leave last sample of data to GetFileSample
+   if (!IsEndlessLoop() && m_nSamplesRead + nNum >= TotalLength())
+      nNum = (unsigned int)(TotalLength() - m_nSamplesRead - 1);
+   if (!nNum)
+      return 0;
+
+   m_bStarted = true;
+   // channel buffers are deinterleaved, so we can copy directly
+   memcpy(pfBuffer, &m_psdpwf->m_sdpWB[m_nReadBufIndex].m_vvafChannels[m_nFileChannel][m_nReadPos], nNum*sizeof(float));
+   m_nReadPos     += nNum;
+   m_nSamplesRead += nNum;
+   return nNum;
+}
+//------------------------------------------------------------------------------
+
 //------------------------------------------------------------------------------
 /// returns file size in samples
 //------------------------------------------------------------------------------
 uint64_t SDPWaveReader::FileSize()
 {
-   return m_nFileSize;
+   return m_psdpwf->FileSize();
 }
 //------------------------------------------------------------------------------
 
@@ -619,7 +1873,7 @@ uint64_t SDPWaveReader::FileSize()
 //------------------------------------------------------------------------------
 uint64_t SDPWaveReader::TotalLength()
 {
-   return m_nTotalLength;
+   return m_psdpwf->TotalLength();
 }
 //------------------------------------------------------------------------------
 
@@ -628,7 +1882,7 @@ uint64_t SDPWaveReader::TotalLength()
 //------------------------------------------------------------------------------
 bool SDPWaveReader::IsEndlessLoop()
 {
-   return (m_nTotalLength == 0);
+   return (m_psdpwf->TotalLength() == 0);
 }
 //------------------------------------------------------------------------------
 
@@ -646,7 +1900,7 @@ bool SDPWaveReader::Done()
 //------------------------------------------------------------------------------
 AnsiString SDPWaveReader::GetFileName()
 {
-   return m_strFileName;
+   return m_psdpwf->GetFileName();
 }
 //------------------------------------------------------------------------------
 
@@ -664,7 +1918,7 @@ unsigned int SDPWaveReader::GetFileChannel()
 //------------------------------------------------------------------------------
 uint64_t SDPWaveReader::GetStartOffset()
 {
-   return m_nStartPos;
+   return m_psdpwf->m_nStartPos;
 }
 //------------------------------------------------------------------------------
 
@@ -673,7 +1927,7 @@ uint64_t SDPWaveReader::GetStartOffset()
 //------------------------------------------------------------------------------
 uint64_t SDPWaveReader::GetFileOffset()
 {
-   return m_nFileOffset;
+   return m_psdpwf->m_nFileOffset;
 }
 //------------------------------------------------------------------------------
 
@@ -700,9 +1954,7 @@ bool SDPWaveReader::Started()
 //------------------------------------------------------------------------------
 uint64_t SDPWaveReader::UsedLength()
 {
-   if (!m_nLength)
-      return m_nFileSize;
-   return  m_nLength;
+   return m_psdpwf->UsedLength();
 }
 //------------------------------------------------------------------------------
 
@@ -746,17 +1998,19 @@ uint64_t  SDPWaveReader::GetLoopPosition()
 {
    // - in first loop the position is 'simply' GetSamplesRead - StartOffset
    uint64_t  nReturn;
-   if (m_nSamplesRead < (UsedLength() - m_nStartPos))
-      nReturn = m_nSamplesRead + m_nStartPos;
+   uint64_t  nStartPos        = m_psdpwf->m_nStartPos;
+   uint64_t  nCrossfadeOffset = m_psdpwf->m_nCrossfadeOffset;
+   if (m_nSamplesRead < (UsedLength() - nStartPos))
+      nReturn = m_nSamplesRead + nStartPos;
    else
       {
       // subtract first incomplete loop WITHOUT subtracting m_nCrossfadeOffset
-      nReturn = m_nSamplesRead - (UsedLength()-m_nStartPos);
+      nReturn = m_nSamplesRead - (UsedLength()-nStartPos);
       // calculate number of available in m_nSamplesRead, where loops (beginning
       // with second loop) only have UsedLength()-m_nCrossfadeOffset samples!
-      uint64_t nNumLoops = nReturn / (UsedLength()-m_nCrossfadeOffset) + 1;
+      uint64_t nNumLoops = nReturn / (UsedLength()-nCrossfadeOffset) + 1;
       // add up NumLoops * m_nCrossfadeOffset (as if it were 'full' loops)
-      nReturn += nNumLoops*m_nCrossfadeOffset;
+      nReturn += nNumLoops*nCrossfadeOffset;
       //
       nReturn = nReturn % (UsedLength());
       }
@@ -1,7 +1,11 @@
 /// \file SoundDllPro_WaveReader_libsndfile.h
 /// \author Berg
-/// \brief Implementation of class SDPWaveReader. Encapsulates buffered reading
-/// of a single channel of a PCM wave file using a thread for non-blocking reading.
+/// \brief Implementation of classes SDPWaveFilePool, SDPWaveFile and
+/// SDPWaveReader. Encapsulates buffered reading of a PCM wave file using a
+/// small pool of worker threads for non-blocking reading of all files.
+/// All channels are read once by SDPWaveFile and shared by the SDPWaveReader
+/// instances reading single channels. Uncompressed WAV/RF64 files are read
+/// directly from a memory mapping of the file without any buffering.
 /// Uses libsndfile
 ///
 /// Project SoundMexPro
@@ -45,6 +49,9 @@
 
 #define WAVREAD_DEFAULTBUFSIZE   655360
 #define WAVREAD_MINBUFSIZE       65536
+#define WAVREAD_DEFAULTTHREADS   2
+#define WAVREAD_MAXTHREADS       16
+#define WAVREAD_PAGESIZE         4096
 
 //------------------------------------------------------------------------------
 /// enumeration of buffer status values formats
@@ -57,68 +64,247 @@ enum SDPWaveReaderBufferStatus
 //------------------------------------------------------------------------------
 
 //------------------------------------------------------------------------------
-/// enumeration of sync events
+/// enumeration of states of re-attaching a detached reader
 //------------------------------------------------------------------------------
-enum SDPWaveReaderEvents
+enum SDPWaveReaderSplitState
 {
-   SDP_WAVEREADEREVENT_LOAD = 0,
-   SDP_WAVEREADEREVENT_STOP
+   SDP_WAVEREADERSPLIT_NONE = 0,
+   SDP_WAVEREADERSPLIT_REQUESTED,
+   SDP_WAVEREADERSPLIT_READY,
+   SDP_WAVEREADERSPLIT_ERROR
 };
 //------------------------------------------------------------------------------
 
 //------------------------------------------------------------------------------
-/// helper class encapsulating one float buffer an it's status
+/// enumeration of sync objects of file reader pool
+//------------------------------------------------------------------------------
+enum SDPWaveFilePoolEvents
+{
+   SDP_WAVEFILEPOOLEVENT_STOP = 0,
+   SDP_WAVEFILEPOOLEVENT_REQUEST
+};
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+/// helper class encapsulating one deinterleaved float buffer an it's status
 //------------------------------------------------------------------------------
 class SDPWaveReaderBuffer
 {
    public:
-      std::valarray<float>       m_vafBuffer;          /// float buffer containing one channel as normalized floats
-      SDPWaveReaderBufferStatus  m_wrbStatus;          /// status of buffer (filled or done)
+      std::vector<std::valarray<float> > m_vvafChannels; /// one float buffer per file channel as normalized floats
+      volatile SDPWaveReaderBufferStatus m_wrbStatus;  /// status of buffer (filled or done)
+      volatile LONG              m_nPending;           /// number of attached readers that did not consume buffer yet
+};
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+/// statistics of file reader pool. Times in milliseconds
+//------------------------------------------------------------------------------
+class SDPWaveFilePoolStats
+{
+   public:
+      unsigned int   nQueueDepth;      /// number of currently queued refill requests
+      unsigned int   nMaxQueueDepth;   /// maximum number of queued refill requests
+      uint64_t       nRequests;        /// number of refill requests processed
+      uint64_t       nMissed;          /// number of refills done after their deadline
+      double         dWorstSlack;      /// minimum time between end of a refill and its deadline (0 if no refill done)
+      uint64_t       nReattaches;      /// number of detached readers re-attached to an own file instance
+      uint64_t       nUnderrun;        /// number of samples returned as zeros by readers waiting for re-attaching
+};
+//------------------------------------------------------------------------------
+
+class SDPWaveFile;
+class SDPWaveFilePool;
+class SDPWaveReader;
+//------------------------------------------------------------------------------
+/// worker thread of file reader pool
+//------------------------------------------------------------------------------
+class SDPWaveFileWorker : public TThread
+{
+   private:
+      SDPWaveFilePool*           m_psdpwfp;        /// pool the worker belongs to
+   protected:
+      void __fastcall Execute();
+   public:
+      __fastcall SDPWaveFileWorker(SDPWaveFilePool* psdpwfp, int nThreadPriority);
+};
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+/// pool with a fixed number of worker threads refilling the buffers of all
+/// SDPWaveFile instances. Refill requests are processed earliest deadline
+/// first, where the deadline is the time when the buffer that is currently
+/// read will run dry. A file is never read by two workers at a time
+//------------------------------------------------------------------------------
+class SDPWaveFilePool
+{
+   friend class SDPWaveFileWorker;
+   private:
+      static SDPWaveFilePool*          sm_psdpwfp;
+      std::vector<SDPWaveFileWorker*>  m_vpsdpwfw;       /// worker threads
+      std::vector<SDPWaveFile*>        m_vpsdpwfQueue;   /// files with pending refill request
+      std::vector<SDPWaveReader*>      m_vpsdpwrQueue;   /// detached readers with pending re-attach request
+      CRITICAL_SECTION                 m_csQueue;
+      HANDLE                           m_hEvents[2];     /// stop event and request semaphore
+      double                           m_dFrequency;     /// performance counter ticks per millisecond
+      SDPWaveFilePoolStats             m_sdpwfps;        /// statistics
+      bool                             m_bSlackValid;    /// flag, if dWorstSlack contains a value
+      void                             Cleanup();
+      bool                             GetRequest(SDPWaveFile* &rpsdpwf, double &rdDeadline);
+      void                             RequestDone(SDPWaveFile* psdpwf, double dDeadline);
+      void                             Enqueue(SDPWaveFile* psdpwf);
+      void                             GetPrefetch(SDPWaveFile* psdpwf, uint64_t &rnFrom, uint64_t &rnTo);
+      bool                             GetSplitRequest(SDPWaveReader* &rpsdpwr);
+      void                             SplitDone(SDPWaveReader* psdpwr);
+   public:
+      SDPWaveFilePool(unsigned int nNumThreads, int nThreadPriority = 2); // corresponds to tpHighest
+      ~SDPWaveFilePool();
+      static SDPWaveFilePool* Instance();
+      double            Now();
+      void              Request(SDPWaveFile* psdpwf, double dDeadline);
+      void              RequestPrefetch(SDPWaveFile* psdpwf, uint64_t nFrom, uint64_t nTo, double dDeadline);
+      void              Cancel(SDPWaveFile* psdpwf);
+      void              RequestSplit(SDPWaveReader* psdpwr);
+      void              CancelSplit(SDPWaveReader* psdpwr);
+      void              AddUnderrun(uint64_t nSamples);
+      unsigned int      NumThreads();
+      void              GetStats(SDPWaveFilePoolStats &rsdpwfps);
+      void              ResetStats();
 };
 //------------------------------------------------------------------------------
 
 //------------------------------------------------------------------------------
-/// thread class for reading one channel of a wave file
+/// class for reading all channels of a wave file. Decodes file once and
+/// deinterleaves data to per-channel buffers that are shared by all
+/// SDPWaveReader instances attached to it. Buffers are refilled by the workers
+/// of SDPWaveFilePool. Uncompressed WAV/RF64 files (PCM16, PCM24, float) are
+/// memory mapped instead: then no buffers are used and all readers convert
+/// their samples directly from the mapping, while the workers of the pool
+/// prefetch the pages ahead of the read position. Reference counted: never
+/// delete directly, call Release() instead
 //------------------------------------------------------------------------------
-class SDPWaveReader : public TThread
+class SDPWaveFile
 {
+   friend class SDPWaveReader;
+   friend class SDPWaveFilePool;
+   friend class SDPWaveFileWorker;
    private:
       SDPWaveReaderBuffer        m_sdpWB[2];         /// two read buffers for ping-pong reading-writing
-      CRITICAL_SECTION           m_csFile;
+      std::valarray<float>       m_vafReadBuffer;    /// interleaved buffer for reading from file
+      CRITICAL_SECTION           m_csFile;           /// protects file access
+      CRITICAL_SECTION           m_csBuffers;        /// protects buffer status, readers and their hold flags
 
       AnsiString                 m_strFileName;    /// filename of wavefile to read
       SNDFILE*                   m_pSndFile;       /// file handle to wave file
-      HANDLE                     m_hEvents[2];     /// events for thread synchronisation
+      SDPWaveFilePool*           m_psdpwfp;        /// pool reading the data
 
       unsigned int               m_nBufferSize;    /// size of internal buffer(s)
-      unsigned int               m_nFileChannel;   /// channel index to read
-      unsigned int               m_nNumFileChannels;   /// total number of channels 
+      unsigned int               m_nNumFileChannels;   /// total number of channels
 
-      unsigned int               m_nReadPos;       /// current read position within current SDPWaveReaderBuffer
-      uint64_t                   m_nSamplesRead;   /// total number of samples read
       uint64_t                   m_nSamplesReadFromFile;   /// total number of samples read
       uint64_t                   m_nFilePos;       /// internal file pos
-      bool                       m_bDone;          /// flag, if all data were read
       uint64_t                   m_nStartPos;      /// internal start read position within file
       uint64_t                   m_nFileSize;      /// file size in samples
       uint64_t                   m_nLength;        /// used length per loop
-      int                        m_nReadBufIndex;  /// index of current buffer for reading in GetSample
       AnsiString                 m_strThreadError; /// string for thread func error
       uint64_t                   m_nFileOffset;       /// offset in file for snippet
       uint64_t                   m_nFileLastSample;   /// last sample to use for snippet
-      bool                       m_bStarted;          /// flag, if any sample was ever retrieved
       uint64_t                   m_nCrossfadeOffset;  /// length of crossfade for looping
       uint64_t                   m_nTotalLength;      /// total playing length
+      volatile LONG              m_nRefCount;         /// reference count
+      // members below are protected by m_csBuffers (entered within m_csFile, if both are needed)
+      std::vector<SDPWaveReader*> m_vpsdpwr;          /// readers currently attached to buffers
+      uint64_t                   m_nSeekPosition;     /// position of last seek
+      bool                       m_bSeekFresh;        /// flag, if no buffer was released since last seek
+      SDPOD_AUDIO                m_sdpodFile;         /// file properties passed on construction
+      unsigned int               m_nDeviceSampleRate; /// device samplerate passed on construction
+      unsigned int               m_nMinBufsize;       /// minimum buffer size passed on construction
+      // members below are protected by critical section of m_psdpwfp
+      bool                       m_bQueued;           /// flag, if refill request is queued
+      bool                       m_bBusy;             /// flag, if a worker is reading data
+      bool                       m_bRequeue;          /// flag, if request was passed while busy
+      double                     m_dDeadline;         /// deadline of pending request
+      uint64_t                   m_nPrefetchFrom;     /// first position of pending prefetch of mapped file
+      uint64_t                   m_nPrefetchTo;       /// end position of pending prefetch of mapped file
+      // members for memory mapped reading
+      HANDLE                     m_hMapFile;          /// handle of mapped file
+      HANDLE                     m_hMapping;          /// file mapping handle
+      const unsigned char*       m_pMapView;          /// view of complete file
+      const unsigned char*       m_pMapData;          /// first sample of data chunk within view (NULL if not mapped)
+      int                        m_nMapSubFormat;     /// libsndfile subformat of mapped data
+      unsigned int               m_nMapBytesPerSample;   /// bytes per sample of mapped data
+      bool                       MapFile(int nFormat);
+      const unsigned char*       FindDataChunk(uint64_t nFileBytes);
+      void                       UnmapFile();
+      uint64_t                   FilePosition(uint64_t nPosition, uint64_t &rnContiguous);
+      void                       ReadMapped(uint64_t nFramePos, unsigned int nChannel, float* pfBuffer, unsigned int nSamples);
+      uint64_t                   PrefetchEnd(uint64_t nPosition);
+      void                       Prefetch(uint64_t nFrom, uint64_t nTo);
       void                       ReadData();
-   protected:
-      void __fastcall Execute();
+      double                     RefillDeadline();
+      void                       SetFilePosition(uint64_t nPosition);
+      void                       Seek(uint64_t nPosition);
+      void                       Prepare(SDPWaveReader* psdpwr, uint64_t nPosition);
+      void                       Attach(SDPWaveReader* psdpwr, uint64_t nPosition);
+      void                       Detach(SDPWaveReader* psdpwr);
+      void                       ReleaseBuffer(SDPWaveReader* psdpwr, int nIndex);
+   public:
+      SDPWaveFile(               SDPOD_AUDIO &rsdpodFile,
+                                 unsigned int      nDeviceSampleRate,
+                                 unsigned int      nMinBufsize = 0);
+      ~SDPWaveFile();
+      void              AddRef();
+      void              Release();
+      bool              IsMapped();
+      AnsiString        GetFileName();
+      unsigned int      NumChannels();
+      uint64_t          FileSize();
+      uint64_t          TotalLength();
+      uint64_t          UsedLength();
+};
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+/// class for reading one channel of a wave file from buffers of a (shared)
+/// SDPWaveFile instance
+//------------------------------------------------------------------------------
+class SDPWaveReader
+{
+   friend class SDPWaveFile;
+   friend class SDPWaveFilePool;
+   friend class SDPWaveFileWorker;
+   private:
+      SDPWaveFile*               m_psdpwf;         /// file instance holding the buffers
+      unsigned int               m_nFileChannel;   /// channel index to read
+      unsigned int               m_nReadPos;       /// current read position within current SDPWaveReaderBuffer
+      uint64_t                   m_nSamplesRead;   /// total number of samples read
+      uint64_t                   m_nPrefetchPos;   /// position up to which pages of mapped file are prefetched
+      bool                       m_bDone;          /// flag, if all data were read
+      int                        m_nReadBufIndex;  /// index of current buffer for reading in GetSample
+      bool                       m_bStarted;          /// flag, if any sample was ever retrieved
+      bool                       m_bAttached;         /// flag, if reader is attached to buffers of m_psdpwf
+      volatile bool              m_abHold[2];         /// flags, if buffers are not consumed yet by this reader
+      // members for re-attaching a detached reader without file access on processing thread
+      volatile LONG              m_nSplitState;       /// state of re-attaching (SDPWaveReaderSplitState)
+      SDPWaveFile*               m_psdpwfSplit;       /// own file instance prepared by pool worker
+      SDPWaveFile*               m_psdpwfRetired;     /// replaced file instance, released on next SetPosition
+      uint64_t                   m_nSplitPosition;    /// position own file instance is prepared for
+      uint64_t                   m_nUnderrun;         /// samples returned as zeros while waiting for re-attaching
+      AnsiString                 m_strSplitError;     /// error of pool worker preparing own file instance
+      // members below are protected by critical section of pool
+      bool                       m_bSplitQueued;      /// flag, if re-attach request is queued
+      bool                       m_bSplitBusy;        /// flag, if a worker is preparing own file instance
+      bool                       Reattach();
+      void                       PrepareSplit();
+      void                       CancelSplit();
+      void                       PrefetchMapped();
    public:
-      __fastcall SDPWaveReader(  SDPOD_AUDIO &rsdpodFile,
+      SDPWaveReader(             SDPOD_AUDIO &rsdpodFile,
                                  unsigned int      nDeviceSampleRate,
-                                 unsigned int      nMinBufsize = 0,
-                                 int               nThreadPriority = 2); // corresponds to tpHighest
-      __fastcall ~SDPWaveReader();
+                                 unsigned int      nMinBufsize = 0);
+      ~SDPWaveReader();
       static unsigned int sm_nWaveReaderBufSize;
+      static bool       sm_bWaveReaderMapFiles;
       AnsiString        GetFileName();
       unsigned int      GetFileChannel();
       uint64_t          GetStartOffset();
@@ -126,6 +312,7 @@ class SDPWaveReader : public TThread
       uint64_t          GetSamplesRead();
       uint64_t          GetLoopPosition();
       float             GetFileSample(bool bFileReadLazy = false);
+      unsigned int      GetFileSamples(float* pfBuffer, unsigned int nSamples);
       uint64_t          FileSize();
       uint64_t          TotalLength();
       bool              Done();
@@ -0,0 +1,239 @@
+//------------------------------------------------------------------------------
+/// \file SoundDllPro_WorkerPool.cpp
+/// \author Berg
+/// \brief Implementation of classes SDPWorkerPool and SDPWorker. Fork/join
+/// pool of worker threads running one job function for a range of indices
+/// (e.g. tracks or channels) in parallel with the calling thread.
+///
+/// Project SoundMexPro
+/// Module  SoundDllPro.dll
+///
+///
+/// ****************************************************************************
+/// Copyright 2023 Daniel Berg, Oldenburg, Germany
+/// ****************************************************************************
+///
+/// This file is part of SoundMexPro.
+///
+///    SoundMexPro is free software: you can redistribute it and/or modify
+///    it under the terms of the GNU General Public License as published by
+///    the Free Software Foundation, either version 3 of the License, or
+///    (at your option) any later version.
+///
+///    SoundMexPro is distributed in the hope that it will be useful,
+///    but WITHOUT ANY WARRANTY; without even the implied warranty of
+///    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+///    GNU General Public License for more details.
+///
+///    You should have received a copy of the GNU General Public License
+///    along with SoundMexPro.  If not, see <http:///www.gnu.org/licenses/>.
+///
+//------------------------------------------------------------------------------
+#include <vcl.h>
+#include <limits.h>
+#pragma hdrstop
+
+#include "SoundDllPro_WorkerPool.h"
+#include "SoundDllPro_Main.h"
+//------------------------------------------------------------------------------
+#pragma package(smart_init)
+
+
+//------------------------------------------------------------------------------
+/// constructor of worker thread: thread is created suspended
+//------------------------------------------------------------------------------
+__fastcall SDPWorker::SDPWorker(SDPWorkerPool* psdpwp, TThreadPriority tp)
+   : TThread(true), m_psdpwp(psdpwp)
+{
+   Priority = tp;
+   FreeOnTerminate = false;
+}
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+/// thread function. Waits for 'work' and runs jobs until no index is left
+//------------------------------------------------------------------------------
+void __fastcall SDPWorker::Execute()
+{
+   while (!Terminated)
+      {
+      // wait for 'work' or 'stop'. To avoid dead locks we have a timeout
+      // of 1 second: in that case we simply re-loop
+      DWORD nWaitResult = WaitForMultipleObjects(2, m_psdpwp->m_hEvents, false, 1000);
+      if (nWaitResult == WAIT_OBJECT_0)
+         break;
+      if (nWaitResult != WAIT_OBJECT_0 + 1)
+         continue;
+      m_psdpwp->RunJobs();
+      // NOTE: setting the event is the last access of the last worker
+      if (InterlockedDecrement(&m_psdpwp->m_nBusy) == 0)
+         SetEvent(m_psdpwp->m_hDone);
+      }
+}
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+/// constructor. Creates events and starts nNumThreads-1 worker threads: the
+/// thread calling Run is the first 'worker'
+//------------------------------------------------------------------------------
+SDPWorkerPool::SDPWorkerPool(unsigned int nNumThreads, TThreadPriority tp)
+   :  m_hDone(NULL),
+      m_lpfnJob(NULL),
+      m_nCount(0),
+      m_nNext(0),
+      m_nBusy(0),
+      m_nError(0),
+      m_bTimedOut(false)
+{
+   m_hEvents[0] = NULL;
+   m_hEvents[1] = NULL;
+   if (!nNumThreads || nNumThreads > SDPWORKERPOOL_MAXTHREADS)
+      throw Exception("invalid number of worker threads");
+   // stop event is manual-resetting to stop all workers, semaphore counts
+   // workers to wake up
+   m_hEvents[0]   = CreateEvent(NULL, TRUE, FALSE, NULL);
+   m_hEvents[1]   = CreateSemaphore(NULL, 0, LONG_MAX, NULL);
+   m_hDone        = CreateEvent(NULL, FALSE, FALSE, NULL);
+   try
+      {
+      if (!m_hEvents[0] || !m_hEvents[1] || !m_hDone)
+         throw Exception("error creating worker pool events");
+      for (unsigned int n = 1; n < nNumThreads; n++)
+         {
+         m_vpsdpw.push_back(new SDPWorker(this, tp));
+         m_vpsdpw.back()->Start();
+         }
+      }
+   catch (...)
+      {
+      Cleanup();
+      throw;
+      }
+}
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+/// destructor. Stops worker threads
+//------------------------------------------------------------------------------
+SDPWorkerPool::~SDPWorkerPool()
+{
+   Cleanup();
+}
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+/// stops and deletes worker threads, closes handles
+//------------------------------------------------------------------------------
+void SDPWorkerPool::Cleanup()
+{
+   // NOTE: no exception here to happen in destructor: thus ignore any error....
+   if (m_hEvents[0])
+      SetEvent(m_hEvents[0]);
+   for (unsigned int n = 0; n < m_vpsdpw.size(); n++)
+      {
+      m_vpsdpw[n]->Terminate();
+      m_vpsdpw[n]->WaitFor();
+      TRYDELETENULL(m_vpsdpw[n]);
+      }
+   m_vpsdpw.clear();
+   for (int i = 0; i < 2; i++)
+      {
+      if (m_hEvents[i] != NULL)
+         {
+         CloseHandle(m_hEvents[i]);
+         m_hEvents[i] = NULL;
+         }
+      }
+   if (m_hDone)
+      {
+      CloseHandle(m_hDone);
+      m_hDone = NULL;
+      }
+}
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+/// returns number of threads including the calling thread
+//------------------------------------------------------------------------------
+unsigned int SDPWorkerPool::NumThreads()
+{
+   return (unsigned int)m_vpsdpw.size() + 1;
+}
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+/// fetches indices and calls job until all indices are fetched. Exceptions are
+/// stored (first one only) and thrown by Run
+//------------------------------------------------------------------------------
+void SDPWorkerPool::RunJobs()
+{
+   LONG nIndex;
+   while ((nIndex = InterlockedIncrement(&m_nNext) - 1) < (LONG)m_nCount)
+      {
+      try
+         {
+         m_lpfnJob((unsigned int)nIndex);
+         }
+      catch (Exception &e)
+         {
+         if (InterlockedExchange(&m_nError, 1) == 0)
+            m_strError = e.Message;
+         }
+      catch (...)
+         {
+         if (InterlockedExchange(&m_nError, 1) == 0)
+            m_strError = "unknown exception in worker job";
+         }
+      }
+}
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+/// calls lpfnJob for all indices 0 ... nCount-1 using the workers and the
+/// calling thread. Returns after all calls are done
+//------------------------------------------------------------------------------
+void SDPWorkerPool::Run(LPFNSDPJOB lpfnJob, unsigned int nCount)
+{
+   if (!nCount)
+      return;
+   // if last run timed out, its workers may still run jobs and will set the
+   // done event when finished: no new run before, otherwise they would fetch
+   // indices of the new run or the stale event would end it too early
+   if (m_bTimedOut)
+      {
+      if (WaitForSingleObject(m_hDone, 0) != WAIT_OBJECT_0)
+         throw Exception("worker threads still busy after timeout");
+      m_bTimedOut = false;
+      }
+   m_lpfnJob   = lpfnJob;
+   m_nCount    = nCount;
+   m_nError    = 0;
+   m_strError  = "";
+   // wake up not more workers than there are indices left for them
+   LONG nWake  = (LONG)m_vpsdpw.size();
+   if (nWake > (LONG)nCount - 1)
+      nWake = (LONG)nCount - 1;
+   m_nBusy     = nWake;
+   // NOTE: interlocked write is a full barrier: job data are visible to workers
+   InterlockedExchange(&m_nNext, 0);
+   if (nWake > 0)
+      ReleaseSemaphore(m_hEvents[1], nWake, NULL);
+   RunJobs();
+   if (nWake > 0)
+      {
+      // all indices are fetched here: workers are done soon, so we spin a
+      // little before blocking. NOTE: the auto-reset event is set exactly once
+      // per run by the last worker, so we always wait for it
+      unsigned int nSpin = 0;
+      while (m_nBusy > 0 && nSpin++ < 4000)
+         YieldProcessor();
+      if (WaitForSingleObject(m_hDone, 10000) != WAIT_OBJECT_0)
+         {
+         m_bTimedOut = true;
+         throw Exception("unexpected timeout waiting for worker threads");
+         }
+      }
+   if (m_nError)
+      throw Exception(m_strError);
+}
+//------------------------------------------------------------------------------
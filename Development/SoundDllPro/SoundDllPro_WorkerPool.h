@@ -0,0 +1,91 @@
+//------------------------------------------------------------------------------
+/// \file SoundDllPro_WorkerPool.h
+/// \author Berg
+/// \brief Implementation of classes SDPWorkerPool and SDPWorker. Fork/join
+/// pool of worker threads running one job function for a range of indices
+/// (e.g. tracks or channels) in parallel with the calling thread.
+///
+/// Project SoundMexPro
+/// Module  SoundDllPro.dll
+///
+///
+/// ****************************************************************************
+/// Copyright 2023 Daniel Berg, Oldenburg, Germany
+/// ****************************************************************************
+///
+/// This file is part of SoundMexPro.
+///
+///    SoundMexPro is free software: you can redistribute it and/or modify
+///    it under the terms of the GNU General Public License as published by
+///    the Free Software Foundation, either version 3 of the License, or
+///    (at your option) any later version.
+///
+///    SoundMexPro is distributed in the hope that it will be useful,
+///    but WITHOUT ANY WARRANTY; without even the implied warranty of
+///    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+///    GNU General Public License for more details.
+///
+///    You should have received a copy of the GNU General Public License
+///    along with SoundMexPro.  If not, see <http:///www.gnu.org/licenses/>.
+///
+//------------------------------------------------------------------------------
+#ifndef SoundDllPro_WorkerPoolH
+#define SoundDllPro_WorkerPoolH
+//---------------------------------------------------------------------------
+#include <Classes.hpp>
+#include <vector>
+//---------------------------------------------------------------------------
+
+#define SDPWORKERPOOL_MAXTHREADS 64
+
+//------------------------------------------------------------------------------
+/// job function called once for each index passed to SDPWorkerPool::Run
+//------------------------------------------------------------------------------
+typedef void (__closure *LPFNSDPJOB)(unsigned int nIndex);
+
+class SDPWorkerPool;
+//------------------------------------------------------------------------------
+/// worker thread of SDPWorkerPool
+//------------------------------------------------------------------------------
+class SDPWorker : public TThread
+{
+   private:
+      SDPWorkerPool*             m_psdpwp;         /// pool the worker belongs to
+   protected:
+      void __fastcall Execute();
+   public:
+      __fastcall SDPWorker(SDPWorkerPool* psdpwp, TThreadPriority tp);
+};
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+/// pool with a fixed number of worker threads. Run calls a job function for
+/// all indices 0 ... nCount-1: the indices are fetched one by one by the
+/// workers and the calling thread, Run returns after all are done. Jobs must
+/// only write data belonging to their index, then the results do not depend
+/// on the distribution of indices to threads
+//------------------------------------------------------------------------------
+class SDPWorkerPool
+{
+   friend class SDPWorker;
+   private:
+      std::vector<SDPWorker*>    m_vpsdpw;         /// worker threads
+      HANDLE                     m_hEvents[2];     /// stop event and work semaphore
+      HANDLE                     m_hDone;          /// set by last busy worker
+      LPFNSDPJOB                 m_lpfnJob;        /// job of current run
+      unsigned int               m_nCount;         /// number of indices of current run
+      volatile LONG              m_nNext;          /// next index to fetch
+      volatile LONG              m_nBusy;          /// workers woken up and not done yet
+      volatile LONG              m_nError;         /// flag, if a job threw an exception
+      AnsiString                 m_strError;       /// message of first exception
+      bool                       m_bTimedOut;      /// flag, if last run timed out with workers still busy
+      void                       Cleanup();
+      void                       RunJobs();
+   public:
+      SDPWorkerPool(unsigned int nNumThreads, TThreadPriority tp = tpHighest);
+      ~SDPWorkerPool();
+      void                       Run(LPFNSDPJOB lpfnJob, unsigned int nCount);
+      unsigned int               NumThreads();
+};
+//------------------------------------------------------------------------------
+#endif
@@ -108,10 +108,13 @@ void __fastcall TSoundSoftwareBuffer::Execute()
          {
          // wait for write handle to be signaled with timeout (to check
          // wor Terminated flag in while loop)
+         m_pHtSound->m_pcQueueWait.Start();
          dw = WaitForMultipleObjects(1, &m_hWriteHandle, false, 100);
          // if m_hWriteHandle is set then one buffer (at least) should be empty now
          if (dw == WAIT_OBJECT_0)
             {
+            // store time waited for space in buffer
+            m_pHtSound->m_pcQueueWait.Stop();
             ResetEvent(m_hWriteHandle);
             // check again, if a buffer is available (if indices are identical, then
             // buffer is full!!)
@@ -0,0 +1,247 @@
+//------------------------------------------------------------------------------
+/// \file SpscRing.cpp
+/// \author Berg
+/// \brief Implementation of classes SpscSignal and SpscRing
+///
+/// Project SoundMexPro
+/// Module SoundDllPro
+///
+/// Implementation of classes SpscSignal and SpscRing used by SoundDataQueue
+/// \sa SoundDataQueue.cpp
+///
+/// ****************************************************************************
+/// Copyright 2023 Daniel Berg, Oldenburg, Germany
+/// ****************************************************************************
+///
+/// This file is part of SoundMexPro.
+///
+///    SoundMexPro is free software: you can redistribute it and/or modify
+///    it under the terms of the GNU General Public License as published by
+///    the Free Software Foundation, either version 3 of the License, or
+///    (at your option) any later version.
+///
+///    SoundMexPro is distributed in the hope that it will be useful,
+///    but WITHOUT ANY WARRANTY; without even the implied warranty of
+///    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+///    GNU General Public License for more details.
+///
+///    You should have received a copy of the GNU General Public License
+///    along with SoundMexPro.  If not, see <http:///www.gnu.org/licenses/>.
+///
+//------------------------------------------------------------------------------
+#include "SpscRing.h"
+#include "casioExceptions.h"
+
+#if defined(_WIN32)
+// Win32 events are used for blocking
+#elif defined(__cpp_lib_atomic_wait)
+#define SPSC_ATOMIC_WAIT
+#elif defined(__linux__)
+#include <unistd.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
+#include <climits>
+#else
+#error no blocking primitive available for SpscSignal
+#endif
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#elif defined(__i386__) || defined(__x86_64__)
+#include <immintrin.h>
+#endif
+
+namespace Asio
+{
+    SpscSignal::SpscSignal(bool bSignalled, unsigned int nMaxSpins)
+        : m_nSequence(0),
+          m_nWaiters(0),
+          m_bExternalWaiter(false),
+          m_nMaxSpins(nMaxSpins),
+          m_nSpins(nMaxSpins)
+    {
+#ifdef _WIN32
+        m_hEvent = CreateEvent(NULL, FALSE, bSignalled ? TRUE : FALSE, NULL);
+        if (m_hEvent == NULL)
+            throw EWin32Error("SpscSignal::SpscSignal",
+                              "CreateEvent failed",
+                              (int)GetLastError());
+#else
+        (void)bSignalled;
+#endif
+    }
+
+    SpscSignal::~SpscSignal()
+    {
+#ifdef _WIN32
+        try
+        {
+            if (m_hEvent)
+            {
+                CloseHandle(m_hEvent);
+                m_hEvent = NULL;
+            }
+        }
+        catch (...)
+        {
+        }
+#endif
+    }
+
+    void SpscSignal::Notify()
+    {
+        // Both the increment of the sequence and the read of m_nWaiters are
+        // sequentially consistent, as are the increment of m_nWaiters and
+        // the read of the sequence in Block: either the waiter sees the new
+        // sequence and does not block, or Notify sees the waiter and wakes
+        // it up.
+        m_nSequence.Increment();
+        if (m_bExternalWaiter || m_nWaiters.LoadSeqCst() > 0)
+            Wake();
+    }
+
+    void SpscSignal::Block(unsigned int nSequence)
+    {
+        m_nWaiters.Increment();
+        if (m_nSequence.LoadSeqCst() == nSequence)
+        {
+#if defined(_WIN32)
+            // a Notify between the check and the wait leaves the
+            // auto-reset event set: WaitForSingleObject returns immediately
+            WaitForSingleObject(m_hEvent, INFINITE);
+#elif defined(SPSC_ATOMIC_WAIT)
+            m_nSequence.Native().wait(nSequence, std::memory_order_acquire);
+#else
+            // the futex checks the sequence atomically with going to sleep
+            syscall(SYS_futex,
+                    reinterpret_cast<unsigned int *>(&m_nSequence.Native()),
+                    FUTEX_WAIT_PRIVATE, nSequence, NULL, NULL, 0);
+#endif
+        }
+        m_nWaiters.Decrement();
+    }
+
+    void SpscSignal::Wake()
+    {
+#if defined(_WIN32)
+        SetEvent(m_hEvent);
+#elif defined(SPSC_ATOMIC_WAIT)
+        m_nSequence.Native().notify_one();
+#else
+        syscall(SYS_futex,
+                reinterpret_cast<unsigned int *>(&m_nSequence.Native()),
+                FUTEX_WAKE_PRIVATE, INT_MAX, NULL, NULL, 0);
+#endif
+    }
+
+    unsigned int SpscSignal::GetMaxSpins() const
+    {
+        return m_nMaxSpins;
+    }
+
+#ifdef _WIN32
+    HANDLE SpscSignal::GetEvent()
+    {
+        m_bExternalWaiter = true;
+        return m_hEvent;
+    }
+#endif
+
+    void SpscSignal::Pause()
+    {
+#if defined(_MSC_VER) || defined(__i386__) || defined(__x86_64__)
+        _mm_pause();
+#elif defined(__aarch64__) || defined(__arm__)
+        __asm__ __volatile__("yield");
+#endif
+    }
+
+    SpscRing::SpscRing(unsigned int nCapacity)
+        : m_nCapacity(nCapacity),
+          m_nWritePos(0),
+          m_nReadPosCache(0),
+          m_nReadPos(0),
+          m_nWritePosCache(0)
+    {
+        if (nCapacity == 0)
+            throw EUnsupportedParamsError("SpscRing::SpscRing",
+                                          "Cannot create ring with capacity"
+                                          " for 0 slots.");
+    }
+
+    unsigned int SpscRing::Capacity() const
+    {
+        return m_nCapacity;
+    }
+
+    unsigned int SpscRing::NumFilled() const
+    {
+        unsigned int nReadPos = m_nReadPos.LoadAcquire();
+        unsigned int nWritePos = m_nWritePos.LoadAcquire();
+        return Distance(nReadPos, nWritePos);
+    }
+
+    bool SpscRing::CanWrite()
+    {
+        unsigned int nWritePos = m_nWritePos.LoadRelaxed();
+        if (Distance(m_nReadPosCache, nWritePos) < m_nCapacity)
+            return true;
+        m_nReadPosCache = m_nReadPos.LoadAcquire();
+        return Distance(m_nReadPosCache, nWritePos) < m_nCapacity;
+    }
+
+    bool SpscRing::CanRead()
+    {
+        unsigned int nReadPos = m_nReadPos.LoadRelaxed();
+        if (m_nWritePosCache != nReadPos)
+            return true;
+        m_nWritePosCache = m_nWritePos.LoadAcquire();
+        return m_nWritePosCache != nReadPos;
+    }
+
+    unsigned int SpscRing::WriteSlot() const
+    {
+        return Slot(m_nWritePos.LoadRelaxed());
+    }
+
+    unsigned int SpscRing::ReadSlot() const
+    {
+        return Slot(m_nReadPos.LoadRelaxed());
+    }
+
+    void SpscRing::CommitWrite()
+    {
+        m_nWritePos.StoreRelease(Next(m_nWritePos.LoadRelaxed()));
+    }
+
+    void SpscRing::CommitRead()
+    {
+        m_nReadPos.StoreRelease(Next(m_nReadPos.LoadRelaxed()));
+    }
+
+    unsigned int SpscRing::Next(unsigned int nPos) const
+    {
+        ++nPos;
+        return (nPos == 2 * m_nCapacity) ? 0 : nPos;
+    }
+
+    unsigned int SpscRing::Slot(unsigned int nPos) const
+    {
+        return (nPos < m_nCapacity) ? nPos : nPos - m_nCapacity;
+    }
+
+    unsigned int SpscRing::Distance(unsigned int nReadPos,
+                                    unsigned int nWritePos) const
+    {
+        return (nWritePos >= nReadPos)
+            ? nWritePos - nReadPos
+            : nWritePos + 2 * m_nCapacity - nReadPos;
+    }
+} // namespace Asio
+
+// Local Variables:
+// mode: c++
+// c-file-style: "stroustrup"
+// c-basic-offset: 4
+// indent-tabs-mode: nil
+// End:
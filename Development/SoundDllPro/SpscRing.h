@@ -0,0 +1,316 @@
+//------------------------------------------------------------------------------
+/// \file SpscRing.h
+/// \author Berg
+/// \brief Interface of classes SpscSignal and SpscRing
+///
+/// Project SoundMexPro
+/// Module SoundDllPro
+///
+/// Interface of classes SpscSignal and SpscRing. SpscRing manages the read
+/// and write positions of a single producer single consumer ring buffer with
+/// atomic indices, SpscSignal lets a thread wait for a condition by spinning
+/// first and blocking afterwards. Both classes do not depend on VCL and use
+/// windows headers on Win32 only.
+/// \sa SoundDataQueue.h
+///
+/// ****************************************************************************
+/// Copyright 2023 Daniel Berg, Oldenburg, Germany
+/// ****************************************************************************
+///
+/// This file is part of SoundMexPro.
+///
+///    SoundMexPro is free software: you can redistribute it and/or modify
+///    it under the terms of the GNU General Public License as published by
+///    the Free Software Foundation, either version 3 of the License, or
+///    (at your option) any later version.
+///
+///    SoundMexPro is distributed in the hope that it will be useful,
+///    but WITHOUT ANY WARRANTY; without even the implied warranty of
+///    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+///    GNU General Public License for more details.
+///
+///    You should have received a copy of the GNU General Public License
+///    along with SoundMexPro.  If not, see <http:///www.gnu.org/licenses/>.
+///
+//------------------------------------------------------------------------------
+#ifndef SPSC_RING_H
+#define SPSC_RING_H
+
+#include <stddef.h>
+#ifdef _WIN32
+#include <windows.h>
+#endif
+
+// The classic Borland compiler has no <atomic>: Interlocked functions are used
+// instead (x86 only, where plain loads have acquire semantics)
+#if defined(__BORLANDC__) && !defined(__clang__)
+#define SPSC_INTERLOCKED
+#else
+#include <atomic>
+#endif
+
+class UNIT_TEST_CLASS;
+
+/// Size assumed for a cache line when separating data written by different
+/// threads.
+#define SPSC_CACHE_LINE 64
+
+namespace Asio
+{
+    /// Atomic unsigned integer with the operations needed by SpscSignal and
+    /// SpscRing.
+    class SpscAtomic {
+#ifdef SPSC_INTERLOCKED
+        volatile LONG m_n;
+#else
+        std::atomic<unsigned int> m_n;
+#endif
+    public:
+        explicit SpscAtomic(unsigned int n = 0) : m_n(n) {}
+#ifdef SPSC_INTERLOCKED
+        unsigned int LoadRelaxed() const { return (unsigned int)m_n; }
+        unsigned int LoadAcquire() const { return (unsigned int)m_n; }
+        unsigned int LoadSeqCst()
+            { return (unsigned int)InterlockedExchangeAdd(&m_n, 0); }
+        void StoreRelease(unsigned int n)
+            { InterlockedExchange(&m_n, (LONG)n); }
+        void Increment() { InterlockedIncrement(&m_n); }
+        void Decrement() { InterlockedDecrement(&m_n); }
+#else
+        unsigned int LoadRelaxed() const
+            { return m_n.load(std::memory_order_relaxed); }
+        unsigned int LoadAcquire() const
+            { return m_n.load(std::memory_order_acquire); }
+        unsigned int LoadSeqCst()
+            { return m_n.load(std::memory_order_seq_cst); }
+        void StoreRelease(unsigned int n)
+            { m_n.store(n, std::memory_order_release); }
+        void Increment() { m_n.fetch_add(1, std::memory_order_seq_cst); }
+        void Decrement() { m_n.fetch_sub(1, std::memory_order_seq_cst); }
+        /// Returns the underlying atomic for blocking on its value.
+        std::atomic<unsigned int> & Native() { return m_n; }
+#endif
+    private:
+        SpscAtomic(const SpscAtomic &);
+        SpscAtomic & operator=(const SpscAtomic &);
+    }; // class SpscAtomic
+
+    /// A SpscSignal wakes up a single thread waiting for a condition that is
+    /// changed by another thread. The waiting thread spins for a while before
+    /// blocking, the number of spins adapts to the success of spinning in
+    /// previous waits. Blocking uses a Win32 auto-reset event on Windows, a
+    /// wait on the sequence counter if std::atomic::wait is available and a
+    /// futex on Linux otherwise. Notify only enters the kernel if a thread is
+    /// blocked or if the event is used by other waiters (\sa GetEvent).
+    ///
+    /// variable prefix: sig for (SIG)nal
+    class SpscSignal {
+        friend class UNIT_TEST_CLASS;
+
+        /// Incremented on each notification, checked by a blocking thread
+        /// to detect notifications that arrived before it blocked.
+        SpscAtomic m_nSequence;
+
+        /// Number of threads currently blocked or about to block.
+        SpscAtomic m_nWaiters;
+
+        /// true if the event was passed to someone waiting on it directly:
+        /// Notify has to set the event each time then.
+        bool m_bExternalWaiter;
+
+        /// Maximum number of spins before blocking, 0 disables spinning.
+        unsigned int m_nMaxSpins;
+
+        /// Current number of spins before blocking. Only accessed by the
+        /// waiting thread.
+        unsigned int m_nSpins;
+
+#ifdef _WIN32
+        /// Win32 auto-reset event used for blocking
+        HANDLE m_hEvent;
+#endif
+
+        /// Blocks until Notify was called after nSequence was read from
+        /// m_nSequence. May return spuriously.
+        void Block(unsigned int nSequence);
+
+        /// Wakes up a blocked thread.
+        void Wake();
+
+    public:
+        /// Default maximum number of spins of a waiting thread.
+        static const unsigned int DEFAULT_MAX_SPINS = 4096;
+
+        /// Create a signal.
+        /// \param[in] bSignalled
+        ///  Initial state of the Win32 event.
+        /// \param[in] nMaxSpins
+        ///  Maximum number of spins before blocking, 0 to block immediately.
+        explicit SpscSignal(bool bSignalled = false,
+                            unsigned int nMaxSpins = DEFAULT_MAX_SPINS);
+
+        /// Deallocate the signal
+        ~SpscSignal();
+
+        /// Notify the waiting thread that the condition might have changed.
+        void Notify();
+
+        /// Wait until a condition becomes true.
+        /// \param[in] fnCondition
+        ///  Functor returning true if the condition is met. Called several
+        ///  times, must not have side effects.
+        template <typename T> void Wait(T fnCondition)
+        {
+            unsigned int nSpin;
+            for (nSpin = 0; nSpin < m_nSpins; ++nSpin)
+            {
+                if (fnCondition())
+                {
+                    // spinning succeeded: allow longer spins next time
+                    m_nSpins = (m_nSpins * 2 > m_nMaxSpins)
+                        ? m_nMaxSpins : m_nSpins * 2;
+                    return;
+                }
+                Pause();
+            }
+            bool bBlocked = false;
+            for (;;)
+            {
+                unsigned int nSequence = m_nSequence.LoadAcquire();
+                if (fnCondition())
+                    break;
+                Block(nSequence);
+                bBlocked = true;
+            }
+            // spinning did not pay: spin shorter next time
+            if (bBlocked)
+                m_nSpins /= 2;
+            if (m_nSpins == 0 && m_nMaxSpins > 0)
+                m_nSpins = 1;
+        }
+
+        /// Spin until a condition becomes true without blocking.
+        /// \param[in] fnCondition
+        ///  Functor returning true if the condition is met.
+        /// \retval true if the condition became true
+        /// \retval false if the condition was not met within the current
+        ///  number of spins
+        template <typename T> bool Spin(T fnCondition)
+        {
+            unsigned int nSpin;
+            for (nSpin = 0; nSpin < m_nSpins; ++nSpin)
+            {
+                if (fnCondition())
+                    return true;
+                Pause();
+            }
+            return fnCondition();
+        }
+
+        /// Returns the maximum number of spins.
+        unsigned int GetMaxSpins() const;
+
+#ifdef _WIN32
+        /// Returns the Win32 Event that is set by Notify. Afterwards Notify
+        /// sets the event on each call, because external waiters cannot be
+        /// counted.
+        HANDLE GetEvent();
+#endif
+
+        /// Processor hint used in spin loops.
+        static void Pause();
+
+    private:
+        SpscSignal(const SpscSignal &);
+        SpscSignal & operator=(const SpscSignal &);
+    }; // class SpscSignal
+
+    /// A SpscRing manages the positions of a ring buffer with a fixed number
+    /// of slots that is written by one thread and read by another thread.
+    /// The positions run from 0 to twice the capacity, so a full ring can be
+    /// distinguished from an empty ring without an unused slot. Each thread
+    /// writes its own position only, the release store of a position
+    /// publishes the slot contents to the other thread. The positions are
+    /// stored in separate cache lines, each together with a cached copy of the
+    /// position of the other thread to avoid reading the other cache line on
+    /// each access.
+    ///
+    /// variable prefix: sr for (S)psc(R)ing
+    class SpscRing {
+        friend class UNIT_TEST_CLASS;
+
+        /// Number of slots
+        const unsigned int m_nCapacity;
+
+        char m_acPad0[SPSC_CACHE_LINE];
+
+        /// Position of next slot to write, written by producer only
+        SpscAtomic m_nWritePos;
+        /// Copy of m_nReadPos last read by producer
+        unsigned int m_nReadPosCache;
+
+        char m_acPad1[SPSC_CACHE_LINE];
+
+        /// Position of next slot to read, written by consumer only
+        SpscAtomic m_nReadPos;
+        /// Copy of m_nWritePos last read by consumer
+        unsigned int m_nWritePosCache;
+
+        char m_acPad2[SPSC_CACHE_LINE];
+
+        /// Returns the position following nPos.
+        unsigned int Next(unsigned int nPos) const;
+
+        /// Returns the slot index of position nPos.
+        unsigned int Slot(unsigned int nPos) const;
+
+        /// Returns the number of filled slots between two positions.
+        unsigned int Distance(unsigned int nReadPos,
+                              unsigned int nWritePos) const;
+
+    public:
+        /// Create a ring with nCapacity slots
+        explicit SpscRing(unsigned int nCapacity);
+
+        /// Returns the number of slots.
+        unsigned int Capacity() const;
+
+        /// Returns the number of filled slots. May be called by any thread,
+        /// the result may be outdated immediately.
+        unsigned int NumFilled() const;
+
+        /// Producer only: returns true if there is at least one empty slot.
+        bool CanWrite();
+
+        /// Consumer only: returns true if there is at least one filled slot.
+        bool CanRead();
+
+        /// Producer only: returns the slot index to write next.
+        unsigned int WriteSlot() const;
+
+        /// Consumer only: returns the slot index to read next.
+        unsigned int ReadSlot() const;
+
+        /// Producer only: publishes the slot written last.
+        void CommitWrite();
+
+        /// Consumer only: releases the slot read last.
+        void CommitRead();
+
+    private:
+        SpscRing(const SpscRing &);
+        SpscRing & operator=(const SpscRing &);
+    }; // class SpscRing
+
+} // namespace Asio
+
+#endif // #ifndef SPSC_RING_H
+
+// next comment block describes code layout for emacs.
+
+// Local Variables:
+// mode: c++
+// c-file-style: "stroustrup"
+// c-basic-offset: 4
+// indent-tabs-mode: nil
+// End:
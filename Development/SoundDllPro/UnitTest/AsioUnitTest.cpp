@@ -0,0 +1,318 @@
+//-----------------------------------------------------------------------------
+/// \file AsioUnitTest.cpp
+/// \author Berg
+/// \brief Unit tests of SpscRing, SpscSignal, SoundDataQueue and SoundDataPool
+///
+/// Project SoundMexPro
+/// Module SoundDllPro
+/// Unit tests of the lock-free classes used by CAsio for passing sound data
+/// between threads. Built without VCL (see CMakeLists.txt in this directory).
+/// The test class is friend of all tested classes (UNIT_TEST_CLASS).
+///
+/// ****************************************************************************
+/// Copyright 2023 Daniel Berg, Oldenburg, Germany
+/// ****************************************************************************
+///
+/// This file is part of SoundMexPro.
+///
+///    SoundMexPro is free software: you can redistribute it and/or modify
+///    it under the terms of the GNU General Public License as published by
+///    the Free Software Foundation, either version 3 of the License, or
+///    (at your option) any later version.
+///
+///    SoundMexPro is distributed in the hope that it will be useful,
+///    but WITHOUT ANY WARRANTY; without even the implied warranty of
+///    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+///    GNU General Public License for more details.
+///
+///    You should have received a copy of the GNU General Public License
+///    along with SoundMexPro.  If not, see <http:///www.gnu.org/licenses/>.
+///
+//-----------------------------------------------------------------------------
+#include <stdio.h>
+#include <thread>
+#include "SpscRing.h"
+#include "SoundDataQueue.h"
+#include "SoundDataPool.h"
+#include "casioExceptions.h"
+
+using namespace Asio;
+
+/// number of failed checks
+static unsigned int g_nFailed = 0;
+
+/// Records a failed check with its location.
+#define CHECK(cond)                                                     \
+    do {                                                                \
+        if (!(cond)) {                                                  \
+            ++g_nFailed;                                                \
+            printf("%s(%d): check failed: %s\n", __FILE__, __LINE__, #cond); \
+        }                                                               \
+    } while (0)
+
+/// Records a failed check, if statement does not throw exception type E.
+#define CHECK_THROWS(statement, E)                                      \
+    do {                                                                \
+        bool bThrown = false;                                           \
+        try { statement; }                                              \
+        catch (E &) { bThrown = true; }                                 \
+        if (!bThrown) {                                                 \
+            ++g_nFailed;                                                \
+            printf("%s(%d): expected exception: %s\n", __FILE__, __LINE__, #statement); \
+        }                                                               \
+    } while (0)
+
+namespace Asio
+{
+/// Test class, friend of all tested classes. NOTE: must be declared in
+/// namespace Asio, where the friend declarations refer to it.
+class AsioUnitTest {
+public:
+    /// A ring uses all slots and keeps order across many wrap-arounds, also
+    /// for capacities that are no power of two.
+    static void TestRingWrap()
+    {
+        unsigned nCapacity;
+        for (nCapacity = 1; nCapacity <= 7; ++nCapacity)
+        {
+            SpscRing srRing(nCapacity);
+            CHECK(srRing.Capacity() == nCapacity);
+            CHECK(srRing.NumFilled() == 0);
+            CHECK(!srRing.CanRead());
+            unsigned nWritten = 0;
+            unsigned nRead = 0;
+            std::vector<unsigned> vnSlots(nCapacity);
+            unsigned nRound;
+            for (nRound = 0; nRound < 5 * nCapacity + 3; ++nRound)
+            {
+                // fill completely: no slot is wasted
+                while (srRing.CanWrite())
+                {
+                    vnSlots[srRing.WriteSlot()] = nWritten++;
+                    srRing.CommitWrite();
+                }
+                CHECK(srRing.NumFilled() == nCapacity);
+                // read a varying number of slots
+                unsigned nToRead = 1 + nRound % nCapacity;
+                while (nToRead-- && srRing.CanRead())
+                {
+                    CHECK(vnSlots[srRing.ReadSlot()] == nRead);
+                    ++nRead;
+                    srRing.CommitRead();
+                }
+                CHECK(srRing.NumFilled() == nWritten - nRead);
+            }
+        }
+    }
+
+    /// Positions of producer and consumer are in separate cache lines.
+    static void TestRingLayout()
+    {
+        SpscRing srRing(4);
+        const char * pcWrite = reinterpret_cast<const char *>(&srRing.m_nWritePos);
+        const char * pcRead = reinterpret_cast<const char *>(&srRing.m_nReadPos);
+        CHECK(pcRead - pcWrite >= SPSC_CACHE_LINE);
+        CHECK(reinterpret_cast<const char *>(&srRing.m_nReadPosCache) < pcRead);
+        CHECK(reinterpret_cast<const char *>(&srRing.m_nWritePosCache) > pcRead);
+    }
+
+    /// The spin budget of a signal doubles on success and halves on blocking.
+    static void TestSignalSpins()
+    {
+        SpscSignal sig(false, 64);
+        CHECK(sig.m_nSpins == 64);
+        std::thread th([&sig]() { sig.Notify(); });
+        bool bFlag = false;
+        // condition becomes true after the first block only
+        struct Condition {
+            bool & m_rbFlag;
+            SpscSignal & m_rsig;
+            bool operator()() const
+            {
+                return m_rbFlag || m_rsig.m_nSequence.LoadAcquire() > 0;
+            }
+        } cond = { bFlag, sig };
+        sig.Wait(cond);
+        th.join();
+        CHECK(sig.m_nSpins <= 64);
+        unsigned nSpins = sig.m_nSpins;
+        bFlag = true;
+        sig.Wait(cond);
+        CHECK(sig.m_nSpins == (nSpins * 2 > 64 ? 64 : nSpins * 2));
+    }
+
+    /// Queue owning its buffers: order, clearing on pop and xrun exceptions.
+    static void TestQueueOwned()
+    {
+        SoundDataQueue sdq(2, 16, 3);
+        CHECK(sdq.NumEmptyBuffers() == 3);
+        CHECK_THROWS(sdq.GetReadPtr(), EXrunError);
+        CHECK_THROWS(sdq.Pop(), EXrunError);
+        CHECK_THROWS(sdq.Push(), EUnexpectedError);
+        unsigned n;
+        for (n = 0; n < 3; ++n)
+        {
+            SoundData * psd = sdq.GetWritePtr();
+            psd->m_vvfData[1][5] = (float)n;
+            sdq.Push();
+        }
+        CHECK(sdq.NumFilledBuffers() == 3);
+        CHECK_THROWS(sdq.GetWritePtr(), EXrunError);
+        CHECK(!sdq.IsReadPtrShared());
+        for (n = 0; n < 3; ++n)
+        {
+            SoundData * psd = sdq.GetReadPtr();
+            CHECK(psd->m_vvfData[1][5] == (float)n);
+            sdq.Pop();
+            CHECK(psd->m_vvfData[1][5] == 0.0f);
+        }
+        CHECK(sdq.NumFilledBuffers() == 0);
+    }
+
+    /// Pool: reference counts, sharing and exhaustion.
+    static void TestPool()
+    {
+        CHECK_THROWS(SoundDataPool(1, 1, 0), EUnsupportedParamsError);
+        SoundDataPool sdp(1, 8, 2);
+        SoundData * psd0 = sdp.Acquire(true);
+        SoundData * psd1 = sdp.Acquire(false);
+        CHECK(psd0 != psd1);
+        CHECK(sdp.NumUsedBlocks() == 2);
+        CHECK_THROWS(sdp.Acquire(false), EXrunError);
+        CHECK(!sdp.IsShared(psd0));
+        sdp.AddRef(psd0);
+        CHECK(sdp.IsShared(psd0));
+        sdp.Release(psd0);
+        CHECK(!sdp.IsShared(psd0));
+        sdp.Release(psd0);
+        CHECK(sdp.NumUsedBlocks() == 1);
+        // foreign blocks are ignored and always shared
+        SoundData sdForeign;
+        sdp.AddRef(&sdForeign);
+        sdp.Release(&sdForeign);
+        CHECK(sdp.IsShared(&sdForeign));
+        // a cleared block contains zeros
+        psd0 = sdp.Acquire(false);
+        psd0->m_vvfData[0][3] = 1.0f;
+        psd0->m_bIsLast = true;
+        sdp.Release(psd0);
+        psd0 = sdp.Acquire(true);
+        CHECK(psd0->m_vvfData[0][3] == 0.0f);
+        CHECK(!psd0->m_bIsLast);
+        sdp.Release(psd0);
+        sdp.Release(psd1);
+        CHECK(sdp.NumUsedBlocks() == 0);
+    }
+
+    /// Queues transporting pool blocks: one block pushed to two queues is
+    /// freed after both popped it, destruction releases queued blocks.
+    static void TestQueuePool()
+    {
+        SoundDataPool sdp(2, 8, 4);
+        CHECK_THROWS(SoundDataQueue(0, true, 2), EUnsupportedParamsError);
+        SoundDataQueue sdqOwned(2, 8, 2);
+        CHECK_THROWS(sdqOwned.PushRef(0), EUnexpectedError);
+        {
+            SoundDataQueue sdqA(&sdp, true, 2);
+            SoundDataQueue sdqB(&sdp, true, 2);
+            SoundData * psd = sdqA.GetWritePtr();
+            psd->m_vvfData[0][0] = 42.0f;
+            sdqA.Push();
+            sdqB.PushRef(psd);
+            CHECK(sdp.NumUsedBlocks() == 1);
+            CHECK(sdqA.IsReadPtrShared());
+            CHECK(sdqB.GetReadPtr() == psd);
+            sdqA.Pop();
+            CHECK(!sdqB.IsReadPtrShared());
+            CHECK(sdqB.GetReadPtr()->m_vvfData[0][0] == 42.0f);
+            sdqB.Pop();
+            CHECK(sdp.NumUsedBlocks() == 0);
+            // GetWritePtr without Push reuses the acquired block
+            SoundData * psdWrite = sdqA.GetWritePtr();
+            CHECK(sdqA.GetWritePtr() == psdWrite);
+            CHECK(sdp.NumUsedBlocks() == 1);
+            sdqA.Push();
+            psdWrite = sdqA.GetWritePtr();
+            sdqA.Push();
+            CHECK(sdp.NumUsedBlocks() == 2);
+            CHECK_THROWS(sdqA.PushRef(psdWrite), EXrunError);
+        }
+        CHECK(sdp.NumUsedBlocks() == 0);
+    }
+
+    /// One producer and one consumer thread: all buffers arrive in order
+    /// with their contents, both with spinning and with immediate blocking.
+    static void TestQueueThreads(unsigned nMaxSpins, bool bPool)
+    {
+        const unsigned nBuffers = 200000;
+        SoundDataPool sdp(1, 4, 6);
+        SoundDataQueue sdqOwned(1, 4, 3, nMaxSpins);
+        SoundDataQueue sdqPool(&sdp, false, 3, nMaxSpins);
+        SoundDataQueue & sdq = bPool ? sdqPool : sdqOwned;
+        std::thread th([&sdq, nBuffers]() {
+            unsigned n;
+            for (n = 0; n < nBuffers; ++n)
+            {
+                sdq.WaitForSpace();
+                SoundData * psd = sdq.GetWritePtr();
+                psd->m_vvfData[0][0] = (float)n;
+                psd->m_vvfData[0][3] = (float)(n + 1);
+                psd->m_bIsLast = (n + 1 == nBuffers);
+                sdq.Push();
+            }
+        });
+        unsigned nErrors = 0;
+        unsigned n;
+        for (n = 0; n < nBuffers; ++n)
+        {
+            sdq.WaitForData();
+            SoundData * psd = sdq.GetReadPtr();
+            if (  psd->m_vvfData[0][0] != (float)n
+               || psd->m_vvfData[0][3] != (float)(n + 1)
+               || psd->m_bIsLast != (n + 1 == nBuffers))
+                ++nErrors;
+            sdq.Pop();
+        }
+        th.join();
+        CHECK(nErrors == 0);
+        CHECK(sdq.NumFilledBuffers() == 0);
+        CHECK(sdp.NumUsedBlocks() == 0);
+    }
+};
+} // namespace Asio
+
+int main()
+{
+    try
+    {
+        Asio::AsioUnitTest::TestRingWrap();
+        Asio::AsioUnitTest::TestRingLayout();
+        Asio::AsioUnitTest::TestSignalSpins();
+        Asio::AsioUnitTest::TestQueueOwned();
+        Asio::AsioUnitTest::TestPool();
+        Asio::AsioUnitTest::TestQueuePool();
+        Asio::AsioUnitTest::TestQueueThreads(SpscSignal::DEFAULT_MAX_SPINS, false);
+        Asio::AsioUnitTest::TestQueueThreads(0, false);
+        Asio::AsioUnitTest::TestQueueThreads(SpscSignal::DEFAULT_MAX_SPINS, true);
+        Asio::AsioUnitTest::TestQueueThreads(0, true);
+    }
+    catch (EAsioError & e)
+    {
+        printf("unexpected exception in %s: %s\n", e.m_lpszMethod, e.m_lpszMsg);
+        return 1;
+    }
+    if (g_nFailed)
+    {
+        printf("%u checks failed\n", g_nFailed);
+        return 1;
+    }
+    printf("all tests passed\n");
+    return 0;
+}
+
+// Local Variables:
+// mode: c++
+// c-file-style: "stroustrup"
+// c-basic-offset: 4
+// indent-tabs-mode: nil
+// End:
@@ -0,0 +1,140 @@
+//-----------------------------------------------------------------------------
+/// \file ConvertBenchmark.cpp
+/// \author Berg
+/// \brief Benchmark of SampleConverter against the former conversions
+///
+/// Project SoundMexPro
+/// Module SoundDllPro
+/// Measures the throughput of the former scalar conversions of CAsio
+/// (ConvertReference.h) and of the SampleConverter kernels of all instruction
+/// sets available for all ASIO sample types and typical buffer sizes. One
+/// line per sample type, buffer size and direction is printed with the time
+/// per sample in nanoseconds and the speedup compared to the former
+/// conversion. Not run by ctest.
+///
+/// ****************************************************************************
+/// Copyright 2023 Daniel Berg, Oldenburg, Germany
+/// ****************************************************************************
+///
+/// This file is part of SoundMexPro.
+///
+///    SoundMexPro is free software: you can redistribute it and/or modify
+///    it under the terms of the GNU General Public License as published by
+///    the Free Software Foundation, either version 3 of the License, or
+///    (at your option) any later version.
+///
+///    SoundMexPro is distributed in the hope that it will be useful,
+///    but WITHOUT ANY WARRANTY; without even the implied warranty of
+///    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+///    GNU General Public License for more details.
+///
+///    You should have received a copy of the GNU General Public License
+///    along with SoundMexPro.  If not, see <http:///www.gnu.org/licenses/>.
+///
+//-----------------------------------------------------------------------------
+#include <stdio.h>
+#include <math.h>
+#include <chrono>
+#include <vector>
+#include "casioConvert.h"
+#include "ConvertReference.h"
+
+using namespace Asio;
+using namespace ConvertReference;
+
+/// number of samples converted per measurement (per buffer size)
+static const size_t c_nSamplesPerRun = 1 << 22;
+
+static const char * const c_rglpszIsa[] = { "scalar", "sse2", "avx2" };
+
+/// prevents the compiler from removing the conversions
+static volatile float g_fSink;
+
+/// Returns the time per sample in nanoseconds of the best of 5 runs of
+/// function f converting nFrames samples per call.
+template <typename F>
+static double Measure(F f, size_t nFrames)
+{
+    size_t nCalls = c_nSamplesPerRun / nFrames;
+    double dBest = 0;
+    for (int nRun = 0; nRun < 5; ++nRun)
+    {
+        std::chrono::steady_clock::time_point tpStart = std::chrono::steady_clock::now();
+        for (size_t nCall = 0; nCall < nCalls; ++nCall)
+            f();
+        std::chrono::duration<double, std::nano> d = std::chrono::steady_clock::now() - tpStart;
+        double dNs = d.count() / (double)(nCalls * nFrames);
+        if (!nRun || dNs < dBest)
+            dBest = dNs;
+    }
+    return dBest;
+}
+
+int main()
+{
+    static const size_t c_rgnFrames[] = { 64, 256, 1024, 4096 };
+    SampleConverterIsa sciAvailable = SampleConverter::AvailableIsa();
+    printf("%-10s %5s %-9s %9s", "type", "frames", "direction", "former");
+    for (int nIsa = SCI_SCALAR; nIsa <= sciAvailable; ++nIsa)
+        printf(" %9s %7s", c_rglpszIsa[nIsa], "speedup");
+    printf("   [ns/sample]\n");
+
+    for (size_t nType = 0; nType < c_nTypes; ++nType)
+    {
+        const SampleType & st = c_rgstTypes[nType];
+        size_t nBytes = BytesPerSample(st);
+        for (size_t nSize = 0; nSize < sizeof(c_rgnFrames) / sizeof(c_rgnFrames[0]); ++nSize)
+        {
+            size_t nFrames = c_rgnFrames[nSize];
+            std::valarray<float> vfFloat(nFrames);
+            for (size_t nFrame = 0; nFrame < nFrames; ++nFrame)
+                vfFloat[nFrame] = 1.1f * sinf(0.01f * (float)nFrame);
+            std::vector<uint8_t> vbDriver(nFrames * nBytes);
+            Float2Asio(vfFloat, &vbDriver[0], st.iDataType);
+
+            for (int nDirection = 0; nDirection < 2; ++nDirection)
+            {
+                bool bToFloat = nDirection == 0;
+                double dFormer;
+                if (bToFloat)
+                    dFormer = Measure([&]() {
+                            Asio2Float(&vbDriver[0], st.iDataType, vfFloat);
+                            g_fSink = vfFloat[0];
+                        }, nFrames);
+                else
+                    dFormer = Measure([&]() {
+                            Float2Asio(vfFloat, &vbDriver[0], st.iDataType);
+                            g_fSink = (float)vbDriver[0];
+                        }, nFrames);
+                printf("%-10s %6u %-9s %9.3f", st.lpszName, (unsigned)nFrames,
+                       bToFloat ? "ToFloat" : "FromFloat", dFormer);
+                for (int nIsa = SCI_SCALAR; nIsa <= sciAvailable; ++nIsa)
+                {
+                    SampleConverter sc(st.sfFormat, st.bBigEndian, st.nValidBits,
+                                       (SampleConverterIsa)nIsa);
+                    double dKernel;
+                    if (bToFloat)
+                        dKernel = Measure([&]() {
+                                sc.ToFloat(&vbDriver[0], &vfFloat[0], nFrames);
+                                g_fSink = vfFloat[0];
+                            }, nFrames);
+                    else
+                        dKernel = Measure([&]() {
+                                sc.FromFloat(&vfFloat[0], &vbDriver[0], nFrames);
+                                g_fSink = (float)vbDriver[0];
+                            }, nFrames);
+                    printf(" %9.3f %6.1fx", dKernel, dFormer / dKernel);
+                }
+                printf("\n");
+            }
+        }
+    }
+    return 0;
+}
+
+// Local Variables:
+// mode: c++
+// c-file-style: "stroustrup"
+// c-basic-offset: 4
+// indent-tabs-mode: nil
+// End:
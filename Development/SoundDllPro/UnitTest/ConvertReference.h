@@ -0,0 +1,337 @@
+//-----------------------------------------------------------------------------
+/// \file ConvertReference.h
+/// \author Berg
+/// \brief Former scalar sample conversions of CAsio as test reference
+///
+/// Project SoundMexPro
+/// Module SoundDllPro
+/// Copy of the per-frame conversions CAsio::Asio2Float and CAsio::Float2Asio
+/// used before the block kernels of SampleConverter (casioConvert.cpp) were
+/// introduced. Only the types __int16/__int32 were replaced by int16_t/int32_t,
+/// left shifts of negative values are done unsigned (same result without
+/// undefined behaviour) and the ASIO sample types are defined here, so no
+/// ASIO SDK is needed.
+/// Used by ConvertUnitTest.cpp and ConvertBenchmark.cpp.
+///
+/// ****************************************************************************
+/// Copyright 2023 Daniel Berg, Oldenburg, Germany
+/// ****************************************************************************
+///
+/// This file is part of SoundMexPro.
+///
+///    SoundMexPro is free software: you can redistribute it and/or modify
+///    it under the terms of the GNU General Public License as published by
+///    the Free Software Foundation, either version 3 of the License, or
+///    (at your option) any later version.
+///
+///    SoundMexPro is distributed in the hope that it will be useful,
+///    but WITHOUT ANY WARRANTY; without even the implied warranty of
+///    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+///    GNU General Public License for more details.
+///
+///    You should have received a copy of the GNU General Public License
+///    along with SoundMexPro.  If not, see <http:///www.gnu.org/licenses/>.
+///
+//-----------------------------------------------------------------------------
+#ifndef ConvertReferenceH
+#define ConvertReferenceH
+
+#include <stdint.h>
+#include <limits>
+#include <valarray>
+#include "casioConvert.h"
+
+namespace ConvertReference {
+    /// ASIO sample types (values of ASIOSampleType in asio.h)
+    enum ASIOSampleType {
+        ASIOSTInt16MSB   = 0,
+        ASIOSTInt24MSB   = 1,
+        ASIOSTInt32MSB   = 2,
+        ASIOSTFloat32MSB = 3,
+        ASIOSTFloat64MSB = 4,
+        ASIOSTInt32MSB16 = 8,
+        ASIOSTInt32MSB18 = 9,
+        ASIOSTInt32MSB20 = 10,
+        ASIOSTInt32MSB24 = 11,
+        ASIOSTInt16LSB   = 16,
+        ASIOSTInt24LSB   = 17,
+        ASIOSTInt32LSB   = 18,
+        ASIOSTFloat32LSB = 19,
+        ASIOSTFloat64LSB = 20,
+        ASIOSTInt32LSB16 = 24,
+        ASIOSTInt32LSB18 = 25,
+        ASIOSTInt32LSB20 = 26,
+        ASIOSTInt32LSB24 = 27
+    };
+
+    /// Description of an ASIO sample type and the matching converter
+    /// parameters (as in CAsio::CreateSampleConverter).
+    struct SampleType {
+        long iDataType;
+        const char * lpszName;
+        Asio::SampleFormat sfFormat;
+        bool bBigEndian;
+        unsigned int nValidBits;
+    };
+
+    /// All ASIO sample types supported by CAsio.
+    static const SampleType c_rgstTypes[] = {
+        { ASIOSTInt16MSB,   "Int16MSB",   Asio::SF_INT16,   true,  32 },
+        { ASIOSTInt24MSB,   "Int24MSB",   Asio::SF_INT24,   true,  32 },
+        { ASIOSTInt32MSB,   "Int32MSB",   Asio::SF_INT32,   true,  32 },
+        { ASIOSTInt32MSB16, "Int32MSB16", Asio::SF_INT32,   true,  16 },
+        { ASIOSTInt32MSB18, "Int32MSB18", Asio::SF_INT32,   true,  18 },
+        { ASIOSTInt32MSB20, "Int32MSB20", Asio::SF_INT32,   true,  20 },
+        { ASIOSTInt32MSB24, "Int32MSB24", Asio::SF_INT32,   true,  24 },
+        { ASIOSTFloat32MSB, "Float32MSB", Asio::SF_FLOAT32, true,  32 },
+        { ASIOSTFloat64MSB, "Float64MSB", Asio::SF_FLOAT64, true,  32 },
+        { ASIOSTInt16LSB,   "Int16LSB",   Asio::SF_INT16,   false, 32 },
+        { ASIOSTInt24LSB,   "Int24LSB",   Asio::SF_INT24,   false, 32 },
+        { ASIOSTInt32LSB,   "Int32LSB",   Asio::SF_INT32,   false, 32 },
+        { ASIOSTInt32LSB16, "Int32LSB16", Asio::SF_INT32,   false, 16 },
+        { ASIOSTInt32LSB18, "Int32LSB18", Asio::SF_INT32,   false, 18 },
+        { ASIOSTInt32LSB20, "Int32LSB20", Asio::SF_INT32,   false, 20 },
+        { ASIOSTInt32LSB24, "Int32LSB24", Asio::SF_INT32,   false, 24 },
+        { ASIOSTFloat32LSB, "Float32LSB", Asio::SF_FLOAT32, false, 32 },
+        { ASIOSTFloat64LSB, "Float64LSB", Asio::SF_FLOAT64, false, 32 }
+    };
+    static const size_t c_nTypes = sizeof(c_rgstTypes) / sizeof(c_rgstTypes[0]);
+
+    /// Returns the number of bytes per sample of an ASIO sample type.
+    inline size_t BytesPerSample(const SampleType & st)
+    {
+        switch (st.sfFormat) {
+        case Asio::SF_INT16:   return 2;
+        case Asio::SF_INT24:   return 3;
+        case Asio::SF_FLOAT64: return 8;
+        default:               return 4;
+        }
+    }
+
+#define COPY_BYTESWAP(pchDest, pchSrc, nBytes) \
+    do \
+    { \
+        for (nByte = 0; nByte < (nBytes); ++nByte) \
+        { \
+           *((pchDest) - nByte) = *((pchSrc) + nByte); \
+        } \
+    } while(0)
+#define COPY_BYTESWAP_SIMPLE(nBytes) \
+    COPY_BYTESWAP(&uValue.rgch[3], &pchSrc[nFrame*(nBytes)], (nBytes))
+
+    union UTypes {
+        int32_t i;
+        int64_t l;
+        signed char rgch[8];
+        float f;
+        double d;
+    };
+
+    /// former CAsio::Asio2Float
+    inline void Asio2Float(const void * pvSrc, long iDataType,
+                           std::valarray<float> & vfDest)
+    {
+        const float fIntAmplitude = 2147483648.0f;
+        const signed char * const pchSrc = static_cast<const signed char *>(pvSrc);
+        unsigned nFrame;
+        unsigned nByte;
+        union UTypes uValue;
+        for (nFrame = 0; nFrame < vfDest.size(); ++nFrame)
+        {
+            uValue.l = 0;
+            switch(ASIOSampleType(iDataType)) {
+            case ASIOSTInt16MSB: // Big Endian signed 16 Bits
+                COPY_BYTESWAP_SIMPLE(2);
+                break;
+            case ASIOSTInt24MSB: // Big Endian packed 24 Bits
+                COPY_BYTESWAP_SIMPLE(3);
+                break;
+            case ASIOSTInt32MSB: // Big Endian 32 Bits
+                COPY_BYTESWAP_SIMPLE(4);
+                break;
+            case ASIOSTInt32MSB16: // only least 16 Bits carry value
+                COPY_BYTESWAP(&uValue.rgch[3], &pchSrc[nFrame*4+2], 2);
+                break;
+            case ASIOSTInt32MSB18: // only least 18 Bits carry value
+                COPY_BYTESWAP(&uValue.rgch[3], &pchSrc[nFrame*4+1], 3);
+                uValue.i = (int32_t)((uint32_t)uValue.i << 6);
+                break;
+            case ASIOSTInt32MSB20: // only least 20 Bits carry value
+                COPY_BYTESWAP(&uValue.rgch[3], &pchSrc[nFrame*4+1], 3);
+                uValue.i = (int32_t)((uint32_t)uValue.i << 4);
+                break;
+            case ASIOSTInt32MSB24: // only least 24 Bits carry value
+                COPY_BYTESWAP(&uValue.rgch[3], &pchSrc[nFrame*4+1], 3);
+                break;
+            case ASIOSTInt16LSB: // Big Endian signed 16 Bits
+                uValue.i = static_cast<const int16_t *>(pvSrc)[nFrame];
+                uValue.i = (int32_t)((uint32_t)uValue.i << 16);
+                break;
+            case ASIOSTInt24LSB: // Big Endian packed 24 Bits
+                uValue.rgch[1] = pchSrc[nFrame*3];
+                uValue.rgch[2] = pchSrc[nFrame*3+1];
+                uValue.rgch[3] = pchSrc[nFrame*3+2];
+                break;
+            case ASIOSTInt32LSB: // Little Endian 32 Bits
+                uValue.i = static_cast<const int32_t *>(pvSrc)[nFrame];
+                break;
+            case ASIOSTInt32LSB16: // only least 16 Bits carry value
+                uValue.i = static_cast<const int32_t *>(pvSrc)[nFrame];
+                uValue.i = (int32_t)((uint32_t)uValue.i << 16);
+                break;
+            case ASIOSTInt32LSB18: // only least 18 Bits carry value
+                uValue.i = static_cast<const int32_t *>(pvSrc)[nFrame];
+                uValue.i = (int32_t)((uint32_t)uValue.i << 14);
+                break;
+            case ASIOSTInt32LSB20: // only least 20 Bits carry value
+                uValue.i = static_cast<const int32_t *>(pvSrc)[nFrame];
+                uValue.i = (int32_t)((uint32_t)uValue.i << 12);
+                break;
+            case ASIOSTInt32LSB24: // only least 24 Bits carry value
+                uValue.i = static_cast<const int32_t *>(pvSrc)[nFrame];
+                uValue.i = (int32_t)((uint32_t)uValue.i << 8);
+                break;
+            case ASIOSTFloat32LSB:
+                vfDest[nFrame] = static_cast<const float *>(pvSrc)[nFrame];
+                continue;
+            case ASIOSTFloat64LSB:
+                vfDest[nFrame] = (float)static_cast<const double *>(pvSrc)[nFrame];
+                continue;
+            case ASIOSTFloat32MSB:
+                COPY_BYTESWAP_SIMPLE(4);
+                vfDest[nFrame] = uValue.f;
+                continue;
+            case ASIOSTFloat64MSB:
+                COPY_BYTESWAP(&uValue.rgch[7], &pchSrc[nFrame*8], 8);
+                vfDest[nFrame] = (float)uValue.d;
+                continue;
+            default:
+                vfDest[nFrame] = 0;
+                continue;
+            }
+            vfDest[nFrame] = uValue.i / fIntAmplitude;
+        }
+    }
+
+    /// former CAsio::Float2Asio
+    inline void Float2Asio(const std::valarray<float> & vfSrc,
+                           void * pvDest, long iDataType)
+    {
+        const float fIntAmplitude = float(1u<<31);
+        const float fIntMin = -fIntAmplitude;
+        const float fIntMax =
+            fIntAmplitude * (1 - std::numeric_limits<float>::epsilon());
+
+        signed char * const pchDest = static_cast<signed char *>(pvDest);
+        unsigned nFrame;
+        unsigned nByte;
+        union UTypes uValue;
+        float fValue;
+        for (nFrame = 0; nFrame < vfSrc.size(); ++nFrame)
+        {
+            uValue.l = 0;
+            switch (iDataType) {
+            case ASIOSTFloat32LSB:
+            case ASIOSTFloat64LSB:
+            case ASIOSTFloat32MSB:
+            case ASIOSTFloat64MSB:
+                fValue = vfSrc[nFrame];
+                if (fValue < -1.0f)
+                {
+                    fValue = -1.0f;
+                }
+                else if (fValue > 1.0f)
+                {
+                    fValue = 1.0f;
+                }
+                break;
+            default:
+                fValue = vfSrc[nFrame] * fIntAmplitude;
+                if (fValue < fIntMin)
+                {
+                    fValue = fIntMin;
+                }
+                else if (fValue > fIntMax)
+                {
+                    fValue = fIntMax;
+                }
+                uValue.i = static_cast<int>(fValue);
+            }
+            switch(iDataType) {
+            case ASIOSTInt16MSB: // Big Endian signed 16 Bits
+                COPY_BYTESWAP(&pchDest[nFrame*2+1], &uValue.rgch[2], 2);
+                break;
+            case ASIOSTInt24MSB: // Big Endian packed 24 Bits
+                COPY_BYTESWAP(&pchDest[nFrame*3+2], &uValue.rgch[1], 3);
+                break;
+            case ASIOSTInt32MSB16: // only least 16 Bits carry value
+                uValue.i >>= 2;
+                // FALL THROUGH
+            case ASIOSTInt32MSB18: // only least 18 Bits carry value
+                uValue.i >>= 2;
+                // FALL THROUGH
+            case ASIOSTInt32MSB20: // only least 20 Bits carry value
+                uValue.i >>= 4;
+                // FALL THROUGH
+            case ASIOSTInt32MSB24: // only least 24 Bits carry value
+                uValue.i >>= 8;
+                // FALL THROUGH
+            case ASIOSTInt32MSB: // Big Endian 32 Bits
+                COPY_BYTESWAP(&pchDest[nFrame*4+3], &uValue.rgch[0], 4);
+                break;
+            case ASIOSTInt16LSB: // Big Endian signed 16 Bits
+                static_cast<int16_t *>(pvDest)[nFrame] =
+                    static_cast<int16_t>(uValue.i >> 16);
+                break;
+            case ASIOSTInt24LSB: // Big Endian packed 24 Bits
+                pchDest[nFrame*3]   = uValue.rgch[1];
+                pchDest[nFrame*3+1] = uValue.rgch[2];
+                pchDest[nFrame*3+2] = uValue.rgch[3];
+                break;
+            case ASIOSTInt32LSB: // Big Endian 32 Bits
+                static_cast<int32_t *>(pvDest)[nFrame] = uValue.i;
+                break;
+            case ASIOSTInt32LSB16: // only least 16 Bits carry value
+                static_cast<int32_t *>(pvDest)[nFrame] = uValue.i >> 16;
+                break;
+            case ASIOSTInt32LSB18: // only least 18 Bits carry value
+                static_cast<int32_t *>(pvDest)[nFrame] = uValue.i >> 14;
+                break;
+            case ASIOSTInt32LSB20: // only least 20 Bits carry value
+                static_cast<int32_t *>(pvDest)[nFrame] = uValue.i >> 12;
+                break;
+            case ASIOSTInt32LSB24: // only least 24 Bits carry value
+                static_cast<int32_t *>(pvDest)[nFrame] = uValue.i >> 8;
+                break;
+            case ASIOSTFloat32LSB:
+                static_cast<float *>(pvDest)[nFrame] = fValue;
+                break;
+            case ASIOSTFloat64LSB:
+                static_cast<double *>(pvDest)[nFrame] = (double)fValue;
+                break;
+            case ASIOSTFloat32MSB:
+                uValue.f = fValue;
+                COPY_BYTESWAP(&pchDest[nFrame*4+3], &uValue.rgch[0], 4);
+                break;
+            case ASIOSTFloat64MSB:
+                uValue.d = (double)fValue;
+                COPY_BYTESWAP(&pchDest[nFrame*8+7], &uValue.rgch[0], 8);
+                break;
+            }
+        }
+    }
+
+#undef COPY_BYTESWAP_SIMPLE
+#undef COPY_BYTESWAP
+}
+#endif
+
+
+// Next comment block tells emacs editor how to format code in this file.
+
+// Local Variables:
+// mode: c++
+// c-file-style: "stroustrup"
+// c-basic-offset: 4
+// indent-tabs-mode: nil
+// End:
@@ -0,0 +1,442 @@
+//-----------------------------------------------------------------------------
+/// \file ConvertUnitTest.cpp
+/// \author Berg
+/// \brief Correctness tests of SampleConverter against the former conversions
+///
+/// Project SoundMexPro
+/// Module SoundDllPro
+/// Compares the block kernels of SampleConverter for all ASIO sample types and
+/// all instruction sets available with the former scalar conversions of CAsio
+/// (ConvertReference.h). Results must be bit identical (NaN compares equal to
+/// NaN). Conversion to float is tested exhaustively for all integer codes of
+/// 16 and 24 bit types and of the valid bits of 32 bit types. Float inputs
+/// and 32 bit integer codes are tested with every n-th bit pattern, where n
+/// is passed as first argument (default 251, 1 tests all 2^32 patterns and
+/// takes hours). Buffers are converted in pieces of varying lengths, so
+/// unaligned pointers and the scalar tails of the vector kernels are tested
+/// as well.
+///
+/// ****************************************************************************
+/// Copyright 2023 Daniel Berg, Oldenburg, Germany
+/// ****************************************************************************
+///
+/// This file is part of SoundMexPro.
+///
+///    SoundMexPro is free software: you can redistribute it and/or modify
+///    it under the terms of the GNU General Public License as published by
+///    the Free Software Foundation, either version 3 of the License, or
+///    (at your option) any later version.
+///
+///    SoundMexPro is distributed in the hope that it will be useful,
+///    but WITHOUT ANY WARRANTY; without even the implied warranty of
+///    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+///    GNU General Public License for more details.
+///
+///    You should have received a copy of the GNU General Public License
+///    along with SoundMexPro.  If not, see <http:///www.gnu.org/licenses/>.
+///
+//-----------------------------------------------------------------------------
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <float.h>
+#include <vector>
+#include "casioConvert.h"
+#include "ConvertReference.h"
+
+using namespace Asio;
+using namespace ConvertReference;
+
+/// number of frames converted at once
+static const size_t c_nChunk = 1 << 16;
+/// maximum number of mismatches printed per type and instruction set
+static const unsigned int c_nMaxReports = 5;
+
+static const char * const c_rglpszIsa[] = { "scalar", "sse2", "avx2" };
+
+/// number of failed checks
+static unsigned int g_nFailed = 0;
+
+/// Records a failed check with its location.
+#define CHECK(cond)                                                     \
+    do {                                                                \
+        if (!(cond)) {                                                  \
+            ++g_nFailed;                                                \
+            printf("%s(%d): check failed: %s\n", __FILE__, __LINE__, #cond); \
+        }                                                               \
+    } while (0)
+
+/// Simple deterministic pseudo random numbers (xorshift).
+class Random {
+    uint64_t m_n;
+public:
+    Random() : m_n(0x2545F4914F6CDD1DULL) {}
+    uint64_t Next()
+    {
+        m_n ^= m_n << 13;
+        m_n ^= m_n >> 7;
+        m_n ^= m_n << 17;
+        return m_n;
+    }
+};
+
+/// Writes value n to pbDest with nBytes bytes in given byte order.
+static void StoreBytes(uint8_t * pbDest, uint64_t n, size_t nBytes, bool bBigEndian)
+{
+    for (size_t nByte = 0; nByte < nBytes; ++nByte)
+    {
+        uint8_t b = (uint8_t)(n >> (8 * nByte));
+        pbDest[bBigEndian ? nBytes - 1 - nByte : nByte] = b;
+    }
+}
+
+/// Returns true if two float values are bit identical or both NaN.
+static bool SameFloat(float f1, float f2)
+{
+    if (f1 != f1 && f2 != f2)
+        return true;
+    return memcmp(&f1, &f2, sizeof(float)) == 0;
+}
+
+/// Returns true if two driver samples are bit identical or both NaN.
+static bool SameSample(const SampleType & st, const uint8_t * pb1, const uint8_t * pb2)
+{
+    size_t nBytes = BytesPerSample(st);
+    if (memcmp(pb1, pb2, nBytes) == 0)
+        return true;
+    if (st.sfFormat != SF_FLOAT32 && st.sfFormat != SF_FLOAT64)
+        return false;
+    uint64_t n1 = 0;
+    uint64_t n2 = 0;
+    for (size_t nByte = 0; nByte < nBytes; ++nByte)
+    {
+        size_t nIndex = st.bBigEndian ? nBytes - 1 - nByte : nByte;
+        n1 |= (uint64_t)pb1[nIndex] << (8 * nByte);
+        n2 |= (uint64_t)pb2[nIndex] << (8 * nByte);
+    }
+    if (st.sfFormat == SF_FLOAT32)
+    {
+        float f1, f2;
+        uint32_t n32 = (uint32_t)n1;
+        memcpy(&f1, &n32, sizeof(float));
+        n32 = (uint32_t)n2;
+        memcpy(&f2, &n32, sizeof(float));
+        return f1 != f1 && f2 != f2;
+    }
+    double d1, d2;
+    memcpy(&d1, &n1, sizeof(double));
+    memcpy(&d2, &n2, sizeof(double));
+    return d1 != d1 && d2 != d2;
+}
+
+/// Converts with the converter in pieces of varying lengths.
+static void ToFloatPieces(const SampleConverter & sc, const uint8_t * pbSrc,
+                          float * pfDest, size_t nFrames)
+{
+    size_t nPiece = 1;
+    size_t nFrame = 0;
+    while (nFrame < nFrames)
+    {
+        size_t n = nFrames - nFrame < nPiece ? nFrames - nFrame : nPiece;
+        sc.ToFloat(pbSrc + nFrame * sc.BytesPerSample(), pfDest + nFrame, n);
+        nFrame += n;
+        nPiece = nPiece % 67 + 1;
+    }
+}
+
+/// Converts with the converter in pieces of varying lengths.
+static void FromFloatPieces(const SampleConverter & sc, const float * pfSrc,
+                            uint8_t * pbDest, size_t nFrames)
+{
+    size_t nPiece = 1;
+    size_t nFrame = 0;
+    while (nFrame < nFrames)
+    {
+        size_t n = nFrames - nFrame < nPiece ? nFrames - nFrame : nPiece;
+        sc.FromFloat(pfSrc + nFrame, pbDest + nFrame * sc.BytesPerSample(), n);
+        nFrame += n;
+        nPiece = nPiece % 67 + 1;
+    }
+}
+
+/// Test of one ASIO sample type with one instruction set.
+class TypeTest {
+    const SampleType & m_st;
+    SampleConverter m_sc;
+    SampleConverterIsa m_sciIsa;
+    size_t m_nBytes;
+    std::vector<uint8_t> m_vbSrc;
+    std::vector<uint8_t> m_vbRef;
+    std::vector<uint8_t> m_vbDest;
+    std::valarray<float> m_vfRef;
+    std::vector<float> m_vfDest;
+    size_t m_nFill;
+    unsigned int m_nReports;
+    uint64_t m_nSamples;
+
+public:
+    TypeTest(const SampleType & st, SampleConverterIsa sciIsa)
+        : m_st(st),
+          m_sc(st.sfFormat, st.bBigEndian, st.nValidBits, sciIsa),
+          m_sciIsa(sciIsa),
+          m_nBytes(BytesPerSample(st)),
+          m_vbSrc(c_nChunk * BytesPerSample(st)),
+          m_vbRef(c_nChunk * BytesPerSample(st)),
+          m_vbDest(c_nChunk * BytesPerSample(st)),
+          m_vfRef(c_nChunk),
+          m_vfDest(c_nChunk),
+          m_nFill(0),
+          m_nReports(0),
+          m_nSamples(0)
+    {
+        CHECK(m_sc.Isa() == sciIsa);
+        CHECK(m_sc.BytesPerSample() == m_nBytes);
+    }
+
+    /// Adds a driver sample (value n in driver byte order) to the chunk
+    /// converted to float.
+    void AddDriverSample(uint64_t n)
+    {
+        StoreBytes(&m_vbSrc[m_nFill * m_nBytes], n, m_nBytes, m_st.bBigEndian);
+        if (++m_nFill == c_nChunk)
+            FlushToFloat();
+    }
+
+    /// Converts the collected driver samples and compares results.
+    void FlushToFloat()
+    {
+        if (!m_nFill)
+            return;
+        std::valarray<float> vfRef(m_nFill);
+        Asio2Float(&m_vbSrc[0], m_st.iDataType, vfRef);
+        ToFloatPieces(m_sc, &m_vbSrc[0], &m_vfDest[0], m_nFill);
+        for (size_t nFrame = 0; nFrame < m_nFill; ++nFrame)
+        {
+            if (!SameFloat(vfRef[nFrame], m_vfDest[nFrame]))
+                Report("ToFloat", &m_vbSrc[nFrame * m_nBytes], m_nBytes,
+                       (double)vfRef[nFrame], (double)m_vfDest[nFrame]);
+        }
+        m_nSamples += m_nFill;
+        m_nFill = 0;
+    }
+
+    /// Adds a float sample to the chunk converted to driver samples.
+    void AddFloatSample(float f)
+    {
+        m_vfRef[m_nFill] = f;
+        if (++m_nFill == c_nChunk)
+            FlushFromFloat();
+    }
+
+    /// Converts the collected float samples and compares results.
+    void FlushFromFloat()
+    {
+        if (!m_nFill)
+            return;
+        std::valarray<float> vfSrc(m_vfRef[std::slice(0, m_nFill, 1)]);
+        Float2Asio(vfSrc, &m_vbRef[0], m_st.iDataType);
+        // fill with garbage: every byte of a sample must be written
+        memset(&m_vbDest[0], 0xA5, m_nFill * m_nBytes);
+        FromFloatPieces(m_sc, &vfSrc[0], &m_vbDest[0], m_nFill);
+        for (size_t nFrame = 0; nFrame < m_nFill; ++nFrame)
+        {
+            if (!SameSample(m_st, &m_vbRef[nFrame * m_nBytes], &m_vbDest[nFrame * m_nBytes]))
+                ReportBytes(vfSrc[nFrame], &m_vbRef[nFrame * m_nBytes],
+                            &m_vbDest[nFrame * m_nBytes]);
+        }
+        m_nSamples += m_nFill;
+        m_nFill = 0;
+    }
+
+    /// Returns number of samples compared.
+    uint64_t NumSamples() const
+    {
+        return m_nSamples;
+    }
+
+private:
+    void Report(const char * lpszMethod, const uint8_t * pbInput, size_t nBytes,
+                double dExpected, double dResult)
+    {
+        ++g_nFailed;
+        if (++m_nReports > c_nMaxReports)
+            return;
+        printf("%s %s (%s): mismatch for input bytes", m_st.lpszName,
+               lpszMethod, c_rglpszIsa[m_sciIsa]);
+        for (size_t nByte = 0; nByte < nBytes; ++nByte)
+            printf(" %02X", pbInput[nByte]);
+        printf(" (expected %.9g, got %.9g)\n", dExpected, dResult);
+    }
+
+    void ReportBytes(float fInput, const uint8_t * pbExpected, const uint8_t * pbResult)
+    {
+        ++g_nFailed;
+        if (++m_nReports > c_nMaxReports)
+            return;
+        printf("%s FromFloat (%s): mismatch for input %.9g (expected bytes",
+               m_st.lpszName, c_rglpszIsa[m_sciIsa], (double)fInput);
+        size_t nByte;
+        for (nByte = 0; nByte < m_nBytes; ++nByte)
+            printf(" %02X", pbExpected[nByte]);
+        printf(", got");
+        for (nByte = 0; nByte < m_nBytes; ++nByte)
+            printf(" %02X", pbResult[nByte]);
+        printf(")\n");
+    }
+};
+
+/// Driver to float: all codes of integer types (all codes of the valid bits
+/// with random unused upper bits), every nStride-th code of 32 bit integer
+/// and float types, random and special double values.
+static uint64_t TestToFloat(const SampleType & st, SampleConverterIsa sciIsa,
+                            uint64_t nStride)
+{
+    TypeTest tt(st, sciIsa);
+    Random rnd;
+    uint64_t n;
+    switch (st.sfFormat) {
+    case SF_INT16:
+        for (n = 0; n < (1u << 16); ++n)
+            tt.AddDriverSample(n);
+        break;
+    case SF_INT24:
+        for (n = 0; n < (1u << 24); ++n)
+            tt.AddDriverSample(n);
+        break;
+    case SF_INT32:
+        if (st.nValidBits < 32)
+        {
+            for (n = 0; n < (1u << st.nValidBits); ++n)
+                tt.AddDriverSample(n | ((rnd.Next() << st.nValidBits) & 0xFFFFFFFFu));
+            break;
+        }
+        // FALL THROUGH
+    case SF_FLOAT32:
+        for (n = 0; n <= 0xFFFFFFFFu; n += nStride)
+            tt.AddDriverSample(n);
+        tt.AddDriverSample(0x7FFFFFFFu);
+        tt.AddDriverSample(0x80000000u);
+        tt.AddDriverSample(0xFFFFFFFFu);
+        break;
+    case SF_FLOAT64:
+        {
+        // random patterns, doubles near float values (rounding) and
+        // specials
+        for (n = 0; n < 0xFFFFFFFFu / nStride; ++n)
+            tt.AddDriverSample(rnd.Next());
+        for (n = 0; n <= 0xFFFFFFFFu; n += nStride * 16)
+        {
+            uint32_t n32 = (uint32_t)n;
+            float f;
+            memcpy(&f, &n32, sizeof(float));
+            double d = (double)f;
+            uint64_t n64;
+            memcpy(&n64, &d, sizeof(double));
+            tt.AddDriverSample(n64);
+            tt.AddDriverSample(n64 + 1);
+            tt.AddDriverSample(n64 - 1);
+            tt.AddDriverSample(n64 + (1ULL << 28));
+            tt.AddDriverSample(n64 + (1ULL << 28) + 1);
+        }
+        static const uint64_t c_rgnSpecial[] = {
+            0, 0x8000000000000000ULL, 1, 0x000FFFFFFFFFFFFFULL,
+            0x7FF0000000000000ULL, 0xFFF0000000000000ULL,
+            0x7FF8000000000000ULL, 0x7FF0000000000001ULL,
+            0x47EFFFFFE0000000ULL, 0x47EFFFFFF0000000ULL, 0x3FF0000000000000ULL
+        };
+        for (n = 0; n < sizeof(c_rgnSpecial) / sizeof(c_rgnSpecial[0]); ++n)
+            tt.AddDriverSample(c_rgnSpecial[n]);
+        }
+        break;
+    default:
+        break;
+    }
+    tt.FlushToFloat();
+    return tt.NumSamples();
+}
+
+/// Float to driver: every nStride-th float bit pattern, all float values of
+/// the integer codes (round trip), values at the clipping limits.
+static uint64_t TestFromFloat(const SampleType & st, SampleConverterIsa sciIsa,
+                              uint64_t nStride)
+{
+    TypeTest tt(st, sciIsa);
+    uint64_t n;
+    float f;
+    for (n = 0; n <= 0xFFFFFFFFu; n += nStride)
+    {
+        uint32_t n32 = (uint32_t)n;
+        memcpy(&f, &n32, sizeof(float));
+        tt.AddFloatSample(f);
+    }
+    // all 16 bit codes and their neighbours
+    for (n = 0; n < (1u << 16); ++n)
+    {
+        f = (float)(int16_t)n / 32768.0f;
+        tt.AddFloatSample(f);
+        tt.AddFloatSample(nextafterf(f, 2.0f));
+        tt.AddFloatSample(nextafterf(f, -2.0f));
+    }
+    static const float c_rgfSpecial[] = {
+        1.0f, -1.0f, 1.0f - FLT_EPSILON / 2, -1.0f - FLT_EPSILON,
+        1.0f + FLT_EPSILON, 0.0f, -0.0f, FLT_MIN, -FLT_MIN, FLT_MAX, -FLT_MAX
+    };
+    for (n = 0; n < sizeof(c_rgfSpecial) / sizeof(c_rgfSpecial[0]); ++n)
+        tt.AddFloatSample(c_rgfSpecial[n]);
+    tt.FlushFromFloat();
+    return tt.NumSamples();
+}
+
+int main(int argc, char * argv[])
+{
+    uint64_t nStride = 251;
+    if (argc > 1)
+        nStride = strtoull(argv[1], NULL, 10);
+    if (!nStride)
+    {
+        printf("usage: ConvertUnitTest [stride of tested bit patterns, default 251]\n");
+        return 1;
+    }
+    SampleConverterIsa sciAvailable = SampleConverter::AvailableIsa();
+    printf("available instruction set: %s, stride %llu\n",
+           c_rglpszIsa[sciAvailable], (unsigned long long)nStride);
+    for (size_t nType = 0; nType < c_nTypes; ++nType)
+    {
+        const SampleType & st = c_rgstTypes[nType];
+        for (int nIsa = SCI_SCALAR; nIsa <= sciAvailable; ++nIsa)
+        {
+            unsigned int nFailed = g_nFailed;
+            uint64_t nToFloat = TestToFloat(st, (SampleConverterIsa)nIsa, nStride);
+            uint64_t nFromFloat = TestFromFloat(st, (SampleConverterIsa)nIsa, nStride);
+            printf("%-10s %-6s: %llu/%llu samples compared, %s\n",
+                   st.lpszName, c_rglpszIsa[nIsa],
+                   (unsigned long long)nToFloat, (unsigned long long)nFromFloat,
+                   nFailed == g_nFailed ? "ok" : "FAILED");
+        }
+    }
+    // unknown format: silence, nothing written
+    SampleConverter sc;
+    float rgf[5] = { 1, 2, 3, 4, 5 };
+    uint8_t rgb[4] = { 1, 2, 3, 4 };
+    sc.ToFloat(rgb, rgf, 5);
+    sc.FromFloat(rgf, rgb, 1);
+    CHECK(rgf[0] == 0 && rgf[4] == 0);
+    CHECK(rgb[0] == 1 && rgb[3] == 4);
+    CHECK(sc.BytesPerSample() == 0);
+
+    if (g_nFailed)
+    {
+        printf("%u checks failed\n", g_nFailed);
+        return 1;
+    }
+    printf("all tests passed\n");
+    return 0;
+}
+
+// Local Variables:
+// mode: c++
+// c-file-style: "stroustrup"
+// c-basic-offset: 4
+// indent-tabs-mode: nil
+// End:
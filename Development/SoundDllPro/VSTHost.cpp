@@ -42,6 +42,20 @@
 // initialize static member
 SoundDllProMain* TVSTHost::sm_phtSound = NULL;
 
+//------------------------------------------------------------------------------
+/// adds plugin output channel (planar buffer) to a host channel buffer
+//------------------------------------------------------------------------------
+static void AddPluginOutput(std::valarray<float>& vfTarget, const CPlanarBuffer& pbOut, unsigned int nChannel)
+{
+   const float* pf = pbOut.GetChannel(nChannel);
+   size_t nSize = vfTarget.size();
+   if (nSize > pbOut.GetNumFrames())
+      nSize = pbOut.GetNumFrames();
+   for (size_t n = 0; n < nSize; n++)
+      vfTarget[n] += pf[n];
+}
+//------------------------------------------------------------------------------
+
 
 //------------------------------------------------------------------------------
 /// Constructor. Initializes members
@@ -52,7 +66,15 @@ TVSTHost::TVSTHost(UnicodeString usName, SoundDllProMain* phtSound, bool bTest)
       m_usName(usName),
       m_ptIdleTimer(NULL),
       m_ttThreadingType(TT_SINGLE),
-      m_nThreadPriority(2) // corresponds to tpHighest
+      m_nThreadPriority(2), // corresponds to tpHighest
+      m_nThreads(0),
+      m_nLastLayer(-1),
+      m_hWork(NULL),
+      m_hStop(NULL),
+      m_hDone(NULL),
+      m_nJobsPending(0),
+      m_nIdleWorkers(0),
+      m_pvvfExternal(NULL)
 {
    sm_phtSound = phtSound;
    if (!bTest && !sm_phtSound)
@@ -64,6 +86,7 @@ TVSTHost::TVSTHost(UnicodeString usName, SoundDllProMain* phtSound, bool bTest)
    m_ptIdleTimer->Interval = 50;
    m_ptIdleTimer->OnTimer = OnIdleTimer;
    m_bDebugOutputOnce = true;
+   InitializeCriticalSection(&m_csPoolError);
 }
 //------------------------------------------------------------------------------
 
@@ -82,6 +105,7 @@ TVSTHost::~TVSTHost()
    catch (...)
       {
       }
+   DeleteCriticalSection(&m_csPoolError);
    sm_phtSound = NULL;
 }
 //------------------------------------------------------------------------------
@@ -148,13 +172,16 @@ void TVSTHost::AssertIndices(const unsigned int& nLayer, const unsigned int& nCh
 
 
 //------------------------------------------------------------------------------
-/// Initializes plugin vector and internal buffer
+/// Initializes plugin vector and internal buffer. nThreads is the number of
+/// threads used in TT_FIXNUM mode including the calling thread (0: number of
+/// processors)
 //------------------------------------------------------------------------------
 #pragma argsused
 void TVSTHost::Init( unsigned int      nChannels,
                      unsigned int      nBlockSize,
                      TThreadingType    ttThreadingType,
-                     int               nThreadPriority)
+                     int               nThreadPriority,
+                     unsigned int      nThreads)
 {
    AssertSoundRunning();
    Exit();
@@ -163,6 +190,7 @@ void TVSTHost::Init( unsigned int      nChannels,
    if (m_nThreadPriority < 0 || m_nThreadPriority > 3)
       throw Exception("invalid thread priority passd to VSTHost->Init");
    m_nThreadPriority    = nThreadPriority;
+   m_nThreads           = nThreads;
 
    unsigned int nLayer, nChannel;
    m_nBlockSize = nBlockSize;
@@ -447,6 +475,19 @@ void TVSTHost::Start()
                m_vvpPlugins[nLayer][nChannel].m_pPlugin->Start((float)SampleRate(), (int)m_nBlockSize);
          }
       }
+   if (m_ttThreadingType == TT_FIXNUM && HasPlugins())
+      {
+      try
+         {
+         BuildJobGraph();
+         StartPool();
+         }
+      catch (...)
+         {
+         StopPool();
+         throw;
+         }
+      }
    m_bStarted = true;
 }
 //------------------------------------------------------------------------------
@@ -458,6 +499,7 @@ void TVSTHost::Stop()
 {
    if (!m_bStarted)
       return;
+   StopPool();
    unsigned int nLayer, nChannel;
    for (nLayer = 0; nLayer < m_vvpPlugins.size(); nLayer++)
       {
@@ -487,6 +529,8 @@ void TVSTHost::Process(vvfVST& vvfBuffers)
       return;
    if (m_ttThreadingType == TT_PLUGIN)
       ProcessMT(vvfBuffers);
+   else if (m_ttThreadingType == TT_FIXNUM)
+      ProcessPool(vvfBuffers);
    else
       ProcessST(vvfBuffers);
 }
@@ -574,7 +618,7 @@ void TVSTHost::ProcessST(vvfVST& vvfBuffers)
                if (!usError.IsEmpty())
                   throw Exception(usError);
 
-               const vvfVST& vvfOut = m_vvpPlugins[nLayer][nChannel].m_pPlugin->GetOutData();
+               const CPlanarBuffer& pbOut = m_vvpPlugins[nLayer][nChannel].m_pPlugin->GetOutData();
 
                // retrieve reference to output mapping
                const std::vector<int>&  viMappingOut  = m_vvpPlugins[nLayer][nChannel].m_pPlugin->GetOutputMapping();
@@ -582,13 +626,13 @@ void TVSTHost::ProcessST(vvfVST& vvfBuffers)
 
                // accumulate data in internal buffer with respect to output mapping
                // stored in plugin itself!
-               nPluginChannelsOut = (unsigned int)vvfOut.size();
+               nPluginChannelsOut = pbOut.GetNumChannels();
                for (nMappedChannel = 0; nMappedChannel < nMappedChannelsOut; nMappedChannel++)
                   {
-                  if (nMappedChannel > nPluginChannelsOut)
+                  if (nMappedChannel >= nPluginChannelsOut)
                      break;
                   if (viMappingOut[nMappedChannel] < (int)nChannels)
-                     m_vvfInternalBuffers[(unsigned int)viMappingOut[nMappedChannel]] += vvfOut[nMappedChannel];
+                     AddPluginOutput(m_vvfInternalBuffers[(unsigned int)viMappingOut[nMappedChannel]], pbOut, nMappedChannel);
                   }
                }
             }
@@ -732,20 +776,20 @@ void TVSTHost::ProcessMT(vvfVST& vvfBuffers)
             // only call 'real' plugins, no references!
             if (IsPlugin(nLayer, nChannel))
                {
-               const vvfVST& vvfOut = m_vvpPlugins[nLayer][nChannel].m_pPlugin->GetOutData();
+               const CPlanarBuffer& pbOut = m_vvpPlugins[nLayer][nChannel].m_pPlugin->GetOutData();
                // retrieve reference to output mapping
                const std::vector<int>&  viMappingOut  = m_vvpPlugins[nLayer][nChannel].m_pPlugin->GetOutputMapping();
                nMappedChannelsOut   = (unsigned int)viMappingOut.size();
 
                // accumulate data in internal buffer with respect to output mapping
                // stored in plugin itself!
-               nPluginChannelsOut = (unsigned int)vvfOut.size();
+               nPluginChannelsOut = pbOut.GetNumChannels();
                for (nMappedChannel = 0; nMappedChannel < nMappedChannelsOut; nMappedChannel++)
                   {
-                  if (nMappedChannel > nPluginChannelsOut)
+                  if (nMappedChannel >= nPluginChannelsOut)
                      break;
                   if (viMappingOut[nMappedChannel] < (int)nChannels)
-                     m_vvfInternalBuffers[(unsigned int)viMappingOut[nMappedChannel]] += vvfOut[nMappedChannel];
+                     AddPluginOutput(m_vvfInternalBuffers[(unsigned int)viMappingOut[nMappedChannel]], pbOut, nMappedChannel);
                   }
                }
             }
@@ -783,6 +827,542 @@ void TVSTHost::ProcessMT(vvfVST& vvfBuffers)
 }
 //------------------------------------------------------------------------------
 
+//------------------------------------------------------------------------------
+/// TVSTHostJobQueue. Job queue of one worker of TT_FIXNUM mode
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+/// constructor. Allocates ring buffer for nCapacity jobs
+//------------------------------------------------------------------------------
+TVSTHostJobQueue::TVSTHostJobQueue(unsigned int nCapacity)
+   :  m_vnJobs(nCapacity ? nCapacity : 1),
+      m_nHead(0),
+      m_nSize(0)
+{
+   InitializeCriticalSectionAndSpinCount(&m_csQueue, 4000);
+}
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+/// destructor
+//------------------------------------------------------------------------------
+TVSTHostJobQueue::~TVSTHostJobQueue()
+{
+   DeleteCriticalSection(&m_csQueue);
+}
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+/// adds a job at the back (called by owner only). NOTE: every job is pushed
+/// only once per buffer, so capacity cannot be exceeded
+//------------------------------------------------------------------------------
+void TVSTHostJobQueue::Push(unsigned int nJob)
+{
+   EnterCriticalSection(&m_csQueue);
+   m_vnJobs[(m_nHead + m_nSize) % m_vnJobs.size()] = nJob;
+   m_nSize++;
+   LeaveCriticalSection(&m_csQueue);
+}
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+/// removes the newest job from the back (called by owner only)
+/// \retval false if queue is empty
+//------------------------------------------------------------------------------
+bool TVSTHostJobQueue::Pop(unsigned int &nJob)
+{
+   bool bReturn = false;
+   EnterCriticalSection(&m_csQueue);
+   if (m_nSize)
+      {
+      m_nSize--;
+      nJob = m_vnJobs[(m_nHead + m_nSize) % m_vnJobs.size()];
+      bReturn = true;
+      }
+   LeaveCriticalSection(&m_csQueue);
+   return bReturn;
+}
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+/// removes the oldest job from the front (called by other workers)
+/// \retval false if queue is empty
+//------------------------------------------------------------------------------
+bool TVSTHostJobQueue::Steal(unsigned int &nJob)
+{
+   bool bReturn = false;
+   EnterCriticalSection(&m_csQueue);
+   if (m_nSize)
+      {
+      nJob = m_vnJobs[m_nHead];
+      m_nHead = (m_nHead + 1) % (unsigned int)m_vnJobs.size();
+      m_nSize--;
+      bReturn = true;
+      }
+   LeaveCriticalSection(&m_csQueue);
+   return bReturn;
+}
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+/// TVSTHostWorker. Worker thread of TT_FIXNUM mode
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+/// constructor. Starts thread immediately
+//------------------------------------------------------------------------------
+TVSTHostWorker::TVSTHostWorker(TVSTHost* pHost, unsigned int nQueue, TThreadPriority tp)
+ :  TThread(false), m_pHost(pHost), m_nQueue(nQueue)
+{
+   if (!pHost)
+      throw Exception("invalid VST host passed to VSTHostWorker");
+   Priority = tp;
+}
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+/// threads execute routine. Waits for stop or work signal and runs jobs until
+/// no more jobs are found in any queue
+//------------------------------------------------------------------------------
+void __fastcall TVSTHostWorker::Execute()
+{
+   HANDLE hEvents[2] = {m_pHost->m_hStop, m_pHost->m_hWork};
+   while (!Terminated)
+      {
+      InterlockedIncrement(&m_pHost->m_nIdleWorkers);
+      DWORD nWaitResult = WaitForMultipleObjects(2, &hEvents[0], false, 1000);
+      InterlockedDecrement(&m_pHost->m_nIdleWorkers);
+      if (nWaitResult == WAIT_OBJECT_0 + 1)
+         m_pHost->RunJobs(m_nQueue);
+      }
+}
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+/// adds an edge to dependency graph: nSuccessor waits for nJob
+//------------------------------------------------------------------------------
+void TVSTHost::AddDependency(unsigned int nJob, unsigned int nSuccessor)
+{
+   std::vector<unsigned int>& rvnSuccessors = m_vJobs[nJob].m_vnSuccessors;
+   for (unsigned int n = 0; n < rvnSuccessors.size(); n++)
+      {
+      if (rvnSuccessors[n] == nSuccessor)
+         return;
+      }
+   rvnSuccessors.push_back(nSuccessor);
+   m_vJobs[nSuccessor].m_nDependencies++;
+}
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+/// builds dependency graph for TT_FIXNUM mode. Implements the same processing
+/// scheme as ProcessST (see there), but each layer writes to it's own buffers,
+/// so layers do not have to be processed one after another:
+/// -  plugin jobs: process one plugin with the buffers of the previous layer
+/// -  channel jobs: accumulate the outputs of all plugins of a layer writing
+///    to one channel (in the order used by ProcessST) and copy the result to
+///    the recursion buffer
+/// A plugin job waits for the channel jobs of the previous layer for the
+/// channels it reads and for the channel jobs of the recursion buffers it
+/// reads from previous layers. Recursion buffers of the own or following
+/// layers contain data of the last buffer, so the channel jobs writing them
+/// wait for the plugin job instead. Layers without plugins and without
+/// recursion usage are skipped.
+//------------------------------------------------------------------------------
+void TVSTHost::BuildJobGraph()
+{
+   unsigned int nLayer, nChannel, n;
+   m_vJobs.clear();
+
+   // determine layers to process and the buffer each layer reads from
+   // (-1: external buffer)
+   std::vector<bool> vbActive(m_nLayers, false);
+   for (nLayer = 0; nLayer < m_nLayers; nLayer++)
+      {
+      for (nChannel = 0; nChannel < m_nChannels; nChannel++)
+         {
+         if (!!m_vvpPlugins[nLayer][nChannel].m_pPlugin || m_vvnRecursionBufferUsage[nLayer][nChannel])
+            vbActive[nLayer] = true;
+         }
+      }
+   m_vnLayerInput.assign(m_nLayers, -1);
+   m_vvvfLayerBuffers.resize(m_nLayers);
+   m_nLastLayer = -1;
+   for (nLayer = 0; nLayer < m_nLayers; nLayer++)
+      {
+      m_vnLayerInput[nLayer] = m_nLastLayer;
+      m_vvvfLayerBuffers[nLayer].clear();
+      if (vbActive[nLayer])
+         {
+         m_nLastLayer = (int)nLayer;
+         m_vvvfLayerBuffers[nLayer].resize(m_nChannels);
+         for (nChannel = 0; nChannel < m_nChannels; nChannel++)
+            m_vvvfLayerBuffers[nLayer][nChannel].resize(m_nBlockSize);
+         }
+      }
+
+   // plugin jobs in the order used by ProcessST
+   for (nLayer = 0; nLayer < m_nLayers; nLayer++)
+      {
+      for (nChannel = 0; nChannel < m_nChannels; nChannel++)
+         {
+         if (IsPlugin(nLayer, nChannel))
+            {
+            TVSTHostJob job;
+            job.m_pPlugin  = m_vvpPlugins[nLayer][nChannel].m_pPlugin;
+            job.m_nLayer   = nLayer;
+            job.m_nChannel = nChannel;
+            m_vJobs.push_back(job);
+            }
+         }
+      }
+   unsigned int nPluginJobs = (unsigned int)m_vJobs.size();
+
+   // channel jobs of all active layers
+   std::vector<std::vector<unsigned int> > vvnChannelJobs(m_nLayers);
+   for (nLayer = 0; nLayer < m_nLayers; nLayer++)
+      {
+      if (!vbActive[nLayer])
+         continue;
+      vvnChannelJobs[nLayer].resize(m_nChannels);
+      for (nChannel = 0; nChannel < m_nChannels; nChannel++)
+         {
+         TVSTHostJob job;
+         job.m_nLayer      = nLayer;
+         job.m_nChannel    = nChannel;
+         job.m_bClear      = !!m_vvpPlugins[nLayer][nChannel].m_pPlugin;
+         job.m_bRecursion  = m_vvnRecursionBufferUsage[nLayer][nChannel] != 0;
+         vvnChannelJobs[nLayer][nChannel] = (unsigned int)m_vJobs.size();
+         m_vJobs.push_back(job);
+         }
+      }
+
+   // dependencies of plugin jobs
+   for (n = 0; n < nPluginJobs; n++)
+      {
+      TVSTHostPlugin* pPlugin = m_vJobs[n].m_pPlugin;
+      nLayer = m_vJobs[n].m_nLayer;
+      // outputs
+      const std::vector<int>& viMappingOut = pPlugin->GetOutputMapping();
+      unsigned int nPluginChannelsOut = pPlugin->GetOutData().GetNumChannels();
+      for (unsigned int nMappedChannel = 0; nMappedChannel < viMappingOut.size(); nMappedChannel++)
+         {
+         if (nMappedChannel >= nPluginChannelsOut)
+            break;
+         if (viMappingOut[nMappedChannel] < 0 || viMappingOut[nMappedChannel] >= (int)m_nChannels)
+            continue;
+         unsigned int nJob = vvnChannelJobs[nLayer][(unsigned int)viMappingOut[nMappedChannel]];
+         std::vector<TVSTHostPlugin*>& rvpContributors = m_vJobs[nJob].m_vpContributors;
+         if (rvpContributors.empty() || rvpContributors.back() != pPlugin)
+            rvpContributors.push_back(pPlugin);
+         AddDependency(n, nJob);
+         }
+      // inputs
+      const std::vector<TVSTNode >& vNodes = pPlugin->GetInputMapping();
+      for (unsigned int nNode = 0; nNode < vNodes.size(); nNode++)
+         {
+         const TVSTNode& rNode = vNodes[nNode];
+         if (rNode.m_nChannel < 0 || rNode.m_nChannel >= (int)m_nChannels)
+            continue;
+         // real input: wait for previous layer
+         if (rNode.m_nLayer < 0 || rNode.m_nLayer >= (int)m_nLayers)
+            {
+            if (m_vnLayerInput[nLayer] >= 0)
+               AddDependency(vvnChannelJobs[(unsigned int)m_vnLayerInput[nLayer]][(unsigned int)rNode.m_nChannel], n);
+            }
+         // recursion from previous layer: wait for it
+         else if (rNode.m_nLayer < (int)nLayer)
+            AddDependency(vvnChannelJobs[(unsigned int)rNode.m_nLayer][(unsigned int)rNode.m_nChannel], n);
+         // recursion from own or following layer: must be read before it's overwritten
+         else
+            AddDependency(n, vvnChannelJobs[(unsigned int)rNode.m_nLayer][(unsigned int)rNode.m_nChannel]);
+         }
+      }
+
+   // channel jobs keeping the data of the previous layer wait for it
+   for (n = nPluginJobs; n < m_vJobs.size(); n++)
+      {
+      nLayer = m_vJobs[n].m_nLayer;
+      if (!m_vJobs[n].m_bClear && m_vnLayerInput[nLayer] >= 0)
+         AddDependency(vvnChannelJobs[(unsigned int)m_vnLayerInput[nLayer]][m_vJobs[n].m_nChannel], n);
+      }
+}
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+/// creates queues and worker threads for TT_FIXNUM mode. The calling thread
+/// of Process is used as worker as well (queue 0)
+//------------------------------------------------------------------------------
+void TVSTHost::StartPool()
+{
+   unsigned int n, nPlugins = 0;
+   for (n = 0; n < m_vJobs.size(); n++)
+      {
+      if (!!m_vJobs[n].m_pPlugin)
+         nPlugins++;
+      }
+   unsigned int nThreads = m_nThreads;
+   if (!nThreads)
+      {
+      SYSTEM_INFO si;
+      GetSystemInfo(&si);
+      nThreads = (unsigned int)si.dwNumberOfProcessors;
+      }
+   // more threads than plugins are never busy
+   if (nThreads > nPlugins)
+      nThreads = nPlugins;
+   if (nThreads < 1)
+      nThreads = 1;
+
+   m_hWork = CreateSemaphore(NULL, 0, (LONG)(m_vJobs.size() + nThreads), NULL);
+   m_hStop = CreateEvent(NULL, TRUE, FALSE, NULL);
+   m_hDone = CreateEvent(NULL, TRUE, FALSE, NULL);
+   if (!m_hWork || !m_hStop || !m_hDone)
+      throw Exception("error creating VST-Host worker events");
+   m_nIdleWorkers = 0;
+   for (n = 0; n < nThreads; n++)
+      m_vpQueues.push_back(new TVSTHostJobQueue((unsigned int)m_vJobs.size()));
+   TThreadPriority tp = (TThreadPriority)((int)tpNormal + m_nThreadPriority);
+   for (n = 1; n < nThreads; n++)
+      m_vpWorkers.push_back(new TVSTHostWorker(this, n, tp));
+}
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+/// stops and deletes worker threads and queues of TT_FIXNUM mode
+//------------------------------------------------------------------------------
+void TVSTHost::StopPool()
+{
+   unsigned int n;
+   for (n = 0; n < m_vpWorkers.size(); n++)
+      m_vpWorkers[n]->Terminate();
+   if (m_hStop)
+      SetEvent(m_hStop);
+   for (n = 0; n < m_vpWorkers.size(); n++)
+      {
+      m_vpWorkers[n]->WaitFor();
+      TRYDELETENULL(m_vpWorkers[n]);
+      }
+   m_vpWorkers.clear();
+   for (n = 0; n < m_vpQueues.size(); n++)
+      TRYDELETENULL(m_vpQueues[n]);
+   m_vpQueues.clear();
+   if (m_hWork)
+      CloseHandle(m_hWork);
+   if (m_hStop)
+      CloseHandle(m_hStop);
+   if (m_hDone)
+      CloseHandle(m_hDone);
+   m_hWork = NULL;
+   m_hStop = NULL;
+   m_hDone = NULL;
+   m_vJobs.clear();
+   m_vvvfLayerBuffers.clear();
+}
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+/// releases semaphore for up to nJobs idle workers. A failure is stored as
+/// pool error: pushed jobs are still run by the calling thread
+//------------------------------------------------------------------------------
+void TVSTHost::WakeWorkers(LONG nJobs)
+{
+   LONG nIdle = m_nIdleWorkers;
+   if (nJobs > nIdle)
+      nJobs = nIdle;
+   if (nJobs > 0 && !ReleaseSemaphore(m_hWork, nJobs, NULL))
+      SetPoolError("error releasing worker semaphore: " + GetLastWindowsError());
+}
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+/// stores first error of pool processing to be thrown by ProcessPool
+//------------------------------------------------------------------------------
+void TVSTHost::SetPoolError(const UnicodeString& usError)
+{
+   EnterCriticalSection(&m_csPoolError);
+   if (m_usPoolError.IsEmpty())
+      m_usPoolError = usError;
+   LeaveCriticalSection(&m_csPoolError);
+}
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+/// runs jobs from own queue or stolen from other queues until all queues are
+/// empty
+//------------------------------------------------------------------------------
+void TVSTHost::RunJobs(unsigned int nQueue)
+{
+   unsigned int nQueues = (unsigned int)m_vpQueues.size();
+   unsigned int nJob, n;
+   while (1)
+      {
+      if (!m_vpQueues[nQueue]->Pop(nJob))
+         {
+         for (n = 1; n < nQueues; n++)
+            {
+            if (m_vpQueues[(nQueue + n) % nQueues]->Steal(nJob))
+               break;
+            }
+         if (n >= nQueues)
+            return;
+         }
+      RunJob(nQueue, nJob);
+      }
+}
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+/// runs one job and pushes successors, that are ready now, to queue nQueue.
+/// Errors are stored and thrown by ProcessPool after all jobs are done
+//------------------------------------------------------------------------------
+void TVSTHost::RunJob(unsigned int nQueue, unsigned int nJob)
+{
+   TVSTHostJob& rJob = m_vJobs[nJob];
+   try
+      {
+      int nInput = m_vnLayerInput[rJob.m_nLayer];
+      const vvfVST& rvvfInput = nInput < 0 ? *m_pvvfExternal : m_vvvfLayerBuffers[(unsigned int)nInput];
+      if (!!rJob.m_pPlugin)
+         {
+         rJob.m_pPlugin->Process(rvvfInput, m_vvvfRecursionBuffers);
+         // retrieve error from plugin
+         UnicodeString usError = rJob.m_pPlugin->GetProcError();
+         if (!usError.IsEmpty())
+            throw Exception(usError);
+         }
+      else
+         {
+         std::valarray<float>& rvfChannel = m_vvvfLayerBuffers[rJob.m_nLayer][rJob.m_nChannel];
+         if (rJob.m_bClear)
+            rvfChannel = 0.0f;
+         else
+            rvfChannel = rvvfInput[rJob.m_nChannel];
+         // accumulate data with respect to output mapping of plugins
+         for (unsigned int n = 0; n < rJob.m_vpContributors.size(); n++)
+            {
+            const CPlanarBuffer& pbOut = rJob.m_vpContributors[n]->GetOutData();
+            const std::vector<int>& viMappingOut = rJob.m_vpContributors[n]->GetOutputMapping();
+            unsigned int nPluginChannelsOut = pbOut.GetNumChannels();
+            for (unsigned int nMappedChannel = 0; nMappedChannel < viMappingOut.size(); nMappedChannel++)
+               {
+               if (nMappedChannel >= nPluginChannelsOut)
+                  break;
+               if (viMappingOut[nMappedChannel] == (int)rJob.m_nChannel)
+                  AddPluginOutput(rvfChannel, pbOut, nMappedChannel);
+               }
+            }
+         if (rJob.m_bRecursion)
+            m_vvvfRecursionBuffers[rJob.m_nLayer][rJob.m_nChannel] = rvfChannel;
+         }
+      }
+   catch (Exception &e)
+      {
+      SetPoolError(e.Message);
+      }
+   catch (...)
+      {
+      SetPoolError("unknown exception in plugin processing");
+      }
+
+   // release successors: run first one in this thread, wake workers for others
+   LONG nReady = 0;
+   for (unsigned int n = 0; n < rJob.m_vnSuccessors.size(); n++)
+      {
+      if (InterlockedDecrement(&m_vJobs[rJob.m_vnSuccessors[n]].m_nPending) == 0)
+         {
+         m_vpQueues[nQueue]->Push(rJob.m_vnSuccessors[n]);
+         nReady++;
+         }
+      }
+   if (nReady > 1)
+      WakeWorkers(nReady - 1);
+   if (InterlockedDecrement(&m_nJobsPending) == 0)
+      SetEvent(m_hDone);
+}
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+/// calls Process function of all plugins using the worker pool (TT_FIXNUM).
+/// The calling thread runs jobs as well until all jobs are done
+//------------------------------------------------------------------------------
+void TVSTHost::ProcessPool(vvfVST& vvfBuffers)
+{
+   try
+      {
+      if (!m_bStarted)
+         throw Exception("VSTHost " + m_usName + " not started: call to Process not allowed!");
+      unsigned int nChannels = (unsigned int)vvfBuffers.size();
+      if (m_nChannels != nChannels || m_vpQueues.empty())
+         throw Exception("fatal sizing error 1 in VSTHost");
+      unsigned int nChannel, nJob;
+      for (nChannel = 0; nChannel < nChannels; nChannel++)
+         {
+         if (vvfBuffers[nChannel].size() != m_nBlockSize)
+            throw Exception("fatal sizing error 1.5 in VSTHost");
+         }
+
+      m_pvvfExternal = &vvfBuffers;
+      // NOTE: workers of a previous call may still be storing an error after
+      // a timeout, so reset under lock as well
+      EnterCriticalSection(&m_csPoolError);
+      m_usPoolError  = "";
+      LeaveCriticalSection(&m_csPoolError);
+      m_nJobsPending = (LONG)m_vJobs.size();
+      for (nJob = 0; nJob < m_vJobs.size(); nJob++)
+         m_vJobs[nJob].m_nPending = m_vJobs[nJob].m_nDependencies;
+      ResetEvent(m_hDone);
+      LONG nReady = 0;
+      for (nJob = 0; nJob < m_vJobs.size(); nJob++)
+         {
+         if (!m_vJobs[nJob].m_nDependencies)
+            {
+            m_vpQueues[0]->Push(nJob);
+            nReady++;
+            }
+         }
+      WakeWorkers(nReady - 1);
+
+      HANDLE hEvents[2] = {m_hDone, m_hWork};
+      DWORD dwStart = GetTickCount();
+      // NOTE: wait for 'done' event rather than checking m_nJobsPending: the
+      // event is the last access of the thread running the last job
+      while (1)
+         {
+         RunJobs(0);
+         InterlockedIncrement(&m_nIdleWorkers);
+         DWORD nWaitResult = WaitForMultipleObjects(2, &hEvents[0], false, 10000);
+         InterlockedDecrement(&m_nIdleWorkers);
+         if (nWaitResult == WAIT_OBJECT_0)
+            break;
+         if (nWaitResult == WAIT_TIMEOUT || GetTickCount() - dwStart > 10000)
+            throw Exception("unexpected timeout waiting for plugin processing");
+         }
+      EnterCriticalSection(&m_csPoolError);
+      UnicodeString usError = m_usPoolError;
+      LeaveCriticalSection(&m_csPoolError);
+      if (!usError.IsEmpty())
+         throw Exception(usError);
+
+      // copy data of last layer back to external buffer
+      if (m_nLastLayer >= 0)
+         {
+         for (nChannel = 0; nChannel < nChannels; nChannel++)
+            vvfBuffers[nChannel] = m_vvvfLayerBuffers[(unsigned int)m_nLastLayer][nChannel];
+         }
+      }
+   catch (Exception &e)
+      {
+      throw Exception("exception in VSTHost processing callback: " + e.Message);
+      }
+   catch (...)
+      {
+      throw Exception("unknown exception in VSTHost processing callback");
+      }
+   m_bDebugOutputOnce = false;
+}
+//------------------------------------------------------------------------------
+
 //------------------------------------------------------------------------------
 /// Idle timer. Calls idle for all effect editors
 //------------------------------------------------------------------------------
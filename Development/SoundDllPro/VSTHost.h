@@ -42,6 +42,7 @@
 
 
 class SoundDllProMain;
+class TVSTHost;
 
 //------------------------------------------------------------------------------
 /// \class TVSTHostPluginInstance. Helper class for storing plugin instances an
@@ -68,19 +69,78 @@ enum TThreadingType
    TT_FIXNUM      // host uses a fix num of threads
 };
 
+//------------------------------------------------------------------------------
+/// \class TVSTHostJob. Node of the dependency graph processed by the worker
+/// pool in TT_FIXNUM mode. A job either processes one plugin or accumulates
+/// the outputs of a layer into one channel
+//------------------------------------------------------------------------------
+class TVSTHostJob
+{
+   public:
+      TVSTHostJob() : m_pPlugin(NULL), m_nLayer(0), m_nChannel(0), m_bClear(false),
+                      m_bRecursion(false), m_nDependencies(0), m_nPending(0){;}
+      TVSTHostPlugin*               m_pPlugin;        /// plugin to process (NULL for channel jobs)
+      unsigned int                  m_nLayer;         /// layer of job
+      unsigned int                  m_nChannel;       /// channel to accumulate (channel jobs only)
+      bool                          m_bClear;         /// channel is used as input in layer (channel jobs only)
+      bool                          m_bRecursion;     /// channel is used for recursion (channel jobs only)
+      std::vector<TVSTHostPlugin*>  m_vpContributors; /// plugins writing to channel (channel jobs only)
+      std::vector<unsigned int>     m_vnSuccessors;   /// jobs waiting for this job
+      LONG                          m_nDependencies;  /// number of jobs this job waits for
+      volatile LONG                 m_nPending;       /// jobs still to be done before this job is ready
+};
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+/// \class TVSTHostJobQueue. Job queue of one worker. The owner pushes and pops
+/// jobs at the back, other workers steal jobs from the front. Capacity is the
+/// total number of jobs, so no allocation is done while processing
+//------------------------------------------------------------------------------
+class TVSTHostJobQueue
+{
+   public:
+      TVSTHostJobQueue(unsigned int nCapacity);
+      ~TVSTHostJobQueue();
+      void                       Push(unsigned int nJob);
+      bool                       Pop(unsigned int &nJob);
+      bool                       Steal(unsigned int &nJob);
+   private:
+      CRITICAL_SECTION           m_csQueue;
+      std::vector<unsigned int>  m_vnJobs;
+      unsigned int               m_nHead;
+      unsigned int               m_nSize;
+};
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+/// \class TVSTHostWorker. Worker thread of TT_FIXNUM mode
+//------------------------------------------------------------------------------
+class TVSTHostWorker : public TThread
+{
+   public:
+      TVSTHostWorker(TVSTHost* pHost, unsigned int nQueue, TThreadPriority tp);
+      void __fastcall Execute();
+   private:
+      TVSTHost*      m_pHost;
+      unsigned int   m_nQueue;
+};
+//------------------------------------------------------------------------------
+
 //------------------------------------------------------------------------------
 /// \class TVSTHost. Class for handling multiple instances of TVSTHostPlugin
 /// in mutliple channels.
 //------------------------------------------------------------------------------
 class TVSTHost
 {
+   friend class TVSTHostWorker;
    public:
       TVSTHost(UnicodeString usName, SoundDllProMain* phtSound, bool bTest = false);
       ~TVSTHost();
       void                 Init( unsigned int      nChannels,
                                  unsigned int      nBlockSize,
                                  TThreadingType    ttThreadingType,
-                                 int               nThreadPriority);
+                                 int               nThreadPriority,
+                                 unsigned int      nThreads = 0);
       void                 Start();
       void                 Stop();
       TVSTHostPlugin*      LoadPlugin( UnicodeString usLibName,
@@ -128,6 +188,31 @@ class TVSTHost
       void                 ProcessST(vvfVST& vvfBuffers);
       void                 ProcessMT(vvfVST& vvfBuffers);
       bool                 HasPlugins();
+      // members for TT_FIXNUM
+      unsigned int         m_nThreads;
+      std::vector<TVSTHostJob>        m_vJobs;
+      std::vector<int>                m_vnLayerInput;
+      std::vector<vvfVST>             m_vvvfLayerBuffers;
+      int                  m_nLastLayer;
+      std::vector<TVSTHostJobQueue*>  m_vpQueues;
+      std::vector<TVSTHostWorker*>    m_vpWorkers;
+      HANDLE               m_hWork;
+      HANDLE               m_hStop;
+      HANDLE               m_hDone;
+      volatile LONG        m_nJobsPending;
+      volatile LONG        m_nIdleWorkers;
+      const vvfVST*        m_pvvfExternal;
+      CRITICAL_SECTION     m_csPoolError;
+      UnicodeString        m_usPoolError;
+      void                 BuildJobGraph();
+      void                 AddDependency(unsigned int nJob, unsigned int nSuccessor);
+      void                 StartPool();
+      void                 StopPool();
+      void                 ProcessPool(vvfVST& vvfBuffers);
+      void                 RunJobs(unsigned int nQueue);
+      void                 RunJob(unsigned int nQueue, unsigned int nJob);
+      void                 WakeWorkers(LONG nJobs);
+      void                 SetPoolError(const UnicodeString& usError);
 
 };
 //------------------------------------------------------------------------------
@@ -40,6 +40,7 @@
 #include "VSTHostPlugin.h"
 #include "VSTHost.h"
 #include "SoundDllPro_Tools.h"
+#include "SoundDllPro_Trace.h"
 //---------------------------------------------------------------------------
 #pragma package(smart_init)
 #pragma link "VSTParameterFrame"
@@ -164,11 +165,8 @@ TVSTHostPlugin::TVSTHostPlugin(  AnsiString                 strLibName,
                         +  " outputs");
       
 
-      // set vector/valarray sizes
-      m_vvafIn.resize((unsigned int)m_pEffect->numInputs);
+      // set pointer list size
       m_vapfIn.resize((unsigned int)m_pEffect->numInputs);
-      m_vvafOut.resize((unsigned int)m_pEffect->numOutputs);
-      m_vapfOut.resize((unsigned int)m_pEffect->numOutputs);
 
       // check mapping vectors
       unsigned int i;
@@ -378,21 +376,33 @@ void TVSTHostPlugin::GetNumChannels(AnsiString strLibName, int &nNumIn, int &nNu
 
 
 //------------------------------------------------------------------------------
-/// Creates local buffers.
+/// Creates local buffers. Input and output buffers are one aligned planar block
+/// each.
 //------------------------------------------------------------------------
 void TVSTHostPlugin::SetBufferSize(unsigned int nBufferSize)
 {
    // adjust float buffer sizes and re-set pointers to internal buffers
+   m_pbIn.SetSize((unsigned int)m_vapfIn.size(), nBufferSize);
+   m_pbOut.SetSize((unsigned int)m_pEffect->numOutputs, nBufferSize);
    unsigned int i;
-   for (i = 0; i < m_vvafIn.size(); i++)
-      {
-      m_vvafIn[i].resize(nBufferSize);
-      m_vapfIn[i] = &m_vvafIn[i][0];
-      }
-   for (i = 0; i < m_vvafOut.size(); i++)
+   for (i = 0; i < m_vapfIn.size(); i++)
+      m_vapfIn[i] = m_pbIn.GetChannel(i);
+}
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+/// Sets pointer of one plugin input to passed channel data without copying.
+/// Source is not written by host while plugin is processing (see TVSTHost).
+/// Sources shorter than the block are copied to internal buffer (zero padded)
+//------------------------------------------------------------------------
+void TVSTHostPlugin::SetInput(unsigned int nInput, const std::valarray<float>& vfSource)
+{
+   if (vfSource.size() >= m_pbIn.GetNumFrames())
+      m_vapfIn[nInput] = const_cast<float*>(&vfSource[0]);
+   else
       {
-      m_vvafOut[i].resize(nBufferSize);
-      m_vapfOut[i] = &m_vvafOut[i][0];
+      m_pbIn.CopyFrom(nInput, vfSource);
+      m_vapfIn[nInput] = m_pbIn.GetChannel(nInput);
       }
 }
 //------------------------------------------------------------------------------
@@ -897,7 +907,7 @@ void TVSTHostPlugin::Process(const vvfVST& vvfBuffer, const std::vector<vvfVST>&
 {
    unsigned int nChannels           = (unsigned int)vvfBuffer.size();
    unsigned int nMappedChannels     = (unsigned int)m_vMappingIn.size();
-   unsigned int nInternalChannels   = (unsigned int)m_vvafIn.size();
+   unsigned int nInternalChannels   = (unsigned int)m_vapfIn.size();
    unsigned int nLayers             = (unsigned int)vvvfRecursion.size();
    unsigned int i;
 
@@ -912,6 +922,8 @@ void TVSTHostPlugin::Process(const vvfVST& vvfBuffer, const std::vector<vvfVST>&
 
       // copy external input data with respect to channel mapping
       // directly to output
+      if (nInternalChannels > m_pbOut.GetNumChannels())
+         nInternalChannels = m_pbOut.GetNumChannels();
       for (i = 0; i < nInternalChannels; i++)
          {
          // channel mapped at all ?
@@ -920,23 +932,24 @@ void TVSTHostPlugin::Process(const vvfVST& vvfBuffer, const std::vector<vvfVST>&
             TVSTNode& rNode = m_vMappingIn[i];
             // channel negative or out of range: fill with zeroes
             if (rNode.m_nChannel < 0 || rNode.m_nChannel >= (int)nChannels)
-               m_vvafOut[i] = 0.0f;
+               m_pbOut.Clear(i);
             // layer neagtive or out of range: use regular input
             else if (rNode.m_nLayer < 0 || rNode.m_nLayer >= (int)nLayers)
-               m_vvafOut[i] = vvfBuffer[(unsigned int)rNode.m_nChannel];
+               m_pbOut.CopyFrom(i, vvfBuffer[(unsigned int)rNode.m_nChannel]);
             // copy recursion buffer
             else
-               m_vvafOut[i] = vvvfRecursion[(unsigned int)rNode.m_nLayer][(unsigned int)rNode.m_nChannel];
+               m_pbOut.CopyFrom(i, vvvfRecursion[(unsigned int)rNode.m_nLayer][(unsigned int)rNode.m_nChannel]);
             }
          else
-            m_vvafOut[i] = 0.0f;
+            m_pbOut.Clear(i);
          }
       }
    // real processing (no bypass)
    else
       {
 
-      // copy external input data with respect to channel mapping
+      // pass external input data with respect to channel mapping: plugin reads
+      // mapped channels in place
       for (i = 0; i < nInternalChannels; i++)
          {
          // channel mapped at all ?
@@ -945,13 +958,16 @@ void TVSTHostPlugin::Process(const vvfVST& vvfBuffer, const std::vector<vvfVST>&
             TVSTNode& rNode = m_vMappingIn[i];
             // channel negative or out of range: fill with zeroes
             if (rNode.m_nChannel < 0 || rNode.m_nChannel >= (int)nChannels)
-               m_vvafIn[i] = 0.0f;
+               {
+               m_pbIn.Clear(i);
+               m_vapfIn[i] = m_pbIn.GetChannel(i);
+               }
             // layer neagtive or out of range: use regular input
             else if (rNode.m_nLayer < 0 || rNode.m_nLayer >= (int)nLayers)
-               m_vvafIn[i] = vvfBuffer[(unsigned int)rNode.m_nChannel];
-            // copy recursion buffer
+               SetInput(i, vvfBuffer[(unsigned int)rNode.m_nChannel]);
+            // use recursion buffer
             else
-               m_vvafIn[i] = vvvfRecursion[(unsigned int)rNode.m_nLayer][(unsigned int)rNode.m_nChannel];
+               SetInput(i, vvvfRecursion[(unsigned int)rNode.m_nLayer][(unsigned int)rNode.m_nChannel]);
 
 
             #ifdef DEBUG_RECURSE
@@ -973,13 +989,14 @@ void TVSTHostPlugin::Process(const vvfVST& vvfBuffer, const std::vector<vvfVST>&
             #endif
             }
          else
-            m_vvafIn[i] = 0.0f;
+            {
+            m_pbIn.Clear(i);
+            m_vapfIn[i] = m_pbIn.GetChannel(i);
+            }
          }
 
-      nInternalChannels   = (unsigned int)m_vvafOut.size();
       // clear internal output buffers
-      for (i = 0; i < nInternalChannels; i++)
-         m_vvafOut[i] = 0.0f;
+      m_pbOut.Clear();
 
 
       if (!m_pProcThread)
@@ -1006,16 +1023,18 @@ void TVSTHostPlugin::DoProcess()
    while (dw--) ;
    return;
    */
+   SDPTrace::Begin(m_strEffectName.c_str());
    #ifndef VST_2_4_EXTENSIONS
    if (!m_bCanReplacing)
       {
-      m_pEffect->process(m_pEffect, &m_vapfIn[0], &m_vapfOut[0], m_nBlockSize);
+      m_pEffect->process(m_pEffect, &m_vapfIn[0], m_pbOut.GetChannels(), m_nBlockSize);
       }
    else
    #endif
       {
-      m_pEffect->processReplacing(m_pEffect, &m_vapfIn[0], &m_vapfOut[0], m_nBlockSize);
+      m_pEffect->processReplacing(m_pEffect, &m_vapfIn[0], m_pbOut.GetChannels(), m_nBlockSize);
       }
+   SDPTrace::End(m_strEffectName.c_str());
 }
 
 //------------------------------------------------------------------------------
@@ -1030,11 +1049,11 @@ HANDLE&    TVSTHostPlugin::GetProcHandle()
 //------------------------------------------------------------------------------
 /// returns internal output data
 //------------------------------------------------------------------------------
-const std::vector<std::valarray<float> >& TVSTHostPlugin::GetOutData()
+const CPlanarBuffer& TVSTHostPlugin::GetOutData()
 {
    // return complete (!) internal buffer. Host has to pick correct channels according
    // to output channel mapping
-   return m_vvafOut;
+   return m_pbOut;
 }
 //------------------------------------------------------------------------------
 
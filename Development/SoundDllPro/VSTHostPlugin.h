@@ -56,6 +56,7 @@
 #pragma clang diagnostic pop // restore options
 
 #include "VSTVendorDefs.h"
+#include "PlanarBuffer.h"
 
 #define TRYDELETENULL(p) {if (p!=NULL) { try {delete p;} catch (...){;} p = NULL;}}
 
@@ -225,7 +226,7 @@ class TVSTHostPlugin
       float                   GetParameter(int nIndex);
       void                    Process(const vvfVST& vvfBuffer, const std::vector<vvfVST>& vvvfRecursion);
       HANDLE&                 GetProcHandle();
-      const vvfVST&           GetOutData();
+      const CPlanarBuffer&    GetOutData();
       const std::vector<int>&       GetOutputMapping();
       const std::vector<TVSTNode >& GetInputMapping();
       void                    CallEditIdle();
@@ -246,10 +247,9 @@ class TVSTHostPlugin
       TVSTPluginProperties*   m_pfrmProperties;
       int                     m_nBlockSize;
       AnsiString              m_asProcError;
-      std::vector<std::valarray<float> >  m_vvafIn;      /// internal input buffers
-      std::vector<std::valarray<float> >  m_vvafOut;     /// internal output buffers
+      CPlanarBuffer           m_pbIn;        /// internal input buffers (unmapped and short inputs)
+      CPlanarBuffer           m_pbOut;       /// internal output buffers
       std::valarray<float *>  m_vapfIn;      /// internal pointer lists to input buffers
-      std::valarray<float *>  m_vapfOut;     /// internal pointer lists to output buffers
       bool                    m_bDebugOutputOnce;
 
       // channel 'mappings': plugin itself uses m_vMappingIn to copy correct channels
@@ -261,6 +261,7 @@ class TVSTHostPlugin
       void                    GetProperties();
       void                    Cleanup();
       void                    SetBufferSize(unsigned int nBufferSize);
+      void                    SetInput(unsigned int nInput, const std::valarray<float>& vfSource);
 };
 //------------------------------------------------------------------------------
 #endif
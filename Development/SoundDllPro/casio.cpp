@@ -90,7 +90,9 @@ CAsio * CAsio::Instance()
 }
 
 CAsio::CAsio()
-    : m_phCbEvents(0),
+    : m_ppcCallback(0),
+      m_ppcProcWait(0),
+      m_phCbEvents(0),
       m_phStopEvents(0),
       m_phProcEvents(0),
       m_phDoneEvents(0),
@@ -112,6 +114,7 @@ CAsio::CAsio()
       m_vviActiveChIndices(),
       m_vvsActiveChNames(),
       m_vviActiveChDataTypes(),
+      m_vvscActiveChConverters(),
       m_pacbCallbacks(NULL),
       m_nWatchdogTimeout(500),
       m_bStopping(false),
@@ -845,6 +848,10 @@ void CAsio::CreateBuffers(const std::vector<bool> & vbChannelMaskIn,
     //     data type specifiers for active input channels (see ChannelDataType)
     // m_vviActiveChDataTypes[OUTPUT]
     //     data type specifiers for active output channels
+    // m_vvscActiveChConverters[INPUT]
+    //     sample converters for active input channels
+    // m_vvscActiveChConverters[OUTPUT]
+    //     sample converters for active output channels
     // m_vvfAciveChMaxValues[INPUT)
     //     maximum possible sample values of sound samples in active input channels
     // m_vvfAciveChMaxValues[OUTPUT)
@@ -958,11 +965,13 @@ void CAsio::CreateBuffers(const std::vector<bool> & vbChannelMaskIn,
     m_vviActiveChIndices.resize(2);
     m_vvsActiveChNames.resize(2);
     m_vviActiveChDataTypes.resize(2);
+    m_vvscActiveChConverters.resize(2);
     m_vvfAciveChMaxValues.resize(2);
     m_vvfAciveChMinValues.resize(2);
     m_vviActiveChIndices[INPUT].clear();
     m_vvsActiveChNames[INPUT].clear();
     m_vviActiveChDataTypes[INPUT].clear();
+    m_vvscActiveChConverters[INPUT].clear();
     m_vvfAciveChMaxValues[INPUT].clear();
     m_vvfAciveChMinValues[INPUT].clear();
     size_t nChIdx;
@@ -980,6 +989,7 @@ void CAsio::CreateBuffers(const std::vector<bool> & vbChannelMaskIn,
             m_vvsActiveChNames[INPUT].push_back(ChannelName((long)nChIdx, INPUT));
             long nDataType = ChannelDataType((long)nChIdx, INPUT);
             m_vviActiveChDataTypes[INPUT].push_back(nDataType);
+            m_vvscActiveChConverters[INPUT].push_back(CreateSampleConverter(nDataType));
             m_vvfAciveChMaxValues[INPUT].push_back(MaxFloatSample(nDataType));
             m_vvfAciveChMinValues[INPUT].push_back(MinFloatSample(nDataType));
             ++m_nActiveChannelsIn;
@@ -988,6 +998,7 @@ void CAsio::CreateBuffers(const std::vector<bool> & vbChannelMaskIn,
     m_vviActiveChIndices[OUTPUT].clear();
     m_vvsActiveChNames[OUTPUT].clear();
     m_vviActiveChDataTypes[OUTPUT].clear();
+    m_vvscActiveChConverters[OUTPUT].clear();
     m_vvfAciveChMaxValues[OUTPUT].clear();
     m_vvfAciveChMinValues[OUTPUT].clear();
     for (nChIdx = 0; nChIdx < vbChannelMaskOut.size(); ++nChIdx)
@@ -1004,6 +1015,7 @@ void CAsio::CreateBuffers(const std::vector<bool> & vbChannelMaskIn,
             m_vvsActiveChNames[OUTPUT].push_back(ChannelName((long)nChIdx, OUTPUT));
             long nDataType = (long)ChannelDataType((long)nChIdx, OUTPUT);
             m_vviActiveChDataTypes[OUTPUT].push_back(nDataType);
+            m_vvscActiveChConverters[OUTPUT].push_back(CreateSampleConverter(nDataType));
             m_vvfAciveChMaxValues[OUTPUT].push_back(MaxFloatSample(nDataType));
             m_vvfAciveChMinValues[OUTPUT].push_back(MinFloatSample(nDataType));
             ++m_nActiveChannelsOut;
@@ -1077,6 +1089,7 @@ void CAsio::CreateBuffers(const std::vector<bool> & vbChannelMaskIn,
         m_vviActiveChIndices.clear();
         m_vvsActiveChNames.clear();
         m_vviActiveChDataTypes.clear();
+        m_vvscActiveChConverters.clear();
         delete m_psxSoundDataExchanger;
         m_psxSoundDataExchanger = 0;
         --sm_nObjects;
@@ -1158,6 +1171,7 @@ void CAsio::DisposeBuffers()
     m_vviActiveChIndices.clear();
     m_vvsActiveChNames.clear();
     m_vviActiveChDataTypes.clear();
+    m_vvscActiveChConverters.clear();
     SetState(INITIALIZED);
 }
 
@@ -1912,7 +1926,15 @@ unsigned CAsio::BuffersWaitingForProcLoop()
     unsigned nBuffersWaiting = GetSoundDataExchanger()->ProcNumClientBuffers();
     if (nBuffersWaiting == 0)
     {
+        if (m_ppcProcWait)
+        {
+            m_ppcProcWait->Start();
+        }
         nBuffersWaiting = WaitForProc();
+        if (m_ppcProcWait)
+        {
+            m_ppcProcWait->Stop();
+        }
         /// may be 0 if Quit or Stop event was set
     }
     return nBuffersWaiting;
@@ -1952,9 +1974,18 @@ unsigned CAsio::WaitForProc()
     rghEvents[L_PLAYBACK] =
         GetSoundDataExchanger()->GetProcPlaybackSpaceEvent();
     rghEvents[L_STOP] = m_phProcEvents[PROC_STOP];
+    // At small buffer sizes the next buffer often arrives within a few
+    // microseconds: spin shortly before entering the kernel. Spinning
+    // leaves the events set, so the wait below may return once without
+    // buffers available.
+    unsigned nNumBuffersWaiting =
+        GetSoundDataExchanger()->SpinForProcClientBuffers();
+    if (nNumBuffersWaiting > 0U)
+    {
+        return nNumBuffersWaiting;
+    }
     for (;;)
     {
-        unsigned nNumBuffersWaiting;
         DWORD nWaitResult =
             WaitForMultipleObjects(L_EVENTS, rghEvents, false, INFINITE);
         switch (nWaitResult)
@@ -2647,9 +2678,10 @@ void CAsio::ConvertInputsToFloat(long nDoubleBufferIndex,
                                    this,
                                    vvfBuf[nChannel].size());
         }
-        Asio2Float(m_rgabiBufferInfos[nChannel].buffers[nDoubleBufferIndex],
-                   m_vviActiveChDataTypes[INPUT][nChannel],
-                   vvfBuf[nChannel]);
+        m_vvscActiveChConverters[INPUT][nChannel].ToFloat(
+                   m_rgabiBufferInfos[nChannel].buffers[nDoubleBufferIndex],
+                   &vvfBuf[nChannel][0],
+                   vvfBuf[nChannel].size());
     }
 }
 
@@ -2678,9 +2710,10 @@ void CAsio::ConvertFloatToOutputs(long nDoubleBufferIndex,
                                    this,
                                    vvfBuf[nChannel].size());
         }
-        Float2Asio(vvfBuf[nChannel],
+        m_vvscActiveChConverters[OUTPUT][nChannel].FromFloat(
+                   &vvfBuf[nChannel][0],
                    m_rgabiBufferInfos[nChannel + m_nActiveChannelsIn].buffers[nDoubleBufferIndex],
-                   m_vviActiveChDataTypes[OUTPUT][nChannel]);
+                   vvfBuf[nChannel].size());
     }
     if (m_bPostOutput)
     {
@@ -2760,218 +2793,65 @@ CAsio::ResizeBitVector(const std::vector<bool> & vbIn, size_t nSize)
     return vbOut;
 }
 
-#define COPY_BYTESWAP(pchDest, pchSrc, nBytes) \
-    do \
-    { \
-        for (nByte = 0; nByte < (nBytes); ++nByte) \
-        { \
-           *((pchDest) - nByte) = *((pchSrc) + nByte); \
-        } \
-    } while(0)
-#define COPY_BYTESWAP_SIMPLE(nBytes) \
-    COPY_BYTESWAP(&uValue.rgch[3], &pchSrc[nFrame*(nBytes)], (nBytes))
-
-union UTypes {
-    __int32 i;
-    int64_t l;
-    signed char rgch[8];
-    float f;
-    double d;
-};
+Asio::SampleConverter CAsio::CreateSampleConverter(long iDataType)
+{
+    switch (ASIOSampleType(iDataType)) {
+    case ASIOSTInt16MSB:
+        return SampleConverter(SF_INT16, true);
+    case ASIOSTInt24MSB:
+        return SampleConverter(SF_INT24, true);
+    case ASIOSTInt32MSB:
+        return SampleConverter(SF_INT32, true);
+    case ASIOSTInt32MSB16:
+        return SampleConverter(SF_INT32, true, 16);
+    case ASIOSTInt32MSB18:
+        return SampleConverter(SF_INT32, true, 18);
+    case ASIOSTInt32MSB20:
+        return SampleConverter(SF_INT32, true, 20);
+    case ASIOSTInt32MSB24:
+        return SampleConverter(SF_INT32, true, 24);
+    case ASIOSTFloat32MSB:
+        return SampleConverter(SF_FLOAT32, true);
+    case ASIOSTFloat64MSB:
+        return SampleConverter(SF_FLOAT64, true);
+    case ASIOSTInt16LSB:
+        return SampleConverter(SF_INT16, false);
+    case ASIOSTInt24LSB:
+        return SampleConverter(SF_INT24, false);
+    case ASIOSTInt32LSB:
+        return SampleConverter(SF_INT32, false);
+    case ASIOSTInt32LSB16:
+        return SampleConverter(SF_INT32, false, 16);
+    case ASIOSTInt32LSB18:
+        return SampleConverter(SF_INT32, false, 18);
+    case ASIOSTInt32LSB20:
+        return SampleConverter(SF_INT32, false, 20);
+    case ASIOSTInt32LSB24:
+        return SampleConverter(SF_INT32, false, 24);
+    case ASIOSTFloat32LSB:
+        return SampleConverter(SF_FLOAT32, false);
+    case ASIOSTFloat64LSB:
+        return SampleConverter(SF_FLOAT64, false);
+    default:
+        return SampleConverter();
+    }
+}
 
 void CAsio::Asio2Float(const void * pvSrc, long iDataType,
                        std::valarray<float> & vfDest)
 {
-    const float fIntAmplitude = 2147483648.0f;
-    const signed char * const pchSrc = static_cast<const signed char *>(pvSrc);
-    unsigned nFrame;
-    unsigned nByte;
-    union UTypes uValue;
-    for (nFrame = 0; nFrame < vfDest.size(); ++nFrame)
-    {
-        uValue.l = 0;
-        switch(ASIOSampleType(iDataType)) {
-        case ASIOSTInt16MSB: // Big Endian signed 16 Bits
-            COPY_BYTESWAP_SIMPLE(2);
-            break;
-        case ASIOSTInt24MSB: // Big Endian packed 24 Bits
-            COPY_BYTESWAP_SIMPLE(3);
-            break;
-        case ASIOSTInt32MSB: // Big Endian 32 Bits
-            COPY_BYTESWAP_SIMPLE(4);
-            break;
-        case ASIOSTInt32MSB16: // only least 16 Bits carry value
-            COPY_BYTESWAP(&uValue.rgch[3], &pchSrc[nFrame*4+2], 2);
-            break;
-        case ASIOSTInt32MSB18: // only least 18 Bits carry value
-            COPY_BYTESWAP(&uValue.rgch[3], &pchSrc[nFrame*4+1], 3);
-            uValue.i <<= 6;
-            break;
-        case ASIOSTInt32MSB20: // only least 20 Bits carry value
-            COPY_BYTESWAP(&uValue.rgch[3], &pchSrc[nFrame*4+1], 3);
-            uValue.i <<= 4;
-            break;
-        case ASIOSTInt32MSB24: // only least 24 Bits carry value
-            COPY_BYTESWAP(&uValue.rgch[3], &pchSrc[nFrame*4+1], 3);
-            break;
-        case ASIOSTInt16LSB: // Big Endian signed 16 Bits
-            uValue.i = static_cast<const __int16 *>(pvSrc)[nFrame];
-            uValue.i <<= 16;
-            break;
-        case ASIOSTInt24LSB: // Big Endian packed 24 Bits
-            uValue.rgch[1] = pchSrc[nFrame*3];
-            uValue.rgch[2] = pchSrc[nFrame*3+1];
-            uValue.rgch[3] = pchSrc[nFrame*3+2];
-            break;
-        case ASIOSTInt32LSB: // Little Endian 32 Bits
-            uValue.i = static_cast<const __int32 *>(pvSrc)[nFrame];
-            break;
-        case ASIOSTInt32LSB16: // only least 16 Bits carry value
-            uValue.i = static_cast<const __int32 *>(pvSrc)[nFrame];
-            uValue.i <<= 16;
-            break;
-        case ASIOSTInt32LSB18: // only least 18 Bits carry value
-            uValue.i = static_cast<const __int32 *>(pvSrc)[nFrame];
-            uValue.i <<= 14;
-            break;
-        case ASIOSTInt32LSB20: // only least 20 Bits carry value
-            uValue.i = static_cast<const __int32 *>(pvSrc)[nFrame];
-            uValue.i <<= 12;
-            break;
-        case ASIOSTInt32LSB24: // only least 24 Bits carry value
-            uValue.i = static_cast<const __int32 *>(pvSrc)[nFrame];
-            uValue.i <<= 8;
-            break;
-        case ASIOSTFloat32LSB:
-            vfDest[nFrame] = static_cast<const float *>(pvSrc)[nFrame];
-            continue;
-        case ASIOSTFloat64LSB:
-            vfDest[nFrame] = (float)static_cast<const double *>(pvSrc)[nFrame];
-            continue;
-        case ASIOSTFloat32MSB:
-            COPY_BYTESWAP_SIMPLE(4);
-            vfDest[nFrame] = uValue.f;
-            continue;
-        case ASIOSTFloat64MSB:
-            COPY_BYTESWAP(&uValue.rgch[7], &pchSrc[nFrame*8], 8);
-            vfDest[nFrame] = (float)uValue.d;
-            continue;
-        default:
-            vfDest[nFrame] = 0;
-            continue;
-        }
-        vfDest[nFrame] = uValue.i / fIntAmplitude;
+    if (vfDest.size())
+    {
+        CreateSampleConverter(iDataType).ToFloat(pvSrc, &vfDest[0], vfDest.size());
     }
 }
 
 void CAsio::Float2Asio(const std::valarray<float> & vfSrc,
                        void * pvDest, long iDataType)
 {
-    const float fIntAmplitude = float(1u<<31);
-    const float fIntMin = -fIntAmplitude;
-    const float fIntMax =
-        fIntAmplitude * (1 - std::numeric_limits<float>::epsilon());
-
-    signed char * const pchDest = static_cast<signed char *>(pvDest);
-    unsigned nFrame;
-    unsigned nByte;
-    union UTypes uValue;
-    float fValue;
-    for (nFrame = 0; nFrame < vfSrc.size(); ++nFrame)
-    {
-        uValue.l = 0;
-        switch (iDataType) {
-        case ASIOSTFloat32LSB:
-        case ASIOSTFloat64LSB:
-        case ASIOSTFloat32MSB:
-        case ASIOSTFloat64MSB:
-            fValue = vfSrc[nFrame];
-            if (fValue < -1.0f)
-            {
-                fValue = -1.0f;
-            }
-            else if (fValue > 1.0f)
-            {
-                fValue = 1.0f;
-            }
-            break;
-        default:
-            fValue = vfSrc[nFrame] * fIntAmplitude;
-            if (fValue < fIntMin)
-            {
-                fValue = fIntMin;
-            }
-            else if (fValue > fIntMax)
-            {
-                fValue = fIntMax;
-            }
-            uValue.i = static_cast<int>(fValue);
-        }
-       // switch off clang warning: fallthrough by purpose
-       #pragma clang diagnostic push
-       #pragma clang diagnostic ignored "-Wimplicit-fallthrough"
-        switch(iDataType) {
-        case ASIOSTInt16MSB: // Big Endian signed 16 Bits
-            COPY_BYTESWAP(&pchDest[nFrame*2+1], &uValue.rgch[2], 2);
-            break;
-        case ASIOSTInt24MSB: // Big Endian packed 24 Bits
-            COPY_BYTESWAP(&pchDest[nFrame*3+2], &uValue.rgch[1], 3);
-            break;
-        case ASIOSTInt32MSB16: // only least 16 Bits carry value
-            uValue.i >>= 2;
-            // FALL THROUGH
-        case ASIOSTInt32MSB18: // only least 18 Bits carry value
-            uValue.i >>= 2;
-            // FALL THROUGH
-        case ASIOSTInt32MSB20: // only least 20 Bits carry value
-            uValue.i >>= 4;
-            // FALL THROUGH
-        case ASIOSTInt32MSB24: // only least 24 Bits carry value
-            uValue.i >>= 8;
-        case ASIOSTInt32MSB: // Big Endian 32 Bits
-            COPY_BYTESWAP(&pchDest[nFrame*4+3], &uValue.rgch[0], 4);
-            break;
-        case ASIOSTInt16LSB: // Big Endian signed 16 Bits
-            static_cast<__int16 *>(pvDest)[nFrame] =
-                static_cast<__int16>(uValue.i >> 16);
-            break;
-        case ASIOSTInt24LSB: // Big Endian packed 24 Bits
-            pchDest[nFrame*3]   = uValue.rgch[1];
-
-            pchDest[nFrame*3+1] = uValue.rgch[2];
-            pchDest[nFrame*3+2] = uValue.rgch[3];
-            break;
-        case ASIOSTInt32LSB: // Big Endian 32 Bits
-            static_cast<__int32 *>(pvDest)[nFrame] = uValue.i;
-            break;
-        case ASIOSTInt32LSB16: // only least 16 Bits carry value
-            static_cast<__int32 *>(pvDest)[nFrame] = uValue.i >> 16;
-            break;
-        case ASIOSTInt32LSB18: // only least 18 Bits carry value
-            static_cast<__int32 *>(pvDest)[nFrame] = uValue.i >> 14;
-            break;
-        case ASIOSTInt32LSB20: // only least 20 Bits carry value
-            static_cast<__int32 *>(pvDest)[nFrame] = uValue.i >> 12;
-            break;
-        case ASIOSTInt32LSB24: // only least 24 Bits carry value
-            static_cast<__int32 *>(pvDest)[nFrame] = uValue.i >> 8;
-            break;
-        case ASIOSTFloat32LSB:
-            static_cast<float *>(pvDest)[nFrame] = fValue;
-            break;
-        case ASIOSTFloat64LSB:
-            static_cast<double *>(pvDest)[nFrame] = (double)fValue;
-            break;
-        case ASIOSTFloat32MSB:
-            uValue.f = fValue;
-            COPY_BYTESWAP(&pchDest[nFrame*4+3], &uValue.rgch[0], 4);
-            break;
-        case ASIOSTFloat64MSB:
-            uValue.d = (double)fValue;
-            COPY_BYTESWAP(&pchDest[nFrame*8+7], &uValue.rgch[0], 8);
-            break;
-        }
-       #pragma clang diagnostic pop
+    if (vfSrc.size())
+    {
+        CreateSampleConverter(iDataType).FromFloat(&vfSrc[0], pvDest, vfSrc.size());
     }
 }
 float CAsio::MaxFloatSample(long iDataType)
@@ -36,6 +36,8 @@
 
 #include "casioEnums.h"
 #include "casioExceptions.h"
+#include "casioConvert.h"
+#include "PerformanceCounter.h"
 
 struct ASIODriverInfo;
 struct ASIOBufferInfo;
@@ -1516,6 +1518,14 @@ namespace Asio
         /// Retrieve the current SoundDataExchanger, or NULL if there is none.
         SoundDataExchanger * GetSoundDataExchanger();
 
+        /// Optional performance counter (set by derived classes) measuring
+        /// the time spent in each bufferSwitch callback of the driver.
+        CPerformanceCounter * m_ppcCallback;
+
+        /// Optional performance counter (set by derived classes) measuring
+        /// the time the processing thread waits for buffers in #WaitForProc.
+        CPerformanceCounter * m_ppcProcWait;
+
      private:
         /// Driver should call this method when the sample rate changes.
         /// (Some don't.)
@@ -1566,6 +1576,13 @@ namespace Asio
         static void Float2Asio(const std::valarray<float> & vfSrc,
                                void * pvDest, long iDataType);
 
+        /// Creates the converter between float and an ASIO sample type.
+        /// \param iDataType
+        ///     The ASIO sample type of a channel.
+        /// \return Converter with block kernels for the sample type (converts
+        ///     to silence and writes nothing for unknown sample types).
+        static SampleConverter CreateSampleConverter(long iDataType);
+
         /// The maximum possible floating-point sample value if the underlying
         /// Asio data type has the given type code
         /// \param iDataType
@@ -1818,6 +1835,14 @@ namespace Asio
         /// Stored: The Asio channel's data type code
         std::vector<std::vector<long> > m_vviActiveChDataTypes;
 
+        /// The sample converters of prepared Asio channels, created from
+        /// the data types once when preparing the buffers.
+        /// First index: INPUT or OUTPUT (defined as values of enum data type
+        /// Asio::Direction in casioEnums.h).
+        /// Second index: nth prepared channel for that direction
+        /// Stored: The converter between float and the channel's data type
+        std::vector<std::vector<SampleConverter> > m_vvscActiveChConverters;
+
         /// The maximum sample values for the data types of the prepared
         /// asio channels.
         /// First index: INPUT or OUTPUT (defined as values of enum data type
@@ -0,0 +1,934 @@
+//------------------------------------------------------------------------------
+/// \file casioConvert.cpp
+/// \author Berg
+/// \brief Implementation of class SampleConverter used by class CAsio
+///
+/// Project SoundMexPro
+/// Module SoundDllPro
+///
+/// Implementation of class SampleConverter: block conversion kernels between
+/// the sample formats of ASIO drivers and float.
+///
+/// ****************************************************************************
+/// Copyright 2023 Daniel Berg, Oldenburg, Germany
+/// ****************************************************************************
+///
+/// This file is part of SoundMexPro.
+///
+///    SoundMexPro is free software: you can redistribute it and/or modify
+///    it under the terms of the GNU General Public License as published by
+///    the Free Software Foundation, either version 3 of the License, or
+///    (at your option) any later version.
+///
+///    SoundMexPro is distributed in the hope that it will be useful,
+///    but WITHOUT ANY WARRANTY; without even the implied warranty of
+///    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+///    GNU General Public License for more details.
+///
+///    You should have received a copy of the GNU General Public License
+///    along with SoundMexPro.  If not, see <http:///www.gnu.org/licenses/>.
+///
+//------------------------------------------------------------------------------
+
+#include "casioConvert.h"
+
+#include <stdint.h>
+#include <string.h>
+#include <float.h>
+
+// SSE2 is always available on x64 and used on x86 if enabled for compiler
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+    #define SC_SSE2
+    #include <emmintrin.h>
+#endif
+// AVX2 kernels are compiled with target attribute and selected at runtime
+#if defined(SC_SSE2) && (defined(__clang__) || defined(__GNUC__)) && (defined(__x86_64__) || defined(__i386__))
+    #define SC_AVX2
+    #include <immintrin.h>
+    #include <cpuid.h>
+    #define SC_TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+
+using namespace Asio;
+
+/// scale of integer samples shifted to most significant bits
+static const float c_fScaleToFloat  = 1.0f / 2147483648.0f;
+static const float c_fIntAmplitude  = 2147483648.0f;
+static const float c_fIntMin        = -c_fIntAmplitude;
+static const float c_fIntMax        = c_fIntAmplitude * (1 - FLT_EPSILON);
+
+//------------------------------------------------------------------------------
+// scalar helpers
+//------------------------------------------------------------------------------
+static inline uint16_t Swap16(uint16_t n)
+{
+    return (uint16_t)((n >> 8) | (n << 8));
+}
+
+static inline uint32_t Swap32(uint32_t n)
+{
+    return (n >> 24) | ((n >> 8) & 0xFF00u) | ((n << 8) & 0xFF0000u) | (n << 24);
+}
+
+static inline uint64_t Swap64(uint64_t n)
+{
+    return ((uint64_t)Swap32((uint32_t)n) << 32) | Swap32((uint32_t)(n >> 32));
+}
+
+/// scales float sample to 32 bit integer range and clips it
+static inline int32_t FloatToInt(float fValue)
+{
+    fValue *= c_fIntAmplitude;
+    if (fValue < c_fIntMin)
+        fValue = c_fIntMin;
+    else if (fValue > c_fIntMax)
+        fValue = c_fIntMax;
+    return static_cast<int32_t>(fValue);
+}
+
+/// clips float sample to [-1:1]
+static inline float ClipFloat(float fValue)
+{
+    if (fValue < -1.0f)
+        return -1.0f;
+    if (fValue > 1.0f)
+        return 1.0f;
+    return fValue;
+}
+
+//------------------------------------------------------------------------------
+// scalar kernels: driver format to float
+//------------------------------------------------------------------------------
+static void NoneToFloat(const void *, float * pfDest, size_t nFrames, unsigned int)
+{
+    memset(pfDest, 0, nFrames * sizeof(float));
+}
+
+static void Int16LsbToFloat(const void * pvSrc, float * pfDest, size_t nFrames, unsigned int)
+{
+    const int16_t * pn = static_cast<const int16_t *>(pvSrc);
+    for (size_t nFrame = 0; nFrame < nFrames; ++nFrame)
+        pfDest[nFrame] = (float)(int32_t)((uint32_t)(int32_t)pn[nFrame] << 16) * c_fScaleToFloat;
+}
+
+static void Int16MsbToFloat(const void * pvSrc, float * pfDest, size_t nFrames, unsigned int)
+{
+    const uint16_t * pn = static_cast<const uint16_t *>(pvSrc);
+    for (size_t nFrame = 0; nFrame < nFrames; ++nFrame)
+        pfDest[nFrame] = (float)(int32_t)((uint32_t)Swap16(pn[nFrame]) << 16) * c_fScaleToFloat;
+}
+
+static void Int24LsbToFloat(const void * pvSrc, float * pfDest, size_t nFrames, unsigned int)
+{
+    const uint8_t * pb = static_cast<const uint8_t *>(pvSrc);
+    for (size_t nFrame = 0; nFrame < nFrames; ++nFrame, pb += 3)
+        pfDest[nFrame] = (float)(int32_t)(((uint32_t)pb[0] << 8) | ((uint32_t)pb[1] << 16) | ((uint32_t)pb[2] << 24)) * c_fScaleToFloat;
+}
+
+static void Int24MsbToFloat(const void * pvSrc, float * pfDest, size_t nFrames, unsigned int)
+{
+    const uint8_t * pb = static_cast<const uint8_t *>(pvSrc);
+    for (size_t nFrame = 0; nFrame < nFrames; ++nFrame, pb += 3)
+        pfDest[nFrame] = (float)(int32_t)(((uint32_t)pb[2] << 8) | ((uint32_t)pb[1] << 16) | ((uint32_t)pb[0] << 24)) * c_fScaleToFloat;
+}
+
+static void Int32LsbToFloat(const void * pvSrc, float * pfDest, size_t nFrames, unsigned int nShift)
+{
+    const uint32_t * pn = static_cast<const uint32_t *>(pvSrc);
+    for (size_t nFrame = 0; nFrame < nFrames; ++nFrame)
+        pfDest[nFrame] = (float)(int32_t)(pn[nFrame] << nShift) * c_fScaleToFloat;
+}
+
+static void Int32MsbToFloat(const void * pvSrc, float * pfDest, size_t nFrames, unsigned int nShift)
+{
+    const uint32_t * pn = static_cast<const uint32_t *>(pvSrc);
+    for (size_t nFrame = 0; nFrame < nFrames; ++nFrame)
+        pfDest[nFrame] = (float)(int32_t)(Swap32(pn[nFrame]) << nShift) * c_fScaleToFloat;
+}
+
+static void Float32LsbToFloat(const void * pvSrc, float * pfDest, size_t nFrames, unsigned int)
+{
+    memcpy(pfDest, pvSrc, nFrames * sizeof(float));
+}
+
+static void Float32MsbToFloat(const void * pvSrc, float * pfDest, size_t nFrames, unsigned int)
+{
+    const uint32_t * pn = static_cast<const uint32_t *>(pvSrc);
+    for (size_t nFrame = 0; nFrame < nFrames; ++nFrame)
+    {
+        uint32_t n = Swap32(pn[nFrame]);
+        memcpy(&pfDest[nFrame], &n, sizeof(float));
+    }
+}
+
+static void Float64LsbToFloat(const void * pvSrc, float * pfDest, size_t nFrames, unsigned int)
+{
+    const double * pd = static_cast<const double *>(pvSrc);
+    for (size_t nFrame = 0; nFrame < nFrames; ++nFrame)
+        pfDest[nFrame] = (float)pd[nFrame];
+}
+
+static void Float64MsbToFloat(const void * pvSrc, float * pfDest, size_t nFrames, unsigned int)
+{
+    const uint64_t * pn = static_cast<const uint64_t *>(pvSrc);
+    for (size_t nFrame = 0; nFrame < nFrames; ++nFrame)
+    {
+        uint64_t n = Swap64(pn[nFrame]);
+        double d;
+        memcpy(&d, &n, sizeof(double));
+        pfDest[nFrame] = (float)d;
+    }
+}
+
+//------------------------------------------------------------------------------
+// scalar kernels: float to driver format
+//------------------------------------------------------------------------------
+static void FloatToNone(const float *, void *, size_t, unsigned int)
+{
+}
+
+static void FloatToInt16Lsb(const float * pfSrc, void * pvDest, size_t nFrames, unsigned int)
+{
+    int16_t * pn = static_cast<int16_t *>(pvDest);
+    for (size_t nFrame = 0; nFrame < nFrames; ++nFrame)
+        pn[nFrame] = (int16_t)(FloatToInt(pfSrc[nFrame]) >> 16);
+}
+
+static void FloatToInt16Msb(const float * pfSrc, void * pvDest, size_t nFrames, unsigned int)
+{
+    uint16_t * pn = static_cast<uint16_t *>(pvDest);
+    for (size_t nFrame = 0; nFrame < nFrames; ++nFrame)
+        pn[nFrame] = Swap16((uint16_t)(FloatToInt(pfSrc[nFrame]) >> 16));
+}
+
+static void FloatToInt24Lsb(const float * pfSrc, void * pvDest, size_t nFrames, unsigned int)
+{
+    uint8_t * pb = static_cast<uint8_t *>(pvDest);
+    for (size_t nFrame = 0; nFrame < nFrames; ++nFrame, pb += 3)
+    {
+        uint32_t n = (uint32_t)FloatToInt(pfSrc[nFrame]);
+        pb[0] = (uint8_t)(n >> 8);
+        pb[1] = (uint8_t)(n >> 16);
+        pb[2] = (uint8_t)(n >> 24);
+    }
+}
+
+static void FloatToInt24Msb(const float * pfSrc, void * pvDest, size_t nFrames, unsigned int)
+{
+    uint8_t * pb = static_cast<uint8_t *>(pvDest);
+    for (size_t nFrame = 0; nFrame < nFrames; ++nFrame, pb += 3)
+    {
+        uint32_t n = (uint32_t)FloatToInt(pfSrc[nFrame]);
+        pb[0] = (uint8_t)(n >> 24);
+        pb[1] = (uint8_t)(n >> 16);
+        pb[2] = (uint8_t)(n >> 8);
+    }
+}
+
+static void FloatToInt32Lsb(const float * pfSrc, void * pvDest, size_t nFrames, unsigned int nShift)
+{
+    int32_t * pn = static_cast<int32_t *>(pvDest);
+    for (size_t nFrame = 0; nFrame < nFrames; ++nFrame)
+        pn[nFrame] = FloatToInt(pfSrc[nFrame]) >> nShift;
+}
+
+static void FloatToInt32Msb(const float * pfSrc, void * pvDest, size_t nFrames, unsigned int nShift)
+{
+    uint32_t * pn = static_cast<uint32_t *>(pvDest);
+    for (size_t nFrame = 0; nFrame < nFrames; ++nFrame)
+        pn[nFrame] = Swap32((uint32_t)(FloatToInt(pfSrc[nFrame]) >> nShift));
+}
+
+static void FloatToFloat32Lsb(const float * pfSrc, void * pvDest, size_t nFrames, unsigned int)
+{
+    float * pf = static_cast<float *>(pvDest);
+    for (size_t nFrame = 0; nFrame < nFrames; ++nFrame)
+        pf[nFrame] = ClipFloat(pfSrc[nFrame]);
+}
+
+static void FloatToFloat32Msb(const float * pfSrc, void * pvDest, size_t nFrames, unsigned int)
+{
+    uint32_t * pn = static_cast<uint32_t *>(pvDest);
+    for (size_t nFrame = 0; nFrame < nFrames; ++nFrame)
+    {
+        float f = ClipFloat(pfSrc[nFrame]);
+        uint32_t n;
+        memcpy(&n, &f, sizeof(float));
+        pn[nFrame] = Swap32(n);
+    }
+}
+
+static void FloatToFloat64Lsb(const float * pfSrc, void * pvDest, size_t nFrames, unsigned int)
+{
+    double * pd = static_cast<double *>(pvDest);
+    for (size_t nFrame = 0; nFrame < nFrames; ++nFrame)
+        pd[nFrame] = (double)ClipFloat(pfSrc[nFrame]);
+}
+
+static void FloatToFloat64Msb(const float * pfSrc, void * pvDest, size_t nFrames, unsigned int)
+{
+    uint64_t * pn = static_cast<uint64_t *>(pvDest);
+    for (size_t nFrame = 0; nFrame < nFrames; ++nFrame)
+    {
+        double d = (double)ClipFloat(pfSrc[nFrame]);
+        uint64_t n;
+        memcpy(&n, &d, sizeof(double));
+        pn[nFrame] = Swap64(n);
+    }
+}
+
+#ifdef SC_SSE2
+//------------------------------------------------------------------------------
+// SSE2 helpers. NOTE: operand order of min/max is chosen to pass NaN like
+// the scalar comparisons do
+//------------------------------------------------------------------------------
+static inline __m128i Swap16_SSE2(__m128i v)
+{
+    return _mm_or_si128(_mm_slli_epi16(v, 8), _mm_srli_epi16(v, 8));
+}
+
+static inline __m128i Swap32_SSE2(__m128i v)
+{
+    v = Swap16_SSE2(v);
+    v = _mm_shufflelo_epi16(v, 0xB1);
+    return _mm_shufflehi_epi16(v, 0xB1);
+}
+
+static inline __m128 IntToFloat_SSE2(__m128i v)
+{
+    return _mm_mul_ps(_mm_cvtepi32_ps(v), _mm_set1_ps(c_fScaleToFloat));
+}
+
+static inline __m128i FloatToInt_SSE2(__m128 v)
+{
+    v = _mm_mul_ps(v, _mm_set1_ps(c_fIntAmplitude));
+    v = _mm_max_ps(_mm_set1_ps(c_fIntMin), v);
+    v = _mm_min_ps(_mm_set1_ps(c_fIntMax), v);
+    return _mm_cvttps_epi32(v);
+}
+
+static inline __m128 ClipFloat_SSE2(__m128 v)
+{
+    v = _mm_max_ps(_mm_set1_ps(-1.0f), v);
+    return _mm_min_ps(_mm_set1_ps(1.0f), v);
+}
+
+//------------------------------------------------------------------------------
+// SSE2 kernels: driver format to float
+//------------------------------------------------------------------------------
+static void Int16LsbToFloat_SSE2(const void * pvSrc, float * pfDest, size_t nFrames, unsigned int nShift)
+{
+    const int16_t * pn = static_cast<const int16_t *>(pvSrc);
+    const __m128i vZero = _mm_setzero_si128();
+    size_t nFrame = 0;
+    for (; nFrame + 8 <= nFrames; nFrame += 8)
+    {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(pn + nFrame));
+        _mm_storeu_ps(pfDest + nFrame,     IntToFloat_SSE2(_mm_unpacklo_epi16(vZero, v)));
+        _mm_storeu_ps(pfDest + nFrame + 4, IntToFloat_SSE2(_mm_unpackhi_epi16(vZero, v)));
+    }
+    Int16LsbToFloat(pn + nFrame, pfDest + nFrame, nFrames - nFrame, nShift);
+}
+
+static void Int16MsbToFloat_SSE2(const void * pvSrc, float * pfDest, size_t nFrames, unsigned int nShift)
+{
+    const int16_t * pn = static_cast<const int16_t *>(pvSrc);
+    const __m128i vZero = _mm_setzero_si128();
+    size_t nFrame = 0;
+    for (; nFrame + 8 <= nFrames; nFrame += 8)
+    {
+        __m128i v = Swap16_SSE2(_mm_loadu_si128(reinterpret_cast<const __m128i *>(pn + nFrame)));
+        _mm_storeu_ps(pfDest + nFrame,     IntToFloat_SSE2(_mm_unpacklo_epi16(vZero, v)));
+        _mm_storeu_ps(pfDest + nFrame + 4, IntToFloat_SSE2(_mm_unpackhi_epi16(vZero, v)));
+    }
+    Int16MsbToFloat(pn + nFrame, pfDest + nFrame, nFrames - nFrame, nShift);
+}
+
+static void Int32LsbToFloat_SSE2(const void * pvSrc, float * pfDest, size_t nFrames, unsigned int nShift)
+{
+    const int32_t * pn = static_cast<const int32_t *>(pvSrc);
+    const __m128i vShift = _mm_cvtsi32_si128((int)nShift);
+    size_t nFrame = 0;
+    for (; nFrame + 4 <= nFrames; nFrame += 4)
+    {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(pn + nFrame));
+        _mm_storeu_ps(pfDest + nFrame, IntToFloat_SSE2(_mm_sll_epi32(v, vShift)));
+    }
+    Int32LsbToFloat(pn + nFrame, pfDest + nFrame, nFrames - nFrame, nShift);
+}
+
+static void Int32MsbToFloat_SSE2(const void * pvSrc, float * pfDest, size_t nFrames, unsigned int nShift)
+{
+    const int32_t * pn = static_cast<const int32_t *>(pvSrc);
+    const __m128i vShift = _mm_cvtsi32_si128((int)nShift);
+    size_t nFrame = 0;
+    for (; nFrame + 4 <= nFrames; nFrame += 4)
+    {
+        __m128i v = Swap32_SSE2(_mm_loadu_si128(reinterpret_cast<const __m128i *>(pn + nFrame)));
+        _mm_storeu_ps(pfDest + nFrame, IntToFloat_SSE2(_mm_sll_epi32(v, vShift)));
+    }
+    Int32MsbToFloat(pn + nFrame, pfDest + nFrame, nFrames - nFrame, nShift);
+}
+
+static void Float32MsbToFloat_SSE2(const void * pvSrc, float * pfDest, size_t nFrames, unsigned int nShift)
+{
+    const int32_t * pn = static_cast<const int32_t *>(pvSrc);
+    size_t nFrame = 0;
+    for (; nFrame + 4 <= nFrames; nFrame += 4)
+    {
+        __m128i v = Swap32_SSE2(_mm_loadu_si128(reinterpret_cast<const __m128i *>(pn + nFrame)));
+        _mm_storeu_ps(pfDest + nFrame, _mm_castsi128_ps(v));
+    }
+    Float32MsbToFloat(pn + nFrame, pfDest + nFrame, nFrames - nFrame, nShift);
+}
+
+static void Float64LsbToFloat_SSE2(const void * pvSrc, float * pfDest, size_t nFrames, unsigned int nShift)
+{
+    const double * pd = static_cast<const double *>(pvSrc);
+    size_t nFrame = 0;
+    for (; nFrame + 4 <= nFrames; nFrame += 4)
+    {
+        __m128 vLo = _mm_cvtpd_ps(_mm_loadu_pd(pd + nFrame));
+        __m128 vHi = _mm_cvtpd_ps(_mm_loadu_pd(pd + nFrame + 2));
+        _mm_storeu_ps(pfDest + nFrame, _mm_movelh_ps(vLo, vHi));
+    }
+    Float64LsbToFloat(pd + nFrame, pfDest + nFrame, nFrames - nFrame, nShift);
+}
+
+//------------------------------------------------------------------------------
+// SSE2 kernels: float to driver format
+//------------------------------------------------------------------------------
+static void FloatToInt16Lsb_SSE2(const float * pfSrc, void * pvDest, size_t nFrames, unsigned int nShift)
+{
+    int16_t * pn = static_cast<int16_t *>(pvDest);
+    size_t nFrame = 0;
+    for (; nFrame + 8 <= nFrames; nFrame += 8)
+    {
+        __m128i vLo = _mm_srai_epi32(FloatToInt_SSE2(_mm_loadu_ps(pfSrc + nFrame)), 16);
+        __m128i vHi = _mm_srai_epi32(FloatToInt_SSE2(_mm_loadu_ps(pfSrc + nFrame + 4)), 16);
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(pn + nFrame), _mm_packs_epi32(vLo, vHi));
+    }
+    FloatToInt16Lsb(pfSrc + nFrame, pn + nFrame, nFrames - nFrame, nShift);
+}
+
+static void FloatToInt16Msb_SSE2(const float * pfSrc, void * pvDest, size_t nFrames, unsigned int nShift)
+{
+    int16_t * pn = static_cast<int16_t *>(pvDest);
+    size_t nFrame = 0;
+    for (; nFrame + 8 <= nFrames; nFrame += 8)
+    {
+        __m128i vLo = _mm_srai_epi32(FloatToInt_SSE2(_mm_loadu_ps(pfSrc + nFrame)), 16);
+        __m128i vHi = _mm_srai_epi32(FloatToInt_SSE2(_mm_loadu_ps(pfSrc + nFrame + 4)), 16);
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(pn + nFrame), Swap16_SSE2(_mm_packs_epi32(vLo, vHi)));
+    }
+    FloatToInt16Msb(pfSrc + nFrame, pn + nFrame, nFrames - nFrame, nShift);
+}
+
+static void FloatToInt32Lsb_SSE2(const float * pfSrc, void * pvDest, size_t nFrames, unsigned int nShift)
+{
+    int32_t * pn = static_cast<int32_t *>(pvDest);
+    const __m128i vShift = _mm_cvtsi32_si128((int)nShift);
+    size_t nFrame = 0;
+    for (; nFrame + 4 <= nFrames; nFrame += 4)
+    {
+        __m128i v = _mm_sra_epi32(FloatToInt_SSE2(_mm_loadu_ps(pfSrc + nFrame)), vShift);
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(pn + nFrame), v);
+    }
+    FloatToInt32Lsb(pfSrc + nFrame, pn + nFrame, nFrames - nFrame, nShift);
+}
+
+static void FloatToInt32Msb_SSE2(const float * pfSrc, void * pvDest, size_t nFrames, unsigned int nShift)
+{
+    int32_t * pn = static_cast<int32_t *>(pvDest);
+    const __m128i vShift = _mm_cvtsi32_si128((int)nShift);
+    size_t nFrame = 0;
+    for (; nFrame + 4 <= nFrames; nFrame += 4)
+    {
+        __m128i v = _mm_sra_epi32(FloatToInt_SSE2(_mm_loadu_ps(pfSrc + nFrame)), vShift);
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(pn + nFrame), Swap32_SSE2(v));
+    }
+    FloatToInt32Msb(pfSrc + nFrame, pn + nFrame, nFrames - nFrame, nShift);
+}
+
+static void FloatToFloat32Lsb_SSE2(const float * pfSrc, void * pvDest, size_t nFrames, unsigned int nShift)
+{
+    float * pf = static_cast<float *>(pvDest);
+    size_t nFrame = 0;
+    for (; nFrame + 4 <= nFrames; nFrame += 4)
+        _mm_storeu_ps(pf + nFrame, ClipFloat_SSE2(_mm_loadu_ps(pfSrc + nFrame)));
+    FloatToFloat32Lsb(pfSrc + nFrame, pf + nFrame, nFrames - nFrame, nShift);
+}
+
+static void FloatToFloat32Msb_SSE2(const float * pfSrc, void * pvDest, size_t nFrames, unsigned int nShift)
+{
+    float * pf = static_cast<float *>(pvDest);
+    size_t nFrame = 0;
+    for (; nFrame + 4 <= nFrames; nFrame += 4)
+    {
+        __m128i v = _mm_castps_si128(ClipFloat_SSE2(_mm_loadu_ps(pfSrc + nFrame)));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(pf + nFrame), Swap32_SSE2(v));
+    }
+    FloatToFloat32Msb(pfSrc + nFrame, pf + nFrame, nFrames - nFrame, nShift);
+}
+
+static void FloatToFloat64Lsb_SSE2(const float * pfSrc, void * pvDest, size_t nFrames, unsigned int nShift)
+{
+    double * pd = static_cast<double *>(pvDest);
+    size_t nFrame = 0;
+    for (; nFrame + 4 <= nFrames; nFrame += 4)
+    {
+        __m128 v = ClipFloat_SSE2(_mm_loadu_ps(pfSrc + nFrame));
+        _mm_storeu_pd(pd + nFrame,     _mm_cvtps_pd(v));
+        _mm_storeu_pd(pd + nFrame + 2, _mm_cvtps_pd(_mm_movehl_ps(v, v)));
+    }
+    FloatToFloat64Lsb(pfSrc + nFrame, pd + nFrame, nFrames - nFrame, nShift);
+}
+#endif // SC_SSE2
+
+#ifdef SC_AVX2
+//------------------------------------------------------------------------------
+// AVX2 helpers
+//------------------------------------------------------------------------------
+/// shuffle mask swapping bytes of 16 bit values within each 128 bit lane
+#define SC_SWAP16_MASK  _mm256_setr_epi8(1,0,3,2,5,4,7,6,9,8,11,10,13,12,15,14, \
+                                         1,0,3,2,5,4,7,6,9,8,11,10,13,12,15,14)
+/// shuffle mask swapping bytes of 32 bit values within each 128 bit lane
+#define SC_SWAP32_MASK  _mm256_setr_epi8(3,2,1,0,7,6,5,4,11,10,9,8,15,14,13,12, \
+                                         3,2,1,0,7,6,5,4,11,10,9,8,15,14,13,12)
+
+SC_TARGET_AVX2 static inline __m256 IntToFloat_AVX2(__m256i v)
+{
+    return _mm256_mul_ps(_mm256_cvtepi32_ps(v), _mm256_set1_ps(c_fScaleToFloat));
+}
+
+SC_TARGET_AVX2 static inline __m256i FloatToInt_AVX2(__m256 v)
+{
+    v = _mm256_mul_ps(v, _mm256_set1_ps(c_fIntAmplitude));
+    v = _mm256_max_ps(_mm256_set1_ps(c_fIntMin), v);
+    v = _mm256_min_ps(_mm256_set1_ps(c_fIntMax), v);
+    return _mm256_cvttps_epi32(v);
+}
+
+/// loads 8 packed 24 bit samples (24 bytes) into two lanes. NOTE: reads 28 bytes
+SC_TARGET_AVX2 static inline __m256i LoadInt24_AVX2(const uint8_t * pb)
+{
+    __m128i vLo = _mm_loadu_si128(reinterpret_cast<const __m128i *>(pb));
+    __m128i vHi = _mm_loadu_si128(reinterpret_cast<const __m128i *>(pb + 12));
+    return _mm256_inserti128_si256(_mm256_castsi128_si256(vLo), vHi, 1);
+}
+
+/// stores two lanes with 12 packed bytes each. NOTE: writes 28 bytes
+SC_TARGET_AVX2 static inline void StoreInt24_AVX2(uint8_t * pb, __m256i v)
+{
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(pb), _mm256_castsi256_si128(v));
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(pb + 12), _mm256_extracti128_si256(v, 1));
+}
+
+//------------------------------------------------------------------------------
+// AVX2 kernels: driver format to float
+//------------------------------------------------------------------------------
+SC_TARGET_AVX2 static void Int16LsbToFloat_AVX2(const void * pvSrc, float * pfDest, size_t nFrames, unsigned int nShift)
+{
+    const int16_t * pn = static_cast<const int16_t *>(pvSrc);
+    size_t nFrame = 0;
+    for (; nFrame + 8 <= nFrames; nFrame += 8)
+    {
+        __m256i v = _mm256_cvtepi16_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i *>(pn + nFrame)));
+        _mm256_storeu_ps(pfDest + nFrame, IntToFloat_AVX2(_mm256_slli_epi32(v, 16)));
+    }
+    Int16LsbToFloat(pn + nFrame, pfDest + nFrame, nFrames - nFrame, nShift);
+}
+
+SC_TARGET_AVX2 static void Int16MsbToFloat_AVX2(const void * pvSrc, float * pfDest, size_t nFrames, unsigned int nShift)
+{
+    const int16_t * pn = static_cast<const int16_t *>(pvSrc);
+    const __m128i vMask = _mm256_castsi256_si128(SC_SWAP16_MASK);
+    size_t nFrame = 0;
+    for (; nFrame + 8 <= nFrames; nFrame += 8)
+    {
+        __m128i vIn = _mm_shuffle_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i *>(pn + nFrame)), vMask);
+        __m256i v = _mm256_cvtepi16_epi32(vIn);
+        _mm256_storeu_ps(pfDest + nFrame, IntToFloat_AVX2(_mm256_slli_epi32(v, 16)));
+    }
+    Int16MsbToFloat(pn + nFrame, pfDest + nFrame, nFrames - nFrame, nShift);
+}
+
+SC_TARGET_AVX2 static void Int24LsbToFloat_AVX2(const void * pvSrc, float * pfDest, size_t nFrames, unsigned int nShift)
+{
+    const uint8_t * pb = static_cast<const uint8_t *>(pvSrc);
+    const char z = (char)0x80;
+    const __m256i vMask = _mm256_setr_epi8(z,0,1,2,z,3,4,5,z,6,7,8,z,9,10,11,
+                                           z,0,1,2,z,3,4,5,z,6,7,8,z,9,10,11);
+    size_t nFrame = 0;
+    // NOTE: load reads 4 bytes beyond 8 samples
+    for (; nFrame + 10 <= nFrames; nFrame += 8)
+    {
+        __m256i v = _mm256_shuffle_epi8(LoadInt24_AVX2(pb + 3*nFrame), vMask);
+        _mm256_storeu_ps(pfDest + nFrame, IntToFloat_AVX2(v));
+    }
+    Int24LsbToFloat(pb + 3*nFrame, pfDest + nFrame, nFrames - nFrame, nShift);
+}
+
+SC_TARGET_AVX2 static void Int24MsbToFloat_AVX2(const void * pvSrc, float * pfDest, size_t nFrames, unsigned int nShift)
+{
+    const uint8_t * pb = static_cast<const uint8_t *>(pvSrc);
+    const char z = (char)0x80;
+    const __m256i vMask = _mm256_setr_epi8(z,2,1,0,z,5,4,3,z,8,7,6,z,11,10,9,
+                                           z,2,1,0,z,5,4,3,z,8,7,6,z,11,10,9);
+    size_t nFrame = 0;
+    // NOTE: load reads 4 bytes beyond 8 samples
+    for (; nFrame + 10 <= nFrames; nFrame += 8)
+    {
+        __m256i v = _mm256_shuffle_epi8(LoadInt24_AVX2(pb + 3*nFrame), vMask);
+        _mm256_storeu_ps(pfDest + nFrame, IntToFloat_AVX2(v));
+    }
+    Int24MsbToFloat(pb + 3*nFrame, pfDest + nFrame, nFrames - nFrame, nShift);
+}
+
+SC_TARGET_AVX2 static void Int32LsbToFloat_AVX2(const void * pvSrc, float * pfDest, size_t nFrames, unsigned int nShift)
+{
+    const int32_t * pn = static_cast<const int32_t *>(pvSrc);
+    const __m128i vShift = _mm_cvtsi32_si128((int)nShift);
+    size_t nFrame = 0;
+    for (; nFrame + 8 <= nFrames; nFrame += 8)
+    {
+        __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(pn + nFrame));
+        _mm256_storeu_ps(pfDest + nFrame, IntToFloat_AVX2(_mm256_sll_epi32(v, vShift)));
+    }
+    Int32LsbToFloat(pn + nFrame, pfDest + nFrame, nFrames - nFrame, nShift);
+}
+
+SC_TARGET_AVX2 static void Int32MsbToFloat_AVX2(const void * pvSrc, float * pfDest, size_t nFrames, unsigned int nShift)
+{
+    const int32_t * pn = static_cast<const int32_t *>(pvSrc);
+    const __m128i vShift = _mm_cvtsi32_si128((int)nShift);
+    const __m256i vMask = SC_SWAP32_MASK;
+    size_t nFrame = 0;
+    for (; nFrame + 8 <= nFrames; nFrame += 8)
+    {
+        __m256i v = _mm256_shuffle_epi8(_mm256_loadu_si256(reinterpret_cast<const __m256i *>(pn + nFrame)), vMask);
+        _mm256_storeu_ps(pfDest + nFrame, IntToFloat_AVX2(_mm256_sll_epi32(v, vShift)));
+    }
+    Int32MsbToFloat(pn + nFrame, pfDest + nFrame, nFrames - nFrame, nShift);
+}
+
+SC_TARGET_AVX2 static void Float32MsbToFloat_AVX2(const void * pvSrc, float * pfDest, size_t nFrames, unsigned int nShift)
+{
+    const int32_t * pn = static_cast<const int32_t *>(pvSrc);
+    const __m256i vMask = SC_SWAP32_MASK;
+    size_t nFrame = 0;
+    for (; nFrame + 8 <= nFrames; nFrame += 8)
+    {
+        __m256i v = _mm256_shuffle_epi8(_mm256_loadu_si256(reinterpret_cast<const __m256i *>(pn + nFrame)), vMask);
+        _mm256_storeu_ps(pfDest + nFrame, _mm256_castsi256_ps(v));
+    }
+    Float32MsbToFloat(pn + nFrame, pfDest + nFrame, nFrames - nFrame, nShift);
+}
+
+//------------------------------------------------------------------------------
+// AVX2 kernels: float to driver format
+//------------------------------------------------------------------------------
+SC_TARGET_AVX2 static void FloatToInt16Lsb_AVX2(const float * pfSrc, void * pvDest, size_t nFrames, unsigned int nShift)
+{
+    int16_t * pn = static_cast<int16_t *>(pvDest);
+    size_t nFrame = 0;
+    for (; nFrame + 16 <= nFrames; nFrame += 16)
+    {
+        __m256i vLo = _mm256_srai_epi32(FloatToInt_AVX2(_mm256_loadu_ps(pfSrc + nFrame)), 16);
+        __m256i vHi = _mm256_srai_epi32(FloatToInt_AVX2(_mm256_loadu_ps(pfSrc + nFrame + 8)), 16);
+        // packs works within lanes: restore order of 64 bit blocks
+        __m256i v = _mm256_permute4x64_epi64(_mm256_packs_epi32(vLo, vHi), 0xD8);
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(pn + nFrame), v);
+    }
+    FloatToInt16Lsb(pfSrc + nFrame, pn + nFrame, nFrames - nFrame, nShift);
+}
+
+SC_TARGET_AVX2 static void FloatToInt16Msb_AVX2(const float * pfSrc, void * pvDest, size_t nFrames, unsigned int nShift)
+{
+    int16_t * pn = static_cast<int16_t *>(pvDest);
+    const __m256i vMask = SC_SWAP16_MASK;
+    size_t nFrame = 0;
+    for (; nFrame + 16 <= nFrames; nFrame += 16)
+    {
+        __m256i vLo = _mm256_srai_epi32(FloatToInt_AVX2(_mm256_loadu_ps(pfSrc + nFrame)), 16);
+        __m256i vHi = _mm256_srai_epi32(FloatToInt_AVX2(_mm256_loadu_ps(pfSrc + nFrame + 8)), 16);
+        __m256i v = _mm256_permute4x64_epi64(_mm256_packs_epi32(vLo, vHi), 0xD8);
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(pn + nFrame), _mm256_shuffle_epi8(v, vMask));
+    }
+    FloatToInt16Msb(pfSrc + nFrame, pn + nFrame, nFrames - nFrame, nShift);
+}
+
+SC_TARGET_AVX2 static void FloatToInt24Lsb_AVX2(const float * pfSrc, void * pvDest, size_t nFrames, unsigned int nShift)
+{
+    uint8_t * pb = static_cast<uint8_t *>(pvDest);
+    const char z = (char)0x80;
+    const __m256i vMask = _mm256_setr_epi8(1,2,3,5,6,7,9,10,11,13,14,15,z,z,z,z,
+                                           1,2,3,5,6,7,9,10,11,13,14,15,z,z,z,z);
+    size_t nFrame = 0;
+    // NOTE: store writes 4 bytes beyond 8 samples that are overwritten afterwards
+    for (; nFrame + 10 <= nFrames; nFrame += 8)
+    {
+        __m256i v = FloatToInt_AVX2(_mm256_loadu_ps(pfSrc + nFrame));
+        StoreInt24_AVX2(pb + 3*nFrame, _mm256_shuffle_epi8(v, vMask));
+    }
+    FloatToInt24Lsb(pfSrc + nFrame, pb + 3*nFrame, nFrames - nFrame, nShift);
+}
+
+SC_TARGET_AVX2 static void FloatToInt24Msb_AVX2(const float * pfSrc, void * pvDest, size_t nFrames, unsigned int nShift)
+{
+    uint8_t * pb = static_cast<uint8_t *>(pvDest);
+    const char z = (char)0x80;
+    const __m256i vMask = _mm256_setr_epi8(3,2,1,7,6,5,11,10,9,15,14,13,z,z,z,z,
+                                           3,2,1,7,6,5,11,10,9,15,14,13,z,z,z,z);
+    size_t nFrame = 0;
+    // NOTE: store writes 4 bytes beyond 8 samples that are overwritten afterwards
+    for (; nFrame + 10 <= nFrames; nFrame += 8)
+    {
+        __m256i v = FloatToInt_AVX2(_mm256_loadu_ps(pfSrc + nFrame));
+        StoreInt24_AVX2(pb + 3*nFrame, _mm256_shuffle_epi8(v, vMask));
+    }
+    FloatToInt24Msb(pfSrc + nFrame, pb + 3*nFrame, nFrames - nFrame, nShift);
+}
+
+SC_TARGET_AVX2 static void FloatToInt32Lsb_AVX2(const float * pfSrc, void * pvDest, size_t nFrames, unsigned int nShift)
+{
+    int32_t * pn = static_cast<int32_t *>(pvDest);
+    const __m128i vShift = _mm_cvtsi32_si128((int)nShift);
+    size_t nFrame = 0;
+    for (; nFrame + 8 <= nFrames; nFrame += 8)
+    {
+        __m256i v = _mm256_sra_epi32(FloatToInt_AVX2(_mm256_loadu_ps(pfSrc + nFrame)), vShift);
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(pn + nFrame), v);
+    }
+    FloatToInt32Lsb(pfSrc + nFrame, pn + nFrame, nFrames - nFrame, nShift);
+}
+
+SC_TARGET_AVX2 static void FloatToInt32Msb_AVX2(const float * pfSrc, void * pvDest, size_t nFrames, unsigned int nShift)
+{
+    int32_t * pn = static_cast<int32_t *>(pvDest);
+    const __m128i vShift = _mm_cvtsi32_si128((int)nShift);
+    const __m256i vMask = SC_SWAP32_MASK;
+    size_t nFrame = 0;
+    for (; nFrame + 8 <= nFrames; nFrame += 8)
+    {
+        __m256i v = _mm256_sra_epi32(FloatToInt_AVX2(_mm256_loadu_ps(pfSrc + nFrame)), vShift);
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(pn + nFrame), _mm256_shuffle_epi8(v, vMask));
+    }
+    FloatToInt32Msb(pfSrc + nFrame, pn + nFrame, nFrames - nFrame, nShift);
+}
+
+SC_TARGET_AVX2 static void FloatToFloat32Lsb_AVX2(const float * pfSrc, void * pvDest, size_t nFrames, unsigned int nShift)
+{
+    float * pf = static_cast<float *>(pvDest);
+    const __m256 vMin = _mm256_set1_ps(-1.0f);
+    const __m256 vMax = _mm256_set1_ps(1.0f);
+    size_t nFrame = 0;
+    for (; nFrame + 8 <= nFrames; nFrame += 8)
+    {
+        __m256 v = _mm256_max_ps(vMin, _mm256_loadu_ps(pfSrc + nFrame));
+        _mm256_storeu_ps(pf + nFrame, _mm256_min_ps(vMax, v));
+    }
+    FloatToFloat32Lsb(pfSrc + nFrame, pf + nFrame, nFrames - nFrame, nShift);
+}
+
+SC_TARGET_AVX2 static void FloatToFloat32Msb_AVX2(const float * pfSrc, void * pvDest, size_t nFrames, unsigned int nShift)
+{
+    float * pf = static_cast<float *>(pvDest);
+    const __m256 vMin = _mm256_set1_ps(-1.0f);
+    const __m256 vMax = _mm256_set1_ps(1.0f);
+    const __m256i vMask = SC_SWAP32_MASK;
+    size_t nFrame = 0;
+    for (; nFrame + 8 <= nFrames; nFrame += 8)
+    {
+        __m256 v = _mm256_min_ps(vMax, _mm256_max_ps(vMin, _mm256_loadu_ps(pfSrc + nFrame)));
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(pf + nFrame), _mm256_shuffle_epi8(_mm256_castps_si256(v), vMask));
+    }
+    FloatToFloat32Msb(pfSrc + nFrame, pf + nFrame, nFrames - nFrame, nShift);
+}
+
+//------------------------------------------------------------------------------
+/// checks CPU and OS support of AVX2
+//------------------------------------------------------------------------------
+static bool CpuHasAvx2()
+{
+    unsigned int nEax, nEbx, nEcx, nEdx;
+    if (!__get_cpuid(1, &nEax, &nEbx, &nEcx, &nEdx))
+        return false;
+    // OSXSAVE and AVX
+    if ((nEcx & (1u << 27)) == 0 || (nEcx & (1u << 28)) == 0)
+        return false;
+    // OS saves XMM and YMM registers
+    unsigned int nXcr0Lo, nXcr0Hi;
+    __asm__ __volatile__("xgetbv" : "=a"(nXcr0Lo), "=d"(nXcr0Hi) : "c"(0));
+    if ((nXcr0Lo & 6u) != 6u)
+        return false;
+    if (__get_cpuid_max(0, 0) < 7)
+        return false;
+    __cpuid_count(7, 0, nEax, nEbx, nEcx, nEdx);
+    return (nEbx & (1u << 5)) != 0;
+}
+#endif // SC_AVX2
+
+//------------------------------------------------------------------------------
+/// determines best available instruction set
+//------------------------------------------------------------------------------
+static SampleConverterIsa DetectIsa()
+{
+#if defined(SC_AVX2)
+    if (CpuHasAvx2())
+        return SCI_AVX2;
+#endif
+#if defined(SC_SSE2)
+    return SCI_SSE2;
+#else
+    return SCI_SCALAR;
+#endif
+}
+
+static const SampleConverterIsa s_sciAvailable = DetectIsa();
+
+SampleConverterIsa SampleConverter::AvailableIsa()
+{
+    return s_sciAvailable;
+}
+
+SampleConverter::SampleConverter()
+    : m_pfnToFloat(NoneToFloat),
+      m_pfnFromFloat(FloatToNone),
+      m_nShift(0),
+      m_nBytesPerSample(0),
+      m_sciIsa(SCI_SCALAR)
+{
+}
+
+SampleConverter::SampleConverter(SampleFormat sfFormat, bool bBigEndian,
+                                 unsigned int nValidBits,
+                                 SampleConverterIsa sciIsa)
+    : m_pfnToFloat(NoneToFloat),
+      m_pfnFromFloat(FloatToNone),
+      m_nShift(0),
+      m_nBytesPerSample(0),
+      m_sciIsa(sciIsa < s_sciAvailable ? sciIsa : s_sciAvailable)
+{
+    // scalar kernels first (used for all formats without SIMD kernels)
+    switch (sfFormat)
+    {
+    case SF_INT16:
+        m_nBytesPerSample = 2;
+        m_pfnToFloat   = bBigEndian ? Int16MsbToFloat : Int16LsbToFloat;
+        m_pfnFromFloat = bBigEndian ? FloatToInt16Msb : FloatToInt16Lsb;
+        break;
+    case SF_INT24:
+        m_nBytesPerSample = 3;
+        m_pfnToFloat   = bBigEndian ? Int24MsbToFloat : Int24LsbToFloat;
+        m_pfnFromFloat = bBigEndian ? FloatToInt24Msb : FloatToInt24Lsb;
+        break;
+    case SF_INT32:
+        m_nBytesPerSample = 4;
+        m_nShift = (nValidBits > 0 && nValidBits < 32) ? 32 - nValidBits : 0;
+        m_pfnToFloat   = bBigEndian ? Int32MsbToFloat : Int32LsbToFloat;
+        m_pfnFromFloat = bBigEndian ? FloatToInt32Msb : FloatToInt32Lsb;
+        break;
+    case SF_FLOAT32:
+        m_nBytesPerSample = 4;
+        m_pfnToFloat   = bBigEndian ? Float32MsbToFloat : Float32LsbToFloat;
+        m_pfnFromFloat = bBigEndian ? FloatToFloat32Msb : FloatToFloat32Lsb;
+        break;
+    case SF_FLOAT64:
+        m_nBytesPerSample = 8;
+        m_pfnToFloat   = bBigEndian ? Float64MsbToFloat : Float64LsbToFloat;
+        m_pfnFromFloat = bBigEndian ? FloatToFloat64Msb : FloatToFloat64Lsb;
+        break;
+    default:
+        m_sciIsa = SCI_SCALAR;
+        return;
+    }
+
+#if defined(SC_SSE2)
+    if (m_sciIsa >= SCI_SSE2)
+    {
+        switch (sfFormat)
+        {
+        case SF_INT16:
+            m_pfnToFloat   = bBigEndian ? Int16MsbToFloat_SSE2 : Int16LsbToFloat_SSE2;
+            m_pfnFromFloat = bBigEndian ? FloatToInt16Msb_SSE2 : FloatToInt16Lsb_SSE2;
+            break;
+        case SF_INT32:
+            m_pfnToFloat   = bBigEndian ? Int32MsbToFloat_SSE2 : Int32LsbToFloat_SSE2;
+            m_pfnFromFloat = bBigEndian ? FloatToInt32Msb_SSE2 : FloatToInt32Lsb_SSE2;
+            break;
+        case SF_FLOAT32:
+            if (bBigEndian)
+                m_pfnToFloat = Float32MsbToFloat_SSE2;
+            m_pfnFromFloat = bBigEndian ? FloatToFloat32Msb_SSE2 : FloatToFloat32Lsb_SSE2;
+            break;
+        case SF_FLOAT64:
+            if (!bBigEndian)
+            {
+                m_pfnToFloat   = Float64LsbToFloat_SSE2;
+                m_pfnFromFloat = FloatToFloat64Lsb_SSE2;
+            }
+            break;
+        default:
+            break;
+        }
+    }
+#endif
+#if defined(SC_AVX2)
+    if (m_sciIsa >= SCI_AVX2)
+    {
+        switch (sfFormat)
+        {
+        case SF_INT16:
+            m_pfnToFloat   = bBigEndian ? Int16MsbToFloat_AVX2 : Int16LsbToFloat_AVX2;
+            m_pfnFromFloat = bBigEndian ? FloatToInt16Msb_AVX2 : FloatToInt16Lsb_AVX2;
+            break;
+        case SF_INT24:
+            m_pfnToFloat   = bBigEndian ? Int24MsbToFloat_AVX2 : Int24LsbToFloat_AVX2;
+            m_pfnFromFloat = bBigEndian ? FloatToInt24Msb_AVX2 : FloatToInt24Lsb_AVX2;
+            break;
+        case SF_INT32:
+            m_pfnToFloat   = bBigEndian ? Int32MsbToFloat_AVX2 : Int32LsbToFloat_AVX2;
+            m_pfnFromFloat = bBigEndian ? FloatToInt32Msb_AVX2 : FloatToInt32Lsb_AVX2;
+            break;
+        case SF_FLOAT32:
+            if (bBigEndian)
+                m_pfnToFloat = Float32MsbToFloat_AVX2;
+            m_pfnFromFloat = bBigEndian ? FloatToFloat32Msb_AVX2 : FloatToFloat32Lsb_AVX2;
+            break;
+        default:
+            break;
+        }
+    }
+#endif
+}
+
+void SampleConverter::ToFloat(const void * pvSrc, float * pfDest, size_t nFrames) const
+{
+    m_pfnToFloat(pvSrc, pfDest, nFrames, m_nShift);
+}
+
+void SampleConverter::FromFloat(const float * pfSrc, void * pvDest, size_t nFrames) const
+{
+    m_pfnFromFloat(pfSrc, pvDest, nFrames, m_nShift);
+}
+
+size_t SampleConverter::BytesPerSample() const
+{
+    return m_nBytesPerSample;
+}
+
+SampleConverterIsa SampleConverter::Isa() const
+{
+    return m_sciIsa;
+}
+
+
+// Next comment block tells emacs editor how to format code in this file.
+
+// Local Variables:
+// mode: c++
+// c-file-style: "stroustrup"
+// c-basic-offset: 4
+// indent-tabs-mode: nil
+// End:
@@ -0,0 +1,151 @@
+//------------------------------------------------------------------------------
+/// \file casioConvert.h
+/// \author Berg
+/// \brief Definition of class SampleConverter used by class CAsio
+///
+/// Project SoundMexPro
+/// Module SoundDllPro
+/// Definition of class SampleConverter: block conversion kernels between the
+/// sample formats of ASIO drivers and float. The kernels do not depend on the
+/// ASIO SDK or on windows headers. SSE2 and AVX2 versions are used if
+/// available with scalar fallbacks.
+///
+/// ****************************************************************************
+/// Copyright 2023 Daniel Berg, Oldenburg, Germany
+/// ****************************************************************************
+///
+/// This file is part of SoundMexPro.
+///
+///    SoundMexPro is free software: you can redistribute it and/or modify
+///    it under the terms of the GNU General Public License as published by
+///    the Free Software Foundation, either version 3 of the License, or
+///    (at your option) any later version.
+///
+///    SoundMexPro is distributed in the hope that it will be useful,
+///    but WITHOUT ANY WARRANTY; without even the implied warranty of
+///    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+///    GNU General Public License for more details.
+///
+///    You should have received a copy of the GNU General Public License
+///    along with SoundMexPro.  If not, see <http:///www.gnu.org/licenses/>.
+///
+//------------------------------------------------------------------------------
+#ifndef casioConvertH
+#define casioConvertH
+
+#include <stddef.h>
+
+namespace Asio {
+    /// \brief Storage format of a sample in a driver buffer.
+    ///
+    /// Variable prefix: sf for Sample Format.
+    enum SampleFormat
+    {
+        /// unknown format: converts to silence, nothing is written to driver
+        SF_NONE = 0,
+        /// signed 16 bit
+        SF_INT16,
+        /// signed 24 bit packed (3 bytes per sample)
+        SF_INT24,
+        /// signed 32 bit, optionally only the least significant 16, 18, 20
+        /// or 24 bits carry the value
+        SF_INT32,
+        /// IEEE 754 32 bit float
+        SF_FLOAT32,
+        /// IEEE 754 64 bit float
+        SF_FLOAT64
+    };
+
+    /// \brief Instruction set used by the conversion kernels.
+    enum SampleConverterIsa
+    {
+        SCI_SCALAR = 0,
+        SCI_SSE2,
+        SCI_AVX2
+    };
+
+    /// Kernel converting nFrames driver samples to float.
+    typedef void (*ToFloatKernel)(const void * pvSrc, float * pfDest,
+                                  size_t nFrames, unsigned int nShift);
+    /// Kernel clipping nFrames float samples and converting them to
+    /// driver samples.
+    typedef void (*FromFloatKernel)(const float * pfSrc, void * pvDest,
+                                    size_t nFrames, unsigned int nShift);
+
+    /// \brief Conversion of one channel between driver format and float.
+    ///
+    /// Variable prefix: sc for Sample Converter.
+    /// The kernels are selected once on construction, so conversion of a
+    /// buffer does not depend on the sample format any longer. The results
+    /// are identical for all instruction sets: integer samples are scaled
+    /// by 2^-31 after shifting them to the most significant bits. When
+    /// converting from float, float samples are clipped to [-1:1] and integer
+    /// samples to [-2^31:2^31-256] before shifting them to the valid bits.
+    class SampleConverter
+    {
+    public:
+        /// Creates a converter for format SF_NONE.
+        SampleConverter();
+
+        /// Creates a converter for a sample format.
+        /// \param sfFormat
+        ///     The storage format of the samples.
+        /// \param bBigEndian
+        ///     true if samples are stored big endian (MSB), false for little
+        ///     endian (LSB).
+        /// \param nValidBits
+        ///     Number of least significant bits carrying the value of SF_INT32
+        ///     samples (16, 18, 20, 24 or 32). Ignored for other formats.
+        /// \param sciIsa
+        ///     Maximum instruction set to be used (SCI_AVX2 selects the best
+        ///     instruction set available).
+        SampleConverter(SampleFormat sfFormat, bool bBigEndian,
+                        unsigned int nValidBits = 32,
+                        SampleConverterIsa sciIsa = SCI_AVX2);
+
+        /// Converts driver samples to float.
+        /// \param pvSrc
+        ///     The buffer pointer from the driver.
+        /// \param pfDest
+        ///     Ouputs the float samples here.
+        /// \param nFrames
+        ///     Number of samples to convert.
+        void ToFloat(const void * pvSrc, float * pfDest, size_t nFrames) const;
+
+        /// Clips float samples to [-1:1] and converts them to driver samples.
+        /// \param pfSrc
+        ///     float samples for soundcard output
+        /// \param pvDest
+        ///     The buffer pointer from the driver.
+        /// \param nFrames
+        ///     Number of samples to convert.
+        void FromFloat(const float * pfSrc, void * pvDest, size_t nFrames) const;
+
+        /// Returns the number of bytes per sample (0 for SF_NONE).
+        size_t BytesPerSample() const;
+
+        /// Returns the instruction set used by the kernels of this instance.
+        SampleConverterIsa Isa() const;
+
+        /// Returns the best instruction set supported by CPU and compiler.
+        static SampleConverterIsa AvailableIsa();
+
+    private:
+        ToFloatKernel m_pfnToFloat;
+        FromFloatKernel m_pfnFromFloat;
+        unsigned int m_nShift;
+        size_t m_nBytesPerSample;
+        SampleConverterIsa m_sciIsa;
+    };
+}
+#endif
+
+
+// Next comment block tells emacs editor how to format code in this file.
+
+// Local Variables:
+// mode: c++
+// c-file-style: "stroustrup"
+// c-basic-offset: 4
+// indent-tabs-mode: nil
+// End:
@@ -30,7 +30,9 @@
 #ifndef casioExceptionsH
 #define casioExceptionsH
 
+#ifdef _WIN32
 #include <windows.h>
+#endif
 
 #include "casioEnums.h"
 
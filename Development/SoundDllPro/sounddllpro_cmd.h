@@ -56,7 +56,15 @@ static struct CMD_ARG
    "      supported. 'xrun' and 'controlpanel' are not supported with 'wdm'.\n"
    "      NOTE: calling 'exit' clears the driver model, thus you have\n"
    "      to call 'setdrivermodel' again after calling 'exit'!\n"
-   "Par.> value:        'asio' or 'wdm'\n"
+   "      Driver model 'null' uses a device without hardware with 64\n"
+   "      input and 64 output channels driven by a virtual clock (see\n"
+   "      'nullclock', 'nullinput' and 'nullinputfile' of 'init'). The\n"
+   "      buffer size is set by 'bufsize' of 'init' (default 512).\n"
+   "      NOTE: the clock thread of driver model 'null' calls processing,\n"
+   "      play and done callbacks directly one after another. The queues\n"
+   "      and the separate processing and done threads used with 'asio'\n"
+   "      ('numbufs', xruns of these queues) are not used.\n"
+   "Par.> value:        'asio', 'wdm' or 'null'\n"
    "Def.> value:        'asio'\n",
    SOUNDDLLPRO_PAR_VALUE ",",                                           // arguments
    SetDriverModel,                                                      // function pointer
@@ -104,6 +112,24 @@ static struct CMD_ARG
    "                 samples - or not! See also command 'getproperties'\n"
    "      filereadbufsize: buffer size used for wave file reading, If below 65536\n"
    "                 value is set to 65536.\n"
+   "      filereadthreads: number of threads used for reading wave files (1-16).\n"
+   "                 All files share these threads, buffers that will run dry\n"
+   "                 first are refilled first.\n"
+   "      filereadmap: flag if uncompressed WAV/RF64 files (16bit, 24bit or\n"
+   "                 float) are memory mapped and read directly without buffering\n"
+   "                 rather than streamed by file reading threads. The file reading\n"
+   "                 threads prefetch the mapped data ahead of the play position.\n"
+   " recwritebufsize: memory in bytes used for writing record files. Recorded\n"
+   "                 data are copied to blocks that are written to disk by a\n"
+   "                 separate thread. If all blocks are in use, recording has\n"
+   "                 to wait (see command 'recwritestats'). Each open record\n"
+   "                 file reserves two blocks, the buffer is enlarged to two\n"
+   "                 blocks per allocated input channel if necessary. Files\n"
+   "                 that cannot reserve blocks (e.g. debug files) are written\n"
+   "                 directly. 0 writes all data directly (synchronous\n"
+   "                 writing).\n"
+   " recwriteblocksize: size in bytes of one block written to disk (65536 -\n"
+   "                 4194304, rounded up to a multiple of 65536).\n"
    "      samplerate: samplerate to use. NOTE: after intialization only this\n"
    "                 samplerate can be used, only files with this samplerate\n"
    "                 can be played!\n"
@@ -240,13 +266,43 @@ static struct CMD_ARG
    "                 written to this file (not in MATLAB but SoundDllMaster\n"
    "                 syntax). NOTE: if write access to file fails (read only\n"
    "                 of invalid filename) 'init' command will fail!\n"
-   " vstmultithreading: flag if each parallel VST plugin should run in a\n"
-   "                 separate thread.\n"
+   " vstmultithreading: threading mode of VST plugins: 0 runs all plugins in\n"
+   "                 one thread, 1 runs each parallel VST plugin in a\n"
+   "                 separate thread, 2 runs all plugins with a fixed number\n"
+   "                 of worker threads (see 'vstthreads'). With 2 a plugin\n"
+   "                 starts as soon as all channels it reads are processed.\n"
    " vstthreadpriority: thread priority for VST threads. Must be between 0 and\n"
    "                 3 (0: normal, 1: higher, 2: highest, 3: time critical).\n"
    "                 Setting value to 3 (time critical) will give highest\n"
    "                 priority to processing, but may block other processes.\n"
    "                 This value is ignored, if 'vstmultithreading' is 0.\n"
+   "     vstthreads: number of threads used for VST processing if\n"
+   "                 'vstmultithreading' is 2 (0: number of processors).\n"
+   "   trackthreads: number of threads used for rendering, gain and level\n"
+   "                 calculation of tracks (including the processing\n"
+   "                 thread). 0 or 1 processes all tracks in the processing\n"
+   "                 thread. Output is identical for all values. Useful\n"
+   "                 with many tracks only. Data notifications are sent\n"
+   "                 after all tracks are rendered if value is > 1.\n"
+   "      nullclock: clock of driver model 'null': 0 processes buffers in\n"
+   "                 real time, 1 as fast as possible. In both modes all\n"
+   "                 callbacks run in the clock thread without queues (see\n"
+   "                 'setdrivermodel'), so timings do not include the queue\n"
+   "                 and thread handover costs of driver model 'asio'.\n"
+   "      nullinput: input data of driver model 'null': 0 silence, 1 last\n"
+   "                 played buffer of output channel with same index\n"
+   "                 (loopback), 2 data from 'nullinputfile'.\n"
+   "  nullinputfile: sound file used as input data if 'nullinput' is 2.\n"
+   "                 File is looped, file channels are used cyclically.\n"
+   "                 Samplerate must match 'samplerate'.\n"
+   "      tracesize: number of events in trace ring (rounded up to a power\n"
+   "                 of 2). Begin and end of driver callback, queue access,\n"
+   "                 processing stages, each VST plugin, MATLAB plugin and\n"
+   "                 file reads are traced. 0 disables tracing (see command\n"
+   "                 'tracedump').\n"
+   "  tracexrunfile: if set, trace of the last 2 seconds is written to this\n"
+   "                 file on every xrun (overwritten). Ignored if\n"
+   "                 'tracesize' is 0.\n"
    "      quiet:     if set to 1, then no version info is printed to workspace.\n"
    "Def.> force:     empty\n"
    "      forcelic:  0\n"
@@ -255,6 +311,10 @@ static struct CMD_ARG
    "      file2file: 0\n"
    "      reccompensatelatency: 0\n"
    "      filereadbufsize: 655360\n"
+   "      filereadthreads: 2\n"
+   "      filereadmap: 1\n"
+   " recwritebufsize: 67108864 (64 MB)\n"
+   " recwriteblocksize: 1048576 (1 MB)\n"
    "     f2fbufsize: 1024\n"
 //   "      bufsize: drivers preferred buffersize\n"
    "     samplerate: 44100\n"
@@ -280,11 +340,22 @@ static struct CMD_ARG
    "    logfile:     empty (no logging)\n"
    " vstmultithreading: 1\n"
    " vstthreadpriority: 2\n"
+   "     vstthreads: 0\n"
+   "   trackthreads: 0\n"
+   "      nullclock: 0\n"
+   "      nullinput: 0\n"
+   "  nullinputfile: empty\n"
+   "      tracesize: 0\n"
+   "  tracexrunfile: empty\n"
    " quiet:             0\n"
    "Ret.> Type:      LicenceType",
    SOUNDDLLPRO_PAR_DRIVER ","                                           // arguments
    SOUNDDLLPRO_PAR_PRIORITY ","
    SOUNDDLLPRO_PAR_FILEREADBUFSIZE ","
+   SOUNDDLLPRO_PAR_FILEREADTHREADS ","
+   SOUNDDLLPRO_PAR_FILEREADMAP ","
+   SOUNDDLLPRO_PAR_RECWRITEBUFSIZE ","
+   SOUNDDLLPRO_PAR_RECWRITEBLOCKSIZE ","
    SOUNDDLLPRO_PAR_FILE2FILE ","
    SOUNDDLLPRO_PAR_RECCOMPLATENCY ","
    SOUNDDLLPRO_PAR_F2FBUFSIZE ","
@@ -303,6 +374,13 @@ static struct CMD_ARG
    SOUNDDLLPRO_PAR_LOGFILE ","
    SOUNDDLLPRO_PAR_VSTMT ","
    SOUNDDLLPRO_PAR_VSTTP ","
+   SOUNDDLLPRO_PAR_VSTTHREADS ","
+   SOUNDDLLPRO_PAR_TRACKTHREADS ","
+   SOUNDDLLPRO_PAR_NULLCLOCK ","
+   SOUNDDLLPRO_PAR_NULLINPUT ","
+   SOUNDDLLPRO_PAR_NULLINPUTFILE ","
+   SOUNDDLLPRO_PAR_TRACESIZE ","
+   SOUNDDLLPRO_PAR_TRACEXRUNFILE ","
    SOUNDDLLPRO_PAR_FREEZESRATE ","
    SOUNDDLLPRO_PAR_TRACK ","
    SOUNDDLLPRO_PAR_NUMBUFS ","
@@ -1028,6 +1106,10 @@ static struct CMD_ARG
    "                   (loopcount-1)*(length-loopramplen) + length\n"
    "      name:      optional name for the data object. Is used track view GUI\n"
    "                 to show names of used vectors.\n"
+   "      datakey:   optional key identifying the data. Data are converted only\n"
+   "                 once and shared by all loaded objects with identical data\n"
+   "                 (or key). If a key is passed, the data are not compared:\n"
+   "                 data loaded with identical key and length must be identical!\n"
    "Def.> track:     vector/array with all tracks\n"
    "      loopcount: 1\n"
    "      offset:    0\n"
@@ -1049,7 +1131,8 @@ static struct CMD_ARG
    SOUNDDLLPRO_PAR_LOOPRAMPLEN ","
    SOUNDDLLPRO_PAR_RAMPLEN ","
    SOUNDDLLPRO_PAR_LOOPCROSSFADE ","
-   SOUNDDLLPRO_PAR_CROSSFADELEN ",",
+   SOUNDDLLPRO_PAR_CROSSFADELEN ","
+   SOUNDDLLPRO_PAR_DATAKEY ",",
    LoadMem,                                                             // function pointer
    1                                                                    // must be initialized
 },
@@ -1451,7 +1534,8 @@ static struct CMD_ARG
    "      returns current name(s). NOTE: value can only be set if device is\n"
    "      stopped!\n"
    "      NOTE: you cannot use the same filename for different channels, only\n"
-   "      one mono file per channel can be written!\n"
+   "      one mono file per channel can be written! To write multiple\n"
+   "      channels to one file use command 'recmultifile'.\n"
    "      If an invalid filename is passed, or a filename that is\n"
    "      already used by another channel you may get errors on 'start'!\n"
    "      You can set/change the filename of a channel either if device is\n"
@@ -1482,6 +1566,36 @@ static struct CMD_ARG
    RecFileName,                                                         // function pointer
    1                                                                    // must be initialized
 },
+{  SOUNDDLLPRO_CMD_RECMULTIFILE,                                        // cmd
+   "Name> " SOUNDDLLPRO_CMD_RECMULTIFILE "\n"                           // help
+   "Help> sets a file for recording a group of input channels interleaved\n"
+   "      to one multichannel file and returns current settings. This is\n"
+   "      recommended for recording many channels: only one file is\n"
+   "      written instead of one file per channel. The channels of the\n"
+   "      group are not written to their own record files (see\n"
+   "      'recfilename'), the settings of commands 'recpause' and\n"
+   "      'reclength' have no effect on the group file.\n"
+   "      NOTE: value can only be set if device is stopped!\n"
+   "      NOTE: recorded data are always stored in normalized 32-bit float\n"
+   "      PCM wave files. Files exceeding 4 GB are written as RF64 files\n"
+   "      (applies to all record files).\n"
+   "Par.> filename:  name of multichannel record file\n"
+   "      channel:   vector/array with input channels (indices or array with\n"
+   "                 names) to write to file in the specified order\n"
+   "      value:     if set to 0, the multichannel record file is disabled\n"
+   "                 and all channels are written to their own files\n"
+   "                 again ('filename' must not be specified)\n"
+   "Def.> channel:   vector/array with all allocated input channels\n"
+   "Ret.> value:     1 if a multichannel record file is set, 0 otherwise,\n"
+   "      filename:  name of multichannel record file (empty if not set),\n"
+   "      channel:   vector with channels written to multichannel record\n"
+   "                 file",
+   SOUNDDLLPRO_PAR_FILENAME ","                                        // arguments
+   SOUNDDLLPRO_PAR_CHANNEL ","
+   SOUNDDLLPRO_PAR_VALUE ",",
+   RecMultiFile,                                                        // function pointer
+   1                                                                    // must be initialized
+},
 {  SOUNDDLLPRO_CMD_RECPAUSE,                                            // cmd
    "Name> " SOUNDDLLPRO_CMD_RECPAUSE "\n"                               // help
    "Help> sets recording pause status of one or more channels and returns\n"
@@ -1628,6 +1742,16 @@ static struct CMD_ARG
    "                 from multiple channels with different recbufsizes (set with\n"
    "                 'recbufsize') cannot be retrieved with a single command and\n"
    "                 must be retrieved subsequently\n"
+   "      cursor:    absolute record sample position of first sample not\n"
+   "                 retrieved yet (streaming read, optional). If passed, only\n"
+   "                 samples recorded since this position are returned (may be\n"
+   "                 none) instead of the complete record buffer. Pass 0 on\n"
+   "                 first call and the returned position plus the number of\n"
+   "                 returned samples (returned 'cursor') on subsequent calls.\n"
+   "                 If samples were overwritten in the record buffer before\n"
+   "                 they were retrieved, all available samples are returned\n"
+   "                 and the number of lost samples is returned in 'overrun'.\n"
+   "                 Much faster than complete reads when called frequently.\n"
    "Def.> channel:   vector/array with all allocated channels\n"
    "Ret.> data:      matrix/array with columns containing record data from\n"
    "                 channels (length is set by 'recbufsize' command),\n"
@@ -1651,12 +1775,14 @@ static struct CMD_ARG
    "                 have missed data! Otherwise you can copy the new data with\n"
    "                 respect to the overlap: the last (recbufsize - n) samples\n"
    "                 in the first buffer are identical to the first (recbufsize - n)\n"
-   "                 samples in the second buffer and you may skip them.",
+   "                 samples in the second buffer and you may skip them.\n"
+   "      overrun:   number of lost samples (only if 'cursor' was passed)",
    SOUNDDLLPRO_PAR_CHANNEL ","
    SOUNDDLLPRO_PAR_DATA ","
    SOUNDDLLPRO_PAR_DATADEST ","
    SOUNDDLLPRO_PAR_SAMPLES ","
-   SOUNDDLLPRO_PAR_CHANNELS ",",                                         // arguments
+   SOUNDDLLPRO_PAR_CHANNELS ","                                         // arguments
+   SOUNDDLLPRO_PAR_CURSOR ",",
    RecGetData,                                                          // function pointer
    1                                                                    // must be initialized
 },
@@ -2233,6 +2359,126 @@ static struct CMD_ARG
    NumXRuns,                                                            // function pointer
    1                                                                    // must be initialized
 },
+{  SOUNDDLLPRO_CMD_FILEREADSTATS,                                       // cmd
+   "Name> " SOUNDDLLPRO_CMD_FILEREADSTATS "\n"                          // help
+   "Help> returns statistics of threads reading wave files since last start\n"
+   "Ret.> threads:   number of file reading threads,\n"
+   "      queuedepth: number of currently pending buffer refills,\n"
+   "      maxqueuedepth: maximum number of pending buffer refills,\n"
+   "      requests:  number of buffer refills done,\n"
+   "      missed:    number of buffer refills done after the buffer\n"
+   "                 was expected to run dry,\n"
+   "      worstslack: minimum time in milliseconds between end of a refill\n"
+   "                 and the time the buffer was expected to run dry (negative\n"
+   "                 if refills were too late),\n"
+   "      reattaches: number of file channels that were detached from a file\n"
+   "                 shared with other channels (by positioning only some of\n"
+   "                 them) and were re-opened by a file reading thread,\n"
+   "      underrunsamples: number of samples played as zeros by such channels\n"
+   "                 while waiting for being re-opened.",
+   "",                                                                  // arguments
+   FileReadStats,                                                       // function pointer
+   1                                                                    // must be initialized
+},
+{  SOUNDDLLPRO_CMD_RECWRITESTATS,                                       // cmd
+   "Name> " SOUNDDLLPRO_CMD_RECWRITESTATS "\n"                          // help
+   "Help> returns statistics of the thread writing record files since last\n"
+   "      start\n"
+   "Ret.> blocks:    total number of blocks (see 'recwritebufsize' in\n"
+   "                 command 'init'),\n"
+   "      blocksize: size of one block in bytes,\n"
+   "      files:     number of open files written by the thread,\n"
+   "      syncfiles: number of open files written directly, because no\n"
+   "                 blocks were left to reserve,\n"
+   "      queuedepth: number of blocks currently queued for writing,\n"
+   "      maxqueuedepth: maximum number of blocks queued for writing,\n"
+   "      maxblocksused: maximum number of blocks in use (queued or being\n"
+   "                 filled),\n"
+   "      bytes:     number of bytes written,\n"
+   "      writes:    number of block writes,\n"
+   "      stalls:    number of times recording had to wait for a free block,\n"
+   "      stalltime: total time in milliseconds recording had to wait,\n"
+   "      maxstalltime: maximum time in milliseconds of one wait,\n"
+   "      maxwritetime: maximum time in milliseconds for writing one block.",
+   "",                                                                  // arguments
+   RecWriteStats,                                                       // function pointer
+   1                                                                    // must be initialized
+},
+{  SOUNDDLLPRO_CMD_LOADMEMSTATS,                                        // cmd
+   "Name> " SOUNDDLLPRO_CMD_LOADMEMSTATS "\n"                           // help
+   "Help> returns memory usage of sample data loaded with command 'loadmem'\n"
+   "Ret.> blocks:    number of stored data blocks (one per data channel),\n"
+   "      references: number of loaded objects using the blocks,\n"
+   "      bytes:     memory used by stored data blocks,\n"
+   "      savedbytes: memory saved by sharing data blocks,\n"
+   "      hits:      number of loaded channels that used an existing block,\n"
+   "      misses:    number of loaded channels that created a new block.",
+   "",                                                                  // arguments
+   LoadMemStats,                                                        // function pointer
+   1                                                                    // must be initialized
+},
+{  SOUNDDLLPRO_CMD_PERFREPORT,                                          // cmd
+   "Name> " SOUNDDLLPRO_CMD_PERFREPORT "\n"                             // help
+   "Help> returns a performance report of the current or last run as JSON\n"
+   "      object for tracking performance over time. Contains driver model,\n"
+   "      samplerate, buffer size, buffer deadline (duration of one buffer),\n"
+   "      number of processed buffers, elapsed time, realtime factors (audio\n"
+   "      time per wall clock time and per dsp time), number of buffers\n"
+   "      exceeding the deadline, xruns, peak memory of the process and for\n"
+   "      each stage (see 'perfstats')\n"
+   "      the count, mean, percentiles (50, 90, 99, 99.9) and maximum of the\n"
+   "      processing times in milliseconds. Percentiles are read from\n"
+   "      histograms (see 'perfstats'). For reproducible offline benchmarks use\n"
+   "      driver model 'null' with 'nullclock' set to 1 (NOTE: without queues\n"
+   "      and processing/done threads, see 'nullclock').\n"
+   "Par.> filename:  name of file to write report to (optional)\n"
+   "Ret.> value:     JSON report (only returned if no filename is passed)",
+   SOUNDDLLPRO_PAR_FILENAME ",",                                        // arguments
+   PerfReport,                                                          // function pointer
+   1                                                                    // must be initialized
+},
+{  SOUNDDLLPRO_CMD_PERFSTATS,                                           // cmd
+   "Name> " SOUNDDLLPRO_CMD_PERFSTATS "\n"                              // help
+   "Help> returns statistics of processing times of all performance stages\n"
+   "      since last start or last call to 'perfstatsreset'. May be called\n"
+   "      while device is running. Stages are: dsp (total processing),\n"
+   "      vstrec, vsttrack, vstmaster (VST plugins), ml (MATLAB callbacks),\n"
+   "      rec (recording), vis (visualization), callback (driver callback)\n"
+   "      and queuewait (waiting for buffers in processing queues). Values are\n"
+   "      read from log-bucketed histograms with a resolution of 12.5 percent.\n"
+   "Ret.> name:      names of stages,\n"
+   "      count:     number of measured values per stage,\n"
+   "      p50:       median in milliseconds per stage,\n"
+   "      p99:       99th percentile in milliseconds per stage,\n"
+   "      p999:      99.9th percentile in milliseconds per stage,\n"
+   "      maxvalue:  maximum in milliseconds per stage.",
+   "",                                                                  // arguments
+   PerfStats,                                                           // function pointer
+   1                                                                    // must be initialized
+},
+{  SOUNDDLLPRO_CMD_PERFSTATSRESET,                                      // cmd
+   "Name> " SOUNDDLLPRO_CMD_PERFSTATSRESET "\n"                         // help
+   "Help> resets statistics of all performance stages (see command\n"
+   "      'perfstats'). May be called while device is running.",
+   "",                                                                  // arguments
+   PerfStatsReset,                                                      // function pointer
+   1                                                                    // must be initialized
+},
+{  SOUNDDLLPRO_CMD_TRACEDUMP,                                           // cmd
+   "Name> " SOUNDDLLPRO_CMD_TRACEDUMP "\n"                              // help
+   "Help> writes events of the trace ring to a file in Chrome trace JSON\n"
+   "      format (to be opened with chrome://tracing or ui.perfetto.dev).\n"
+   "      Each event is tagged with thread and index of processed buffer.\n"
+   "      Tracing must be enabled with 'tracesize' in command 'init'. May be\n"
+   "      called while device is running.\n"
+   "Par.> filename:  name of file to write trace to\n"
+   "      length:    length of trace in seconds before the newest event\n"
+   "                 (optional, default: 0 writes all events of trace ring)",
+   SOUNDDLLPRO_PAR_FILENAME ","                                         // arguments
+   SOUNDDLLPRO_PAR_LENGTH ",",
+   TraceDump,                                                           // function pointer
+   1                                                                    // must be initialized
+},
 {  SOUNDDLLPRO_CMD_BETATEST,                                               // cmd
    "Name> " SOUNDDLLPRO_CMD_BETATEST "\n"                                  // help
    "Help> Betatest command. No help",
@@ -447,8 +447,11 @@ __declspec(dllexport) int cdecl SoundMexPro(const char* lpcszCommand, char* lpcs
                      throw SOUNDMEX_Error("invalid data position value returned from command: " + GetValue(vsRet, SOUNDDLLPRO_PAR_POSITION));
                   }
 
-               // then compare it with sizes that MUST have been passed from Python
-               if (nSamplesPy != nBufSize)
+               // then compare it with sizes that MUST have been passed from Python.
+               // NOTE: streaming reads of recgetdata (cursor passed) return up to
+               // 'samples' samples per channel
+               bool bCursor = GetValue(vsRet, SOUNDDLLPRO_PAR_CURSOR).length() > 0;
+               if (bCursor ? nSamplesPy < nBufSize : nSamplesPy != nBufSize)
                   {
                   AnsiString as;
                   as.printf("sample count mismatch Python/SoundDllPro (%d/%d)", (int)nSamplesPy,  (int)nBufSize);
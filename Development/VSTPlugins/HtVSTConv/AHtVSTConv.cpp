@@ -28,6 +28,7 @@
 ///
 //------------------------------------------------------------------------------
 #include "AHtVSTConv.h"
+#include <inifiles.hpp>
 
 #include <stdio.h>
 #include <windows.h>
@@ -43,20 +44,71 @@ static float dBToFactor(const float f4dB)
 }
 //--------------------------------------------------------------------------
 
+//--------------------------------------------------------------------------
+/// constructor: initializes members and output buffers
+//--------------------------------------------------------------------------
+CHtConvInstance::CHtConvInstance(AnsiString str, unsigned int nBlockSize)
+   :  m_hConvolver(NULL),
+      m_nBlockSize(nBlockSize),
+      m_strImpulseResponse(str),
+      m_vvfOut(MAX_CHANNELS, std::vector<float>(nBlockSize)),
+      m_vpfOut(MAX_CHANNELS)
+{
+   for (unsigned int nChannel = 0; nChannel < MAX_CHANNELS; nChannel++)
+      m_vpfOut[nChannel] = nBlockSize ? &m_vvfOut[nChannel][0] : NULL;
+}
+//--------------------------------------------------------------------------
+
+//--------------------------------------------------------------------------
+/// constructor: starts thread
+//--------------------------------------------------------------------------
+CHtVSTConvLoader::CHtVSTConvLoader(CHtVSTConvolver* pConvolver)
+   :  TThread(false),
+      m_pConvolver(pConvolver)
+{
+}
+//--------------------------------------------------------------------------
+
+//--------------------------------------------------------------------------
+/// threads execute routine. Waits for requests or retired convolvers
+//--------------------------------------------------------------------------
+void __fastcall CHtVSTConvLoader::Execute()
+{
+   while (!Terminated)
+      {
+      WaitForSingleObject(m_pConvolver->m_hLoad, 1000);
+      if (Terminated)
+         break;
+      m_pConvolver->ProcessRequests();
+      }
+}
+//--------------------------------------------------------------------------
+
 //--------------------------------------------------------------------------
 /// constructor: calls base class and initializes members
 //--------------------------------------------------------------------------
 CHtVSTConvolver::CHtVSTConvolver (audioMasterCallback audioMaster)
-   :  AudioEffectX (audioMaster, 1, 2), // programs, parameters
+   :  AudioEffectX (audioMaster, 1, 3), // programs, parameters
       m_bIsValid(false),
-      m_hConvolver(NULL),
       m_fGain(1.0f),
       m_fEnabled(1.0f),
-      m_bSkip(false),
+      m_fXFade((float)DEFAULT_XFADE_BLOCKS / (float)MAX_XFADE_BLOCKS),
       m_hLibrary(NULL),
+      m_nRequestBlockSize(0),
+      m_bRequest(false),
+      m_hLoad(NULL),
+      m_pLoader(NULL),
+      m_pciActive(NULL),
+      m_pciFadeOut(NULL),
+      m_pciPending(NULL),
+      m_pciRetired(NULL),
+      m_nFadePos(0),
+      m_nFadeLen(0),
       m_lpfnConvInit(NULL),
       m_lpfnConvExit(NULL),
-      m_lpfnConvProcess(NULL)
+      m_lpfnConvProcess(NULL),
+      m_lpfnConvGetPlanStats(NULL),
+      m_bReportPlanning(false)
 {
    InitializeCriticalSection(&m_csDataSection);
    setNumInputs (MAX_CHANNELS);
@@ -92,11 +144,24 @@ CHtVSTConvolver::CHtVSTConvolver (audioMasterCallback audioMaster)
       if (!m_lpfnConvProcess)
          throw Exception("cannot load 'ConvProcess' function from library '" + asLib + "'");
 
+      SetPlanMode(ChangeFileExt(c, ".ini"), asLib);
+      SetPartitioning(ChangeFileExt(c, ".ini"), asLib);
+
+      m_hLoad = CreateEvent(NULL, FALSE, FALSE, NULL);
+      if (!m_hLoad)
+         throw Exception("cannot create event for loader thread");
+      m_pLoader = new CHtVSTConvLoader(this);
+
       // set 'valid flag' (used in _main)
       m_bIsValid = true;
       }
    catch (Exception &e)
       {
+      if (m_hLoad)
+         {
+         CloseHandle(m_hLoad);
+         m_hLoad = NULL;
+         }
       if (!!m_hLibrary)
          FreeLibrary(m_hLibrary);
       m_hLibrary = NULL;
@@ -126,91 +191,270 @@ CHtVSTConvolver::~CHtVSTConvolver ()
 //--------------------------------------------------------------------------
 
 //--------------------------------------------------------------------------
-/// (Re-)initializes convolution DLL
+/// reads FFTW planning effort from optional settings file next to the plugin
+/// (section 'Settings', key 'FFTPlanMode': estimate, measure or patient) and
+/// passes it to the library. Not supported by older libraries
+/// \param[in] strIniFile name of settings file
+/// \param[in] strLib name of library for error messages
+//--------------------------------------------------------------------------
+void CHtVSTConvolver::SetPlanMode(AnsiString strIniFile, AnsiString strLib)
+{
+   if (!FileExists(strIniFile))
+      return;
+   TMemIniFile* pIni = new TMemIniFile(strIniFile);
+   try
+      {
+      int nMode = CONV_PLANMODE_ESTIMATE;
+      UnicodeString us = LowerCase(pIni->ReadString("Settings", "FFTPlanMode", "estimate"));
+      if (us == "measure")
+         nMode = CONV_PLANMODE_MEASURE;
+      else if (us == "patient")
+         nMode = CONV_PLANMODE_PATIENT;
+      else if (us != "estimate")
+         throw Exception("invalid FFTPlanMode found in settings file '" + strIniFile + "'");
+      if (nMode == CONV_PLANMODE_ESTIMATE)
+         return;
+
+      LPFNCONVSETPLANMODE lpfnConvSetPlanMode = (LPFNCONVSETPLANMODE)GetProcAddress(m_hLibrary, "ConvSetPlanMode");
+      if (!lpfnConvSetPlanMode)
+         lpfnConvSetPlanMode = (LPFNCONVSETPLANMODE)GetProcAddress(m_hLibrary, "_ConvSetPlanMode");
+      if (!lpfnConvSetPlanMode)
+         throw Exception("FFTPlanMode not supported by library '" + strLib + "'");
+      lpfnConvSetPlanMode(nMode);
+
+      m_lpfnConvGetPlanStats = (LPFNCONVGETPLANSTATS)GetProcAddress(m_hLibrary, "ConvGetPlanStats");
+      if (!m_lpfnConvGetPlanStats)
+         m_lpfnConvGetPlanStats = (LPFNCONVGETPLANSTATS)GetProcAddress(m_hLibrary, "_ConvGetPlanStats");
+      m_bReportPlanning = !!m_lpfnConvGetPlanStats;
+      }
+   __finally
+      {
+      delete pIni;
+      }
+}
+//--------------------------------------------------------------------------
+
+//--------------------------------------------------------------------------
+/// reads maximum partition size for non-uniform partitioned convolution from
+/// optional settings file next to the plugin (section 'Settings', key
+/// 'MaxPartitionSize', default 0: uniform partitions) and passes it to the
+/// library. Non-uniform convolution runs one high priority thread per
+/// partition level, so it is opt-in. Not supported by older libraries
+/// \param[in] strIniFile name of settings file
+/// \param[in] strLib name of library for error messages
+//--------------------------------------------------------------------------
+void CHtVSTConvolver::SetPartitioning(AnsiString strIniFile, AnsiString strLib)
+{
+   if (!FileExists(strIniFile))
+      return;
+   TMemIniFile* pIni = new TMemIniFile(strIniFile);
+   try
+      {
+      int nSize = pIni->ReadInteger("Settings", "MaxPartitionSize", 0);
+      if (nSize < 0)
+         throw Exception("invalid MaxPartitionSize found in settings file '" + strIniFile + "'");
+      if (!nSize)
+         return;
+
+      LPFNCONVSETMAXPARTITIONSIZE lpfnConvSetMaxPartitionSize = (LPFNCONVSETMAXPARTITIONSIZE)GetProcAddress(m_hLibrary, "ConvSetMaxPartitionSize");
+      if (!lpfnConvSetMaxPartitionSize)
+         lpfnConvSetMaxPartitionSize = (LPFNCONVSETMAXPARTITIONSIZE)GetProcAddress(m_hLibrary, "_ConvSetMaxPartitionSize");
+      if (!lpfnConvSetMaxPartitionSize)
+         throw Exception("MaxPartitionSize not supported by library '" + strLib + "'");
+      lpfnConvSetMaxPartitionSize((unsigned)nSize);
+      }
+   __finally
+      {
+      delete pIni;
+      }
+}
+//--------------------------------------------------------------------------
+
+//--------------------------------------------------------------------------
+/// requests a convolver for an impulse response and the current block size.
+/// The convolver is created by the loader thread and crossfaded in by the
+/// audio thread. Requests not processed yet are replaced
 //--------------------------------------------------------------------------
 void CHtVSTConvolver::InitConv(AnsiString str)
 {
    if (!m_hLibrary)
       throw Exception("Fatal error: lib not loaded");
-   m_bSkip = true;
    EnterCriticalSection(&m_csDataSection);
+   m_strRequest         = str;
+   m_nRequestBlockSize  = (unsigned int)blockSize;
+   m_bRequest           = true;
+   LeaveCriticalSection(&m_csDataSection);
+   SetEvent(m_hLoad);
+}
+//--------------------------------------------------------------------------
+
+//--------------------------------------------------------------------------
+/// stops loader thread and deletes all convolvers
+//--------------------------------------------------------------------------
+void CHtVSTConvolver::ExitConv()
+{
+   if (!m_hLibrary)
+      return;
    try
       {
-      ExitConv();
-      CWaveFileReader wfr;
-      try
+      if (m_pLoader)
          {
-         wfr.Load(str.c_str());
+         m_pLoader->Terminate();
+         SetEvent(m_hLoad);
+         m_pLoader->WaitFor();
+         delete m_pLoader;
+         m_pLoader = NULL;
          }
-      catch (LPCTSTR lpcsz)
+      if (m_hLoad)
          {
-         MessageBox(0, lpcsz, "Error", 0);
-         return;
+         CloseHandle(m_hLoad);
+         m_hLoad = NULL;
          }
+      DeleteInstance(m_pciActive);
+      m_pciActive = NULL;
+      DeleteInstance(m_pciFadeOut);
+      m_pciFadeOut = NULL;
+      DeleteInstance(m_pciPending);
+      m_pciPending = NULL;
+      DeleteInstance(m_pciRetired);
+      m_pciRetired = NULL;
+      }
+   catch (...)
+      {
+      }
+}
+//--------------------------------------------------------------------------
+
+//--------------------------------------------------------------------------
+/// processes requests in loader thread: deletes convolver passed back by
+/// audio thread and creates convolver for last request. The new convolver
+/// is published to audio thread atomically. A published convolver that was
+/// not taken by the audio thread yet is replaced and deleted
+//--------------------------------------------------------------------------
+void CHtVSTConvolver::ProcessRequests()
+{
+   DeleteInstance((CHtConvInstance*)InterlockedExchangePointer((PVOID volatile*)&m_pciRetired, NULL));
+
+   EnterCriticalSection(&m_csDataSection);
+   bool bRequest           = m_bRequest;
+   AnsiString str          = m_strRequest;
+   unsigned int nBlockSize = m_nRequestBlockSize;
+   m_bRequest              = false;
+   LeaveCriticalSection(&m_csDataSection);
+   if (!bRequest)
+      return;
+
+   CHtConvInstance* pci = CreateInstance(str, nBlockSize);
+   if (!pci)
+      return;
+   DeleteInstance((CHtConvInstance*)InterlockedExchangePointer((PVOID volatile*)&m_pciPending, pci));
+   EnterCriticalSection(&m_csDataSection);
+   m_strImpulseResponse = str;
+   LeaveCriticalSection(&m_csDataSection);
+}
+//--------------------------------------------------------------------------
 
+//--------------------------------------------------------------------------
+/// loads impulse response and creates convolver. Called in loader thread
+/// \retval new convolver or NULL on error
+//--------------------------------------------------------------------------
+CHtConvInstance* CHtVSTConvolver::CreateInstance(AnsiString str, unsigned int nBlockSize)
+{
+   CWaveFileReader wfr;
+   try
+      {
+      wfr.Load(str.c_str());
+      }
+   catch (LPCTSTR lpcsz)
+      {
+      MessageBox(0, lpcsz, "Error", 0);
+      return NULL;
+      }
+
+   CHtConvInstance* pci = new CHtConvInstance(str, nBlockSize);
+   try
+      {
       #pragma clang diagnostic push
       #pragma clang diagnostic ignored "-Wcast-qual"
-      m_hConvolver = m_lpfnConvInit((unsigned int)blockSize, MAX_CHANNELS, wfr.m_nSize, (const float**)wfr.m_lpData);
-      #pragma clang diagnostic pop      
-      m_strImpulseResponse = str;
-      m_bSkip = false;
+      pci->m_hConvolver = m_lpfnConvInit(nBlockSize, MAX_CHANNELS, wfr.m_nSize, (const float**)wfr.m_lpData);
+      #pragma clang diagnostic pop
       }
-   __finally
+   catch (...)
       {
-      LeaveCriticalSection(&m_csDataSection);
       }
+   if (!pci->m_hConvolver)
+      {
+      delete pci;
+      return NULL;
+      }
+   if (m_bReportPlanning)
+      {
+      unsigned int nPlans  = 0;
+      double dPlanningMs   = 0.0;
+      m_lpfnConvGetPlanStats(&nPlans, &dPlanningMs);
+      AnsiString strReport;
+      strReport.printf("HtVSTConv: %u FFT plans, total planning time %.1lf ms", nPlans, dPlanningMs);
+      OutputDebugString(strReport.c_str());
+      }
+   return pci;
 }
 //--------------------------------------------------------------------------
 
 //--------------------------------------------------------------------------
-/// exits convolution DLL
+/// deletes a convolver. Never called in audio thread
 //--------------------------------------------------------------------------
-void CHtVSTConvolver::ExitConv()
+void CHtVSTConvolver::DeleteInstance(CHtConvInstance* pci)
 {
-   if (!m_hLibrary)
+   if (!pci)
       return;
    try
       {
-      EnterCriticalSection(&m_csDataSection);
-      try
-         {
-         if (m_hConvolver)
-            m_lpfnConvExit(m_hConvolver);
-         m_hConvolver = NULL;
-         }
-      __finally
-         {
-         LeaveCriticalSection(&m_csDataSection);
-         }
+      if (pci->m_hConvolver)
+         m_lpfnConvExit(pci->m_hConvolver);
       }
    catch (...)
       {
       }
+   delete pci;
+}
+//--------------------------------------------------------------------------
+
+//--------------------------------------------------------------------------
+/// passes a convolver from audio thread back to loader thread for deletion.
+/// NOTE: audio thread takes new convolvers only if m_pciRetired is empty, so
+/// a retired convolver is never overwritten
+//--------------------------------------------------------------------------
+void CHtVSTConvolver::RetireInstance(CHtConvInstance* pci)
+{
+   if (!pci)
+      return;
+   InterlockedExchangePointer((PVOID volatile*)&m_pciRetired, pci);
+   SetEvent(m_hLoad);
+}
+//--------------------------------------------------------------------------
+
+//--------------------------------------------------------------------------
+/// returns true if a convolver can be used with current block size
+//--------------------------------------------------------------------------
+bool CHtVSTConvolver::IsUsable(CHtConvInstance* pci)
+{
+   return pci && pci->m_nBlockSize == (unsigned int)blockSize;
 }
 //--------------------------------------------------------------------------
 
 //--------------------------------------------------------------------------
-/// sets block size
+/// sets block size. Convolver for new block size is requested
 //--------------------------------------------------------------------------
 void CHtVSTConvolver::setBlockSize (VstInt32 nBlockSize)
 {
-   if (blockSize != nBlockSize || !m_hConvolver)
+   if (blockSize != nBlockSize)
       {
+      blockSize = nBlockSize;
       EnterCriticalSection(&m_csDataSection);
-      try
-         {
-         bool bWasInit = !m_strImpulseResponse.IsEmpty();
-         ExitConv();
-
-         blockSize = nBlockSize;
-
-         if (bWasInit)
-            InitConv(m_strImpulseResponse);
-         }
-      __finally
-         {
-         LeaveCriticalSection(&m_csDataSection);
-         }
+      AnsiString str = m_strRequest;
+      LeaveCriticalSection(&m_csDataSection);
+      if (!str.IsEmpty())
+         InitConv(str);
       }
 }
 //--------------------------------------------------------------------------
@@ -232,10 +476,12 @@ void CHtVSTConvolver::setProgramName (char *name)
 //--------------------------------------------------------------------------
 void CHtVSTConvolver::getProgramName (char *name)
 {
+   EnterCriticalSection(&m_csDataSection);
    if (m_strImpulseResponse.IsEmpty())
       strcpy (name, "default");
    else
       strcpy (name, m_strImpulseResponse.c_str());
+   LeaveCriticalSection(&m_csDataSection);
 }
 //--------------------------------------------------------------------------
 
@@ -246,8 +492,10 @@ void CHtVSTConvolver::setParameter (VstInt32 index, float value)
 {
    if (index == 0)
       m_fEnabled = value;
-   else
+   else if (index == 1)
       m_fGain = value;
+   else
+      m_fXFade = value;
 }
 //--------------------------------------------------------------------------
 
@@ -256,7 +504,9 @@ void CHtVSTConvolver::setParameter (VstInt32 index, float value)
 //--------------------------------------------------------------------------
 float CHtVSTConvolver::getParameter (VstInt32 index)
 {
-   return (index == 0) ? m_fEnabled : m_fGain;
+   if (index == 0)
+      return m_fEnabled;
+   return (index == 1) ? m_fGain : m_fXFade;
 }
 //--------------------------------------------------------------------------
 
@@ -267,8 +517,10 @@ void CHtVSTConvolver::getParameterName (VstInt32 index, char *label)
 {
    if (index == 0)
       strcpy(label, "enabled");
-   else
+   else if (index == 1)
       strcpy(label, "gain");
+   else
+      strcpy(label, "xfade");
 }
 //--------------------------------------------------------------------------
 
@@ -279,8 +531,10 @@ void CHtVSTConvolver::getParameterDisplay (VstInt32 index, char *text)
 {
    if (index == 0)
       sprintf(text, m_fEnabled > 0.5f ? "true" : "false");
-   else
+   else if (index == 1)
       sprintf(text, "%.2f", 50.0 * (double)m_fGain - 50.0);
+   else
+      sprintf(text, "%d", (int)(m_fXFade * MAX_XFADE_BLOCKS + 0.5f));
 }
 //--------------------------------------------------------------------------
 
@@ -292,8 +546,10 @@ void CHtVSTConvolver::getParameterLabel(VstInt32 index, char *label)
 {
    if (index == 0)
       strcpy (label, " ");
-   else
+   else if (index == 1)
       strcpy (label, "dB");
+   else
+      strcpy (label, "blocks");
 }
 //--------------------------------------------------------------------------
 
@@ -330,46 +586,95 @@ bool CHtVSTConvolver::getVendorString (char* text)
 
 
 //--------------------------------------------------------------------------
-/// Processing routine called by process and processReplacing
+/// Processing routine called by process and processReplacing. Takes new
+/// convolver published by loader thread and crossfades from old to new
+/// convolver output. Never waits for loader thread
 //--------------------------------------------------------------------------
 #pragma argsused
 void CHtVSTConvolver::DoProcess (float **inputs, float **outputs, VstInt32 sampleFrames, bool bReplace)
 {
-   if (m_bSkip || !m_hConvolver || m_fEnabled <= 0.5f)
+   // take new convolver, if no crossfade is running and the last retired
+   // convolver was deleted
+   if (!m_pciFadeOut && !m_pciRetired && m_pciPending)
+      {
+      CHtConvInstance* pci = (CHtConvInstance*)InterlockedExchangePointer((PVOID volatile*)&m_pciPending, NULL);
+      if (pci)
+         {
+         unsigned int nXFadeBlocks = (unsigned int)(m_fXFade * MAX_XFADE_BLOCKS + 0.5f);
+         if (IsUsable(m_pciActive) && IsUsable(pci) && nXFadeBlocks && m_fEnabled > 0.5f)
+            {
+            m_pciFadeOut   = m_pciActive;
+            m_nFadePos     = 0;
+            m_nFadeLen     = nXFadeBlocks * (unsigned int)blockSize;
+            }
+         else
+            RetireInstance(m_pciActive);
+         m_pciActive = pci;
+         }
+      }
+
+   // crossfade is stopped if old convolver cannot be used any longer
+   if (m_pciFadeOut && (!IsUsable(m_pciFadeOut) || !IsUsable(m_pciActive) || m_fEnabled <= 0.5f))
+      {
+      RetireInstance(m_pciFadeOut);
+      m_pciFadeOut = NULL;
+      }
+
+   if (!IsUsable(m_pciActive) || m_fEnabled <= 0.5f)
       {
       MoveMemory(outputs[0], inputs[0], (unsigned int)sampleFrames*sizeof(float));
       MoveMemory(outputs[1], inputs[1], (unsigned int)sampleFrames*sizeof(float));
       return;
       }
 
-   EnterCriticalSection(&m_csDataSection);
-   try
+   if (!m_pciFadeOut)
+      m_lpfnConvProcess(m_pciActive->m_hConvolver, (unsigned int)blockSize, MAX_CHANNELS, MAX_CHANNELS, inputs, outputs);
+   else
       {
-
-      m_lpfnConvProcess(m_hConvolver, (unsigned int)blockSize, MAX_CHANNELS, MAX_CHANNELS, inputs, outputs);
-
-
-      if (m_fGain != 1.0f)
+      // process both convolvers into own buffers (inputs and outputs may be
+      // identical) and fade linearly from old to new output
+      m_lpfnConvProcess(m_pciFadeOut->m_hConvolver, (unsigned int)blockSize, MAX_CHANNELS, MAX_CHANNELS, inputs, &m_pciFadeOut->m_vpfOut[0]);
+      m_lpfnConvProcess(m_pciActive->m_hConvolver, (unsigned int)blockSize, MAX_CHANNELS, MAX_CHANNELS, inputs, &m_pciActive->m_vpfOut[0]);
+      float fStep = 1.0f / (float)m_nFadeLen;
+      unsigned int nSamples = (unsigned int)blockSize;
+      for (int nIndex = 0; nIndex < MAX_CHANNELS; nIndex++)
          {
-         float fGain = dBToFactor(50.0f * m_fGain - 50.0f);
-         float *lpf;
-         int nSamples;
-         for (int nIndex = 0; nIndex < MAX_CHANNELS; nIndex++)
+         if (!outputs[nIndex])
+            continue;
+         const float *lpfOld = &m_pciFadeOut->m_vvfOut[(unsigned int)nIndex][0];
+         const float *lpfNew = &m_pciActive->m_vvfOut[(unsigned int)nIndex][0];
+         for (unsigned int nSample = 0; nSample < nSamples; nSample++)
             {
-            if (!outputs[nIndex])
-               continue;
-            nSamples = sampleFrames;
-            lpf = &outputs[nIndex][0];
-            while(nSamples--)
-               {
-               *lpf++ *= fGain;
-               }
+            float fNew = (float)(m_nFadePos + nSample + 1) * fStep;
+            if (fNew > 1.0f)
+               fNew = 1.0f;
+            outputs[nIndex][nSample] = lpfOld[nSample] + fNew * (lpfNew[nSample] - lpfOld[nSample]);
             }
          }
+      m_nFadePos += nSamples;
+      if (m_nFadePos >= m_nFadeLen)
+         {
+         RetireInstance(m_pciFadeOut);
+         m_pciFadeOut = NULL;
+         }
       }
-   __finally
+
+   if (m_fGain != 1.0f)
       {
-      LeaveCriticalSection(&m_csDataSection);
+      float fGain = dBToFactor(50.0f * m_fGain - 50.0f);
+      float *lpf;
+      int nSamples;
+      for (int nIndex = 0; nIndex < MAX_CHANNELS; nIndex++)
+         {
+         if (!outputs[nIndex])
+            continue;
+         nSamples = sampleFrames;
+         lpf = &outputs[nIndex][0];
+         while(nSamples--)
+            {
+            *lpf++ *= fGain;
+            }
+         }
       }
 }
 //--------------------------------------------------------------------------
@@ -42,10 +42,15 @@
 #include "audioeffectx.h"
 #pragma clang diagnostic pop
 
+#include <vector>
 #include "WaveFileReader.h"
 #include "ConvLibDefines.h"
 
 #define MAX_CHANNELS    2
+/// maximum number of blocks for crossfading between impulse responses
+#define MAX_XFADE_BLOCKS      64
+/// default number of blocks for crossfading between impulse responses
+#define DEFAULT_XFADE_BLOCKS  4
 
 
 void EnsureFFTW();
@@ -53,11 +58,44 @@ void EnsureFFTW();
 
 extern HINSTANCE__* hInstance;
 
+class CHtVSTConvolver;
+
+//------------------------------------------------------------------------------
+/// convolver created by convolution DLL for one impulse response and block
+/// size, prefix ci
+//------------------------------------------------------------------------------
+class CHtConvInstance
+{
+   public:
+      CHtConvInstance(AnsiString str, unsigned int nBlockSize);
+      void*                            m_hConvolver;           /// handle returned by ConvInit
+      unsigned int                     m_nBlockSize;           /// block size of convolver
+      AnsiString                       m_strImpulseResponse;   /// file name of impulse response
+      std::vector<std::vector<float> > m_vvfOut;               /// output buffers used for crossfading
+      std::vector<float*>              m_vpfOut;               /// pointers to m_vvfOut
+};
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+/// thread creating and deleting convolvers for CHtVSTConvolver, so the audio
+/// thread never waits for an impulse response to be loaded
+//------------------------------------------------------------------------------
+class CHtVSTConvLoader : public TThread
+{
+   public:
+      CHtVSTConvLoader(CHtVSTConvolver* pConvolver);
+      void __fastcall Execute();
+   private:
+      CHtVSTConvolver*  m_pConvolver;
+};
+//------------------------------------------------------------------------------
+
 //------------------------------------------------------------------------------
 /// CHtVSTConvolver VST plugin for fast parttitioned convolution
 //------------------------------------------------------------------------------
 class CHtVSTConvolver : public AudioEffectX
 {
+   friend class CHtVSTConvLoader;
    public:
       CHtVSTConvolver (audioMasterCallback audioMaster);
       ~CHtVSTConvolver ();
@@ -92,18 +130,37 @@ class CHtVSTConvolver : public AudioEffectX
       virtual VstPlugCategory getPlugCategory () { return kPlugCategEffect; }
 
    private:
-      _RTL_CRITICAL_SECTION   m_csDataSection;
-      void*                   m_hConvolver;
+      _RTL_CRITICAL_SECTION   m_csDataSection;        /// protects request and name of impulse response
       float                   m_fGain;
       float                   m_fEnabled;
-      bool                    m_bSkip;
+      float                   m_fXFade;               /// crossfade length (0-1 for 0-MAX_XFADE_BLOCKS blocks)
       HINSTANCE               m_hLibrary;
-      AnsiString              m_strImpulseResponse;
+      AnsiString              m_strImpulseResponse;   /// impulse response of last convolver created
+      AnsiString              m_strRequest;           /// impulse response requested last
+      unsigned int            m_nRequestBlockSize;    /// block size requested last
+      bool                    m_bRequest;             /// flag if request was not processed yet
+      HANDLE                  m_hLoad;                /// event signalling request or retired convolver to loader
+      CHtVSTConvLoader*       m_pLoader;
+      CHtConvInstance*        m_pciActive;            /// convolver used by audio thread (audio thread only)
+      CHtConvInstance*        m_pciFadeOut;           /// convolver faded out (audio thread only)
+      CHtConvInstance* volatile m_pciPending;         /// new convolver published by loader
+      CHtConvInstance* volatile m_pciRetired;         /// convolver passed back to loader for deletion
+      unsigned int            m_nFadePos;             /// current position in crossfade (samples)
+      unsigned int            m_nFadeLen;             /// length of current crossfade (samples)
       LPFNCONVINIT            m_lpfnConvInit;
       LPFNCONVEXIT            m_lpfnConvExit;
       LPFNCONVPROCESS         m_lpfnConvProcess;
+      LPFNCONVGETPLANSTATS    m_lpfnConvGetPlanStats;
+      bool                    m_bReportPlanning;      /// flag if FFTW planning statistics are reported
+      void                    SetPlanMode(AnsiString strIniFile, AnsiString strLib);
+      void                    SetPartitioning(AnsiString strIniFile, AnsiString strLib);
       void                    InitConv(AnsiString str);
       void                    ExitConv();
+      void                    ProcessRequests();
+      CHtConvInstance*        CreateInstance(AnsiString str, unsigned int nBlockSize);
+      void                    DeleteInstance(CHtConvInstance* pci);
+      void                    RetireInstance(CHtConvInstance* pci);
+      bool                    IsUsable(CHtConvInstance* pci);
 
 };
 //------------------------------------------------------------------------------
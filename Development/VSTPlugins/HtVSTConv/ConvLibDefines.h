@@ -34,5 +34,13 @@
 typedef void*  (cdecl *LPFNCONVINIT)(unsigned, unsigned, unsigned, const float**);
 typedef void   (cdecl *LPFNCONVEXIT)(void*);
 typedef int    (cdecl *LPFNCONVPROCESS)(void*, unsigned, unsigned, unsigned, float* const*, float* const*);
+// optional functions (not exported by older libraries)
+/// FFTW planning effort passed to ConvSetPlanMode (values of THtFFTPlanMode)
+#define CONV_PLANMODE_ESTIMATE   0
+#define CONV_PLANMODE_MEASURE    1
+#define CONV_PLANMODE_PATIENT    2
+typedef void   (cdecl *LPFNCONVSETPLANMODE)(int);
+typedef void   (cdecl *LPFNCONVGETPLANSTATS)(unsigned*, double*);
+typedef void   (cdecl *LPFNCONVSETMAXPARTITIONSIZE)(unsigned);
 
 #endif // ConvLibDefinesH
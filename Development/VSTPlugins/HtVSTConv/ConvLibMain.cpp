@@ -31,6 +31,12 @@
 //------------------------------------------------------------------------------
 #include <windows.h>
 #include "HtPartitionedConvolution.h"
+#include "ConvLibDefines.h"
+
+/// maximum partition size used for tails of long impulse responses (non-uniform
+/// partitioned convolution, see ConvSetMaxPartitionSize). 0 (default): uniform
+/// partitions of fragment size
+static unsigned g_nMaxPartitionSize = 0;
 
 //------------------------------------------------------------------------------
 /// exported functions for VST plugin
@@ -55,6 +61,18 @@ extern "C" {
                                           float * const* ppfDataIn,
                                           float * const* ppfDataOut);
 }
+
+extern "C" {
+   __declspec(dllexport) void ConvSetPlanMode(int nMode);
+}
+
+extern "C" {
+   __declspec(dllexport) void ConvGetPlanStats(unsigned * pnPlans, double * pdPlanningMs);
+}
+
+extern "C" {
+   __declspec(dllexport) void ConvSetMaxPartitionSize(unsigned nSize);
+}
 //------------------------------------------------------------------------------
 
 //------------------------------------------------------------------------------
@@ -77,7 +95,7 @@ void* ConvInit(unsigned nFragsize, unsigned nChannels, unsigned nIrsLen, const f
 
    tfs.push_back(CHtTransferFunction(0, vvfData[0]));
    tfs.push_back(CHtTransferFunction(1, vvfData[vvfData.size()-1]));
-   return new CHtPartitionedConvolution(nFragsize, 2, tfs);
+   return new CHtPartitionedConvolution(nFragsize, 2, tfs, g_nMaxPartitionSize);
 
 }
 //------------------------------------------------------------------------------
@@ -114,6 +132,45 @@ int ConvProcess(void * handle, unsigned nFragsize, unsigned nChannelsIn, unsigne
 }
 //------------------------------------------------------------------------------
 
+//------------------------------------------------------------------------------
+/// sets planning effort of FFTW plans created from now on (CONV_PLANMODE_*)
+//------------------------------------------------------------------------------
+void ConvSetPlanMode(int nMode)
+{
+   THtFFTPlanMode fpm = HTFFT_PLANMODE_ESTIMATE;
+   if (nMode == CONV_PLANMODE_MEASURE)
+      fpm = HTFFT_PLANMODE_MEASURE;
+   else if (nMode == CONV_PLANMODE_PATIENT)
+      fpm = HTFFT_PLANMODE_PATIENT;
+   CHtFFTPlanCache::Instance().SetPlanMode(fpm);
+}
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+/// returns number of FFTW plans and total time spent in FFTW planner
+//------------------------------------------------------------------------------
+void ConvGetPlanStats(unsigned * pnPlans, double * pdPlanningMs)
+{
+   CHtFFTPlanStats fps;
+   CHtFFTPlanCache::Instance().GetStats(fps);
+   if (pnPlans)
+      *pnPlans = fps.nPlans;
+   if (pdPlanningMs)
+      *pdPlanningMs = fps.dPlanningMs;
+}
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+/// sets maximum partition size of convolvers created from now on. Non-uniform
+/// partitioned convolution (one thread per partition level) is used only, if
+/// it is at least 4 times the fragment size. 0 selects uniform partitions
+//------------------------------------------------------------------------------
+void ConvSetMaxPartitionSize(unsigned nSize)
+{
+   g_nMaxPartitionSize = nSize;
+}
+//------------------------------------------------------------------------------
+
 //------------------------------------------------------------------------------
 ///
 //------------------------------------------------------------------------------
@@ -29,19 +29,396 @@
 ///
 //------------------------------------------------------------------------------
 #include "HtFFT3.h"
+#include <stdio.h>
+#include <string.h>
+
+/// name of FFTW wisdom file stored in directory of binary
+#define HTFFT_WISDOMFILE "libfftw3f-3.wisdom"
+/// prefix of name of process wide planner mutex (process id is appended)
+#define HTFFT_PLANNERMUTEX "HtFFTPlanner_"
+//--------------------------------------------------------------------------
+
+//--------------------------------------------------------------------------
+/// static plan cache instance. NOTE: plans are created on first use, not
+/// on DLL load
+//--------------------------------------------------------------------------
+static CHtFFTPlanCache s_fpc;
+
+//--------------------------------------------------------------------------
+/// constructor. Initializes members. FFTW is not used here
+//--------------------------------------------------------------------------
+CHtFFTPlanCache::CHtFFTPlanCache()
+   :  m_hPlanner(NULL),
+      m_mode(HTFFT_PLANMODE_ESTIMATE),
+      m_bWisdomChecked(false),
+      m_bWisdomDirty(false),
+      m_nUsers(0)
+{
+   InitializeCriticalSection(&m_csPlans);
+   memset(&m_fps, 0, sizeof(m_fps));
+}
+//--------------------------------------------------------------------------
+
+//--------------------------------------------------------------------------
+/// destructor. NOTE: plans are not destroyed, because FFTW library may be
+/// unloaded already on process exit
+//--------------------------------------------------------------------------
+CHtFFTPlanCache::~CHtFFTPlanCache()
+{
+   if (m_hPlanner)
+      CloseHandle(m_hPlanner);
+   DeleteCriticalSection(&m_csPlans);
+}
+//--------------------------------------------------------------------------
+
+//--------------------------------------------------------------------------
+/// returns process wide plan cache
+//--------------------------------------------------------------------------
+CHtFFTPlanCache& CHtFFTPlanCache::Instance()
+{
+   return s_fpc;
+}
+//--------------------------------------------------------------------------
+
+//--------------------------------------------------------------------------
+/// returns distance of channels in wave buffers of batched plans in floats:
+/// FFT length rounded up to 32 bytes
+/// \param[in] nFFTLen FFT length
+//--------------------------------------------------------------------------
+unsigned int CHtFFTPlanCache::WaveDist(unsigned int nFFTLen)
+{
+   return (nFFTLen + 7) & ~7U;
+}
+//--------------------------------------------------------------------------
+
+//--------------------------------------------------------------------------
+/// returns distance of channels in spectrum buffers of batched plans in
+/// complex values: number of bins rounded up to 32 bytes
+/// \param[in] nFFTLen FFT length
+//--------------------------------------------------------------------------
+unsigned int CHtFFTPlanCache::SpecDist(unsigned int nFFTLen)
+{
+   return (nFFTLen/2 + 1 + 3) & ~3U;
+}
+//--------------------------------------------------------------------------
+
+//--------------------------------------------------------------------------
+/// sorting operator for plan keys
+//--------------------------------------------------------------------------
+bool CHtFFTPlanCache::TPlanKey::operator<(const TPlanKey& rpk) const
+{
+   if (m_nFFTLen != rpk.m_nFFTLen)
+      return m_nFFTLen < rpk.m_nFFTLen;
+   if (m_type != rpk.m_type)
+      return m_type < rpk.m_type;
+   if (m_nBatch != rpk.m_nBatch)
+      return m_nBatch < rpk.m_nBatch;
+   if (m_nAlignIn != rpk.m_nAlignIn)
+      return m_nAlignIn < rpk.m_nAlignIn;
+   return m_nAlignOut < rpk.m_nAlignOut;
+}
+//--------------------------------------------------------------------------
+
+//--------------------------------------------------------------------------
+/// sets planning effort for plans created from now on. Cached plans are
+/// not replaced
+//--------------------------------------------------------------------------
+void CHtFFTPlanCache::SetPlanMode(THtFFTPlanMode mode)
+{
+   EnterCriticalSection(&m_csPlans);
+   m_mode = mode;
+   LeaveCriticalSection(&m_csPlans);
+}
+//--------------------------------------------------------------------------
+
+//--------------------------------------------------------------------------
+/// returns planning effort for new plans
+//--------------------------------------------------------------------------
+THtFFTPlanMode CHtFFTPlanCache::GetPlanMode()
+{
+   EnterCriticalSection(&m_csPlans);
+   THtFFTPlanMode mode = m_mode;
+   LeaveCriticalSection(&m_csPlans);
+   return mode;
+}
+//--------------------------------------------------------------------------
+
+//--------------------------------------------------------------------------
+/// returns current statistics
+//--------------------------------------------------------------------------
+void CHtFFTPlanCache::GetStats(CHtFFTPlanStats &rfps)
+{
+   EnterCriticalSection(&m_csPlans);
+   rfps        = m_fps;
+   rfps.nPlans = (unsigned int)m_mapPlans.size();
+   LeaveCriticalSection(&m_csPlans);
+}
+//--------------------------------------------------------------------------
+
+//--------------------------------------------------------------------------
+/// registers a CHtFFT instance using the cache
+//--------------------------------------------------------------------------
+void CHtFFTPlanCache::AddUser()
+{
+   EnterCriticalSection(&m_csPlans);
+   m_nUsers++;
+   LeaveCriticalSection(&m_csPlans);
+}
+//--------------------------------------------------------------------------
+
+//--------------------------------------------------------------------------
+/// unregisters a CHtFFT instance. Saves wisdom, if the last instance is
+/// removed and measured plans were created since the last save. NOTE: not
+/// done in destructor, because FFTW library may be unloaded already on
+/// process exit
+//--------------------------------------------------------------------------
+void CHtFFTPlanCache::RemoveUser()
+{
+   EnterCriticalSection(&m_csPlans);
+   try
+      {
+      if (m_nUsers)
+         m_nUsers--;
+      if (!m_nUsers && m_bWisdomDirty)
+         {
+         m_bWisdomDirty = false;
+         LockPlanner();
+         SaveWisdom();
+         UnlockPlanner();
+         }
+      }
+   catch (...)
+      {
+      }
+   LeaveCriticalSection(&m_csPlans);
+}
+//--------------------------------------------------------------------------
+
+//--------------------------------------------------------------------------
+/// acquires process wide planner mutex. The mutex is created on first use.
+/// Called within critical section
+/// \exception Exception if mutex cannot be created
+//--------------------------------------------------------------------------
+void CHtFFTPlanCache::LockPlanner()
+{
+   if (!m_hPlanner)
+      {
+      char szName[64];
+      sprintf(szName, HTFFT_PLANNERMUTEX "%lu", (unsigned long)GetCurrentProcessId());
+      m_hPlanner = CreateMutexA(NULL, FALSE, szName);
+      if (!m_hPlanner)
+         throw Exception("error creating FFT planner mutex");
+      }
+   // NOTE: WAIT_ABANDONED (owner thread terminated) transfers ownership as well
+   if (WaitForSingleObject(m_hPlanner, INFINITE) == WAIT_FAILED)
+      throw Exception("error acquiring FFT planner mutex");
+}
+//--------------------------------------------------------------------------
+
+//--------------------------------------------------------------------------
+/// releases process wide planner mutex
+//--------------------------------------------------------------------------
+void CHtFFTPlanCache::UnlockPlanner()
+{
+   ReleaseMutex(m_hPlanner);
+}
+//--------------------------------------------------------------------------
+
+//--------------------------------------------------------------------------
+/// returns a cached plan or creates a new one. The plan is created on
+/// internal buffers with the same alignment as the passed buffers, so passed
+/// buffers are never overwritten by planning
+/// \param[in] type type of transform
+/// \param[in] nFFTLen FFT length
+/// \param[in] nBatch number of channels (must be 1 for r2r types). Channels
+/// are stored planar with distances WaveDist() and SpecDist()
+/// \param[in] pIn input buffer the plan will be executed with
+/// \param[in] pOut output buffer the plan will be executed with
+/// \retval plan or NULL on error
+//--------------------------------------------------------------------------
+fftwf_plan CHtFFTPlanCache::GetPlan(THtFFTPlanType type, unsigned int nFFTLen, unsigned int nBatch,
+                                    const void* pIn, const void* pOut)
+{
+   TPlanKey pk;
+   pk.m_nFFTLen   = nFFTLen;
+   pk.m_type      = type;
+   pk.m_nBatch    = nBatch;
+   pk.m_nAlignIn  = (unsigned int)((size_t)pIn % 32);
+   pk.m_nAlignOut = (unsigned int)((size_t)pOut % 32);
+
+   fftwf_plan plan = NULL;
+   EnterCriticalSection(&m_csPlans);
+   try
+      {
+      std::map<TPlanKey, fftwf_plan>::iterator it = m_mapPlans.find(pk);
+      if (it != m_mapPlans.end())
+         {
+         m_fps.nHits++;
+         plan = it->second;
+         }
+      else
+         {
+         LockPlanner();
+         try
+            {
+            if (!m_bWisdomChecked)
+               LoadWisdom();
+            plan = CreatePlan(pk);
+            }
+         catch (...)
+            {
+            UnlockPlanner();
+            throw;
+            }
+         UnlockPlanner();
+         if (plan)
+            m_mapPlans[pk] = plan;
+         }
+      }
+   catch (...)
+      {
+      LeaveCriticalSection(&m_csPlans);
+      throw;
+      }
+   LeaveCriticalSection(&m_csPlans);
+   return plan;
+}
+//--------------------------------------------------------------------------
+
+//--------------------------------------------------------------------------
+/// creates a new plan on internal buffers with the alignment specified in
+/// key and updates statistics. Called by GetPlan within critical section
+/// holding the planner mutex
+/// \param[in] pk key of plan
+/// \retval plan or NULL on error
+//--------------------------------------------------------------------------
+fftwf_plan CHtFFTPlanCache::CreatePlan(const TPlanKey& pk)
+{
+   unsigned int nFlags = FFTW_ESTIMATE;
+   if (m_mode == HTFFT_PLANMODE_MEASURE)
+      nFlags = FFTW_MEASURE;
+   else if (m_mode == HTFFT_PLANMODE_PATIENT)
+      nFlags = FFTW_PATIENT;
+
+   // planning buffers: planar buffers are large enough for all types
+   size_t nWaveBytes = sizeof(float) * WaveDist(pk.m_nFFTLen) * pk.m_nBatch;
+   size_t nSpecBytes = sizeof(fftwf_complex) * SpecDist(pk.m_nFFTLen) * pk.m_nBatch;
+   size_t nBytes     = nWaveBytes > nSpecBytes ? nWaveBytes : nSpecBytes;
+   char* pcIn  = (char*)fftwf_malloc(nBytes + 32);
+   char* pcOut = (char*)fftwf_malloc(nBytes + 32);
+   if (!pcIn || !pcOut)
+      {
+      if (pcIn)
+         fftwf_free(pcIn);
+      if (pcOut)
+         fftwf_free(pcOut);
+      throw Exception("error allocating FFT planning buffers");
+      }
+   float* pfIn    = (float*)(pcIn + (32 - (size_t)pcIn % 32) % 32 + pk.m_nAlignIn);
+   float* pfOut   = (float*)(pcOut + (32 - (size_t)pcOut % 32) % 32 + pk.m_nAlignOut);
+   int nLen       = (int)pk.m_nFFTLen;
+   int nWaveDist  = (int)WaveDist(pk.m_nFFTLen);
+   int nSpecDist  = (int)SpecDist(pk.m_nFFTLen);
+
+   fftwf_plan plan = NULL;
+   LARGE_INTEGER liStart, liStop, liFreq;
+   QueryPerformanceCounter(&liStart);
+   switch (pk.m_type)
+      {
+      case HTFFT_PLAN_R2HC:
+         plan = fftwf_plan_r2r_1d(nLen, pfIn, pfOut, FFTW_R2HC, nFlags);
+         break;
+      case HTFFT_PLAN_HC2R:
+         plan = fftwf_plan_r2r_1d(nLen, pfIn, pfOut, FFTW_HC2R, nFlags);
+         break;
+      case HTFFT_PLAN_R2C:
+         plan = fftwf_plan_many_dft_r2c(1, &nLen, (int)pk.m_nBatch,
+                                        pfIn, NULL, 1, nWaveDist,
+                                        (fftwf_complex*)pfOut, NULL, 1, nSpecDist,
+                                        nFlags);
+         break;
+      case HTFFT_PLAN_C2R:
+         plan = fftwf_plan_many_dft_c2r(1, &nLen, (int)pk.m_nBatch,
+                                        (fftwf_complex*)pfIn, NULL, 1, nSpecDist,
+                                        pfOut, NULL, 1, nWaveDist,
+                                        nFlags);
+         break;
+      }
+   QueryPerformanceCounter(&liStop);
+   QueryPerformanceFrequency(&liFreq);
+   fftwf_free(pcIn);
+   fftwf_free(pcOut);
+
+   if (plan)
+      {
+      double dMs = 1000.0 * (double)(liStop.QuadPart - liStart.QuadPart) / (double)liFreq.QuadPart;
+      m_fps.nMisses++;
+      m_fps.dPlanningMs += dMs;
+      if (nFlags != FFTW_ESTIMATE)
+         m_bWisdomDirty = true;
+      }
+   return plan;
+}
+//--------------------------------------------------------------------------
+
+//--------------------------------------------------------------------------
+/// determines name of wisdom file in directory of the binary containing
+/// this code and imports wisdom from it. Called once by GetPlan within
+/// critical section holding the planner mutex
+//--------------------------------------------------------------------------
+void CHtFFTPlanCache::LoadWisdom()
+{
+   m_bWisdomChecked = true;
+   HMODULE hModule = NULL;
+   if (!GetModuleHandleExA(  GET_MODULE_HANDLE_EX_FLAG_FROM_ADDRESS | GET_MODULE_HANDLE_EX_FLAG_UNCHANGED_REFCOUNT,
+                              (LPCSTR)&s_fpc, &hModule))
+      return;
+   char szPath[MAX_PATH+1];
+   DWORD dwLen = GetModuleFileNameA(hModule, szPath, MAX_PATH);
+   if (!dwLen || dwLen >= MAX_PATH)
+      return;
+   szPath[dwLen] = '\0';
+   std::string str(szPath);
+   size_t nPos = str.find_last_of("\\/");
+   m_strWisdomFile = (nPos == std::string::npos ? std::string() : str.substr(0, nPos+1)) + HTFFT_WISDOMFILE;
+   m_fps.bWisdomLoaded = !!fftwf_import_wisdom_from_filename(m_strWisdomFile.c_str());
+}
+//--------------------------------------------------------------------------
+
+//--------------------------------------------------------------------------
+/// exports accumulated wisdom to wisdom file. Called by RemoveUser within
+/// critical section holding the planner mutex. Errors (e.g. write protected
+/// directory) are ignored
+//--------------------------------------------------------------------------
+void CHtFFTPlanCache::SaveWisdom()
+{
+   if (!m_strWisdomFile.empty())
+      fftwf_export_wisdom_to_filename(m_strWisdomFile.c_str());
+}
+//--------------------------------------------------------------------------
 
 //--------------------------------------------------------------------------
 
 
 //--------------------------------------------------------------------------
 /// Constructor. Intializes members, data buffers and FFTW
+/// \param[in] nFFTLen FFT length
+/// \param[in] nChannels number of channels transformed by one batched plan
+/// (HTFFT_BACKEND_R2C only). Should be the number of channels usually passed
+/// to Wave2Spec/Spec2Wave. Other channel numbers are processed in chunks of
+/// nChannels channels
+/// \param[in] backend FFTW transforms to use
 /// \exception CHtException if FFTW and CHtFFT use different precisions
 /// \exception Exception if an FFT-length < 2 is specified
 //--------------------------------------------------------------------------
-CHtFFT::CHtFFT(unsigned int nFFTLen)
+CHtFFT::CHtFFT(unsigned int nFFTLen, unsigned int nChannels, THtFFTBackend backend)
    :  m_nFFTLen(nFFTLen),
-      m_vafBufIn(0.0f, nFFTLen),
-      m_vafBufOut(0.0f, nFFTLen),
+      m_backend(backend),
+      m_nBatch(nChannels ? nChannels : 1),
+      m_nWaveDist(0),
+      m_nSpecDist(0),
+      m_pfBatchWave(NULL),
+      m_pcBatchSpec(NULL),
       m_fftw_plan_Wave2Spec(NULL),
       m_fftw_plan_Spec2Wave(NULL)
 {
@@ -65,25 +442,50 @@ CHtFFT::CHtFFT(unsigned int nFFTLen)
       m_nIm++;
 
    m_fScale = 1.0f / (float)nFFTLen;
+   CHtFFTPlanCache::Instance().AddUser();
    try
       {
-      m_fftw_plan_Wave2Spec = fftwf_plan_r2r_1d ((int)m_nFFTLen, &m_vafBufIn[0], &m_vafBufOut[0], FFTW_R2HC , FFTW_ESTIMATE);
-      m_fftw_plan_Spec2Wave = fftwf_plan_r2r_1d ((int)m_nFFTLen, &m_vafBufIn[0], &m_vafBufOut[0], FFTW_HC2R, FFTW_ESTIMATE);
+      if (m_backend == HTFFT_BACKEND_R2R)
+         {
+         m_vafBufIn.resize(nFFTLen, 0.0f);
+         m_vafBufOut.resize(nFFTLen, 0.0f);
+         m_fftw_plan_Wave2Spec = CHtFFTPlanCache::Instance().GetPlan(HTFFT_PLAN_R2HC, m_nFFTLen, 1, &m_vafBufIn[0], &m_vafBufOut[0]);
+         m_fftw_plan_Spec2Wave = CHtFFTPlanCache::Instance().GetPlan(HTFFT_PLAN_HC2R, m_nFFTLen, 1, &m_vafBufIn[0], &m_vafBufOut[0]);
+         }
+      else
+         {
+         // channels are stored planar with distances keeping every channel
+         // aligned to 32 bytes
+         m_nWaveDist = CHtFFTPlanCache::WaveDist(m_nFFTLen);
+         m_nSpecDist = CHtFFTPlanCache::SpecDist(m_nFFTLen);
+         m_pfBatchWave = (float*)fftwf_malloc(sizeof(float) * m_nWaveDist * m_nBatch);
+         m_pcBatchSpec = (fftwf_complex*)fftwf_malloc(sizeof(fftwf_complex) * m_nSpecDist * m_nBatch);
+         if (!m_pfBatchWave || !m_pcBatchSpec)
+            throw Exception("error allocating FFT buffers");
+         memset(m_pfBatchWave, 0, sizeof(float) * m_nWaveDist * m_nBatch);
+         memset(m_pcBatchSpec, 0, sizeof(fftwf_complex) * m_nSpecDist * m_nBatch);
+         m_fftw_plan_Wave2Spec = CHtFFTPlanCache::Instance().GetPlan(HTFFT_PLAN_R2C, m_nFFTLen, m_nBatch, m_pfBatchWave, m_pcBatchSpec);
+         m_fftw_plan_Spec2Wave = CHtFFTPlanCache::Instance().GetPlan(HTFFT_PLAN_C2R, m_nFFTLen, m_nBatch, m_pcBatchSpec, m_pfBatchWave);
+         }
+      if (!m_fftw_plan_Wave2Spec || !m_fftw_plan_Spec2Wave)
+         throw Exception("error creating FFT plans");
       }
    catch (...)
       {
       Cleanup();
+      CHtFFTPlanCache::Instance().RemoveUser();
       throw;
       }
 }
 //--------------------------------------------------------------------------
 
 //--------------------------------------------------------------------------
-/// Destructor. Calls Cleanup
+/// Destructor. Calls Cleanup and unregisters from plan cache
 //--------------------------------------------------------------------------
 CHtFFT::~CHtFFT(  )
 {
    Cleanup();
+   CHtFFTPlanCache::Instance().RemoveUser();
 }
 //--------------------------------------------------------------------------
 
@@ -92,29 +494,18 @@ CHtFFT::~CHtFFT(  )
 //--------------------------------------------------------------------------
 void CHtFFT::Cleanup()
 {
-   if (m_fftw_plan_Wave2Spec)
+   // NOTE: plans are owned by CHtFFTPlanCache
+   m_fftw_plan_Wave2Spec = NULL;
+   m_fftw_plan_Spec2Wave = NULL;
+   if (m_pfBatchWave)
       {
-      // secure silent cleanup
-      try
-         {
-         fftwf_destroy_plan(m_fftw_plan_Wave2Spec);
-         }
-      catch (...)
-         {
-         }
-      m_fftw_plan_Wave2Spec = NULL;
+      fftwf_free(m_pfBatchWave);
+      m_pfBatchWave = NULL;
       }
-   if (m_fftw_plan_Wave2Spec)
+   if (m_pcBatchSpec)
       {
-      // secure silent cleanup
-      try
-         {
-         fftwf_destroy_plan(m_fftw_plan_Wave2Spec);
-         }
-      catch (...)
-         {
-         }
-      m_fftw_plan_Wave2Spec = NULL;
+      fftwf_free(m_pcBatchSpec);
+      m_pcBatchSpec = NULL;
       }
 }
 //--------------------------------------------------------------------------
@@ -183,6 +574,12 @@ void CHtFFT::Wave2Spec(const vvaf & vvafWave, vvac & vvacSpec, bool bSwap)
    if (nFrames != m_nFFTLen)
       throw Exception(UnicodeString().sprintf(L"waveform has invalid length (%u, FFTLen: %u)", nFrames, m_nFFTLen));
 
+   if (m_backend == HTFFT_BACKEND_R2C)
+      {
+      Wave2SpecBatch(vvafWave, vvacSpec, bSwap);
+      return;
+      }
+
    unsigned int nFrame, nChannel;
    for (nChannel = 0; nChannel < nChannels; nChannel++)
       {
@@ -199,7 +596,7 @@ void CHtFFT::Wave2Spec(const vvaf & vvafWave, vvac & vvacSpec, bool bSwap)
          }
 
       // call FFT
-      fftwf_execute(m_fftw_plan_Wave2Spec);
+      fftwf_execute_r2r(m_fftw_plan_Wave2Spec, &m_vafBufIn[0], &m_vafBufOut[0]);
       // sort fftw-type to internal order
       SortFFTW2Spec(m_vafBufOut, vvacSpec, nChannel);
       }
@@ -223,13 +620,19 @@ void CHtFFT::Spec2Wave(const vvac &vvacSpec, vvaf &vvafWave)
    if (nFrames > m_nFFTLen)
       throw Exception(UnicodeString().sprintf(L"waveform has invalid length (%u, FFTLen: %u)", nFrames, m_nFFTLen));
 
+   if (m_backend == HTFFT_BACKEND_R2C)
+      {
+      Spec2WaveBatch(vvacSpec, vvafWave, nFrames);
+      return;
+      }
+
    unsigned int nChannel, nFrame;
    for (nChannel = 0; nChannel < nChannels; nChannel++)
       {
       // sort internal order to fftw-type
       SortSpec2FFTW(m_vafBufIn, vvacSpec, nChannel);
       // call ifft
-      fftwf_execute(m_fftw_plan_Spec2Wave);
+      fftwf_execute_r2r(m_fftw_plan_Spec2Wave, &m_vafBufIn[0], &m_vafBufOut[0]);
       // copy data back to output buffer
       for (nFrame = 0; nFrame < nFrames; nFrame++)
          vvafWave[nChannel][nFrame] = m_vafBufOut[nFrame];
@@ -237,6 +640,99 @@ void CHtFFT::Spec2Wave(const vvac &vvacSpec, vvaf &vvafWave)
 }
 //--------------------------------------------------------------------------
 
+//--------------------------------------------------------------------------
+/// Does FFT with batched r2c plan. The spectrum is written by FFTW in the
+/// internal order (std::complex<float> and fftwf_complex have identical
+/// layout), so it is copied without sorting. Sizes are checked by caller
+/// \param[in] vvafWave vector of float valarrays containing the source waveform
+/// \param[out] vvacSpec vector of complex valarrays receiving spectrum
+/// \param[in] bSwap if true the two input wave data halves are swapped
+/// \exception Exception if spectrum dimensions are invalid
+//--------------------------------------------------------------------------
+void CHtFFT::Wave2SpecBatch(const vvaf & vvafWave, vvac & vvacSpec, bool bSwap)
+{
+   unsigned int nChannels = (unsigned int)vvafWave.size();
+   unsigned int nHalf     = m_nFFTLen / 2;
+   unsigned int nFirst, nChannel, nBatchChannel, nFrame;
+   for (nChannel = 0; nChannel < nChannels; nChannel++)
+      {
+      if (vvacSpec[nChannel].size() < m_nRe)
+         throw Exception(UnicodeString().sprintf(L"Input spectrum contains only %u bins, but %u real parts are available.", vvacSpec[nChannel].size(), m_nRe));
+      }
+   // process channels in chunks of batch size
+   for (nFirst = 0; nFirst < nChannels; nFirst += m_nBatch)
+      {
+      unsigned int nBatchChannels = nChannels - nFirst;
+      if (nBatchChannels > m_nBatch)
+         nBatchChannels = m_nBatch;
+      for (nBatchChannel = 0; nBatchChannel < nBatchChannels; nBatchChannel++)
+         {
+         const float* pfSrc = &vvafWave[nFirst + nBatchChannel][0];
+         float* pfDst = m_pfBatchWave + nBatchChannel * m_nWaveDist;
+         // copy values to internal buffer with respect to 'swap'-flag
+         if (bSwap)
+            {
+            for (nFrame = 0; nFrame < m_nFFTLen - nHalf; nFrame++)
+               pfDst[nFrame + nHalf] = m_fScale * pfSrc[nFrame];
+            for (; nFrame < m_nFFTLen; nFrame++)
+               pfDst[nFrame + nHalf - m_nFFTLen] = m_fScale * pfSrc[nFrame];
+            }
+         else
+            {
+            for (nFrame = 0; nFrame < m_nFFTLen; nFrame++)
+               pfDst[nFrame] = m_fScale * pfSrc[nFrame];
+            }
+         }
+      // call FFT
+      fftwf_execute_dft_r2c(m_fftw_plan_Wave2Spec, m_pfBatchWave, m_pcBatchSpec);
+      for (nBatchChannel = 0; nBatchChannel < nBatchChannels; nBatchChannel++)
+         {
+         vac& vacSpec = vvacSpec[nFirst + nBatchChannel];
+         memcpy(&vacSpec[0], m_pcBatchSpec + nBatchChannel * m_nSpecDist, m_nRe * sizeof(CHtComplex));
+         if (vacSpec.size() > m_nRe)
+            memset(&vacSpec[m_nRe], 0, (vacSpec.size() - m_nRe) * sizeof(CHtComplex));
+         }
+      }
+}
+//--------------------------------------------------------------------------
+
+//--------------------------------------------------------------------------
+/// Does IFFT with batched c2r plan. Sizes are checked by caller
+/// \param[in] vvacSpec vector of complex valarrays containing source spectrum
+/// \param[out] vvafWave vector of float valarrays receiving the waveform
+/// \param[in] nFrames number of frames to copy to vvafWave
+/// \exception Exception if spectrum dimensions are invalid
+//--------------------------------------------------------------------------
+void CHtFFT::Spec2WaveBatch(const vvac & vvacSpec, vvaf & vvafWave, unsigned int nFrames)
+{
+   unsigned int nChannels = (unsigned int)vvafWave.size();
+   unsigned int nFirst, nChannel, nBatchChannel;
+   for (nChannel = 0; nChannel < nChannels; nChannel++)
+      {
+      if (vvacSpec[nChannel].size() < m_nRe)
+         throw Exception(UnicodeString().sprintf(L"Input spectrum contains only %u bins, but %u real parts are available.", vvacSpec[nChannel].size(), m_nRe));
+      }
+   // process channels in chunks of batch size
+   for (nFirst = 0; nFirst < nChannels; nFirst += m_nBatch)
+      {
+      unsigned int nBatchChannels = nChannels - nFirst;
+      if (nBatchChannels > m_nBatch)
+         nBatchChannels = m_nBatch;
+      // NOTE: c2r transform destroys its input, so spectrum is always copied
+      for (nBatchChannel = 0; nBatchChannel < nBatchChannels; nBatchChannel++)
+         memcpy(m_pcBatchSpec + nBatchChannel * m_nSpecDist, &vvacSpec[nFirst + nBatchChannel][0], m_nRe * sizeof(CHtComplex));
+      // call ifft
+      fftwf_execute_dft_c2r(m_fftw_plan_Spec2Wave, m_pcBatchSpec, m_pfBatchWave);
+      // copy data back to output buffer
+      for (nBatchChannel = 0; nBatchChannel < nBatchChannels; nBatchChannel++)
+         {
+         if (nFrames)
+            memcpy(&vvafWave[nFirst + nBatchChannel][0], m_pfBatchWave + nBatchChannel * m_nWaveDist, nFrames * sizeof(float));
+         }
+      }
+}
+//--------------------------------------------------------------------------
+
 //--------------------------------------------------------------------------
 /// Returns the number of values in each valarrays of a vector of valarrays.
 /// \param[in] vvafWave reference to vecor of vallarrays
@@ -34,6 +34,165 @@
 //------------------------------------------------------------------------------
 #include "HtPartitionedConvolution.h"
 #include <mem.h>
+
+// AVX/FMA kernel is compiled with target attribute and selected at runtime
+#if (defined(__clang__) || defined(__GNUC__)) && (defined(__x86_64__) || defined(__i386__))
+   #define PC_AVX_FMA
+   #include <immintrin.h>
+   #include <cpuid.h>
+   #define PC_TARGET_AVX_FMA __attribute__((target("avx,fma")))
+#endif
+//--------------------------------------------------------------------------
+
+//--------------------------------------------------------------------------
+/// Kernel for complex multiply-accumulate over all filter partitions of one
+/// channel: pfSumRe + j*pfSumIm = sum over terms of X*H.
+/// \param[in] ppfTerms four pointers for each term: real and imaginary part of
+/// input spectrum X, real and imaginary part of frequency response H. All
+/// pointers are aligned to 32 bytes
+/// \param[in] nTerms number of terms (must be > 0)
+/// \param[in] nBins number of bins (multiple of 8)
+/// \param[out] pfSumRe real part of sum (aligned to 32 bytes)
+/// \param[out] pfSumIm imaginary part of sum (aligned to 32 bytes)
+//--------------------------------------------------------------------------
+typedef void (*LPFNCOMPLEXMACSUM)(const float* const* ppfTerms, unsigned int nTerms, unsigned int nBins,
+                                  float* pfSumRe, float* pfSumIm);
+
+//--------------------------------------------------------------------------
+/// Scalar version of complex multiply-accumulate kernel (see
+/// LPFNCOMPLEXMACSUM)
+//--------------------------------------------------------------------------
+static void ComplexMacSum(const float* const* ppfTerms, unsigned int nTerms, unsigned int nBins,
+                          float* pfSumRe, float* pfSumIm)
+{
+   memset(pfSumRe, 0, nBins*sizeof(float));
+   memset(pfSumIm, 0, nBins*sizeof(float));
+   unsigned int nTerm, nBin;
+   for (nTerm = 0; nTerm < nTerms; nTerm++)
+      {
+      const float* pfXRe = ppfTerms[4*nTerm];
+      const float* pfXIm = ppfTerms[4*nTerm+1];
+      const float* pfHRe = ppfTerms[4*nTerm+2];
+      const float* pfHIm = ppfTerms[4*nTerm+3];
+      for (nBin = 0; nBin < nBins; nBin++)
+         {
+         pfSumRe[nBin] += pfXRe[nBin] * pfHRe[nBin] - pfXIm[nBin] * pfHIm[nBin];
+         pfSumIm[nBin] += pfXRe[nBin] * pfHIm[nBin] + pfXIm[nBin] * pfHRe[nBin];
+         }
+      }
+}
+//--------------------------------------------------------------------------
+
+#ifdef PC_AVX_FMA
+//--------------------------------------------------------------------------
+/// AVX/FMA version of complex multiply-accumulate kernel (see
+/// LPFNCOMPLEXMACSUM). Processes blocks of 16 bins and keeps the sums in
+/// registers over all terms, so every output bin is written only once
+//--------------------------------------------------------------------------
+PC_TARGET_AVX_FMA
+static void ComplexMacSumAvxFma(const float* const* ppfTerms, unsigned int nTerms, unsigned int nBins,
+                                float* pfSumRe, float* pfSumIm)
+{
+   unsigned int nTerm, nBin = 0;
+   for (; nBin + 16 <= nBins; nBin += 16)
+      {
+      __m256 vRe0 = _mm256_setzero_ps();
+      __m256 vIm0 = _mm256_setzero_ps();
+      __m256 vRe1 = _mm256_setzero_ps();
+      __m256 vIm1 = _mm256_setzero_ps();
+      const float* const* ppf = ppfTerms;
+      for (nTerm = 0; nTerm < nTerms; nTerm++, ppf += 4)
+         {
+         __m256 vXRe = _mm256_load_ps(ppf[0] + nBin);
+         __m256 vXIm = _mm256_load_ps(ppf[1] + nBin);
+         __m256 vHRe = _mm256_load_ps(ppf[2] + nBin);
+         __m256 vHIm = _mm256_load_ps(ppf[3] + nBin);
+         vRe0 = _mm256_fmadd_ps(vXRe, vHRe, vRe0);
+         vRe0 = _mm256_fnmadd_ps(vXIm, vHIm, vRe0);
+         vIm0 = _mm256_fmadd_ps(vXRe, vHIm, vIm0);
+         vIm0 = _mm256_fmadd_ps(vXIm, vHRe, vIm0);
+         vXRe = _mm256_load_ps(ppf[0] + nBin + 8);
+         vXIm = _mm256_load_ps(ppf[1] + nBin + 8);
+         vHRe = _mm256_load_ps(ppf[2] + nBin + 8);
+         vHIm = _mm256_load_ps(ppf[3] + nBin + 8);
+         vRe1 = _mm256_fmadd_ps(vXRe, vHRe, vRe1);
+         vRe1 = _mm256_fnmadd_ps(vXIm, vHIm, vRe1);
+         vIm1 = _mm256_fmadd_ps(vXRe, vHIm, vIm1);
+         vIm1 = _mm256_fmadd_ps(vXIm, vHRe, vIm1);
+         }
+      _mm256_store_ps(pfSumRe + nBin, vRe0);
+      _mm256_store_ps(pfSumIm + nBin, vIm0);
+      _mm256_store_ps(pfSumRe + nBin + 8, vRe1);
+      _mm256_store_ps(pfSumIm + nBin + 8, vIm1);
+      }
+   // remaining block of 8 bins
+   if (nBin < nBins)
+      {
+      __m256 vRe = _mm256_setzero_ps();
+      __m256 vIm = _mm256_setzero_ps();
+      const float* const* ppf = ppfTerms;
+      for (nTerm = 0; nTerm < nTerms; nTerm++, ppf += 4)
+         {
+         __m256 vXRe = _mm256_load_ps(ppf[0] + nBin);
+         __m256 vXIm = _mm256_load_ps(ppf[1] + nBin);
+         __m256 vHRe = _mm256_load_ps(ppf[2] + nBin);
+         __m256 vHIm = _mm256_load_ps(ppf[3] + nBin);
+         vRe = _mm256_fmadd_ps(vXRe, vHRe, vRe);
+         vRe = _mm256_fnmadd_ps(vXIm, vHIm, vRe);
+         vIm = _mm256_fmadd_ps(vXRe, vHIm, vIm);
+         vIm = _mm256_fmadd_ps(vXIm, vHRe, vIm);
+         }
+      _mm256_store_ps(pfSumRe + nBin, vRe);
+      _mm256_store_ps(pfSumIm + nBin, vIm);
+      }
+}
+//--------------------------------------------------------------------------
+
+//--------------------------------------------------------------------------
+/// checks CPU and OS support of AVX and FMA
+//--------------------------------------------------------------------------
+static bool CpuHasAvxFma()
+{
+   unsigned int nEax, nEbx, nEcx, nEdx;
+   if (!__get_cpuid(1, &nEax, &nEbx, &nEcx, &nEdx))
+      return false;
+   // FMA, OSXSAVE and AVX
+   if ((nEcx & (1u << 12)) == 0 || (nEcx & (1u << 27)) == 0 || (nEcx & (1u << 28)) == 0)
+      return false;
+   // OS saves XMM and YMM registers
+   unsigned int nXcr0Lo, nXcr0Hi;
+   __asm__ __volatile__("xgetbv" : "=a"(nXcr0Lo), "=d"(nXcr0Hi) : "c"(0));
+   return (nXcr0Lo & 6u) == 6u;
+}
+//--------------------------------------------------------------------------
+#endif // PC_AVX_FMA
+
+//--------------------------------------------------------------------------
+/// returns best complex multiply-accumulate kernel for current CPU
+//--------------------------------------------------------------------------
+static LPFNCOMPLEXMACSUM SelectComplexMacSum()
+{
+   #ifdef PC_AVX_FMA
+   if (CpuHasAvxFma())
+      return ComplexMacSumAvxFma;
+   #endif
+   return ComplexMacSum;
+}
+//--------------------------------------------------------------------------
+
+static const LPFNCOMPLEXMACSUM s_lpfnComplexMacSum = SelectComplexMacSum();
+
+//--------------------------------------------------------------------------
+/// Resizes buffer and sets all values to zero. Previous content is lost
+/// \param[in] nSize new number of floats
+//--------------------------------------------------------------------------
+void CHtAlignedFloats::Resize(size_t nSize)
+{
+   // up to 7 additional floats needed for alignment
+   m_vfData.assign(nSize + 8, 0.0f);
+   size_t nMisalign = ((size_t)&m_vfData[0]) % 32;
+   m_pfData = &m_vfData[0] + (nMisalign ? (32 - nMisalign) / sizeof(float) : 0);
+}
 //--------------------------------------------------------------------------
 
 //--------------------------------------------------------------------------
@@ -42,27 +201,138 @@
 /// \param[in] nFragSize Audio fragment size, equal to partition size.
 /// \param[in] nChannels Number of audio channels.
 /// \param[in] tfs CHtTransferFunctions sparse vector of impulse responses.
+/// \param[in] nMaxPartitionSize maximum partition size for non-uniform
+/// partitions. If it is smaller than 4*nFragSize, uniform partitions of
+/// size nFragSize are used. Otherwise the first 8*nFragSize samples of the
+/// impulse responses are processed with partitions of nFragSize, the tail by
+/// levels with partition sizes growing by factor 4 up to nMaxPartitionSize.
+/// A level with partition size N processes the samples from 2*N to 8*N (the
+/// last level all remaining samples).
 /// \exception Exception on invalid indices
 //--------------------------------------------------------------------------
 CHtPartitionedConvolution::CHtPartitionedConvolution( unsigned int nFragSize,
                                                       unsigned int nChannels,
-                                                      const CHtTransferFunctions & tfs)
+                                                      const CHtTransferFunctions & tfs,
+                                                      unsigned int nMaxPartitionSize)
+    : m_nFragSize(nFragSize),
+      m_nInputChannels(nChannels),
+      m_nOutputChannels(nChannels),
+      m_nOutputPartitions(0U),
+      m_nFilterPartitions(0U),
+      m_nWaveInBufferHalfCurrentIndex(0U),
+      m_nBins(0U),
+      m_nInputPartitionCurrentIndex(0U),
+      m_pfft(NULL),
+      m_pfftOut(NULL)
+{
+   Create(tfs, nMaxPartitionSize);
+}
+//--------------------------------------------------------------------------
+
+//--------------------------------------------------------------------------
+/// Constructor for MIMO convolution. Initializes all members and buffers and
+/// breaks up impulse responses into partitions.
+/// \param[in] nFragSize Audio fragment size, equal to partition size.
+/// \param[in] nInputChannels Number of input channels.
+/// \param[in] nOutputChannels Number of output channels.
+/// \param[in] tfs CHtTransferFunctions sparse vector of impulse responses
+/// with input and output channel index. Transfer functions with identical
+/// output channel are summed up.
+/// \param[in] nMaxPartitionSize maximum partition size for non-uniform
+/// partitions (see other constructor).
+/// \exception Exception on invalid indices
+//--------------------------------------------------------------------------
+CHtPartitionedConvolution::CHtPartitionedConvolution( unsigned int nFragSize,
+                                                      unsigned int nInputChannels,
+                                                      unsigned int nOutputChannels,
+                                                      const CHtTransferFunctions & tfs,
+                                                      unsigned int nMaxPartitionSize)
     : m_nFragSize(nFragSize),
-      m_nChannels(nChannels),
-      m_nOutputPartitions(tfs.Partitions(m_nFragSize).max()),
-      m_nFilterPartitions(tfs.PartitionsNonEmpty(m_nFragSize).sum()),
+      m_nInputChannels(nInputChannels),
+      m_nOutputChannels(nOutputChannels),
+      m_nOutputPartitions(0U),
+      m_nFilterPartitions(0U),
       m_nWaveInBufferHalfCurrentIndex(0U),
-      m_vvafWaveIn(m_nChannels, std::valarray<float>(2*m_nFragSize)),
-      m_vvacSpecIn(m_nChannels, std::valarray<CHtComplex>(m_nFragSize+1)),
-      m_vvacFrequencyResponse(m_nFilterPartitions, std::valarray<CHtComplex>(m_nFragSize+1)),
-      m_fiBookKeeping(m_nFilterPartitions),
-      m_vvacSpecOut(m_nOutputPartitions, vvac(m_nChannels, std::valarray<CHtComplex>(m_nFragSize+1))),
-      m_nOutputPartitionCurrentIndex(0U),
-      m_vvafWaveOut(m_nChannels, std::valarray<float>(m_nFragSize))
+      m_nBins(0U),
+      m_nInputPartitionCurrentIndex(0U),
+      m_pfft(NULL),
+      m_pfftOut(NULL)
 {
+   Create(tfs, nMaxPartitionSize);
+}
+//--------------------------------------------------------------------------
+
+//--------------------------------------------------------------------------
+/// Initializes partitions of fragment size and levels for non-uniform
+/// partitions. Called by constructors
+/// \param[in] tfs CHtTransferFunctions sparse vector of impulse responses.
+/// \param[in] nMaxPartitionSize maximum partition size for non-uniform
+/// partitions.
+/// \exception Exception on invalid indices
+//--------------------------------------------------------------------------
+void CHtPartitionedConvolution::Create(const CHtTransferFunctions & tfs, unsigned int nMaxPartitionSize)
+{
+   try
+      {
+      unsigned int nPartitionSize = 4*m_nFragSize;
+      unsigned int nBegin         = 2*nPartitionSize;
+      unsigned int nLength        = tfs.MaxLength();
+      if (nPartitionSize > nMaxPartitionSize || nLength <= nBegin)
+         Init(tfs);
+      else
+         {
+         Init(tfs.Segment(0, nBegin));
+         while (nBegin < nLength)
+            {
+            unsigned int nEnd = 2*4*nPartitionSize;
+            // last level processes the complete remaining tail
+            if (4*nPartitionSize > nMaxPartitionSize)
+               nEnd = nLength;
+            m_vpLevels.push_back(new CHtConvolutionLevel(nPartitionSize, m_nInputChannels, m_nOutputChannels, tfs.Segment(nBegin, nEnd)));
+            nPartitionSize *= 4;
+            nBegin = nEnd;
+            }
+         }
+      }
+   catch (...)
+      {
+      Cleanup();
+      throw;
+      }
+}
+//--------------------------------------------------------------------------
+
+//--------------------------------------------------------------------------
+/// Initializes all buffers and breaks up impulse responses into partitions
+/// of fragment size.
+/// \param[in] tfs CHtTransferFunctions sparse vector of impulse responses.
+/// \exception Exception on invalid indices
+//--------------------------------------------------------------------------
+void CHtPartitionedConvolution::Init(const CHtTransferFunctions & tfs)
+{
+   m_nOutputPartitions = tfs.Partitions(m_nFragSize).max();
+   // delay line needs at least one partition for the current input spectrum
+   if (!m_nOutputPartitions)
+      m_nOutputPartitions = 1;
+   m_nFilterPartitions = tfs.PartitionsNonEmpty(m_nFragSize).sum();
+   m_nBins = (m_nFragSize + 1 + 7) & ~7U;
+   m_vvafWaveIn.assign(m_nInputChannels, std::valarray<float>(2*m_nFragSize));
+   m_vvacSpecIn.assign(m_nInputChannels, std::valarray<CHtComplex>(m_nFragSize+1));
+   m_afFdlRe.Resize((size_t)m_nInputChannels * m_nOutputPartitions * m_nBins);
+   m_afFdlIm.Resize((size_t)m_nInputChannels * m_nOutputPartitions * m_nBins);
+   m_afFilterRe.Resize((size_t)m_nFilterPartitions * m_nBins);
+   m_afFilterIm.Resize((size_t)m_nFilterPartitions * m_nBins);
+   m_afSumRe.Resize(m_nBins);
+   m_afSumIm.Resize(m_nBins);
+   m_fiBookKeeping.resize(m_nFilterPartitions);
+   m_vvnChannelPartitions.assign(m_nOutputChannels, std::vector<unsigned int>());
+   m_vvacSpecOut.assign(m_nOutputChannels, std::valarray<CHtComplex>(m_nFragSize+1));
+   m_vvafWaveOut.assign(m_nOutputChannels, std::valarray<float>(m_nFragSize));
+
    // create CHtFFT instance
    unsigned int nFragSize_2 = 2*m_nFragSize;
-   m_pfft = new CHtFFT(nFragSize_2);
+   m_pfft = new CHtFFT(nFragSize_2, m_nInputChannels);
+   m_pfftOut = new CHtFFT(nFragSize_2, m_nOutputChannels);
 
    // create temporary wave buffer for impulse response
    vvaf vvafPartitions(m_nFilterPartitions, std::valarray<float>(nFragSize_2));
@@ -88,25 +358,46 @@ CHtPartitionedConvolution::CHtPartitionedConvolution( unsigned int nFragSize,
             for (nFrame = 0; nFrame < m_nFragSize && (nFrame + nDelay * m_nFragSize) < (tfs[nTransferFunction].m_vfImpulseResponse.size()); nFrame++)
                vvafPartitions[nFilterPartition][nFrame] = tfs[nTransferFunction].m_vfImpulseResponse[nFrame + nDelay * m_nFragSize];
             m_fiBookKeeping[nFilterPartition].m_nChannelIndex = tfs[nTransferFunction].m_nChannelIndex;
-            if (m_fiBookKeeping[nFilterPartition].m_nChannelIndex >= m_nChannels)
+            if (m_fiBookKeeping[nFilterPartition].m_nChannelIndex >= m_nOutputChannels)
                throw Exception("Channel index is out of range");
+            m_fiBookKeeping[nFilterPartition].m_nInputChannelIndex = tfs[nTransferFunction].m_nInputChannelIndex;
+            if (m_fiBookKeeping[nFilterPartition].m_nInputChannelIndex >= m_nInputChannels)
+               throw Exception("Input channel index is out of range");
             m_fiBookKeeping[nFilterPartition].m_nDelay = nDelay;
+            m_vvnChannelPartitions[m_fiBookKeeping[nFilterPartition].m_nChannelIndex].push_back(nFilterPartition);
             nFilterPartition++;
             }
         }
     }
 
 
+   // pointer lists for complex multiply-accumulate (four pointers per term)
+   size_t nMaxTerms = 0;
+   unsigned int nChannel;
+   for (nChannel = 0; nChannel < m_nOutputChannels; nChannel++)
+      {
+      if (nMaxTerms < m_vvnChannelPartitions[nChannel].size())
+         nMaxTerms = m_vvnChannelPartitions[nChannel].size();
+      }
+   m_vpfTerms.assign(4*nMaxTerms, (const float*)NULL);
+
    // do FFT of complete wave buffer
-   m_pfft->Wave2Spec(vvafPartitions, m_vvacFrequencyResponse, false);
+   vvac vvacFrequencyResponse(m_nFilterPartitions, std::valarray<CHtComplex>(m_nFragSize+1));
+   m_pfft->Wave2Spec(vvafPartitions, vvacFrequencyResponse, false);
 
    // Forward and inverse transform of the signal will lose a factor
    // fftlength. Normalize by multiplying the frequency response with
-   // fftlength.
+   // fftlength. Store real and imaginary parts separately
    for (nFilterPartition = 0; nFilterPartition <  m_nFilterPartitions; nFilterPartition++)
+      {
+      float* pfRe = m_afFilterRe.Data() + (size_t)nFilterPartition * m_nBins;
+      float* pfIm = m_afFilterIm.Data() + (size_t)nFilterPartition * m_nBins;
       for (nFrame = 0; nFrame <  m_nFragSize+1; nFrame++)
-         m_vvacFrequencyResponse[nFilterPartition][nFrame] *= float(nFragSize_2);
-
+         {
+         pfRe[nFrame] = vvacFrequencyResponse[nFilterPartition][nFrame].real() * float(nFragSize_2);
+         pfIm[nFrame] = vvacFrequencyResponse[nFilterPartition][nFrame].imag() * float(nFragSize_2);
+         }
+      }
 }
 //--------------------------------------------------------------------------
 
@@ -115,17 +406,36 @@ CHtPartitionedConvolution::CHtPartitionedConvolution( unsigned int nFragSize,
 //--------------------------------------------------------------------------
 CHtPartitionedConvolution::~CHtPartitionedConvolution()
 {
+   Cleanup();
+}
+//--------------------------------------------------------------------------
+
+//--------------------------------------------------------------------------
+/// Deletes levels and CHtFFT instances
+//--------------------------------------------------------------------------
+void CHtPartitionedConvolution::Cleanup()
+{
+   unsigned int nLevel;
+   for (nLevel = 0; nLevel < m_vpLevels.size(); nLevel++)
+      delete m_vpLevels[nLevel];
+   m_vpLevels.clear();
    if (m_pfft)
       {
       delete m_pfft;
       m_pfft = NULL;
       }
+   if (m_pfftOut)
+      {
+      delete m_pfftOut;
+      m_pfftOut = NULL;
+      }
 }
 //--------------------------------------------------------------------------
 
 
 //--------------------------------------------------------------------------
-/// Processing. Copies input data, calls DoProcess, copies output data back
+/// Processing. Calls MIMO processing with identical number of input and
+/// output channels
 /// \param[in] ppfSignalIn array with float pointers to input wave data
 /// \param[in] ppfSignalOut array with float pointers to output wave data
 /// \param[in] nChannels number of channels
@@ -136,8 +446,28 @@ void CHtPartitionedConvolution::Process(  float * const * ppfSignalIn,
                                           unsigned int nChannels,
                                           unsigned int nFrames)
 {
-   if (nChannels != m_nChannels)
-      FFTERROR_STR_INT_INT("Input signal num_channels (%u) differs from m_nChannels (%u)", nChannels, m_nChannels);
+   Process(ppfSignalIn, nChannels, ppfSignalOut, nChannels, nFrames);
+}
+//--------------------------------------------------------------------------
+
+//--------------------------------------------------------------------------
+/// Processing. Copies input data, calls DoProcess, copies output data back
+/// \param[in] ppfSignalIn array with float pointers to input wave data
+/// \param[in] nInputChannels number of input channels
+/// \param[in] ppfSignalOut array with float pointers to output wave data
+/// \param[in] nOutputChannels number of output channels
+/// \param[in] nFrames number of frames
+//--------------------------------------------------------------------------
+void CHtPartitionedConvolution::Process(  float * const * ppfSignalIn,
+                                          unsigned int nInputChannels,
+                                          float * const * ppfSignalOut,
+                                          unsigned int nOutputChannels,
+                                          unsigned int nFrames)
+{
+   if (nInputChannels != m_nInputChannels)
+      FFTERROR_STR_INT_INT("Input signal num_channels (%u) differs from m_nInputChannels (%u)", nInputChannels, m_nInputChannels);
+   if (nOutputChannels != m_nOutputChannels)
+      FFTERROR_STR_INT_INT("Output signal num_channels (%u) differs from m_nOutputChannels (%u)", nOutputChannels, m_nOutputChannels);
    if (nFrames != m_nFragSize)
       FFTERROR_STR_INT_INT("Input signal num_frames (%u) differs from fragsize (%u)", nFrames, m_nFragSize);
 
@@ -145,21 +475,15 @@ void CHtPartitionedConvolution::Process(  float * const * ppfSignalIn,
    // replace half of the input buffer with the new input signal. The other half
    // buffer retains the signal of the previous call to this method.
    unsigned int nChannel;
-   for (nChannel = 0; nChannel < nChannels; nChannel++)
+   for (nChannel = 0; nChannel < nInputChannels; nChannel++)
       memcpy(&m_vvafWaveIn[nChannel][m_nFragSize * m_nWaveInBufferHalfCurrentIndex], ppfSignalIn[nChannel], nFrames*sizeof(float));
 
    // do filtering
    DoProcess();
 
    // copy output data back
-   unsigned int nFrame;
-   for (nFrame = 0; nFrame < nFrames; nFrame++)
-      {
-      for (nChannel = 0; nChannel < nChannels; nChannel++)
-        {
-        ppfSignalOut[nChannel][nFrame] = m_vvafWaveOut[nChannel][nFrame];
-        }
-    }
+   for (nChannel = 0; nChannel < nOutputChannels; nChannel++)
+      memcpy(ppfSignalOut[nChannel], &m_vvafWaveOut[nChannel][0], nFrames*sizeof(float));
 }
 //--------------------------------------------------------------------------
 
@@ -172,8 +496,8 @@ void CHtPartitionedConvolution::Process(vvaf & vvafSignalIn, vvaf & vvafSignalOu
 {
    unsigned int nChannel;
    unsigned int nChannels = (unsigned int)vvafSignalIn.size();
-   if (nChannels != m_nChannels)
-      FFTERROR_STR_INT_INT("Input signal num_channels (%u) differs from m_nChannels (%u)", nChannels, m_nChannels);
+   if (nChannels != m_nInputChannels)
+      FFTERROR_STR_INT_INT("Input signal num_channels (%u) differs from m_nInputChannels (%u)", nChannels, m_nInputChannels);
 
    for (nChannel = 0; nChannel < nChannels; nChannel++)
       {
@@ -181,8 +505,8 @@ void CHtPartitionedConvolution::Process(vvaf & vvafSignalIn, vvaf & vvafSignalOu
          FFTERROR_STR_INT_INT("Input signal num_frames (%u) differs from fragsize (%u)", vvafSignalIn[nChannel].size(), m_nFragSize);
       }
    nChannels = (unsigned int)vvafSignalOut.size();
-   if (nChannels != m_nChannels)
-      FFTERROR_STR_INT_INT("Output signal num_channels (%u) differs from m_nChannels (%u)", nChannels, m_nChannels);
+   if (nChannels != m_nOutputChannels)
+      FFTERROR_STR_INT_INT("Output signal num_channels (%u) differs from m_nOutputChannels (%u)", nChannels, m_nOutputChannels);
 
    for (nChannel = 0; nChannel < nChannels; nChannel++)
       {
@@ -193,7 +517,7 @@ void CHtPartitionedConvolution::Process(vvaf & vvafSignalIn, vvaf & vvafSignalOu
    // replace half of the input buffer with the new input signal.
    // The other half buffer retains the signal of the previous call
    // to this method.
-   for (nChannel = 0; nChannel < nChannels; nChannel++)
+   for (nChannel = 0; nChannel < m_nInputChannels; nChannel++)
       memcpy(&m_vvafWaveIn[nChannel][m_nFragSize * m_nWaveInBufferHalfCurrentIndex], &vvafSignalIn[nChannel][0], m_nFragSize*sizeof(float));
 
    // do filtering
@@ -218,65 +542,75 @@ void CHtPartitionedConvolution::Process(vvaf & vvafSignal)
 //--------------------------------------------------------------------------
 
 //--------------------------------------------------------------------------
-/// Internal processing. Does FFT, filtering, IFFT
+/// Internal processing. Does FFT, filtering, IFFT. The input spectrum is
+/// stored in the frequency-domain delay line, then each output spectrum is
+/// calculated as the sum over all filter partitions of the output channel of
+/// the frequency response multiplied with the delayed spectrum of the input
+/// channel of the filter partition.
 //--------------------------------------------------------------------------
 void CHtPartitionedConvolution::DoProcess()
 {
    // do the FFT
    m_pfft->Wave2Spec(m_vvafWaveIn, m_vvacSpecIn, bool(m_nWaveInBufferHalfCurrentIndex));
 
-   unsigned int nFilterPartition, nChannel, nDelay, nFrame;
-
-   // NOTE: speed tests were done for Borland compiler and gcc.
-   // They showed for Borland
-   //    - pointer access in inner loop over the frames is faster than vector array access
-   //    - in place calculation  inner loop is faster than using temp variable
-   // For gcc it was vice versa for both points!!
-   #ifdef __BORLANDC__
-   unsigned int nFrameIterator = m_nFragSize+1;
-   CHtComplex *pcplx1, *pcplx2, *pcplx3;
-   for (nFilterPartition = 0; nFilterPartition < m_nFilterPartitions; nFilterPartition++)
+   unsigned int nChannel, nTerm, nFrame;
+   unsigned int nBins = m_nFragSize+1;
+
+   // store input spectra in current partition of delay line
+   for (nChannel = 0; nChannel < m_nInputChannels; nChannel++)
       {
-      nChannel = m_fiBookKeeping[nFilterPartition].m_nChannelIndex;
-      nDelay   = (m_fiBookKeeping[nFilterPartition].m_nDelay + m_nOutputPartitionCurrentIndex) % m_nOutputPartitions;
-      pcplx1   = &(m_vvacSpecIn[nChannel][0]);
-      pcplx2   = &(m_vvacFrequencyResponse[nFilterPartition][0]);
-      pcplx3   = &(m_vvacSpecOut[nDelay][nChannel][0]);
-      nFrame = nFrameIterator;
-      while (nFrame--)
+      size_t nOffset = ((size_t)nChannel * m_nOutputPartitions + m_nInputPartitionCurrentIndex) * m_nBins;
+      float* pfRe = m_afFdlRe.Data() + nOffset;
+      float* pfIm = m_afFdlIm.Data() + nOffset;
+      const CHtComplex* pcplx = &m_vvacSpecIn[nChannel][0];
+      for (nFrame = 0; nFrame < nBins; nFrame++)
          {
-         *pcplx3++  += *pcplx1++ * *pcplx2++;
+         pfRe[nFrame] = pcplx[nFrame].real();
+         pfIm[nFrame] = pcplx[nFrame].imag();
          }
-       }
-   #else  // no Borland compiler
-   CHtComplex ct;
-   for (nFilterPartition = 0; nFilterPartition < m_nFilterPartitions; nFilterPartition++)
+      }
+
+   // calculate output spectra
+   float* pfSumRe = m_afSumRe.Data();
+   float* pfSumIm = m_afSumIm.Data();
+   for (nChannel = 0; nChannel < m_nOutputChannels; nChannel++)
       {
-      nChannel = m_fiBookKeeping[nFilterPartition].m_nChannelIndex;
-      nDelay   = (m_fiBookKeeping[nFilterPartition].m_nDelay + m_nOutputPartitionCurrentIndex) % m_nOutputPartitions;
-      // apply
-      for (nFrame = 0; nFrame < m_nFragSize+1; nFrame++)
+      const std::vector<unsigned int>& vnPartitions = m_vvnChannelPartitions[nChannel];
+      unsigned int nTerms = (unsigned int)vnPartitions.size();
+      CHtComplex* pcplx = &m_vvacSpecOut[nChannel][0];
+      if (!nTerms)
+         {
+         memset(pcplx, 0, sizeof(CHtComplex)*nBins);
+         continue;
+         }
+      for (nTerm = 0; nTerm < nTerms; nTerm++)
          {
-         ct  = m_vvacSpecIn[nChannel][nFrame];
-         ct *= m_vvacFrequencyResponse[nFilterPartition][nFrame];
-         m_vvacSpecOut[nDelay][nChannel][nFrame] += ct;
+         unsigned int nFilterPartition = vnPartitions[nTerm];
+         // partition of delay line containing input spectrum delayed by delay of filter partition
+         unsigned int nPartition = (m_nInputPartitionCurrentIndex + m_nOutputPartitions - m_fiBookKeeping[nFilterPartition].m_nDelay) % m_nOutputPartitions;
+         size_t nOffset = ((size_t)m_fiBookKeeping[nFilterPartition].m_nInputChannelIndex * m_nOutputPartitions + nPartition) * m_nBins;
+         m_vpfTerms[4*nTerm]     = m_afFdlRe.Data() + nOffset;
+         m_vpfTerms[4*nTerm+1]   = m_afFdlIm.Data() + nOffset;
+         m_vpfTerms[4*nTerm+2]   = m_afFilterRe.Data() + (size_t)nFilterPartition * m_nBins;
+         m_vpfTerms[4*nTerm+3]   = m_afFilterIm.Data() + (size_t)nFilterPartition * m_nBins;
          }
+      s_lpfnComplexMacSum(&m_vpfTerms[0], nTerms, m_nBins, pfSumRe, pfSumIm);
+      for (nFrame = 0; nFrame < nBins; nFrame++)
+         pcplx[nFrame] = CHtComplex(pfSumRe[nFrame], pfSumIm[nFrame]);
       }
-   #endif // #ifdef __BORLANDC__
 
    // IFFT
-   m_pfft->Spec2Wave(m_vvacSpecOut[m_nOutputPartitionCurrentIndex], m_vvafWaveOut);
+   m_pfftOut->Spec2Wave(m_vvacSpecOut, m_vvafWaveOut);
 
-
-    // clear output buffer for reuse
-   unsigned nSize = sizeof(CHtComplex)*(m_nFragSize+1);
-   for (nChannel = 0; nChannel < m_nChannels; nChannel++)
-      memset(&m_vvacSpecOut[m_nOutputPartitionCurrentIndex][nChannel][0], 0, nSize);
+   // add output of levels processing the tail (non-uniform mode only)
+   unsigned int nLevel;
+   for (nLevel = 0; nLevel < m_vpLevels.size(); nLevel++)
+      m_vpLevels[nLevel]->Process(m_vvafWaveIn, m_nFragSize * m_nWaveInBufferHalfCurrentIndex, m_nFragSize, m_vvafWaveOut);
 
     // update counters
-   m_nOutputPartitionCurrentIndex++;
-   if (m_nOutputPartitionCurrentIndex >= m_nOutputPartitions)
-      m_nOutputPartitionCurrentIndex = 0;
+   m_nInputPartitionCurrentIndex++;
+   if (m_nInputPartitionCurrentIndex >= m_nOutputPartitions)
+      m_nInputPartitionCurrentIndex = 0;
    m_nWaveInBufferHalfCurrentIndex =
       1U - m_nWaveInBufferHalfCurrentIndex;
 }
@@ -284,3 +618,163 @@ void CHtPartitionedConvolution::DoProcess()
 
 
 
+//--------------------------------------------------------------------------
+/// Constructor. Creates uniform convolution and processing thread.
+/// \param[in] nPartitionSize partition size of level
+/// \param[in] nInputChannels Number of input channels.
+/// \param[in] nOutputChannels Number of output channels.
+/// \param[in] tfs CHtTransferFunctions with the part of the impulse
+/// responses to be processed by this level.
+/// \exception Exception on invalid indices or if thread creation fails
+//--------------------------------------------------------------------------
+CHtConvolutionLevel::CHtConvolutionLevel( unsigned int nPartitionSize,
+                                          unsigned int nInputChannels,
+                                          unsigned int nOutputChannels,
+                                          const CHtTransferFunctions & tfs)
+   :  m_nPartitionSize(nPartitionSize),
+      m_nPosition(0U),
+      m_ppc(NULL),
+      m_vvafWaveIn(nInputChannels, std::valarray<float>(nPartitionSize)),
+      m_vvafJobIn(nInputChannels, std::valarray<float>(nPartitionSize)),
+      m_vvafJobOut(nOutputChannels, std::valarray<float>(nPartitionSize)),
+      m_vvafWaveOut(nOutputChannels, std::valarray<float>(nPartitionSize)),
+      m_hThread(NULL),
+      m_hWork(NULL),
+      m_hDone(NULL),
+      m_bPending(false),
+      m_bTerminate(false),
+      m_bError(false)
+{
+   try
+      {
+      m_ppc = new CHtPartitionedConvolution(nPartitionSize, nInputChannels, nOutputChannels, tfs);
+      m_hWork = CreateEvent(NULL, FALSE, FALSE, NULL);
+      m_hDone = CreateEvent(NULL, TRUE, TRUE, NULL);
+      if (!m_hWork || !m_hDone)
+         throw Exception("error creating events for convolution level");
+      m_hThread = CreateThread(NULL, 0, ThreadProc, this, 0, NULL);
+      if (!m_hThread)
+         throw Exception("error creating thread for convolution level");
+      SetThreadPriority(m_hThread, THREAD_PRIORITY_HIGHEST);
+      }
+   catch (...)
+      {
+      Cleanup();
+      throw;
+      }
+}
+//--------------------------------------------------------------------------
+
+//--------------------------------------------------------------------------
+/// destructor. Does Cleanup
+//--------------------------------------------------------------------------
+CHtConvolutionLevel::~CHtConvolutionLevel()
+{
+   Cleanup();
+}
+//--------------------------------------------------------------------------
+
+//--------------------------------------------------------------------------
+/// Stops thread, closes handles and deletes uniform convolution
+//--------------------------------------------------------------------------
+void CHtConvolutionLevel::Cleanup()
+{
+   if (m_hThread)
+      {
+      m_bTerminate = true;
+      SetEvent(m_hWork);
+      WaitForSingleObject(m_hThread, INFINITE);
+      CloseHandle(m_hThread);
+      m_hThread = NULL;
+      }
+   if (m_hWork)
+      {
+      CloseHandle(m_hWork);
+      m_hWork = NULL;
+      }
+   if (m_hDone)
+      {
+      CloseHandle(m_hDone);
+      m_hDone = NULL;
+      }
+   if (m_ppc)
+      {
+      delete m_ppc;
+      m_ppc = NULL;
+      }
+}
+//--------------------------------------------------------------------------
+
+//--------------------------------------------------------------------------
+/// Thread function. Processes one partition after each 'work' signal
+//--------------------------------------------------------------------------
+DWORD WINAPI CHtConvolutionLevel::ThreadProc(LPVOID lpParameter)
+{
+   CHtConvolutionLevel* pcl = (CHtConvolutionLevel*)lpParameter;
+   while (1)
+      {
+      WaitForSingleObject(pcl->m_hWork, INFINITE);
+      if (pcl->m_bTerminate)
+         break;
+      try
+         {
+         pcl->m_ppc->Process(pcl->m_vvafJobIn, pcl->m_vvafJobOut);
+         }
+      catch (...)
+         {
+         pcl->m_bError = true;
+         }
+      SetEvent(pcl->m_hDone);
+      }
+   return 0;
+}
+//--------------------------------------------------------------------------
+
+//--------------------------------------------------------------------------
+/// Processing. Collects one fragment of input signal and adds one fragment of
+/// the current output to the output signal. If a partition is complete, the
+/// result of the previous partition is waited for and the complete partition
+/// is passed to the thread.
+/// \param[in] vvafWaveIn input wave data
+/// \param[in] nOffset offset of current fragment in vvafWaveIn
+/// \param[in] nFrames number of frames of current fragment. Must be a divisor
+/// of partition size
+/// \param[in,out] vvafWaveOut output wave data to add output of level to.
+/// \exception Exception if thread fails or does not finish in time
+//--------------------------------------------------------------------------
+void CHtConvolutionLevel::Process(const vvaf & vvafWaveIn, unsigned int nOffset, unsigned int nFrames, vvaf & vvafWaveOut)
+{
+   unsigned int nChannels = (unsigned int)m_vvafWaveIn.size();
+   unsigned int nChannel, nFrame;
+   for (nChannel = 0; nChannel < nChannels; nChannel++)
+      memcpy(&m_vvafWaveIn[nChannel][m_nPosition], &vvafWaveIn[nChannel][nOffset], nFrames*sizeof(float));
+   nChannels = (unsigned int)m_vvafWaveOut.size();
+   for (nChannel = 0; nChannel < nChannels; nChannel++)
+      {
+      float *pfOut         = &vvafWaveOut[nChannel][0];
+      const float *pfLevel = &m_vvafWaveOut[nChannel][m_nPosition];
+      for (nFrame = 0; nFrame < nFrames; nFrame++)
+         pfOut[nFrame] += pfLevel[nFrame];
+      }
+   m_nPosition += nFrames;
+   if (m_nPosition < m_nPartitionSize)
+      return;
+   m_nPosition = 0;
+
+   // deadline: the result of the previous partition is needed now
+   if (m_bPending)
+      {
+      if (WaitForSingleObject(m_hDone, 10000) != WAIT_OBJECT_0)
+         throw Exception("timeout in convolution level");
+      m_bPending = false;
+      if (m_bError)
+         throw Exception("error in convolution level");
+      }
+   // play result and pass complete partition to thread
+   m_vvafWaveOut.swap(m_vvafJobOut);
+   m_vvafWaveIn.swap(m_vvafJobIn);
+   ResetEvent(m_hDone);
+   m_bPending = true;
+   SetEvent(m_hWork);
+}
+//--------------------------------------------------------------------------
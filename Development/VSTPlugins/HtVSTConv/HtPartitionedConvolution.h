@@ -35,6 +35,7 @@
 #ifndef HtPartitionedConvolutionH
 #define HtPartitionedConvolutionH
 //--------------------------------------------------------------------------
+#include <windows.h>
 #include "HtFFT3.h"
 #include "HtTransferFunction.h"
 
@@ -52,20 +53,56 @@
 //--------------------------------------------------------------------------
 struct FilterIndex
 {
-   unsigned int m_nChannelIndex;    /// channel index of a
-   unsigned int m_nDelay;           /// delay (in blocks)
+   unsigned int m_nChannelIndex;       /// (output) channel index of a
+   unsigned int m_nInputChannelIndex;  /// input channel index of a
+   unsigned int m_nDelay;              /// delay (in blocks)
 };
 //--------------------------------------------------------------------------
 
+//--------------------------------------------------------------------------
+/// float buffer aligned to 32 bytes for SIMD processing, prefix af
+//--------------------------------------------------------------------------
+class CHtAlignedFloats
+{
+   public:
+      CHtAlignedFloats() : m_pfData(NULL) {}
+      void     Resize(size_t nSize);
+      float*   Data() const { return m_pfData; }
+   private:
+      std::vector<float>   m_vfData;      /// data including space for alignment
+      float*               m_pfData;      /// aligned pointer into m_vfData
+      CHtAlignedFloats(const CHtAlignedFloats&);
+      CHtAlignedFloats& operator=(const CHtAlignedFloats&);
+};
+//--------------------------------------------------------------------------
+
+class CHtConvolutionLevel;
+
 //--------------------------------------------------------------------------
 /// Class for multichannel partitioned convolution, prefix pc
+/// If a maximum partition size larger than the fragment size is passed,
+/// non-uniform partitions are used: the head of the impulse responses is
+/// processed with partitions of fragment size, the tail with larger
+/// partitions that are processed on background threads (see
+/// CHtConvolutionLevel)
+/// In MIMO mode (different numbers of input and output channels or transfer
+/// functions with different input and output channel) every transfer
+/// function filters one input channel to one output channel. Each input
+/// channel is transformed once and each output channel is transformed back
+/// once, however many transfer functions use them.
 //--------------------------------------------------------------------------
 class CHtPartitionedConvolution
 {
    public:
       CHtPartitionedConvolution( unsigned int nFragSize,
                                  unsigned int nChannels,
-                                 const CHtTransferFunctions & tfs);
+                                 const CHtTransferFunctions & tfs,
+                                 unsigned int nMaxPartitionSize = 0);
+      CHtPartitionedConvolution( unsigned int nFragSize,
+                                 unsigned int nInputChannels,
+                                 unsigned int nOutputChannels,
+                                 const CHtTransferFunctions & tfs,
+                                 unsigned int nMaxPartitionSize = 0);
       ~CHtPartitionedConvolution();
 
       // different types of processing routines
@@ -73,52 +110,113 @@ class CHtPartitionedConvolution
                      float * const *   ppfSignalOut,
                      unsigned int      nChannels,
                      unsigned int      nFrames);
+      void Process(  float * const *   ppfSignalIn,
+                     unsigned int      nInputChannels,
+                     float * const *   ppfSignalOut,
+                     unsigned int      nOutputChannels,
+                     unsigned int      nFrames);
       void Process(vvaf & vvafSignalIn, vvaf & vvafSignalOut);
       // inline processing
       void Process(vvaf & vvafSignal);
    private:
 
       unsigned int m_nFragSize;           /// Audio fragment size, always equal to partition size.
-      unsigned int m_nChannels;           /// Number of audio channels.
+      unsigned int m_nInputChannels;      /// Number of input channels.
+      unsigned int m_nOutputChannels;     /// Number of output channels.
       unsigned int m_nOutputPartitions;   /// The maximum number of partitions in any of the impulse responses.
                                           /// Determines the size if the delay line.
       unsigned int m_nFilterPartitions;   /// The total number of non-zero impulse response partitions.
       unsigned int m_nWaveInBufferHalfCurrentIndex;   /// A counter modulo 2. Indicates the buffer half in input
                                                       /// signal wave into which to copy the current input signal.
+      unsigned int m_nBins;               /// Number of fft bins (m_nFragSize+1) rounded up to a multiple of 8
+                                          /// for SIMD processing. The additional bins are always zero.
 
-      vvaf   m_vvafWaveIn;                /// Buffer for input signal. Has m_nChannels channels and m_nFragSize*2 frames
+      vvaf   m_vvafWaveIn;                /// Buffer for input signal. Has m_nInputChannels channels and m_nFragSize*2 frames
 
 
-      vvac m_vvacSpecIn;                  /// Buffer for FFT transformed input signal. Has m_nChannels channels
+      vvac m_vvacSpecIn;                  /// Buffer for FFT transformed input signal. Has m_nInputChannels channels
                                           /// and m_nFragSize+1 frames (fft bins).
 
-      vvac   m_vvacFrequencyResponse;     /// Buffers for frequency response spectra of impulse response
-                                          /// partitions.  Each "channel" contains another partition of
-                                          /// some impulse response.  The array m_fiBookKeeping is used to
-                                          /// keep track what to do with these frequency responses.
-                                          /// This container has m_nFilterPartitions channels and m_nFragSize+1
-                                          /// frames (fft bins).
+      CHtAlignedFloats m_afFdlRe;         /// Frequency-domain delay line: real parts of the spectra of the last
+                                          /// m_nOutputPartitions input blocks of all input channels. Layout is
+                                          /// [input channel][partition][bin] with m_nBins bins per partition.
+      CHtAlignedFloats m_afFdlIm;         /// Imaginary parts of frequency-domain delay line.
+      unsigned int m_nInputPartitionCurrentIndex;     /// A counter modulo m_nOutputPartitions, indexing the
+                                                      /// partition of the delay line containing the current
+                                                      /// input spectrum.
+
+      CHtAlignedFloats m_afFilterRe;      /// Real parts of frequency response spectra of impulse response
+                                          /// partitions. Layout is [filter partition][bin] with m_nBins bins.
+                                          /// The array m_fiBookKeeping is used to keep track what to do with
+                                          /// these frequency responses.
+      CHtAlignedFloats m_afFilterIm;      /// Imaginary parts of frequency response spectra.
 
       std::vector<FilterIndex> m_fiBookKeeping; /// Keeps track of channel index, and delay. The index into
-                                                /// this array is the same as the "channel" index into the
-                                                /// m_vvacFrequencyResponse array. Array has m_nFilterPartitions
+                                                /// this array is the same as the filter partition index into
+                                                /// m_afFilterRe/m_afFilterIm. Array has m_nFilterPartitions
                                                 /// entries.
-
-      std::vector<vvac> m_vvacSpecOut;    /// Buffers for FFT transformed output signal. For each array
-                                          /// member, the number of channels is equal to m_nChannels,
-                                          /// number of frames (fft bins) is equal to m_nFragSize+1.
-                                          /// Array size is equal to m_nOutputPartitions.
-      unsigned int m_nOutputPartitionCurrentIndex;    /// A counter modulo output_partitions, indexing the
-                                                      /// "current" output partition.
+      std::vector<std::vector<unsigned int> > m_vvnChannelPartitions;   /// Indices of filter partitions for each
+                                                                        /// output channel.
+      std::vector<const float*> m_vpfTerms;     /// Pointers to spectra passed to complex multiply-accumulate
+                                                /// kernel (four for each filter partition of a channel).
+      CHtAlignedFloats m_afSumRe;         /// Real parts of output spectrum of one output channel.
+      CHtAlignedFloats m_afSumIm;         /// Imaginary parts of output spectrum of one channel.
+
+      vvac m_vvacSpecOut;                 /// Buffer for FFT transformed output signal. Has m_nOutputChannels channels
+                                          /// and m_nFragSize+1 frames (fft bins).
 
       vvaf   m_vvafWaveOut;               /// Buffer for the wave output signal. Number of channels is equal
-                                          /// to m_nChannels, number of frames is equal to m_nFragSize
+                                          /// to m_nOutputChannels, number of frames is equal to m_nFragSize
 
 
-      CHtFFT* m_pfft;                     /// CHtFFT instance
+      CHtFFT* m_pfft;                     /// CHtFFT instance for FFT of input channels (and impulse responses)
+      CHtFFT* m_pfftOut;                  /// CHtFFT instance for IFFT of output channels
+
+      std::vector<CHtConvolutionLevel*> m_vpLevels;   /// Levels with larger partitions processing the tail
+                                                      /// of the impulse responses (non-uniform mode only)
 
       // private processing routine
       void DoProcess();
+      void Create(const CHtTransferFunctions & tfs, unsigned int nMaxPartitionSize);
+      void Init(const CHtTransferFunctions & tfs);
+      void Cleanup();
+};
+//--------------------------------------------------------------------------
+
+//--------------------------------------------------------------------------
+/// Class for one level of non-uniform partitioned convolution, prefix cl.
+/// A level processes the part of the impulse responses starting at twice
+/// it's partition size with a uniform CHtPartitionedConvolution on an own
+/// thread. Input is collected until one partition is complete. The result
+/// is needed one partition later, so the thread has the duration of one
+/// partition to calculate it. The audio thread waits for the result at
+/// that deadline.
+//--------------------------------------------------------------------------
+class CHtConvolutionLevel
+{
+   public:
+      CHtConvolutionLevel( unsigned int nPartitionSize,
+                           unsigned int nInputChannels,
+                           unsigned int nOutputChannels,
+                           const CHtTransferFunctions & tfs);
+      ~CHtConvolutionLevel();
+      void Process(const vvaf & vvafWaveIn, unsigned int nOffset, unsigned int nFrames, vvaf & vvafWaveOut);
+   private:
+      unsigned int m_nPartitionSize;      /// partition size of this level
+      unsigned int m_nPosition;           /// position within current partition
+      CHtPartitionedConvolution* m_ppc;   /// uniform convolution with partition size
+      vvaf   m_vvafWaveIn;                /// Buffer collecting the input signal of one partition
+      vvaf   m_vvafJobIn;                 /// Input signal of partition processed by thread
+      vvaf   m_vvafJobOut;                /// Output signal calculated by thread
+      vvaf   m_vvafWaveOut;               /// Output signal currently played
+      HANDLE m_hThread;                   /// processing thread
+      HANDLE m_hWork;                     /// event signalling a new partition to process
+      HANDLE m_hDone;                     /// event signalling that processing is done
+      bool   m_bPending;                  /// flag if thread is processing a partition
+      volatile bool m_bTerminate;         /// flag to terminate thread
+      volatile bool m_bError;             /// flag if processing in thread failed
+      static DWORD WINAPI ThreadProc(LPVOID lpParameter);
+      void Cleanup();
 };
 //--------------------------------------------------------------------------
 #endif // #ifndef HtPartitionedConvolutionH
@@ -58,7 +58,24 @@
 CHtTransferFunction::CHtTransferFunction( unsigned int nChannelIndex,
                                           const std::vector<float> & vfImpulseResponse)
    :  m_vfImpulseResponse(vfImpulseResponse),
-      m_nChannelIndex(nChannelIndex)
+      m_nChannelIndex(nChannelIndex),
+      m_nInputChannelIndex(nChannelIndex)
+{
+}
+//--------------------------------------------------------------------------
+
+//--------------------------------------------------------------------------
+/// Constructor for MIMO convolution. Initializes members
+/// \param[in] nInputChannelIndex input channel index to store
+/// \param[in] nOutputChannelIndex output channel index to store
+/// \param[in] vfImpulseResponse float vector containing impulse response
+//--------------------------------------------------------------------------
+CHtTransferFunction::CHtTransferFunction( unsigned int nInputChannelIndex,
+                                          unsigned int nOutputChannelIndex,
+                                          const std::vector<float> & vfImpulseResponse)
+   :  m_vfImpulseResponse(vfImpulseResponse),
+      m_nChannelIndex(nOutputChannelIndex),
+      m_nInputChannelIndex(nInputChannelIndex)
 {
 }
 //--------------------------------------------------------------------------
@@ -154,3 +171,48 @@ std::valarray<unsigned int> CHtTransferFunctions::PartitionsNonEmpty(unsigned in
 }
 //--------------------------------------------------------------------------
 
+//--------------------------------------------------------------------------
+/// returns the maximum length of all impulse responses
+/// \retval maximum length in samples
+//--------------------------------------------------------------------------
+unsigned int CHtTransferFunctions::MaxLength() const
+{
+   unsigned int nResult = 0;
+   unsigned int nSize = (unsigned int)size();
+   unsigned int nTransferFunction;
+   for (nTransferFunction = 0; nTransferFunction < nSize; nTransferFunction++)
+      {
+      if ((*this)[nTransferFunction].m_vfImpulseResponse.size() > nResult)
+         nResult = (unsigned int)(*this)[nTransferFunction].m_vfImpulseResponse.size();
+      }
+   return nResult;
+}
+//--------------------------------------------------------------------------
+
+//--------------------------------------------------------------------------
+/// returns transfer functions containing a segment of all impulse responses
+/// with unchanged input and output channel indices
+/// \param[in] nBegin first sample of segment
+/// \param[in] nEnd sample behind segment
+/// \retval transfer functions with segments (may be empty if an impulse
+/// response is shorter than nBegin)
+//--------------------------------------------------------------------------
+CHtTransferFunctions CHtTransferFunctions::Segment(unsigned int nBegin, unsigned int nEnd) const
+{
+   CHtTransferFunctions tfs;
+   unsigned int nSize = (unsigned int)size();
+   unsigned int nTransferFunction;
+   for (nTransferFunction = 0; nTransferFunction < nSize; nTransferFunction++)
+      {
+      const std::vector<float>& vfImpulseResponse = (*this)[nTransferFunction].m_vfImpulseResponse;
+      unsigned int nLength = (unsigned int)vfImpulseResponse.size();
+      std::vector<float> vfSegment;
+      if (nBegin < nLength)
+         vfSegment.assign(vfImpulseResponse.begin() + nBegin, vfImpulseResponse.begin() + (nEnd < nLength ? nEnd : nLength));
+      tfs.push_back(CHtTransferFunction((*this)[nTransferFunction].m_nInputChannelIndex,
+                                        (*this)[nTransferFunction].m_nChannelIndex,
+                                        vfSegment));
+      }
+   return tfs;
+}
+//--------------------------------------------------------------------------
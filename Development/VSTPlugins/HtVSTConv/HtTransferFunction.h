@@ -41,15 +41,21 @@
 
 //--------------------------------------------------------------------------
 /// Helper class containing an impulse response for one channel with helper
-/// functions. Prefix tf.
+/// functions. Prefix tf. The impulse response filters input channel
+/// m_nInputChannelIndex to output channel m_nChannelIndex (identical unless
+/// created for MIMO convolution).
 //--------------------------------------------------------------------------
 class CHtTransferFunction
 {
    public:
       std::vector<float>   m_vfImpulseResponse;    /// float vector containing impulse response for one channel
-      unsigned int         m_nChannelIndex;        /// corresponing channel index
+      unsigned int         m_nChannelIndex;        /// corresponing (output) channel index
+      unsigned int         m_nInputChannelIndex;   /// corresponing input channel index
 
       CHtTransferFunction( unsigned int nChannelIndex, const std::vector<float> & vfImpulseResponse);
+      CHtTransferFunction( unsigned int nInputChannelIndex,
+                           unsigned int nOutputChannelIndex,
+                           const std::vector<float> & vfImpulseResponse);
       unsigned int   Partitions(unsigned int nFragsize) const;
       unsigned int   PartitionsNonEmpty(unsigned int nFragsize) const;
       bool           IsEmpty(unsigned int nFragsize, unsigned int nIndex) const;
@@ -65,6 +71,8 @@ class CHtTransferFunctions : public std::vector<CHtTransferFunction>
    public:
       std::valarray<unsigned int> Partitions(unsigned int nFragsize) const;
       std::valarray<unsigned int> PartitionsNonEmpty(unsigned int nFragsize) const;
+      unsigned int                MaxLength() const;
+      CHtTransferFunctions        Segment(unsigned int nBegin, unsigned int nEnd) const;
 };
 //--------------------------------------------------------------------------
 
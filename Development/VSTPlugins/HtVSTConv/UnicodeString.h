@@ -0,0 +1,107 @@
+//-----------------------------------------------------------------------------
+/// \file UnicodeString.h
+/// \author Berg
+/// \brief Minimal UnicodeString and Exception for building CHtFFT without VCL
+///
+/// Project SoundMexPro
+/// Module HtVstEq.dll, HtVSTConv.dll
+/// Minimal replacement of the Borland UnicodeString and Exception used by
+/// HtFFT3.cpp with compilers other than C++Builder (e.g. for the benchmark
+/// in HtVstEq/Benchmark). Implements UnicodeString::sprintf(const wchar_t*, ...)
+/// and Exception(const char*), Exception(const UnicodeString&) only.
+///
+/// ****************************************************************************
+/// Copyright 2023 Daniel Berg, Oldenburg, Germany
+/// ****************************************************************************
+///
+/// This file is part of SoundMexPro.
+///
+///    SoundMexPro is free software: you can redistribute it and/or modify
+///    it under the terms of the GNU General Public License as published by
+///    the Free Software Foundation, either version 3 of the License, or
+///    (at your option) any later version.
+///
+///    SoundMexPro is distributed in the hope that it will be useful,
+///    but WITHOUT ANY WARRANTY; without even the implied warranty of
+///    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+///    GNU General Public License for more details.
+///
+///    You should have received a copy of the GNU General Public License
+///    along with SoundMexPro.  If not, see <http:///www.gnu.org/licenses/>.
+///
+//-----------------------------------------------------------------------------
+#ifndef UnicodeStringH
+#define UnicodeStringH
+
+#include <stdarg.h>
+#include <wchar.h>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+/// String class with the subset of the Borland UnicodeString interface
+/// needed by CHtFFT.
+///
+/// variable prefix: str for (STR)ing
+class UnicodeString {
+    std::wstring m_str;
+public:
+    UnicodeString() {}
+
+    /// Returns the zero terminated contents.
+    const wchar_t * c_str() const { return m_str.c_str(); }
+
+    /// Replaces contents by formatted text (printf format) and returns *this.
+    UnicodeString & sprintf(const wchar_t * lpszFormat, ...)
+    {
+        std::vector<wchar_t> vc(256);
+        for (;;)
+        {
+            va_list args;
+            va_start(args, lpszFormat);
+            int nLen = vswprintf(&vc[0], vc.size(), lpszFormat, args);
+            va_end(args);
+            if (nLen >= 0 && (size_t)nLen < vc.size())
+            {
+                m_str.assign(&vc[0], (size_t)nLen);
+                break;
+            }
+            // vswprintf does not return the needed size: grow up to a limit
+            if (vc.size() >= 0x10000)
+            {
+                m_str.clear();
+                break;
+            }
+            vc.resize(vc.size() * 2);
+        }
+        return *this;
+    }
+};
+
+/// Exception class with the subset of the Borland Exception interface needed
+/// by CHtFFT. The message is available with what().
+class Exception : public std::runtime_error {
+public:
+    explicit Exception(const char * lpszMsg) : std::runtime_error(lpszMsg) {}
+
+    explicit Exception(const UnicodeString & str) : std::runtime_error(Narrow(str)) {}
+
+private:
+    /// Converts messages (ASCII only) to char.
+    static std::string Narrow(const UnicodeString & str)
+    {
+        std::string strNarrow;
+        for (const wchar_t * lpsz = str.c_str(); *lpsz; ++lpsz)
+            strNarrow += (*lpsz < 0x80) ? (char)*lpsz : '?';
+        return strNarrow;
+    }
+};
+
+#endif
+
+// Local Variables:
+// mode: c++
+// c-file-style: "stroustrup"
+// c-basic-offset: 4
+// indent-tabs-mode: nil
+// End:
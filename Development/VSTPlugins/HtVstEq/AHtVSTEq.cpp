@@ -614,6 +614,17 @@ bool __fastcall CHtVSTEq::LoadFilterFile(AnsiString sFileName)
       else if (us != "lin_lin")
          throw Exception("invalid InterpolMode found in settings");
 
+      // planning effort of FFTW plans created from now on
+      THtFFTPlanMode fpm = HTFFT_PLANMODE_ESTIMATE;
+      us = LowerCase(m_pIni->ReadString("Settings", "FFTPlanMode", "estimate"));
+      if (us == "measure")
+         fpm = HTFFT_PLANMODE_MEASURE;
+      else if (us == "patient")
+         fpm = HTFFT_PLANMODE_PATIENT;
+      else if (us != "estimate")
+         throw Exception("invalid FFTPlanMode found in settings");
+      CHtFFTPlanCache::Instance().SetPlanMode(fpm);
+
       // read FFT properties
       m_nFFTLen = (unsigned int)m_pIni->ReadInteger("Settings", "FFTLen", 512);
       m_nFFTLen = (unsigned int)ConvertToPowerOfTwo((int)m_nFFTLen);
@@ -0,0 +1,152 @@
+//-----------------------------------------------------------------------------
+/// \file HtFFTBenchmark.cpp
+/// \author Berg
+/// \brief Micro benchmark of the FFTW backends of CHtFFT
+///
+/// Project SoundMexPro
+/// Module HtVstEq.dll, HtVSTConv.dll
+/// Measures Wave2Spec followed by Spec2Wave of CHtFFT (HtFFT3.cpp, identical
+/// in HtVstEq and HtVSTConv) with backend HTFFT_BACKEND_R2R (one halfcomplex
+/// r2r transform per channel plus sorting) and HTFFT_BACKEND_R2C (one batched
+/// r2c/c2r transform for all channels) for typical FFT lengths and channel
+/// counts. One line per FFT length and channel count is printed with the time
+/// per channel in microseconds, the speedup of r2c and the maximum difference
+/// of the spectra of both backends. Usage:
+///    HtFFTBenchmark [estimate|measure|patient]
+///
+/// ****************************************************************************
+/// Copyright 2023 Daniel Berg, Oldenburg, Germany
+/// ****************************************************************************
+///
+/// This file is part of SoundMexPro.
+///
+///    SoundMexPro is free software: you can redistribute it and/or modify
+///    it under the terms of the GNU General Public License as published by
+///    the Free Software Foundation, either version 3 of the License, or
+///    (at your option) any later version.
+///
+///    SoundMexPro is distributed in the hope that it will be useful,
+///    but WITHOUT ANY WARRANTY; without even the implied warranty of
+///    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+///    GNU General Public License for more details.
+///
+///    You should have received a copy of the GNU General Public License
+///    along with SoundMexPro.  If not, see <http:///www.gnu.org/licenses/>.
+///
+//-----------------------------------------------------------------------------
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <chrono>
+#include "HtFFT3.h"
+
+/// number of samples transformed per measurement (per FFT length and channels)
+static const size_t c_nSamplesPerRun = 1 << 22;
+
+/// prevents the compiler from removing the transforms
+static volatile float g_fSink;
+
+/// Returns the time per call in microseconds of the best of 5 runs of
+/// function f calling nCalls times per run.
+template <typename F>
+static double Measure(F f, size_t nCalls)
+{
+    double dBest = 0;
+    for (int nRun = 0; nRun < 5; ++nRun)
+    {
+        std::chrono::steady_clock::time_point tpStart = std::chrono::steady_clock::now();
+        for (size_t nCall = 0; nCall < nCalls; ++nCall)
+            f();
+        std::chrono::duration<double, std::micro> d = std::chrono::steady_clock::now() - tpStart;
+        double dUs = d.count() / (double)nCalls;
+        if (!nRun || dUs < dBest)
+            dBest = dUs;
+    }
+    return dBest;
+}
+
+int main(int argc, char * argv[])
+{
+    THtFFTPlanMode mode = HTFFT_PLANMODE_ESTIMATE;
+    if (argc > 1)
+    {
+        if (!strcmp(argv[1], "measure"))
+            mode = HTFFT_PLANMODE_MEASURE;
+        else if (!strcmp(argv[1], "patient"))
+            mode = HTFFT_PLANMODE_PATIENT;
+        else if (strcmp(argv[1], "estimate"))
+        {
+            fprintf(stderr, "usage: HtFFTBenchmark [estimate|measure|patient]\n");
+            return 1;
+        }
+    }
+    CHtFFTPlanCache::Instance().SetPlanMode(mode);
+
+    static const unsigned int c_rgnFFTLen[] = { 128, 256, 512, 1024, 2048, 4096, 8192 };
+    static const unsigned int c_rgnChannels[] = { 1, 2, 8 };
+    printf("%6s %8s %9s %9s %7s %9s   [us/channel]\n", "fftlen", "channels", "r2r", "r2c", "speedup", "maxdiff");
+    try
+    {
+        for (size_t nLen = 0; nLen < sizeof(c_rgnFFTLen) / sizeof(c_rgnFFTLen[0]); ++nLen)
+        {
+            unsigned int nFFTLen = c_rgnFFTLen[nLen];
+            for (size_t nCh = 0; nCh < sizeof(c_rgnChannels) / sizeof(c_rgnChannels[0]); ++nCh)
+            {
+                unsigned int nChannels = c_rgnChannels[nCh];
+                size_t nCalls = c_nSamplesPerRun / (nFFTLen * nChannels);
+                if (!nCalls)
+                    nCalls = 1;
+                vvaf vvafWave(nChannels, vaf(nFFTLen));
+                for (unsigned int nChannel = 0; nChannel < nChannels; ++nChannel)
+                    for (unsigned int nFrame = 0; nFrame < nFFTLen; ++nFrame)
+                        vvafWave[nChannel][nFrame] = (float)rand() / (float)RAND_MAX - 0.5f;
+                vvaf vvafOut(nChannels, vaf(nFFTLen));
+
+                double rgdUs[2];
+                vvac rgvvacSpec[2];
+                static const THtFFTBackend c_rgBackend[2] = { HTFFT_BACKEND_R2R, HTFFT_BACKEND_R2C };
+                for (int nBackend = 0; nBackend < 2; ++nBackend)
+                {
+                    CHtFFT fft(nFFTLen, nChannels, c_rgBackend[nBackend]);
+                    vvac & vvacSpec = rgvvacSpec[nBackend];
+                    vvacSpec.assign(nChannels, vac(nFFTLen / 2 + 1));
+                    fft.Wave2Spec(vvafWave, vvacSpec, false);
+                    rgdUs[nBackend] = Measure([&]() {
+                            fft.Wave2Spec(vvafWave, vvacSpec, false);
+                            fft.Spec2Wave(vvacSpec, vvafOut);
+                            g_fSink = vvafOut[0][0];
+                        }, nCalls) / (double)nChannels;
+                }
+                // both backends must return the identical spectrum (internal order)
+                float fMaxDiff = 0.0f;
+                for (unsigned int nChannel = 0; nChannel < nChannels; ++nChannel)
+                    for (unsigned int nBin = 0; nBin < nFFTLen / 2 + 1; ++nBin)
+                    {
+                        float fDiff = std::abs(rgvvacSpec[0][nChannel][nBin] - rgvvacSpec[1][nChannel][nBin]);
+                        if (fDiff > fMaxDiff)
+                            fMaxDiff = fDiff;
+                    }
+                printf("%6u %8u %9.3f %9.3f %6.2fx %9.2e\n", nFFTLen, nChannels,
+                       rgdUs[0], rgdUs[1], rgdUs[0] / rgdUs[1], (double)fMaxDiff);
+            }
+        }
+    }
+    catch (const std::exception & e)
+    {
+        fprintf(stderr, "error: %s\n", e.what());
+        return 1;
+    }
+
+    CHtFFTPlanStats fps;
+    CHtFFTPlanCache::Instance().GetStats(fps);
+    printf("plans: %u, planning time: %.1f ms, wisdom loaded: %s\n",
+           fps.nPlans, fps.dPlanningMs, fps.bWisdomLoaded ? "yes" : "no");
+    return 0;
+}
+
+// Local Variables:
+// mode: c++
+// c-file-style: "stroustrup"
+// c-basic-offset: 4
+// indent-tabs-mode: nil
+// End:
@@ -42,10 +42,18 @@
 #include <vector>
 #include <valarray>
 #include <complex>
+#include <map>
+#include <string>
 
 
-/// include vcl only for Borland compiler
+/// include vcl only for Borland compiler, other compilers (benchmark in
+/// HtVstEq/Benchmark) use minimal replacements of Exception and UnicodeString
+#ifdef __BORLANDC__
 #include <vcl.h>
+#else
+#include "UnicodeString.h"
+#endif
+#include <windows.h>
 
 #define CHtComplex std::complex<float>
 /// definition of valarray of floats
@@ -58,6 +66,104 @@ typedef std::vector<vaf > vvaf;
 typedef std::vector<vac > vvac;
 
 
+//--------------------------------------------------------------------------
+/// FFTW transforms used by CHtFFT
+//--------------------------------------------------------------------------
+enum THtFFTBackend
+{
+   HTFFT_BACKEND_R2R = 0,  /// one halfcomplex r2r transform per channel, spectrum is sorted to internal order
+   HTFFT_BACKEND_R2C       /// one batched r2c/c2r transform for all channels in native complex order
+};
+
+//--------------------------------------------------------------------------
+/// type of FFTW plans created by CHtFFTPlanCache
+//--------------------------------------------------------------------------
+enum THtFFTPlanType
+{
+   HTFFT_PLAN_R2HC = 0,    /// r2r halfcomplex forward transform
+   HTFFT_PLAN_HC2R,        /// r2r halfcomplex backward transform
+   HTFFT_PLAN_R2C,         /// batched r2c forward transform
+   HTFFT_PLAN_C2R          /// batched c2r backward transform
+};
+
+//--------------------------------------------------------------------------
+/// planning effort used by CHtFFTPlanCache for new plans
+//--------------------------------------------------------------------------
+enum THtFFTPlanMode
+{
+   HTFFT_PLANMODE_ESTIMATE = 0,  /// FFTW_ESTIMATE: no measurements
+   HTFFT_PLANMODE_MEASURE,       /// FFTW_MEASURE
+   HTFFT_PLANMODE_PATIENT        /// FFTW_PATIENT
+};
+
+//--------------------------------------------------------------------------
+/// statistics of CHtFFTPlanCache
+//--------------------------------------------------------------------------
+class CHtFFTPlanStats
+{
+   public:
+      unsigned int   nPlans;           /// number of cached plans
+      unsigned int   nHits;            /// number of requests served by cached plans
+      unsigned int   nMisses;          /// number of requests that created new plans
+      double         dPlanningMs;      /// total time spent in FFTW planner in milliseconds
+      bool           bWisdomLoaded;    /// true if wisdom file was loaded
+};
+
+//--------------------------------------------------------------------------
+/// Thread safe cache of FFTW plans shared by all CHtFFT instances of a
+/// module, prefix fpc. Plans are never destroyed and must be executed with
+/// the new-array execute functions of FFTW on buffers with the alignment
+/// passed to GetPlan. Default planning effort is FFTW_ESTIMATE. Wisdom is
+/// loaded from a file next to the binary on first use and saved once, when
+/// the last CHtFFT instance is destroyed after plans were measured.
+/// NOTE: libfftw3f-3.dll is shared by all modules of the process, but each
+/// module has its own cache, so all calls to the FFTW planner are serialized
+/// with a process wide named mutex
+//--------------------------------------------------------------------------
+class CHtFFTPlanCache
+{
+   public:
+      CHtFFTPlanCache();
+      ~CHtFFTPlanCache();
+      static CHtFFTPlanCache& Instance();
+      fftwf_plan     GetPlan(THtFFTPlanType type, unsigned int nFFTLen, unsigned int nBatch,
+                             const void* pIn, const void* pOut);
+      void           SetPlanMode(THtFFTPlanMode mode);
+      THtFFTPlanMode GetPlanMode();
+      void           GetStats(CHtFFTPlanStats &rfps);
+      void           AddUser();
+      void           RemoveUser();
+      static unsigned int WaveDist(unsigned int nFFTLen);
+      static unsigned int SpecDist(unsigned int nFFTLen);
+   private:
+      //--------------------------------------------------------------------------
+      /// key of a cached plan
+      //--------------------------------------------------------------------------
+      struct TPlanKey
+      {
+         unsigned int   m_nFFTLen;     /// FFT length
+         THtFFTPlanType m_type;        /// direction/type of transform
+         unsigned int   m_nBatch;      /// number of channels transformed by plan
+         unsigned int   m_nAlignIn;    /// byte offset of input buffer from 32 byte boundary
+         unsigned int   m_nAlignOut;   /// byte offset of output buffer from 32 byte boundary
+         bool operator<(const TPlanKey& rpk) const;
+      };
+      std::map<TPlanKey, fftwf_plan>   m_mapPlans;
+      CRITICAL_SECTION  m_csPlans;
+      HANDLE            m_hPlanner;          /// process wide mutex serializing FFTW planner calls
+      THtFFTPlanMode    m_mode;
+      CHtFFTPlanStats   m_fps;
+      bool              m_bWisdomChecked;
+      bool              m_bWisdomDirty;      /// true if measured plans were created since last save
+      unsigned int      m_nUsers;            /// number of CHtFFT instances using the cache
+      std::string       m_strWisdomFile;
+      void              LockPlanner();
+      void              UnlockPlanner();
+      fftwf_plan        CreatePlan(const TPlanKey& pk);
+      void              LoadWisdom();
+      void              SaveWisdom();
+};
+
 //--------------------------------------------------------------------------
 /// Class encapsulating call to FFTW, prefix fft
 //--------------------------------------------------------------------------
@@ -65,21 +171,30 @@ class CHtFFT
 {
    friend class UNIT_TEST_CLASS;
    public:
-      CHtFFT(unsigned int nFFTLen);
+      CHtFFT(unsigned int nFFTLen, unsigned int nChannels = 1, THtFFTBackend backend = HTFFT_BACKEND_R2C);
       ~CHtFFT();
       void Wave2Spec(const vvaf & vvafWave, vvac& vvacSpec, bool bSwap );
       void Spec2Wave(const vvac & vvacSpec, vvaf & vvafWave);
+      THtFFTBackend Backend() const { return m_backend; }
     private:
       unsigned int         m_nFFTLen;              /// FFTlength to use
       unsigned int         m_nRe;                  /// number of real values
       unsigned int         m_nIm;                  /// number of imaginary values
       float                m_fScale;               /// internal scaling
-      std::valarray<float> m_vafBufIn;             /// input data buffer for FFTW
-      std::valarray<float> m_vafBufOut;            /// output data buffer for FFTW
+      THtFFTBackend        m_backend;              /// FFTW transforms used
+      unsigned int         m_nBatch;               /// number of channels transformed by one batched plan
+      unsigned int         m_nWaveDist;            /// distance of channels in m_pfBatchWave (floats, multiple of 8)
+      unsigned int         m_nSpecDist;            /// distance of channels in m_pcBatchSpec (complex, multiple of 4)
+      float*               m_pfBatchWave;          /// aligned planar wave buffer for batched plans
+      fftwf_complex*       m_pcBatchSpec;          /// aligned planar spectrum buffer for batched plans
+      std::valarray<float> m_vafBufIn;             /// input data buffer for FFTW (r2r backend only)
+      std::valarray<float> m_vafBufOut;            /// output data buffer for FFTW (r2r backend only)
       fftwf_plan            m_fftw_plan_Wave2Spec;  /// plan for the FFTW for FFT, see FFTW documentataion
       fftwf_plan            m_fftw_plan_Spec2Wave;  /// plan for the FFTW for IFFT, see FFTW documentataion
       void SortFFTW2Spec(const vaf & vafFFTW, vvac & vvacSpec, unsigned int nChannel);
       void SortSpec2FFTW(vaf & vafFFTW, const vvac & vvacSpec, unsigned int nChannel);
+      void Wave2SpecBatch(const vvaf & vvafWave, vvac& vvacSpec, bool bSwap);
+      void Spec2WaveBatch(const vvac & vvacSpec, vvaf & vvafWave, unsigned int nFrames);
       unsigned int GetNumFrames(const vvaf &vvafWave);
       void Cleanup();
       void InternalCheckSizes(const vaf  & vafFFTW,
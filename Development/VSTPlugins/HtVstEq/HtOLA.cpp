@@ -165,7 +165,7 @@ void CHtOLA::Initialize(unsigned int nChannels, unsigned int nFFTLen, unsigned i
       // m_f4IFFTScalingFactor = 2.0f/(float)(m_nWindowLen / m_nWindowShift) * f4SpectrumScaling;
 
       // create FFT
-      m_pFFT = new CHtFFT(m_nFFTLen);
+      m_pFFT = new CHtFFT(m_nFFTLen, m_nChannels);
       Reset();
       }
    catch (...)
@@ -446,10 +446,21 @@ void __fastcall TfrmEqInput::SetFilterProperties()
    else
       sb->Panels->Items[1]->Text = "real filter";
 
-   AnsiString str;
-   str.printf( "FFT: %d", m_pEqualizer->m_nFFTLen);
+   ShowFFTProperties();
+}
+//------------------------------------------------------------------------------
 
-   sb->Panels->Items[0]->Text = str;
+//------------------------------------------------------------------------------
+/// shows FFT length and FFTW planning statistics in status bar
+//------------------------------------------------------------------------------
+void TfrmEqInput::ShowFFTProperties()
+{
+   CHtFFTPlanStats fps;
+   CHtFFTPlanCache::Instance().GetStats(fps);
+   AnsiString str;
+   str.printf( "FFT: %d, plans: %u (%.1lf ms)", m_pEqualizer->m_nFFTLen, fps.nPlans, fps.dPlanningMs);
+   if (sb->Panels->Items[0]->Text != str)
+      sb->Panels->Items[0]->Text = str;
 }
 //------------------------------------------------------------------------------
 
@@ -494,6 +505,8 @@ void __fastcall TfrmEqInput::UpdateTimerTimer(TObject *Sender)
    UpdateTimer->Enabled = false;
    if (UpdateTimer->Tag)
       m_pEqualizer->Update();
+   // plans are created in startProcess
+   ShowFFTProperties();
 
    UpdateTimer->Tag = 0;
    UpdateTimer->Enabled = true;
@@ -117,6 +117,7 @@ class TfrmEqInput : public TForm
       unsigned int m_nFFTLen;
       float m_fSampleRate;
       void  SetPosCaption(double dX, double dY);
+      void  ShowFFTProperties();
    public:		// Anwender-Deklarationen
       __fastcall TfrmEqInput(CHtVSTEq *pEqualizer);
       void __fastcall DisableSpectra();
@@ -457,6 +457,10 @@ void mexFunction(int nlhs, mxArray *plhs[], int nrhs, const mxArray *prhs[])
                SMPCreateFileMapping(mfData, strValue.c_str(), dwSize);
                // clear it
                ZeroMemory(mfData.pData, dwSize);
+               // for streaming reads of recgetdata (cursor passed) more data may
+               // be available now: limit them to the size of the mapped file
+               if (0==_strcmpi(strCommand.c_str(), SOUNDDLLPRO_CMD_RECGETDATA))
+                  strCmd = strCmd + SOUNDDLLPRO_PAR_SAMPLES "=" + IntegerToStr(nBufSize) + ";";
                // append name of MemMapped file to command for 'regular' call below
                strCmd += SOUNDDLLPRO_PAR_DATA "=";
                strCmd += strValue;
@@ -583,7 +587,9 @@ void mexFunction(int nlhs, mxArray *plhs[], int nrhs, const mxArray *prhs[])
 
                   if (!TryStrToInteger(GetValue(vsRet, SOUNDDLLPRO_PAR_BUFSIZE), nBufSize64) || nBufSize64 < 0)
                      throw SOUNDMEX_Error("invalid buffersize value returned from command: " + GetValue(vsRet, SOUNDDLLPRO_PAR_BUFSIZE));
-                  if (nBufSize64 == 0)
+                  // NOTE: streaming reads of recgetdata (cursor passed) may return no new data
+                  bool bCursor = GetValue(vsRet, SOUNDDLLPRO_PAR_CURSOR).length() > 0;
+                  if (nBufSize64 == 0 && !bCursor)
                      throw SOUNDMEX_Error("no data available/recorded (buffer size is 0)");
 
                   if (!TryStrToInteger(GetValue(vsRet, SOUNDDLLPRO_PAR_CHANNELS), nChannels64) || nChannels64 < 0)
@@ -630,6 +636,15 @@ void mexFunction(int nlhs, mxArray *plhs[], int nrhs, const mxArray *prhs[])
                         plhs[2] = mxCreateDoubleMatrix(1, 1, mxREAL);
                         *mxGetPr(plhs[2]) = (double)nDataPos64;
                         }
+                     // write number of lost samples of streaming read
+                     if ((0==_strcmpi(strCommand.c_str(), SOUNDDLLPRO_CMD_RECGETDATA)) && nlhs > 3)
+                        {
+                        __int64 nOverrun64 = 0;
+                        if (bCursor && !TryStrToInteger(GetValue(vsRet, SOUNDDLLPRO_PAR_OVERRUN), nOverrun64))
+                           throw SOUNDMEX_Error("invalid overrun value returned from command: " + GetValue(vsRet, SOUNDDLLPRO_PAR_OVERRUN));
+                        plhs[3] = mxCreateDoubleMatrix(1, 1, mxREAL);
+                        *mxGetPr(plhs[3]) = (double)nOverrun64;
+                        }
                      }
                   }
                catch (...)
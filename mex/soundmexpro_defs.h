@@ -138,6 +138,13 @@ enum  {
 #define SOUNDDLLPRO_CMD_WAIT           "wait"
 #define SOUNDDLLPRO_CMD_PLAYING        "playing"
 #define SOUNDDLLPRO_CMD_XRUN           "xrun"
+#define SOUNDDLLPRO_CMD_FILEREADSTATS  "filereadstats"
+#define SOUNDDLLPRO_CMD_RECWRITESTATS  "recwritestats"
+#define SOUNDDLLPRO_CMD_LOADMEMSTATS   "loadmemstats"
+#define SOUNDDLLPRO_CMD_PERFREPORT     "perfreport"
+#define SOUNDDLLPRO_CMD_PERFSTATS      "perfstats"
+#define SOUNDDLLPRO_CMD_PERFSTATSRESET "perfstatsreset"
+#define SOUNDDLLPRO_CMD_TRACEDUMP      "tracedump"
 #define SOUNDDLLPRO_CMD_CLIPTHRS       "clipthreshold"
 #define SOUNDDLLPRO_CMD_CLIPCOUNT      "clipcount"
 #define SOUNDDLLPRO_CMD_RESETCLIPCOUNT "resetclipcount"
@@ -149,6 +156,7 @@ enum  {
 #define SOUNDDLLPRO_CMD_RECSTARTED     "recstarted"
 #define SOUNDDLLPRO_CMD_RECLEN         "reclength"
 #define SOUNDDLLPRO_CMD_RECFILENAME    "recfilename"
+#define SOUNDDLLPRO_CMD_RECMULTIFILE   "recmultifile"
 #define SOUNDDLLPRO_CMD_RECPAUSE       "recpause"
 #define SOUNDDLLPRO_CMD_RECVOLUME      "recvolume"
 #define SOUNDDLLPRO_CMD_RECORDING      "recording"
@@ -196,6 +204,10 @@ enum  {
 #define SOUNDDLLPRO_PAR_FILE2FILE      "file2file"
 #define SOUNDDLLPRO_PAR_RECCOMPLATENCY "reccompensatelatency"
 #define SOUNDDLLPRO_PAR_FILEREADBUFSIZE "filereadbufsize"
+#define SOUNDDLLPRO_PAR_FILEREADTHREADS "filereadthreads"
+#define SOUNDDLLPRO_PAR_FILEREADMAP    "filereadmap"
+#define SOUNDDLLPRO_PAR_RECWRITEBUFSIZE "recwritebufsize"
+#define SOUNDDLLPRO_PAR_RECWRITEBLOCKSIZE "recwriteblocksize"
 #define SOUNDDLLPRO_PAR_F2FBUFSIZE     "f2fbufsize"
 #define SOUNDDLLPRO_PAR_NUMBUFS        "numbufs"
 #define SOUNDDLLPRO_PAR_FREEZESRATE    "freezesamplerate"
@@ -215,6 +227,7 @@ enum  {
 #define SOUNDDLLPRO_PAR_WIDTH          "width"
 #define SOUNDDLLPRO_PAR_HEIGHT         "height"
 #define SOUNDDLLPRO_PAR_DATA           "data"
+#define SOUNDDLLPRO_PAR_DATAKEY        "datakey"
 #define SOUNDDLLPRO_PAR_DATADEST       "datadest"
 #define SOUNDDLLPRO_PAR_NAME           "name"
 #define SOUNDDLLPRO_PAR_SAMPLERATE     "samplerate"
@@ -230,9 +243,18 @@ enum  {
 #define SOUNDDLLPRO_PAR_LATENCYIN      "LatencyIn"
 #define SOUNDDLLPRO_PAR_LATENCYOUT	   "LatencyOut"
 #define SOUNDDLLPRO_PAR_SAMPLES        "samples"
+#define SOUNDDLLPRO_PAR_CURSOR         "cursor"
+#define SOUNDDLLPRO_PAR_OVERRUN        "overrun"
 #define SOUNDDLLPRO_PAR_CHANNELS       "channels"
 #define SOUNDDLLPRO_PAR_VSTMT          "vstmultithreading"
 #define SOUNDDLLPRO_PAR_VSTTP          "vstthreadpriority"
+#define SOUNDDLLPRO_PAR_VSTTHREADS     "vstthreads"
+#define SOUNDDLLPRO_PAR_TRACKTHREADS   "trackthreads"
+#define SOUNDDLLPRO_PAR_TRACESIZE      "tracesize"
+#define SOUNDDLLPRO_PAR_TRACEXRUNFILE  "tracexrunfile"
+#define SOUNDDLLPRO_PAR_NULLCLOCK      "nullclock"
+#define SOUNDDLLPRO_PAR_NULLINPUT      "nullinput"
+#define SOUNDDLLPRO_PAR_NULLINPUTFILE  "nullinputfile"
 #define SOUNDDLLPRO_PAR_LOOPCOUNT      "loopcount"
 #define SOUNDDLLPRO_PAR_PLUGIN_EXE     "pluginexe"
 #define SOUNDDLLPRO_PAR_PLUGIN_START   "pluginstart"
@@ -252,7 +274,34 @@ enum  {
 #define SOUNDDLLPRO_PAR_CLOSERECFILE   "closerecfile"
 #define SOUNDDLLPRO_PAR_XR_PROC        "xrunproc"
 #define SOUNDDLLPRO_PAR_XR_DONE        "xrundone"
+#define SOUNDDLLPRO_PAR_THREADS        "threads"
+#define SOUNDDLLPRO_PAR_QUEUEDEPTH     "queuedepth"
+#define SOUNDDLLPRO_PAR_MAXQUEUEDEPTH  "maxqueuedepth"
+#define SOUNDDLLPRO_PAR_REQUESTS       "requests"
+#define SOUNDDLLPRO_PAR_MISSED         "missed"
+#define SOUNDDLLPRO_PAR_WORSTSLACK     "worstslack"
+#define SOUNDDLLPRO_PAR_REATTACHES     "reattaches"
+#define SOUNDDLLPRO_PAR_UNDERRUNSAMPLES "underrunsamples"
+#define SOUNDDLLPRO_PAR_BLOCKS         "blocks"
+#define SOUNDDLLPRO_PAR_REFERENCES     "references"
+#define SOUNDDLLPRO_PAR_BYTES          "bytes"
+#define SOUNDDLLPRO_PAR_SAVEDBYTES     "savedbytes"
+#define SOUNDDLLPRO_PAR_HITS           "hits"
+#define SOUNDDLLPRO_PAR_MISSES         "misses"
+#define SOUNDDLLPRO_PAR_BLOCKSIZE      "blocksize"
+#define SOUNDDLLPRO_PAR_MAXBLOCKSUSED  "maxblocksused"
+#define SOUNDDLLPRO_PAR_FILES          "files"
+#define SOUNDDLLPRO_PAR_SYNCFILES      "syncfiles"
+#define SOUNDDLLPRO_PAR_WRITES         "writes"
+#define SOUNDDLLPRO_PAR_STALLS         "stalls"
+#define SOUNDDLLPRO_PAR_STALLTIME      "stalltime"
+#define SOUNDDLLPRO_PAR_MAXSTALLTIME   "maxstalltime"
+#define SOUNDDLLPRO_PAR_MAXWRITETIME   "maxwritetime"
 #define SOUNDDLLPRO_PAR_MAXVALUE       "maxvalue"
+#define SOUNDDLLPRO_PAR_COUNT          "count"
+#define SOUNDDLLPRO_PAR_P50            "p50"
+#define SOUNDDLLPRO_PAR_P99            "p99"
+#define SOUNDDLLPRO_PAR_P999           "p999"
 #define SOUNDDLLPRO_PAR_OFFSET         "offset"
 #define SOUNDDLLPRO_PAR_STARTOFFSET    "startoffset"
 #define SOUNDDLLPRO_PAR_BUSY           "busy"
@@ -313,5 +362,6 @@ enum  {
 #define SOUNDDLLPRO_PAR_ALL            "all"
 #define SOUNDDLLPRO_PAR_ASIO           "asio"
 #define SOUNDDLLPRO_PAR_WDM            "wdm"
+#define SOUNDDLLPRO_PAR_NULL           "null"
 //------------------------------------------------------------------------------
 #endif